@@ -21,6 +21,14 @@
 #include "citnames/citnames-forward.h"
 #include "intercept/intercept-forward.h"
 
+#include <fmt/format.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+
 namespace {
 
     constexpr std::optional<std::string_view> ADVANCED_GROUP = {"advanced options"};
@@ -36,10 +44,25 @@ namespace {
         auto verbose = arguments.as_bool(flags::VERBOSE).unwrap_or(false);
         auto force_wrapper = arguments.as_bool(cmd::intercept::FLAG_FORCE_WRAPPER).unwrap_or(false);
         auto force_preload = arguments.as_bool(cmd::intercept::FLAG_FORCE_PRELOAD).unwrap_or(false);
+        auto force_seccomp = arguments.as_bool(cmd::intercept::FLAG_FORCE_SECCOMP).unwrap_or(false);
+        auto force_ebpf = arguments.as_bool(cmd::intercept::FLAG_FORCE_EBPF).unwrap_or(false);
+        auto force_es = arguments.as_bool(cmd::intercept::FLAG_FORCE_ES).unwrap_or(false);
+        auto output_json = arguments.as_bool(cmd::intercept::FLAG_OUTPUT_JSON).unwrap_or(false);
+        auto output_zstd = arguments.as_bool(cmd::intercept::FLAG_OUTPUT_ZSTD).unwrap_or(false);
+        auto output_index = arguments.as_bool(cmd::intercept::FLAG_OUTPUT_INDEX).unwrap_or(false);
+        auto output_sync = arguments.as_string(cmd::intercept::FLAG_OUTPUT_SYNC).unwrap_or(cmd::intercept::SYNC_NONE);
+        auto resume = arguments.as_bool(cmd::intercept::FLAG_RESUME).unwrap_or(false);
+        auto server_threads = arguments.as_string(cmd::intercept::FLAG_SERVER_THREADS).unwrap_or("0");
+        auto affinity = arguments.as_string(cmd::intercept::FLAG_AFFINITY);
+        auto filter = arguments.as_string(cmd::intercept::FLAG_FILTER);
+        auto discard = arguments.as_string(cmd::intercept::FLAG_DISCARD);
+        auto capture = arguments.as_string(cmd::intercept::FLAG_CAPTURE);
+        auto sample = arguments.as_string(cmd::intercept::FLAG_SAMPLE).unwrap_or("1");
+        auto profile = arguments.as_bool(cmd::bear::FLAG_PROFILE).unwrap_or(false);
 
         return rust::merge(program, command, rust::merge(library, wrapper, wrapper_dir))
                 .map<sys::Process::Builder>(
-                        [&environment, &output, &verbose, &force_wrapper, &force_preload](auto tuple) {
+                        [&environment, &output, &verbose, &force_wrapper, &force_preload, &force_seccomp, &force_ebpf, &force_es, &output_json, &output_zstd, &output_index, &output_sync, &resume, &server_threads, &affinity, &filter, &discard, &capture, &sample, &profile](auto tuple) {
                             const auto&[program, command, pack] = tuple;
                             const auto&[library, wrapper, wrapper_dir] = pack;
 
@@ -50,13 +73,56 @@ namespace {
                                     .add_argument(cmd::intercept::FLAG_LIBRARY).add_argument(library)
                                     .add_argument(cmd::intercept::FLAG_WRAPPER).add_argument(wrapper)
                                     .add_argument(cmd::intercept::FLAG_WRAPPER_DIR).add_argument(wrapper_dir)
-                                    .add_argument(cmd::intercept::FLAG_OUTPUT).add_argument(output);
+                                    .add_argument(cmd::intercept::FLAG_OUTPUT).add_argument(output)
+                                    .add_argument(cmd::intercept::FLAG_SERVER_THREADS).add_argument(server_threads);
                             if (force_wrapper) {
                                 builder.add_argument(cmd::intercept::FLAG_FORCE_WRAPPER);
                             }
                             if (force_preload) {
                                 builder.add_argument(cmd::intercept::FLAG_FORCE_PRELOAD);
                             }
+                            if (force_seccomp) {
+                                builder.add_argument(cmd::intercept::FLAG_FORCE_SECCOMP);
+                            }
+                            if (force_ebpf) {
+                                builder.add_argument(cmd::intercept::FLAG_FORCE_EBPF);
+                            }
+                            if (force_es) {
+                                builder.add_argument(cmd::intercept::FLAG_FORCE_ES);
+                            }
+                            if (output_json) {
+                                builder.add_argument(cmd::intercept::FLAG_OUTPUT_JSON);
+                            }
+                            if (output_zstd) {
+                                builder.add_argument(cmd::intercept::FLAG_OUTPUT_ZSTD);
+                            }
+                            if (output_index) {
+                                builder.add_argument(cmd::intercept::FLAG_OUTPUT_INDEX);
+                            }
+                            if (output_sync != cmd::intercept::SYNC_NONE) {
+                                builder.add_argument(cmd::intercept::FLAG_OUTPUT_SYNC).add_argument(output_sync);
+                            }
+                            if (resume) {
+                                builder.add_argument(cmd::intercept::FLAG_RESUME);
+                            }
+                            if (affinity.is_ok()) {
+                                builder.add_argument(cmd::intercept::FLAG_AFFINITY).add_argument(affinity.unwrap());
+                            }
+                            if (filter.is_ok()) {
+                                builder.add_argument(cmd::intercept::FLAG_FILTER).add_argument(filter.unwrap());
+                            }
+                            if (discard.is_ok()) {
+                                builder.add_argument(cmd::intercept::FLAG_DISCARD).add_argument(discard.unwrap());
+                            }
+                            if (capture.is_ok()) {
+                                builder.add_argument(cmd::intercept::FLAG_CAPTURE).add_argument(capture.unwrap());
+                            }
+                            if (sample != "1") {
+                                builder.add_argument(cmd::intercept::FLAG_SAMPLE).add_argument(sample);
+                            }
+                            if (profile) {
+                                builder.add_argument(cmd::bear::FLAG_PROFILE);
+                            }
                             if (verbose) {
                                 builder.add_argument(flags::VERBOSE);
                             }
@@ -72,33 +138,91 @@ namespace {
         auto output = arguments.as_string(cmd::citnames::FLAG_OUTPUT);
         auto config = arguments.as_string(cmd::citnames::FLAG_CONFIG);
         auto append = arguments.as_bool(cmd::citnames::FLAG_APPEND).unwrap_or(false);
+        auto huge_pages = arguments.as_bool(cmd::citnames::FLAG_HUGE_PAGES).unwrap_or(false);
+        auto command_format = arguments.as_string(cmd::citnames::FLAG_COMMAND_FORMAT);
+        auto drop_output = arguments.as_bool(cmd::citnames::FLAG_DROP_OUTPUT).unwrap_or(false);
+        auto profile = arguments.as_bool(cmd::bear::FLAG_PROFILE).unwrap_or(false);
         auto verbose = arguments.as_bool(flags::VERBOSE).unwrap_or(false);
 
         return rust::merge(program, output)
-                .map<sys::Process::Builder>([&environment, &input, &config, &append, &verbose](auto tuple) {
+                .map<sys::Process::Builder>([&environment, &input, &config, &append, &huge_pages, &command_format, &drop_output, &profile, &verbose](auto tuple) {
                     const auto&[program, output] = tuple;
 
                     auto builder = sys::Process::Builder(program)
                             .set_environment(environment)
                             .add_argument(program)
                             .add_argument("citnames")
-                            .add_argument(cmd::citnames::FLAG_INPUT).add_argument(input)
                             .add_argument(cmd::citnames::FLAG_OUTPUT).add_argument(output)
                             // can run the file checks, because we are on the host.
                             .add_argument(cmd::citnames::FLAG_RUN_CHECKS);
                     if (append) {
                         builder.add_argument(cmd::citnames::FLAG_APPEND);
                     }
+                    if (huge_pages) {
+                        builder.add_argument(cmd::citnames::FLAG_HUGE_PAGES);
+                    }
+                    if (command_format.is_ok()) {
+                        builder.add_argument(cmd::citnames::FLAG_COMMAND_FORMAT).add_argument(command_format.unwrap());
+                    }
+                    if (drop_output) {
+                        builder.add_argument(cmd::citnames::FLAG_DROP_OUTPUT);
+                    }
+                    if (profile) {
+                        builder.add_argument(cmd::bear::FLAG_PROFILE);
+                    }
                     if (config.is_ok()) {
                         builder.add_argument(cmd::citnames::FLAG_CONFIG).add_argument(config.unwrap());
                     }
                     if (verbose) {
                         builder.add_argument(flags::VERBOSE);
                     }
+                    // the input flag takes every remaining argument, so it
+                    // goes last.
+                    builder.add_argument(cmd::citnames::FLAG_INPUT).add_argument(input);
                     return builder;
                 });
     }
 
+    // The intermediate events file never survives a combined run, so it
+    // does not have to live next to the output file. Pick a private
+    // directory on a tmpfs backed location for it when one is available:
+    // the FIFO of the streaming mode can then be created even when the
+    // output directory sits on a filesystem without FIFO support, and
+    // the sequential fallback stops pushing the whole events database
+    // through the build tree's disk. Returns nothing when no candidate
+    // fits; the intermediate then stays next to the output, as before.
+    std::optional<fs::path> intermediate_directory(const sys::env::Vars &environment) {
+        // Demand this much free space from the candidate, so a small (or
+        // nearly full) runtime directory is not starved by the events of
+        // a large build; beyond that the page cache eviction of the
+        // tmpfs (the swap) takes the place of a disk spill.
+        constexpr uintmax_t MINIMUM_FREE_BYTES = uintmax_t(1024) * 1024 * 1024;
+
+        const auto runtime_dir = environment.find("XDG_RUNTIME_DIR");
+        const fs::path candidates[] = {
+                (runtime_dir != environment.end()) ? fs::path(runtime_dir->second) : fs::path(),
+                fs::path("/dev/shm"),
+        };
+        std::error_code error_code;
+        for (const auto &candidate : candidates) {
+            if (candidate.empty() || !fs::is_directory(candidate, error_code)) {
+                continue;
+            }
+            const auto space = fs::space(candidate, error_code);
+            if (error_code || (space.available < MINIMUM_FREE_BYTES)) {
+                continue;
+            }
+            // Only a directory this process created is used; an already
+            // existing one (a leftover, or a foreign plant in the world
+            // writable /dev/shm) is not trusted.
+            auto directory = candidate / fmt::format("bear-{}", getpid());
+            if (fs::create_directory(directory, error_code) && !error_code) {
+                return directory;
+            }
+        }
+        return std::nullopt;
+    }
+
     rust::Result<int> execute(sys::Process::Builder builder, const std::string_view &name) {
         return builder.spawn()
                 .and_then<sys::ExitStatus>([](auto child) {
@@ -116,26 +240,112 @@ namespace {
                     spdlog::debug("Running {} finished. [Exited with {}]", name, status);
                 });
     }
+
+    // Run the two processes in parallel: the intercept process writes the
+    // events into a FIFO, which the citnames process consumes as they
+    // happen. The semantic analysis overlaps the build this way.
+    rust::Result<int> execute_streaming(const sys::Process::Builder &intercept, const sys::Process::Builder &citnames) {
+        auto intercept_child = intercept.spawn();
+        auto citnames_child = citnames.spawn();
+
+        auto result = intercept_child
+                .and_then<sys::ExitStatus>([](auto child) {
+                    sys::SignalForwarder guard(child);
+                    return child.wait();
+                })
+                .map<int>([](auto status) {
+                    return status.code().value_or(EXIT_FAILURE);
+                })
+                .map_err<std::runtime_error>([](auto error) {
+                    spdlog::warn("Running intercept failed: {}", error.what());
+                    return error;
+                })
+                .on_success([](auto status) {
+                    spdlog::debug("Running intercept finished. [Exited with {}]", status);
+                });
+
+        citnames_child
+                .and_then<sys::ExitStatus>([](auto child) {
+                    return child.wait();
+                })
+                .map<int>([](auto status) {
+                    return status.code().value_or(EXIT_FAILURE);
+                })
+                .on_success([](auto status) {
+                    spdlog::debug("Running citnames finished. [Exited with {}]", status);
+                })
+                .on_error([](auto error) {
+                    spdlog::warn("Running citnames failed: {}", error.what());
+                });
+
+        return result;
+    }
 }
 
 namespace bear {
 
-	Command::Command(const sys::Process::Builder& intercept, const sys::Process::Builder& citnames, fs::path output) noexcept
+	Command::Command(const sys::Process::Builder& intercept, const sys::Process::Builder& citnames, fs::path output, std::optional<fs::path> temporary, bool profile, bool skip_on_failure) noexcept
 			: ps::Command()
 			, intercept_(intercept)
 			, citnames_(citnames)
 			, output_(std::move(output))
+			, temporary_(std::move(temporary))
+			, profile_(profile)
+			, skip_on_failure_(skip_on_failure)
 	{ }
 
 	[[nodiscard]] rust::Result<int> Command::execute() const
 	{
+		std::error_code error_code;
+		// Connect the two processes through a FIFO, so the citnames process
+		// consumes the events while the build runs. Falls back to the
+		// sequential execution when the FIFO can not be created. (The
+		// skip policy needs the events as a regular file, so it forces
+		// the sequential path.)
+		if (!skip_on_failure_ && (::mkfifo(output_.c_str(), 0600) == 0)) {
+			const auto started = std::chrono::steady_clock::now();
+			auto result = ::execute_streaming(intercept_, citnames_);
+			if (profile_) {
+				// the two phases overlap here; their inner breakdowns
+				// are printed by the subcommand processes.
+				spdlog::info("profile: build and semantic analysis (overlapped) took {} ms.",
+				             std::chrono::duration_cast<std::chrono::milliseconds>(
+				                     std::chrono::steady_clock::now() - started).count());
+			}
+			fs::remove(output_, error_code);
+			if (temporary_.has_value()) {
+				fs::remove_all(temporary_.value(), error_code);
+			}
+			return result;
+		}
+
+		const auto started = std::chrono::steady_clock::now();
 		auto result = ::execute(intercept_, "intercept");
+		const auto intercepted = std::chrono::steady_clock::now();
 
-		std::error_code error_code;
+		const bool failed = (result.unwrap_or(EXIT_FAILURE) != EXIT_SUCCESS);
+		if (skip_on_failure_ && failed) {
+			// a retried build will not consult this output anyway; the
+			// events stay for a later `bear citnames` invocation.
+			spdlog::warn("Build failed; semantic analysis skipped. The events are kept at {}.", output_.string());
+			return result;
+		}
 		if (fs::exists(output_, error_code)) {
 			::execute(citnames_, "citnames");
 			fs::remove(output_, error_code);
 		}
+		if (temporary_.has_value()) {
+			// the sidecars of the subcommands (the run summary, the
+			// shard files of an interrupted run) live next to the
+			// intermediate; drop them with the directory.
+			fs::remove_all(temporary_.value(), error_code);
+		}
+		if (profile_) {
+			spdlog::info("profile: build and event collection took {} ms, semantic analysis took {} ms.",
+			             std::chrono::duration_cast<std::chrono::milliseconds>(intercepted - started).count(),
+			             std::chrono::duration_cast<std::chrono::milliseconds>(
+			                     std::chrono::steady_clock::now() - intercepted).count());
+		}
 		return result;
 	}
 
@@ -147,28 +357,137 @@ namespace bear {
         {
                 const flags::Parser intercept_parser("intercept", cmd::VERSION, {
                         {cmd::intercept::FLAG_OUTPUT,        {1,  false, "path of the result file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::intercept::FLAG_OUTPUT_JSON,   {0,  false, "write events as JSON, for debugging", std::nullopt,                DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_ZSTD,   {0,  false, "compress the output with zstd",  std::nullopt,                     std::nullopt}},
+                        {cmd::intercept::FLAG_OUTPUT_INDEX,  {0,  false, "write an index file next to the output", std::nullopt,             std::nullopt}},
+                        {cmd::intercept::FLAG_OUTPUT_SYNC,   {1,  false, "events file sync policy: none, group or strict", {cmd::intercept::SYNC_NONE}, std::nullopt}},
+                        {cmd::intercept::FLAG_RESUME,        {0,  false, "append to the events of an interrupted run", std::nullopt,                 std::nullopt}},
+                        {cmd::intercept::FLAG_SERVER_THREADS,{1,  false, "number of event collector threads", {"0"},                            ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_AFFINITY,      {1,  false, "cpu list the collector threads are pinned to", std::nullopt,          ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_FILTER,        {1,  false, "only report executables with these basenames (colon separated)", std::nullopt, ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_DISCARD,       {1,  false, "drop events of executables with these basenames (colon separated)", std::nullopt, ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_CAPTURE,       {1,  false, "event capture profile: full or minimal", {"full"},                 ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_SAMPLE,        {1,  false, "report one in this many executions, chosen on the pid", {"1"},    ADVANCED_GROUP}},
                         {cmd::intercept::FLAG_FORCE_PRELOAD, {0,  false, "force to use library preload",   std::nullopt,                     DEVELOPER_GROUP}},
                         {cmd::intercept::FLAG_FORCE_WRAPPER, {0,  false, "force to use compiler wrappers", std::nullopt,                     DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_FORCE_SECCOMP, {0,  false, "force to use seccomp interception", std::nullopt,                  DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_FORCE_EBPF,    {0,  false, "force to use eBPF interception", std::nullopt,                     DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_FORCE_ES,      {0,  false, "force to use EndpointSecurity interception", std::nullopt,         DEVELOPER_GROUP}},
                         {cmd::intercept::FLAG_LIBRARY,       {1,  false, "path to the preload library",    {cmd::library::DEFAULT_PATH},     DEVELOPER_GROUP}},
                         {cmd::intercept::FLAG_WRAPPER,       {1,  false, "path to the wrapper executable", {cmd::wrapper::DEFAULT_PATH},     DEVELOPER_GROUP}},
                         {cmd::intercept::FLAG_WRAPPER_DIR,   {1,  false, "path to the wrapper directory",  {cmd::wrapper::DEFAULT_DIR_PATH}, DEVELOPER_GROUP}},
-                        {cmd::intercept::FLAG_COMMAND,       {-1, true,  "command to execute",             std::nullopt,                     std::nullopt}}
+                        {cmd::intercept::FLAG_DAEMON,        {0,  false, "run the collector until terminated, without a build command", std::nullopt, ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_LISTEN,        {1,  false, "listen on this address (or vsock:cid:port URI) for remote build workers", std::nullopt, ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_METRICS,       {1,  false, "publish the collector counters on this host:port address for a monitoring scrape", std::nullopt, ADVANCED_GROUP}},
+                        {cmd::bear::FLAG_PROFILE,            {0,  false, "print a timing breakdown of the run phases at exit", std::nullopt,  ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_COMMAND,       {-1, false, "command to execute",             std::nullopt,                     std::nullopt}}
+                });
+
+                const flags::Parser merge_parser("merge", cmd::VERSION, {
+                        {cmd::merge::FLAG_OUTPUT,            {1,  false, "path of the result file",        {cmd::merge::DEFAULT_OUTPUT},     std::nullopt}},
+                        {cmd::intercept::FLAG_OUTPUT_JSON,   {0,  false, "write events as JSON, for debugging", std::nullopt,                DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_ZSTD,   {0,  false, "compress the output with zstd",  std::nullopt,                     std::nullopt}},
+                        {cmd::merge::FLAG_MAX_MEMORY,        {1,  false, "memory budget of the duplicate detection in megabytes", {"0"},    std::nullopt}},
+                        {cmd::merge::FLAG_INPUT,             {-1, true,  "events databases to merge",      std::nullopt,                     std::nullopt}}
+                });
+
+                const flags::Parser trace_parser("trace", cmd::VERSION, {
+                        {cmd::trace::FLAG_INPUT,             {1,  false, "path of the events file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::trace::FLAG_OUTPUT,            {1,  false, "path of the result file",        {cmd::trace::DEFAULT_OUTPUT},     std::nullopt}}
+                });
+
+                const flags::Parser stats_parser("stats", cmd::VERSION, {
+                        {cmd::stats::FLAG_INPUT,             {1,  false, "path of the events file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}}
+                });
+
+                const flags::Parser compact_parser("compact", cmd::VERSION, {
+                        {cmd::compact::FLAG_INPUT,           {1,  false, "path of the events file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::compact::FLAG_OUTPUT,          {1,  true,  "path of the compacted events file", std::nullopt,                  std::nullopt}},
+                        {cmd::compact::FLAG_FILTER,          {1,  true,  "keep only executables with these basenames (colon separated)", std::nullopt, std::nullopt}},
+                        {cmd::compact::FLAG_COLLAPSE,        {0,  false, "fold single child shell wrappers into their child process", std::nullopt,   ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_JSON,   {0,  false, "write events as JSON, for debugging", std::nullopt,                DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_ZSTD,   {0,  false, "compress the output with zstd",  std::nullopt,                     std::nullopt}}
+                });
+
+                const flags::Parser critical_path_parser("critical-path", cmd::VERSION, {
+                        {cmd::critical_path::FLAG_INPUT,     {1,  false, "path of the events file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}}
+                });
+
+                const flags::Parser events_parser("events", cmd::VERSION, {
+                        {cmd::events::FLAG_INPUT,            {1,  false, "path of the events file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::events::FLAG_SINCE,            {1,  false, "print events at or after this time (RFC 3339 or microseconds)", std::nullopt, std::nullopt}},
+                        {cmd::events::FLAG_UNTIL,            {1,  false, "print events at or before this time (RFC 3339 or microseconds)", std::nullopt, std::nullopt}},
+                        {cmd::events::FLAG_PID,              {1,  false, "print events of this pid or pid range (first-last)", std::nullopt, std::nullopt}}
+                });
+
+                const flags::Parser replay_parser("replay", cmd::VERSION, {
+                        {cmd::replay::FLAG_OUTPUT,            {1,  false, "path of the result file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::replay::FLAG_EXECUTIONS,        {1,  false, "number of synthetic process executions", {"100000"},              std::nullopt}},
+                        {cmd::replay::FLAG_RATE,              {1,  false, "target executions per second, 0 is unthrottled", {"0"},           std::nullopt}},
+                        {cmd::replay::FLAG_THREADS,           {1,  false, "number of producer threads, 0 uses all cores", {"0"},             std::nullopt}},
+                        {cmd::replay::FLAG_ARGUMENT_BYTES,    {1,  false, "extra argument bytes per execution", {"256"},                     std::nullopt}},
+                        {cmd::replay::FLAG_ENVIRONMENT_BYTES, {1,  false, "environment bytes per execution", {"2048"},                       std::nullopt}},
+                        {cmd::intercept::FLAG_OUTPUT_JSON,    {0,  false, "write events as JSON, for debugging", std::nullopt,               DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_ZSTD,    {0,  false, "compress the output with zstd",  std::nullopt,                    std::nullopt}},
+                        {cmd::intercept::FLAG_OUTPUT_INDEX,   {0,  false, "write an index sidecar next to the output", std::nullopt,         std::nullopt}},
+                        {cmd::intercept::FLAG_OUTPUT_SYNC,    {1,  false, "events file sync policy: none, group or strict", {cmd::intercept::SYNC_NONE}, std::nullopt}}
+                });
+
+                const flags::Parser doctor_parser("doctor", cmd::VERSION, {
+                        {cmd::doctor::FLAG_EXECUTIONS,       {1,  false, "number of compiler executions in the probe workload", {"50"},   std::nullopt}},
+                        {cmd::bear::FLAG_BEAR,               {1,  false, "path to the bear executable",    {cmd::bear::DEFAULT_PATH},        DEVELOPER_GROUP}}
+                });
+
+                const flags::Parser verify_parser("verify", cmd::VERSION, {
+                        {cmd::verify::FLAG_INPUT,            {1,  false, "path of the events file",        {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::verify::FLAG_OUTPUT,           {1,  false, "path of the compilation database to check", {cmd::citnames::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::verify::FLAG_CONFIG,           {1,  false, "path of the config file",        std::nullopt,                     std::nullopt}}
+                });
+
+                const flags::Parser serve_parser("serve", cmd::VERSION, {
+                        {cmd::serve::FLAG_INPUT,             {1,  false, "path of the compilation database to serve", {cmd::citnames::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::serve::FLAG_SOCKET,            {1,  true,  "path of the unix socket to answer queries on", std::nullopt,                 std::nullopt}}
                 });
 
                 const flags::Parser citnames_parser("citnames", cmd::VERSION, {
-                        {cmd::citnames::FLAG_INPUT,      {1, false, "path of the input file",                    {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
+                        {cmd::citnames::FLAG_INPUT,      {-1, false, "events databases to analyze (consumes the rest of the arguments)", {cmd::intercept::DEFAULT_OUTPUT}, std::nullopt}},
                         {cmd::citnames::FLAG_OUTPUT,     {1, false, "path of the result file",                   {cmd::citnames::DEFAULT_OUTPUT},  std::nullopt}},
                         {cmd::citnames::FLAG_CONFIG,     {1, false, "path of the config file",                   std::nullopt,                     std::nullopt}},
                         {cmd::citnames::FLAG_APPEND,     {0, false, "append to output, instead of overwrite it", std::nullopt,                     std::nullopt}},
-                        {cmd::citnames::FLAG_RUN_CHECKS, {0, false, "can run checks on the current host",        std::nullopt,                     std::nullopt}}
+                        {cmd::citnames::FLAG_RUN_CHECKS, {0, false, "can run checks on the current host",        std::nullopt,                     std::nullopt}},
+                        {cmd::citnames::FLAG_MAX_MEMORY, {1, false, "memory budget of the entries in megabytes", {"0"},                            std::nullopt}},
+                        {cmd::citnames::FLAG_METRICS,    {1, false, "write per tool recognition metrics into the file", std::nullopt,                 std::nullopt}},
+                        {cmd::citnames::FLAG_COMMAND_FORMAT, {1, false, "emit the command as: arguments or command",  std::nullopt,                     std::nullopt}},
+                        {cmd::citnames::FLAG_DROP_OUTPUT, {0, false, "omit the output field from the entries",        std::nullopt,                     std::nullopt}},
+                        {cmd::citnames::FLAG_HUGE_PAGES, {0, false, "back the large buffers with transparent huge pages", std::nullopt,               ADVANCED_GROUP}},
+                        {cmd::bear::FLAG_PROFILE,        {0, false, "print a timing breakdown of the run phases at exit", std::nullopt,               ADVANCED_GROUP}}
                 });
 
-		const flags::Parser parser("bear", cmd::VERSION, {intercept_parser, citnames_parser}, {
+		const flags::Parser parser("bear", cmd::VERSION, {intercept_parser, citnames_parser, merge_parser, trace_parser, stats_parser, compact_parser, critical_path_parser, events_parser, replay_parser, doctor_parser, verify_parser, serve_parser}, {
                         {cmd::citnames::FLAG_OUTPUT,         {1,  false, "path of the result file",                  {cmd::citnames::DEFAULT_OUTPUT},  std::nullopt}},
                         {cmd::citnames::FLAG_APPEND,         {0,  false, "append result to an existing output file", std::nullopt,                     ADVANCED_GROUP}},
                         {cmd::citnames::FLAG_CONFIG,         {1,  false, "path of the config file",                  std::nullopt,                     ADVANCED_GROUP}},
+                        {cmd::citnames::FLAG_COMMAND_FORMAT, {1,  false, "emit the command as: arguments or command", std::nullopt,                    ADVANCED_GROUP}},
+                        {cmd::citnames::FLAG_DROP_OUTPUT,    {0,  false, "omit the output field from the entries",   std::nullopt,                     ADVANCED_GROUP}},
+                        {cmd::citnames::FLAG_HUGE_PAGES,     {0,  false, "back the large buffers with transparent huge pages", std::nullopt,           ADVANCED_GROUP}},
+                        {cmd::bear::FLAG_PROFILE,            {0,  false, "print a timing breakdown of the run phases at exit", std::nullopt,           ADVANCED_GROUP}},
+                        {cmd::bear::FLAG_SKIP_ON_FAILURE,    {0,  false, "skip the semantic analysis when the build fails, keeping the events file", std::nullopt, ADVANCED_GROUP}},
                         {cmd::intercept::FLAG_FORCE_PRELOAD, {0,  false, "force to use library preload",             std::nullopt,                     ADVANCED_GROUP}},
                         {cmd::intercept::FLAG_FORCE_WRAPPER, {0,  false, "force to use compiler wrappers",           std::nullopt,                     ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_FORCE_SECCOMP, {0,  false, "force to use seccomp interception",        std::nullopt,                     ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_FORCE_EBPF,    {0,  false, "force to use eBPF interception",           std::nullopt,                     ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_FORCE_ES,      {0,  false, "force to use EndpointSecurity interception", std::nullopt,                   ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_JSON,   {0,  false, "write events as JSON, for debugging",      std::nullopt,                     DEVELOPER_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_ZSTD,   {0,  false, "compress the intermediate events with zstd", std::nullopt,                   ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_INDEX,  {0,  false, "index the intermediate events file",       std::nullopt,                     ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_OUTPUT_SYNC,   {1,  false, "events file sync policy: none, group or strict", {cmd::intercept::SYNC_NONE}, ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_RESUME,        {0,  false, "append to the events of an interrupted run", std::nullopt,                 ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_SERVER_THREADS,{1,  false, "number of event collector threads",        {"0"},                            ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_AFFINITY,      {1,  false, "cpu list the collector threads are pinned to", std::nullopt,                 ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_FILTER,        {1,  false, "only report executables with these basenames (colon separated)", std::nullopt, ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_DISCARD,       {1,  false, "drop events of executables with these basenames (colon separated)", std::nullopt, ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_CAPTURE,       {1,  false, "event capture profile: full or minimal",   {"full"},                         ADVANCED_GROUP}},
+                        {cmd::intercept::FLAG_SAMPLE,        {1,  false, "report one in this many executions, chosen on the pid", {"1"},              ADVANCED_GROUP}},
                         {cmd::bear::FLAG_BEAR,               {1,  false, "path to the bear executable",              {cmd::bear::DEFAULT_PATH},        DEVELOPER_GROUP}},
                         {cmd::intercept::FLAG_LIBRARY,       {1,  false, "path to the preload library",              {cmd::library::DEFAULT_PATH},     DEVELOPER_GROUP}},
                         {cmd::intercept::FLAG_WRAPPER,       {1,  false, "path to the wrapper executable",           {cmd::wrapper::DEFAULT_PATH},     DEVELOPER_GROUP}},
@@ -188,11 +507,42 @@ namespace bear {
                         if (auto intercept = ic::Intercept(log_config_); intercept.matches(args)) {
                             return intercept.subcommand(args, envp);
                         }
+                        if (auto merge = ic::Merge(log_config_); merge.matches(args)) {
+                            return merge.subcommand(args, envp);
+                        }
+                        if (auto trace = ic::Trace(log_config_); trace.matches(args)) {
+                            return trace.subcommand(args, envp);
+                        }
+                        if (auto stats = ic::Stats(log_config_); stats.matches(args)) {
+                            return stats.subcommand(args, envp);
+                        }
+                        if (auto compact = ic::Compact(log_config_); compact.matches(args)) {
+                            return compact.subcommand(args, envp);
+                        }
+                        if (auto critical_path = ic::CriticalPath(log_config_); critical_path.matches(args)) {
+                            return critical_path.subcommand(args, envp);
+                        }
+                        if (auto events = ic::Events(log_config_); events.matches(args)) {
+                            return events.subcommand(args, envp);
+                        }
+                        if (auto replay = ic::Replay(log_config_); replay.matches(args)) {
+                            return replay.subcommand(args, envp);
+                        }
+                        if (auto doctor = ic::Doctor(log_config_); doctor.matches(args)) {
+                            return doctor.subcommand(args, envp);
+                        }
+                        if (auto verify = cs::Verify(log_config_); verify.matches(args)) {
+                            return verify.subcommand(args, envp);
+                        }
+                        if (auto serve = cs::Serve(log_config_); serve.matches(args)) {
+                            return serve.subcommand(args, envp);
+                        }
                         return rust::Err(std::runtime_error("Invalid subcommand"));
                 }
-                // If there were no subcommand, then just execute the two one after the other.
-                // TODO: execute the two process parallel like the intercept output is the citnames input.
-                //       `bear intercept -o - | bear citnames -i - -o compile_commands.json`
+                // If there were no subcommand, then execute the two in parallel,
+                // connected through a FIFO. Like the shell pipeline
+                // `bear intercept -o - | bear citnames -i - -o compile_commands.json`
+                // would do. (Or one after the other, when the FIFO can not be created.)
                 auto commands = args.as_string(cmd::citnames::FLAG_OUTPUT)
                                     .map<fs::path>([](const auto& output) {
                                         return fs::path(output).replace_extension(".events.json");
@@ -200,14 +550,28 @@ namespace bear {
                                     .unwrap_or(fs::path(cmd::citnames::DEFAULT_OUTPUT));
 
                 auto environment = sys::env::from(const_cast<const char**>(envp));
+                // A resumed run picks up the shard files the interrupted one
+                // left behind, so its intermediate shall stay at the stable
+                // place. The same holds when a failed build shall leave the
+                // events behind for a later citnames invocation. Everything
+                // else goes to a tmpfs backed directory when one is available.
+                const auto skip_on_failure = args.as_bool(cmd::bear::FLAG_SKIP_ON_FAILURE).unwrap_or(false);
+                std::optional<fs::path> temporary = std::nullopt;
+                if (!args.as_bool(cmd::intercept::FLAG_RESUME).unwrap_or(false) && !skip_on_failure) {
+                    temporary = intermediate_directory(environment);
+                }
+                if (temporary.has_value()) {
+                    commands = temporary.value() / commands.filename();
+                }
                 auto intercept = prepare_intercept(args, environment, commands);
                 auto citnames = prepare_citnames(args, environment, commands);
 
+                const auto profile = args.as_bool(cmd::bear::FLAG_PROFILE).unwrap_or(false);
                 return rust::merge(intercept, citnames)
-                    .map<ps::CommandPtr>([&commands](const auto& tuple) {
+                    .map<ps::CommandPtr>([&commands, &temporary, &profile, &skip_on_failure](const auto& tuple) {
                         const auto& [intercept, citnames] = tuple;
 
-                        return std::make_unique<Command>(intercept, citnames, commands);
+                        return std::make_unique<Command>(intercept, citnames, commands, temporary, profile, skip_on_failure);
                     });
         }
 }
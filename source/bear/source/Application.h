@@ -39,7 +39,7 @@ namespace bear {
 
     struct Command : ps::Command {
     public:
-        Command(const sys::Process::Builder& intercept, const sys::Process::Builder& citnames, fs::path output) noexcept;
+        Command(const sys::Process::Builder& intercept, const sys::Process::Builder& citnames, fs::path output, std::optional<fs::path> temporary, bool profile, bool skip_on_failure) noexcept;
 
         [[nodiscard]] rust::Result<int> execute() const override;
 
@@ -50,6 +50,19 @@ namespace bear {
         sys::Process::Builder intercept_;
         sys::Process::Builder citnames_;
         fs::path output_;
+        // The private tmpfs backed directory which holds the intermediate
+        // events file, when one could be created. Removed after the run,
+        // together with the sidecar files the subcommands left in it.
+        std::optional<fs::path> temporary_;
+        // Print how long the phases of the run took. The subcommands
+        // report their internal phases themselves; this level sees the
+        // wall time of the processes.
+        bool profile_;
+        // Do not run the semantic analysis after a failed build; the
+        // events file is kept for a later `bear citnames` invocation.
+        // The phases run sequentially then (no FIFO), so the events of
+        // the failed build exist as a regular file.
+        bool skip_on_failure_;
     };
 
     struct Application : ps::ApplicationFromArgs {
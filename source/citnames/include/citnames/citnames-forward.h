@@ -31,4 +31,20 @@ namespace cs {
 
         NON_DEFAULT_CONSTRUCTABLE(Citnames)
     };
+
+    struct Verify : ps::SubcommandFromArgs {
+        Verify(const ps::ApplicationLogConfig&) noexcept;
+
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Verify)
+    };
+
+    struct Serve : ps::SubcommandFromArgs {
+        Serve(const ps::ApplicationLogConfig&) noexcept;
+
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Serve)
+    };
 }
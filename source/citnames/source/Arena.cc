@@ -0,0 +1,174 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Arena.h"
+
+#include <spdlog/spdlog.h>
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+    // The size of a transparent huge page on the architectures we care
+    // about; mappings below it gain nothing from the advice.
+    constexpr size_t HUGE_PAGE_SIZE = 2u * 1024u * 1024u;
+    // The first heap allocation of an arena; doubles from there.
+    constexpr size_t INITIAL_CAPACITY = 16u * 1024u;
+
+    std::atomic<bool> huge_pages_enabled(false);
+
+    // The allocation counters of the run, aggregated over every arena.
+    std::atomic<uint64_t> reserved_bytes(0);
+    std::atomic<uint64_t> advised_bytes(0);
+    std::atomic<uint64_t> advice_refused(0);
+    std::atomic<uint64_t> map_fallbacks(0);
+
+    size_t round_up(const size_t value, const size_t step) {
+        return ((value + step - 1) / step) * step;
+    }
+
+    // Maps an anonymous region and asks for huge page backing. Returns
+    // nullptr when the mapping failed; the caller falls back to the heap.
+    char *map_region(const size_t capacity) {
+        void *region = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            map_fallbacks.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+#ifdef MADV_HUGEPAGE
+        if (::madvise(region, capacity, MADV_HUGEPAGE) == 0) {
+            advised_bytes.fetch_add(capacity, std::memory_order_relaxed);
+        } else {
+            advice_refused.fetch_add(1, std::memory_order_relaxed);
+        }
+#else
+        advice_refused.fetch_add(1, std::memory_order_relaxed);
+#endif
+        return static_cast<char *>(region);
+    }
+}
+
+namespace cs {
+
+    Arena::Arena() noexcept
+            : data_(nullptr)
+            , size_(0)
+            , capacity_(0)
+            , mapped_(false)
+    { }
+
+    Arena::~Arena() noexcept {
+        release();
+    }
+
+    Arena::Arena(Arena &&other) noexcept
+            : data_(other.data_)
+            , size_(other.size_)
+            , capacity_(other.capacity_)
+            , mapped_(other.mapped_)
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+        other.mapped_ = false;
+    }
+
+    Arena &Arena::operator=(Arena &&other) noexcept {
+        if (this != &other) {
+            release();
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            mapped_ = other.mapped_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+            other.capacity_ = 0;
+            other.mapped_ = false;
+        }
+        return *this;
+    }
+
+    size_t Arena::append(const std::string_view value) {
+        if (size_ + value.size() > capacity_) {
+            grow(size_ + value.size());
+        }
+        const size_t offset = size_;
+        std::memcpy(data_ + offset, value.data(), value.size());
+        size_ += value.size();
+        return offset;
+    }
+
+    void Arena::grow(const size_t required) {
+        size_t capacity = (capacity_ > 0) ? (capacity_ * 2) : INITIAL_CAPACITY;
+        while (capacity < required) {
+            capacity *= 2;
+        }
+        char *data = nullptr;
+        bool mapped = false;
+        // Small buffers stay on the heap; the advice only pays off once
+        // the arena spans whole huge pages.
+        if (huge_pages_enabled.load(std::memory_order_relaxed) && (capacity >= HUGE_PAGE_SIZE)) {
+            capacity = round_up(capacity, HUGE_PAGE_SIZE);
+            data = map_region(capacity);
+            mapped = (data != nullptr);
+        }
+        if (data == nullptr) {
+            data = static_cast<char *>(std::malloc(capacity));
+            if (data == nullptr) {
+                throw std::bad_alloc();
+            }
+        }
+        reserved_bytes.fetch_add(capacity - capacity_, std::memory_order_relaxed);
+        if (size_ > 0) {
+            std::memcpy(data, data_, size_);
+        }
+        release();
+        data_ = data;
+        capacity_ = capacity;
+        mapped_ = mapped;
+    }
+
+    void Arena::release() noexcept {
+        if (data_ != nullptr) {
+            if (mapped_) {
+                ::munmap(data_, capacity_);
+            } else {
+                std::free(data_);
+            }
+            data_ = nullptr;
+        }
+    }
+
+    void Arena::use_huge_pages(const bool enabled) noexcept {
+        huge_pages_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void Arena::report() {
+        spdlog::debug("arena use: reserved {} MB, {} MB advised for huge pages, advice refused {} times, mmap fallbacks {}.",
+                      reserved_bytes.load() >> 20u,
+                      advised_bytes.load() >> 20u,
+                      advice_refused.load(),
+                      map_fallbacks.load());
+    }
+}
@@ -0,0 +1,71 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace cs {
+
+    // A growable contiguous byte buffer for the columnar batch stores.
+    //
+    // The batches of a large build hold gigabytes of path and argument
+    // bytes, which the scans then visit through spans in effectively
+    // random order. On 4 KB pages the TLB misses dominate such a walk,
+    // so the arena can back its memory with anonymous mappings advised
+    // to use transparent huge pages (MADV_HUGEPAGE). The advice is best
+    // effort: a kernel without THP, a failing mmap, or a platform
+    // without the advice silently falls back to the plain heap.
+    //
+    // Growth may move the bytes, like a vector's; the offsets returned
+    // by append stay valid, pointers into the buffer do not.
+    class Arena {
+    public:
+        Arena() noexcept;
+        ~Arena() noexcept;
+
+        // Appends the bytes and returns the offset they start at.
+        size_t append(std::string_view value);
+
+        [[nodiscard]] const char *data() const noexcept { return data_; }
+        [[nodiscard]] size_t size() const noexcept { return size_; }
+
+        // Whether the arenas created from now on ask for huge page
+        // backing. Off by default; the citnames command turns it on.
+        static void use_huge_pages(bool enabled) noexcept;
+        // Logs the allocation counters of the run: bytes reserved, bytes
+        // advised for huge pages, and how often the advice was refused.
+        static void report();
+
+        Arena(Arena &&other) noexcept;
+        Arena &operator=(Arena &&other) noexcept;
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+    private:
+        void grow(size_t required);
+        void release() noexcept;
+
+        char *data_;
+        size_t size_;
+        size_t capacity_;
+        bool mapped_;
+    };
+}
@@ -18,20 +18,40 @@
  */
 
 #include "config.h"
+#include "Arena.h"
 #include "Citnames.h"
 #include "Configuration.h"
+#include "OrderedEmitter.h"
 #include "Output.h"
+#include "SemanticCache.h"
 #include "semantic/Build.h"
 #include "semantic/Tool.h"
 #include "collect/db/EventsDatabaseReader.h"
 #include "libsys/Path.h"
 
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #ifdef HAVE_FMT_STD_H
 #include <fmt/std.h>
 #endif
 #include <fmt/ostream.h>
+#include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
 namespace fs = std::filesystem;
@@ -46,8 +66,9 @@ namespace {
     std::list<fs::path> to_abspath(const std::list<fs::path> &paths, const fs::path &root) {
         std::list<fs::path> results;
         for (const auto &path : paths) {
-            auto result = path.is_absolute() ? path : root / path;
-            results.emplace_back(result);
+            // normalize too, so the filters compare against the same
+            // spelling the entries carry.
+            results.emplace_back(sys::path::normalize(path, root));
         }
         return results;
     }
@@ -100,31 +121,83 @@ namespace {
         return error_code.value() == 0;
     }
 
+    // Compares the content of two files. Used to leave the output file
+    // (and its mtime) untouched when a build produced no database change:
+    // editors watching the file would re-index everything otherwise.
+    bool same_content(const fs::path &lhs, const fs::path &rhs) {
+        std::error_code error_code;
+        const auto lhs_size = fs::file_size(lhs, error_code);
+        if (error_code) {
+            return false;
+        }
+        const auto rhs_size = fs::file_size(rhs, error_code);
+        if (error_code || lhs_size != rhs_size) {
+            return false;
+        }
+        std::ifstream lhs_stream(lhs, std::ios::binary);
+        std::ifstream rhs_stream(rhs, std::ios::binary);
+        char lhs_buffer[8192];
+        char rhs_buffer[8192];
+        while (lhs_stream && rhs_stream) {
+            lhs_stream.read(lhs_buffer, sizeof(lhs_buffer));
+            rhs_stream.read(rhs_buffer, sizeof(rhs_buffer));
+            if (lhs_stream.gcount() != rhs_stream.gcount()) {
+                return false;
+            }
+            if (!std::equal(lhs_buffer, lhs_buffer + lhs_stream.gcount(), rhs_buffer)) {
+                return false;
+            }
+        }
+        return lhs_stream.eof() && rhs_stream.eof();
+    }
+
     rust::Result<cs::Arguments> into_arguments(const flags::Arguments &args) {
-        auto input = args.as_string(cmd::citnames::FLAG_INPUT);
+        auto input = args.as_string_list(cmd::citnames::FLAG_INPUT);
         auto output = args.as_string(cmd::citnames::FLAG_OUTPUT);
         auto append = args.as_bool(cmd::citnames::FLAG_APPEND)
                 .unwrap_or(false);
+        // the budget is given in megabytes; zero (the default) is no limit.
+        const size_t max_memory = args.as_string(cmd::citnames::FLAG_MAX_MEMORY)
+                .map<size_t>([](auto value) { return size_t(strtoul(value.data(), nullptr, 10)); })
+                .unwrap_or(0)
+                * 1024u * 1024u;
+        const auto metrics = args.as_string(cmd::citnames::FLAG_METRICS)
+                .map<std::optional<fs::path>>([](auto value) { return std::make_optional(fs::path(value)); })
+                .unwrap_or(std::nullopt);
+        const auto profile = args.as_bool(cmd::bear::FLAG_PROFILE)
+                .unwrap_or(false);
 
         return rust::merge(input, output)
-                .map<cs::Arguments>([&append](auto tuple) {
+                .map<cs::Arguments>([&append, &max_memory, &metrics, &profile](auto tuple) {
                     const auto&[input, output] = tuple;
+                    std::vector<fs::path> inputs;
+                    for (const auto &file : input) {
+                        inputs.emplace_back(file);
+                    }
                     return cs::Arguments{
-                            fs::path(input),
+                            std::move(inputs),
                             fs::path(output),
                             append,
+                            max_memory,
+                            metrics,
+                            profile,
                     };
                 })
                 .and_then<cs::Arguments>([](auto arguments) -> rust::Result<cs::Arguments> {
-                    // validate
-                    if (!is_exists(arguments.input)) {
-                        return rust::Err(std::runtime_error(
-                                fmt::format("Missing input file: {}", arguments.input)));
+                    // validate ("-" stands for the standard input)
+                    for (const auto &input : arguments.inputs) {
+                        if ((input != "-") && !is_exists(input)) {
+                            return rust::Err(std::runtime_error(
+                                    fmt::format("Missing input file: {}", input)));
+                        }
                     }
                     return rust::Ok(cs::Arguments{
-                            arguments.input,
+                            arguments.inputs,
                             arguments.output,
                             (arguments.append && is_exists(arguments.output)),
+                            arguments.max_memory,
+                            arguments.metrics,
+                            arguments.profile,
                     });
                 });
     }
@@ -145,15 +218,11 @@ namespace {
 
     rust::Result<cs::Configuration>
     into_configuration(const flags::Arguments &args, const sys::env::Vars &environment) {
-        auto config_arg = args.as_string(cmd::citnames::FLAG_CONFIG);
-        auto config = config_arg.is_ok()
-                      ? config_arg
-                              .and_then<cs::Configuration>([](auto candidate) {
-                                  return cs::ConfigurationSerializer().from_json(fs::path(candidate));
-                              })
-                      : rust::Ok(cs::Configuration());
+        const auto config_file = args.as_string(cmd::citnames::FLAG_CONFIG)
+                .map<std::optional<fs::path>>([](auto candidate) { return std::make_optional(fs::path(candidate)); })
+                .unwrap_or(std::nullopt);
 
-        return config
+        return cs::load_configuration(config_file, environment)
                 .map<cs::Configuration>([&args](auto config) {
                     // command line arguments overrides the default values or the configuration content.
                     const auto run_checks = args
@@ -161,13 +230,15 @@ namespace {
                             .unwrap_or(config.output.content.include_only_existing_source);
                     // update the content filter parameters according to the run_check outcome.
                     config.output.content = update_content(config.output.content, run_checks);
-                    return config;
-                })
-                .map<cs::Configuration>([&environment](auto config) {
-                    // recognize compilers from known environment variables.
-                    const auto env_compilers = compilers(environment);
-                    config.compilation.compilers_to_recognize =
-                            update_compilers_to_recognize(config.compilation.compilers_to_recognize, env_compilers);
+                    // field emission control: a command line value wins over
+                    // the configuration file.
+                    if (const auto format = args.as_string(cmd::citnames::FLAG_COMMAND_FORMAT); format.is_ok()) {
+                        config.output.format.command_as_array =
+                                (format.unwrap() != cmd::citnames::COMMAND_FORMAT_STRING);
+                    }
+                    if (args.as_bool(cmd::citnames::FLAG_DROP_OUTPUT).unwrap_or(false)) {
+                        config.output.format.drop_output_field = true;
+                    }
                     return config;
                 })
                 .on_success([](const auto &config) {
@@ -175,56 +246,542 @@ namespace {
                 });
     }
 
-    size_t transform(cs::semantic::Build &build, const db::EventsDatabaseReader::Ptr& events, std::list<cs::Entry> &output) {
-        for (const auto &event : *events) {
-            const auto entries = build.recognize(event)
-                    .map<std::list<cs::Entry>>([](const auto &semantic) -> std::list<cs::Entry> {
-                        const auto candidate = dynamic_cast<const cs::semantic::CompilerCall *>(semantic.get());
-                        return (candidate != nullptr) ? candidate->into_entries() : std::list<cs::Entry>();
-                    })
-                    .unwrap_or({});
-            std::copy(entries.begin(), entries.end(), std::back_inserter(output));
+    // Reports the memory use of the run: the estimated peak of the entry
+    // list, and the peak RSS of the process. It is audible only when a
+    // budget was given - that caller wants to see how close the run got.
+    void report_memory_use(size_t peak_entries, size_t budget) {
+        struct rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+        // ru_maxrss is reported in kilobytes on Linux.
+        const size_t peak_rss = size_t(usage.ru_maxrss) * 1024u;
+        if (budget > 0) {
+            spdlog::info("memory use: entries peaked at {} MB (budget {} MB), process RSS peaked at {} MB",
+                         peak_entries >> 20u, budget >> 20u, peak_rss >> 20u);
+        } else {
+            spdlog::debug("memory use: entries peaked at {} MB, process RSS peaked at {} MB",
+                          peak_entries >> 20u, peak_rss >> 20u);
+        }
+    }
+
+    cs::Recognition recognize(const cs::semantic::Build &build, rpc::Event &&event) {
+        return build.recognize(std::move(event))
+                .map<cs::Recognition>([](const auto &semantic) -> cs::Recognition {
+                    if (const auto link = dynamic_cast<const cs::semantic::Link *>(semantic.get()); link != nullptr) {
+                        return cs::Recognition { {}, link->into_entries() };
+                    }
+                    if (const auto compiler = dynamic_cast<const cs::semantic::CompilerCall *>(semantic.get()); compiler != nullptr) {
+                        return cs::Recognition { compiler->into_entries(), {} };
+                    }
+                    return cs::Recognition {};
+                })
+                .unwrap_or(cs::Recognition {});
+    }
+
+    // The semantic cache key of an event: the hash of the command fields
+    // which determine the recognition result. Events which are not command
+    // executions have no key, those bypass the cache.
+    std::optional<uint64_t> recognition_key(const rpc::Event &event) {
+        if (!event.has_started()) {
+            return std::nullopt;
+        }
+        const auto &execution = event.started().execution();
+        cs::Digest digest;
+        digest.feed(execution.executable());
+        for (const auto &argument : execution.arguments()) {
+            digest.feed(argument);
+        }
+        digest.feed(execution.working_dir());
+        // the environment influences the result too: the preprocessor
+        // variables become emitted arguments (ToolGcc), and the wrapper
+        // tools resolve the real compiler through PATH (ToolWrapper).
+        // only the consulted variables are fed, so an incidental
+        // difference (say, MAKELEVEL) does not break the sharing.
+        const auto &environment = execution.environment();
+        for (const char *name : {
+                "CPATH", "C_INCLUDE_PATH", "CPLUS_INCLUDE_PATH",
+                "OBJC_INCLUDE_PATH", "PATH"}) {
+            if (const auto it = environment.find(name); it != environment.end()) {
+                digest.feed(name);
+                digest.feed(it->second);
+            }
+        }
+        return std::make_optional(digest.state);
+    }
+
+    // The digest of the configuration parts which influence the semantic
+    // recognition. A configuration change invalidates the cached results.
+    uint64_t configuration_digest(const cs::Configuration &configuration) {
+        std::ostringstream buffer;
+        buffer << configuration.compilation;
+        cs::Digest digest;
+        digest.feed(buffer.str());
+        return digest.state;
+    }
+
+    // Merges the per worker tool metrics into the accumulated list; tools
+    // are matched by name, new tools keep their dispatch order.
+    void merge_metrics(std::list<cs::semantic::ToolMetrics> &into, std::list<cs::semantic::ToolMetrics> &&from) {
+        for (auto &entry : from) {
+            const auto it = std::find_if(into.begin(), into.end(),
+                                         [&entry](const auto &candidate) { return candidate.tool == entry.tool; });
+            if (it == into.end()) {
+                into.push_back(std::move(entry));
+            } else {
+                it->offered += entry.offered;
+                it->matched += entry.matched;
+                it->spent += entry.spent;
+            }
+        }
+    }
+
+    void write_metrics(const fs::path &file, const std::list<cs::semantic::ToolMetrics> &metrics) {
+        nlohmann::json payload = nlohmann::json::array();
+        for (const auto &entry : metrics) {
+            payload.push_back(nlohmann::json{
+                    {"tool",     entry.tool},
+                    {"offered",  entry.offered},
+                    {"matched",  entry.matched},
+                    {"spent_us", std::chrono::duration_cast<std::chrono::microseconds>(entry.spent).count()},
+            });
+        }
+        std::ofstream target(file);
+        target << std::setw(2) << payload << std::endl;
+    }
+
+    // Bounds the events waiting for recognition, so the reader does not
+    // balloon the memory usage when it is faster than the workers.
+    constexpr size_t RECOGNITION_QUEUE_LIMIT = 4 * 1024;
+
+    // The state of a previous run against the same events database. When
+    // the database only grew since (the digest of the old prefix still
+    // matches), the append mode skips the recognition of the events it
+    // already turned into entries.
+    struct RecognitionState {
+        size_t events;      // number of events processed by the previous run
+        size_t size;        // size of the events database at that time
+        uint64_t checksum;  // digest of the events database at that time
+    };
+
+    fs::path state_file(const fs::path &output) {
+        return fs::path(output.string() + ".state");
+    }
+
+    // The link commands database is written next to the output file.
+    fs::path link_file(const fs::path &output) {
+        return output.parent_path() / "link_commands.json";
+    }
+
+    // The delta of the database generations is written next to the
+    // output file. (compile_commands.json -> compile_commands.delta.json)
+    fs::path delta_file(const fs::path &output) {
+        fs::path result(output);
+        result.replace_extension(".delta.json");
+        return result;
+    }
+
+    std::optional<RecognitionState> read_state(const fs::path &file) {
+        std::ifstream source(file);
+        RecognitionState result = {};
+        if (source >> result.events >> result.size >> result.checksum) {
+            return std::make_optional(result);
         }
-        return output.size();
+        return std::nullopt;
+    }
+
+    void write_state(const fs::path &file, const RecognitionState &state) {
+        std::ofstream target(file);
+        target << state.events << ' ' << state.size << ' ' << state.checksum << std::endl;
+    }
+
+    // Number of events the previous run has processed, when its state is
+    // still valid for this input. Zero means everything shall be processed.
+    size_t events_to_skip(const db::EventsDatabaseReader::Ptr &events, const fs::path &output) {
+        if (const auto state = read_state(state_file(output)); state.has_value()) {
+            const auto digest = events->prefix_digest(state->size);
+            if (digest.has_value() && (digest.value() == state->checksum)) {
+                return state->events;
+            }
+        }
+        return 0;
+    }
+
+    // Run the semantic recognition on a pool of worker threads.
+    //
+    // The recognition of each event is independent, so this thread streams
+    // the events from the database, the workers recognize them in parallel,
+    // and the results are stitched back together in event order. The output
+    // is identical to what the sequential run produces.
+    //
+    // The entries leave through the sinks in event order, as soon as every
+    // earlier event is recognized - so the caller can bound the memory they
+    // occupy, instead of receiving them all at once at the end. Compiler
+    // call entries go to the sink, linker call entries to the link sink.
+    // The same pool carries both kinds of work: recognition, and the sink
+    // side of the emission. No thread is dedicated to either, so a link
+    // heavy stretch (all recognition) and a unity build stretch (heavy
+    // entries behind single events) both keep every core busy.
+    //
+    // The first skip events are read but not recognized: a previous run has
+    // already turned them into entries. The seen counter reports how many
+    // events the database held in total.
+    // The per tool recognition metrics of the run land in the metrics list
+    // (the workers merge their counters into it when they finish).
+    size_t transform(const cs::Configuration &configuration, const std::vector<db::EventsDatabaseReader::Ptr> &inputs,
+                     cs::SemanticCache &cache,
+                     const std::function<void(std::list<cs::Entry> &&)> &sink,
+                     const std::function<void(std::list<cs::Entry> &&)> &link_sink,
+                     std::list<cs::semantic::ToolMetrics> &metrics,
+                     const size_t skip, size_t &seen) {
+        const size_t cores = std::thread::hardware_concurrency();
+        const size_t worker_count = (cores > 1) ? cores : 1;
+
+        std::mutex queue_mutex;
+        std::condition_variable ready;
+        std::condition_variable space;
+        std::deque<std::pair<size_t, db::EventPtr>> queue;
+        bool done = false;
+
+        std::mutex metrics_mutex;
+        size_t count = 0;
+        // The results leave in event order, through whichever worker
+        // closes the gap; the sinks (view filtering, spill
+        // serialization) run outside the emitter lock, so the
+        // recognition of the other workers never queues up behind them.
+        // Only the draining worker touches the count.
+        cs::OrderedEmitter<cs::Recognition> emitter(skip);
+
+        std::vector<std::thread> workers;
+        workers.reserve(worker_count);
+        for (size_t index = 0; index < worker_count; ++index) {
+            workers.emplace_back([&]() {
+                const cs::semantic::Build build(configuration.compilation);
+                for (;;) {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    ready.wait(lock, [&queue, &done]() { return done || !queue.empty(); });
+                    if (queue.empty()) {
+                        break;
+                    }
+                    auto [position, event] = std::move(queue.front());
+                    queue.pop_front();
+                    lock.unlock();
+                    space.notify_one();
+
+                    // consult the cache before running the tool matchers.
+                    const auto key = recognition_key(*event);
+                    auto cached = key.has_value()
+                            ? cache.lookup(key.value())
+                            : std::optional<cs::Recognition>();
+                    auto entries = cached.has_value()
+                            ? std::move(cached.value())
+                            : recognize(build, std::move(*event));
+                    if (key.has_value() && !cached.has_value()) {
+                        cache.remember(key.value(), entries);
+                    }
+                    // an empty result is recorded too: it tells that
+                    // every event before the next one is complete.
+                    emitter.emit(position, std::move(entries),
+                            [&count, &sink, &link_sink](auto, cs::Recognition &&result) {
+                                count += result.compilations.size();
+                                if (!result.compilations.empty()) {
+                                    sink(std::move(result.compilations));
+                                }
+                                if (!result.links.empty()) {
+                                    link_sink(std::move(result.links));
+                                }
+                            });
+                }
+                {
+                    const std::lock_guard<std::mutex> guard(metrics_mutex);
+                    merge_metrics(metrics, build.metrics());
+                }
+            });
+        }
+
+        // stream the events into the queue on this thread. the inputs are
+        // read one after the other, in the order they were given: the
+        // output (and the duplicate detection, which keeps the first
+        // occurrence) stays deterministic this way, while the expensive
+        // part - the recognition - runs on the workers anyway.
+        for (const auto &events : inputs) {
+            for (auto event = events->next(); event.has_value(); event = events->next()) {
+                if (event->is_err()) {
+                    spdlog::warn("Reading events failed: {}", event->unwrap_err().what());
+                    break;
+                }
+                const size_t position = seen++;
+                if (position < skip) {
+                    // a previous run has processed this event already.
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                space.wait(lock, [&queue]() { return queue.size() < RECOGNITION_QUEUE_LIMIT; });
+                queue.emplace_back(position, event->unwrap());
+                lock.unlock();
+                ready.notify_one();
+            }
+        }
+        {
+            const std::lock_guard<std::mutex> guard(queue_mutex);
+            done = true;
+        }
+        ready.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        return count;
     }
 }
 
 namespace cs {
 
+    rust::Result<Configuration> load_configuration(
+            const std::optional<fs::path> &config_file,
+            const sys::env::Vars &environment) {
+        auto config = config_file.has_value()
+                ? ConfigurationSerializer().from_json(config_file.value())
+                : rust::Result<Configuration>(rust::Ok(Configuration()));
+
+        return config
+                .map<Configuration>([&environment](auto config) {
+                    // recognize compilers from known environment variables.
+                    const auto env_compilers = compilers(environment);
+                    config.compilation.compilers_to_recognize =
+                            update_compilers_to_recognize(config.compilation.compilers_to_recognize, env_compilers);
+                    return config;
+                });
+    }
+
     rust::Result<int> Command::execute() const {
+        const auto started = std::chrono::steady_clock::now();
+        auto recognized = started;
         cs::CompilationDatabase output(configuration_.output.format, configuration_.output.content);
-        std::list<cs::Entry> entries;
+        cs::EntrySpool entries(arguments_.max_memory, fs::path(arguments_.output.string() + ".spill"), configuration_.output.content);
+        cs::CompilationDatabase::Entries link_entries;
+        // the additional output views; they filter the entries while the
+        // recognition pass streams them through.
+        std::list<cs::FilteredView> views;
+        for (const auto &view : configuration_.output.views) {
+            views.emplace_back(configuration_.output.format, view);
+        }
+        bool appended = false;
+        cs::SemanticCache cache(
+                fs::path(arguments_.output.string() + ".cache"),
+                configuration_digest(configuration_));
+        cache.load();
+        // the digests of the previous generation; captured before any
+        // write, so the delta output can diff against them. (the index
+        // sidecar answers this without parsing the database.)
+        std::vector<std::pair<uint64_t, uint64_t>> previous_digests;
+        if (configuration_.output.format.write_delta && is_exists(arguments_.output)) {
+            previous_digests = output.digests_of(arguments_.output)
+                    .unwrap_or(std::vector<std::pair<uint64_t, uint64_t>>());
+        }
 
-        // get current compilations from the input.
-        return db::EventsDatabaseReader::from(arguments_.input)
-                .map<size_t>([this, &entries](const auto &commands) {
-                    cs::semantic::Build build(configuration_.compilation);
-                    return transform(build, commands, entries);
+        // open every input before the processing starts; a missing file
+        // fails the run before any output is touched.
+        std::vector<db::EventsDatabaseReader::Ptr> readers;
+        readers.reserve(arguments_.inputs.size());
+        for (const auto &input : arguments_.inputs) {
+            auto reader = db::EventsDatabaseReader::from(input);
+            if (reader.is_err()) {
+                return rust::Err(reader.unwrap_err());
+            }
+            readers.emplace_back(reader.unwrap());
+        }
+
+        // get current compilations from the inputs.
+        return rust::Result<std::vector<db::EventsDatabaseReader::Ptr>>(rust::Ok(std::move(readers)))
+                .map<size_t>([this, &entries, &link_entries, &views, &cache, &recognized](const auto &commands) {
+                    // skip the events a previous append run has processed.
+                    // (the resume state counts the events of one file; it
+                    // does not apply to a multi input run.)
+                    const size_t skip = (arguments_.append && (commands.size() == 1))
+                            ? events_to_skip(commands.front(), arguments_.output)
+                            : 0;
+                    if (skip > 0) {
+                        spdlog::debug("events processed by a previous run. [size: {}]", skip);
+                    }
+                    size_t seen = 0;
+                    std::list<cs::semantic::ToolMetrics> tool_metrics;
+                    const auto count = transform(
+                            configuration_, commands, cache,
+                            [&entries, &views](auto batch) {
+                                for (auto &view : views) {
+                                    view.push(batch);
+                                }
+                                entries.push(std::move(batch));
+                            },
+                            [&link_entries](auto batch) { link_entries.splice(link_entries.end(), batch); },
+                            tool_metrics,
+                            skip, seen);
+                    recognized = std::chrono::steady_clock::now();
+                    spdlog::debug("semantic cache answered {} of {} events.", cache.hits(), seen - skip);
+                    for (const auto &entry : tool_metrics) {
+                        spdlog::debug("tool {}: offered {}, matched {}, spent {} ms.",
+                                      entry.tool, entry.offered, entry.matched,
+                                      std::chrono::duration_cast<std::chrono::milliseconds>(entry.spent).count());
+                    }
+                    if (arguments_.metrics.has_value()) {
+                        write_metrics(arguments_.metrics.value(), tool_metrics);
+                    }
+                    // remember the work done, so a later append run can resume.
+                    if (arguments_.append && (commands.size() == 1)) {
+                        if (const auto size = commands.front()->mapped_size(); size.has_value()) {
+                            const auto digest = commands.front()->prefix_digest(size.value());
+                            write_state(
+                                    state_file(arguments_.output),
+                                    RecognitionState { seen, size.value(), digest.value_or(0) });
+                        }
+                    }
+                    return count;
                 })
-                .and_then<size_t>([this, &output, &entries](auto new_entries_count) {
+                .and_then<size_t>([this, &output, &entries, &appended](auto new_entries_count) {
                     spdlog::debug("compilation entries created. [size: {}]", new_entries_count);
+                    // extend the existing database via the append index, when
+                    // it can answer the duplicate checks; this avoids parsing
+                    // the old content entirely.
+                    if (arguments_.append && !entries.spilled() && is_exists(arguments_.output)) {
+                        auto fast = output.to_json_append(arguments_.output, entries.entries());
+                        if (fast.is_ok()) {
+                            appended = true;
+                            return fast;
+                        }
+                        spdlog::debug("append index not usable, falling back to merge. [cause: {}]",
+                                      fast.unwrap_err().what());
+                    }
                     // read back the current content and extend with the new elements.
-                    return (arguments_.append)
-                        ? output.from_json(arguments_.output, entries)
+                    // (when entries were spilled, the read back is part of the
+                    // streamed write instead, to keep the memory bounded.)
+                    return (arguments_.append && !entries.spilled())
+                        ? output.from_json(arguments_.output, entries.entries())
                                 .template map<size_t>([&new_entries_count](auto old_entries_count) {
                                     spdlog::debug("compilation entries have read. [size: {}]", old_entries_count);
                                     return new_entries_count + old_entries_count;
                                 })
                         : rust::Result<size_t>(rust::Ok(new_entries_count));
                 })
-                .and_then<size_t>([this, &output, &entries](const size_t & size) {
+                .and_then<size_t>([this, &output, &entries, &appended, &previous_digests](const size_t & size) {
                     // write the entries into the output file.
+                    if (appended) {
+                        spdlog::debug("compilation entries appended to output. [size: {}]", size);
+                        // an append removes nothing, so the delta needs no
+                        // previous file; the new keys are in the sidecar.
+                        if (configuration_.output.format.write_delta) {
+                            auto delta = output.to_json_delta(
+                                    delta_file(arguments_.output), arguments_.output,
+                                    std::nullopt, previous_digests);
+                            if (delta.is_err()) {
+                                return delta;
+                            }
+                            spdlog::debug("delta entries written. [size: {}]", delta.unwrap_or(0));
+                        }
+                        return rust::Result<size_t>(rust::Ok(size));
+                    }
                     spdlog::debug("compilation entries to output. [size: {}]", size);
 
                     const fs::path temporary_file(arguments_.output.string() + ".tmp");
-                    auto result = output.to_json(temporary_file, entries);
+                    auto result = entries.spilled()
+                            ? output.to_json(temporary_file, entries,
+                                             (arguments_.append)
+                                                     ? std::make_optional(arguments_.output)
+                                                     : std::nullopt)
+                            : output.to_json(temporary_file, entries.entries());
+                    // the delta of the generations, while both are still on
+                    // disk: the old database provides the removed entries.
+                    if (configuration_.output.format.write_delta && result.is_ok()) {
+                        auto delta = output.to_json_delta(
+                                delta_file(arguments_.output), temporary_file,
+                                is_exists(arguments_.output)
+                                        ? std::make_optional(arguments_.output)
+                                        : std::nullopt,
+                                previous_digests);
+                        if (delta.is_err()) {
+                            return delta;
+                        }
+                        spdlog::debug("delta entries written. [size: {}]", delta.unwrap_or(0));
+                    }
+                    // the append index sidecar moves together with the database
+                    // file. (the fresh index stays valid for the unchanged file
+                    // too: the content is the same.)
+                    rename_file(
+                            fs::path(temporary_file.string() + ".index"),
+                            fs::path(arguments_.output.string() + ".index"));
+                    // ... and so does the compressed artifact, when one
+                    // was requested.
+                    rename_file(
+                            fs::path(temporary_file.string() + ".zst"),
+                            fs::path(arguments_.output.string() + ".zst"));
+                    if (result.is_ok() && is_exists(arguments_.output) && same_content(temporary_file, arguments_.output)) {
+                        spdlog::debug("compilation entries are unchanged, keeping the output file.");
+                        std::error_code error_code;
+                        fs::remove(temporary_file, error_code);
+                        return result;
+                    }
                     return rename_file(temporary_file, arguments_.output)
                         ? result
                         : rust::Err(std::runtime_error(fmt::format("Failed to rename file: {}", arguments_.output)));
                 })
-                .map<int>([](auto size) {
+                .and_then<size_t>([this, &output](const size_t &size) -> rust::Result<size_t> {
+                    // write the per-directory shards of the database, when asked.
+                    if (!configuration_.output.format.shard_by_directory) {
+                        return rust::Ok(size);
+                    }
+                    return output.to_json_shards(arguments_.output)
+                            .map<size_t>([&size](auto sharded) {
+                                spdlog::debug("compilation entries sharded. [size: {}]", sharded);
+                                return size;
+                            });
+                })
+                .and_then<size_t>([this, &output, &link_entries](const size_t &size) -> rust::Result<size_t> {
+                    // write the link commands into a database next to the output
+                    // file. the file is only created when a link command was seen
+                    // (most users run no LTO analysis and need no extra file).
+                    const fs::path link_output = link_file(arguments_.output);
+                    if (link_entries.empty() && !is_exists(link_output)) {
+                        return rust::Ok(size);
+                    }
+                    if (arguments_.append && is_exists(link_output)) {
+                        if (auto fast = output.to_json_append(link_output, link_entries); fast.is_ok()) {
+                            spdlog::debug("link entries appended to output. [size: {}]", fast.unwrap_or(0));
+                            return rust::Ok(size);
+                        }
+                        if (auto read = output.from_json(link_output, link_entries); read.is_err()) {
+                            return rust::Err(read.unwrap_err());
+                        }
+                    }
+                    spdlog::debug("link entries to output. [size: {}]", link_entries.size());
+                    return output.to_json(link_output, link_entries)
+                            .map<size_t>([&size](auto) { return size; });
+                })
+                .and_then<size_t>([&views](const size_t &size) -> rust::Result<size_t> {
+                    // write the additional filtered views of the database.
+                    for (const auto &view : views) {
+                        auto result = view.write();
+                        if (result.is_err()) {
+                            return rust::Err(result.unwrap_err());
+                        }
+                        spdlog::debug("view entries written. [view: {}, size: {}]",
+                                      view.name(), result.unwrap_or(0));
+                    }
+                    return rust::Ok(size);
+                })
+                .map<int>([this, &entries, &cache, &started, &recognized](auto size) {
                     // just map to success exit code if it was successful.
                     spdlog::debug("compilation entries written. [size: {}]", size);
+                    cache.store();
+                    report_memory_use(entries.peak(), arguments_.max_memory);
+                    Arena::report();
+                    if (arguments_.profile) {
+                        struct rusage usage = {};
+                        getrusage(RUSAGE_SELF, &usage);
+                        const auto cpu_ms = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+                                + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+                        spdlog::info("profile: event read and recognition took {} ms, filter and write took {} ms, cpu {} ms.",
+                                     std::chrono::duration_cast<std::chrono::milliseconds>(recognized - started).count(),
+                                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             std::chrono::steady_clock::now() - recognized).count(),
+                                     cpu_ms);
+                    }
                     return EXIT_SUCCESS;
                 });
     }
@@ -242,6 +799,12 @@ namespace cs {
     rust::Result<ps::CommandPtr> Citnames::command(const flags::Arguments &args, const char **envp) const {
         auto environment = sys::env::from(const_cast<const char **>(envp));
 
+        // the batch arenas of a large build are gigabytes with random
+        // access; huge page backing cuts the TLB misses of the scans.
+        if (args.as_bool(cmd::citnames::FLAG_HUGE_PAGES).unwrap_or(false)) {
+            Arena::use_huge_pages(true);
+        }
+
         auto arguments = into_arguments(args);
         auto configuration = into_configuration(args, environment);
 
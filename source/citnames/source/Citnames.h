@@ -26,7 +26,9 @@
 #include "libsys/Environment.h"
 
 #include <filesystem>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include "citnames/citnames-forward.h"
 
@@ -35,11 +37,29 @@ namespace fs = std::filesystem;
 namespace cs {
 
     struct Arguments {
-        fs::path input;
+        // The events databases to analyze, in the order they were given.
+        // A sharded CI build produces several; they feed one recognition
+        // pipeline, without an intermediate merged file.
+        std::vector<fs::path> inputs;
         fs::path output;
         bool append;
+        // Memory budget of the entries in bytes; zero means no limit.
+        size_t max_memory;
+        // File to write the per tool recognition metrics into.
+        std::optional<fs::path> metrics;
+        // Print how long the phases of the run took at exit.
+        bool profile;
     };
 
+    // Loads the recognition configuration: the content of the config file
+    // when one was given (the defaults otherwise), extended with the
+    // compilers the usual environment variables (CC, CXX, FC) name. The
+    // subcommands which run the semantic recognition derive their
+    // configuration from this.
+    [[nodiscard]] rust::Result<Configuration> load_configuration(
+            const std::optional<fs::path> &config_file,
+            const sys::env::Vars &environment);
+
     struct Command : ps::Command {
         Command(Arguments arguments, cs::Configuration configuration) noexcept;
 
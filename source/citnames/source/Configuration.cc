@@ -30,12 +30,32 @@ namespace cs {
     void from_json(const nlohmann::json &j, Format &rhs) {
         j.at("command_as_array").get_to(rhs.command_as_array);
         j.at("drop_output_field").get_to(rhs.drop_output_field);
+        if (j.contains("shard_by_directory")) {
+            j.at("shard_by_directory").get_to(rhs.shard_by_directory);
+        }
+        if (j.contains("sort_entries")) {
+            j.at("sort_entries").get_to(rhs.sort_entries);
+        }
+        if (j.contains("write_delta")) {
+            j.at("write_delta").get_to(rhs.write_delta);
+        }
+        if (j.contains("compress_output")) {
+            j.at("compress_output").get_to(rhs.compress_output);
+        }
+        if (j.contains("relative_to_directory")) {
+            j.at("relative_to_directory").get_to(rhs.relative_to_directory);
+        }
     }
 
     void to_json(nlohmann::json &j, const Format &rhs) {
         j = nlohmann::json{
                 {"command_as_array",  rhs.command_as_array},
                 {"drop_output_field", rhs.drop_output_field},
+                {"shard_by_directory", rhs.shard_by_directory},
+                {"sort_entries", rhs.sort_entries},
+                {"write_delta", rhs.write_delta},
+                {"compress_output", rhs.compress_output},
+                {"relative_to_directory", rhs.relative_to_directory},
         };
     }
 
@@ -66,9 +86,32 @@ namespace cs {
         }
     }
 
+    void from_json(const nlohmann::json &j, OutputView &rhs) {
+        j.at("file").get_to(rhs.file);
+        if (j.contains("name")) {
+            j.at("name").get_to(rhs.name);
+        } else {
+            rhs.name = rhs.file.string();
+        }
+        if (j.contains("content")) {
+            j.at("content").get_to(rhs.content);
+        }
+    }
+
+    void to_json(nlohmann::json &j, const OutputView &rhs) {
+        j = nlohmann::json{
+                {"name",    rhs.name},
+                {"file",    rhs.file},
+                {"content", rhs.content},
+        };
+    }
+
     void from_json(const nlohmann::json &j, Output &rhs) {
         j.at("format").get_to(rhs.format);
         j.at("content").get_to(rhs.content);
+        if (j.contains("views")) {
+            j.at("views").get_to(rhs.views);
+        }
     }
 
     void to_json(nlohmann::json &j, const Output &rhs) {
@@ -76,6 +119,9 @@ namespace cs {
                 {"format",  rhs.format},
                 {"content", rhs.content},
         };
+        if (!rhs.views.empty()) {
+            j["views"] = rhs.views;
+        }
     }
 
     void from_json(const nlohmann::json &j, CompilerWrapper &rhs) {
@@ -101,6 +147,18 @@ namespace cs {
         }
     }
 
+    void from_json(const nlohmann::json &j, PathMapping &rhs) {
+        j.at("from").get_to(rhs.from);
+        j.at("to").get_to(rhs.to);
+    }
+
+    void to_json(nlohmann::json &j, const PathMapping &rhs) {
+        j = nlohmann::json{
+                {"from", rhs.from},
+                {"to",   rhs.to},
+        };
+    }
+
     void from_json(const nlohmann::json &j, Compilation &rhs) {
         if (j.contains("compilers_to_recognize")) {
             j.at("compilers_to_recognize").get_to(rhs.compilers_to_recognize);
@@ -108,6 +166,9 @@ namespace cs {
         if (j.contains("compilers_to_exclude")) {
             j.at("compilers_to_exclude").get_to(rhs.compilers_to_exclude);
         }
+        if (j.contains("path_mappings")) {
+            j.at("path_mappings").get_to(rhs.path_mappings);
+        }
     }
 
     void to_json(nlohmann::json &j, const Compilation &rhs) {
@@ -117,6 +178,9 @@ namespace cs {
         if (!rhs.compilers_to_exclude.empty()) {
             j["compilers_to_exclude"] = rhs.compilers_to_exclude;
         }
+        if (!rhs.path_mappings.empty()) {
+            j["path_mappings"] = rhs.path_mappings;
+        }
     }
 
     void from_json(const nlohmann::json &j, Configuration &rhs) {
@@ -153,6 +217,15 @@ namespace cs {
         return os;
     }
 
+    std::ostream &operator<<(std::ostream &os, const OutputView &value)
+    {
+        nlohmann::json payload;
+        to_json(payload, value);
+        os << payload;
+
+        return os;
+    }
+
     std::ostream &operator<<(std::ostream &os, const Output &value)
     {
         nlohmann::json payload;
@@ -171,6 +244,15 @@ namespace cs {
         return os;
     }
 
+    std::ostream &operator<<(std::ostream &os, const PathMapping &value)
+    {
+        nlohmann::json payload;
+        to_json(payload, value);
+        os << payload;
+
+        return os;
+    }
+
     std::ostream &operator<<(std::ostream &os, const Compilation &value)
     {
         nlohmann::json payload;
@@ -43,9 +43,26 @@ namespace cs {
     // One format element is how the command is represented: it can be an array
     // of strings or a single string (shell escaping to protect white spaces).
     // Another format element is if the output field is emitted or not.
+    //
+    // The sharding writes an additional compilation database into every
+    // top level directory of the build, holding the entries of that
+    // subtree only. Editors pick up the nearest database, so they only
+    // parse the subtree they open. (Helps on huge monorepo outputs.)
+    //
+    // The sorting orders the entries by file (then by arguments), so two
+    // databases of the same build diff cleanly. It applies only when the
+    // entries fit in memory; a memory bounded run streams them unsorted.
     struct Format {
         bool command_as_array = true;
         bool drop_output_field = false;
+        bool shard_by_directory = false;
+        bool sort_entries = false;
+        bool write_delta = false;
+        bool compress_output = false;
+        // Emit the file (and output) fields relative to the entry
+        // directory, which the specification allows; absolute paths
+        // repeat the project root in every entry.
+        bool relative_to_directory = false;
     };
 
     // Controls the content of the output.
@@ -60,10 +77,24 @@ namespace cs {
         std::list<fs::path> paths_to_exclude = {};
     };
 
+    // An additional, filtered database written in the same run.
+    //
+    // A view names an output file and holds a content filter (and the
+    // duplicate filter fields) of its own. The recognized entries stream
+    // through every view during the single recognition pass, so the
+    // extra databases cost no second run over the events. Append runs
+    // rewrite the view files from the events of the current run only.
+    struct OutputView {
+        std::string name;
+        fs::path file;
+        Content content;
+    };
+
     // Groups together the output related configurations.
     struct Output {
         Format format;
         Content content;
+        std::list<OutputView> views = {};
     };
 
     // Represents a compiler wrapper that the tool will recognize.
@@ -77,10 +108,24 @@ namespace cs {
         std::list<std::string> flags_to_remove;
     };
 
+    // A mount mapping of a containerized build.
+    //
+    // The events of a build running in a container record the container
+    // side paths, which mean nothing to the tools reading the database
+    // on the host. A mapping rewrites the paths under the container side
+    // prefix to the host side mount point during the recognition, so the
+    // written database needs no post processing. The first matching
+    // mapping wins.
+    struct PathMapping {
+        fs::path from;
+        fs::path to;
+    };
+
     // Represents compiler related configuration.
     struct Compilation {
         std::list<CompilerWrapper> compilers_to_recognize;
         std::list<fs::path> compilers_to_exclude;
+        std::list<PathMapping> path_mappings = {};
     };
 
     // Represents the application configuration.
@@ -92,8 +137,10 @@ namespace cs {
     // Convenient methods for these types.
     std::ostream& operator<<(std::ostream&, const Format&);
     std::ostream& operator<<(std::ostream&, const Content&);
+    std::ostream& operator<<(std::ostream&, const OutputView&);
     std::ostream& operator<<(std::ostream&, const Output&);
     std::ostream& operator<<(std::ostream&, const CompilerWrapper&);
+    std::ostream& operator<<(std::ostream&, const PathMapping&);
     std::ostream& operator<<(std::ostream&, const Compilation&);
     std::ostream& operator<<(std::ostream&, const Configuration&);
 
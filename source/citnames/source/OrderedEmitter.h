@@ -0,0 +1,78 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace cs {
+
+    // Restores the position order of results produced out of order on a
+    // pool of worker threads, and feeds them to a consumer as soon as
+    // every earlier position is complete.
+    //
+    // One thread at a time drains the ready results; the role migrates
+    // to whichever thread closes the gap. The consumer runs without the
+    // lock held, so the producers never queue up behind it: a result
+    // landing while the draining thread is out of the lock is picked up
+    // by its next round, and the baton only rests when no ready result
+    // is left.
+    template <typename Result>
+    class OrderedEmitter {
+    public:
+        explicit OrderedEmitter(const size_t first) noexcept
+                : next_(first)
+        { }
+
+        OrderedEmitter(const OrderedEmitter &) = delete;
+        OrderedEmitter &operator=(const OrderedEmitter &) = delete;
+
+        // Records the result of the given position. When no other
+        // thread is emitting, takes the baton and drains every result
+        // which became contiguous, calling the consumer with the
+        // position and the result (outside the lock, in order).
+        template <typename Consumer>
+        void emit(const size_t position, Result &&result, const Consumer &consumer)
+        {
+            std::unique_lock<std::mutex> guard(mutex_);
+            results_.emplace(position, std::move(result));
+            if (emitting_) {
+                return;
+            }
+            emitting_ = true;
+            while (!results_.empty() && (results_.begin()->first == next_)) {
+                auto node = results_.extract(results_.begin());
+                ++next_;
+                guard.unlock();
+                consumer(node.key(), std::move(node.mapped()));
+                guard.lock();
+            }
+            emitting_ = false;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::map<size_t, Result> results_;
+        size_t next_;
+        bool emitting_ = false;
+    };
+}
@@ -17,18 +17,38 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "Arena.h"
 #include "Output.h"
+#include "SemanticCache.h"
+#include "collect/db/ZstdStream.h"
 #include "libshell/Command.h"
 
 #include <algorithm>
-#include <iomanip>
+#include <cstdlib>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
 #include <memory>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <fmt/format.h>
 #include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cs {
+    void from_json(const nlohmann::json &j, Entry &entry);
+}
 
 namespace {
 
@@ -37,49 +57,232 @@ namespace {
         virtual bool apply(const cs::Entry &) = 0;
     };
 
+    // The configured directories, compiled for containment tests.
+    //
+    // The directories used to be matched one by one with a component wise
+    // comparison, which made the test linear in the directory count for
+    // every entry. Normalized so that every component is closed with a
+    // separator, the component prefix test becomes a string prefix test;
+    // and with the nested entries pruned, the only candidate is the
+    // greatest stored prefix not greater than the path. One binary search
+    // decides the containment, whatever the directory count is.
+    class PathPrefixes {
+    public:
+        explicit PathPrefixes(const std::list<fs::path> &directories)
+                : prefixes_()
+        {
+            for (const auto &directory : directories) {
+                prefixes_.emplace_back(normalize(directory));
+            }
+            std::sort(prefixes_.begin(), prefixes_.end());
+            // Drop the entries covered by a shorter one. A candidate
+            // between a kept prefix and a path starting with it would
+            // itself start with that prefix, so the pruned set needs a
+            // single probe per query.
+            std::vector<std::string> kept;
+            for (auto &prefix : prefixes_) {
+                if (kept.empty() || (prefix.compare(0, kept.back().size(), kept.back()) != 0)) {
+                    kept.emplace_back(std::move(prefix));
+                }
+            }
+            prefixes_ = std::move(kept);
+        }
+
+        [[nodiscard]] bool empty() const {
+            return prefixes_.empty();
+        }
+
+        [[nodiscard]] bool does_contain(const fs::path &file) const {
+            const std::string candidate = normalize(file);
+            auto it = std::upper_bound(prefixes_.begin(), prefixes_.end(), candidate);
+            if (it == prefixes_.begin()) {
+                return false;
+            }
+            --it;
+            return candidate.compare(0, it->size(), *it) == 0;
+        }
+
+    private:
+        // The string form which makes the component prefix test a string
+        // prefix test: every component is closed with a separator. (The
+        // empty trailing component of a "dir/" spelling disappears.)
+        static std::string normalize(const fs::path &path) {
+            std::string result;
+            for (const auto &component : path) {
+                if (component == "/") {
+                    result += '/';
+                } else if (!component.empty()) {
+                    result += component.string();
+                    result += '/';
+                }
+            }
+            return result;
+        }
+
+    private:
+        std::vector<std::string> prefixes_;
+    };
+
+    // Columnar store of a batch of entries. The field bytes live in one
+    // arena and the rows are parallel arrays of spans into it, so the
+    // filter and digest scans walk consecutive memory instead of chasing
+    // the heap blocks of entry objects. A row becomes an entry object
+    // only when a consumer demands one.
+    class EntryBatch {
+    public:
+        struct Span {
+            size_t offset;
+            size_t size;
+        };
+
+        // One row of the batch: views into the arena, valid while the
+        // batch lives and does not grow.
+        struct View {
+            std::string_view directory;
+            std::string_view file;
+            std::optional<std::string_view> output;
+
+            [[nodiscard]] size_t argument_count() const noexcept {
+                return size_t(arguments_end - arguments_begin);
+            }
+
+            [[nodiscard]] std::string_view argument(const size_t index) const noexcept {
+                const auto &span = arguments_begin[index];
+                return {arena + span.offset, span.size};
+            }
+
+            const char *arena;
+            const Span *arguments_begin;
+            const Span *arguments_end;
+        };
+
+        EntryBatch() = default;
+
+        // Parses the record (with the same validation and anchoring as
+        // the entry reader) and appends it as a row. The scratch entry
+        // keeps its string capacity, so a long parse settles into no
+        // allocation per record.
+        void push(const nlohmann::json &record) {
+            cs::from_json(record, scratch_);
+            directories_.push_back(intern(scratch_.directory.native()));
+            files_.push_back(intern(scratch_.file.native()));
+            outputs_.push_back(scratch_.output.has_value()
+                    ? intern(scratch_.output.value().native())
+                    : Span {NO_OUTPUT, 0});
+            const size_t arguments_begin = arguments_.size();
+            for (const auto &argument : scratch_.arguments) {
+                arguments_.push_back(intern(argument));
+            }
+            bounds_.emplace_back(arguments_begin, arguments_.size());
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return files_.size();
+        }
+
+        [[nodiscard]] View view(const size_t row) const noexcept {
+            const auto &output = outputs_[row];
+            return View {
+                    resolve(directories_[row]),
+                    resolve(files_[row]),
+                    (output.offset == NO_OUTPUT)
+                            ? std::nullopt
+                            : std::make_optional(resolve(output)),
+                    arena_.data(),
+                    arguments_.data() + bounds_[row].first,
+                    arguments_.data() + bounds_[row].second,
+            };
+        }
+
+        [[nodiscard]] cs::Entry to_entry(const size_t row) const {
+            const auto source = view(row);
+            cs::Entry result;
+            result.file = source.file;
+            result.directory = source.directory;
+            if (source.output.has_value()) {
+                result.output = fs::path(source.output.value());
+            }
+            for (size_t index = 0; index < source.argument_count(); ++index) {
+                result.arguments.emplace_back(source.argument(index));
+            }
+            return result;
+        }
+
+    private:
+        static constexpr size_t NO_OUTPUT = std::numeric_limits<size_t>::max();
+
+        Span intern(const std::string_view value) {
+            return {arena_.append(value), value.size()};
+        }
+
+        [[nodiscard]] std::string_view resolve(const Span &span) const noexcept {
+            return {arena_.data() + span.offset, span.size};
+        }
+
+    private:
+        cs::Arena arena_;
+        std::vector<Span> directories_;
+        std::vector<Span> files_;
+        std::vector<Span> outputs_;
+        std::vector<Span> arguments_;
+        std::vector<std::pair<size_t, size_t>> bounds_;
+        cs::Entry scratch_;
+    };
+
     struct ContentFilter : public Filter {
         explicit ContentFilter(cs::Content config)
                 : config(std::move(config))
+                , include_(this->config.paths_to_include)
+                , exclude_(this->config.paths_to_exclude)
         { }
 
         bool apply(const cs::Entry &entry) override {
-            const auto &file = entry.file;
-            return exists(file) && to_include(file) && !to_exclude(file);
+            return apply(std::string_view(entry.file.native()));
+        }
+
+        // The columnar scan hands the file as a view; the paths the
+        // tests need are built only when a test actually runs.
+        bool apply(const EntryBatch::View &row) {
+            return apply(row.file);
         }
 
     private:
-        [[nodiscard]] inline bool exists(const fs::path &file) const {
+        bool apply(const std::string_view file) {
+            return exists(file) && to_include(file) && !to_exclude(file);
+        }
+
+        [[nodiscard]] inline bool exists(const std::string_view file) {
             const auto &to_check = config.include_only_existing_source;
             return (!to_check) || (to_check && does_exist(file));
         }
 
-        [[nodiscard]] inline bool to_include(const fs::path &file) const {
-            const auto &include = config.paths_to_include;
-            return include.empty() || does_contain(include, file);
+        [[nodiscard]] inline bool to_include(const std::string_view file) const {
+            return include_.empty() || include_.does_contain(fs::path(file));
         }
 
-        [[nodiscard]] inline bool to_exclude(const fs::path &file) const {
-            const auto &exclude = config.paths_to_exclude;
-            return !exclude.empty() && does_contain(exclude, file);
+        [[nodiscard]] inline bool to_exclude(const std::string_view file) const {
+            return !exclude_.empty() && exclude_.does_contain(fs::path(file));
         }
 
-        [[nodiscard]] static bool does_exist(const fs::path &path) {
+        // The same source file shows up in many entries, and on network
+        // file systems every stat call is a round trip. Ask the file
+        // system only once per unique path.
+        [[nodiscard]] bool does_exist(const std::string_view path) {
+            if (const auto it = checked.find(path); it != checked.end()) {
+                return it->second;
+            }
             std::error_code error_code;
-            return fs::exists(path, error_code);
-        }
-
-        [[nodiscard]] static bool does_contain(const std::list<fs::path> &directories, const fs::path &file) {
-            return std::any_of(directories.begin(), directories.end(), [&file](auto directory) {
-                // check if the path elements (list of directory names) are the same.
-                const auto [end, nothing] = std::mismatch(directory.begin(), directory.end(), file.begin());
-                // the file is contained in the directory if all path elements are
-                // in the file paths too.
-                return (end == directory.end()) || (*end == "");
-            });
+            const bool result = fs::exists(fs::path(path), error_code);
+            checked.emplace(path, result);
+            return result;
         }
 
     private:
         const cs::Content config;
+        const PathPrefixes include_;
+        const PathPrefixes exclude_;
+        // transparent comparison, so a view probes without a key copy.
+        std::map<std::string, bool, std::less<>> checked;
     };
 
     // Pure version of the boost::hash_combine function.
@@ -98,8 +301,18 @@ namespace {
             return new_entry;
         }
 
+        // The columnar scan hashes the field views in place. (The view
+        // and the string hashes agree on equal content, the standard
+        // guarantees that.)
+        bool apply(const EntryBatch::View &row) {
+            const auto h2 = hash(row);
+            auto [_, new_entry] = hashes.emplace(h2);
+            return new_entry;
+        }
+
     private:
         virtual size_t hash(const cs::Entry&) const = 0;
+        virtual size_t hash(const EntryBatch::View&) const = 0;
 
         std::unordered_set<size_t> hashes;
     };
@@ -110,7 +323,14 @@ namespace {
             size_t hash(const cs::Entry &entry) const override {
                 auto string_hasher = std::hash<std::string>{};
 
-                return string_hasher(entry.file);
+                // hash the native representation to avoid a path copy.
+                return string_hasher(entry.file.native());
+            }
+
+            size_t hash(const EntryBatch::View &row) const override {
+                auto string_hasher = std::hash<std::string_view>{};
+
+                return string_hasher(row.file);
             }
     };
 
@@ -119,10 +339,22 @@ namespace {
             size_t hash(const cs::Entry &entry) const override {
                 auto string_hasher = std::hash<std::string>{};
 
-                auto hash = string_hasher(entry.file);
+                auto hash = string_hasher(entry.file.native());
 
                 if (entry.output) {
-                    hash = hash_combine(hash, string_hasher(*entry.output));
+                    hash = hash_combine(hash, string_hasher(entry.output->native()));
+                }
+
+                return hash;
+            }
+
+            size_t hash(const EntryBatch::View &row) const override {
+                auto string_hasher = std::hash<std::string_view>{};
+
+                auto hash = string_hasher(row.file);
+
+                if (row.output) {
+                    hash = hash_combine(hash, string_hasher(row.output.value()));
                 }
 
                 return hash;
@@ -134,10 +366,10 @@ namespace {
             size_t hash(const cs::Entry &entry) const override {
                 auto string_hasher = std::hash<std::string>{};
 
-                auto hash = string_hasher(entry.file);
+                auto hash = string_hasher(entry.file.native());
 
                 if (entry.output) {
-                    hash = hash_combine(hash, string_hasher(*entry.output));
+                    hash = hash_combine(hash, string_hasher(entry.output->native()));
                 }
 
                 for (const auto& arg : entry.arguments) {
@@ -146,6 +378,22 @@ namespace {
 
                 return hash;
             }
+
+            size_t hash(const EntryBatch::View &row) const override {
+                auto string_hasher = std::hash<std::string_view>{};
+
+                auto hash = string_hasher(row.file);
+
+                if (row.output) {
+                    hash = hash_combine(hash, string_hasher(row.output.value()));
+                }
+
+                for (size_t index = 0; index < row.argument_count(); ++index) {
+                    hash = hash_combine(hash, string_hasher(row.argument(index)));
+                }
+
+                return hash;
+            }
     };
 
     DuplicateFilterPtr DuplicateFilter::from_content(const cs::Content& content) {
@@ -164,167 +412,2082 @@ namespace {
         return std::make_unique<FileOutputDuplicateFilter>();
     }
 
-}
+    // Publishes an output file atomically. The content is written into
+    // an unlinked temporary file in the target directory and linked into
+    // place once complete: a crashed run leaves no partial file behind,
+    // and the readers of the file (editors, language servers) observe a
+    // single modification instead of a gradually growing document. Where
+    // O_TMPFILE is not supported, a named temporary file and a rename
+    // give the same publication, only the crash leaves the name behind.
+    class AtomicOutputFile {
+    public:
+        explicit AtomicOutputFile(fs::path file)
+                : file_(std::move(file))
+                , temporary_()
+                , fd_(-1)
+                , stream_()
+        {
+            const auto directory =
+                    file_.parent_path().empty() ? fs::path(".") : file_.parent_path();
+#ifdef O_TMPFILE
+            fd_ = ::open(directory.c_str(), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
+#endif
+            if (fd_ >= 0) {
+                stream_.open(fmt::format("/proc/self/fd/{}", fd_));
+                if (stream_.is_open()) {
+                    return;
+                }
+                ::close(fd_);
+                fd_ = -1;
+            }
+            auto pattern = (directory / (file_.filename().string() + ".XXXXXX")).string();
+            const int fd = ::mkstemp(pattern.data());
+            if (fd >= 0) {
+                // mkstemp creates the file private to the owner; give it
+                // the permissions a plain creation would have given.
+                const auto mask = ::umask(0);
+                ::umask(mask);
+                ::fchmod(fd, 0666 & ~mask);
+                ::close(fd);
+                temporary_ = pattern;
+                stream_.open(temporary_);
+            }
+        }
 
-namespace cs {
+        ~AtomicOutputFile() noexcept {
+            stream_.close();
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+            if (!temporary_.empty()) {
+                std::error_code error_code;
+                fs::remove(temporary_, error_code);
+            }
+        }
 
-    void validate(const Entry &entry) {
-        if (entry.file.empty()) {
-            throw std::runtime_error("Field 'file' is empty string.");
+        [[nodiscard]] bool is_open() const {
+            return stream_.is_open();
         }
-        if (entry.directory.empty()) {
-            throw std::runtime_error("Field 'directory' is empty string.");
+
+        std::ostream &stream() noexcept {
+            return stream_;
         }
-        if (entry.output.has_value() && entry.output.value().empty()) {
-            throw std::runtime_error("Field 'output' is empty string.");
+
+        // Moves the finished content to the target path. Returns false
+        // when the write or the publication failed; the temporary is
+        // cleaned up by the destructor in that case.
+        bool publish() {
+            stream_.close();
+            if (stream_.fail()) {
+                return false;
+            }
+            if (fd_ >= 0) {
+                // The anonymous file gets a name next to the target first,
+                // then the rename replaces the target in one step.
+                auto named = file_.string() + ".publish";
+                const auto source = fmt::format("/proc/self/fd/{}", fd_);
+                ::unlink(named.c_str());
+                if (::linkat(AT_FDCWD, source.c_str(), AT_FDCWD, named.c_str(), AT_SYMLINK_FOLLOW) != 0) {
+                    return false;
+                }
+                ::close(fd_);
+                fd_ = -1;
+                temporary_ = named;
+            }
+            std::error_code error_code;
+            fs::rename(temporary_, file_, error_code);
+            if (error_code) {
+                return false;
+            }
+            temporary_.clear();
+            return true;
         }
-        if (entry.arguments.empty()) {
-            throw std::runtime_error("Field 'arguments' is empty list.");
+
+    private:
+        fs::path file_;
+        fs::path temporary_;
+        int fd_;
+        std::ofstream stream_;
+    };
+
+    // Routes the written bytes into two stream buffers: the writer
+    // produces the plain database and the compressed artifact in the
+    // same serialization pass.
+    class TeeBuf : public std::streambuf {
+    public:
+        TeeBuf(std::streambuf *first, std::streambuf *second)
+                : first_(first)
+                , second_(second)
+        { }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (ch == traits_type::eof()) {
+                return traits_type::not_eof(ch);
+            }
+            const auto c = traits_type::to_char_type(ch);
+            return ((first_->sputc(c) == traits_type::eof()) || (second_->sputc(c) == traits_type::eof()))
+                    ? traits_type::eof()
+                    : ch;
         }
-    }
 
-    nlohmann::json to_json(const Entry &rhs, const Format &format) {
-        nlohmann::json json;
+        std::streamsize xsputn(const char *source, std::streamsize count) override {
+            const auto first = first_->sputn(source, count);
+            const auto second = second_->sputn(source, count);
+            return std::min(first, second);
+        }
 
-        json["file"] = rhs.file;
-        json["directory"] = rhs.directory;
-        if (!format.drop_output_field && rhs.output.has_value()) {
-            json["output"] = rhs.output.value();
+        int sync() override {
+            return ((first_->pubsync() == 0) && (second_->pubsync() == 0)) ? 0 : -1;
         }
-        if (format.command_as_array) {
-            json["arguments"] = rhs.arguments;
-        } else {
-            json["command"] = sh::join(rhs.arguments);
+
+        // The writer asks the position to record the splice point of the
+        // index; that is a property of the plain file, so the query goes
+        // to the first buffer only.
+        pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override {
+            return ((offset == 0) && (direction == std::ios_base::cur))
+                    ? first_->pubseekoff(0, std::ios_base::cur, which)
+                    : pos_type(off_type(-1));
         }
 
-        return json;
-    }
+    private:
+        std::streambuf *first_;
+        std::streambuf *second_;
+    };
 
-    void from_json(const nlohmann::json &j, Entry &entry) {
-        j.at("file").get_to(entry.file);
-        j.at("directory").get_to(entry.directory);
-        if (j.contains("output")) {
-            std::string output;
-            j.at("output").get_to(output);
-            entry.output.emplace(output);
+    // The compressed companion of the database being written: the
+    // serialized bytes stream through a zstd compressor into the
+    // "<file>.zst" artifact while the plain file is produced, so the
+    // artifact costs no second pass over the entries.
+    class CompressedArtifact {
+    public:
+        CompressedArtifact(const fs::path &file, std::ostream &plain)
+                : target_(fs::path(file.string() + ".zst"))
+                , compressor_(target_.is_open()
+                        ? ic::collect::db::zstd_compress_stream(
+                                std::make_unique<std::ostream>(target_.stream().rdbuf()))
+                        : nullptr)
+                , tee_(plain.rdbuf(), (compressor_ != nullptr) ? compressor_->rdbuf() : plain.rdbuf())
+                , stream_(&tee_)
+        { }
+
+        [[nodiscard]] bool is_open() const {
+            return compressor_ != nullptr;
         }
-        if (j.contains("arguments")) {
-            std::list<std::string> arguments;
-            j.at("arguments").get_to(arguments);
-            entry.arguments.swap(arguments);
-        } else if (j.contains("command")) {
-            std::string command;
-            j.at("command").get_to(command);
 
-            sh::split(command)
-                    .on_success([&entry](auto arguments) {
-                        entry.arguments = arguments;
-                    })
-                    .on_error([](auto error) {
-                        throw error;
-                    });
-        } else {
-            throw std::runtime_error("Field 'command' or 'arguments' not found");
+        [[nodiscard]] std::ostream &stream() noexcept {
+            return stream_;
         }
 
-        validate(entry);
-    }
+        // Finishes the zstd frame, then moves the artifact in place.
+        [[nodiscard]] bool publish() {
+            compressor_.reset();
+            return target_.publish();
+        }
 
-    bool operator==(const Entry &lhs, const Entry &rhs) {
-        return (lhs.file == rhs.file)
-               && (lhs.directory == rhs.directory)
-               && (lhs.output == rhs.output)
-               && (lhs.arguments == rhs.arguments);
-    }
+    private:
+        AtomicOutputFile target_;
+        std::unique_ptr<std::ostream> compressor_;
+        TeeBuf tee_;
+        std::ostream stream_;
+    };
 
-    std::ostream &operator<<(std::ostream &os, const Entry &entry) {
-        const Format format;
-        const nlohmann::json &json = to_json(entry, format);
-        os << json;
+    // Recompresses the whole database file into its artifact: the path
+    // of the appended output, whose artifact cannot be spliced.
+    bool refresh_compressed(const fs::path &file) {
+        AtomicOutputFile target(fs::path(file.string() + ".zst"));
+        if (!target.is_open()) {
+            return false;
+        }
+        auto compressor = ic::collect::db::zstd_compress_stream(
+                std::make_unique<std::ostream>(target.stream().rdbuf()));
+        if (compressor == nullptr) {
+            return false;
+        }
+        std::ifstream source(file, std::ios::binary);
+        *compressor << source.rdbuf();
+        const bool copied = source.good() || source.eof();
+        compressor.reset();
+        return copied && target.publish();
+    }
 
-        return os;
+    // The compressed artifact stands in for the plain database on read:
+    // a ".zst" path decompresses directly, and when the plain file is
+    // missing but its compressed companion exists, that one is opened.
+    // Returns null when the zstd support is not built in.
+    std::unique_ptr<std::istream> open_database(const fs::path &file) {
+        if (file.extension() == ".zst") {
+            return ic::collect::db::zstd_decompress_stream(
+                    std::make_unique<std::ifstream>(file, std::ios::binary));
+        }
+        std::error_code error_code;
+        if (!fs::exists(file, error_code)) {
+            const fs::path compressed(file.string() + ".zst");
+            if (fs::exists(compressed, error_code)) {
+                return ic::collect::db::zstd_decompress_stream(
+                        std::make_unique<std::ifstream>(compressed, std::ios::binary));
+            }
+        }
+        return std::make_unique<std::ifstream>(file);
     }
 
-    CompilationDatabase::CompilationDatabase(Format _format, Content _content)
-            : format(_format)
-            , content(std::move(_content))
-    { }
+    // The spelling of the path relative to the entry directory, when it
+    // lies under that directory; a path elsewhere keeps its absolute
+    // form (a ../ chain could grow longer than the absolute spelling).
+    std::string_view relative_to(const std::string_view path, const std::string_view directory) {
+        if ((path.size() > directory.size() + 1)
+                && (path.compare(0, directory.size(), directory) == 0)
+                && (path[directory.size()] == '/')) {
+            return path.substr(directory.size() + 1);
+        }
+        return path;
+    }
 
+    // Serializes entries straight into a reused buffer, with the layout
+    // the generic JSON pretty printer would emit. The entry schema is
+    // fixed, so the fields are written directly: no JSON document is
+    // built and no allocation happens per field, which makes the write
+    // of a huge database a memory bandwidth problem, not a CPU one.
+    class EntrySerializer {
+    public:
+        explicit EntrySerializer(const cs::Format &format) noexcept
+                : format_(format)
+                , buffer_()
+        { }
 
-    rust::Result<size_t> CompilationDatabase::to_json(const fs::path &file, const Entries &rhs) const {
-        try {
-            std::ofstream target(file);
-            return to_json(target, rhs)
-                    .map_err<std::runtime_error>([&file](auto error) {
-                        return std::runtime_error(
-                                fmt::format("Failed to write file: {}, cause: {}",
-                                            file.string(),
-                                            error.what()));
-                    });
+        // Returns the entry as an element of the document array (two
+        // spaces base indentation, no trailing separator). The returned
+        // view is valid until the next call.
+        std::string_view serialize(const cs::Entry &entry) {
+            buffer_.clear();
+            append_literal("  {\n");
+            if (format_.command_as_array) {
+                if (entry.arguments.empty()) {
+                    append_literal("    \"arguments\": [],\n");
+                } else {
+                    append_literal("    \"arguments\": [\n");
+                    for (auto it = entry.arguments.begin(); it != entry.arguments.end(); ++it) {
+                        append_literal("      ");
+                        append_string(*it);
+                        append_literal((std::next(it) == entry.arguments.end()) ? "\n" : ",\n");
+                    }
+                    append_literal("    ],\n");
+                }
+            } else {
+                append_literal("    \"command\": ");
+                append_string(sh::join(entry.arguments.flatten()));
+                append_literal(",\n");
+            }
+            append_literal("    \"directory\": ");
+            append_string(entry.directory.native());
+            append_literal(",\n    \"file\": ");
+            append_string(format_.relative_to_directory
+                    ? relative_to(entry.file.native(), entry.directory.native())
+                    : std::string_view(entry.file.native()));
+            if (!format_.drop_output_field && entry.output.has_value()) {
+                append_literal(",\n    \"output\": ");
+                append_string(format_.relative_to_directory
+                        ? relative_to(entry.output.value().native(), entry.directory.native())
+                        : std::string_view(entry.output.value().native()));
+            }
+            append_literal("\n  }");
+            return std::string_view(buffer_.data(), buffer_.size());
+        }
 
-        } catch (const std::exception &error) {
-            return rust::Err(std::runtime_error(
-                    fmt::format("Failed to write file: {}, cause: {}",
-                                file.string(),
-                                error.what())));
+        // The same layout from a columnar row: the bytes go from the
+        // batch arena into the buffer, no entry object in between.
+        std::string_view serialize(const EntryBatch::View &row) {
+            buffer_.clear();
+            append_literal("  {\n");
+            if (format_.command_as_array) {
+                if (row.argument_count() == 0) {
+                    append_literal("    \"arguments\": [],\n");
+                } else {
+                    append_literal("    \"arguments\": [\n");
+                    for (size_t index = 0; index < row.argument_count(); ++index) {
+                        append_literal("      ");
+                        append_string(row.argument(index));
+                        append_literal((index + 1 == row.argument_count()) ? "\n" : ",\n");
+                    }
+                    append_literal("    ],\n");
+                }
+            } else {
+                // the quoting works on a list; this output mode is rare.
+                std::list<std::string> arguments;
+                for (size_t index = 0; index < row.argument_count(); ++index) {
+                    arguments.emplace_back(row.argument(index));
+                }
+                append_literal("    \"command\": ");
+                append_string(sh::join(arguments));
+                append_literal(",\n");
+            }
+            append_literal("    \"directory\": ");
+            append_string(row.directory);
+            append_literal(",\n    \"file\": ");
+            append_string(format_.relative_to_directory
+                    ? relative_to(row.file, row.directory)
+                    : row.file);
+            if (!format_.drop_output_field && row.output.has_value()) {
+                append_literal(",\n    \"output\": ");
+                append_string(format_.relative_to_directory
+                        ? relative_to(row.output.value(), row.directory)
+                        : row.output.value());
+            }
+            append_literal("\n  }");
+            return std::string_view(buffer_.data(), buffer_.size());
         }
-    }
 
-    rust::Result<size_t> CompilationDatabase::to_json(std::ostream &ostream, const Entries &entries) const {
-        try {
-            ContentFilter content_filter(content);
-            DuplicateFilterPtr duplicate_filter = DuplicateFilter::from_content(content);
+    private:
+        void append_literal(const std::string_view value) {
+            buffer_.append(value.data(), value.data() + value.size());
+        }
 
-            size_t count = 0;
-            nlohmann::json json = nlohmann::json::array();
-            for (const auto &entry : entries) {
-                if (content_filter.apply(entry) && duplicate_filter->apply(entry)) {
-                    auto json_entry = cs::to_json(entry, format);
-                    json.emplace_back(std::move(json_entry));
-                    ++count;
+        // Appends the value as a JSON string literal. The characters
+        // which need no escaping (the overwhelming majority) are copied
+        // in whole spans; the scan is a plain byte loop, which the
+        // compiler vectorizes.
+        void append_string(const std::string_view value) {
+            buffer_.push_back('"');
+            size_t begin = 0;
+            for (size_t index = 0; index < value.size(); ++index) {
+                const auto character = static_cast<unsigned char>(value[index]);
+                if ((character != '"') && (character != '\\') && (character >= 0x20)) {
+                    continue;
                 }
+                buffer_.append(value.data() + begin, value.data() + index);
+                switch (character) {
+                    case '"': append_literal("\\\""); break;
+                    case '\\': append_literal("\\\\"); break;
+                    case '\b': append_literal("\\b"); break;
+                    case '\f': append_literal("\\f"); break;
+                    case '\n': append_literal("\\n"); break;
+                    case '\r': append_literal("\\r"); break;
+                    case '\t': append_literal("\\t"); break;
+                    default:
+                        fmt::format_to(std::back_inserter(buffer_), "\\u{:04x}", character);
+                        break;
+                }
+                begin = index + 1;
             }
+            buffer_.append(value.data() + begin, value.data() + value.size());
+            buffer_.push_back('"');
+        }
 
-            ostream << std::setw(2) << json << std::endl;
+    private:
+        cs::Format format_;
+        fmt::memory_buffer buffer_;
+    };
 
-            return rust::Ok(count);
-        } catch (const std::exception &error) {
-            return rust::Err(std::runtime_error(error.what()));
+    // The digest of the fields the configured duplicate filter compares.
+    // (A stable hash: the append index persists it across runs.)
+    uint64_t key_digest(const cs::Entry &entry, const std::string &fields) {
+        cs::Digest digest;
+        digest.feed(entry.file.native());
+        if (fields != cs::DUPLICATE_FILE && entry.output) {
+            digest.feed(entry.output->native());
+        }
+        if (fields == cs::DUPLICATE_ALL) {
+            for (const auto &argument : entry.arguments) {
+                digest.feed(argument);
+            }
         }
+        return digest.state;
     }
 
-    rust::Result<size_t> CompilationDatabase::from_json(const fs::path &file, std::list<cs::Entry> &entries) const {
-        try {
-            std::ifstream source(file);
-            return from_json(source, entries)
-                    .map_err<std::runtime_error>([&file](auto error) {
-                        return std::runtime_error(
-                                fmt::format("Failed to read file: {}, cause: {}",
-                                            file.string(),
-                                            error.what()));
-                    });
-        } catch (const std::exception &error) {
-            return rust::Err(std::runtime_error(
-                    fmt::format("Failed to read file: {}, cause: {}",
-                                file.string(),
-                                error.what())));
+    // The digest of every field; tells an identical entry apart from an
+    // entry which collides on the filter key only.
+    uint64_t content_digest(const cs::Entry &entry) {
+        cs::Digest digest;
+        digest.feed(entry.file.native());
+        digest.feed(entry.directory.native());
+        if (entry.output) {
+            digest.feed(entry.output->native());
+        }
+        for (const auto &argument : entry.arguments) {
+            digest.feed(argument);
         }
+        return digest.state;
     }
 
-    rust::Result<size_t> CompilationDatabase::from_json(std::istream &istream, std::list<cs::Entry> &entries) const {
-        try {
-            nlohmann::json in;
-            istream >> in;
+    // The same digests from a columnar row; they shall stay identical to
+    // the entry form, the append index persists them across runs.
+    uint64_t key_digest(const EntryBatch::View &row, const std::string &fields) {
+        cs::Digest digest;
+        digest.feed(row.file);
+        if (fields != cs::DUPLICATE_FILE && row.output.has_value()) {
+            digest.feed(row.output.value());
+        }
+        if (fields == cs::DUPLICATE_ALL) {
+            for (size_t index = 0; index < row.argument_count(); ++index) {
+                digest.feed(row.argument(index));
+            }
+        }
+        return digest.state;
+    }
+
+    uint64_t content_digest(const EntryBatch::View &row) {
+        cs::Digest digest;
+        digest.feed(row.file);
+        digest.feed(row.directory);
+        if (row.output.has_value()) {
+            digest.feed(row.output.value());
+        }
+        for (size_t index = 0; index < row.argument_count(); ++index) {
+            digest.feed(row.argument(index));
+        }
+        return digest.state;
+    }
+
+    // The digest of the configuration the append index depends on: when
+    // the format or the filters change, the indexed content would not
+    // match what a fresh run produces, so the index becomes stale.
+    uint64_t index_config_digest(const cs::Format &format, const cs::Content &content) {
+        cs::Digest digest;
+        digest.feed(format.command_as_array ? "arguments" : "command");
+        digest.feed(format.drop_output_field ? "no-output" : "output");
+        digest.feed(content.duplicate_filter_fields);
+        for (const auto &path : content.paths_to_include) {
+            digest.feed(path.native());
+        }
+        for (const auto &path : content.paths_to_exclude) {
+            digest.feed(path.native());
+        }
+        return digest.state;
+    }
+
+    // Writes the filtered entries of one database with the array framing
+    // around them, and collects what the append index needs: the digests
+    // of the written entries and where the closing bracket starts.
+    class EntryWriter {
+    public:
+        EntryWriter(const cs::Format &format, const cs::Content &content, std::ostream &ostream)
+                : content_filter_(content)
+                , duplicate_filter_(DuplicateFilter::from_content(content))
+                , fields_(content.duplicate_filter_fields)
+                , serializer_(format)
+                , ostream_(ostream)
+                , digests_()
+                , tail_(0)
+                , count_(0)
+        { }
 
-            for (const auto &e : in) {
-                Entry entry;
-                cs::from_json(e, entry);
-                entries.emplace_back(entry);
+        void write(const cs::Entry &entry) {
+            if (content_filter_.apply(entry) && duplicate_filter_->apply(entry)) {
+                ostream_ << ((count_ == 0) ? "[\n" : ",\n");
+                const auto serialized = serializer_.serialize(entry);
+                ostream_.write(serialized.data(), std::streamsize(serialized.size()));
+                digests_.emplace_back(key_digest(entry, fields_), content_digest(entry));
+                ++count_;
             }
+        }
 
-            return rust::Ok(in.size());
-        } catch (const std::exception &error) {
-            return rust::Err(std::runtime_error(error.what()));
+        // The columnar form: the filters, the digests and the serializer
+        // all run on the arena views, no entry object is built.
+        void write(const EntryBatch::View &row) {
+            if (content_filter_.apply(row) && duplicate_filter_->apply(row)) {
+                ostream_ << ((count_ == 0) ? "[\n" : ",\n");
+                const auto serialized = serializer_.serialize(row);
+                ostream_.write(serialized.data(), std::streamsize(serialized.size()));
+                digests_.emplace_back(key_digest(row, fields_), content_digest(row));
+                ++count_;
+            }
+        }
+
+        // Closes the array; returns the number of entries written.
+        size_t finish() {
+            tail_ = size_t(std::max<std::streamoff>(0, ostream_.tellp()));
+            ostream_ << ((count_ == 0) ? "[]" : "\n]") << std::endl;
+            return count_;
+        }
+
+        [[nodiscard]] const std::vector<std::pair<uint64_t, uint64_t>> &digests() const noexcept {
+            return digests_;
+        }
+
+        [[nodiscard]] size_t tail() const noexcept {
+            return tail_;
+        }
+
+    private:
+        ContentFilter content_filter_;
+        DuplicateFilterPtr duplicate_filter_;
+        std::string fields_;
+        EntrySerializer serializer_;
+        std::ostream &ostream_;
+        std::vector<std::pair<uint64_t, uint64_t>> digests_;
+        size_t tail_;
+        size_t count_;
+    };
+
+    constexpr uint32_t INDEX_VERSION = 2;
+
+    fs::path index_file(const fs::path &file) {
+        return fs::path(file.string() + ".index");
+    }
+
+    // The modification time of the file as a raw tick count; zero when
+    // the file cannot be stat'd. Part of the index fingerprint: a file
+    // rewritten to the same byte count still invalidates the sidecar.
+    int64_t file_mtime(const fs::path &file) {
+        std::error_code error_code;
+        const auto time = fs::last_write_time(file, error_code);
+        return error_code ? 0 : int64_t(time.time_since_epoch().count());
+    }
+
+    // The append index of a database file: the digests of the entries it
+    // holds and the offset where new entries can be spliced in.
+    struct AppendIndex {
+        size_t size;
+        size_t tail;
+        std::vector<std::pair<uint64_t, uint64_t>> digests;
+    };
+
+    // Persists the append index next to the database file. A failure is
+    // not an error: the next append run falls back to the full merge.
+    void write_index(
+            const fs::path &file,
+            const cs::Format &format,
+            const cs::Content &content,
+            const size_t tail,
+            const std::vector<std::pair<uint64_t, uint64_t>> &digests) {
+        std::error_code error_code;
+        const auto size = fs::file_size(file, error_code);
+        if (error_code) {
+            return;
+        }
+        std::ofstream target(index_file(file));
+        target << fmt::format("index {} {:016x} {} {} {} {}\n",
+                              INDEX_VERSION,
+                              index_config_digest(format, content),
+                              size, file_mtime(file), tail, digests.size());
+        for (const auto &[key, value] : digests) {
+            target << fmt::format("{:016x} {:016x}\n", key, value);
+        }
+    }
+
+    // Reads the append index of the database file back; empty when the
+    // index is missing, corrupt, or does not describe the current file
+    // content and configuration.
+    std::optional<AppendIndex> read_index(
+            const fs::path &file,
+            const cs::Format &format,
+            const cs::Content &content) {
+        std::ifstream source(index_file(file));
+        std::string magic;
+        uint32_t version = 0;
+        uint64_t config = 0;
+        AppendIndex result = {0, 0, {}};
+        int64_t mtime = 0;
+        size_t count = 0;
+        source >> magic >> std::dec >> version >> std::hex >> config
+               >> std::dec >> result.size >> mtime >> result.tail >> count;
+        if (!source || magic != "index" || version != INDEX_VERSION
+                || config != index_config_digest(format, content)) {
+            return std::nullopt;
+        }
+        std::error_code error_code;
+        if (fs::file_size(file, error_code) != result.size || error_code) {
+            return std::nullopt;
+        }
+        if (file_mtime(file) != mtime) {
+            return std::nullopt;
+        }
+        result.digests.reserve(count);
+        for (size_t idx = 0; idx < count; ++idx) {
+            uint64_t key = 0;
+            uint64_t value = 0;
+            if (!(source >> std::hex >> key >> value)) {
+                return std::nullopt;
+            }
+            result.digests.emplace_back(key, value);
+        }
+        return result;
+    }
+
+    // Whether the database file is one this tool wrote: the append
+    // index sidecar is its fingerprint. The header names the file size
+    // and modification time at write time, so a file touched by
+    // anything else since does not pass — not even an in-place rewrite
+    // which keeps the byte count. The configuration digest is not
+    // compared here: it guards the splice semantics, not the
+    // trustworthiness of the bytes.
+    bool self_produced(const fs::path &file) {
+        std::ifstream source(index_file(file));
+        std::string magic;
+        uint32_t version = 0;
+        uint64_t config = 0;
+        size_t size = 0;
+        int64_t mtime = 0;
+        source >> magic >> std::dec >> version >> std::hex >> config >> std::dec >> size >> mtime;
+        if (!source || magic != "index" || version != INDEX_VERSION) {
+            return false;
+        }
+        std::error_code error_code;
+        return (fs::file_size(file, error_code) == size) && !error_code
+                && (file_mtime(file) == mtime);
+    }
+
+    // SAX handler which builds and validates one entry at a time, so the
+    // reader never materializes the whole document in memory.
+    class StreamingReader : public nlohmann::json_sax<nlohmann::json> {
+    public:
+        explicit StreamingReader(const cs::CompilationDatabase::EntryConsumer &consumer) noexcept
+                : consumer_(&consumer)
+                , batch_sink_(nullptr)
+        { }
+
+        // The columnar mode: the records land in the batch, entry
+        // objects are never built.
+        explicit StreamingReader(EntryBatch &batch) noexcept
+                : consumer_(nullptr)
+                , batch_sink_(&batch)
+        { }
+
+        [[nodiscard]] size_t count() const noexcept {
+            return count_;
+        }
+
+        bool start_array(std::size_t elements) override {
+            if (builder_) {
+                ++depth_;
+                return builder_->start_array(elements);
+            }
+            if (!in_array_) {
+                in_array_ = true;
+                return true;
+            }
+            // an entry shall be an object, not an array.
+            return false;
+        }
+
+        bool end_array() override {
+            if (builder_) {
+                --depth_;
+                return builder_->end_array();
+            }
+            in_array_ = false;
+            return true;
+        }
+
+        bool start_object(std::size_t elements) override {
+            if (!builder_) {
+                if (!in_array_) {
+                    // the document itself shall be an array of objects.
+                    return false;
+                }
+                value_ = nlohmann::json();
+                builder_ = std::make_unique<nlohmann::detail::json_sax_dom_parser<nlohmann::json>>(value_);
+                depth_ = 0;
+            }
+            ++depth_;
+            return builder_->start_object(elements);
+        }
+
+        bool end_object() override {
+            if (!builder_) {
+                return false;
+            }
+            const bool result = builder_->end_object();
+            if (--depth_ == 0) {
+                // the entry is complete, convert and validate it.
+                if (batch_sink_ != nullptr) {
+                    batch_sink_->push(value_);
+                } else {
+                    cs::Entry entry;
+                    cs::from_json(value_, entry);
+                    (*consumer_)(std::move(entry));
+                }
+                ++count_;
+                builder_.reset();
+            }
+            return result;
+        }
+
+        bool null() override { return builder_ && builder_->null(); }
+        bool boolean(bool value) override { return builder_ && builder_->boolean(value); }
+        bool number_integer(number_integer_t value) override { return builder_ && builder_->number_integer(value); }
+        bool number_unsigned(number_unsigned_t value) override { return builder_ && builder_->number_unsigned(value); }
+        bool number_float(number_float_t value, const string_t &raw) override { return builder_ && builder_->number_float(value, raw); }
+        bool string(string_t &value) override { return builder_ && builder_->string(value); }
+        bool binary(binary_t &value) override { return builder_ && builder_->binary(value); }
+        bool key(string_t &value) override { return builder_ && builder_->key(value); }
+
+        bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &error) override {
+            throw std::runtime_error(error.what());
+        }
+
+    private:
+        const cs::CompilationDatabase::EntryConsumer *consumer_;
+        EntryBatch *batch_sink_;
+        size_t count_ = 0;
+        size_t depth_ = 0;
+        bool in_array_ = false;
+        nlohmann::json value_;
+        std::unique_ptr<nlohmann::detail::json_sax_dom_parser<nlohmann::json>> builder_;
+    };
+
+    // A read only memory mapping of a file. Unmaps on destruction.
+    class MappedFile {
+    public:
+        explicit MappedFile(const fs::path &file)
+                : data_(nullptr)
+                , size_(0)
+        {
+            const int fd = ::open(file.c_str(), O_RDONLY);
+            if (fd == -1) {
+                return;
+            }
+            struct stat status = {};
+            if ((::fstat(fd, &status) == -1) || (status.st_size == 0)) {
+                ::close(fd);
+                return;
+            }
+            void *const address = ::mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED) {
+                return;
+            }
+            data_ = static_cast<const char *>(address);
+            size_ = size_t(status.st_size);
+        }
+
+        ~MappedFile() noexcept {
+            if (data_ != nullptr) {
+                ::munmap(const_cast<char *>(data_), size_);
+            }
+        }
+
+        [[nodiscard]] bool is_open() const { return data_ != nullptr; }
+        [[nodiscard]] const char *data() const { return data_; }
+        [[nodiscard]] size_t size() const { return size_; }
+
+        NON_DEFAULT_CONSTRUCTABLE(MappedFile)
+        NON_COPYABLE_NOR_MOVABLE(MappedFile)
+
+    private:
+        const char *data_;
+        size_t size_;
+    };
+
+    // The cut points of the document for the parallel parse: the content
+    // range of the top level array, and inside it the offsets right after
+    // a record nearest to the even sized cut targets. One byte scan which
+    // only tracks the string state and the nesting depth, so it runs at
+    // memory speed. Returns nothing when the document does not look like
+    // an array of objects; the streaming reader reports those properly.
+    struct DocumentCuts {
+        size_t content_begin;
+        size_t content_end;
+        std::vector<size_t> offsets;
+    };
+
+    std::optional<DocumentCuts> cut_document(const char *data, const size_t size, const size_t chunks) {
+        DocumentCuts result = {0, 0, {}};
+        bool in_string = false;
+        bool escaped = false;
+        bool closed = false;
+        size_t depth = 0;
+        size_t target = 1;
+        for (size_t offset = 0; offset < size; ++offset) {
+            const char character = data[offset];
+            if (in_string) {
+                if (escaped) {
+                    escaped = false;
+                } else if (character == '\\') {
+                    escaped = true;
+                } else if (character == '"') {
+                    in_string = false;
+                }
+                continue;
+            }
+            switch (character) {
+                case '"':
+                    if (depth < 2) {
+                        // a string toplevel or directly in the array.
+                        return std::nullopt;
+                    }
+                    in_string = true;
+                    break;
+                case '[':
+                case '{':
+                    if (depth == 0) {
+                        if ((character != '[') || closed) {
+                            return std::nullopt;
+                        }
+                        result.content_begin = offset + 1;
+                    } else if ((depth == 1) && (character == '[')) {
+                        // a record shall be an object, not an array.
+                        return std::nullopt;
+                    }
+                    ++depth;
+                    break;
+                case ']':
+                case '}':
+                    if (depth == 0) {
+                        return std::nullopt;
+                    }
+                    --depth;
+                    if (depth == 0) {
+                        result.content_end = offset;
+                        closed = true;
+                    } else if ((depth == 1) && (character == '}')) {
+                        // a record ended; keep it when a cut target passed.
+                        if ((target < chunks) && (offset + 1 >= size * target / chunks)) {
+                            result.offsets.push_back(offset + 1);
+                            while ((target < chunks) && (offset + 1 >= size * target / chunks)) {
+                                ++target;
+                            }
+                        }
+                    }
+                    break;
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                case ',':
+                    break;
+                default:
+                    if (depth < 2) {
+                        // a scalar toplevel or directly in the array.
+                        return std::nullopt;
+                    }
+                    break;
+            }
+        }
+        return (closed && (depth == 0) && !in_string)
+                ? std::make_optional(std::move(result))
+                : std::nullopt;
+    }
+
+    // Parses a large database file on worker threads: the document is
+    // memory mapped, cut on record boundaries, and every chunk runs its
+    // own SAX parse into a private columnar batch. The batches keep the
+    // document order, so the duplicate filtering downstream keeps its
+    // first-wins semantic. Returns nothing when the parallel path does
+    // not apply (small file, single core, unmappable or malformed
+    // input); the caller falls back to the streaming reader then.
+    std::optional<rust::Result<std::vector<EntryBatch>>>
+    parse_batches(const fs::path &file) {
+        constexpr size_t PARALLEL_PARSE_THRESHOLD = 8 * 1024 * 1024;
+
+        const size_t cores = std::thread::hardware_concurrency();
+        const size_t chunks = std::min((cores > 1) ? cores : 1, size_t(16));
+        if (chunks < 2) {
+            return std::nullopt;
+        }
+        const MappedFile mapped(file);
+        if (!mapped.is_open() || (mapped.size() < PARALLEL_PARSE_THRESHOLD)) {
+            return std::nullopt;
+        }
+        const auto cuts = cut_document(mapped.data(), mapped.size(), chunks);
+        if (!cuts.has_value()) {
+            return std::nullopt;
+        }
+
+        std::vector<size_t> bounds;
+        bounds.reserve(cuts->offsets.size() + 2);
+        bounds.push_back(cuts->content_begin);
+        bounds.insert(bounds.end(), cuts->offsets.begin(), cuts->offsets.end());
+        bounds.push_back(cuts->content_end);
+
+        const size_t count = bounds.size() - 1;
+        std::vector<EntryBatch> batches(count);
+        std::vector<std::string> errors(count);
+        {
+            std::vector<std::thread> workers;
+            workers.reserve(count);
+            for (size_t index = 0; index < count; ++index) {
+                workers.emplace_back([&mapped, &bounds, &batches, &errors, index]() {
+                    const char *begin = mapped.data() + bounds[index];
+                    const char *const end = mapped.data() + bounds[index + 1];
+                    // the chunk starts after the previous record; strip
+                    // the separator to frame it as an array again.
+                    while ((begin != end) && ((*begin == ' ') || (*begin == '\t') || (*begin == '\n') || (*begin == '\r'))) {
+                        ++begin;
+                    }
+                    if ((begin != end) && (*begin == ',')) {
+                        ++begin;
+                    }
+                    std::string payload;
+                    payload.reserve(size_t(end - begin) + 2);
+                    payload += '[';
+                    payload.append(begin, end);
+                    payload += ']';
+                    try {
+                        StreamingReader reader(batches[index]);
+                        if (!nlohmann::json::sax_parse(payload, &reader)) {
+                            errors[index] = "The file is not a JSON array of objects.";
+                        }
+                    } catch (const std::exception &error) {
+                        errors[index] = error.what();
+                    }
+                });
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+        }
+        for (const auto &error : errors) {
+            if (!error.empty()) {
+                return std::make_optional(
+                        rust::Result<std::vector<EntryBatch>>(rust::Err(std::runtime_error(error))));
+            }
+        }
+        return std::make_optional(
+                rust::Result<std::vector<EntryBatch>>(rust::Ok(std::move(batches))));
+    }
+
+    // Parser for a database this tool wrote itself (see self_produced).
+    // The input needs no schema validation and no UTF-8 revalidation,
+    // the writer produced well formed content; the parse is one pass
+    // over the mapped bytes which only knows the entry fields, strings
+    // and string arrays. Anything it does not expect aborts the fast
+    // path (the parse returns nothing) and the caller falls back to the
+    // strict reader: a surprise costs a wasted prefix scan, never a
+    // wrong result. The entries are collected and handed over only when
+    // the whole document parsed, so a late abort cannot leak a partial
+    // read into the consumer.
+    class TrustedParser {
+    public:
+        TrustedParser(const char *data, size_t size) noexcept
+                : cursor_(data)
+                , end_(data + size)
+        { }
+
+        [[nodiscard]] std::optional<size_t> parse(const cs::CompilationDatabase::EntryConsumer &consumer) {
+            std::list<cs::Entry> entries;
+            if (!expect('[')) {
+                return std::nullopt;
+            }
+            skip_spaces();
+            if ((cursor_ != end_) && (*cursor_ == ']')) {
+                ++cursor_;
+            } else {
+                while (true) {
+                    cs::Entry entry;
+                    if (!parse_entry(entry)) {
+                        return std::nullopt;
+                    }
+                    entries.emplace_back(std::move(entry));
+                    skip_spaces();
+                    if ((cursor_ != end_) && (*cursor_ == ',')) {
+                        ++cursor_;
+                        continue;
+                    }
+                    if ((cursor_ != end_) && (*cursor_ == ']')) {
+                        ++cursor_;
+                        break;
+                    }
+                    return std::nullopt;
+                }
+            }
+            skip_spaces();
+            if (cursor_ != end_) {
+                return std::nullopt;
+            }
+            const size_t count = entries.size();
+            for (auto &entry : entries) {
+                consumer(std::move(entry));
+            }
+            return count;
+        }
+
+        NON_DEFAULT_CONSTRUCTABLE(TrustedParser)
+
+    private:
+        void skip_spaces() {
+            while ((cursor_ != end_)
+                    && ((*cursor_ == ' ') || (*cursor_ == '\t') || (*cursor_ == '\n') || (*cursor_ == '\r'))) {
+                ++cursor_;
+            }
+        }
+
+        bool expect(const char character) {
+            skip_spaces();
+            if ((cursor_ == end_) || (*cursor_ != character)) {
+                return false;
+            }
+            ++cursor_;
+            return true;
+        }
+
+        static int hex_digit(const char character) {
+            if ((character >= '0') && (character <= '9')) {
+                return character - '0';
+            }
+            if ((character >= 'a') && (character <= 'f')) {
+                return character - 'a' + 10;
+            }
+            if ((character >= 'A') && (character <= 'F')) {
+                return character - 'A' + 10;
+            }
+            return -1;
+        }
+
+        bool parse_string(std::string &result) {
+            if (!expect('"')) {
+                return false;
+            }
+            result.clear();
+            const char *begin = cursor_;
+            while (cursor_ != end_) {
+                const char character = *cursor_;
+                if (character == '"') {
+                    result.append(begin, cursor_);
+                    ++cursor_;
+                    return true;
+                }
+                if (character != '\\') {
+                    ++cursor_;
+                    continue;
+                }
+                result.append(begin, cursor_);
+                if (++cursor_ == end_) {
+                    return false;
+                }
+                switch (*cursor_) {
+                    case '"': result.push_back('"'); break;
+                    case '\\': result.push_back('\\'); break;
+                    case '/': result.push_back('/'); break;
+                    case 'b': result.push_back('\b'); break;
+                    case 'f': result.push_back('\f'); break;
+                    case 'n': result.push_back('\n'); break;
+                    case 'r': result.push_back('\r'); break;
+                    case 't': result.push_back('\t'); break;
+                    case 'u': {
+                        // the writer only emits control character escapes
+                        // this way; anything above ASCII is not ours.
+                        if (end_ - cursor_ < 5) {
+                            return false;
+                        }
+                        int value = 0;
+                        for (int index = 1; index <= 4; ++index) {
+                            const int digit = hex_digit(cursor_[index]);
+                            if (digit < 0) {
+                                return false;
+                            }
+                            value = value * 16 + digit;
+                        }
+                        if (value > 0x7f) {
+                            return false;
+                        }
+                        result.push_back(char(value));
+                        cursor_ += 4;
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+                ++cursor_;
+                begin = cursor_;
+            }
+            return false;
+        }
+
+        bool parse_entry(cs::Entry &entry) {
+            if (!expect('{')) {
+                return false;
+            }
+            bool first = true;
+            std::string key;
+            std::string value;
+            while (true) {
+                skip_spaces();
+                if ((cursor_ != end_) && (*cursor_ == '}')) {
+                    ++cursor_;
+                    break;
+                }
+                if (!first && !expect(',')) {
+                    return false;
+                }
+                first = false;
+                if (!parse_string(key) || !expect(':')) {
+                    return false;
+                }
+                if (key == "arguments") {
+                    if (!expect('[')) {
+                        return false;
+                    }
+                    skip_spaces();
+                    if ((cursor_ != end_) && (*cursor_ == ']')) {
+                        ++cursor_;
+                        continue;
+                    }
+                    while (true) {
+                        if (!parse_string(value)) {
+                            return false;
+                        }
+                        entry.arguments.emplace_back(std::move(value));
+                        skip_spaces();
+                        if ((cursor_ != end_) && (*cursor_ == ',')) {
+                            ++cursor_;
+                            continue;
+                        }
+                        if ((cursor_ != end_) && (*cursor_ == ']')) {
+                            ++cursor_;
+                            break;
+                        }
+                        return false;
+                    }
+                } else if (key == "command") {
+                    if (!parse_string(value)) {
+                        return false;
+                    }
+                    auto split = sh::split(value);
+                    if (split.is_err()) {
+                        return false;
+                    }
+                    const auto arguments = split.unwrap();
+                    entry.arguments.assign(arguments.begin(), arguments.end());
+                } else if (key == "directory") {
+                    if (!parse_string(value)) {
+                        return false;
+                    }
+                    entry.directory = fs::path(std::move(value));
+                } else if (key == "file") {
+                    if (!parse_string(value)) {
+                        return false;
+                    }
+                    entry.file = fs::path(std::move(value));
+                } else if (key == "output") {
+                    if (!parse_string(value)) {
+                        return false;
+                    }
+                    entry.output.emplace(std::move(value));
+                } else {
+                    // an unknown field: not our output, let the strict
+                    // reader judge it.
+                    return false;
+                }
+            }
+            // the same anchoring the strict reader applies: the
+            // in-memory entries are always absolute.
+            if (entry.file.is_relative()) {
+                entry.file = entry.directory / entry.file;
+            }
+            if (entry.output.has_value() && entry.output.value().is_relative()) {
+                entry.output = entry.directory / entry.output.value();
+            }
+            return !entry.file.empty() && !entry.directory.empty();
+        }
+
+    private:
+        const char *cursor_;
+        const char *end_;
+    };
+
+    // The longest common directory prefix of two paths.
+    fs::path common_prefix(const fs::path &lhs, const fs::path &rhs) {
+        fs::path result;
+        for (auto lit = lhs.begin(), rit = rhs.begin();
+                (lit != lhs.end()) && (rit != rhs.end()) && (*lit == *rit);
+                ++lit, ++rit) {
+            result /= *lit;
+        }
+        return result;
+    }
+
+    // The shard directory of an entry: the top level directory of its
+    // file under the common root. Empty when the file sits directly in
+    // the root directory (or outside of it).
+    fs::path shard_of(const fs::path &root, const fs::path &directory) {
+        auto root_it = root.begin();
+        auto dir_it = directory.begin();
+        while ((root_it != root.end()) && (dir_it != directory.end()) && (*root_it == *dir_it)) {
+            ++root_it;
+            ++dir_it;
+        }
+        return ((root_it == root.end()) && (dir_it != directory.end()))
+                ? root / *dir_it
+                : fs::path();
+    }
+
+    // Writes the entries of one shard; emits the array framing around
+    // them. A shard which cannot be opened is reported once and skipped.
+    class ShardWriter {
+    public:
+        ShardWriter(const fs::path &file, const cs::Format &format)
+                : stream_(file)
+                , serializer_(format)
+                , count_(0)
+        {
+            if (!stream_.is_open()) {
+                spdlog::warn("Failed to open shard file: {}", file.string());
+            }
+        }
+
+        ~ShardWriter() noexcept {
+            if (stream_.is_open()) {
+                stream_ << ((count_ == 0) ? "[]" : "\n]") << std::endl;
+            }
+        }
+
+        bool write(const cs::Entry &entry) {
+            if (!stream_.is_open()) {
+                return false;
+            }
+            stream_ << ((count_ == 0) ? "[\n" : ",\n");
+            const auto serialized = serializer_.serialize(entry);
+            stream_.write(serialized.data(), std::streamsize(serialized.size()));
+            ++count_;
+            return true;
+        }
+
+    private:
+        std::ofstream stream_;
+        EntrySerializer serializer_;
+        size_t count_;
+    };
+
+    // The output order of the sorted mode: by file, then by the command.
+    // (The remaining fields break the rare ties, so the order is total
+    // and two databases of the same build diff cleanly.)
+    bool entry_less(const cs::Entry *lhs, const cs::Entry *rhs) {
+        if (lhs->file != rhs->file) {
+            return lhs->file < rhs->file;
+        }
+        if (lhs->arguments != rhs->arguments) {
+            return lhs->arguments < rhs->arguments;
+        }
+        if (lhs->directory != rhs->directory) {
+            return lhs->directory < rhs->directory;
+        }
+        return lhs->output < rhs->output;
+    }
+
+    // An index of the entries in output order. Only the pointers are
+    // sorted, the entries do not move. Large indexes are cut into chunks
+    // sorted on worker threads and merged pairwise, so a million entry
+    // database sorts in a fraction of a second.
+    std::vector<const cs::Entry *> sorted_index(const cs::CompilationDatabase::Entries &entries) {
+        std::vector<const cs::Entry *> result;
+        result.reserve(entries.size());
+        for (const auto &entry : entries) {
+            result.push_back(&entry);
+        }
+
+        const size_t cores = std::thread::hardware_concurrency();
+        const size_t chunks = std::min((cores > 1) ? cores : 1, size_t(16));
+        constexpr size_t PARALLEL_SORT_THRESHOLD = 16 * 1024;
+        if ((chunks < 2) || (result.size() < PARALLEL_SORT_THRESHOLD)) {
+            std::sort(result.begin(), result.end(), entry_less);
+            return result;
+        }
+
+        std::vector<size_t> bounds;
+        bounds.reserve(chunks + 1);
+        for (size_t index = 0; index <= chunks; ++index) {
+            bounds.push_back(result.size() * index / chunks);
+        }
+        {
+            std::vector<std::thread> workers;
+            workers.reserve(chunks);
+            for (size_t index = 0; index < chunks; ++index) {
+                workers.emplace_back([&result, &bounds, index]() {
+                    std::sort(std::next(result.begin(), bounds[index]),
+                              std::next(result.begin(), bounds[index + 1]),
+                              entry_less);
+                });
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+        }
+        for (size_t width = 1; width < chunks; width *= 2) {
+            std::vector<std::thread> workers;
+            for (size_t index = 0; index + width < chunks; index += 2 * width) {
+                workers.emplace_back([&result, &bounds, &chunks, index, width]() {
+                    std::inplace_merge(
+                            std::next(result.begin(), bounds[index]),
+                            std::next(result.begin(), bounds[index + width]),
+                            std::next(result.begin(), bounds[std::min(index + 2 * width, chunks)]),
+                            entry_less);
+                });
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+        }
+        return result;
+    }
+}
+
+namespace cs {
+
+    void validate(const Entry &entry) {
+        if (entry.file.empty()) {
+            throw std::runtime_error("Field 'file' is empty string.");
+        }
+        if (entry.directory.empty()) {
+            throw std::runtime_error("Field 'directory' is empty string.");
+        }
+        if (entry.output.has_value() && entry.output.value().empty()) {
+            throw std::runtime_error("Field 'output' is empty string.");
+        }
+        if (entry.arguments.empty()) {
+            throw std::runtime_error("Field 'arguments' is empty list.");
+        }
+    }
+
+    nlohmann::json to_json(const Entry &rhs, const Format &format) {
+        nlohmann::json json;
+
+        json["file"] = format.relative_to_directory
+                ? std::string(relative_to(rhs.file.native(), rhs.directory.native()))
+                : rhs.file.native();
+        json["directory"] = rhs.directory;
+        if (!format.drop_output_field && rhs.output.has_value()) {
+            json["output"] = format.relative_to_directory
+                    ? std::string(relative_to(rhs.output.value().native(), rhs.directory.native()))
+                    : rhs.output.value().native();
+        }
+        if (format.command_as_array) {
+            json["arguments"] = rhs.arguments;
+        } else {
+            json["command"] = sh::join(rhs.arguments.flatten());
+        }
+
+        return json;
+    }
+
+    void from_json(const nlohmann::json &j, Entry &entry) {
+        j.at("file").get_to(entry.file);
+        j.at("directory").get_to(entry.directory);
+        if (j.contains("output")) {
+            std::string output;
+            j.at("output").get_to(output);
+            entry.output.emplace(output);
+        }
+        if (j.contains("arguments")) {
+            std::vector<std::string> arguments;
+            j.at("arguments").get_to(arguments);
+            entry.arguments.swap(arguments);
+        } else if (j.contains("command")) {
+            std::string command;
+            j.at("command").get_to(command);
+
+            sh::split(command)
+                    .on_success([&entry](auto arguments) {
+                        entry.arguments.assign(arguments.begin(), arguments.end());
+                    })
+                    .on_error([](auto error) {
+                        throw error;
+                    });
+        } else {
+            throw std::runtime_error("Field 'command' or 'arguments' not found");
+        }
+        // A relative file (or output) is anchored to the entry directory
+        // on read, so the in-memory entries are always absolute.
+        if (entry.file.is_relative()) {
+            entry.file = entry.directory / entry.file;
+        }
+        if (entry.output.has_value() && entry.output.value().is_relative()) {
+            entry.output = entry.directory / entry.output.value();
+        }
+
+        validate(entry);
+    }
+
+    bool operator==(const Entry &lhs, const Entry &rhs) {
+        return (lhs.file == rhs.file)
+               && (lhs.directory == rhs.directory)
+               && (lhs.output == rhs.output)
+               && (lhs.arguments == rhs.arguments);
+    }
+
+    std::ostream &operator<<(std::ostream &os, const Entry &entry) {
+        const Format format;
+        const nlohmann::json &json = to_json(entry, format);
+        os << json;
+
+        return os;
+    }
+
+    CompilationDatabase::CompilationDatabase(Format _format, Content _content)
+            : format(_format)
+            , content(std::move(_content))
+    { }
+
+
+    rust::Result<size_t> CompilationDatabase::to_json(const fs::path &file, const Entries &rhs) const {
+        try {
+            AtomicOutputFile target(file);
+            if (!target.is_open()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}", file.string())));
+            }
+            std::unique_ptr<CompressedArtifact> artifact;
+            if (format.compress_output) {
+                artifact = std::make_unique<CompressedArtifact>(file, target.stream());
+                if (!artifact->is_open()) {
+                    return rust::Err(std::runtime_error(
+                            fmt::format("Failed to write file: {}.zst", file.string())));
+                }
+            }
+            EntryWriter writer(format, content, artifact ? artifact->stream() : target.stream());
+            if (format.sort_entries) {
+                for (const auto *entry : sorted_index(rhs)) {
+                    writer.write(*entry);
+                }
+            } else {
+                for (const auto &entry : rhs) {
+                    writer.write(entry);
+                }
+            }
+            const auto count = writer.finish();
+            if (artifact && !artifact->publish()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}.zst", file.string())));
+            }
+            if (!target.publish()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}", file.string())));
+            }
+            write_index(file, format, content, writer.tail(), writer.digests());
+            return rust::Ok(count);
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to write file: {}, cause: {}",
+                                file.string(),
+                                error.what())));
+        }
+    }
+
+    rust::Result<size_t> CompilationDatabase::to_json(std::ostream &ostream, const Entries &entries) const {
+        try {
+            // stream the entries one by one, instead of building a single
+            // JSON document of the whole content in memory.
+            EntryWriter writer(format, content, ostream);
+            if (format.sort_entries) {
+                for (const auto *entry : sorted_index(entries)) {
+                    writer.write(*entry);
+                }
+            } else {
+                for (const auto &entry : entries) {
+                    writer.write(entry);
+                }
+            }
+            return rust::Ok(writer.finish());
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(error.what()));
+        }
+    }
+
+    rust::Result<size_t> CompilationDatabase::from_json(const fs::path &file, std::list<cs::Entry> &entries) const {
+        return from_json(file, EntryConsumer([&entries](Entry &&entry) {
+            entries.emplace_back(std::move(entry));
+        }));
+    }
+
+    rust::Result<size_t> CompilationDatabase::from_json(std::istream &istream, std::list<cs::Entry> &entries) const {
+        return from_json(istream, EntryConsumer([&entries](Entry &&entry) {
+            entries.emplace_back(std::move(entry));
+        }));
+    }
+
+    rust::Result<size_t> CompilationDatabase::from_json(const fs::path &file, const EntryConsumer &consumer) const {
+        try {
+            // a database this tool wrote itself skips the schema and
+            // UTF-8 revalidation: the append reads the previous output
+            // back on every incremental build, and revalidating our own
+            // bytes is a fixed tax on each of them. any surprise in the
+            // content falls through to the strict paths below.
+            if ((file.extension() != ".zst") && self_produced(file)) {
+                if (const MappedFile mapped(file); mapped.is_open()) {
+                    TrustedParser parser(mapped.data(), mapped.size());
+                    if (const auto count = parser.parse(consumer); count.has_value()) {
+                        return rust::Ok(count.value());
+                    }
+                    spdlog::debug("The trusted parse of {} did not apply; using the strict reader.", file.string());
+                }
+            }
+            // a large plain file is parsed on worker threads, cut on
+            // record boundaries. the compressed form stays on the
+            // streaming reader, a zstd frame does not cut.
+            if (file.extension() != ".zst") {
+                if (auto parallel = parse_batches(file); parallel.has_value()) {
+                    return std::move(parallel.value())
+                            .map<size_t>([&consumer](auto batches) {
+                                size_t total = 0;
+                                for (const auto &batch : batches) {
+                                    for (size_t row = 0; row < batch.size(); ++row) {
+                                        consumer(batch.to_entry(row));
+                                        ++total;
+                                    }
+                                }
+                                return total;
+                            })
+                            .map_err<std::runtime_error>([&file](auto error) {
+                                return std::runtime_error(
+                                        fmt::format("Failed to read file: {}, cause: {}",
+                                                    file.string(),
+                                                    error.what()));
+                            });
+                }
+            }
+            auto source = open_database(file);
+            if (source == nullptr) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to read file: {}, cause: {}",
+                                    file.string(),
+                                    "the zstd support is not built in")));
+            }
+            return from_json(*source, consumer)
+                    .map_err<std::runtime_error>([&file](auto error) {
+                        return std::runtime_error(
+                                fmt::format("Failed to read file: {}, cause: {}",
+                                            file.string(),
+                                            error.what()));
+                    });
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to read file: {}, cause: {}",
+                                file.string(),
+                                error.what())));
+        }
+    }
+
+    rust::Result<size_t> CompilationDatabase::from_json(std::istream &istream, const EntryConsumer &consumer) const {
+        try {
+            StreamingReader reader(consumer);
+            if (!nlohmann::json::sax_parse(istream, &reader)) {
+                return rust::Err(std::runtime_error("The file is not a JSON array of objects."));
+            }
+            return rust::Ok(reader.count());
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(error.what()));
+        }
+    }
+
+    uint64_t CompilationDatabase::key_of(const Entry &entry) const {
+        return key_digest(entry, content.duplicate_filter_fields);
+    }
+
+    bool CompilationDatabase::admits(const Entry &entry) const {
+        ContentFilter filter(content);
+        return filter.apply(entry);
+    }
+
+    rust::Result<std::vector<uint64_t>> CompilationDatabase::keys_of(const fs::path &file) const {
+        std::vector<uint64_t> result;
+        if (const auto index = read_index(file, format, content); index.has_value()) {
+            result.reserve(index->digests.size());
+            for (const auto &[key, _] : index->digests) {
+                result.push_back(key);
+            }
+            return rust::Ok(std::move(result));
+        }
+        // the columnar scan digests the field views of a large file in
+        // place; no entry object is built for the key computation.
+        if (file.extension() != ".zst") {
+            if (auto parallel = parse_batches(file); parallel.has_value()) {
+                return std::move(parallel.value())
+                        .map<std::vector<uint64_t>>([this, &result](auto batches) {
+                            for (const auto &batch : batches) {
+                                for (size_t row = 0; row < batch.size(); ++row) {
+                                    result.push_back(key_digest(batch.view(row), content.duplicate_filter_fields));
+                                }
+                            }
+                            return std::move(result);
+                        });
+            }
+        }
+        return from_json(file, EntryConsumer([this, &result](Entry &&entry) {
+                    result.push_back(key_of(entry));
+                }))
+                .map<std::vector<uint64_t>>([&result](auto) {
+                    return std::move(result);
+                });
+    }
+
+    rust::Result<std::vector<std::pair<uint64_t, uint64_t>>> CompilationDatabase::digests_of(const fs::path &file) const {
+        if (auto index = read_index(file, format, content); index.has_value()) {
+            return rust::Ok(std::move(index->digests));
+        }
+        std::vector<std::pair<uint64_t, uint64_t>> result;
+        // same columnar scan as keys_of: the digests come straight from
+        // the arena views of a large file.
+        if (file.extension() != ".zst") {
+            if (auto parallel = parse_batches(file); parallel.has_value()) {
+                return std::move(parallel.value())
+                        .map<std::vector<std::pair<uint64_t, uint64_t>>>([this, &result](auto batches) {
+                            for (const auto &batch : batches) {
+                                for (size_t row = 0; row < batch.size(); ++row) {
+                                    const auto view = batch.view(row);
+                                    result.emplace_back(
+                                            key_digest(view, content.duplicate_filter_fields),
+                                            content_digest(view));
+                                }
+                            }
+                            return std::move(result);
+                        });
+            }
+        }
+        return from_json(file, EntryConsumer([this, &result](Entry &&entry) {
+                    result.emplace_back(key_of(entry), content_digest(entry));
+                }))
+                .map<std::vector<std::pair<uint64_t, uint64_t>>>([&result](auto) {
+                    return std::move(result);
+                });
+    }
+
+    rust::Result<size_t> CompilationDatabase::to_json(const fs::path &file, EntrySpool &spool, const std::optional<fs::path> &append_from) const {
+        try {
+            AtomicOutputFile output(file);
+            if (!output.is_open()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}", file.string())));
+            }
+            std::unique_ptr<CompressedArtifact> artifact;
+            if (format.compress_output) {
+                artifact = std::make_unique<CompressedArtifact>(file, output.stream());
+                if (!artifact->is_open()) {
+                    return rust::Err(std::runtime_error(
+                            fmt::format("Failed to write file: {}.zst", file.string())));
+                }
+            }
+            EntryWriter writer(format, content, artifact ? artifact->stream() : output.stream());
+            const EntryConsumer write = [&writer](Entry &&entry) {
+                writer.write(entry);
+            };
+            // The new entries come first, so on a duplicate they win over
+            // the content of the previous database. (Same as the in-memory
+            // append, which puts the old entries after the new ones.)
+            auto result = spool.drain(write);
+            if (result.is_ok() && append_from.has_value()) {
+                // a large previous database is merged through the columnar
+                // batches: the filters, the digests and the serializer run
+                // on the arena views, entry objects are never built.
+                auto merged = false;
+                if (append_from.value().extension() != ".zst") {
+                    if (auto parallel = parse_batches(append_from.value()); parallel.has_value()) {
+                        result = std::move(parallel.value())
+                                .map<size_t>([&writer](auto batches) {
+                                    size_t total = 0;
+                                    for (const auto &batch : batches) {
+                                        for (size_t row = 0; row < batch.size(); ++row) {
+                                            writer.write(batch.view(row));
+                                            ++total;
+                                        }
+                                    }
+                                    return total;
+                                });
+                        merged = true;
+                    }
+                }
+                if (!merged) {
+                    result = from_json(append_from.value(), write);
+                }
+            }
+            const auto count = writer.finish();
+
+            return result
+                    .and_then<int>([&output, &artifact](const auto &) -> rust::Result<int> {
+                        if (artifact && !artifact->publish()) {
+                            return rust::Err(std::runtime_error("Failed to publish the content."));
+                        }
+                        return output.publish()
+                            ? rust::Result<int>(rust::Ok(0))
+                            : rust::Result<int>(rust::Err(std::runtime_error("Failed to publish the content.")));
+                    })
+                    .map<size_t>([&file, &writer, &count, this](auto) {
+                        write_index(file, format, content, writer.tail(), writer.digests());
+                        return count;
+                    })
+                    .map_err<std::runtime_error>([&file](auto error) {
+                        return std::runtime_error(
+                                fmt::format("Failed to write file: {}, cause: {}",
+                                            file.string(),
+                                            error.what()));
+                    });
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to write file: {}, cause: {}",
+                                file.string(),
+                                error.what())));
+        }
+    }
+
+    rust::Result<size_t> CompilationDatabase::to_json_append(const fs::path &file, const Entries &entries) const {
+        try {
+            if (format.sort_entries) {
+                return rust::Err(std::runtime_error("Sorted output has no stable append point."));
+            }
+            if (content.include_only_existing_source) {
+                return rust::Err(std::runtime_error("Existence checks need to revisit the old entries."));
+            }
+            auto index = read_index(file, format, content);
+            if (!index.has_value() || index->digests.empty()) {
+                return rust::Err(std::runtime_error("The append index is missing or stale."));
+            }
+            // filter the new entries against the index. an entry whose key
+            // is indexed with a different content replaces an old entry,
+            // which only the full merge can do.
+            std::unordered_map<uint64_t, uint64_t> seen(index->digests.begin(), index->digests.end());
+            ContentFilter content_filter(content);
+            std::vector<const Entry *> additions;
+            for (const auto &entry : entries) {
+                if (!content_filter.apply(entry)) {
+                    continue;
+                }
+                const auto key = key_digest(entry, content.duplicate_filter_fields);
+                const auto value = content_digest(entry);
+                if (const auto it = seen.find(key); it != seen.end()) {
+                    if (it->second == value) {
+                        continue;
+                    }
+                    return rust::Err(std::runtime_error("An indexed entry changed; needs a merge."));
+                }
+                seen.emplace(key, value);
+                additions.push_back(&entry);
+                index->digests.emplace_back(key, value);
+            }
+            const auto count = index->digests.size();
+            if (additions.empty()) {
+                return rust::Ok(count);
+            }
+            AtomicOutputFile target(file);
+            if (!target.is_open()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}", file.string())));
+            }
+            // copy the old entries without parsing them, up to the point
+            // where the closing bracket starts, then splice the new ones.
+            {
+                std::ifstream source(file, std::ios::binary);
+                std::vector<char> buffer(64 * 1024);
+                size_t left = index->tail;
+                while (left > 0 && source.read(buffer.data(), std::streamsize(std::min(left, buffer.size())))) {
+                    target.stream().write(buffer.data(), source.gcount());
+                    left -= size_t(source.gcount());
+                }
+                if (left > 0) {
+                    return rust::Err(std::runtime_error(
+                            fmt::format("Failed to read file: {}", file.string())));
+                }
+            }
+            EntrySerializer serializer(format);
+            for (const auto *entry : additions) {
+                target.stream() << ",\n";
+                const auto serialized = serializer.serialize(*entry);
+                target.stream().write(serialized.data(), std::streamsize(serialized.size()));
+            }
+            const auto tail = size_t(std::max<std::streamoff>(0, target.stream().tellp()));
+            target.stream() << "\n]" << std::endl;
+            if (!target.publish()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}", file.string())));
+            }
+            write_index(file, format, content, tail, index->digests);
+            // the compressed artifact cannot be spliced; refresh it with
+            // one streaming byte copy of the final content (no re-parse).
+            if (format.compress_output && !refresh_compressed(file)) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}.zst", file.string())));
+            }
+            return rust::Ok(count);
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to append file: {}, cause: {}",
+                                file.string(),
+                                error.what())));
+        }
+    }
+
+    rust::Result<size_t> CompilationDatabase::to_json_shards(const fs::path &file) const {
+        try {
+            // first pass: the common root directory of the files.
+            std::optional<fs::path> root;
+            auto scanned = from_json(file, EntryConsumer([&root](Entry &&entry) {
+                const auto directory = entry.file.parent_path();
+                root = root.has_value()
+                        ? std::make_optional(common_prefix(root.value(), directory))
+                        : std::make_optional(directory);
+            }));
+            if (scanned.is_err()) {
+                return scanned;
+            }
+            // a common root is needed to name the top level directories;
+            // the filesystem root would shard into foreign directories.
+            if (!root.has_value() || (root.value() == root.value().root_path())) {
+                return rust::Ok(size_t(0));
+            }
+            // second pass: route the entries. one writer per top level
+            // directory; entries directly under the root are only in the
+            // main database. the directory of an entry repeats a lot, so
+            // the routing decision is cached by the directory string.
+            std::map<fs::path, std::unique_ptr<ShardWriter>> shards;
+            std::map<std::string, fs::path> routes;
+            size_t count = 0;
+            auto written = from_json(file, EntryConsumer(
+                    [this, &root, &shards, &routes, &count, &file](Entry &&entry) {
+                        const auto directory = entry.file.parent_path();
+                        auto [route, inserted] = routes.emplace(directory.native(), fs::path());
+                        if (inserted) {
+                            route->second = shard_of(root.value(), directory);
+                        }
+                        if (route->second.empty()) {
+                            return;
+                        }
+                        auto shard = shards.find(route->second);
+                        if (shard == shards.end()) {
+                            shard = shards.emplace(
+                                    route->second,
+                                    std::make_unique<ShardWriter>(route->second / file.filename(), format)).first;
+                        }
+                        if (shard->second->write(entry)) {
+                            ++count;
+                        }
+                    }));
+            return written.map<size_t>([&count](auto) { return count; });
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to write shards of file: {}, cause: {}",
+                                file.string(),
+                                error.what())));
+        }
+    }
+
+    rust::Result<size_t> CompilationDatabase::to_json_delta(
+            const fs::path &delta_file,
+            const fs::path &current_file,
+            const std::optional<fs::path> &previous_file,
+            const std::vector<std::pair<uint64_t, uint64_t>> &previous_digests) const {
+        try {
+            auto current_digests = digests_of(current_file);
+            if (current_digests.is_err()) {
+                return rust::Err(current_digests.unwrap_err());
+            }
+            const std::unordered_map<uint64_t, uint64_t> previous(
+                    previous_digests.begin(), previous_digests.end());
+            const std::unordered_map<uint64_t, uint64_t> current(
+                    current_digests.unwrap().begin(), current_digests.unwrap().end());
+            // a key on both sides with a different content digest is a
+            // modified entry; the delta carries its new content.
+            std::unordered_set<uint64_t> added_keys;
+            std::unordered_set<uint64_t> modified_keys;
+            for (const auto &[key, digest] : current) {
+                if (const auto it = previous.find(key); it == previous.end()) {
+                    added_keys.insert(key);
+                } else if (it->second != digest) {
+                    modified_keys.insert(key);
+                }
+            }
+            std::unordered_set<uint64_t> removed_keys;
+            for (const auto &[key, _] : previous) {
+                if (current.count(key) == 0) {
+                    removed_keys.insert(key);
+                }
+            }
+            // only the differing entries are read back from the files.
+            Entries added;
+            Entries modified;
+            if (!added_keys.empty() || !modified_keys.empty()) {
+                auto read = from_json(current_file, EntryConsumer(
+                        [this, &added_keys, &modified_keys, &added, &modified](Entry &&entry) {
+                            const auto key = key_of(entry);
+                            if (added_keys.count(key) > 0) {
+                                added.emplace_back(std::move(entry));
+                            } else if (modified_keys.count(key) > 0) {
+                                modified.emplace_back(std::move(entry));
+                            }
+                        }));
+                if (read.is_err()) {
+                    return read;
+                }
+            }
+            Entries removed;
+            if (!removed_keys.empty() && previous_file.has_value()) {
+                auto read = from_json(previous_file.value(), EntryConsumer(
+                        [this, &removed_keys, &removed](Entry &&entry) {
+                            if (removed_keys.count(key_of(entry)) > 0) {
+                                removed.emplace_back(std::move(entry));
+                            }
+                        }));
+                if (read.is_err()) {
+                    return read;
+                }
+            }
+
+            AtomicOutputFile target(delta_file);
+            if (!target.is_open()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}", delta_file.string())));
+            }
+            nlohmann::json json;
+            json["added"] = nlohmann::json::array();
+            for (const auto &entry : added) {
+                json["added"].emplace_back(cs::to_json(entry, format));
+            }
+            json["removed"] = nlohmann::json::array();
+            for (const auto &entry : removed) {
+                json["removed"].emplace_back(cs::to_json(entry, format));
+            }
+            json["modified"] = nlohmann::json::array();
+            for (const auto &entry : modified) {
+                json["modified"].emplace_back(cs::to_json(entry, format));
+            }
+            target.stream() << json.dump(2);
+            if (!target.publish()) {
+                return rust::Err(std::runtime_error(
+                        fmt::format("Failed to write file: {}", delta_file.string())));
+            }
+            return rust::Ok(added.size() + removed.size() + modified.size());
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to write file: {}, cause: {}",
+                                delta_file.string(),
+                                error.what())));
+        }
+    }
+
+    FilteredView::FilteredView(Format format, OutputView view)
+            : format_(format)
+            , view_(std::move(view))
+            , filter_()
+            , entries_()
+    {
+        auto content_filter = std::make_shared<ContentFilter>(view_.content);
+        auto duplicate_filter = std::shared_ptr<DuplicateFilter>(DuplicateFilter::from_content(view_.content));
+        filter_ = [content_filter, duplicate_filter](const Entry &entry) {
+            return content_filter->apply(entry) && duplicate_filter->apply(entry);
+        };
+    }
+
+    void FilteredView::push(const CompilationDatabase::Entries &batch) {
+        for (const auto &entry : batch) {
+            if (filter_(entry)) {
+                entries_.push_back(entry);
+            }
+        }
+    }
+
+    const std::string &FilteredView::name() const noexcept {
+        return view_.name;
+    }
+
+    rust::Result<size_t> FilteredView::write() const {
+        const CompilationDatabase database(format_, view_.content);
+        return database.to_json(view_.file, entries_);
+    }
+
+    // The memory an entry costs in the accumulated list. An estimate: it
+    // counts the string contents and the container overheads, but not the
+    // allocator padding around them.
+    size_t footprint(const Entry &entry) noexcept {
+        size_t result = sizeof(Entry) + 2 * sizeof(void *);
+        result += entry.file.native().size();
+        result += entry.directory.native().size();
+        if (entry.output.has_value()) {
+            result += entry.output.value().native().size();
+        }
+        // a shared argument block is counted in every sibling entry; the
+        // over-estimate only makes the spool spill earlier, never later.
+        for (const auto &argument : entry.arguments) {
+            result += sizeof(std::string) + argument.size();
+        }
+        return result;
+    }
+
+    EntrySpool::EntrySpool(size_t budget, fs::path spill_file, const Content &content)
+            : budget_(budget)
+            , file_(std::move(spill_file))
+            , filter_()
+            , entries_()
+            , usage_(0)
+            , peak_(0)
+            , spilled_(0)
+    {
+        auto content_filter = std::make_shared<ContentFilter>(content);
+        auto duplicate_filter = std::shared_ptr<DuplicateFilter>(DuplicateFilter::from_content(content));
+        filter_ = [content_filter, duplicate_filter](const Entry &entry) {
+            return content_filter->apply(entry) && duplicate_filter->apply(entry);
+        };
+    }
+
+    EntrySpool::~EntrySpool() noexcept {
+        if (spilled_ > 0) {
+            std::error_code error_code;
+            fs::remove(file_, error_code);
+        }
+    }
+
+    void EntrySpool::push(CompilationDatabase::Entries &&batch) {
+        // An early exit only: the dropped entries would be dropped by the
+        // writer anyway, but this way they are not held, serialized and
+        // parsed back in between.
+        batch.remove_if([this](const auto &entry) { return !filter_(entry); });
+        for (const auto &entry : batch) {
+            usage_ += footprint(entry);
+        }
+        entries_.splice(entries_.end(), batch);
+        peak_ = std::max(peak_, usage_);
+        if ((budget_ > 0) && (usage_ > budget_)) {
+            spill();
+        }
+    }
+
+    void EntrySpool::spill() {
+        try {
+            // One JSON entry per line, appended after previous spills. The
+            // format is an implementation detail of the spool; the file is
+            // removed when the spool goes away.
+            std::ofstream target(file_, std::ios::app);
+            const Format format;
+            for (const auto &entry : entries_) {
+                target << cs::to_json(entry, format).dump() << '\n';
+            }
+            if (target) {
+                spilled_ += entries_.size();
+                entries_.clear();
+                usage_ = 0;
+            }
+        } catch (const std::exception &error) {
+            // Failing to spill is not an error: the entries stay in memory,
+            // and only the memory budget is breached.
+            spdlog::warn("Spilling entries failed: {}", error.what());
+        }
+    }
+
+    bool EntrySpool::spilled() const noexcept {
+        return spilled_ > 0;
+    }
+
+    size_t EntrySpool::peak() const noexcept {
+        return peak_;
+    }
+
+    CompilationDatabase::Entries &EntrySpool::entries() noexcept {
+        return entries_;
+    }
+
+    rust::Result<size_t> EntrySpool::drain(const CompilationDatabase::EntryConsumer &consumer) {
+        try {
+            size_t count = 0;
+            if (spilled_ > 0) {
+                std::ifstream source(file_);
+                for (std::string line; std::getline(source, line);) {
+                    Entry entry;
+                    cs::from_json(nlohmann::json::parse(line), entry);
+                    consumer(std::move(entry));
+                    ++count;
+                }
+                if (count != spilled_) {
+                    return rust::Err(std::runtime_error(
+                            fmt::format("Failed to read back the spilled entries: expected {}, got {}",
+                                        spilled_, count)));
+                }
+            }
+            for (auto &entry : entries_) {
+                consumer(std::move(entry));
+                ++count;
+            }
+            entries_.clear();
+            usage_ = 0;
+            return rust::Ok(count);
+        } catch (const std::exception &error) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to read back the spilled entries: {}", error.what())));
         }
     }
 }
@@ -22,16 +22,122 @@
 #include "Configuration.h"
 #include "libresult/Result.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <initializer_list>
 #include <iosfwd>
+#include <iterator>
 #include <list>
+#include <memory>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace cs {
 
+    // The argument list of a database entry.
+    //
+    // One command compiling several sources produces sibling entries
+    // whose argument lists are identical up to the trailing source
+    // argument. The common front block is built once and referenced by
+    // every sibling; each entry owns only its tail. This collapses the
+    // memory cost of multi source commands (a unity build repeats the
+    // same long flag list across dozens of entries) while the list
+    // still reads like one flat sequence.
+    //
+    // Mutation only touches the owned tail; assign and swap drop the
+    // shared block, so a list refilled from a parse behaves like a
+    // plain vector.
+    class ArgumentList {
+    public:
+        using Block = std::vector<std::string>;
+        using value_type = std::string;
+        using size_type = size_t;
+
+        ArgumentList() = default;
+        ArgumentList(std::initializer_list<std::string> values) : shared_(), tail_(values) {}
+        ArgumentList(Block values) : shared_(), tail_(std::move(values)) {}
+        ArgumentList(std::shared_ptr<const Block> shared, Block tail)
+                : shared_(std::move(shared))
+                , tail_(std::move(tail))
+        { }
+
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const std::string *;
+            using reference = const std::string &;
+
+            const_iterator(const ArgumentList *owner, size_t index) : owner_(owner), index_(index) {}
+
+            reference operator*() const { return (*owner_)[index_]; }
+            pointer operator->() const { return &(*owner_)[index_]; }
+            const_iterator &operator++() { ++index_; return *this; }
+            const_iterator operator++(int) { const auto copy = *this; ++index_; return copy; }
+            bool operator==(const const_iterator &rhs) const { return index_ == rhs.index_; }
+            bool operator!=(const const_iterator &rhs) const { return index_ != rhs.index_; }
+
+        private:
+            const ArgumentList *owner_;
+            size_t index_;
+        };
+
+        [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this, 0); }
+        [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this, size()); }
+        [[nodiscard]] size_t size() const noexcept { return shared_size() + tail_.size(); }
+        [[nodiscard]] bool empty() const noexcept { return (shared_size() == 0) && tail_.empty(); }
+        [[nodiscard]] const std::string &operator[](const size_t index) const noexcept {
+            return (index < shared_size()) ? (*shared_)[index] : tail_[index - shared_size()];
+        }
+
+        void push_back(std::string value) { tail_.emplace_back(std::move(value)); }
+        template <typename... Args>
+        void emplace_back(Args &&...args) { tail_.emplace_back(std::forward<Args>(args)...); }
+        template <typename Iterator>
+        void assign(Iterator first, Iterator last) {
+            shared_.reset();
+            tail_.assign(first, last);
+        }
+        void swap(Block &other) {
+            shared_.reset();
+            tail_.swap(other);
+        }
+
+        // The arguments as one contiguous block, for the consumers which
+        // need a real vector (like the shell command quoting).
+        [[nodiscard]] Block flatten() const {
+            Block result;
+            result.reserve(size());
+            if (shared_) {
+                result.insert(result.end(), shared_->begin(), shared_->end());
+            }
+            result.insert(result.end(), tail_.begin(), tail_.end());
+            return result;
+        }
+
+        bool operator==(const ArgumentList &rhs) const {
+            return (size() == rhs.size()) && std::equal(begin(), end(), rhs.begin());
+        }
+        bool operator!=(const ArgumentList &rhs) const { return !(*this == rhs); }
+        bool operator<(const ArgumentList &rhs) const {
+            return std::lexicographical_compare(begin(), end(), rhs.begin(), rhs.end());
+        }
+
+    private:
+        [[nodiscard]] size_t shared_size() const noexcept { return shared_ ? shared_->size() : 0; }
+
+    private:
+        std::shared_ptr<const Block> shared_;
+        Block tail_;
+    };
+
     // The definition of the JSON compilation database format can be
     // found here:
     //   https://clang.llvm.org/docs/JSONCompilationDatabase.html
@@ -48,7 +154,11 @@ namespace cs {
         fs::path file;
         fs::path directory;
         std::optional<fs::path> output;
-        std::list<std::string> arguments;
+        // The argument blocks are contiguous vectors (a database holds
+        // millions of these, and per argument list nodes were a large
+        // share of the memory), and sibling entries of one multi source
+        // command share their common front.
+        ArgumentList arguments;
     };
 
     // Convenient methods for these types.
@@ -65,6 +175,7 @@ namespace cs {
     // parameters. And basic content filtering is also available.
     struct CompilationDatabase {
         using Entries = std::list<Entry>;
+        using EntryConsumer = std::function<void(Entry &&)>;
 
         CompilationDatabase(Format, Content);
         virtual ~CompilationDatabase() noexcept = default;
@@ -72,12 +183,135 @@ namespace cs {
         // Serialization methods with error mapping.
         [[nodiscard]] virtual rust::Result<size_t> to_json(const fs::path& file, const Entries &entries) const;
         [[nodiscard]] virtual rust::Result<size_t> to_json(std::ostream &ostream, const Entries &entries) const;
+        // Writes the spooled entries (and after them the content of an
+        // existing database file, when given). Entries stream from the
+        // spool one by one, so the whole database is never in memory.
+        [[nodiscard]] virtual rust::Result<size_t> to_json(const fs::path& file, class EntrySpool &spool, const std::optional<fs::path> &append_from) const;
+        // Extends an existing database with the new entries, without
+        // parsing the old content: the file writers leave an index
+        // sidecar behind (the digests of the written entries and the
+        // splice offset), and the append verifies the duplicates against
+        // that. Fails when the index is missing or stale, or when an old
+        // entry would need to be replaced; the caller shall fall back to
+        // the read-merge-write path then. Returns the total entry count.
+        [[nodiscard]] virtual rust::Result<size_t> to_json_append(const fs::path& file, const Entries &entries) const;
+        // Reads the written database back and routes every entry into an
+        // additional database in the top level directory of its file
+        // (under the common root of all files). The main database stays
+        // complete; the shards let an editor parse only the subtree it
+        // opens. Returns the number of sharded entries.
+        [[nodiscard]] virtual rust::Result<size_t> to_json_shards(const fs::path& file) const;
+        // Writes the delta between two generations of the database: the
+        // entries added, modified and removed since the previous write,
+        // compared with the same digests the index sidecar persists. An
+        // entry is modified when its key stayed but its content digest
+        // changed. The digests of both generations come from their
+        // sidecars when those are fresh, so the no-change case parses
+        // nothing; only the differing entries are read back. The
+        // previous file is only consulted when entries disappeared (an
+        // append has none), and its digests shall be captured before
+        // the database is rewritten. Returns the delta entry count.
+        [[nodiscard]] virtual rust::Result<size_t> to_json_delta(
+                const fs::path& delta_file,
+                const fs::path& current_file,
+                const std::optional<fs::path>& previous_file,
+                const std::vector<std::pair<uint64_t, uint64_t>>& previous_digests) const;
 
         [[nodiscard]] virtual rust::Result<size_t> from_json(const fs::path& file, Entries &entries) const;
         [[nodiscard]] virtual rust::Result<size_t> from_json(std::istream &istream, Entries &entries) const;
+        // Streaming variants: hand over each entry as it is parsed,
+        // instead of collecting them into a list.
+        [[nodiscard]] virtual rust::Result<size_t> from_json(const fs::path& file, const EntryConsumer &consumer) const;
+        [[nodiscard]] virtual rust::Result<size_t> from_json(std::istream &istream, const EntryConsumer &consumer) const;
+
+        // The duplicate filter key digest of an entry, computed with the
+        // configured filter fields. (The same digest the index sidecar of
+        // a written database persists.)
+        [[nodiscard]] virtual uint64_t key_of(const Entry &entry) const;
+        // True when the content filter of the database admits the entry.
+        [[nodiscard]] virtual bool admits(const Entry &entry) const;
+        // The key digests of the entries of a database file, in entry
+        // order. A fresh index sidecar provides them without parsing the
+        // file; otherwise the database is streamed and the digests are
+        // recomputed from the entries.
+        [[nodiscard]] virtual rust::Result<std::vector<uint64_t>> keys_of(const fs::path& file) const;
+        // The (key, content) digest pairs of the entries of a database
+        // file, in entry order; the content digest tells the entries
+        // with the same key apart. Served from the index sidecar when
+        // it is fresh, recomputed from the streamed entries otherwise.
+        [[nodiscard]] virtual rust::Result<std::vector<std::pair<uint64_t, uint64_t>>> digests_of(const fs::path& file) const;
 
     private:
         Format format;
         Content content;
     };
+
+    // Collects one additional output view of the database.
+    //
+    // The view applies its own content and duplicate filters while the
+    // entries stream through the recognition pass, and keeps only the
+    // surviving entries; write() publishes them into the file of the
+    // view with the shared output format.
+    class FilteredView {
+    public:
+        FilteredView(Format format, OutputView view);
+
+        // Runs the filters of the view on the batch; the survivors are
+        // kept until write() publishes them.
+        void push(const CompilationDatabase::Entries &batch);
+
+        [[nodiscard]] const std::string &name() const noexcept;
+
+        // Writes the collected entries into the file of the view.
+        [[nodiscard]] rust::Result<size_t> write() const;
+
+    private:
+        Format format_;
+        OutputView view_;
+        std::function<bool(const Entry &)> filter_;
+        CompilationDatabase::Entries entries_;
+    };
+
+    // Accumulates the recognized entries within a memory budget.
+    //
+    // Below the budget the entries stay in memory, and the spool behaves
+    // like a plain list. When the estimated memory use exceeds the budget,
+    // the accumulated entries are written to the spill file and the memory
+    // is released: the run degrades to slower-but-finishing, instead of
+    // being killed by the OOM killer. (A zero budget means no limit.)
+    // The entries the output filters would drop are dropped already on
+    // the push: they never cost memory, spill serialization or a
+    // re-parse on the drain. (The writer applies the filters again when
+    // the database is written; that pass also covers the entries of an
+    // appended database.)
+    class EntrySpool {
+    public:
+        EntrySpool(size_t budget, fs::path spill_file, const Content &content);
+        ~EntrySpool() noexcept;
+
+        void push(CompilationDatabase::Entries &&batch);
+
+        // Whether the budget was hit and entries went to the spill file.
+        [[nodiscard]] bool spilled() const noexcept;
+        // The estimated peak memory use of the entries, in bytes.
+        [[nodiscard]] size_t peak() const noexcept;
+        // The in-memory entries; only meaningful when nothing was spilled.
+        [[nodiscard]] CompilationDatabase::Entries &entries() noexcept;
+
+        // Streams every accumulated entry (the spilled ones first, in the
+        // order they arrived) into the consumer.
+        [[nodiscard]] rust::Result<size_t> drain(const CompilationDatabase::EntryConsumer &consumer);
+
+    private:
+        void spill();
+
+    private:
+        size_t budget_;
+        fs::path file_;
+        std::function<bool(const Entry &)> filter_;
+        CompilationDatabase::Entries entries_;
+        size_t usage_;
+        size_t peak_;
+        size_t spilled_;
+    };
 }
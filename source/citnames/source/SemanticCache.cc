@@ -0,0 +1,171 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SemanticCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace cs {
+    nlohmann::json to_json(const Entry &rhs, const Format &format);
+    void from_json(const nlohmann::json &j, Entry &entry);
+}
+
+namespace {
+
+    constexpr int VERSION = 1;
+    // Bounds the number of cached results. An incremental build of a big
+    // project stays well under this; the bound only guards the file size
+    // against a cache shared by many different builds.
+    constexpr size_t CAPACITY = 256 * 1024;
+
+    std::string to_hex(const uint64_t value) {
+        return fmt::format("{:016x}", value);
+    }
+
+    uint64_t from_hex(const std::string &value) {
+        return strtoull(value.c_str(), nullptr, 16);
+    }
+
+    nlohmann::json entries_to_json(const cs::CompilationDatabase::Entries &entries) {
+        nlohmann::json result = nlohmann::json::array();
+        for (const auto &entry : entries) {
+            result.push_back(cs::to_json(entry, cs::Format{}));
+        }
+        return result;
+    }
+
+    cs::CompilationDatabase::Entries entries_from_json(const nlohmann::json &json) {
+        cs::CompilationDatabase::Entries result;
+        for (const auto &item : json) {
+            cs::Entry entry;
+            cs::from_json(item, entry);
+            result.emplace_back(std::move(entry));
+        }
+        return result;
+    }
+}
+
+namespace cs {
+
+    SemanticCache::SemanticCache(fs::path file, uint64_t config_digest)
+            : file_(std::move(file))
+            , config_digest_(config_digest)
+            , run_(1)
+            , hits_(0)
+            , mutex_()
+            , records_()
+    { }
+
+    void SemanticCache::load() {
+        try {
+            std::ifstream stream(file_);
+            std::string line;
+            if (!stream.is_open() || !std::getline(stream, line)) {
+                return;
+            }
+            const auto header = nlohmann::json::parse(line);
+            if ((header.value("version", 0) != VERSION)
+                    || (header.value("config", "") != to_hex(config_digest_))) {
+                // written by another version or configuration; start empty.
+                return;
+            }
+            run_ = header.value("run", uint64_t(0)) + 1;
+            while (std::getline(stream, line)) {
+                const auto json = nlohmann::json::parse(line);
+                Record record {
+                        json.value("used", uint64_t(0)),
+                        Recognition {
+                                entries_from_json(json.at("compilations")),
+                                entries_from_json(json.at("links"))
+                        }
+                };
+                records_.emplace(from_hex(json.at("key").get<std::string>()), std::move(record));
+            }
+        } catch (const std::exception &error) {
+            spdlog::debug("Loading semantic cache failed: {}", error.what());
+            records_.clear();
+            run_ = 1;
+        }
+    }
+
+    void SemanticCache::store() {
+        try {
+            // most recently used first, dropped over the capacity.
+            std::vector<std::pair<uint64_t, const Record *>> order;
+            order.reserve(records_.size());
+            for (const auto &[key, record] : records_) {
+                order.emplace_back(key, &record);
+            }
+            std::sort(order.begin(), order.end(), [](const auto &lhs, const auto &rhs) {
+                return lhs.second->last_used > rhs.second->last_used;
+            });
+            if (order.size() > CAPACITY) {
+                order.resize(CAPACITY);
+            }
+
+            std::ofstream stream(file_);
+            const nlohmann::json header = {
+                    {"version", VERSION},
+                    {"config", to_hex(config_digest_)},
+                    {"run", run_}
+            };
+            stream << header.dump() << std::endl;
+            for (const auto &[key, record] : order) {
+                const nlohmann::json json = {
+                        {"key", to_hex(key)},
+                        {"used", record->last_used},
+                        {"compilations", entries_to_json(record->result.compilations)},
+                        {"links", entries_to_json(record->result.links)}
+                };
+                stream << json.dump() << '\n';
+            }
+        } catch (const std::exception &error) {
+            // failing to write the cache is not an error, the next run
+            // just recognizes every command again.
+            spdlog::warn("Writing semantic cache failed: {}", error.what());
+        }
+    }
+
+    std::optional<Recognition> SemanticCache::lookup(const uint64_t key) {
+        const std::lock_guard<std::mutex> guard(mutex_);
+        if (auto it = records_.find(key); it != records_.end()) {
+            it->second.last_used = run_;
+            ++hits_;
+            return std::make_optional(it->second.result);
+        }
+        return std::nullopt;
+    }
+
+    void SemanticCache::remember(const uint64_t key, const Recognition &result) {
+        const std::lock_guard<std::mutex> guard(mutex_);
+        records_.insert_or_assign(key, Record { run_, result });
+    }
+
+    size_t SemanticCache::hits() const noexcept {
+        return hits_;
+    }
+}
@@ -0,0 +1,105 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Output.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace cs {
+
+    // The result of the semantic recognition of one command, routed by
+    // the destination: compiler calls produce compilation entries, the
+    // linker and archiver calls produce link entries.
+    struct Recognition {
+        CompilationDatabase::Entries compilations;
+        CompilationDatabase::Entries links;
+    };
+
+    // Incremental FNV-1a hash over strings. (The same hash function the
+    // events database uses for interning.) A zero byte is fed after each
+    // string, so the boundaries count too.
+    struct Digest {
+        uint64_t state = 0xcbf29ce484222325u;
+
+        void feed(const std::string_view value) noexcept {
+            for (const char character : value) {
+                step(uint8_t(character));
+            }
+            step(uint8_t(0));
+        }
+
+        void step(const uint8_t byte) noexcept {
+            state = (state ^ byte) * 0x100000001b3u;
+        }
+    };
+
+    // Persistent cache of recognition results, keyed by the hash of the
+    // executed command (program, arguments, working directory) and the
+    // recognition configuration.
+    //
+    // An incremental build repeats most of its commands, so a repeat run
+    // finds most results here instead of running the tool matchers. The
+    // results of not recognized commands are cached too (an empty result
+    // is a result), those are the majority of the events.
+    //
+    // The file is compacted on store: the records are kept in the order
+    // they were last used, and the least recently used ones are dropped
+    // over the capacity. Reading or writing failures are not errors, the
+    // run just proceeds without the cached results.
+    class SemanticCache {
+    public:
+        SemanticCache(fs::path file, uint64_t config_digest);
+
+        // Reads the cache file; an unreadable, corrupt or mismatching
+        // file leaves the cache empty.
+        void load();
+        // Writes the records back, most recently used first, bounded by
+        // the capacity.
+        void store();
+
+        // Returns the cached result and marks the record used.
+        [[nodiscard]] std::optional<Recognition> lookup(uint64_t key);
+        void remember(uint64_t key, const Recognition &result);
+
+        // How many lookups were answered from the cache.
+        [[nodiscard]] size_t hits() const noexcept;
+
+    private:
+        struct Record {
+            uint64_t last_used;
+            Recognition result;
+        };
+
+        fs::path file_;
+        uint64_t config_digest_;
+        uint64_t run_;
+        size_t hits_;
+        std::mutex mutex_;
+        std::unordered_map<uint64_t, Record> records_;
+    };
+}
@@ -0,0 +1,215 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Serve.h"
+#include "Configuration.h"
+#include "Output.h"
+#include "citnames/citnames-forward.h"
+#include "libsys/Errors.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+    // The index over the loaded database: source file path to entries.
+    // The entries live in the list which loaded them, and the list never
+    // changes once the index is built.
+    using EntryIndex = std::unordered_map<std::string, std::vector<const cs::Entry *>>;
+
+    // Entries may spell the source file relative to their directory;
+    // the index (and every query) uses the normalized absolute form.
+    std::string index_key(const fs::path &file, const fs::path &directory) {
+        const auto resolved = file.is_absolute() ? file : (directory / file);
+        return resolved.lexically_normal().string();
+    }
+
+    EntryIndex build_index(const cs::CompilationDatabase::Entries &entries) {
+        EntryIndex result;
+        for (const auto &entry : entries) {
+            result[index_key(entry.file, entry.directory)].push_back(&entry);
+        }
+        return result;
+    }
+
+    // The request is a single file path, up to the first newline (or
+    // the end of the stream for clients which just close after writing).
+    std::string read_request(int client) {
+        std::string result;
+        char buffer[4096];
+        for (;;) {
+            const ssize_t count = ::recv(client, buffer, sizeof(buffer), 0);
+            if (count <= 0) {
+                break;
+            }
+            result.append(buffer, size_t(count));
+            if (const auto end = result.find('\n'); end != std::string::npos) {
+                result.resize(end);
+                break;
+            }
+        }
+        if (!result.empty() && result.back() == '\r') {
+            result.pop_back();
+        }
+        return result;
+    }
+
+    void write_response(int client, const std::string &content) {
+        size_t sent = 0;
+        while (sent < content.size()) {
+            const ssize_t count = ::send(client, content.data() + sent, content.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0) {
+                break;
+            }
+            sent += size_t(count);
+        }
+    }
+
+    // The accept loop; it runs until the listener socket is shut down.
+    void serve_queries(int listener, const cs::CompilationDatabase &database, const EntryIndex &index) {
+        for (;;) {
+            int client;
+            do {
+                client = ::accept(listener, nullptr, nullptr);
+            } while ((-1 == client) && (EINTR == errno));
+            if (-1 == client) {
+                break;
+            }
+            const auto request = fs::path(read_request(client)).lexically_normal().string();
+            cs::CompilationDatabase::Entries matches;
+            if (const auto it = index.find(request); it != index.end()) {
+                for (const auto *entry : it->second) {
+                    matches.push_back(*entry);
+                }
+            }
+            // a miss answers with an empty database, which the client
+            // can tell apart from a server failure (closed connection).
+            std::ostringstream response;
+            if (database.to_json(response, matches).is_ok()) {
+                write_response(client, response.str());
+            }
+            ::close(client);
+        }
+    }
+}
+
+namespace cs {
+
+    ServeCommand::ServeCommand(fs::path input, fs::path socket) noexcept
+            : ps::Command()
+            , input_(std::move(input))
+            , socket_(std::move(socket))
+    { }
+
+    rust::Result<int> ServeCommand::execute() const
+    {
+        CompilationDatabase database(Format {}, Content {});
+        CompilationDatabase::Entries entries;
+        if (auto loaded = database.from_json(input_, entries); loaded.is_err()) {
+            return rust::Err(loaded.unwrap_err());
+        }
+        const auto index = build_index(entries);
+        spdlog::debug("compilation database loaded. [entries: {0}, files: {1}]", entries.size(), index.size());
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        const auto path = socket_.string();
+        if (path.size() >= sizeof(address.sun_path)) {
+            return rust::Err(std::runtime_error(fmt::format("The socket path is too long: {0}", path)));
+        }
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        // a socket file left behind by a crashed server would fail the
+        // bind; replace it. (A live server holds the same path, so two
+        // servers on one socket is a user error this cannot protect.)
+        std::error_code error_code;
+        if (fs::is_socket(socket_, error_code)) {
+            fs::remove(socket_, error_code);
+        }
+
+        const int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (-1 == listener) {
+            return rust::Err(std::runtime_error(fmt::format("Creating the socket failed: {0}", sys::error_string(errno))));
+        }
+        if (-1 == ::bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address))) {
+            const auto message = fmt::format("Binding the socket {0} failed: {1}", path, sys::error_string(errno));
+            ::close(listener);
+            return rust::Err(std::runtime_error(message));
+        }
+        if (-1 == ::listen(listener, 8)) {
+            const auto message = fmt::format("Listening on the socket failed: {0}", sys::error_string(errno));
+            ::close(listener);
+            return rust::Err(std::runtime_error(message));
+        }
+        spdlog::debug("Answering queries on the socket. [path: {0}]", path);
+
+        // Block the termination signals before the worker thread is
+        // created, so it inherits the mask and the sigwait below is the
+        // only place where the signals are delivered.
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigaddset(&mask, SIGHUP);
+        pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+        std::thread worker([listener, &database, &index]() {
+            serve_queries(listener, database, index);
+        });
+        int signal = 0;
+        sigwait(&mask, &signal);
+        spdlog::debug("Signal received. [{0}]", signal);
+        // the shutdown wakes the accept call of the worker.
+        ::shutdown(listener, SHUT_RDWR);
+        worker.join();
+        ::close(listener);
+        fs::remove(socket_, error_code);
+        return rust::Ok(EXIT_SUCCESS);
+    }
+
+    Serve::Serve(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("serve", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Serve::command(const flags::Arguments &args, const char **) const {
+        const auto input = args.as_string(cmd::serve::FLAG_INPUT)
+                .map<fs::path>([](auto value) { return fs::path(value); });
+        const auto socket = args.as_string(cmd::serve::FLAG_SOCKET)
+                .map<fs::path>([](auto value) { return fs::path(value); });
+
+        return rust::merge(input, socket)
+                .map<ps::CommandPtr>([](auto tuple) {
+                    const auto&[input, socket] = tuple;
+                    return std::make_unique<ServeCommand>(input, socket);
+                });
+    }
+}
@@ -0,0 +1,53 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libmain/SubcommandFromArgs.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace cs {
+
+    // Answers per file lookups against a compilation database over a
+    // unix socket. The database is loaded once into a hash index keyed
+    // by the source file path, so a query costs a single lookup instead
+    // of a scan over the JSON file - and every editor session on the
+    // host shares the one resident copy. The protocol is plain text:
+    // the client sends one file path terminated by a newline, the
+    // server answers with the matching entries as a JSON compilation
+    // database and closes the connection. The server runs until a
+    // termination signal arrives.
+    struct ServeCommand : ps::Command {
+
+        ServeCommand(fs::path input, fs::path socket) noexcept;
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(ServeCommand)
+        NON_COPYABLE_NOR_MOVABLE(ServeCommand)
+
+    private:
+        fs::path input_;
+        fs::path socket_;
+    };
+}
@@ -0,0 +1,170 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "Verify.h"
+#include "Citnames.h"
+#include "Output.h"
+#include "semantic/Build.h"
+#include "semantic/Tool.h"
+#include "collect/db/EventsDatabaseReader.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+namespace db = ic::collect::db;
+
+namespace {
+
+    bool is_exists(const fs::path &path) {
+        std::error_code error_code;
+        return fs::exists(path, error_code);
+    }
+
+    // The compilation entries the recognition finds in the event. The
+    // link commands land in a separate database, so the check skips
+    // them. (Link is a compiler call too, hence it is tested first.)
+    cs::CompilationDatabase::Entries recognize(const cs::semantic::Build &build, rpc::Event &&event) {
+        return build.recognize(std::move(event))
+                .map<cs::CompilationDatabase::Entries>([](const auto &semantic) -> cs::CompilationDatabase::Entries {
+                    if (dynamic_cast<const cs::semantic::Link *>(semantic.get()) != nullptr) {
+                        return {};
+                    }
+                    if (const auto compiler = dynamic_cast<const cs::semantic::CompilerCall *>(semantic.get()); compiler != nullptr) {
+                        return compiler->into_entries();
+                    }
+                    return {};
+                })
+                .unwrap_or(cs::CompilationDatabase::Entries());
+    }
+}
+
+namespace cs {
+
+    rust::Result<int> VerifyCommand::execute() const {
+        const CompilationDatabase database(configuration_.output.format, configuration_.output.content);
+
+        auto keys = database.keys_of(output_);
+        auto events = db::EventsDatabaseReader::from(input_);
+
+        return rust::merge(keys, events)
+                .and_then<int>([this, &database](const auto &tuple) -> rust::Result<int> {
+                    const auto &[keys, events] = tuple;
+                    const std::unordered_set<uint64_t> present(keys.begin(), keys.end());
+
+                    const semantic::Build build(configuration_.compilation);
+                    size_t commands = 0;
+                    size_t recognized = 0;
+                    std::unordered_set<uint64_t> expected;
+                    // the first entry of every missing key, for the report.
+                    std::map<uint64_t, Entry> missing;
+                    for (auto event = events->next(); event.has_value(); event = events->next()) {
+                        if (event->is_err()) {
+                            return rust::Err(std::runtime_error(fmt::format(
+                                    "Reading events failed: {}", event->unwrap_err().what())));
+                        }
+                        const auto current = event->unwrap();
+                        if (!current->has_started()) {
+                            continue;
+                        }
+                        ++commands;
+                        for (auto &entry : recognize(build, std::move(*current))) {
+                            if (!database.admits(entry)) {
+                                continue;
+                            }
+                            ++recognized;
+                            const auto key = database.key_of(entry);
+                            expected.insert(key);
+                            if ((present.count(key) == 0) && (missing.count(key) == 0)) {
+                                missing.emplace(key, std::move(entry));
+                            }
+                        }
+                    }
+                    size_t matched = 0;
+                    for (const auto key : expected) {
+                        matched += (present.count(key) != 0) ? 1 : 0;
+                    }
+
+                    fmt::print("commands:   {} (recognized {} compilations, {} distinct)\n",
+                               commands, recognized, expected.size());
+                    fmt::print("entries:    {}\n", present.size());
+                    for (const auto &[key, entry] : missing) {
+                        fmt::print("missing:    {}\n", entry.file.string());
+                    }
+                    fmt::print("missing:    {}\n", missing.size());
+                    // extra entries are not a failure: appended runs and the
+                    // views of other event files leave legitimate ones behind.
+                    fmt::print("extra:      {}\n", present.size() - matched);
+                    return rust::Ok(missing.empty() ? EXIT_SUCCESS : EXIT_FAILURE);
+                });
+    }
+
+    VerifyCommand::VerifyCommand(cs::Configuration configuration, fs::path input, fs::path output) noexcept
+            : ps::Command()
+            , configuration_(std::move(configuration))
+            , input_(std::move(input))
+            , output_(std::move(output))
+    { }
+
+    Verify::Verify(const ps::ApplicationLogConfig &log_config) noexcept
+            : ps::SubcommandFromArgs("verify", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Verify::command(const flags::Arguments &args, const char **envp) const {
+        const auto environment = sys::env::from(const_cast<const char **>(envp));
+        const auto config_file = args.as_string(cmd::verify::FLAG_CONFIG)
+                .map<std::optional<fs::path>>([](auto candidate) { return std::make_optional(fs::path(candidate)); })
+                .unwrap_or(std::nullopt);
+
+        auto configuration = load_configuration(config_file, environment);
+        auto input = args.as_string(cmd::verify::FLAG_INPUT)
+                .and_then<fs::path>([](auto value) -> rust::Result<fs::path> {
+                    if (!is_exists(value)) {
+                        return rust::Err(std::runtime_error(
+                                fmt::format("Missing input file: {}", value)));
+                    }
+                    return rust::Ok(fs::path(value));
+                });
+        auto output = args.as_string(cmd::verify::FLAG_OUTPUT)
+                .and_then<fs::path>([](auto value) -> rust::Result<fs::path> {
+                    if (!is_exists(value)) {
+                        return rust::Err(std::runtime_error(
+                                fmt::format("Missing output file: {}", value)));
+                    }
+                    return rust::Ok(fs::path(value));
+                });
+
+        return rust::merge(configuration, input, output)
+                .map<ps::CommandPtr>([](auto tuple) {
+                    auto &[configuration, input, output] = tuple;
+                    return std::make_unique<VerifyCommand>(
+                            std::move(configuration), std::move(input), std::move(output));
+                });
+    }
+}
@@ -0,0 +1,52 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "Configuration.h"
+#include "libmain/SubcommandFromArgs.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace cs {
+
+    // Checks that a compilation database is consistent with an events
+    // database: every compilation the semantic recognition finds in the
+    // events has its entry in the output. The check compares the duplicate
+    // filter key digests (which the index sidecar of the database serves
+    // without parsing it), so it streams both files once - much cheaper
+    // than re-running citnames and diffing the results.
+    struct VerifyCommand : ps::Command {
+
+        VerifyCommand(cs::Configuration configuration, fs::path input, fs::path output) noexcept;
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(VerifyCommand)
+        NON_COPYABLE_NOR_MOVABLE(VerifyCommand)
+
+    private:
+        cs::Configuration configuration_;
+        fs::path input_;
+        fs::path output_;
+    };
+}
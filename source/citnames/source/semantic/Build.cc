@@ -22,6 +22,8 @@
 #include "ToolGcc.h"
 #include "ToolClang.h"
 #include "ToolCuda.h"
+#include "ToolLd.h"
+#include "ToolAr.h"
 #include "ToolWrapper.h"
 #include "ToolExtendingWrapper.h"
 #include "Convert.h"
@@ -38,12 +40,14 @@ template <> struct fmt::formatter<domain::Execution> : ostream_formatter {};
 
 namespace {
 
-    std::shared_ptr<cs::semantic::Tool> from(cs::Compilation cfg) {
+    std::shared_ptr<cs::semantic::ToolAny> from(cs::Compilation cfg) {
         cs::semantic::ToolAny::ToolPtrs tools = {
                 std::make_shared<cs::semantic::ToolGcc>(),
                 std::make_shared<cs::semantic::ToolClang>(),
                 std::make_shared<cs::semantic::ToolWrapper>(),
                 std::make_shared<cs::semantic::ToolCuda>(),
+                std::make_shared<cs::semantic::ToolLd>(),
+                std::make_shared<cs::semantic::ToolAr>(),
         };
         for (auto && compiler : cfg.compilers_to_recognize) {
             tools.emplace_front(std::make_shared<cs::semantic::ToolExtendingWrapper>(std::move(compiler)));
@@ -58,13 +62,26 @@ namespace {
 namespace cs::semantic {
 
     Build::Build(Compilation cfg) noexcept
-            : tools_(from(std::move(cfg)))
+            : translator_(std::make_shared<PathTranslator>(cfg.path_mappings))
+            , tools_(from(std::move(cfg)))
     { }
 
     [[nodiscard]]
-    rust::Result<SemanticPtr> Build::recognize(const rpc::Event &event) const {
+    rust::Result<SemanticPtr> Build::recognize(rpc::Event &&event) const {
         if (event.has_started()) {
-            auto execution = domain::from(event.started().execution());
+            // The container side paths of a mapped build shall become host
+            // paths before the tool matchers see them, so the compiler
+            // detection and the written entries work against the host
+            // filesystem.
+            if (!translator_->empty()) {
+                auto *mapped = event.mutable_started()->mutable_execution();
+                translator_->translate(*mapped->mutable_executable());
+                translator_->translate(*mapped->mutable_working_dir());
+                for (auto &argument : *mapped->mutable_arguments()) {
+                    translator_->translate(argument);
+                }
+            }
+            auto execution = domain::from(std::move(*event.mutable_started()->mutable_execution()));
             auto pid = event.started().pid();
 
             spdlog::debug("[pid: {}] execution: {}", pid, execution);
@@ -82,4 +99,8 @@ namespace cs::semantic {
             return rust::Err(std::runtime_error("n/a"));
         }
     }
+
+    std::list<ToolMetrics> Build::metrics() const {
+        return tools_->metrics();
+    }
 }
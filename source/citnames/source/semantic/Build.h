@@ -21,7 +21,8 @@
 
 #include "config.h"
 #include "Configuration.h"
-#include "semantic/Tool.h"
+#include "semantic/PathTranslator.h"
+#include "semantic/ToolAny.h"
 #include "intercept.grpc.pb.h"
 
 #include <memory>
@@ -35,13 +36,22 @@ namespace cs::semantic {
     public:
         explicit Build(Compilation cfg) noexcept;
 
+        // Takes the event by value; the execution strings are moved out of
+        // it instead of copied, so the caller shall not use it afterwards.
         [[nodiscard]]
-        rust::Result<SemanticPtr> recognize(const rpc::Event &event) const;
+        rust::Result<SemanticPtr> recognize(rpc::Event &&event) const;
+
+        // The recognition effort spent in each tool matcher so far.
+        [[nodiscard]]
+        std::list<ToolMetrics> metrics() const;
 
         NON_DEFAULT_CONSTRUCTABLE(Build)
         NON_COPYABLE_NOR_MOVABLE(Build)
 
     private:
-        std::shared_ptr<Tool> tools_;
+        // Declared before the tools: it is created from the configuration
+        // before the tools consume it.
+        std::shared_ptr<PathTranslator> translator_;
+        std::shared_ptr<ToolAny> tools_;
     };
 }
@@ -19,298 +19,265 @@
 
 #include "Parsers.h"
 
-#include <set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-namespace {
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <system_error>
 
-    std::string_view take_extension(const std::string_view &file) {
-        const auto pos = file.rfind('.');
-        return (pos == std::string::npos) ? file : file.substr(pos);
-    }
+namespace cs::semantic {
 
-    std::optional<std::string_view> split_extra(const std::string_view &prefix, const std::string_view &candidate) {
-        if (prefix.empty()) {
-            return std::make_optional(candidate);
-        }
-        if (candidate.empty()) {
-            return std::nullopt;
+    FlagsByName::FlagsByName(std::initializer_list<value_type> entries)
+            : entries_(entries)
+            , trie_(1)
+            , base_(nullptr)
+    {
+        std::sort(entries_.begin(), entries_.end(),
+                  [](const value_type &lhs, const value_type &rhs) { return lhs.first < rhs.first; });
+        for (uint32_t entry = 0; entry < entries_.size(); ++entry) {
+            insert_into_trie(entry);
         }
-        if (prefix.size() > candidate.size()) {
-            return std::nullopt;
-        }
-        const auto common = candidate.substr(0, prefix.size());
-        if (common == prefix) {
-            return std::make_optional(candidate.substr(prefix.size()));
-        }
-        return std::nullopt;
     }
 
-    enum class FlagMatch {
-        SEP,
-        GLUED,
-        GLUED_WITH_EQ,
-    };
-
-    FlagMatch classify_flag_matching(const std::string_view &flag) {
-        if (flag.empty()) {
-            return FlagMatch::SEP;
-        } else {
-            if (flag[0] == '=') {
-                return FlagMatch::GLUED_WITH_EQ;
-            } else {
-                return FlagMatch::GLUED;
+    FlagsByName::FlagsByName(const FlagsByName &base, const FlagsByName &extra)
+            : entries_()
+            , trie_(1)
+            , base_(&base)
+    {
+        // only the real additions are kept; dropping the duplicates here
+        // lets the lookup check the overlay first and still give the
+        // base entries their precedence.
+        entries_.reserve(extra.entries_.size());
+        for (const auto &entry : extra.entries_) {
+            if (base.find(entry.first) == nullptr) {
+                entries_.push_back(entry);
             }
         }
-    }
-
-    using namespace cs::semantic;
-
-    bool is_exact_match_only(const MatchInstruction match_instruction) {
-        switch (match_instruction) {
-            case MatchInstruction::EXACTLY:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
-            case MatchInstruction::EXACTLY_WITH_2_OPTS:
-            case MatchInstruction::EXACTLY_WITH_3_OPTS:
-                return true;
-            default:
-                return false;
+        std::sort(entries_.begin(), entries_.end(),
+                  [](const value_type &lhs, const value_type &rhs) { return lhs.first < rhs.first; });
+        for (uint32_t entry = 0; entry < entries_.size(); ++entry) {
+            insert_into_trie(entry);
         }
     }
 
-    bool is_prefix_match(const MatchInstruction match_instruction) {
-        switch (match_instruction) {
-            case MatchInstruction::PREFIX:
-            case MatchInstruction::PREFIX_WITH_1_OPT:
-            case MatchInstruction::PREFIX_WITH_2_OPTS:
-            case MatchInstruction::PREFIX_WITH_3_OPTS:
-                return true;
-            default:
-                return false;
+    void FlagsByName::insert_into_trie(const uint32_t entry) {
+        uint32_t node = 0;
+        for (const char step : entries_[entry].first) {
+            auto &children = trie_[node].children;
+            const auto child = std::lower_bound(
+                    children.begin(), children.end(), step,
+                    [](const auto &lhs, const char rhs) { return lhs.first < rhs; });
+            if ((child != children.end()) && (child->first == step)) {
+                node = child->second;
+            } else {
+                const auto created = static_cast<uint32_t>(trie_.size());
+                children.insert(child, std::make_pair(step, created));
+                // this may move the nodes, the children reference dies here.
+                trie_.emplace_back();
+                node = created;
+            }
         }
+        trie_[node].entry = static_cast<int32_t>(entry);
     }
 
-    bool is_glue_allowed(const MatchInstruction match_instruction) {
-        switch (match_instruction) {
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
-            case MatchInstruction::PREFIX:
-            case MatchInstruction::PREFIX_WITH_1_OPT:
-            case MatchInstruction::PREFIX_WITH_2_OPTS:
-            case MatchInstruction::PREFIX_WITH_3_OPTS:
-                return true;
-            default:
-                return false;
+    const FlagsByName::value_type *FlagsByName::find(const std::string_view &key) const {
+        const auto candidate = std::lower_bound(
+                entries_.begin(), entries_.end(), key,
+                [](const value_type &entry, const std::string_view &value) { return entry.first < value; });
+        if ((candidate != entries_.end()) && (candidate->first == key)) {
+            return &(*candidate);
         }
+        return (base_ != nullptr) ? base_->find(key) : nullptr;
     }
 
-    bool is_glue_with_equal_allowed(const MatchInstruction match_instruction) {
-        switch (match_instruction) {
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
-                return true;
-            default:
-                return false;
+    const FlagsByName::value_type *FlagsByName::find_longest_prefix(const std::string_view &key) const {
+        // a single walk over the key visits every stored prefix of it;
+        // the last terminal node passed marks the longest one.
+        const value_type *result = nullptr;
+        uint32_t node = 0;
+        for (const char step : key) {
+            const auto &children = trie_[node].children;
+            const auto child = std::lower_bound(
+                    children.begin(), children.end(), step,
+                    [](const auto &lhs, const char rhs) { return lhs.first < rhs; });
+            if ((child == children.end()) || (child->first != step)) {
+                break;
+            }
+            node = child->second;
+            if (trie_[node].entry >= 0) {
+                result = &entries_[trie_[node].entry];
+            }
         }
-    }
-
-    [[nodiscard]] size_t count_of_arguments(MatchInstruction match_instruction) {
-        switch (match_instruction) {
-            case MatchInstruction::EXACTLY:
-                return 1;
-            case MatchInstruction::EXACTLY_WITH_1_OPT_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP:
-            case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
-                return 2;
-            case MatchInstruction::EXACTLY_WITH_2_OPTS:
-                return 3;
-            case MatchInstruction::EXACTLY_WITH_3_OPTS:
-                return 4;
-            case MatchInstruction::PREFIX:
-                return 1;
-            case MatchInstruction::PREFIX_WITH_1_OPT:
-                return 2;
-            case MatchInstruction::PREFIX_WITH_2_OPTS:
-                return 3;
-            case MatchInstruction::PREFIX_WITH_3_OPTS:
-                return 4;
+        // the layers resolve by length; the overlay holds no duplicate
+        // of a base name, so equal lengths can not compete.
+        if (base_ != nullptr) {
+            const auto *from_base = base_->find_longest_prefix(key);
+            if ((from_base != nullptr) &&
+                ((result == nullptr) || (from_base->first.size() > result->first.size()))) {
+                return from_base;
+            }
         }
-        return 0;
+        return result;
     }
-}
-
-namespace cs::semantic {
 
-    std::tuple<ArgumentsView, ArgumentsView> ArgumentsView::take(const size_t count) const {
-        const size_t size = std::distance(begin_, end_);
-        if (size < count) {
-            auto arguments = ArgumentsView(begin_, begin_);
-            auto remainder = ArgumentsView(end_, end_);
-            return std::make_tuple(arguments, remainder);
-        } else {
-            const auto end = std::next(begin_, count);
-            auto arguments = ArgumentsView(begin_, end);
-            auto remainder = ArgumentsView(end, end_);
-            return std::make_tuple(arguments, remainder);
-        }
-    }
+    // The matchers and the argument view helpers live in the header:
+    // they are the per argument inner loop of the recognition, and the
+    // inline bodies let the composed tool parsers fold into a single
+    // classification function. This file keeps the flag table, which is
+    // built once and only probed from that loop.
+}
 
-    Arguments::value_type ArgumentsView::front() const {
-        return *begin_;
-    }
+namespace {
 
-    Arguments::value_type ArgumentsView::back() const {
-        return *std::prev(end_);
-    }
+    using namespace cs::semantic;
 
-    rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> FlagParser::parse(const ArgumentsView &input) const {
-        // early exit if there is nothing to do.
-        if (input.empty()) {
-            return rust::Err(input);
-        }
-        // early exit if the flag is an empty string.
-        const auto key = input.front();
-        if (key.empty()) {
-            return rust::Err(input);
-        }
-        // based on the lookup result, consume the input.
-        if (auto match = lookup(key); match) {
-            const auto&[count, type] = match.value();
-            const auto&[arguments, remainder] = input.take(count);
-            if (arguments.empty()) {
-                return rust::Err(input);
+    // Splits the content of a response file into options, following the
+    // compiler rules: the options are separated by whitespace; single or
+    // double quotes keep whitespace inside an option; a backslash makes
+    // the next character literal (also inside quotes).
+    std::shared_ptr<const Arguments> tokenize_response_file(const char *it, const char *const end) {
+        auto result = std::make_shared<Arguments>();
+        std::string current;
+        bool in_token = false;
+        char quote = char(0);
+        while (it != end) {
+            const char character = *it++;
+            if (character == '\\') {
+                if (it != end) {
+                    current.push_back(*it++);
+                    in_token = true;
+                }
+                continue;
             }
-            auto flag = CompilerFlag { arguments, type };
-            return rust::Ok(std::make_pair(flag, remainder));
-        }
-        return rust::Err(input);
-    }
-
-    std::optional<FlagParser::Match> FlagParser::lookup(const std::string_view &key) const {
-        // try to find if the key has an associated instruction
-        if (const auto candidate = flags_.lower_bound(key); flags_.end() != candidate) {
-            // exact matches are preferred in all cases.
-            if (auto result = check_equal(key, *candidate); result) {
-                return result;
+            if (quote != char(0)) {
+                if (character == quote) {
+                    quote = char(0);
+                } else {
+                    current.push_back(character);
+                }
+                continue;
             }
-        }
-
-        std::optional<std::string> candidate_longest = std::nullopt;
-        for (const auto &[candidate, info] : flags_) {
-            if (const auto& extra = split_extra(candidate, key); extra) {
-                const size_t prefix_length = key.size() - extra.value().size();
-                if (!candidate_longest || (prefix_length > candidate_longest.value().size())) {
-                    candidate_longest = std::make_optional(std::string(candidate));
+            if ((character == '\'') || (character == '"')) {
+                quote = character;
+                in_token = true;
+                continue;
+            }
+            if (std::isspace(static_cast<unsigned char>(character))) {
+                if (in_token) {
+                    result->emplace_back(std::move(current));
+                    current.clear();
+                    in_token = false;
                 }
+                continue;
             }
+            current.push_back(character);
+            in_token = true;
         }
-
-        return (candidate_longest.has_value())
-            ? check_partial(key, *(flags_.find(candidate_longest.value())))
-            : std::nullopt;
-    }
-
-    std::optional<FlagParser::Match>
-    FlagParser::check_equal(const std::string_view &key, const FlagsByName::value_type &candidate) {
-        const auto &flag_definition = candidate.second;
-        if ((is_exact_match_only(flag_definition.match) || is_prefix_match(flag_definition.match)) && key == candidate.first) {
-            const size_t count = count_of_arguments(flag_definition.match);
-            return std::make_optional(std::make_tuple(count, flag_definition.type));
+        if (in_token) {
+            result->emplace_back(std::move(current));
         }
-        return std::nullopt;
+        return result;
     }
 
-    std::optional<FlagParser::Match>
-    FlagParser::check_partial(const std::string_view &key, const FlagsByName::value_type &candidate) {
-        const auto &flag_definition = candidate.second;
-        const auto flag_matching = classify_flag_matching(key.substr(candidate.first.size()));
-        switch (flag_matching) {
-            case FlagMatch::GLUED:
-                if (is_glue_allowed(flag_definition.match)) {
-                    const size_t decrease = is_prefix_match(flag_definition.match) ? 0 : 1;
-                    const size_t count = count_of_arguments(flag_definition.match) - decrease;
-                    return std::make_optional(std::make_tuple(count, flag_definition.type));
-                }
-                break;
-            case FlagMatch::GLUED_WITH_EQ:
-                if (is_glue_with_equal_allowed(flag_definition.match)) {
-                    const size_t count = count_of_arguments(flag_definition.match) - 1;
-                    return std::make_optional(std::make_tuple(count, flag_definition.type));
-                }
-                break;
-            default:
-                // This should not happen here. Exact match is already filtered out.
-                __builtin_unreachable();
+    // Reads and tokenizes a response file through a memory mapping, so
+    // the content is not copied before the tokens are cut out of it.
+    // Returns null when the file cannot be read.
+    std::shared_ptr<const Arguments> read_response_file(const fs::path &file) {
+        const int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd == -1) {
+            return nullptr;
+        }
+        struct stat status = {};
+        if (::fstat(fd, &status) == -1) {
+            ::close(fd);
+            return nullptr;
+        }
+        if (status.st_size == 0) {
+            ::close(fd);
+            return std::make_shared<Arguments>();
+        }
+        void *const address = ::mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            return nullptr;
         }
-        return std::nullopt;
+        const char *const begin = static_cast<const char *>(address);
+        auto result = tokenize_response_file(begin, begin + status.st_size);
+        ::munmap(address, size_t(status.st_size));
+        return result;
     }
 
-    rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> SourceMatcher::parse(const ArgumentsView &input) {
-        static const std::set<std::string_view> extensions = {
-                // header files
-                ".h", ".hh", ".H", ".hp", ".hxx", ".hpp", ".HPP", ".h++", ".tcc",
-                // C
-                ".c", ".C",
-                // C++
-                ".cc", ".CC", ".c++", ".C++", ".cxx", ".cpp", ".cp",
-                // CUDA
-                ".cu",
-                // ObjectiveC
-                ".m", ".mi", ".mm", ".M", ".mii",
-                // Preprocessed
-                ".i", ".ii",
-                // Assembly
-                ".s", ".S", ".sx", ".asm",
-                // Fortran
-                ".f", ".for", ".ftn",
-                ".F", ".FOR", ".fpp", ".FPP", ".FTN",
-                ".f90", ".f95", ".f03", ".f08",
-                ".F90", ".F95", ".F03", ".F08",
-                // go
-                ".go",
-                // brig
-                ".brig",
-                // D
-                ".d", ".di", ".dd",
-                // Ada
-                ".ads", ".abd"
+    // The tokens of an already read response file. The modification time
+    // detects a file which changed since (should not happen during a run,
+    // but a stale entry would silently corrupt the output).
+    std::shared_ptr<const Arguments> cached_response_file(const fs::path &file) {
+        struct Entry {
+            fs::file_time_type mtime;
+            std::shared_ptr<const Arguments> tokens;
         };
+        static std::mutex mutex;
+        static std::map<std::string, Entry> cache;
 
-        if (input.empty()) {
-            return rust::Err(input);
+        std::error_code error_code;
+        const auto mtime = fs::last_write_time(file, error_code);
+        if (error_code) {
+            return nullptr;
         }
-        const auto &candidate = input.front();
-        const auto &extension = take_extension(candidate);
-        if (extensions.find(extension) != extensions.end()) {
-            const auto &[arguments, remainder] = input.take(1);
-            if (arguments.empty()) {
-                return rust::Err(input);
+        {
+            const std::lock_guard<std::mutex> guard(mutex);
+            if (const auto it = cache.find(file.native()); (it != cache.end()) && (it->second.mtime == mtime)) {
+                return it->second.tokens;
             }
-            auto flag = CompilerFlag { arguments, CompilerFlagType::SOURCE };
-            return rust::Ok(std::make_pair(flag, remainder));
         }
-        return rust::Err(input);
+        auto tokens = read_response_file(file);
+        if (tokens != nullptr) {
+            const std::lock_guard<std::mutex> guard(mutex);
+            cache[file.native()] = Entry { mtime, tokens };
+        }
+        return tokens;
     }
 
-    rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> EverythingElseFlagMatcher::parse(const ArgumentsView &input) {
-        if (input.empty()) {
-            return rust::Err(input);
+    // A response file may reference further response files; the depth
+    // limit breaks reference cycles.
+    constexpr size_t RESPONSE_FILE_DEPTH = 16;
+
+    void expand_into(Arguments &output, const std::string &argument, const fs::path &working_dir, const size_t depth) {
+        if ((depth == 0) || (argument.size() < 2) || (argument.front() != '@')) {
+            output.push_back(argument);
+            return;
         }
-        if (const auto &front = input.front(); !front.empty()) {
-            const auto &[arguments, remainder] = input.take(1);
-            if (arguments.empty()) {
-                return rust::Err(input);
-            }
-            auto flag = CompilerFlag { arguments, CompilerFlagType::LINKER_OBJECT_FILE };
-            return rust::Ok(std::make_pair(flag, remainder));
+        const fs::path reference(argument.substr(1));
+        const auto tokens = cached_response_file(
+                reference.is_absolute() ? reference : working_dir / reference);
+        if (tokens == nullptr) {
+            output.push_back(argument);
+            return;
+        }
+        for (const auto &token : *tokens) {
+            expand_into(output, token, working_dir, depth - 1);
+        }
+    }
+}
+
+namespace cs::semantic {
+
+    Arguments expand_response_files(const Arguments &arguments, const fs::path &working_dir) {
+        const bool has_reference = std::any_of(arguments.begin(), arguments.end(),
+                [](const auto &argument) { return (argument.size() > 1) && (argument.front() == '@'); });
+        if (!has_reference) {
+            return arguments;
+        }
+        Arguments result;
+        result.reserve(arguments.size());
+        for (const auto &argument : arguments) {
+            expand_into(result, argument, working_dir, RESPONSE_FILE_DEPTH);
         }
-        return rust::Err(input);
+        return result;
     }
 }
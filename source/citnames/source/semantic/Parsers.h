@@ -24,10 +24,13 @@
 
 #include <cstdint>
 #include <list>
-#include <map>
 #include <optional>
 #include <string>
-#include <optional>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <fmt/format.h>
 
@@ -36,7 +39,10 @@ namespace cs::semantic {
     using namespace domain;
 
     // Represents command line arguments.
-    using Arguments = std::list<std::string>;
+    //
+    // A contiguous vector, so the parsers walk the arguments without
+    // chasing list nodes, and a view of it is just an iterator pair.
+    using Arguments = std::vector<std::string>;
 
     // Represents a segment of command line arguments.
     struct ArgumentsView {
@@ -62,10 +68,31 @@ namespace cs::semantic {
             return end_;
         }
 
-        [[nodiscard]] Arguments::value_type front() const;
-        [[nodiscard]] Arguments::value_type back() const;
+        // These run once or more per argument of every command; inline
+        // definitions keep them out of the call overhead of the
+        // recognition loop, and the references spare a string copy (and
+        // its allocation) per probe.
+        [[nodiscard]] const Arguments::value_type &front() const {
+            return *begin_;
+        }
 
-        [[nodiscard]] std::tuple<ArgumentsView, ArgumentsView> take(size_t count) const;
+        [[nodiscard]] const Arguments::value_type &back() const {
+            return *std::prev(end_);
+        }
+
+        [[nodiscard]] std::tuple<ArgumentsView, ArgumentsView> take(const size_t count) const {
+            const size_t size = std::distance(begin_, end_);
+            if (size < count) {
+                auto arguments = ArgumentsView(begin_, begin_);
+                auto remainder = ArgumentsView(end_, end_);
+                return std::make_tuple(arguments, remainder);
+            } else {
+                const auto end = std::next(begin_, count);
+                auto arguments = ArgumentsView(begin_, end);
+                auto remainder = ArgumentsView(end, end_);
+                return std::make_tuple(arguments, remainder);
+            }
+        }
 
     private:
         Arguments::const_iterator begin_;
@@ -142,7 +169,163 @@ namespace cs::semantic {
         CompilerFlagType type;
     };
 
-    using FlagsByName = std::map<std::string_view, FlagDefinition>;
+    // The classification of a match instruction, evaluated for every
+    // argument of every command. Constexpr switches in the header, so
+    // they fold into the inlined matcher bodies below instead of being
+    // calls into another translation unit.
+    namespace detail {
+
+        constexpr bool is_exact_match_only(const MatchInstruction match_instruction) {
+            switch (match_instruction) {
+                case MatchInstruction::EXACTLY:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
+                case MatchInstruction::EXACTLY_WITH_2_OPTS:
+                case MatchInstruction::EXACTLY_WITH_3_OPTS:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        constexpr bool is_prefix_match(const MatchInstruction match_instruction) {
+            switch (match_instruction) {
+                case MatchInstruction::PREFIX:
+                case MatchInstruction::PREFIX_WITH_1_OPT:
+                case MatchInstruction::PREFIX_WITH_2_OPTS:
+                case MatchInstruction::PREFIX_WITH_3_OPTS:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        constexpr bool is_glue_allowed(const MatchInstruction match_instruction) {
+            switch (match_instruction) {
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
+                case MatchInstruction::PREFIX:
+                case MatchInstruction::PREFIX_WITH_1_OPT:
+                case MatchInstruction::PREFIX_WITH_2_OPTS:
+                case MatchInstruction::PREFIX_WITH_3_OPTS:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        constexpr bool is_glue_with_equal_allowed(const MatchInstruction match_instruction) {
+            switch (match_instruction) {
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        constexpr size_t count_of_arguments(const MatchInstruction match_instruction) {
+            switch (match_instruction) {
+                case MatchInstruction::EXACTLY:
+                    return 1;
+                case MatchInstruction::EXACTLY_WITH_1_OPT_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP:
+                case MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_OR_WITHOUT_EQ_OR_SEP:
+                    return 2;
+                case MatchInstruction::EXACTLY_WITH_2_OPTS:
+                    return 3;
+                case MatchInstruction::EXACTLY_WITH_3_OPTS:
+                    return 4;
+                case MatchInstruction::PREFIX:
+                    return 1;
+                case MatchInstruction::PREFIX_WITH_1_OPT:
+                    return 2;
+                case MatchInstruction::PREFIX_WITH_2_OPTS:
+                    return 3;
+                case MatchInstruction::PREFIX_WITH_3_OPTS:
+                    return 4;
+            }
+            return 0;
+        }
+
+        enum class FlagMatch {
+            SEP,
+            GLUED,
+            GLUED_WITH_EQ,
+        };
+
+        constexpr FlagMatch classify_flag_matching(const std::string_view &flag) {
+            if (flag.empty()) {
+                return FlagMatch::SEP;
+            } else {
+                if (flag[0] == '=') {
+                    return FlagMatch::GLUED_WITH_EQ;
+                } else {
+                    return FlagMatch::GLUED;
+                }
+            }
+        }
+
+        constexpr std::string_view take_extension(const std::string_view &file) {
+            const auto pos = file.rfind('.');
+            return (pos == std::string::npos) ? file : file.substr(pos);
+        }
+    }
+
+    // Represents the flag definitions indexed by the flag name.
+    //
+    // The definitions are kept in a flat array, sorted by name once at
+    // construction. The exact lookups are binary searches over
+    // contiguous memory; the prefix lookups walk a trie built over the
+    // same array, finding the longest match in a single traversal.
+    //
+    // A table can also be an overlay over a shared immutable base: the
+    // base is referenced, not copied, and the lookups resolve the
+    // layering (the small overlay is checked first). This way every
+    // tool references the one frozen base table and only owns its own
+    // additions.
+    class FlagsByName {
+    public:
+        using value_type = std::pair<std::string_view, FlagDefinition>;
+
+        FlagsByName(std::initializer_list<value_type> entries);
+        // Layers the extra definitions over the base, which shall
+        // outlive this table. On duplicate names the base entry wins.
+        FlagsByName(const FlagsByName &base, const FlagsByName &extra);
+
+        // Finds the definition with the given name.
+        [[nodiscard]] const value_type *find(const std::string_view &key) const;
+
+        // Finds the definition with the longest name that is a prefix of the key.
+        [[nodiscard]] const value_type *find_longest_prefix(const std::string_view &key) const;
+
+    private:
+        // A node of the spelling trie. The children are few and short
+        // lived in the cache, so they are a sorted flat array instead
+        // of pointer chased tree nodes.
+        struct TrieNode {
+            std::vector<std::pair<char, uint32_t>> children;
+            int32_t entry = -1;
+        };
+
+        void insert_into_trie(uint32_t entry);
+
+    private:
+        std::vector<value_type> entries_;
+        // The spellings compiled into a byte wise trie: the longest
+        // stored prefix of a key falls out of one walk over the key,
+        // however large the table grows. This is the inner loop of the
+        // recognition, probed once per argument of every command.
+        std::vector<TrieNode> trie_;
+        const FlagsByName *base_;
+    };
 
     // Parser combinator which takes a list of flag definition and tries to apply
     // to the received input stream. It can recognize only a single compiler flag
@@ -171,16 +354,154 @@ namespace cs::semantic {
         FlagsByName const& flags_;
     };
 
+    // The matcher bodies are inline: the per tool parser is a static
+    // composition (Repeat over OneOf over these), and with the bodies
+    // in the header the whole classification of one argument compiles
+    // into a single function, with only the table lookups as calls.
+    inline rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> FlagParser::parse(const ArgumentsView &input) const {
+        // early exit if there is nothing to do.
+        if (input.empty()) {
+            return rust::Err(input);
+        }
+        // early exit if the flag is an empty string.
+        const std::string_view key = input.front();
+        if (key.empty()) {
+            return rust::Err(input);
+        }
+        // based on the lookup result, consume the input.
+        if (auto match = lookup(key); match) {
+            const auto&[count, type] = match.value();
+            const auto&[arguments, remainder] = input.take(count);
+            if (arguments.empty()) {
+                return rust::Err(input);
+            }
+            auto flag = CompilerFlag { arguments, type };
+            return rust::Ok(std::make_pair(flag, remainder));
+        }
+        return rust::Err(input);
+    }
+
+    inline std::optional<FlagParser::Match> FlagParser::lookup(const std::string_view &key) const {
+        // try to find if the key has an associated instruction
+        if (const auto *candidate = flags_.find(key); candidate != nullptr) {
+            // exact matches are preferred in all cases.
+            if (auto result = check_equal(key, *candidate); result) {
+                return result;
+            }
+        }
+        // otherwise take the flag with the longest name that is a prefix of the key.
+        if (const auto *candidate = flags_.find_longest_prefix(key); candidate != nullptr) {
+            return check_partial(key, *candidate);
+        }
+        return std::nullopt;
+    }
+
+    inline std::optional<FlagParser::Match>
+    FlagParser::check_equal(const std::string_view &key, const FlagsByName::value_type &candidate) {
+        const auto &flag_definition = candidate.second;
+        if ((detail::is_exact_match_only(flag_definition.match) || detail::is_prefix_match(flag_definition.match)) && key == candidate.first) {
+            const size_t count = detail::count_of_arguments(flag_definition.match);
+            return std::make_optional(std::make_tuple(count, flag_definition.type));
+        }
+        return std::nullopt;
+    }
+
+    inline std::optional<FlagParser::Match>
+    FlagParser::check_partial(const std::string_view &key, const FlagsByName::value_type &candidate) {
+        const auto &flag_definition = candidate.second;
+        const auto flag_matching = detail::classify_flag_matching(key.substr(candidate.first.size()));
+        switch (flag_matching) {
+            case detail::FlagMatch::GLUED:
+                if (detail::is_glue_allowed(flag_definition.match)) {
+                    const size_t decrease = detail::is_prefix_match(flag_definition.match) ? 0 : 1;
+                    const size_t count = detail::count_of_arguments(flag_definition.match) - decrease;
+                    return std::make_optional(std::make_tuple(count, flag_definition.type));
+                }
+                break;
+            case detail::FlagMatch::GLUED_WITH_EQ:
+                if (detail::is_glue_with_equal_allowed(flag_definition.match)) {
+                    const size_t count = detail::count_of_arguments(flag_definition.match) - 1;
+                    return std::make_optional(std::make_tuple(count, flag_definition.type));
+                }
+                break;
+            default:
+                // This should not happen here. Exact match is already filtered out.
+                __builtin_unreachable();
+        }
+        return std::nullopt;
+    }
+
     // Parser combinator which recognize source files as a single argument of a compiler call.
     struct SourceMatcher {
         [[nodiscard]]
-        static rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> parse(const ArgumentsView &input);
+        static rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> parse(const ArgumentsView &input) {
+            // Checked for every argument of every command; a hash set makes
+            // the lookup a single probe. Case stays significant, it selects
+            // the language (".c" vs ".C"), so both spellings are listed.
+            static const std::unordered_set<std::string_view> extensions = {
+                    // header files
+                    ".h", ".hh", ".H", ".hp", ".hxx", ".hpp", ".HPP", ".h++", ".tcc",
+                    // C
+                    ".c", ".C",
+                    // C++
+                    ".cc", ".CC", ".c++", ".C++", ".cxx", ".cpp", ".cp",
+                    // CUDA
+                    ".cu",
+                    // ObjectiveC
+                    ".m", ".mi", ".mm", ".M", ".mii",
+                    // Preprocessed
+                    ".i", ".ii",
+                    // Assembly
+                    ".s", ".S", ".sx", ".asm",
+                    // Fortran
+                    ".f", ".for", ".ftn",
+                    ".F", ".FOR", ".fpp", ".FPP", ".FTN",
+                    ".f90", ".f95", ".f03", ".f08",
+                    ".F90", ".F95", ".F03", ".F08",
+                    // go
+                    ".go",
+                    // brig
+                    ".brig",
+                    // D
+                    ".d", ".di", ".dd",
+                    // Ada
+                    ".ads", ".abd"
+            };
+
+            if (input.empty()) {
+                return rust::Err(input);
+            }
+            const auto &candidate = input.front();
+            const auto &extension = detail::take_extension(candidate);
+            if (extensions.find(extension) != extensions.end()) {
+                const auto &[arguments, remainder] = input.take(1);
+                if (arguments.empty()) {
+                    return rust::Err(input);
+                }
+                auto flag = CompilerFlag { arguments, CompilerFlagType::SOURCE };
+                return rust::Ok(std::make_pair(flag, remainder));
+            }
+            return rust::Err(input);
+        }
     };
 
     // A parser combinator, which recognize a single compiler flag without any conditions.
     struct EverythingElseFlagMatcher {
         [[nodiscard]]
-        static rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> parse(const ArgumentsView &input);
+        static rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> parse(const ArgumentsView &input) {
+            if (input.empty()) {
+                return rust::Err(input);
+            }
+            if (const auto &front = input.front(); !front.empty()) {
+                const auto &[arguments, remainder] = input.take(1);
+                if (arguments.empty()) {
+                    return rust::Err(input);
+                }
+                auto flag = CompilerFlag { arguments, CompilerFlagType::LINKER_OBJECT_FILE };
+                return rust::Ok(std::make_pair(flag, remainder));
+            }
+            return rust::Err(input);
+        }
     };
 
     // A parser combinator, which takes multiple parsers and executes them
@@ -241,6 +562,19 @@ namespace cs::semantic {
         }
     };
 
+    // Expands the @file response file references of an argument list.
+    //
+    // The tokens read from the file replace the @file argument in place,
+    // recursively (a response file may reference further response files).
+    // A relative file name is resolved against the working directory of
+    // the execution, not the directory citnames runs in. A reference that
+    // cannot be read is kept as a plain argument, like the compilers do.
+    //
+    // The files are read with mmap and their tokens are cached (keyed by
+    // path and modification time) for the rest of the run: a response
+    // file referenced by thousands of compilations is tokenized once.
+    [[nodiscard]] Arguments expand_response_files(const Arguments &arguments, const fs::path &working_dir);
+
     template <typename Parser>
     rust::Result<CompilerFlags> parse(const Parser &parser, const Arguments &arguments)
     {
@@ -0,0 +1,64 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PathTranslator.h"
+
+namespace cs::semantic {
+
+    PathTranslator::PathTranslator(const std::list<PathMapping> &mappings)
+            : mappings_()
+            , mutex_()
+            , memoized_()
+    {
+        mappings_.reserve(mappings.size());
+        for (const auto &mapping : mappings) {
+            mappings_.emplace_back(mapping.from.string(), mapping.to.string());
+        }
+    }
+
+    bool PathTranslator::empty() const noexcept {
+        return mappings_.empty();
+    }
+
+    void PathTranslator::translate(std::string &value) {
+        if (mappings_.empty() || value.empty()) {
+            return;
+        }
+        const std::lock_guard<std::mutex> guard(mutex_);
+        if (const auto it = memoized_.find(value); it != memoized_.end()) {
+            value = it->second;
+            return;
+        }
+        auto result = apply(value);
+        memoized_.emplace(value, result);
+        value = std::move(result);
+    }
+
+    std::string PathTranslator::apply(const std::string &value) const {
+        for (const auto &[from, to] : mappings_) {
+            if ((value.size() >= from.size()) && (value.compare(0, from.size(), from) == 0)
+                    && ((value.size() == from.size()) || (value[from.size()] == OS_DIR_SEPARATOR))) {
+                std::string result(value);
+                result.replace(0, from.size(), to);
+                return result;
+            }
+        }
+        return value;
+    }
+}
@@ -0,0 +1,62 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "Configuration.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cs::semantic {
+
+    // Rewrites the container side path prefixes of the configured mount
+    // mappings to their host side mount points. A build repeats the
+    // same few thousand path strings over its many commands, so the
+    // result of each distinct string is memoized: a path is matched
+    // against the mappings exactly once, every later occurrence is a
+    // hash lookup. Shared by the recognition worker threads.
+    class PathTranslator {
+    public:
+        explicit PathTranslator(const std::list<PathMapping> &mappings);
+
+        [[nodiscard]] bool empty() const noexcept;
+
+        // Replaces the value in place when a mapping matches it. Only a
+        // whole path component prefix matches ("/src" rewrites "/src/a.c",
+        // but not "/srcs/a.c"); the first matching mapping wins.
+        void translate(std::string &value);
+
+        NON_DEFAULT_CONSTRUCTABLE(PathTranslator)
+        NON_COPYABLE_NOR_MOVABLE(PathTranslator)
+
+    private:
+        [[nodiscard]] std::string apply(const std::string &value) const;
+
+    private:
+        std::vector<std::pair<std::string, std::string>> mappings_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, std::string> memoized_;
+    };
+}
@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "semantic/Semantic.h"
+#include "libsys/Path.h"
 
 #include <fmt/format.h>
 #ifdef HAVE_FMT_STD_H
@@ -66,7 +67,7 @@ namespace cs::semantic {
 
     Compile::Compile(fs::path working_dir,
                      fs::path compiler,
-                     std::list<std::string> flags,
+                     std::vector<std::string> flags,
                      std::vector<fs::path> sources,
                      std::optional<fs::path> output)
             : working_dir(std::move(working_dir))
@@ -102,35 +103,80 @@ namespace cs::semantic {
 
     std::list<cs::Entry> Compile::into_entries() const {
         const auto abspath = [this](const fs::path &path) -> fs::path {
-            auto candidate = (path.is_absolute()) ? path : working_dir / path;
-            // Create canonical path without checking of file existence.
-            fs::path result;
-            for (const auto& part : candidate) {
-                if (part == ".")
-                    continue;
-                if (part == "..")
-                    result = result.parent_path();
-                else
-                    result = result / part;
-            }
-            return result;
+            return sys::path::normalize(path, working_dir);
         };
+        // The sibling entries differ only in their trailing source
+        // argument. The common front (compiler, flags and output) is
+        // built once and shared between them, so a command compiling
+        // dozens of sources does not repeat its flag list per entry.
+        auto common = std::make_shared<cs::ArgumentList::Block>();
+        common->reserve(flags.size() + (output ? 3 : 1));
+        common->push_back(compiler.string());
+        std::copy(flags.begin(), flags.end(), std::back_inserter(*common));
+        if (output) {
+            common->emplace_back("-o");
+            common->push_back(output.value().string());
+        }
         std::list<cs::Entry> results;
         for (const auto& source : sources) {
-            cs::Entry result {
+            results.emplace_back(cs::Entry {
                 abspath(source),
                 working_dir,
                 output ? std::optional(abspath(output.value())) : std::nullopt,
-                { compiler.string() }
-            };
-            std::copy(flags.begin(), flags.end(), std::back_inserter(result.arguments));
-            if (output) {
-                result.arguments.emplace_back("-o");
-                result.arguments.push_back(output.value().string());
-            }
-            result.arguments.push_back(source);
-            results.emplace_back(std::move(result));
+                cs::ArgumentList(common, { source.string() })
+            });
         }
         return results;
     }
+
+    Link::Link(fs::path working_dir,
+               fs::path linker,
+               std::vector<std::string> arguments,
+               std::vector<fs::path> inputs,
+               std::optional<fs::path> output)
+            : working_dir(std::move(working_dir))
+            , linker(std::move(linker))
+            , arguments(std::move(arguments))
+            , inputs(std::move(inputs))
+            , output(std::move(output))
+    { }
+
+    bool Link::operator==(const Semantic &rhs) const {
+        if (this == &rhs)
+            return true;
+
+        if (const auto *const ptr = dynamic_cast<Link const*>(&rhs); ptr != nullptr) {
+            return (working_dir == ptr->working_dir)
+                && (linker == ptr->linker)
+                && (output == ptr->output)
+                && (inputs == ptr->inputs)
+                && (arguments == ptr->arguments);
+        }
+        return false;
+    }
+
+    std::ostream &Link::operator<<(std::ostream &os) const {
+        os  << "Link { working_dir: " << working_dir
+            << ", linker: " << linker
+            << ", arguments: " << fmt::format("[{}]", fmt::join(arguments.begin(), arguments.end(), ", "))
+            << ", inputs: " << fmt::format("[{}]", fmt::join(inputs.begin(), inputs.end(), ", "))
+            << ", output: " << (output ? output.value().string() : "")
+            << " }";
+        return os;
+    }
+
+    std::list<cs::Entry> Link::into_entries() const {
+        // One entry per link command. The command is kept as executed
+        // (the consumers want to replay or analyze it as a whole), and
+        // the file field holds the created artifact. A linker without
+        // the output flag writes a.out.
+        const auto artifact = sys::path::normalize(output.value_or(fs::path("a.out")), working_dir);
+        cs::Entry result {
+                artifact,
+                working_dir,
+                std::make_optional(artifact),
+                arguments
+        };
+        return { std::move(result) };
+    }
 }
\ No newline at end of file
@@ -85,7 +85,7 @@ namespace cs::semantic {
     struct Compile : public CompilerCall {
         Compile(fs::path working_dir,
                 fs::path compiler,
-                std::list<std::string> flags,
+                std::vector<std::string> flags,
                 std::vector<fs::path> sources,
                 std::optional<fs::path> output);
 
@@ -97,8 +97,31 @@ namespace cs::semantic {
     public:
         fs::path working_dir;
         fs::path compiler;
-        std::list<std::string> flags;
+        std::vector<std::string> flags;
         std::vector<fs::path> sources;
         std::optional<fs::path> output;
     };
+
+    // Represents a linker (or archiver) call, which combines object files
+    // into an artifact. These entries go into a separate database, not
+    // into the compilation database.
+    struct Link : public CompilerCall {
+        Link(fs::path working_dir,
+             fs::path linker,
+             std::vector<std::string> arguments,
+             std::vector<fs::path> inputs,
+             std::optional<fs::path> output);
+
+        bool operator==(Semantic const&) const override;
+        std::ostream& operator<<(std::ostream&) const override;
+
+        [[nodiscard]] std::list<cs::Entry> into_entries() const override;
+
+    public:
+        fs::path working_dir;
+        fs::path linker;
+        std::vector<std::string> arguments;
+        std::vector<fs::path> inputs;
+        std::optional<fs::path> output;
+    };
 }
@@ -23,6 +23,8 @@
 #include "libresult/Result.h"
 
 #include <memory>
+#include <optional>
+#include <string>
 
 namespace cs::semantic {
 
@@ -36,6 +38,19 @@ namespace cs::semantic {
         [[nodiscard]]
         virtual rust::Result<SemanticPtr> recognize(const Execution &) const = 0;
 
+        // The name the tool reports itself under (in logs and metrics).
+        [[nodiscard]]
+        virtual std::string name() const = 0;
+
+        // The executable path this tool matches, when it matches exactly
+        // one (the user configured wrappers do). The dispatch collects
+        // these into a single hash index, so the configured matcher
+        // count does not multiply the per execution cost.
+        [[nodiscard]]
+        virtual std::optional<fs::path> exact_executable() const {
+            return std::nullopt;
+        }
+
         // Helper methods to evaluate the recognize method result.
         static bool recognized_ok(const rust::Result<SemanticPtr> &result) noexcept;
         static bool recognized_with_error(const rust::Result<SemanticPtr> &result) noexcept;
@@ -24,24 +24,106 @@
 namespace cs::semantic {
 
     ToolAny::ToolAny(ToolAny::ToolPtrs &&tools, std::list<fs::path> &&to_exclude) noexcept
-            : tools_(tools)
-            , to_exclude_(to_exclude)
-    { }
+            : tools_()
+            , exact_tools_()
+            , exact_list_()
+            , exclude_names_()
+            , exclude_paths_()
+    {
+        tools_.reserve(tools.size());
+        for (auto &tool : tools) {
+            if (const auto executable = tool->exact_executable(); executable.has_value()) {
+                exact_tools_[executable.value().string()] = tool;
+                exact_list_.emplace_back(std::move(tool));
+            } else {
+                tools_.emplace_back(0, std::move(tool));
+            }
+        }
+        for (const auto &path : to_exclude) {
+            auto normalized = path.lexically_normal();
+            exclude_names_.insert(normalized.filename().string());
+            exclude_paths_.insert(normalized.string());
+        }
+    }
 
     rust::Result<SemanticPtr> ToolAny::recognize(const domain::Execution &execution) const {
         // do different things if the execution is matching one of the nominated compilers.
-        if (to_exclude_.end() != std::find(to_exclude_.begin(), to_exclude_.end(), execution.executable)) {
+        if (!exclude_names_.empty()
+                && (exclude_names_.find(execution.executable.filename().string()) != exclude_names_.end())
+                && (exclude_paths_.find(execution.executable.lexically_normal().string()) != exclude_paths_.end())) {
             return rust::Err(std::runtime_error("The tool is on the exclude list from configuration."));
         } else {
+            // ask the tool which recognized this executable before.
+            if (const auto it = recognized_.find(execution.executable); it != recognized_.end()) {
+                auto result = measure(it->second, execution);
+                if (Tool::recognized_ok(result) || Tool::recognized_with_error(result)) {
+                    return result;
+                }
+            }
+            // one lookup covers every exact path matcher at once.
+            if (const auto it = exact_tools_.find(execution.executable.string()); it != exact_tools_.end()) {
+                auto result = measure(it->second, execution);
+                if (Tool::recognized_ok(result) || Tool::recognized_with_error(result)) {
+                    recognized_[execution.executable] = it->second;
+                    return result;
+                }
+            }
             // check if any tool can recognize the execution.
-            for (const auto &tool : tools_) {
-                auto result = tool->recognize(execution);
+            for (size_t index = 0; index < tools_.size(); ++index) {
+                auto result = measure(tools_[index].second, execution);
                 // return if it recognized in any way.
                 if (Tool::recognized_ok(result) || Tool::recognized_with_error(result)) {
+                    recognized_[execution.executable] = tools_[index].second;
+                    promote(index);
                     return result;
                 }
             }
         }
         return rust::Err(std::runtime_error("No tools recognize this execution."));
     }
+
+    rust::Result<SemanticPtr> ToolAny::measure(const ToolPtr &tool, const Execution &execution) const {
+        const auto before = std::chrono::steady_clock::now();
+        auto result = tool->recognize(execution);
+        const auto after = std::chrono::steady_clock::now();
+
+        auto &entry = metrics_[tool.get()];
+        if (entry.offered == 0) {
+            entry.tool = tool->name();
+        }
+        ++entry.offered;
+        entry.spent += std::chrono::duration_cast<std::chrono::nanoseconds>(after - before);
+        if (Tool::recognized_ok(result) || Tool::recognized_with_error(result)) {
+            ++entry.matched;
+        }
+        return result;
+    }
+
+    void ToolAny::promote(const size_t index) const {
+        const size_t count = ++tools_[index].first;
+        // the reordering pays off on the next unseen executable; the
+        // repeats of a known one are served from the cache anyway.
+        size_t position = index;
+        while ((position > 0) && (tools_[position - 1].first < count)) {
+            --position;
+        }
+        if (position != index) {
+            std::rotate(tools_.begin() + position, tools_.begin() + index, tools_.begin() + index + 1);
+        }
+    }
+
+    std::list<ToolMetrics> ToolAny::metrics() const {
+        std::list<ToolMetrics> results;
+        for (const auto &[count, tool] : tools_) {
+            if (const auto it = metrics_.find(tool.get()); it != metrics_.end()) {
+                results.push_back(it->second);
+            }
+        }
+        for (const auto &tool : exact_list_) {
+            if (const auto it = metrics_.find(tool.get()); it != metrics_.end()) {
+                results.push_back(it->second);
+            }
+        }
+        return results;
+    }
 }
@@ -21,8 +21,26 @@
 
 #include "Tool.h"
 
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 namespace cs::semantic {
 
+    // The recognition effort one tool matcher spent during a run: how
+    // many executions were offered to it, how many it claimed, and the
+    // time the calls took together.
+    struct ToolMetrics {
+        std::string tool;
+        size_t offered = 0;
+        size_t matched = 0;
+        std::chrono::nanoseconds spent = std::chrono::nanoseconds::zero();
+    };
+
     class ToolAny : public Tool {
     public:
         using ToolPtr = std::shared_ptr<Tool>;
@@ -33,8 +51,53 @@ namespace cs::semantic {
         [[nodiscard]]
         rust::Result<SemanticPtr> recognize(const Execution &execution) const override;
 
+        [[nodiscard]]
+        std::string name() const override {
+            return "any";
+        }
+
+        // The effort spent in each tool so far, in dispatch order. Tools
+        // which were never asked are left out.
+        [[nodiscard]]
+        std::list<ToolMetrics> metrics() const;
+
+    private:
+        // Dispatches to the tool and accounts the call in the metrics.
+        [[nodiscard]]
+        rust::Result<SemanticPtr> measure(const ToolPtr &tool, const Execution &execution) const;
+
+        // Accounts a match and bubbles the tool ahead of the less
+        // frequently matching ones in the dispatch list.
+        void promote(size_t index) const;
+
     private:
-        ToolPtrs tools_;
-        std::list<fs::path> to_exclude_;
+        // The dispatch list with a match counter per tool. The order
+        // adapts to the observed match frequency, so a homogeneous build
+        // (a single compiler throughout) converges to first-try matches
+        // without configuration. Single-threaded per Build, like the
+        // caches below, therefore no locking.
+        mutable std::vector<std::pair<size_t, ToolPtr>> tools_;
+        // Tools which declare an exact executable path (the user
+        // configured compiler wrappers) are folded into a single hash
+        // index instead of the dispatch list, so any number of them
+        // costs one lookup per executable.
+        std::unordered_map<std::string, ToolPtr> exact_tools_;
+        // The indexed tools in their configuration order, for the
+        // metrics report only.
+        std::vector<ToolPtr> exact_list_;
+        // The exclusion check runs on every event; the configured paths
+        // are prebuilt into hash sets of normalized paths. The basename
+        // set rejects the common (not excluded) case with a single
+        // lookup, before the path normalization.
+        std::unordered_set<std::string> exclude_names_;
+        std::unordered_set<std::string> exclude_paths_;
+        // Remembers which tool recognized an executable, so later executions
+        // of the same binary are dispatched without asking every tool again.
+        // The owning Build instance is used by a single thread, therefore
+        // the cache needs no locking.
+        mutable std::map<fs::path, ToolPtr> recognized_;
+        // The recognition effort spent in each tool. Single-threaded per
+        // Build, like the cache above, therefore no locking.
+        mutable std::map<const Tool *, ToolMetrics> metrics_;
     };
 }
@@ -0,0 +1,126 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ToolAr.h"
+
+#include <algorithm>
+#include <regex>
+#include <string_view>
+#include <utility>
+
+using namespace cs::semantic;
+
+namespace {
+
+    // The archiver command line is positional, not flag driven:
+    //
+    //   ar [-]operation[modifiers] [relpos] [count] archive [member...]
+    //
+    // This takes the arguments apart along those positions. Returns
+    // nothing when the command does not create or update an archive.
+    struct ArchiverCall {
+        std::string operation;
+        fs::path archive;
+        std::vector<fs::path> members;
+    };
+
+    std::optional<ArchiverCall> take_apart(const Arguments &arguments) {
+        ArchiverCall result;
+        bool has_archive = false;
+        size_t positionals_to_skip = 0;
+
+        for (auto it = std::next(arguments.begin()); it != arguments.end(); ++it) {
+            const std::string &argument = *it;
+            // long options (--plugin <name> takes a value, the rest does not.)
+            if (argument.size() > 1 && argument[0] == '-' && argument[1] == '-') {
+                if ((argument == "--plugin") && (std::next(it) != arguments.end())) {
+                    ++it;
+                }
+                continue;
+            }
+            if (result.operation.empty()) {
+                // the leading dash of the operation is optional.
+                result.operation = (!argument.empty() && argument[0] == '-')
+                        ? argument.substr(1)
+                        : argument;
+                // the relpos and count modifiers consume a positional
+                // argument each, before the archive name.
+                constexpr std::string_view POSITIONAL_MODIFIERS = "abiN";
+                for (const char modifier : result.operation) {
+                    if (POSITIONAL_MODIFIERS.find(modifier) != std::string_view::npos) {
+                        ++positionals_to_skip;
+                    }
+                }
+                continue;
+            }
+            if (positionals_to_skip > 0) {
+                --positionals_to_skip;
+                continue;
+            }
+            if (!has_archive) {
+                result.archive = fs::path(argument);
+                has_archive = true;
+            } else {
+                result.members.emplace_back(argument);
+            }
+        }
+        // only the insert and replace operations create or update the
+        // archive content; and without members there is nothing captured.
+        const bool creates = (result.operation.find_first_of("qr") != std::string::npos);
+        return (creates && has_archive && !result.members.empty())
+                ? std::make_optional(std::move(result))
+                : std::nullopt;
+    }
+}
+
+namespace cs::semantic {
+
+    rust::Result<SemanticPtr> ToolAr::recognize(const Execution &execution) const {
+        if (!is_archiver_call(execution.executable)) {
+            return rust::Ok(SemanticPtr());
+        }
+        Arguments raw_arguments;
+        std::copy(execution.arguments.begin(), execution.arguments.end(), std::back_inserter(raw_arguments));
+        const Arguments arguments = expand_response_files(raw_arguments, execution.working_dir);
+        auto candidate = take_apart(arguments);
+        if (!candidate.has_value()) {
+            return rust::Ok(SemanticPtr());
+        }
+        SemanticPtr result = std::make_shared<Link>(
+                execution.working_dir,
+                execution.executable,
+                arguments,
+                std::move(candidate.value().members),
+                std::make_optional(std::move(candidate.value().archive))
+        );
+        return rust::Ok(std::move(result));
+    }
+
+    bool ToolAr::is_archiver_call(const fs::path& program) const {
+        static const auto pattern = std::regex(
+                // - ar
+                //   - with prefixes like: llvm-, gcc-, arm-none-eabi-
+                //   - with postfixes like: -15
+                R"(^(([^-]*-)*ar(-\d+(\.\d+){0,2})?)$)"
+        );
+
+        std::cmatch m;
+        return std::regex_match(program.filename().c_str(), m, pattern);
+    }
+}
@@ -171,17 +171,17 @@ namespace {
             {"-Xpreprocessor",    {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,                  CompilerFlagType::OTHER}},
     };
 
-    FlagsByName clang_flags(const FlagsByName &base) {
-        FlagsByName flags(base);
-        flags.insert(CLANG_FLAG_DEFINITION.begin(), CLANG_FLAG_DEFINITION.end());
-        return flags;
-    }
 }
 
 namespace cs::semantic {
 
+    const FlagsByName &ToolClang::flags() {
+        static const FlagsByName table(ToolGcc::FLAG_DEFINITION, CLANG_FLAG_DEFINITION);
+        return table;
+    }
+
     ToolClang::ToolClang() noexcept
-            : flag_definition(clang_flags(ToolGcc::FLAG_DEFINITION))
+            : flag_definition(flags())
     { }
 
     rust::Result<SemanticPtr> ToolClang::recognize(const Execution &execution) const {
@@ -30,10 +30,20 @@ namespace cs::semantic {
         [[nodiscard]]
         rust::Result<SemanticPtr> recognize(const Execution &execution) const override;
 
+        [[nodiscard]]
+        std::string name() const override {
+            return "clang";
+        }
+
     protected:
         [[nodiscard]]
         bool is_compiler_call(const fs::path &program) const override;
 
-        const FlagsByName flag_definition;
+        // The clang table is an overlay over the shared gcc base table:
+        // built once, referenced by every instance.
+        [[nodiscard]]
+        static const FlagsByName &flags();
+
+        const FlagsByName &flag_definition;
     };
 }
@@ -19,15 +19,122 @@
 
 #include "ToolCuda.h"
 #include "ToolGcc.h"
+#include "Parsers.h"
 
 #include <regex>
 
 namespace cs::semantic {
 
+    namespace {
+
+        // The forwarded host flags never name the CUDA sources or the
+        // nvcc output; a classification that would, is demoted before it
+        // can change the meaning of the nvcc command.
+        CompilerFlagType forwarded_type(const CompilerFlagType type) {
+            switch (type) {
+                case CompilerFlagType::SOURCE:
+                case CompilerFlagType::KIND_OF_OUTPUT:
+                case CompilerFlagType::KIND_OF_OUTPUT_NO_LINKING:
+                case CompilerFlagType::KIND_OF_OUTPUT_INFO:
+                case CompilerFlagType::KIND_OF_OUTPUT_OUTPUT:
+                    return CompilerFlagType::OTHER;
+                default:
+                    return type;
+            }
+        }
+
+        // Recognizes the "-Xcompiler <flag>" forwarding of nvcc. The
+        // forwarded flag is classified in place with the shared host
+        // compiler table: the result is one flag spanning both elements
+        // of the input, no argument containers are rebuilt for the
+        // nested parse. The comma packed form ("-Xcompiler=-a,-b") is a
+        // single argv element; it is not sliceable in place and stays
+        // with the generic matchers, packed.
+        struct ForwardedFlagMatcher {
+            explicit ForwardedFlagMatcher(const FlagsByName &host) noexcept
+                    : host_(host)
+            { }
+
+            [[nodiscard]]
+            rust::Result<std::pair<CompilerFlag, ArgumentsView>, ArgumentsView> parse(const ArgumentsView &input) const {
+                if (input.empty()) {
+                    return rust::Err(input);
+                }
+                const auto &option = input.front();
+                if ((option != "-Xcompiler") && (option != "--compiler-options")) {
+                    return rust::Err(input);
+                }
+                const auto &[arguments, remainder] = input.take(2);
+                if (arguments.empty()) {
+                    // nothing follows the option; leave it to the generic matchers.
+                    return rust::Err(input);
+                }
+                // nvcc forwards one token per option, so the nested parse
+                // runs over the slice of that single element.
+                const ArgumentsView forwarded(std::next(arguments.begin()), arguments.end());
+                auto type = CompilerFlagType::OTHER;
+                if (forwarded.front().find(',') == std::string::npos) {
+                    host_.parse(forwarded)
+                            .on_success([&type](const auto &tuple) {
+                                const auto &[flag, rest] = tuple;
+                                if (rest.empty()) {
+                                    type = forwarded_type(flag.type);
+                                }
+                            });
+                }
+                auto flag = CompilerFlag { arguments, type };
+                return rust::Ok(std::make_pair(flag, remainder));
+            }
+
+        private:
+            FlagParser host_;
+        };
+    }
+
+    const FlagsByName &ToolCuda::flag_definition() {
+        // The nvcc flags that take a separate value; without them the
+        // value would be classified on its own (and "-arch sm_80" would
+        // look like a linker input). Layered over the gcc table, which
+        // is referenced, not copied.
+        static const FlagsByName definition(ToolGcc::FLAG_DEFINITION, FlagsByName({
+                {"-ccbin",            {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::KIND_OF_OUTPUT}},
+                {"--compiler-bindir", {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::KIND_OF_OUTPUT}},
+                {"-arch",             {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::OTHER}},
+                {"-code",             {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::OTHER}},
+                {"-gencode",          {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::OTHER}},
+                {"-maxrregcount",     {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::OTHER}},
+                {"-Xptxas",           {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,                  CompilerFlagType::OTHER}},
+                {"-Xcudafe",          {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,                  CompilerFlagType::OTHER}},
+                {"-Xnvlink",          {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,                  CompilerFlagType::LINKER}},
+        }));
+        return definition;
+    }
+
     bool ToolCuda::is_compiler_call(const fs::path& program) const {
         static const auto pattern = std::regex(R"(^(nvcc)$)");
 
         std::cmatch m;
         return std::regex_match(program.filename().c_str(), m, pattern);
     }
+
+    rust::Result<SemanticPtr> ToolCuda::compilation(const Execution &execution) const {
+        const auto &parser =
+                Repeat(
+                        OneOf(
+                                ForwardedFlagMatcher(ToolGcc::FLAG_DEFINITION),
+                                FlagParser(flag_definition()),
+                                SourceMatcher(),
+                                EverythingElseFlagMatcher()
+                        )
+                );
+
+        const Arguments input_arguments = prepare_arguments(
+                Arguments(execution.arguments.begin(), execution.arguments.end()),
+                execution.working_dir,
+                execution.environment);
+        return parse(parser, input_arguments)
+                .and_then<SemanticPtr>([&execution](auto flags) {
+                    return semantic_from_flags(flags, execution.working_dir, execution.executable);
+                });
+    }
 }
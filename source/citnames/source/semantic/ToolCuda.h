@@ -26,5 +26,20 @@ namespace cs::semantic {
     struct ToolCuda : public ToolGcc {
         [[nodiscard]]
         bool is_compiler_call(const fs::path& program) const override;
+
+        [[nodiscard]]
+        std::string name() const override {
+            return "cuda";
+        }
+
+    protected:
+        [[nodiscard]]
+        rust::Result<SemanticPtr> compilation(const Execution &execution) const override;
+
+    private:
+        // The nvcc table: a thin overlay of the nvcc specific flags
+        // over the shared gcc table.
+        [[nodiscard]]
+        static const FlagsByName &flag_definition();
     };
 }
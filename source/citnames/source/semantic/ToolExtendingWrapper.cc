@@ -20,15 +20,30 @@
 #include "ToolExtendingWrapper.h"
 
 #include <algorithm>
+#include <iterator>
 
 namespace cs::semantic {
 
     ToolExtendingWrapper::ToolExtendingWrapper(CompilerWrapper &&compilers_to_recognize) noexcept
-            : compilers_to_recognize_(compilers_to_recognize)
-    { }
+            : executable_(std::move(compilers_to_recognize.executable))
+            , flags_to_add_(std::make_move_iterator(compilers_to_recognize.flags_to_add.begin()),
+                            std::make_move_iterator(compilers_to_recognize.flags_to_add.end()))
+            , flags_to_remove_(std::make_move_iterator(compilers_to_recognize.flags_to_remove.begin()),
+                               std::make_move_iterator(compilers_to_recognize.flags_to_remove.end()))
+    {
+        std::sort(flags_to_remove_.begin(), flags_to_remove_.end());
+    }
 
     bool ToolExtendingWrapper::is_compiler_call(const fs::path &program) const {
-        return compilers_to_recognize_.executable == program;
+        return executable_ == program;
+    }
+
+    std::string ToolExtendingWrapper::name() const {
+        return executable_.string();
+    }
+
+    std::optional<fs::path> ToolExtendingWrapper::exact_executable() const {
+        return executable_;
     }
 
     rust::Result<SemanticPtr> ToolExtendingWrapper::recognize(const Execution &execution) const {
@@ -36,21 +51,22 @@ namespace cs::semantic {
                 .map<cs::semantic::SemanticPtr>([this](auto semantic) {
                     if (auto* ptr = dynamic_cast<Compile*>(semantic.get()); ptr != nullptr) {
                         // remove flags which were asked to be removed.
-                        ptr->flags.erase(
-                                std::remove_if(
-                                        ptr->flags.begin(),
-                                        ptr->flags.end(),
-                                        [this](auto flag) {
-                                            return std::any_of(
-                                                    compilers_to_recognize_.flags_to_remove.begin(),
-                                                    compilers_to_recognize_.flags_to_remove.end(),
-                                                    [&flag](auto flag_to_remove) { return flag_to_remove == flag; });
-                                        }),
-                                ptr->flags.end());
+                        if (!flags_to_remove_.empty()) {
+                            ptr->flags.erase(
+                                    std::remove_if(
+                                            ptr->flags.begin(),
+                                            ptr->flags.end(),
+                                            [this](const auto &flag) {
+                                                return std::binary_search(
+                                                        flags_to_remove_.begin(),
+                                                        flags_to_remove_.end(),
+                                                        flag);
+                                            }),
+                                    ptr->flags.end());
+                        }
                         // add flags which were asked to be added.
-                        std::copy(compilers_to_recognize_.flags_to_add.begin(),
-                                  compilers_to_recognize_.flags_to_add.end(),
-                                  std::back_inserter(ptr->flags));
+                        ptr->flags.reserve(ptr->flags.size() + flags_to_add_.size());
+                        ptr->flags.insert(ptr->flags.end(), flags_to_add_.begin(), flags_to_add_.end());
                     }
                     return semantic;
                 });
@@ -21,6 +21,9 @@
 
 #include "ToolGcc.h"
 
+#include <string>
+#include <vector>
+
 namespace cs::semantic {
 
     struct ToolExtendingWrapper : public ToolGcc {
@@ -33,7 +36,18 @@ namespace cs::semantic {
         [[nodiscard]]
         rust::Result<SemanticPtr> recognize(const Execution &execution) const override;
 
+        [[nodiscard]]
+        std::string name() const override;
+
+        [[nodiscard]]
+        std::optional<fs::path> exact_executable() const override;
+
     private:
-        CompilerWrapper compilers_to_recognize_;
+        fs::path executable_;
+        // The flag edits are prepared once: the additions as a contiguous
+        // block for a bulk append, the removals sorted for a binary search.
+        // The recognition runs them against every matched entry.
+        std::vector<std::string> flags_to_add_;
+        std::vector<std::string> flags_to_remove_;
     };
 }
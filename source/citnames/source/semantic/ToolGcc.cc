@@ -60,14 +60,6 @@ namespace {
         return flags;
     }
 
-    Arguments create_argument_list(const Execution &execution) {
-        Arguments input_arguments;
-        std::copy(execution.arguments.begin(), execution.arguments.end(), std::back_inserter(input_arguments));
-        Arguments extra_arguments = flags_from_environment(execution.environment);
-        std::copy(extra_arguments.begin(), extra_arguments.end(), std::back_inserter(input_arguments));
-        return input_arguments;
-    }
-
     bool is_compiler_query(const CompilerFlags& flags)
     {
         // no flag is a no compilation
@@ -270,6 +262,20 @@ namespace cs::semantic {
     }
 
     rust::Result<SemanticPtr> ToolGcc::compilation(const FlagsByName &flags, const Execution &execution) {
+        return compilation(
+                flags,
+                execution.working_dir,
+                execution.executable,
+                Arguments(execution.arguments.begin(), execution.arguments.end()),
+                execution.environment);
+    }
+
+    rust::Result<SemanticPtr> ToolGcc::compilation(
+            const FlagsByName &flags,
+            const fs::path &working_dir,
+            const fs::path &executable,
+            Arguments &&arguments,
+            const std::map<std::string, std::string> &environment) {
         const auto &parser =
                 Repeat(
                         OneOf(
@@ -279,36 +285,52 @@ namespace cs::semantic {
                         )
                 );
 
-        const Arguments &input_arguments = create_argument_list(execution);
+        const Arguments input_arguments = prepare_arguments(std::move(arguments), working_dir, environment);
         return parse(parser, input_arguments)
-                .and_then<SemanticPtr>([&execution](auto flags) -> rust::Result<SemanticPtr> {
-                    if (is_compiler_query(flags)) {
-                        SemanticPtr result = std::make_shared<QueryCompiler>();
-                        return rust::Ok(std::move(result));
-                    }
-                    if (is_prerpocessor(flags)) {
-                        SemanticPtr result = std::make_shared<Preprocess>();
-                        return rust::Ok(std::move(result));
-                    }
+                .and_then<SemanticPtr>([&working_dir, &executable](auto flags) {
+                    return semantic_from_flags(flags, working_dir, executable);
+                });
+    }
 
-                    auto[arguments, sources, output] = split(flags);
-                    // Validate: must have source files.
-                    if (sources.empty()) {
-                        return rust::Err(std::runtime_error("Source files not found for compilation."));
-                    }
-                    // TODO: introduce semantic type for linking
-                    if (linking(flags)) {
-                        arguments.insert(arguments.begin(), "-c");
-                    }
+    Arguments ToolGcc::prepare_arguments(
+            Arguments &&arguments,
+            const fs::path &working_dir,
+            const std::map<std::string, std::string> &environment) {
+        const Arguments extra_arguments = flags_from_environment(environment);
+        std::copy(extra_arguments.begin(), extra_arguments.end(), std::back_inserter(arguments));
+        return expand_response_files(arguments, working_dir);
+    }
 
-                    SemanticPtr result = std::make_shared<Compile>(
-                            execution.working_dir,
-                            execution.executable,
-                            std::move(arguments),
-                            std::move(sources),
-                            std::move(output)
-                    );
-                    return rust::Ok(std::move(result));
-                });
+    rust::Result<SemanticPtr> ToolGcc::semantic_from_flags(
+            const CompilerFlags &flags,
+            const fs::path &working_dir,
+            const fs::path &executable) {
+        if (is_compiler_query(flags)) {
+            SemanticPtr result = std::make_shared<QueryCompiler>();
+            return rust::Ok(std::move(result));
+        }
+        if (is_prerpocessor(flags)) {
+            SemanticPtr result = std::make_shared<Preprocess>();
+            return rust::Ok(std::move(result));
+        }
+
+        auto[arguments, sources, output] = split(flags);
+        // Validate: must have source files.
+        if (sources.empty()) {
+            return rust::Err(std::runtime_error("Source files not found for compilation."));
+        }
+        // TODO: introduce semantic type for linking
+        if (linking(flags)) {
+            arguments.insert(arguments.begin(), "-c");
+        }
+
+        SemanticPtr result = std::make_shared<Compile>(
+                working_dir,
+                executable,
+                std::move(arguments),
+                std::move(sources),
+                std::move(output)
+        );
+        return rust::Ok(std::move(result));
     }
 }
@@ -29,6 +29,11 @@ namespace cs::semantic {
         [[nodiscard]]
         rust::Result<SemanticPtr> recognize(const Execution &execution) const override;
 
+        [[nodiscard]]
+        std::string name() const override {
+            return "gcc";
+        }
+
     protected:
         [[nodiscard]]
         virtual bool is_compiler_call(const fs::path& program) const;
@@ -39,6 +44,35 @@ namespace cs::semantic {
         [[nodiscard]]
         static rust::Result<SemanticPtr> compilation(const FlagsByName &flags, const Execution &execution);
 
+        // Same as above, but takes the pieces of the execution separately.
+        // Wrapper tools use it to parse the wrapped command in place,
+        // without assembling a new execution object for it.
+        [[nodiscard]]
+        static rust::Result<SemanticPtr> compilation(
+                const FlagsByName &flags,
+                const fs::path &working_dir,
+                const fs::path &executable,
+                Arguments &&arguments,
+                const std::map<std::string, std::string> &environment);
+
+        // The argument list a compilation is parsed from: the flags
+        // injected through the environment appended, the @file
+        // references expanded.
+        [[nodiscard]]
+        static Arguments prepare_arguments(
+                Arguments &&arguments,
+                const fs::path &working_dir,
+                const std::map<std::string, std::string> &environment);
+
+        // Builds the semantic from the classified flags. Derived tools
+        // with their own parser composition share the classification
+        // rules through this.
+        [[nodiscard]]
+        static rust::Result<SemanticPtr> semantic_from_flags(
+                const CompilerFlags &flags,
+                const fs::path &working_dir,
+                const fs::path &executable);
+
         static const FlagsByName FLAG_DEFINITION;
     };
 }
@@ -0,0 +1,183 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ToolLd.h"
+
+#include <algorithm>
+#include <regex>
+#include <utility>
+
+using namespace cs::semantic;
+
+namespace {
+
+    bool is_linker_query(const CompilerFlags& flags)
+    {
+        // no flag is a no linking
+        if (flags.empty()) {
+            return true;
+        }
+        // otherwise check if this was a version query or a help
+        return std::any_of(flags.begin(), flags.end(), [](const auto& flag) {
+            return (flag.type == CompilerFlagType::KIND_OF_OUTPUT_INFO);
+        });
+    }
+
+    std::tuple<
+            std::vector<fs::path>,
+            std::optional<fs::path>
+    > split(const CompilerFlags &flags) {
+        std::vector<fs::path> inputs;
+        std::optional<fs::path> output;
+
+        for (const auto &flag : flags) {
+            switch (flag.type) {
+                case CompilerFlagType::LINKER_OBJECT_FILE: {
+                    auto candidate = fs::path(flag.arguments.front());
+                    inputs.emplace_back(std::move(candidate));
+                    break;
+                }
+                case CompilerFlagType::KIND_OF_OUTPUT_OUTPUT: {
+                    auto candidate = fs::path(flag.arguments.back());
+                    output = std::make_optional(std::move(candidate));
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return std::make_tuple(inputs, output);
+    }
+}
+
+namespace cs::semantic {
+
+    // The flags which take a separate value are the important ones here:
+    // without them the value would be taken as an input file. Every other
+    // option is covered by the catch-all prefix entries at the end.
+    const FlagsByName ToolLd::FLAG_DEFINITION = {
+            {"-o",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::KIND_OF_OUTPUT_OUTPUT}},
+            {"--output",         {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::KIND_OF_OUTPUT_OUTPUT}},
+            {"--help",           {MatchInstruction::PREFIX,                              CompilerFlagType::KIND_OF_OUTPUT_INFO}},
+            {"--version",        {MatchInstruction::EXACTLY,                             CompilerFlagType::KIND_OF_OUTPUT_INFO}},
+            {"-v",               {MatchInstruction::EXACTLY,                             CompilerFlagType::KIND_OF_OUTPUT_INFO}},
+            {"-V",               {MatchInstruction::EXACTLY,                             CompilerFlagType::KIND_OF_OUTPUT_INFO}},
+            {"-L",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::DIRECTORY_SEARCH_LINKER}},
+            {"--library-path",   {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::DIRECTORY_SEARCH_LINKER}},
+            {"-l",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::LINKER}},
+            {"--library",        {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-T",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::LINKER}},
+            {"--script",         {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-e",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::LINKER}},
+            {"--entry",          {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-m",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::LINKER}},
+            {"-u",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::LINKER}},
+            {"-y",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::LINKER}},
+            {"-z",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-b",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-c",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-a",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-f",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-F",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-G",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-h",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-soname",          {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"--soname",         {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-R",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-rpath",           {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"--rpath",          {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-rpath-link",      {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"--rpath-link",     {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-dynamic-linker",  {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"--dynamic-linker", {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-Map",             {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-init",            {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-fini",            {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-Y",               {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"-A",               {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_OR_SEP,     CompilerFlagType::LINKER}},
+            {"-assert",          {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"--defsym",         {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"--wrap",           {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"--undefined",      {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-plugin",          {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"--plugin",         {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-plugin-opt",      {MatchInstruction::EXACTLY_WITH_1_OPT_SEP,              CompilerFlagType::LINKER}},
+            {"--plugin-opt",     {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"--sysroot",        {MatchInstruction::EXACTLY_WITH_1_OPT_GLUED_WITH_EQ_OR_SEP, CompilerFlagType::LINKER}},
+            {"-",                {MatchInstruction::PREFIX,                              CompilerFlagType::LINKER}},
+            {"--",               {MatchInstruction::PREFIX,                              CompilerFlagType::LINKER}},
+    };
+
+    rust::Result<SemanticPtr> ToolLd::recognize(const Execution &execution) const {
+        if (is_linker_call(execution.executable)) {
+            return linking(FLAG_DEFINITION, execution);
+        }
+        return rust::Ok(SemanticPtr());
+    }
+
+    bool ToolLd::is_linker_call(const fs::path& program) const {
+        static const auto pattern = std::regex(
+                // - ld
+                // - ld.bfd, ld.gold, ld.lld, ld.mold
+                //   - with prefixes like: arm-none-eabi-
+                // - gold, mold, lld
+                //   - with postfixes like: -15
+                R"(^(([^-]*-)*ld(\.(bfd|gold|lld|mold))?|gold|mold|lld(-\d+)?)$)"
+        );
+
+        std::cmatch m;
+        return std::regex_match(program.filename().c_str(), m, pattern);
+    }
+
+    rust::Result<SemanticPtr> ToolLd::linking(const FlagsByName &flags, const Execution &execution) {
+        const auto &parser =
+                Repeat(
+                        OneOf(
+                                FlagParser(flags),
+                                EverythingElseFlagMatcher()
+                        )
+                );
+
+        Arguments raw_arguments;
+        std::copy(execution.arguments.begin(), execution.arguments.end(), std::back_inserter(raw_arguments));
+        const Arguments input_arguments = expand_response_files(raw_arguments, execution.working_dir);
+        return parse(parser, input_arguments)
+                .and_then<SemanticPtr>([&execution, &input_arguments](auto flags) -> rust::Result<SemanticPtr> {
+                    if (is_linker_query(flags)) {
+                        SemanticPtr result = std::make_shared<QueryCompiler>();
+                        return rust::Ok(std::move(result));
+                    }
+
+                    auto[inputs, output] = split(flags);
+                    // Validate: must have input files.
+                    if (inputs.empty()) {
+                        return rust::Err(std::runtime_error("Input files not found for linking."));
+                    }
+
+                    SemanticPtr result = std::make_shared<Link>(
+                            execution.working_dir,
+                            execution.executable,
+                            input_arguments,
+                            std::move(inputs),
+                            std::move(output)
+                    );
+                    return rust::Ok(std::move(result));
+                });
+    }
+}
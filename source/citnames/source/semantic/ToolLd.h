@@ -0,0 +1,48 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Tool.h"
+#include "Parsers.h"
+
+namespace cs::semantic {
+
+    // Recognizes direct linker calls and returns a Link semantic,
+    // which goes into the link commands database.
+    struct ToolLd : public Tool {
+
+        [[nodiscard]]
+        rust::Result<SemanticPtr> recognize(const Execution &execution) const override;
+
+        [[nodiscard]]
+        std::string name() const override {
+            return "ld";
+        }
+
+    protected:
+        [[nodiscard]]
+        virtual bool is_linker_call(const fs::path& program) const;
+
+        [[nodiscard]]
+        static rust::Result<SemanticPtr> linking(const FlagsByName &flags, const Execution &execution);
+
+        static const FlagsByName FLAG_DEFINITION;
+    };
+}
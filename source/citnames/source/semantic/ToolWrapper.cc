@@ -41,17 +41,52 @@ namespace {
 namespace cs::semantic {
 
     rust::Result<SemanticPtr> ToolWrapper::recognize(const Execution &execution) const {
-        if (is_ccache_call(execution.executable)) {
-            return is_ccache_query(execution.arguments)
-                    ? rust::Ok<SemanticPtr>(std::make_shared<QueryCompiler>())
-                    : compilation(remove_wrapper(execution));
+        el::Resolver resolver;
+        return recognize(resolver, execution);
+    }
+
+    rust::Result<SemanticPtr> ToolWrapper::recognize(el::Resolver &resolver, const Execution &execution) {
+        // Peel the wrapper prefixes by advancing a window over the argument
+        // list; a chain like "ccache distcc gcc" is unwrapped in one pass,
+        // without assembling an execution object per layer.
+        auto program = execution.executable;
+        auto begin = execution.arguments.begin();
+        const auto end = execution.arguments.end();
+        bool wrapped = false;
+        for (;;) {
+            if (is_ccache_call(program)) {
+                const auto inner = (begin == end) ? end : std::next(begin);
+                if (inner == end || looks_like_ccache_parameter(*inner)) {
+                    return rust::Ok<SemanticPtr>(std::make_shared<QueryCompiler>());
+                }
+                begin = inner;
+            } else if (is_distcc_call(program)) {
+                const auto inner = (begin == end) ? end : std::next(begin);
+                if (inner == end || looks_like_distcc_parameter(*inner)) {
+                    return rust::Ok<SemanticPtr>(std::make_shared<QueryCompiler>());
+                }
+                begin = inner;
+            } else {
+                break;
+            }
+            program = fs::path(*begin);
+            wrapped = true;
         }
-        if (is_distcc_call(execution.executable)) {
-            return is_distcc_query(execution.arguments)
-                    ? rust::Ok<SemanticPtr>(std::make_shared<QueryCompiler>())
-                    : compilation(remove_wrapper(execution));
+        if (!wrapped) {
+            return rust::Ok(SemanticPtr());
+        }
+        // use resolver to get the full path to the wrapped executable.
+        if (const auto path = execution.environment.find("PATH"); path != execution.environment.end()) {
+            if (const auto candidate = resolver.from_search_path(program.string(), path->second.c_str()); candidate.is_ok()) {
+                program = fs::path(candidate.unwrap());
+            }
         }
-        return rust::Ok(SemanticPtr());
+        return compilation(
+                FLAG_DEFINITION,
+                execution.working_dir,
+                program,
+                Arguments(begin, end),
+                execution.environment);
     }
 
     bool ToolWrapper::is_ccache_call(const fs::path &program) {
@@ -84,31 +119,4 @@ namespace cs::semantic {
         return false;
     }
 
-    domain::Execution ToolWrapper::remove_wrapper(const Execution &execution) {
-        el::Resolver resolver;
-        return remove_wrapper(resolver, execution);
-    }
-
-    domain::Execution ToolWrapper::remove_wrapper(el::Resolver &resolver, const Execution &execution) {
-        auto environment = execution.environment;
-        if (const auto path = environment.find("PATH"); path != environment.end()) {
-            // take the second argument as a program candidate
-            const auto program = std::next(execution.arguments.begin());
-            if (program != execution.arguments.end()) {
-                // use resolver to get the full path to the executable.
-                const auto candidate = resolver.from_search_path(*program, path->second.c_str());
-                if (candidate.is_ok()) {
-                    domain::Execution copy = execution;
-                    copy.arguments.pop_front();
-                    copy.executable = candidate.unwrap();
-                    return copy;
-                }
-            }
-        }
-        // fall back to the second argument as an executable.
-        domain::Execution copy = execution;
-        copy.arguments.pop_front();
-        copy.executable = copy.arguments.front();
-        return copy;
-    }
 }
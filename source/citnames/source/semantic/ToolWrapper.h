@@ -34,6 +34,11 @@ namespace cs::semantic {
         [[nodiscard]]
         rust::Result<SemanticPtr> recognize(const Execution &execution) const override;
 
+        [[nodiscard]]
+        std::string name() const override {
+            return "wrapper";
+        }
+
     // visible for testing
     public:
         static bool is_ccache_call(const fs::path &program);
@@ -42,7 +47,6 @@ namespace cs::semantic {
         static bool is_distcc_call(const fs::path &program);
         static bool is_distcc_query(const std::list<std::string> &arguments);
 
-        static domain::Execution remove_wrapper(const domain::Execution &);
-        static domain::Execution remove_wrapper(el::Resolver &, const domain::Execution &);
+        static rust::Result<SemanticPtr> recognize(el::Resolver &, const domain::Execution &);
     };
 }
@@ -0,0 +1,73 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "Arena.h"
+
+#include <string>
+#include <string_view>
+
+namespace {
+
+    TEST(arena, starts_empty) {
+        cs::Arena arena;
+        EXPECT_EQ(0, arena.size());
+    }
+
+    TEST(arena, append_returns_the_offset) {
+        cs::Arena arena;
+        EXPECT_EQ(0, arena.append("first"));
+        EXPECT_EQ(5, arena.append("second"));
+        EXPECT_EQ(11, arena.size());
+        EXPECT_EQ("firstsecond", std::string(arena.data(), arena.size()));
+    }
+
+    TEST(arena, bytes_survive_growth) {
+        cs::Arena arena;
+        const std::string value(1024, 'x');
+        for (size_t count = 0; count < 8 * 1024; ++count) {
+            EXPECT_EQ(count * value.size(), arena.append(value));
+        }
+        EXPECT_EQ(8 * 1024 * value.size(), arena.size());
+        const std::string_view content(arena.data(), arena.size());
+        EXPECT_EQ(std::string_view::npos, content.find_first_not_of('x'));
+    }
+
+    TEST(arena, bytes_survive_growth_with_huge_pages) {
+        cs::Arena::use_huge_pages(true);
+        cs::Arena arena;
+        const std::string value(1024, 'y');
+        for (size_t count = 0; count < 8 * 1024; ++count) {
+            EXPECT_EQ(count * value.size(), arena.append(value));
+        }
+        cs::Arena::use_huge_pages(false);
+        EXPECT_EQ(8 * 1024 * value.size(), arena.size());
+        const std::string_view content(arena.data(), arena.size());
+        EXPECT_EQ(std::string_view::npos, content.find_first_not_of('y'));
+    }
+
+    TEST(arena, move_takes_the_bytes) {
+        cs::Arena source;
+        source.append("payload");
+        cs::Arena target(std::move(source));
+        EXPECT_EQ(7, target.size());
+        EXPECT_EQ("payload", std::string(target.data(), target.size()));
+    }
+}
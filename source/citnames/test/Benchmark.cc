@@ -0,0 +1,160 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "semantic/Parsers.h"
+#include "semantic/ToolAny.h"
+#include "semantic/ToolClang.h"
+#include "semantic/ToolCuda.h"
+#include "semantic/ToolGcc.h"
+#include "semantic/ToolWrapper.h"
+#include "libshell/Command.h"
+
+#include <fstream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace cs::semantic;
+
+namespace {
+
+    // Expose the flag table the same way the unit tests reach the
+    // protected members.
+    struct Expose : public ToolGcc {
+        using ToolGcc::FLAG_DEFINITION;
+    };
+
+    // The corpus holds one real command line per line; comments start
+    // with a hash mark. Extend the file when a new command shape shows
+    // up in production profiles.
+    std::vector<std::string> load_corpus() {
+        std::vector<std::string> result;
+        std::ifstream source(BENCHMARK_DATA_DIR "/commands.txt");
+        for (std::string line; std::getline(source, line);) {
+            if (!line.empty() && (line.front() != '#')) {
+                result.emplace_back(std::move(line));
+            }
+        }
+        return result;
+    }
+
+    const std::vector<std::string> CORPUS = load_corpus();
+
+    domain::Execution to_execution(const std::string &command) {
+        const auto words = sh::split(command).unwrap_or({});
+        return domain::Execution {
+                fs::path(words.empty() ? "true" : words.front()),
+                std::list<std::string>(words.begin(), words.end()),
+                fs::path("/home/user/project"),
+                {},
+        };
+    }
+
+    std::vector<domain::Execution> to_executions() {
+        std::vector<domain::Execution> result;
+        for (const auto &command : CORPUS) {
+            result.emplace_back(to_execution(command));
+        }
+        return result;
+    }
+
+    std::shared_ptr<Tool> create_tools() {
+        // The same tool list Build assembles from an empty configuration.
+        ToolAny::ToolPtrs tools = {
+                std::make_shared<ToolGcc>(),
+                std::make_shared<ToolClang>(),
+                std::make_shared<ToolWrapper>(),
+                std::make_shared<ToolCuda>(),
+        };
+        return std::make_shared<ToolAny>(std::move(tools), std::list<fs::path>());
+    }
+
+    void shell_split(benchmark::State &state) {
+        size_t bytes = 0;
+        for (auto _ : state) {
+            for (const auto &command : CORPUS) {
+                auto words = sh::split(command);
+                benchmark::DoNotOptimize(words);
+                bytes += command.size();
+            }
+        }
+        state.SetBytesProcessed(int64_t(bytes));
+    }
+
+    void flag_parser(benchmark::State &state) {
+        const auto parser =
+                Repeat(
+                        OneOf(
+                                FlagParser(Expose::FLAG_DEFINITION),
+                                SourceMatcher(),
+                                EverythingElseFlagMatcher()
+                        )
+                );
+        std::vector<Arguments> inputs;
+        for (const auto &execution : to_executions()) {
+            inputs.emplace_back(Arguments(execution.arguments.begin(), execution.arguments.end()));
+        }
+        for (auto _ : state) {
+            for (const auto &input : inputs) {
+                auto flags = parse(parser, input);
+                benchmark::DoNotOptimize(flags);
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * inputs.size()));
+    }
+
+    void tool_recognize_first_sight(benchmark::State &state) {
+        const auto executions = to_executions();
+        for (auto _ : state) {
+            // A fresh tool set, so every executable is dispatched through
+            // the full recognition chain. (This is the once-per-binary
+            // cost of a citnames run.)
+            const auto tools = create_tools();
+            for (const auto &execution : executions) {
+                auto semantic = tools->recognize(execution);
+                benchmark::DoNotOptimize(semantic);
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * executions.size()));
+    }
+
+    void tool_recognize_cached(benchmark::State &state) {
+        const auto executions = to_executions();
+        const auto tools = create_tools();
+        for (auto _ : state) {
+            // The executables repeat, like the compiler calls of a real
+            // build; ToolAny serves them from its dispatch cache.
+            for (const auto &execution : executions) {
+                auto semantic = tools->recognize(execution);
+                benchmark::DoNotOptimize(semantic);
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * executions.size()));
+    }
+
+    BENCHMARK(shell_split);
+    BENCHMARK(flag_parser);
+    BENCHMARK(tool_recognize_first_sight);
+    BENCHMARK(tool_recognize_cached);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,113 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "OrderedEmitter.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    TEST(ordered_emitter, holds_a_result_until_the_gap_closes)
+    {
+        cs::OrderedEmitter<int> sut(0);
+        std::vector<size_t> emitted;
+        const auto consumer = [&emitted](size_t position, int &&) {
+            emitted.push_back(position);
+        };
+
+        sut.emit(2, 20, consumer);
+        EXPECT_TRUE(emitted.empty());
+        sut.emit(1, 10, consumer);
+        EXPECT_TRUE(emitted.empty());
+        // the gap closer drains everything which became contiguous.
+        sut.emit(0, 0, consumer);
+        EXPECT_EQ((std::vector<size_t>{0, 1, 2}), emitted);
+    }
+
+    TEST(ordered_emitter, starts_at_the_given_position)
+    {
+        // the skip of a resumed run: earlier positions never arrive.
+        cs::OrderedEmitter<int> sut(5);
+        std::vector<int> emitted;
+        const auto consumer = [&emitted](size_t, int &&value) {
+            emitted.push_back(value);
+        };
+
+        sut.emit(6, 60, consumer);
+        EXPECT_TRUE(emitted.empty());
+        sut.emit(5, 50, consumer);
+        EXPECT_EQ((std::vector<int>{50, 60}), emitted);
+    }
+
+    TEST(ordered_emitter, baton_hand_off_keeps_the_order)
+    {
+        // A pool of workers completing positions out of order; whatever
+        // the interleaving, the consumer shall observe every position
+        // exactly once, in order. (Meant to run under the thread
+        // sanitizer too: the consumer state is unguarded on purpose,
+        // only the draining worker may touch it.)
+        constexpr size_t WORKERS = 8;
+        constexpr size_t EVENTS = 20000;
+
+        cs::OrderedEmitter<size_t> sut(0);
+        std::vector<size_t> emitted;
+        emitted.reserve(EVENTS);
+        size_t checksum = 0;
+        const auto consumer = [&emitted, &checksum](size_t position, size_t &&value) {
+            emitted.push_back(position);
+            checksum += value;
+        };
+
+        std::atomic<size_t> ticket(0);
+        std::vector<std::thread> workers;
+        workers.reserve(WORKERS);
+        for (size_t index = 0; index < WORKERS; ++index) {
+            workers.emplace_back([&sut, &ticket, &consumer, index]() {
+                std::mt19937 generator{unsigned(index)};
+                std::uniform_int_distribution<int> jitter(0, 3);
+                for (;;) {
+                    const size_t position = ticket.fetch_add(1);
+                    if (position >= EVENTS) {
+                        break;
+                    }
+                    // make the completion order diverge from the
+                    // position order.
+                    for (int spin = jitter(generator); spin > 0; --spin) {
+                        std::this_thread::yield();
+                    }
+                    sut.emit(position, position * 2, consumer);
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        ASSERT_EQ(EVENTS, emitted.size());
+        for (size_t position = 0; position < EVENTS; ++position) {
+            EXPECT_EQ(position, emitted[position]) << "at position " << position;
+        }
+        EXPECT_EQ(EVENTS * (EVENTS - 1), checksum);
+    }
+}
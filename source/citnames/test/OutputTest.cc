@@ -21,6 +21,10 @@
 
 #include "Output.h"
 
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
 #include <iterator>
 
 namespace {
@@ -65,9 +69,9 @@ namespace {
     TEST(compilation_database, same_entries_read_back)
     {
         std::list<cs::Entry> expected = {
-                { "entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
-                { "entries.c", "/path/to", { "entries.o" }, { "cc", "-c", "-o", "entries.o", "entries.c" } },
+                { "/path/to/entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entries.c", "/path/to", { "/path/to/entries.o" }, { "cc", "-c", "-o", "entries.o", "entries.c" } },
         };
 
         value_serialized_and_read_back(expected, expected, AS_ARGUMENTS);
@@ -77,31 +81,42 @@ namespace {
     TEST(compilation_database, entries_without_output_read_back)
     {
         std::list<cs::Entry> input = {
-                { "entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
-                { "entries.c", "/path/to", { "entries.o" }, { "cc", "-c", "-o", "entries.o", "entries.c" } },
+                { "/path/to/entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entries.c", "/path/to", { "/path/to/entries.o" }, { "cc", "-c", "-o", "entries.o", "entries.c" } },
         };
         std::list<cs::Entry> expected = {
-                { "entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
-                { "entries.c", "/path/to", std::nullopt, { "cc", "-c", "-o", "entries.o", "entries.c" } },
+                { "/path/to/entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entries.c", "/path/to", std::nullopt, { "cc", "-c", "-o", "entries.o", "entries.c" } },
         };
 
         value_serialized_and_read_back(input, expected, AS_ARGUMENTS_NO_OUTPUT);
         value_serialized_and_read_back(input, expected, AS_COMMAND_NO_OUTPUT);
     }
 
+    TEST(compilation_database, escaped_characters_read_back)
+    {
+        std::list<cs::Entry> expected = {
+                { "/path/to/we ird\"name\\.c", "/path/\tto", std::nullopt,
+                  { "cc", "-c", "-DMESSAGE=\"multi\nline\"", "we ird\"name\\.c" } },
+        };
+
+        value_serialized_and_read_back(expected, expected, AS_ARGUMENTS);
+        value_serialized_and_read_back(expected, expected, AS_COMMAND);
+    }
+
     TEST(compilation_database, merged_entries_read_back)
     {
         std::list<cs::Entry> input = {
-                { "entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
-                { "entry_one.c", "/path/to", std::nullopt, { "cc1", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", std::nullopt, { "cc1", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to", std::nullopt, { "cc1", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", std::nullopt, { "cc1", "-c", "entry_two.c" } },
         };
         std::list<cs::Entry> expected = {
-                { "entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to", std::nullopt, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", std::nullopt, { "cc", "-c", "entry_two.c" } },
         };
 
         value_serialized_and_read_back(input, expected, AS_ARGUMENTS);
@@ -113,14 +128,14 @@ namespace {
     TEST(compilation_database, duplicate_entries_file_read_back)
     {
         std::list<cs::Entry> input = {
-                { "entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
-                { "entry_one.c", "/path/to/changed", { "entry_one2.o" }, { "cc1", "-c", "-o", "entry_one2.o", "entry_one.c" } },
-                { "entry_two.c", "/path/to/changed", { "entry_two2.o" }, { "cc1", "-c", "-o", "entry_two2.o", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to/changed", { "/path/to/entry_one2.o" }, { "cc1", "-c", "-o", "entry_one2.o", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to/changed", { "/path/to/entry_two2.o" }, { "cc1", "-c", "-o", "entry_two2.o", "entry_two.c" } },
         };
         std::list<cs::Entry> expected = {
-                { "entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
         };
 
         cs::Content content;
@@ -131,18 +146,18 @@ namespace {
     TEST(compilation_database, duplicate_entries_file_output_read_back)
     {
         std::list<cs::Entry> input = {
-                { "entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
-                { "entry_one.c", "/path/to/changed", { "entry_one2.o" }, { "cc1", "-c", "-o", "entry_one2.o", "entry_one.c" } },
-                { "entry_two.c", "/path/to/changed", { "entry_two2.o" }, { "cc1", "-c", "-o", "entry_two2.o", "entry_two.c" } },
-                { "entry_one.c", "/path/to/changed", { "entry_one.o" }, { "cc1", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to/changed", { "entry_two.o" }, { "cc1", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to/changed", { "/path/to/entry_one2.o" }, { "cc1", "-c", "-o", "entry_one2.o", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to/changed", { "/path/to/entry_two2.o" }, { "cc1", "-c", "-o", "entry_two2.o", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to/changed", { "/path/to/entry_one.o" }, { "cc1", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to/changed", { "/path/to/entry_two.o" }, { "cc1", "-c", "entry_two.c" } },
         };
         std::list<cs::Entry> expected = {
-                { "entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
-                { "entry_one.c", "/path/to/changed", { "entry_one2.o" }, { "cc1", "-c", "-o", "entry_one2.o", "entry_one.c" } },
-                { "entry_two.c", "/path/to/changed", { "entry_two2.o" }, { "cc1", "-c", "-o", "entry_two2.o", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_one.c", "/path/to/changed", { "/path/to/entry_one2.o" }, { "cc1", "-c", "-o", "entry_one2.o", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to/changed", { "/path/to/entry_two2.o" }, { "cc1", "-c", "-o", "entry_two2.o", "entry_two.c" } },
         };
 
         cs::Content content;
@@ -153,30 +168,30 @@ namespace {
     TEST(compilation_database, duplicate_entries_all_read_back)
     {
         std::list<cs::Entry> input = {
-                { "entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
-                { "entry_three.c", "/path/to", { "entry_three.o" }, { "cc", "-c", "entry_three.c" } },
+                { "/path/to/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_three.c", "/path/to", { "/path/to/entry_three.o" }, { "cc", "-c", "entry_three.c" } },
 
                 // Filename changed
-                { "entry_one.changed.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_one.changed.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
 
                 // Output changed
-                { "entry_two.c", "/path/to", { "entry_two_changed.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two_changed.o" }, { "cc", "-c", "entry_two.c" } },
 
                 // Flags changed
-                { "entry_three.c", "/path/to", { "entry_three.o" }, { "cc", "-DCHANGED", "-c", "entry_three.c" } },
+                { "/path/to/entry_three.c", "/path/to", { "/path/to/entry_three.o" }, { "cc", "-DCHANGED", "-c", "entry_three.c" } },
 
-                { "entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
-                { "entry_three.c", "/path/to", { "entry_three.o" }, { "cc", "-c", "entry_three.c" } },
+                { "/path/to/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_three.c", "/path/to", { "/path/to/entry_three.o" }, { "cc", "-c", "entry_three.c" } },
         };
         std::list<cs::Entry> expected = {
-                { "entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
-                { "entry_three.c", "/path/to", { "entry_three.o" }, { "cc", "-c", "entry_three.c" } },
-                { "entry_one.changed.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-                { "entry_two.c", "/path/to", { "entry_two_changed.o" }, { "cc", "-c", "entry_two.c" } },
-                { "entry_three.c", "/path/to", { "entry_three.o" }, { "cc", "-DCHANGED", "-c", "entry_three.c" } },
+                { "/path/to/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_three.c", "/path/to", { "/path/to/entry_three.o" }, { "cc", "-c", "entry_three.c" } },
+                { "/path/to/entry_one.changed.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+                { "/path/to/entry_two.c", "/path/to", { "/path/to/entry_two_changed.o" }, { "cc", "-c", "entry_two.c" } },
+                { "/path/to/entry_three.c", "/path/to", { "/path/to/entry_three.o" }, { "cc", "-DCHANGED", "-c", "entry_three.c" } },
 
         };
 
@@ -222,14 +237,14 @@ namespace {
     TEST(compilation_database, include_filter_works_with_trailing_slash)
     {
         std::list<cs::Entry> input = {
-            { "/home/user/project/build/source/entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-            { "/home/user/project/build/source/entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
-            { "/home/user/project/build/test/entry_one_test.c", "/path/to", { "entry_one_test.o" }, { "cc", "-c", "entry_one.c" } },
-            { "/home/user/project/build/test/entry_two_test.c", "/path/to", { "entry_two_test.o" }, { "cc", "-c", "entry_two.c" } },
+            { "/home/user/project/build/source/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+            { "/home/user/project/build/source/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+            { "/home/user/project/build/test/entry_one_test.c", "/path/to", { "/path/to/entry_one_test.o" }, { "cc", "-c", "entry_one.c" } },
+            { "/home/user/project/build/test/entry_two_test.c", "/path/to", { "/path/to/entry_two_test.o" }, { "cc", "-c", "entry_two.c" } },
         };
         std::list<cs::Entry> expected = {
-            { "/home/user/project/build/source/entry_one.c", "/path/to", { "entry_one.o" }, { "cc", "-c", "entry_one.c" } },
-            { "/home/user/project/build/source/entry_two.c", "/path/to", { "entry_two.o" }, { "cc", "-c", "entry_two.c" } },
+            { "/home/user/project/build/source/entry_one.c", "/path/to", { "/path/to/entry_one.o" }, { "cc", "-c", "entry_one.c" } },
+            { "/home/user/project/build/source/entry_two.c", "/path/to", { "/path/to/entry_two.o" }, { "cc", "-c", "entry_two.c" } },
         };
 
         cs::Content content;
@@ -241,4 +256,368 @@ namespace {
         content.paths_to_exclude = { fs::path("/home/user/project/build/test/") };
         value_serialized_and_read_back(input, expected, AS_ARGUMENTS, content);
     }
+
+    TEST(compilation_database, sorted_entries_ordered_by_file)
+    {
+        const std::list<cs::Entry> input = {
+                { "/path/to/two.c", "/path/to", std::nullopt, { "cc", "-c", "two.c" } },
+                { "/path/to/one.c", "/path/to", std::nullopt, { "cc", "-c", "-O2", "one.c" } },
+                { "/path/to/one.c", "/path/to", std::nullopt, { "cc", "-c", "-O0", "one.c" } },
+        };
+        const std::list<cs::Entry> expected = {
+                { "/path/to/one.c", "/path/to", std::nullopt, { "cc", "-c", "-O0", "one.c" } },
+                { "/path/to/one.c", "/path/to", std::nullopt, { "cc", "-c", "-O2", "one.c" } },
+                { "/path/to/two.c", "/path/to", std::nullopt, { "cc", "-c", "two.c" } },
+        };
+
+        cs::Format format = AS_ARGUMENTS;
+        format.sort_entries = true;
+        cs::Content content;
+        content.duplicate_filter_fields = cs::DUPLICATE_ALL;
+        cs::CompilationDatabase sut(format, content);
+        std::stringstream buffer;
+
+        EXPECT_TRUE(sut.to_json(buffer, input).is_ok());
+
+        std::list<cs::Entry> deserialized;
+        EXPECT_TRUE(sut.from_json(buffer, deserialized).is_ok());
+        EXPECT_EQ(expected, deserialized);
+    }
+
+    TEST(compilation_database, shards_by_top_level_directory)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-test-" + std::to_string(getpid()));
+        fs::create_directories(root / "lib");
+        fs::create_directories(root / "app");
+
+        const std::list<cs::Entry> input = {
+                { root / "lib" / "one.c", root, std::nullopt, { "cc", "-c", "one.c" } },
+                { root / "lib" / "nested" / "two.c", root, std::nullopt, { "cc", "-c", "two.c" } },
+                { root / "app" / "main.c", root, std::nullopt, { "cc", "-c", "main.c" } },
+                { root / "top.c", root, std::nullopt, { "cc", "-c", "top.c" } },
+        };
+
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        const fs::path file = root / "compile_commands.json";
+        EXPECT_TRUE(sut.to_json(file, input).is_ok());
+
+        auto sharded = sut.to_json_shards(file);
+        EXPECT_TRUE(sharded.is_ok());
+        // the entry directly under the root stays in the main database only.
+        EXPECT_EQ(3, sharded.unwrap());
+
+        std::list<cs::Entry> lib_entries;
+        EXPECT_TRUE(sut.from_json(root / "lib" / "compile_commands.json", lib_entries).is_ok());
+        EXPECT_EQ(2, lib_entries.size());
+
+        std::list<cs::Entry> app_entries;
+        EXPECT_TRUE(sut.from_json(root / "app" / "compile_commands.json", app_entries).is_ok());
+        EXPECT_EQ(1, app_entries.size());
+
+        fs::remove_all(root);
+    }
+
+    TEST(compilation_database, append_extends_the_database_via_the_index)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-append-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+        const fs::path file = root / "compile_commands.json";
+
+        const std::list<cs::Entry> old_entries = {
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/two.c", "/path/to", { "/path/to/two.o" }, { "cc", "-c", "two.c" } },
+        };
+        const std::list<cs::Entry> new_entries = {
+                // already in the database, shall not duplicate.
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/three.c", "/path/to", { "/path/to/three.o" }, { "cc", "-c", "three.c" } },
+        };
+
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        EXPECT_TRUE(sut.to_json(file, old_entries).is_ok());
+
+        auto appended = sut.to_json_append(file, new_entries);
+        EXPECT_TRUE(appended.is_ok());
+        EXPECT_EQ(3, appended.unwrap());
+
+        std::list<cs::Entry> read_back;
+        EXPECT_TRUE(sut.from_json(file, read_back).is_ok());
+        const std::list<cs::Entry> expected = {
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/two.c", "/path/to", { "/path/to/two.o" }, { "cc", "-c", "two.c" } },
+                { "/path/to/three.c", "/path/to", { "/path/to/three.o" }, { "cc", "-c", "three.c" } },
+        };
+        EXPECT_EQ(expected, read_back);
+
+        fs::remove_all(root);
+    }
+
+    TEST(compilation_database, append_fails_when_it_needs_a_merge)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-append-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+        const fs::path file = root / "compile_commands.json";
+
+        const std::list<cs::Entry> old_entries = {
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+        };
+        // the same file compiles with different flags now: the old entry
+        // needs to be replaced, which the splicing append cannot do.
+        const std::list<cs::Entry> new_entries = {
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "-O2", "one.c" } },
+        };
+
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        EXPECT_TRUE(sut.to_json(file, old_entries).is_ok());
+        EXPECT_TRUE(sut.to_json_append(file, new_entries).is_err());
+
+        // without the index sidecar it fails too.
+        fs::remove(fs::path(file.string() + ".index"));
+        EXPECT_TRUE(sut.to_json_append(file, new_entries).is_err());
+
+        fs::remove_all(root);
+    }
+
+    TEST(compilation_database, filtered_view_writes_the_surviving_entries)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-view-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+
+        cs::Content content;
+        content.paths_to_exclude = { fs::path("/path/to/test") };
+        const cs::OutputView view { "no-tests", root / "view_commands.json", content };
+
+        cs::FilteredView sut(AS_ARGUMENTS, view);
+        sut.push({
+                { "/path/to/src/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/test/one_test.c", "/path/to", { "/path/to/one_test.o" }, { "cc", "-c", "one_test.c" } },
+        });
+        sut.push({
+                // a duplicate of the first batch, shall not show up twice.
+                { "/path/to/src/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/src/two.c", "/path/to", { "/path/to/two.o" }, { "cc", "-c", "two.c" } },
+        });
+
+        auto written = sut.write();
+        EXPECT_TRUE(written.is_ok());
+        EXPECT_EQ(2, written.unwrap_or(0));
+
+        const std::list<cs::Entry> expected = {
+                { "/path/to/src/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/src/two.c", "/path/to", { "/path/to/two.o" }, { "cc", "-c", "two.c" } },
+        };
+        std::list<cs::Entry> read_back;
+        cs::CompilationDatabase reader(AS_ARGUMENTS, DEFAULT_CONTENT);
+        EXPECT_TRUE(reader.from_json(view.file, read_back).is_ok());
+        EXPECT_EQ(expected, read_back);
+
+        fs::remove_all(root);
+    }
+
+    // A corpus big enough to cross the parallel parse threshold, with
+    // content that stresses the chunk boundary scanner: braces, brackets,
+    // commas and escaped quotes inside the string values.
+    std::list<cs::Entry> large_corpus()
+    {
+        const std::string filler(512, 'x');
+        std::list<cs::Entry> result;
+        for (size_t index = 0; index < 12000; ++index) {
+            const std::string name = "source_" + std::to_string(index);
+            result.push_back({
+                    "/path/to/project/src/" + name + ".c",
+                    "/path/to/project",
+                    { "/path/to/project/objects/" + name + ".o" },
+                    { "cc", "-c", "-O2",
+                      "-DMESSAGE=\"a {quoted} [value], with \\\"escapes\\\", commas\"",
+                      "-I/path/to/project/include",
+                      "-DFILLER=" + filler,
+                      "src/" + name + ".c" } });
+        }
+        return result;
+    }
+
+    TEST(compilation_database, chunked_parallel_parse_matches_the_streaming_parse)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-parallel-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+        const fs::path file = root / "compile_commands.json";
+
+        const auto corpus = large_corpus();
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        {
+            // through a plain stream: no index sidecar, so the read has
+            // to parse the content instead of trusting the writer.
+            std::ofstream sink(file);
+            EXPECT_TRUE(sut.to_json(sink, corpus).is_ok());
+        }
+        ASSERT_GE(fs::file_size(file), 8 * 1024 * 1024);
+
+        // the file path goes through the memory mapped chunked parse
+        // (on a multi core host), the stream through the row-by-row
+        // reader; the entries shall agree byte for byte, in order.
+        std::list<cs::Entry> mapped;
+        EXPECT_TRUE(sut.from_json(file, mapped).is_ok());
+
+        std::ifstream source(file);
+        std::list<cs::Entry> streamed;
+        EXPECT_TRUE(sut.from_json(source, streamed).is_ok());
+
+        EXPECT_EQ(corpus, mapped);
+        EXPECT_EQ(streamed, mapped);
+
+        fs::remove_all(root);
+    }
+
+    TEST(compilation_database, columnar_digests_match_the_row_digests)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-columnar-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+        const fs::path file = root / "compile_commands.json";
+
+        // a mixed corpus: a third of the entries carry no output field.
+        auto corpus = large_corpus();
+        size_t position = 0;
+        for (auto &entry : corpus) {
+            if (++position % 3 == 0) {
+                entry.output.reset();
+            }
+        }
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        EXPECT_TRUE(sut.to_json(file, corpus).is_ok());
+        ASSERT_GE(fs::file_size(file), 8 * 1024 * 1024);
+
+        // the index sidecar holds the digests the row serializer computed
+        // while writing the file.
+        auto row_keys = sut.keys_of(file);
+        auto row_digests = sut.digests_of(file);
+        ASSERT_TRUE(row_keys.is_ok());
+        ASSERT_TRUE(row_digests.is_ok());
+
+        // without the sidecar, the digests come from the columnar scan of
+        // the arena views; they shall be the same numbers.
+        fs::remove(fs::path(file.string() + ".index"));
+        auto columnar_keys = sut.keys_of(file);
+        auto columnar_digests = sut.digests_of(file);
+        ASSERT_TRUE(columnar_keys.is_ok());
+        ASSERT_TRUE(columnar_digests.is_ok());
+        EXPECT_EQ(row_keys.unwrap(), columnar_keys.unwrap());
+        EXPECT_EQ(row_digests.unwrap(), columnar_digests.unwrap());
+
+        // and the entry level key computation over the streaming parse
+        // agrees too.
+        std::ifstream source(file);
+        std::list<cs::Entry> streamed;
+        EXPECT_TRUE(sut.from_json(source, streamed).is_ok());
+        std::vector<uint64_t> entry_keys;
+        entry_keys.reserve(streamed.size());
+        for (const auto &entry : streamed) {
+            entry_keys.push_back(sut.key_of(entry));
+        }
+        EXPECT_EQ(entry_keys, columnar_keys.unwrap());
+
+        fs::remove_all(root);
+    }
+
+    TEST(compilation_database, trusted_parse_round_trips_its_own_output)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-trusted-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+        const fs::path file = root / "compile_commands.json";
+
+        const std::list<cs::Entry> expected = {
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/two.c", "/path/to", std::nullopt, { "cc", "-c", "two.c" } },
+                { "/path/to/we ird\"name\\.c", "/path/to", std::nullopt,
+                  { "cc", "-c", "-DMESSAGE=\"multi\nline\"", "we ird\"name\\.c" } },
+        };
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        EXPECT_TRUE(sut.to_json(file, expected).is_ok());
+
+        // the index sidecar marks the file self produced, so this read
+        // goes through the trusted parser.
+        std::list<cs::Entry> read_back;
+        EXPECT_TRUE(sut.from_json(file, read_back).is_ok());
+        EXPECT_EQ(expected, read_back);
+
+        fs::remove_all(root);
+    }
+
+    TEST(compilation_database, tampered_database_is_not_trusted)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-tamper-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+        const fs::path file = root / "compile_commands.json";
+
+        const std::list<cs::Entry> entries = {
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+        };
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        EXPECT_TRUE(sut.to_json(file, entries).is_ok());
+
+        // overwrite one byte inside a string value with invalid UTF-8;
+        // the byte count stays the same, so a size-only fingerprint
+        // would still trust the file and hand the raw byte out.
+        {
+            std::ifstream source(file);
+            const std::string content(
+                    (std::istreambuf_iterator<char>(source)),
+                    std::istreambuf_iterator<char>());
+            const auto position = content.find("one.c");
+            ASSERT_NE(position, std::string::npos);
+            std::fstream sink(file, std::ios::binary | std::ios::in | std::ios::out);
+            sink.seekp(std::streamoff(position));
+            sink.put('\xff');
+        }
+        // a coarse timestamp filesystem could hide an immediate
+        // rewrite; make the modification time visibly different.
+        fs::last_write_time(file, fs::last_write_time(file) + std::chrono::seconds(2));
+
+        // the sidecar no longer describes the file, so the read lands
+        // on the validating reader, which rejects the broken encoding.
+        std::list<cs::Entry> read_back;
+        EXPECT_TRUE(sut.from_json(file, read_back).is_err());
+
+        fs::remove_all(root);
+    }
+
+    TEST(compilation_database, stale_sidecar_falls_back_to_the_strict_reader)
+    {
+        const fs::path root =
+                fs::temp_directory_path() / ("output-stale-test-" + std::to_string(getpid()));
+        fs::create_directories(root);
+        const fs::path file = root / "compile_commands.json";
+
+        const std::list<cs::Entry> expected = {
+                { "/path/to/one.c", "/path/to", { "/path/to/one.o" }, { "cc", "-c", "one.c" } },
+                { "/path/to/two.c", "/path/to", { "/path/to/two.o" }, { "cc", "-c", "two.c" } },
+        };
+        cs::CompilationDatabase sut(AS_ARGUMENTS, DEFAULT_CONTENT);
+        EXPECT_TRUE(sut.to_json(file, expected).is_ok());
+
+        // a sidecar left behind by something else: the recorded size
+        // and time do not match the file, so neither the trusted parse
+        // nor the digest shortcut applies — the strict reader serves
+        // both, correctly.
+        {
+            std::ofstream sidecar(fs::path(file.string() + ".index"));
+            sidecar << "index 2 0000000000000000 1 1 0 0\n";
+        }
+        std::list<cs::Entry> read_back;
+        EXPECT_TRUE(sut.from_json(file, read_back).is_ok());
+        EXPECT_EQ(expected, read_back);
+
+        auto keys = sut.keys_of(file);
+        ASSERT_TRUE(keys.is_ok());
+        EXPECT_EQ(expected.size(), keys.unwrap().size());
+
+        fs::remove_all(root);
+    }
 }
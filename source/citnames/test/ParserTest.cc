@@ -21,6 +21,9 @@
 
 #include "semantic/Parsers.h"
 
+#include <unistd.h>
+#include <fstream>
+
 using namespace cs::semantic;
 
 namespace cs::semantic {
@@ -341,4 +344,58 @@ namespace {
             EXPECT_EQ(expected, flags.unwrap());
         }
     }
+
+    struct ResponseFile {
+        explicit ResponseFile(const std::string &content)
+                : path(fs::temp_directory_path() / ("parser-test-" + std::to_string(getpid()) + "-" + std::to_string(counter++)))
+        {
+            std::ofstream stream(path);
+            stream << content;
+        }
+
+        ~ResponseFile() {
+            std::error_code error_code;
+            fs::remove(path, error_code);
+        }
+
+        const fs::path path;
+        static size_t counter;
+    };
+
+    size_t ResponseFile::counter = 0;
+
+    TEST(Parser, expand_response_files_without_reference) {
+        const Arguments input = {"compiler", "-c", "source.c"};
+        EXPECT_EQ(input, expand_response_files(input, fs::path("/tmp")));
+    }
+
+    TEST(Parser, expand_response_files_replaces_reference_in_place) {
+        const ResponseFile file("-I include\n-D 'NAME=\"with space\"'  -O2\n");
+
+        const Arguments input = {"compiler", "-c", "@" + file.path.string(), "source.c"};
+        const Arguments expected = {"compiler", "-c", "-I", "include", "-D", "NAME=\"with space\"", "-O2", "source.c"};
+        EXPECT_EQ(expected, expand_response_files(input, fs::path("/tmp")));
+    }
+
+    TEST(Parser, expand_response_files_resolves_against_working_dir) {
+        const ResponseFile file("-O2");
+
+        const Arguments input = {"compiler", "@" + file.path.filename().string()};
+        const Arguments expected = {"compiler", "-O2"};
+        EXPECT_EQ(expected, expand_response_files(input, file.path.parent_path()));
+    }
+
+    TEST(Parser, expand_response_files_expands_recursively) {
+        const ResponseFile inner("-O2");
+        const ResponseFile outer("-c @" + inner.path.string());
+
+        const Arguments input = {"compiler", "@" + outer.path.string()};
+        const Arguments expected = {"compiler", "-c", "-O2"};
+        EXPECT_EQ(expected, expand_response_files(input, fs::path("/tmp")));
+    }
+
+    TEST(Parser, expand_response_files_keeps_unreadable_reference) {
+        const Arguments input = {"compiler", "@/no/such/response/file"};
+        EXPECT_EQ(input, expand_response_files(input, fs::path("/tmp")));
+    }
 }
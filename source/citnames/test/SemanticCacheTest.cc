@@ -0,0 +1,124 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "SemanticCache.h"
+
+#include <unistd.h>
+#include <fstream>
+
+namespace {
+
+    struct TemporaryFile {
+        TemporaryFile()
+                : path(fs::temp_directory_path()
+                        / ("semantic-cache-test-" + std::to_string(getpid()) + "-" + std::to_string(counter++)))
+        { }
+
+        ~TemporaryFile() {
+            std::error_code error_code;
+            fs::remove(path, error_code);
+        }
+
+        const fs::path path;
+        static size_t counter;
+    };
+
+    size_t TemporaryFile::counter = 0;
+
+    cs::Recognition example_result() {
+        return cs::Recognition {
+                {
+                        cs::Entry {
+                                "/path/to/source.c",
+                                "/path/to",
+                                { "/path/to/source.o" },
+                                { "cc", "-c", "-o", "source.o", "source.c" }
+                        }
+                },
+                {}
+        };
+    }
+
+    TEST(SemanticCache, misses_on_empty) {
+        TemporaryFile file;
+        cs::SemanticCache sut(file.path, 42);
+
+        EXPECT_EQ(std::nullopt, sut.lookup(1));
+        EXPECT_EQ(0, sut.hits());
+    }
+
+    TEST(SemanticCache, answers_remembered_result) {
+        TemporaryFile file;
+        cs::SemanticCache sut(file.path, 42);
+
+        sut.remember(1, example_result());
+
+        const auto result = sut.lookup(1);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(example_result().compilations, result.value().compilations);
+        EXPECT_EQ(1, sut.hits());
+    }
+
+    TEST(SemanticCache, survives_store_and_load) {
+        TemporaryFile file;
+        {
+            cs::SemanticCache writer(file.path, 42);
+            writer.remember(1, example_result());
+            writer.remember(2, cs::Recognition {});
+            writer.store();
+        }
+        cs::SemanticCache reader(file.path, 42);
+        reader.load();
+
+        const auto result = reader.lookup(1);
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(example_result().compilations, result.value().compilations);
+        // the empty result is a result too.
+        const auto empty = reader.lookup(2);
+        ASSERT_TRUE(empty.has_value());
+        EXPECT_TRUE(empty.value().compilations.empty());
+    }
+
+    TEST(SemanticCache, configuration_change_empties) {
+        TemporaryFile file;
+        {
+            cs::SemanticCache writer(file.path, 42);
+            writer.remember(1, example_result());
+            writer.store();
+        }
+        cs::SemanticCache reader(file.path, 43);
+        reader.load();
+
+        EXPECT_EQ(std::nullopt, reader.lookup(1));
+    }
+
+    TEST(SemanticCache, corrupt_file_empties) {
+        TemporaryFile file;
+        {
+            std::ofstream stream(file.path);
+            stream << "this is not a cache file" << std::endl;
+        }
+        cs::SemanticCache sut(file.path, 42);
+        sut.load();
+
+        EXPECT_EQ(std::nullopt, sut.lookup(1));
+    }
+}
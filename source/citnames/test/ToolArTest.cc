@@ -0,0 +1,134 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "semantic/Tool.h"
+#include "semantic/ToolAr.h"
+
+using namespace cs::semantic;
+
+namespace {
+
+    TEST(ToolAr, is_archiver_call) {
+        struct Expose : public ToolAr {
+            using ToolAr::is_archiver_call;
+        };
+        Expose sut;
+
+        EXPECT_TRUE(sut.is_archiver_call("ar"));
+        EXPECT_TRUE(sut.is_archiver_call("/usr/bin/ar"));
+        EXPECT_TRUE(sut.is_archiver_call("gcc-ar"));
+        EXPECT_TRUE(sut.is_archiver_call("llvm-ar"));
+        EXPECT_TRUE(sut.is_archiver_call("llvm-ar-15"));
+        EXPECT_TRUE(sut.is_archiver_call("arm-none-eabi-ar"));
+        EXPECT_FALSE(sut.is_archiver_call("tar"));
+        EXPECT_FALSE(sut.is_archiver_call("cc"));
+    }
+
+    TEST(ToolAr, fails_on_empty) {
+        Execution input = {};
+
+        ToolAr sut;
+
+        EXPECT_TRUE(Tool::not_recognized(sut.recognize(input)));
+    }
+
+    TEST(ToolAr, simple) {
+        Execution input = {
+                "/usr/bin/ar",
+                {"ar", "rcs", "libthing.a", "main.o", "util.o"},
+                "/home/user/project",
+                {},
+        };
+        SemanticPtr expected = SemanticPtr(
+                new Link(
+                        input.working_dir,
+                        input.executable,
+                        Arguments(input.arguments.begin(), input.arguments.end()),
+                        {fs::path("main.o"), fs::path("util.o")},
+                        {fs::path("libthing.a")})
+        );
+
+        ToolAr sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
+    }
+
+    TEST(ToolAr, operation_with_dash) {
+        Execution input = {
+                "/usr/bin/ar",
+                {"ar", "-qc", "libthing.a", "main.o"},
+                "/home/user/project",
+                {},
+        };
+        SemanticPtr expected = SemanticPtr(
+                new Link(
+                        input.working_dir,
+                        input.executable,
+                        Arguments(input.arguments.begin(), input.arguments.end()),
+                        {fs::path("main.o")},
+                        {fs::path("libthing.a")})
+        );
+
+        ToolAr sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
+    }
+
+    TEST(ToolAr, plugin_option_value_is_not_member) {
+        Execution input = {
+                "/usr/bin/ar",
+                {"ar", "--plugin", "liblto_plugin.so", "r", "libthing.a", "main.o"},
+                "/home/user/project",
+                {},
+        };
+        SemanticPtr expected = SemanticPtr(
+                new Link(
+                        input.working_dir,
+                        input.executable,
+                        Arguments(input.arguments.begin(), input.arguments.end()),
+                        {fs::path("main.o")},
+                        {fs::path("libthing.a")})
+        );
+
+        ToolAr sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
+    }
+
+    TEST(ToolAr, listing_is_not_recognized) {
+        Execution input = {
+                "/usr/bin/ar",
+                {"ar", "t", "libthing.a"},
+                "/home/user/project",
+                {},
+        };
+
+        ToolAr sut;
+
+        EXPECT_TRUE(Tool::not_recognized(sut.recognize(input)));
+    }
+}
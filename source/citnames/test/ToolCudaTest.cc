@@ -0,0 +1,222 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "semantic/Tool.h"
+#include "semantic/ToolCuda.h"
+
+using namespace cs::semantic;
+
+namespace {
+
+    TEST(ToolCuda, is_compiler_call) {
+        struct Expose : public ToolCuda {
+            using ToolCuda::is_compiler_call;
+        };
+        Expose sut;
+
+        EXPECT_TRUE(sut.is_compiler_call("nvcc"));
+        EXPECT_TRUE(sut.is_compiler_call("/usr/local/cuda/bin/nvcc"));
+        EXPECT_FALSE(sut.is_compiler_call("gcc"));
+        EXPECT_FALSE(sut.is_compiler_call("nvcc-wrapper"));
+    }
+
+    TEST(ToolCuda, simple) {
+        const Execution input = {
+                "/usr/local/cuda/bin/nvcc",
+                {"nvcc", "-c", "-o", "kernel.o", "kernel.cu"},
+                "/home/user/project",
+                {},
+        };
+        const Compile expected(
+                input.working_dir,
+                input.executable,
+                {"-c"},
+                {fs::path("kernel.cu")},
+                {fs::path("kernel.o")}
+        );
+
+        ToolCuda sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_EQ(expected, *(result.unwrap().get()));
+    }
+
+    TEST(ToolCuda, forwarded_flags_kept) {
+        const Execution input = {
+                "/usr/local/cuda/bin/nvcc",
+                {
+                        "nvcc",
+                        "-c",
+                        "-Xcompiler",
+                        "-fPIC",
+                        "-Xcompiler",
+                        "-Wall",
+                        "--compiler-options",
+                        "-O2",
+                        "-o",
+                        "kernel.o",
+                        "kernel.cu"
+                },
+                "/home/user/project",
+                {},
+        };
+        const Compile expected(
+                input.working_dir,
+                input.executable,
+                {"-c", "-Xcompiler", "-fPIC", "-Xcompiler", "-Wall", "--compiler-options", "-O2"},
+                {fs::path("kernel.cu")},
+                {fs::path("kernel.o")}
+        );
+
+        ToolCuda sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_EQ(expected, *(result.unwrap().get()));
+    }
+
+    TEST(ToolCuda, forwarded_make_flags_filtered) {
+        const Execution input = {
+                "/usr/local/cuda/bin/nvcc",
+                {
+                        "nvcc",
+                        "-c",
+                        "-Xcompiler",
+                        "-MD",
+                        "-Xcompiler",
+                        "-fPIC",
+                        "-o",
+                        "kernel.o",
+                        "kernel.cu"
+                },
+                "/home/user/project",
+                {},
+        };
+        // the dependency generation pair is dropped, like the plain gcc
+        // "-MD" would be; the forwarded "-fPIC" pair stays.
+        const Compile expected(
+                input.working_dir,
+                input.executable,
+                {"-c", "-Xcompiler", "-fPIC"},
+                {fs::path("kernel.cu")},
+                {fs::path("kernel.o")}
+        );
+
+        ToolCuda sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_EQ(expected, *(result.unwrap().get()));
+    }
+
+    TEST(ToolCuda, forwarded_flag_does_not_hijack_output) {
+        const Execution input = {
+                "/usr/local/cuda/bin/nvcc",
+                {
+                        "nvcc",
+                        "-c",
+                        "-Xcompiler",
+                        "-E",
+                        "-o",
+                        "kernel.o",
+                        "kernel.cu"
+                },
+                "/home/user/project",
+                {},
+        };
+        // a forwarded "-E" is a host flag; it shall not turn the nvcc
+        // command into a preprocessor run.
+        const Compile expected(
+                input.working_dir,
+                input.executable,
+                {"-c", "-Xcompiler", "-E"},
+                {fs::path("kernel.cu")},
+                {fs::path("kernel.o")}
+        );
+
+        ToolCuda sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_EQ(expected, *(result.unwrap().get()));
+    }
+
+    TEST(ToolCuda, comma_packed_forwarding_kept) {
+        const Execution input = {
+                "/usr/local/cuda/bin/nvcc",
+                {
+                        "nvcc",
+                        "-c",
+                        "-Xcompiler",
+                        "-fPIC,-O2",
+                        "-o",
+                        "kernel.o",
+                        "kernel.cu"
+                },
+                "/home/user/project",
+                {},
+        };
+        const Compile expected(
+                input.working_dir,
+                input.executable,
+                {"-c", "-Xcompiler", "-fPIC,-O2"},
+                {fs::path("kernel.cu")},
+                {fs::path("kernel.o")}
+        );
+
+        ToolCuda sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_EQ(expected, *(result.unwrap().get()));
+    }
+
+    TEST(ToolCuda, cuda_flags_with_values) {
+        const Execution input = {
+                "/usr/local/cuda/bin/nvcc",
+                {
+                        "nvcc",
+                        "-c",
+                        "-arch", "sm_80",
+                        "-gencode", "arch=compute_80,code=sm_80",
+                        "-ccbin", "/usr/bin/g++-12",
+                        "-o", "kernel.o",
+                        "kernel.cu"
+                },
+                "/home/user/project",
+                {},
+        };
+        const Compile expected(
+                input.working_dir,
+                input.executable,
+                {"-c", "-arch", "sm_80", "-gencode", "arch=compute_80,code=sm_80", "-ccbin", "/usr/bin/g++-12"},
+                {fs::path("kernel.cu")},
+                {fs::path("kernel.o")}
+        );
+
+        ToolCuda sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_EQ(expected, *(result.unwrap().get()));
+    }
+}
@@ -0,0 +1,129 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "semantic/Tool.h"
+#include "semantic/ToolLd.h"
+
+using namespace cs::semantic;
+
+namespace {
+
+    TEST(ToolLd, is_linker_call) {
+        struct Expose : public ToolLd {
+            using ToolLd::is_linker_call;
+        };
+        Expose sut;
+
+        EXPECT_TRUE(sut.is_linker_call("ld"));
+        EXPECT_TRUE(sut.is_linker_call("/usr/bin/ld"));
+        EXPECT_TRUE(sut.is_linker_call("ld.bfd"));
+        EXPECT_TRUE(sut.is_linker_call("ld.gold"));
+        EXPECT_TRUE(sut.is_linker_call("ld.lld"));
+        EXPECT_TRUE(sut.is_linker_call("ld.mold"));
+        EXPECT_TRUE(sut.is_linker_call("gold"));
+        EXPECT_TRUE(sut.is_linker_call("mold"));
+        EXPECT_TRUE(sut.is_linker_call("lld-15"));
+        EXPECT_TRUE(sut.is_linker_call("arm-none-eabi-ld"));
+        EXPECT_FALSE(sut.is_linker_call("cc"));
+        EXPECT_FALSE(sut.is_linker_call("old"));
+    }
+
+    TEST(ToolLd, fails_on_empty) {
+        Execution input = {};
+
+        ToolLd sut;
+
+        EXPECT_TRUE(Tool::not_recognized(sut.recognize(input)));
+    }
+
+    TEST(ToolLd, simple) {
+        Execution input = {
+                "/usr/bin/ld",
+                {"ld", "-o", "exe", "main.o", "util.o", "-L.", "-lthing"},
+                "/home/user/project",
+                {},
+        };
+        SemanticPtr expected = SemanticPtr(
+                new Link(
+                        input.working_dir,
+                        input.executable,
+                        Arguments(input.arguments.begin(), input.arguments.end()),
+                        {fs::path("main.o"), fs::path("util.o")},
+                        {fs::path("exe")})
+        );
+
+        ToolLd sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
+    }
+
+    TEST(ToolLd, flag_values_are_not_inputs) {
+        Execution input = {
+                "/usr/bin/ld",
+                {"ld", "-z", "now", "--entry", "start", "-dynamic-linker", "/lib/ld.so", "-o", "exe", "main.o"},
+                "/home/user/project",
+                {},
+        };
+        SemanticPtr expected = SemanticPtr(
+                new Link(
+                        input.working_dir,
+                        input.executable,
+                        Arguments(input.arguments.begin(), input.arguments.end()),
+                        {fs::path("main.o")},
+                        {fs::path("exe")})
+        );
+
+        ToolLd sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
+    }
+
+    TEST(ToolLd, version_query) {
+        Execution input = {
+                "/usr/bin/ld",
+                {"ld", "--version"},
+                "/home/user/project",
+                {},
+        };
+
+        ToolLd sut;
+
+        auto result = sut.recognize(input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+    }
+
+    TEST(ToolLd, without_inputs_fails) {
+        Execution input = {
+                "/usr/bin/ld",
+                {"ld", "-o", "exe", "-lthing"},
+                "/home/user/project",
+                {},
+        };
+
+        ToolLd sut;
+
+        EXPECT_TRUE(Tool::recognized_with_error(sut.recognize(input)));
+    }
+}
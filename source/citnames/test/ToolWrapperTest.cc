@@ -99,49 +99,81 @@ namespace {
         EXPECT_FALSE(ToolWrapper::is_ccache_query({"distcc", "cc", "-c"}));
     }
 
-    TEST(ToolWrapper, remove_wrapper) {
+    TEST(ToolWrapper, unwraps_and_recognizes) {
         const Execution input = {
                 "/usr/bin/ccache",
                 {"ccache", "cc", "-c", "-o", "source.o", "source.c"},
                 "/home/user/project",
                 {{"PATH", "/usr/bin:/usr/sbin"}},
         };
-        const Execution expected = {
-                "/usr/bin/cc",
-                {"cc", "-c", "-o", "source.o", "source.c"},
+        SemanticPtr expected = SemanticPtr(
+                new Compile(
+                        input.working_dir,
+                        "/usr/bin/cc",
+                        {"-c"},
+                        {fs::path("source.c")},
+                        {fs::path("source.o")})
+        );
+
+        ResolverMock resolver;
+        EXPECT_CALL(resolver, from_search_path(Eq(std::string_view("cc")), _))
+                .Times(1)
+                .WillOnce(Return(rust::Result<const char*, int>(rust::Ok("/usr/bin/cc"))));
+
+        auto result = ToolWrapper::recognize(resolver, input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
+    }
+
+    TEST(ToolWrapper, unwraps_wrapper_chain) {
+        const Execution input = {
+                "/usr/bin/ccache",
+                {"ccache", "distcc", "cc", "-c", "-o", "source.o", "source.c"},
                 "/home/user/project",
                 {{"PATH", "/usr/bin:/usr/sbin"}},
         };
+        SemanticPtr expected = SemanticPtr(
+                new Compile(
+                        input.working_dir,
+                        "/usr/bin/cc",
+                        {"-c"},
+                        {fs::path("source.c")},
+                        {fs::path("source.o")})
+        );
 
         ResolverMock resolver;
         EXPECT_CALL(resolver, from_search_path(Eq(std::string_view("cc")), _))
                 .Times(1)
                 .WillOnce(Return(rust::Result<const char*, int>(rust::Ok("/usr/bin/cc"))));
 
-        auto result = ToolWrapper::remove_wrapper(resolver, input);
-        EXPECT_EQ(expected, result);
+        auto result = ToolWrapper::recognize(resolver, input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
     }
 
-    TEST(ToolWrapper, remove_wrapper_fails_to_resolve) {
+    TEST(ToolWrapper, unwrap_fails_to_resolve) {
         const Execution input = {
                 "/usr/bin/ccache",
                 {"ccache", "cc", "-c", "-o", "source.o", "source.c"},
                 "/home/user/project",
                 {{"PATH", "/usr/bin:/usr/sbin"}},
         };
-        const Execution expected = {
-                "cc",
-                {"cc", "-c", "-o", "source.o", "source.c"},
-                "/home/user/project",
-                {{"PATH", "/usr/bin:/usr/sbin"}},
-        };
+        SemanticPtr expected = SemanticPtr(
+                new Compile(
+                        input.working_dir,
+                        "cc",
+                        {"-c"},
+                        {fs::path("source.c")},
+                        {fs::path("source.o")})
+        );
 
         ResolverMock resolver;
         EXPECT_CALL(resolver, from_search_path(Eq(std::string_view("cc")), _))
                 .Times(1)
                 .WillOnce(Return(rust::Result<const char*, int>(rust::Err(12))));
 
-        auto result = ToolWrapper::remove_wrapper(resolver, input);
-        EXPECT_EQ(expected, result);
+        auto result = ToolWrapper::recognize(resolver, input);
+        EXPECT_TRUE(Tool::recognized_ok(result));
+        EXPECT_PRED2([](auto lhs, auto rhs) { return lhs->operator==(*rhs); }, expected, result.unwrap());
     }
 }
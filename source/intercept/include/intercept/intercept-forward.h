@@ -31,4 +31,60 @@ namespace ic {
         NON_DEFAULT_CONSTRUCTABLE(Intercept)
     };
 
+    struct Merge : ps::SubcommandFromArgs {
+        Merge(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Merge)
+    };
+
+    struct Trace : ps::SubcommandFromArgs {
+        Trace(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Trace)
+    };
+
+    struct Stats : ps::SubcommandFromArgs {
+        Stats(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Stats)
+    };
+
+    struct Compact : ps::SubcommandFromArgs {
+        Compact(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Compact)
+    };
+
+    struct CriticalPath : ps::SubcommandFromArgs {
+        CriticalPath(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(CriticalPath)
+    };
+
+    struct Events : ps::SubcommandFromArgs {
+        Events(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Events)
+    };
+
+    struct Replay : ps::SubcommandFromArgs {
+        Replay(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Replay)
+    };
+
+    struct Doctor : ps::SubcommandFromArgs {
+        Doctor(const ps::ApplicationLogConfig&) noexcept;
+        rust::Result<ps::CommandPtr> command(const flags::Arguments &args, const char **envp) const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(Doctor)
+    };
+
 }
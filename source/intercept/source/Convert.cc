@@ -19,6 +19,8 @@
 
 #include "Convert.h"
 
+#include <utility>
+
 namespace domain {
 
     Execution from(const rpc::Execution &input) noexcept {
@@ -41,4 +43,37 @@ namespace domain {
         result.mutable_environment()->insert(input.environment.begin(), input.environment.end());
         return result;
     }
+
+    Execution from(rpc::Execution &&input) noexcept {
+        std::list<std::string> arguments;
+        for (auto &argument : *input.mutable_arguments()) {
+            arguments.emplace_back(std::move(argument));
+        }
+        std::map<std::string, std::string> environment;
+        for (auto &entry : *input.mutable_environment()) {
+            // the map key is const; only the value can be moved.
+            environment.emplace(entry.first, std::move(entry.second));
+        }
+        return Execution{
+                fs::path(std::move(*input.mutable_executable())),
+                std::move(arguments),
+                fs::path(std::move(*input.mutable_working_dir())),
+                std::move(environment)
+        };
+    }
+
+    rpc::Execution into(Execution &&input) noexcept {
+        rpc::Execution result;
+        result.set_executable(input.executable.string());
+        result.mutable_arguments()->Reserve(input.arguments.size());
+        for (auto &argument : input.arguments) {
+            result.add_arguments(std::move(argument));
+        }
+        result.set_working_dir(input.working_dir);
+        auto &environment = *result.mutable_environment();
+        for (auto &entry : input.environment) {
+            environment[entry.first] = std::move(entry.second);
+        }
+        return result;
+    }
 }
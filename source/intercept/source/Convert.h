@@ -26,4 +26,9 @@ namespace domain {
 
     Execution from(const rpc::Execution &) noexcept;
     rpc::Execution into(const Execution &) noexcept;
+
+    // The rvalue overloads move the strings across the boundary instead
+    // of copying them; the argument is left in an unspecified state.
+    Execution from(rpc::Execution &&) noexcept;
+    rpc::Execution into(Execution &&) noexcept;
 }
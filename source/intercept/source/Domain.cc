@@ -22,10 +22,20 @@
 
 #include <google/protobuf/util/json_util.h>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 
 namespace domain {
 
+    ReporterId make_reporter_id(ProcessId pid) {
+        static std::atomic<uint32_t> counter(uint32_t(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count()));
+        return (ReporterId(pid) << 32u) | ReporterId(counter.fetch_add(1, std::memory_order_relaxed));
+    }
+
     bool operator==(const Execution &lhs, const Execution &rhs) {
         return (lhs.executable == rhs.executable)
                && (lhs.arguments == rhs.arguments)
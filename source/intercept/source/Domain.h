@@ -43,5 +43,12 @@ namespace domain {
     bool operator==(const Execution& lhs, const Execution& rhs);
     std::ostream& operator<<(std::ostream&, const Execution&);
 
+    // Composes the reporter id of a process: the process id in the high
+    // bits and a per process counter in the low ones. Cheap to assign,
+    // and unique within a session. The counter starts from the monotonic
+    // clock, so the low word approximates the start time in microseconds
+    // and sorting by it reconstructs the start order of the events.
+    ReporterId make_reporter_id(ProcessId pid);
+
     using SessionLocator = std::string;
 }
@@ -0,0 +1,99 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "HybridClock.h"
+
+#include <google/protobuf/util/time_util.h>
+
+#include <atomic>
+#include <ctime>
+
+#ifdef HAVE_SYS_UTSNAME_H
+#include <sys/utsname.h>
+#endif
+
+namespace {
+
+    // the process wide clock; every stamp and observation goes through it.
+    std::atomic<uint64_t> LAST(0);
+
+    uint64_t wall_clock() noexcept {
+        timespec ts;
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+        const uint64_t micros = uint64_t(ts.tv_sec) * 1000000u + uint64_t(ts.tv_nsec) / 1000u;
+        return micros << domain::hlc::LOGICAL_BITS;
+    }
+}
+
+namespace domain::hlc {
+
+    uint32_t node_identity() noexcept {
+        static const uint32_t identity = []() -> uint32_t {
+#ifdef HAVE_UNAME
+            utsname name;
+            if (0 == ::uname(&name)) {
+                // FNV-1a over the node name.
+                uint32_t hash = 0x811c9dc5;
+                for (const char *it = name.nodename; *it != char(0); ++it) {
+                    hash ^= uint8_t(*it);
+                    hash *= 0x01000193;
+                }
+                // zero is the "not stamped" marker, keep away from it.
+                return (hash != 0) ? hash : 1;
+            }
+#endif
+            return 1;
+        }();
+        return identity;
+    }
+
+    uint64_t advance() noexcept {
+        const uint64_t wall = wall_clock();
+        uint64_t last = LAST.load(std::memory_order_relaxed);
+        for (;;) {
+            const uint64_t next = (wall > last) ? wall : (last + 1);
+            if (LAST.compare_exchange_weak(last, next, std::memory_order_relaxed)) {
+                return next;
+            }
+        }
+    }
+
+    void observe(const uint64_t clock) noexcept {
+        uint64_t last = LAST.load(std::memory_order_relaxed);
+        while (clock > last) {
+            if (LAST.compare_exchange_weak(last, clock, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+    }
+
+    void stamp(rpc::Event &event) noexcept {
+        event.set_clock(advance());
+        event.set_node(node_identity());
+    }
+
+    uint64_t ordering_key(const rpc::Event &event) noexcept {
+        if (const uint64_t clock = event.clock(); clock != 0) {
+            return clock;
+        }
+        const auto micros = google::protobuf::util::TimeUtil::TimestampToMicroseconds(event.timestamp());
+        return (micros > 0) ? (uint64_t(micros) << LOGICAL_BITS) : 0;
+    }
+}
@@ -0,0 +1,58 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "intercept.pb.h"
+
+#include <cstdint>
+
+namespace domain::hlc {
+
+    // The clock value packs the wall clock microseconds above this many
+    // bits of logical counter. The counter absorbs events stamped within
+    // the same microsecond (and observed clocks running ahead of the
+    // wall clock), so the value is strictly monotonic within a process.
+    constexpr int LOGICAL_BITS = 12;
+
+    // Digest of the node name this process runs on. Events captured on
+    // different nodes can carry equal clock values; the node identity
+    // breaks those ties deterministically in a multi node merge.
+    [[nodiscard]] uint32_t node_identity() noexcept;
+
+    // Advance the process wide clock and return the new value: the wall
+    // clock when it moved past the last value, the incremented last
+    // value otherwise.
+    [[nodiscard]] uint64_t advance() noexcept;
+
+    // Fold a clock value received from another process into the process
+    // wide clock, so locally stamped events order after the observed
+    // one. A zero value (an event without a clock) is a no-op.
+    void observe(uint64_t clock) noexcept;
+
+    // Stamp the event with the advanced clock and the node identity.
+    // (The wall timestamp of the event is set separately; it stays the
+    // human readable time, the clock is the ordering key.)
+    void stamp(rpc::Event &event) noexcept;
+
+    // The merge ordering key of an event: the clock when present, the
+    // wall timestamp scaled to the clock resolution for events captured
+    // before the clock existed.
+    [[nodiscard]] uint64_t ordering_key(const rpc::Event &event) noexcept;
+}
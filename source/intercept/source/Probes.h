@@ -0,0 +1,51 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+
+// Static tracepoints (USDT) on the interception hot path.
+//
+// The probes compile to a single nop instruction until a tracer (like
+// bpftrace or perf) attaches to them, so they are free in production.
+// Attach to them by the "bear" provider name to get per stage latency
+// of a live build, without rebuilding with extra instrumentation:
+//
+//   bpftrace -e 'usdt:libexec.so:bear:exec_rewrite_entry { ... }'
+//
+// On platforms without the systemtap headers the macros expand to
+// nothing.
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define BEAR_PROBE(name) STAP_PROBE(bear, name)
+#define BEAR_PROBE1(name, argument) STAP_PROBE1(bear, name, argument)
+
+#else
+
+#define BEAR_PROBE(name) \
+    do {                 \
+    } while (false)
+#define BEAR_PROBE1(name, argument) \
+    do {                            \
+    } while (false)
+
+#endif
@@ -0,0 +1,126 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "collect/Affinity.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+    // the configured cpu set; empty means no pinning anywhere.
+    std::vector<int> cpus;
+
+    // A cpu list in the taskset style: comma separated cpu numbers or
+    // dash separated ranges, like "0-7,16".
+    rust::Result<std::vector<int>> parse(const std::string &spec)
+    {
+        std::vector<int> result;
+        const char *it = spec.c_str();
+        while (*it != '\0') {
+            char *end = nullptr;
+            const long first = strtol(it, &end, 10);
+            if (end == it || first < 0) {
+                return rust::Err(std::runtime_error(fmt::format("Unrecognized cpu list: \"{}\"", spec)));
+            }
+            long last = first;
+            it = end;
+            if (*it == '-') {
+                last = strtol(it + 1, &end, 10);
+                if (end == it + 1 || last < first) {
+                    return rust::Err(std::runtime_error(fmt::format("Unrecognized cpu list: \"{}\"", spec)));
+                }
+                it = end;
+            }
+            for (long cpu = first; cpu <= last; ++cpu) {
+                result.push_back(int(cpu));
+            }
+            if (*it == ',') {
+                ++it;
+            } else if (*it != '\0') {
+                return rust::Err(std::runtime_error(fmt::format("Unrecognized cpu list: \"{}\"", spec)));
+            }
+        }
+        return rust::Ok(std::move(result));
+    }
+
+    void pin_to(const int cpu)
+    {
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        // a failed pin is only a lost optimization, the thread runs on.
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            spdlog::debug("Pinning a thread to cpu {} failed.", cpu);
+        }
+#else
+        (void)cpu;
+#endif
+    }
+}
+
+namespace ic::affinity {
+
+    rust::Result<size_t> configure(const std::string &spec)
+    {
+        if (spec.empty()) {
+            cpus.clear();
+            return rust::Ok(size_t(0));
+        }
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+        return parse(spec)
+                .map<size_t>([](auto parsed) {
+                    cpus = std::move(parsed);
+                    return cpus.size();
+                });
+#else
+        return rust::Err(std::runtime_error("Thread affinity is not supported on this platform."));
+#endif
+    }
+
+    void pin_writer()
+    {
+        if (!cpus.empty()) {
+            pin_to(cpus.front());
+        }
+    }
+
+    void pin_handler(const size_t index)
+    {
+        if (cpus.empty()) {
+            return;
+        }
+        // with a single cpu set the writer and the handlers share it.
+        if (cpus.size() == 1) {
+            pin_to(cpus.front());
+            return;
+        }
+        pin_to(cpus[1 + (index % (cpus.size() - 1))]);
+    }
+}
@@ -0,0 +1,48 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "libresult/Result.h"
+
+#include <cstddef>
+#include <string>
+
+namespace ic::affinity {
+
+    // Installs the cpu list the collector threads shall run on, parsed
+    // from the command line spec ("0-7,16" style). Called once before
+    // the threads are created; an empty spec leaves the scheduling to
+    // the kernel. Returns the number of cpus in the set.
+    //
+    // On a multi socket host the threads otherwise bounce between the
+    // nodes, and the event ingestion pays remote memory penalties. The
+    // pinned threads allocate and first touch their buffers locally, so
+    // the memory placement follows the pin.
+    rust::Result<size_t> configure(const std::string &spec);
+
+    // Pins the calling thread (the events writer) to the first cpu of
+    // the configured set.
+    void pin_writer();
+
+    // Pins the calling thread (a request handler) to one cpu of the
+    // configured set, spread round robin by the index. The first cpu
+    // belongs to the writer; the handlers share the rest.
+    void pin_handler(size_t index);
+}
@@ -0,0 +1,320 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/Compact.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "collect/db/EventsDatabaseWriter.h"
+#include "intercept/intercept-forward.h"
+
+#include <google/protobuf/util/time_util.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace db = ic::collect::db;
+
+namespace {
+
+    // The keep flag holds executable basenames, colon separated. (The
+    // same spelling the filter flag of the collector uses.)
+    std::unordered_set<std::string> keep_set(const std::string &flag) {
+        std::unordered_set<std::string> result;
+        for (size_t begin = 0; begin < flag.size();) {
+            const size_t end = std::min(flag.find(':', begin), flag.size());
+            if (end > begin) {
+                result.emplace(flag.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+        return result;
+    }
+
+    struct DroppedStats {
+        size_t count = 0;
+        int64_t total = 0;      // microseconds
+        int64_t longest = 0;    // microseconds
+    };
+
+    bool is_shell(const std::string &executable) {
+        static const std::unordered_set<std::string> SHELLS = { "sh", "bash", "dash", "zsh", "ksh" };
+        return SHELLS.count(fs::path(executable).filename().string()) != 0;
+    }
+
+    // The ancestry of one process, as far as the compaction needs it.
+    struct Lineage {
+        uint64_t parent = 0;    // rid of the parent, zero when unknown
+        bool shell = false;
+        size_t children = 0;
+        int64_t started = 0;    // microseconds
+        int64_t terminated = 0; // microseconds, zero without termination
+    };
+
+    // The result of the ancestry scan: the trampoline shells to drop,
+    // and for each leaf they wrapped, the wall time window of the whole
+    // chain (the termination stays zero when the outermost shell had no
+    // termination event).
+    struct CollapsePlan {
+        std::unordered_set<uint64_t> dropped;
+        std::map<uint64_t, std::pair<int64_t, int64_t>> adjusted;
+    };
+
+    // The first pass over the input: reconstruct the process tree from
+    // the ppid linkage and find the trampoline chains. A trampoline is a
+    // shell which started exactly one child; a typical build wraps every
+    // rule as `sh -c "cc ..."`, so these shells make up a large share of
+    // the events while carrying no information beyond their timing. The
+    // pid to rid resolution follows the stream order, which keeps a
+    // recycled pid attached to its latest process.
+    rust::Result<CollapsePlan> scan_trampolines(const db::EventsDatabaseReader::Ptr &reader) {
+        std::map<uint64_t, Lineage> lineage;
+        std::unordered_map<uint32_t, uint64_t> owner;
+
+        for (auto event = reader->next(); event.has_value(); event = reader->next()) {
+            if (event->is_err()) {
+                return rust::Err(std::runtime_error(fmt::format(
+                        "Reading events failed: {}", event->unwrap_err().what())));
+            }
+            const auto &current = *event->unwrap();
+            const auto timestamp =
+                    google::protobuf::util::TimeUtil::TimestampToMicroseconds(current.timestamp());
+            if (current.has_started()) {
+                Lineage entry;
+                entry.shell = is_shell(current.started().execution().executable());
+                entry.started = timestamp;
+                if (const auto it = owner.find(current.started().ppid()); it != owner.end()) {
+                    entry.parent = it->second;
+                    ++lineage[it->second].children;
+                }
+                lineage[current.rid()] = entry;
+                owner[current.started().pid()] = current.rid();
+            } else if (current.has_terminated()) {
+                lineage[current.rid()].terminated = timestamp;
+            }
+        }
+
+        CollapsePlan result;
+        for (const auto &[rid, entry] : lineage) {
+            // a single child shell is itself folded into its leaf.
+            if (entry.shell && entry.children == 1) {
+                continue;
+            }
+            int64_t started = entry.started;
+            int64_t terminated = entry.terminated;
+            bool folded = false;
+            for (uint64_t up = entry.parent; up != 0;) {
+                const auto it = lineage.find(up);
+                if (it == lineage.end() || !it->second.shell || it->second.children != 1) {
+                    break;
+                }
+                result.dropped.insert(up);
+                if (it->second.started != 0) {
+                    started = it->second.started;
+                }
+                terminated = std::max(terminated, it->second.terminated);
+                folded = true;
+                up = it->second.parent;
+            }
+            if (folded) {
+                result.adjusted.emplace(rid, std::make_pair(started, terminated));
+            }
+        }
+        return rust::Ok(std::move(result));
+    }
+
+    // The timing summary of the dropped processes, written next to the
+    // compacted file. A plain text format: the header line names the
+    // format version; the events line counts the input, kept and dropped
+    // events; the optional collapsed line counts the trampoline shells
+    // folded into their leaf process; the wall line holds the first and
+    // last event timestamp of the whole input (microseconds); then one
+    // line per dropped binary with its execution count, cumulative and
+    // longest duration. The executable path comes last on the line,
+    // because it may contain spaces.
+    bool write_summary(
+            const fs::path &file,
+            size_t total, size_t kept,
+            const std::optional<size_t> &collapsed,
+            int64_t first, int64_t last,
+            const std::map<std::string, DroppedStats> &binaries) {
+        std::ofstream target(file);
+        target << "compact 1\n";
+        target << "events " << total << ' ' << kept << ' ' << (total - kept) << '\n';
+        if (collapsed.has_value()) {
+            target << "collapsed " << *collapsed << '\n';
+        }
+        target << "wall " << first << ' ' << last << '\n';
+        for (const auto &[name, stats] : binaries) {
+            target << "binary " << stats.count << ' ' << stats.total << ' ' << stats.longest << ' ' << name << '\n';
+        }
+        return target.good();
+    }
+}
+
+namespace ic {
+
+    rust::Result<int> CompactCommand::execute() const
+    {
+        // Refuse to overwrite the input with the compacted result.
+        if (input_ == output_) {
+            return rust::Err(std::runtime_error("The output file is the input file."));
+        }
+        // the collapse rule needs the process tree up front, which costs
+        // an extra pass over the input.
+        CollapsePlan plan;
+        if (collapse_) {
+            auto scanned = db::EventsDatabaseReader::from(input_)
+                    .and_then<CollapsePlan>([](const auto &reader) { return scan_trampolines(reader); });
+            if (scanned.is_err()) {
+                return rust::Err(scanned.unwrap_err());
+            }
+            plan = scanned.unwrap();
+        }
+        auto reader = db::EventsDatabaseReader::from(input_);
+        auto writer = db::EventsDatabaseWriter::create(output_, format_, db::EventsDatabaseWriter::DEFAULT_FLUSH_THRESHOLD, compress_);
+        return rust::merge(reader, writer)
+                .and_then<int>([this, &plan](const auto &tuple) -> rust::Result<int> {
+                    const auto &[reader, writer] = tuple;
+
+                    size_t total = 0;
+                    size_t kept = 0;
+                    int64_t first = 0;
+                    int64_t last = 0;
+                    std::unordered_set<uint64_t> kept_rids;
+                    // the dropped executions waiting for their termination.
+                    std::map<uint64_t, std::pair<int64_t, std::string>> open;
+                    std::map<std::string, DroppedStats> binaries;
+
+                    for (auto event = reader->next(); event.has_value(); event = reader->next()) {
+                        if (event->is_err()) {
+                            return rust::Err(std::runtime_error(fmt::format(
+                                    "Reading events failed: {}", event->unwrap_err().what())));
+                        }
+                        const auto &current = *event->unwrap();
+                        // The environment definitions are skipped: the
+                        // writer re-creates them from the kept events.
+                        if (!current.has_started() && !current.has_terminated() && !current.has_signalled()) {
+                            continue;
+                        }
+                        ++total;
+                        const auto timestamp =
+                                google::protobuf::util::TimeUtil::TimestampToMicroseconds(current.timestamp());
+                        first = (first == 0) ? timestamp : std::min(first, timestamp);
+                        last = std::max(last, timestamp);
+                        // a collapsed trampoline shell leaves no trace of
+                        // its own: its wall time lives on in its leaf.
+                        if (plan.dropped.count(current.rid()) != 0) {
+                            continue;
+                        }
+                        // the leaf of a collapsed chain reports the wall
+                        // time of the whole chain.
+                        auto effective = timestamp;
+                        if (const auto it = plan.adjusted.find(current.rid()); it != plan.adjusted.end()) {
+                            if (current.has_started()) {
+                                effective = it->second.first;
+                            } else if (current.has_terminated() && (it->second.second != 0)) {
+                                effective = it->second.second;
+                            }
+                        }
+                        if (current.has_started()) {
+                            const auto &executable = current.started().execution().executable();
+                            if (keep_.count(fs::path(executable).filename().string()) != 0) {
+                                kept_rids.insert(current.rid());
+                            } else {
+                                open.emplace(current.rid(), std::make_pair(effective, executable));
+                                continue;
+                            }
+                        } else if (kept_rids.count(current.rid()) == 0) {
+                            if (current.has_terminated()) {
+                                if (const auto it = open.find(current.rid()); it != open.end()) {
+                                    auto &binary = binaries[it->second.second];
+                                    const auto duration = effective - it->second.first;
+                                    ++binary.count;
+                                    binary.total += duration;
+                                    binary.longest = std::max(binary.longest, duration);
+                                    open.erase(it);
+                                }
+                            }
+                            continue;
+                        }
+                        if (effective != timestamp) {
+                            rpc::Event patched(current);
+                            *patched.mutable_timestamp() =
+                                    google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(effective);
+                            if (auto written = writer->insert_event(patched); written.is_err()) {
+                                return rust::Err(written.unwrap_err());
+                            }
+                        } else if (auto written = writer->insert_event(current); written.is_err()) {
+                            return rust::Err(written.unwrap_err());
+                        }
+                        ++kept;
+                    }
+                    // a dropped process without a termination event still
+                    // counts, just without a duration.
+                    for (const auto &[rid, entry] : open) {
+                        ++binaries[entry.second].count;
+                    }
+
+                    const auto collapsed = collapse_
+                            ? std::optional<size_t>(plan.dropped.size())
+                            : std::nullopt;
+                    if (!write_summary(fs::path(output_.string() + cmd::compact::SUMMARY_SUFFIX),
+                                       total, kept, collapsed, first, last, binaries)) {
+                        return rust::Err(std::runtime_error("Writing the summary file failed."));
+                    }
+                    spdlog::debug("events compacted. [total: {}, kept: {}]", total, kept);
+                    return writer->flush().template map<int>([](auto) { return EXIT_SUCCESS; });
+                });
+    }
+
+    Compact::Compact(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("compact", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Compact::command(const flags::Arguments &args, const char **) const {
+        const auto input = args.as_string(cmd::compact::FLAG_INPUT)
+                .map<fs::path>([](auto value) { return fs::path(value); });
+        const auto output = args.as_string(cmd::compact::FLAG_OUTPUT)
+                .map<fs::path>([](auto value) { return fs::path(value); });
+        const auto format = args.as_bool(cmd::intercept::FLAG_OUTPUT_JSON).unwrap_or(false)
+                ? db::EventsDatabaseFormat::JSON
+                : db::EventsDatabaseFormat::BINARY;
+        const auto compress = args.as_bool(cmd::intercept::FLAG_OUTPUT_ZSTD).unwrap_or(false);
+        const auto keep = keep_set(std::string(args.as_string(cmd::compact::FLAG_FILTER).unwrap_or("")));
+        if (keep.empty()) {
+            return rust::Err(std::runtime_error("The keep filter is empty; it would drop every event."));
+        }
+        const auto collapse = args.as_bool(cmd::compact::FLAG_COLLAPSE).unwrap_or(false);
+
+        return rust::merge(input, output)
+                .map<ps::CommandPtr>([&format, &compress, &keep, &collapse](auto tuple) {
+                    const auto&[input, output] = tuple;
+                    return std::make_unique<CompactCommand>(input, output, format, compress, keep, collapse);
+                });
+    }
+}
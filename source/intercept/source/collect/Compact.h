@@ -0,0 +1,69 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libmain/SubcommandFromArgs.h"
+#include "collect/db/EventsDatabaseFormat.h"
+
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace ic {
+
+    // Rewrites an events database keeping only the processes whose
+    // executable basename is on the keep list. A build traces far more
+    // processes than the compilations the recognition consumes, so the
+    // archived file shrinks dramatically. The lifecycle events of the
+    // dropped processes are folded into a timing summary sidecar, which
+    // preserves the per binary execution counts and durations.
+    struct CompactCommand : ps::Command {
+
+        CompactCommand(fs::path input, fs::path output, collect::db::EventsDatabaseFormat format, bool compress, std::unordered_set<std::string> keep, bool collapse)
+                : ps::Command()
+                , input_(std::move(input))
+                , output_(std::move(output))
+                , format_(format)
+                , compress_(compress)
+                , keep_(std::move(keep))
+                , collapse_(collapse)
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(CompactCommand)
+        NON_COPYABLE_NOR_MOVABLE(CompactCommand)
+
+    private:
+        fs::path input_;
+        fs::path output_;
+        collect::db::EventsDatabaseFormat format_;
+        bool compress_;
+        // The executable basenames whose processes survive the rewrite.
+        std::unordered_set<std::string> keep_;
+        // When set, a shell whose only job was to exec a single child is
+        // folded into that child: the shell events are dropped and the
+        // child events are stretched to cover the shell's wall time.
+        bool collapse_;
+    };
+}
@@ -0,0 +1,237 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/CriticalPath.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "intercept/intercept-forward.h"
+
+#include <google/protobuf/util/time_util.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace db = ic::collect::db;
+
+namespace {
+
+    // A finished execution of the recorded process tree.
+    struct Execution {
+        uint32_t pid = 0;
+        uint32_t ppid = 0;
+        std::string executable;
+        int64_t start = 0;  // microseconds
+        int64_t end = 0;    // microseconds
+        uint64_t rss = 0;   // peak resident set in kilobytes, zero when unknown
+
+        [[nodiscard]] int64_t duration() const { return end - start; }
+    };
+
+    // The longest chain of serialized executions from the candidates:
+    // the subset maximizing the summed duration, where each execution
+    // starts at or after the previous one ended. Weighted interval
+    // scheduling: sorted by end time, each execution either extends the
+    // best chain ending before its start, or is skipped.
+    std::vector<const Execution *> longest_chain(std::vector<const Execution *> candidates) {
+        if (candidates.empty()) {
+            return candidates;
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const auto *lhs, const auto *rhs) { return lhs->end < rhs->end; });
+        const size_t count = candidates.size();
+        std::vector<int64_t> best(count, 0);
+        std::vector<size_t> previous(count, count);
+        // the best chain value among the first N entries, and which
+        // entry achieves it, so the predecessor lookup stays constant.
+        std::vector<std::pair<int64_t, size_t>> best_prefix(count);
+        for (size_t index = 0; index < count; ++index) {
+            // the best chain which ended at or before this start.
+            const auto it = std::upper_bound(
+                    candidates.begin(), candidates.begin() + long(index), candidates[index]->start,
+                    [](int64_t start, const auto *entry) { return start < entry->end; });
+            const size_t before = size_t(std::distance(candidates.begin(), it));
+            best[index] = candidates[index]->duration();
+            if (before > 0) {
+                best[index] += best_prefix[before - 1].first;
+                previous[index] = best_prefix[before - 1].second;
+            }
+            best_prefix[index] = ((index > 0) && (best_prefix[index - 1].first >= best[index]))
+                    ? best_prefix[index - 1]
+                    : std::make_pair(best[index], index);
+        }
+        const size_t tail = best_prefix[count - 1].second;
+        std::vector<const Execution *> chain;
+        for (size_t index = tail; index != count; index = previous[index]) {
+            chain.push_back(candidates[index]);
+        }
+        std::reverse(chain.begin(), chain.end());
+        return chain;
+    }
+
+    // Expand an execution into the serialized work it stands for: a
+    // process with finished children is represented by the chain of its
+    // children (the build tool is not the work, the steps it drove are),
+    // a leaf represents itself.
+    void expand(const Execution *execution,
+                const std::map<uint32_t, std::vector<const Execution *>> &children,
+                std::vector<const Execution *> &path) {
+        const auto it = children.find(execution->pid);
+        if ((it == children.end()) || it->second.empty()) {
+            path.push_back(execution);
+            return;
+        }
+        for (const auto *child : longest_chain(it->second)) {
+            expand(child, children, path);
+        }
+    }
+
+    std::string seconds(int64_t duration) {
+        return fmt::format("{:.3f}s", double(duration) / 1e6);
+    }
+}
+
+namespace ic {
+
+    rust::Result<int> CriticalPathCommand::execute() const
+    {
+        return db::EventsDatabaseReader::from(input_)
+                .and_then<int>([](const auto &reader) -> rust::Result<int> {
+                    std::map<uint64_t, Execution> open;
+                    std::vector<Execution> executions;
+
+                    for (auto event = reader->next(); event.has_value(); event = reader->next()) {
+                        if (event->is_err()) {
+                            spdlog::warn("Reading events failed: {}", event->unwrap_err().what());
+                            break;
+                        }
+                        const auto &current = *event->unwrap();
+                        const auto timestamp =
+                                google::protobuf::util::TimeUtil::TimestampToMicroseconds(current.timestamp());
+                        if (current.has_started()) {
+                            Execution execution;
+                            execution.pid = current.started().pid();
+                            execution.ppid = current.started().ppid();
+                            execution.executable = current.started().execution().executable();
+                            execution.start = timestamp;
+                            open.emplace(current.rid(), std::move(execution));
+                        } else if (current.has_terminated()) {
+                            const auto it = open.find(current.rid());
+                            if (it == open.end()) {
+                                continue;
+                            }
+                            it->second.end = timestamp;
+                            if (current.terminated().has_usage()) {
+                                it->second.rss = current.terminated().usage().max_rss_kb();
+                            }
+                            executions.emplace_back(std::move(it->second));
+                            open.erase(it);
+                        }
+                    }
+                    if (executions.empty()) {
+                        fmt::print("no finished executions.\n");
+                        return rust::Ok(EXIT_SUCCESS);
+                    }
+                    if (!open.empty()) {
+                        spdlog::warn("{} executions have no termination event; they are left out.", open.size());
+                    }
+
+                    // The tree: children by parent pid, roots are the
+                    // executions whose parent was not recorded (the build
+                    // command bear started, usually a single one).
+                    std::set<uint32_t> pids;
+                    for (const auto &execution : executions) {
+                        pids.insert(execution.pid);
+                    }
+                    std::map<uint32_t, std::vector<const Execution *>> children;
+                    std::vector<const Execution *> roots;
+                    for (const auto &execution : executions) {
+                        if (pids.count(execution.ppid) > 0) {
+                            children[execution.ppid].push_back(&execution);
+                        } else {
+                            roots.push_back(&execution);
+                        }
+                    }
+
+                    std::vector<const Execution *> path;
+                    for (const auto *root : longest_chain(roots)) {
+                        expand(root, children, path);
+                    }
+
+                    int64_t first = executions.front().start;
+                    int64_t last = executions.front().end;
+                    for (const auto &execution : executions) {
+                        first = std::min(first, execution.start);
+                        last = std::max(last, execution.end);
+                    }
+                    const auto wall_time = last - first;
+                    int64_t path_time = 0;
+                    for (const auto *step : path) {
+                        path_time += step->duration();
+                    }
+                    fmt::print("critical path: {} steps, {} of {} wall time ({:.0f}%)\n\n",
+                               path.size(), seconds(path_time), seconds(wall_time),
+                               (wall_time > 0) ? 100.0 * double(path_time) / double(wall_time) : 0.0);
+                    // the memory column appears when the events carry
+                    // resource usage (older databases have none).
+                    const bool with_usage = std::any_of(
+                            executions.begin(), executions.end(),
+                            [](const auto &execution) { return execution.rss > 0; });
+                    if (with_usage) {
+                        fmt::print("{:>10}  {:>10}  {:>8}  {:>10}  executable\n",
+                                   "duration", "start", "pid", "peak rss");
+                    } else {
+                        fmt::print("{:>10}  {:>10}  {:>8}  executable\n", "duration", "start", "pid");
+                    }
+                    for (const auto *step : path) {
+                        if (with_usage) {
+                            fmt::print("{:>10}  {:>10}  {:>8}  {:>10}  {}\n",
+                                       seconds(step->duration()),
+                                       seconds(step->start - first),
+                                       step->pid,
+                                       fmt::format("{} MB", step->rss / 1024),
+                                       step->executable);
+                        } else {
+                            fmt::print("{:>10}  {:>10}  {:>8}  {}\n",
+                                       seconds(step->duration()),
+                                       seconds(step->start - first),
+                                       step->pid,
+                                       step->executable);
+                        }
+                    }
+                    return rust::Ok(EXIT_SUCCESS);
+                });
+    }
+
+    CriticalPath::CriticalPath(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("critical-path", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> CriticalPath::command(const flags::Arguments &args, const char **) const {
+        return args.as_string(cmd::critical_path::FLAG_INPUT)
+                .map<ps::CommandPtr>([](auto input) {
+                    return std::make_unique<CriticalPathCommand>(fs::path(input));
+                });
+    }
+}
@@ -0,0 +1,52 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libmain/SubcommandFromArgs.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace ic {
+
+    // Reconstructs the process tree of an events database and reports
+    // the critical path: the longest chain of serialized executions
+    // which bounds the wall time of the build. A process which spawned
+    // children is represented by the chain of its children, so the
+    // report names the compile and link steps, not the build tool
+    // driving them.
+    struct CriticalPathCommand : ps::Command {
+
+        explicit CriticalPathCommand(fs::path input)
+                : ps::Command()
+                , input_(std::move(input))
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(CriticalPathCommand)
+        NON_COPYABLE_NOR_MOVABLE(CriticalPathCommand)
+
+    private:
+        fs::path input_;
+    };
+}
@@ -0,0 +1,225 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/Doctor.h"
+#include "collect/Session.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "intercept/intercept-forward.h"
+#include "libsys/Os.h"
+#include "libsys/Path.h"
+#include "libsys/Process.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace db = ic::collect::db;
+
+namespace {
+
+    struct Engine {
+        const char *name;
+        const char *force_flag;
+    };
+
+    // The engines worth probing on this platform. EndpointSecurity is
+    // left out: it needs entitlements (or root) that a doctor run can
+    // not assume.
+    constexpr Engine ENGINES[] = {
+#ifdef SUPPORT_PRELOAD
+            {"preload", cmd::intercept::FLAG_FORCE_PRELOAD},
+#endif
+            {"wrapper", cmd::intercept::FLAG_FORCE_WRAPPER},
+#ifdef SUPPORT_SECCOMP
+            {"seccomp", cmd::intercept::FLAG_FORCE_SECCOMP},
+#endif
+#ifdef SUPPORT_EBPF
+            {"ebpf", cmd::intercept::FLAG_FORCE_EBPF},
+#endif
+    };
+
+    // The workload runs a real compiler, because the wrapper engine only
+    // sees executables it has a wrapper for.
+    std::optional<fs::path> find_compiler(const sys::env::Vars &environment)
+    {
+        constexpr const char *CANDIDATES[] = {"cc", "gcc", "clang", "c++"};
+
+        const auto paths = sys::os::get_path(environment);
+        if (paths.is_err()) {
+            return std::nullopt;
+        }
+        const auto directories = sys::path::split(paths.unwrap());
+        for (const auto *name : CANDIDATES) {
+            for (const auto &directory : directories) {
+                if (fs::path candidate = directory / name; ::access(candidate.c_str(), X_OK) == 0) {
+                    return candidate;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Run the command and return the elapsed wall time in microseconds.
+    // A nonzero exit is an error here; the workload itself always exits
+    // with zero.
+    rust::Result<int64_t> timed_run(const sys::Process::Builder &builder)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        return builder.spawn()
+                .and_then<sys::ExitStatus>([](auto child) {
+                    return child.wait();
+                })
+                .and_then<int64_t>([&started](auto status) -> rust::Result<int64_t> {
+                    if (const auto code = status.code(); code.value_or(EXIT_FAILURE) != EXIT_SUCCESS) {
+                        return rust::Err(std::runtime_error(
+                                fmt::format("Exited with {}.", code.value_or(EXIT_FAILURE))));
+                    }
+                    return rust::Ok(int64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - started).count()));
+                });
+    }
+
+    size_t count_started_events(const fs::path &events)
+    {
+        auto reader = db::EventsDatabaseReader::from(events);
+        if (reader.is_err()) {
+            return 0;
+        }
+        size_t count = 0;
+        const auto &instance = reader.unwrap();
+        for (auto event = instance->next(); event.has_value(); event = instance->next()) {
+            if (event->is_err()) {
+                break;
+            }
+            if (event->unwrap()->has_started()) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    rust::Result<fs::path> make_probe_directory()
+    {
+        std::string buffer = (fs::temp_directory_path() / "bear-doctor-XXXXXX").string();
+        if (::mkdtemp(buffer.data()) == nullptr) {
+            return rust::Err(std::runtime_error("Failed to create a temporary directory for the probe."));
+        }
+        return rust::Ok(fs::path(buffer));
+    }
+}
+
+namespace ic {
+
+    rust::Result<int> DoctorCommand::execute() const
+    {
+        const auto compiler = find_compiler(environment_);
+        if (!compiler.has_value()) {
+            return rust::Err(std::runtime_error("No compiler found on the PATH to probe with."));
+        }
+        // the compiler is resolved through the PATH inside the loop, so
+        // the wrapper engine has a chance to interpose it.
+        const std::string script = fmt::format(
+                "i=0; while [ $i -lt {0} ]; do {1} --version >/dev/null 2>&1; i=$((i+1)); done",
+                executions_, compiler->filename().string());
+
+        const auto baseline = timed_run(sys::Process::Builder("/bin/sh")
+                .set_environment(environment_)
+                .add_argument("/bin/sh")
+                .add_argument("-c")
+                .add_argument(script));
+        if (baseline.is_err()) {
+            return rust::Err(std::runtime_error("Running the probe workload without interception failed."));
+        }
+
+        fmt::print("probing with {} compiler executions of {}\n\n", executions_, compiler->string());
+        fmt::print("{:<10}  {:>18}  {:>8}  note\n", "engine", "per-exec overhead", "events");
+
+        std::optional<Engine> winner;
+        int64_t winner_overhead = 0;
+        for (const auto &engine : ENGINES) {
+            auto directory = make_probe_directory();
+            if (directory.is_err()) {
+                return rust::Err(directory.unwrap_err());
+            }
+            const fs::path output = directory.unwrap() / "events.db";
+            const auto elapsed = timed_run(sys::Process::Builder(bear_)
+                    .set_environment(environment_)
+                    .add_argument(bear_.string())
+                    .add_argument("intercept")
+                    .add_argument(cmd::intercept::FLAG_OUTPUT).add_argument(output)
+                    .add_argument(engine.force_flag)
+                    .add_argument(cmd::intercept::FLAG_COMMAND)
+                    .add_argument("/bin/sh")
+                    .add_argument("-c")
+                    .add_argument(script));
+            const size_t events = elapsed.is_ok() ? count_started_events(output) : 0;
+
+            std::error_code error_code;
+            fs::remove_all(directory.unwrap(), error_code);
+
+            if (elapsed.is_err()) {
+                fmt::print("{:<10}  {:>18}  {:>8}  {}\n", engine.name, "-", "-", elapsed.unwrap_err().what());
+                continue;
+            }
+            // the engine has to see at least the compiler executions of
+            // the loop; fewer means it misses processes on this host.
+            if (events < executions_) {
+                fmt::print("{:<10}  {:>18}  {:>8}  incomplete coverage\n", engine.name, "-", events);
+                continue;
+            }
+            const auto overhead = std::max(int64_t(0), elapsed.unwrap() - baseline.unwrap()) / int64_t(executions_);
+            fmt::print("{:<10}  {:>15} us  {:>8}\n", engine.name, overhead, events);
+            if (!winner.has_value() || overhead < winner_overhead) {
+                winner = engine;
+                winner_overhead = overhead;
+            }
+        }
+
+        if (!winner.has_value()) {
+            return rust::Err(std::runtime_error("No engine intercepted the probe workload."));
+        }
+        return Session::record_engine_preference(winner->name)
+                .map<int>([&winner](const auto &file) {
+                    fmt::print("\nselected engine: {} (recorded in {})\n", winner->name, file.string());
+                    return EXIT_SUCCESS;
+                });
+    }
+
+    Doctor::Doctor(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("doctor", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Doctor::command(const flags::Arguments &args, const char **envp) const {
+        const auto executions = args.as_string(cmd::doctor::FLAG_EXECUTIONS)
+                .map<size_t>([](auto value) { return size_t(strtoul(value.data(), nullptr, 10)); })
+                .unwrap_or(50);
+        return args.as_string(cmd::bear::FLAG_BEAR)
+                .map<ps::CommandPtr>([&executions, &envp](auto bear) {
+                    return std::make_unique<DoctorCommand>(
+                            fs::path(bear), std::max(size_t(1), executions), sys::env::from(envp));
+                });
+    }
+}
@@ -0,0 +1,63 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libmain/SubcommandFromArgs.h"
+#include "libsys/Environment.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace ic {
+
+    // Probes the interception engines on this host and records the
+    // fastest one, so the later runs pick it without a force flag.
+    //
+    // Each engine is probed with the same micro workload: a shell loop
+    // running the compiler a fixed number of times. The loop is timed
+    // bare first, then under each engine, and the produced events are
+    // counted. An engine that failed to start, or saw fewer compiler
+    // executions than the loop ran (a preload library does not see
+    // static binaries, and SIP strips it from protected ones), is out;
+    // among the rest the lowest per-execution overhead wins. The winner
+    // goes into a host-local cache file that the session selection
+    // consults.
+    struct DoctorCommand : ps::Command {
+
+        DoctorCommand(fs::path bear, size_t executions, sys::env::Vars environment)
+                : ps::Command()
+                , bear_(std::move(bear))
+                , executions_(executions)
+                , environment_(std::move(environment))
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(DoctorCommand)
+        NON_COPYABLE_NOR_MOVABLE(DoctorCommand)
+
+    private:
+        fs::path bear_;
+        size_t executions_;
+        sys::env::Vars environment_;
+    };
+}
@@ -0,0 +1,103 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EventQueue.h"
+
+#include <utility>
+
+namespace {
+
+    size_t round_up_to_power_of_two(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1u;
+        }
+        return result;
+    }
+}
+
+namespace ic::collect {
+
+    EventQueue::EventQueue(size_t capacity)
+            : cells_()
+            , mask_(round_up_to_power_of_two(capacity) - 1)
+            , enqueue_position_(0)
+            , dequeue_position_(0)
+    {
+        cells_ = std::make_unique<Cell[]>(mask_ + 1);
+        for (size_t index = 0; index <= mask_; ++index) {
+            cells_[index].sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+
+    bool EventQueue::push(rpc::Event &&event) noexcept {
+        size_t position = enqueue_position_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[position & mask_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = intptr_t(sequence) - intptr_t(position);
+            if (difference == 0) {
+                // The cell is free. Claim it by advancing the enqueue
+                // position, or retry when another producer was faster.
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.event = std::move(event);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The cell still holds an event the consumer has not taken.
+                return false;
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool EventQueue::pop(rpc::Event &event) noexcept {
+        size_t position = dequeue_position_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[position & mask_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = intptr_t(sequence) - intptr_t(position + 1);
+            if (difference == 0) {
+                // The cell holds an event. Claim it by advancing the
+                // dequeue position, or retry when another consumer was
+                // faster.
+                if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    event = std::move(cell.event);
+                    cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The producer has not finished writing the cell yet.
+                return false;
+            } else {
+                position = dequeue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t EventQueue::depth() const noexcept {
+        const size_t enqueue = enqueue_position_.load(std::memory_order_relaxed);
+        const size_t dequeue = dequeue_position_.load(std::memory_order_relaxed);
+        // The two loads race with the producers and the consumers; clamp
+        // the transiently inverted readings to zero.
+        return (enqueue > dequeue) ? (enqueue - dequeue) : 0;
+    }
+}
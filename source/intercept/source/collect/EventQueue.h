@@ -0,0 +1,67 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "intercept.pb.h"
+
+#include <atomic>
+#include <memory>
+
+namespace ic::collect {
+
+    // A bounded lock-free queue for events, with many producers and many
+    // consumers. The gRPC handler threads push the events without
+    // blocking each other, and the writer threads drain them.
+    //
+    // The implementation is the classic bounded ring buffer with a
+    // per-cell sequence counter (by Dmitry Vyukov). A full queue rejects
+    // the push instead of blocking; the caller decides how to deal with
+    // the overflow.
+    class EventQueue {
+    public:
+        explicit EventQueue(size_t capacity);
+
+        // Called from the producer threads. Takes the event on success,
+        // returns false when the queue is full.
+        [[nodiscard]] bool push(rpc::Event &&event) noexcept;
+        // Called from the consumer threads. Returns false when the
+        // queue is empty.
+        [[nodiscard]] bool pop(rpc::Event &event) noexcept;
+        // The number of events waiting in the queue. A racy snapshot,
+        // good enough to steer decisions like adding a consumer.
+        [[nodiscard]] size_t depth() const noexcept;
+
+        NON_DEFAULT_CONSTRUCTABLE(EventQueue)
+        NON_COPYABLE_NOR_MOVABLE(EventQueue)
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            rpc::Event event;
+        };
+
+    private:
+        std::unique_ptr<Cell[]> cells_;
+        size_t mask_;
+        alignas(64) std::atomic<size_t> enqueue_position_;
+        alignas(64) std::atomic<size_t> dequeue_position_;
+    };
+}
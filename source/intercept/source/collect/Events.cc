@@ -0,0 +1,132 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/Events.h"
+#include "intercept/intercept-forward.h"
+
+#include <google/protobuf/util/json_util.h>
+#include <google/protobuf/util/time_util.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+using google::protobuf::util::JsonPrintOptions;
+using google::protobuf::util::TimeUtil;
+
+namespace db = ic::collect::db;
+
+namespace {
+
+    JsonPrintOptions create_print_options() {
+        JsonPrintOptions print_options;
+        print_options.add_whitespace = false;
+        print_options.always_print_primitive_fields = true;
+        print_options.preserve_proto_field_names = true;
+        print_options.always_print_enums_as_ints = false;
+        return print_options;
+    }
+
+    const JsonPrintOptions print_options = create_print_options();
+
+    bool all_digits(const std::string &input) {
+        return !input.empty()
+                && std::all_of(input.begin(), input.end(), [](unsigned char c) { return std::isdigit(c); });
+    }
+
+    // A time bound is either the microseconds since the epoch (a plain
+    // integer) or an RFC 3339 timestamp (what the JSON events carry).
+    std::optional<uint64_t> parse_time(const std::string &input) {
+        if (all_digits(input)) {
+            return std::stoull(input);
+        }
+        google::protobuf::Timestamp timestamp;
+        if (TimeUtil::FromString(input, &timestamp)) {
+            return uint64_t(TimeUtil::TimestampToMicroseconds(timestamp));
+        }
+        return std::nullopt;
+    }
+
+    // A pid selection is a single pid or an inclusive "first-last" range.
+    std::optional<std::pair<uint32_t, uint32_t>> parse_pids(const std::string &input) {
+        const auto dash = input.find('-');
+        const auto first = input.substr(0, dash);
+        const auto last = (dash == std::string::npos) ? first : input.substr(dash + 1);
+        if (!all_digits(first) || !all_digits(last)) {
+            return std::nullopt;
+        }
+        return std::make_pair(uint32_t(std::stoul(first)), uint32_t(std::stoul(last)));
+    }
+}
+
+namespace ic {
+
+    rust::Result<int> EventsCommand::execute() const
+    {
+        return db::EventsDatabaseReader::from(input_)
+                .and_then<int>([this](const auto &reader) {
+                    return reader->query(query_, [](const db::EventPtr &event) {
+                                std::string json;
+                                if (google::protobuf::util::MessageToJsonString(*event, &json, print_options).ok()) {
+                                    fmt::print("{}\n", json);
+                                }
+                            })
+                            .template map<int>([](const auto count) {
+                                spdlog::debug("{} events matched the query.", count);
+                                return EXIT_SUCCESS;
+                            });
+                });
+    }
+
+    Events::Events(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("events", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Events::command(const flags::Arguments &args, const char **) const {
+        auto input = args.as_string(cmd::events::FLAG_INPUT);
+        if (input.is_err()) {
+            return rust::Err(input.unwrap_err());
+        }
+        db::EventsDatabaseQuery query;
+        if (const auto since = args.as_string(cmd::events::FLAG_SINCE); since.is_ok()) {
+            query.since = parse_time(std::string(since.unwrap()));
+            if (!query.since) {
+                return rust::Err(std::runtime_error("The since value is neither a timestamp nor microseconds."));
+            }
+        }
+        if (const auto until = args.as_string(cmd::events::FLAG_UNTIL); until.is_ok()) {
+            query.until = parse_time(std::string(until.unwrap()));
+            if (!query.until) {
+                return rust::Err(std::runtime_error("The until value is neither a timestamp nor microseconds."));
+            }
+        }
+        if (const auto pids = args.as_string(cmd::events::FLAG_PID); pids.is_ok()) {
+            query.pids = parse_pids(std::string(pids.unwrap()));
+            if (!query.pids) {
+                return rust::Err(std::runtime_error("The pid value is neither a pid nor a pid range."));
+            }
+        }
+        return rust::Ok<ps::CommandPtr>(std::make_unique<EventsCommand>(fs::path(input.unwrap()), query));
+    }
+}
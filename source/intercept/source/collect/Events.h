@@ -0,0 +1,53 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "libmain/SubcommandFromArgs.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace ic {
+
+    // Prints the events of an events database which match a time window
+    // and a pid range, one JSON object per line. On an indexed database
+    // the selection runs on the index sidecar, so only the matching
+    // records are read from the file.
+    struct EventsCommand : ps::Command {
+
+        EventsCommand(fs::path input, collect::db::EventsDatabaseQuery query)
+                : ps::Command()
+                , input_(std::move(input))
+                , query_(query)
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(EventsCommand)
+        NON_COPYABLE_NOR_MOVABLE(EventsCommand)
+
+    private:
+        fs::path input_;
+        collect::db::EventsDatabaseQuery query_;
+    };
+}
@@ -17,21 +17,37 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "HybridClock.h"
+#include "collect/Affinity.h"
 #include "collect/Intercept.h"
+#include "collect/Metrics.h"
 #include "collect/Reporter.h"
 #include "collect/RpcServices.h"
 #include "collect/Session.h"
 #include "report/libexec/Resolver.h"
+#include "report/libexec/ShmRing.h"
 #include "libsys/Environment.h"
 #include "libsys/Errors.h"
 #include "libsys/Os.h"
+#include "libsys/Signal.h"
 
-#include <grpcpp/security/server_credentials.h>
-#include <grpcpp/server_builder.h>
+#include <google/protobuf/util/time_util.h>
 #include <spdlog/spdlog.h>
 #include <fmt/format.h>
 
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <filesystem>
+#include <optional>
+#include <random>
+#include <thread>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -77,47 +93,368 @@ namespace {
                     };
                 });
     }
+
+    // The host name the intercepted processes shall connect to. Local
+    // builds use the loopback name; when the collector listens on an
+    // external address, the machine's host name is handed out, so remote
+    // build workers can reach it.
+    std::string service_host(const std::string &listen_address)
+    {
+        if (listen_address.empty()) {
+            return "localhost";
+        }
+        char buffer[HOST_NAME_MAX + 1] = {0};
+        return (gethostname(buffer, HOST_NAME_MAX) == 0) ? std::string(buffer) : listen_address;
+    }
+
+    // The locator the reporting processes shall connect to. A vsock
+    // listener (builds inside microVMs) is handed out through the well
+    // known host CID: from a guest, the host is always CID 2, no matter
+    // which CID the listen URI bound. The TCP listeners hand out the
+    // machine's host name, and a local session the loopback name.
+    std::string service_locator(const std::string &listen_address, int port)
+    {
+        if (listen_address.rfind("vsock:", 0) == 0) {
+            return fmt::format("vsock:2:{}", port);
+        }
+        return fmt::format("dns:///{}:{}", service_host(listen_address), port);
+    }
+
+    // A random session token. It guards a collector listening on an
+    // external address against events from unrelated processes.
+    std::string generate_token()
+    {
+        std::mt19937_64 generator(std::random_device{}());
+        return fmt::format("{:016x}{:016x}", generator(), generator());
+    }
+
+    // Quotes a value for the POSIX shell, so the printed export lines can
+    // be sourced as they are.
+    std::string shell_quote(const std::string &value)
+    {
+        std::string result = "'";
+        for (const char character : value) {
+            if (character == '\'') {
+                result += "'\\''";
+            } else {
+                result += character;
+            }
+        }
+        result += '\'';
+        return result;
+    }
+
+    // The collector persists the events of an attached session with a
+    // small delay (its queue is drained by a separate thread). After the
+    // build command finished, wait until the session database stops
+    // growing - capped, so a stuck collector can not hold the build.
+    void wait_for_quiet(const fs::path &output)
+    {
+        std::error_code error_code;
+        auto last = fs::file_size(output, error_code);
+        for (int round = 0; round < 20; ++round) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            const auto size = fs::file_size(output, error_code);
+            if (!error_code && (size == last)) {
+                return;
+            }
+            last = error_code ? 0 : size;
+        }
+    }
+
+    // Turn the fixed layout records of the shared memory ring into started
+    // events, and feed them to the reporter. The ring records carry no
+    // environment (it would not fit a fixed size slot), which is fine for
+    // the semantic analysis: it only needs the command itself.
+    void drain_ring(el::shm::Ring &ring, ic::Reporter &reporter, const std::atomic<bool> &done)
+    {
+        std::mt19937_64 generator(std::random_device{}());
+        const auto slot = std::make_unique<el::shm::Slot>();
+        for (;;) {
+            if (el::shm::pop(ring, *slot)) {
+                if (slot->length == 0) {
+                    // The producer dropped the record, only the slot remained.
+                    continue;
+                }
+                std::vector<std::string_view> fields;
+                for (const char *it = slot->data; it < slot->data + slot->length; it += fields.back().size() + 1) {
+                    fields.emplace_back(it);
+                }
+                if (fields.size() < 2) {
+                    continue;
+                }
+                rpc::Event event;
+                event.set_rid(generator());
+                domain::hlc::stamp(event);
+                *event.mutable_timestamp() = google::protobuf::util::TimeUtil::GetCurrentTime();
+                auto &started = *event.mutable_started();
+                started.set_pid(slot->pid);
+                started.set_ppid(slot->ppid);
+                auto &execution = *started.mutable_execution();
+                execution.set_working_dir(std::string(fields[0]));
+                execution.set_executable(std::string(fields[1]));
+                for (size_t index = 2; index < fields.size(); ++index) {
+                    execution.add_arguments(std::string(fields[index]));
+                }
+                reporter.report(event);
+            } else if (done.load(std::memory_order_acquire)) {
+                // The build is over, and the last pop saw an empty ring.
+                break;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+    }
 }
 
 namespace ic {
 
     rust::Result<int> Command::execute() const
     {
+        const auto started = std::chrono::steady_clock::now();
         // Create and start the gRPC server
-        int port = 0;
-        ic::SupervisorImpl supervisor(*session_);
-        ic::InterceptorImpl interceptor(*reporter_);
-        auto server = grpc::ServerBuilder()
-                          .RegisterService(&supervisor)
-                          .RegisterService(&interceptor)
-                          .AddListeningPort("dns:///localhost:0", grpc::InsecureServerCredentials(), &port)
-                          .BuildAndStart();
-
-        // Create session_locator URL for the services
-        auto session_locator = SessionLocator(fmt::format("dns:///localhost:{}", port));
-        spdlog::debug("Running gRPC server. {0}", session_locator);
-        // Execute the build command
-        auto result = session_->run(execution_, session_locator);
-        // Stop the gRPC server
-        spdlog::debug("Stopping gRPC server.");
-        server->Shutdown();
-        // Exit with the build status
+        ic::RpcServer server(*session_, *reporter_, server_threads_, listen_address_, token_);
+        return server.start()
+                .and_then<int>([this, &server, &started](auto port) {
+                    // Start draining the shared memory ring, when the session has one.
+                    std::atomic<bool> done(false);
+                    std::thread drainer;
+                    if (auto *ring = session_->events_ring(); ring != nullptr) {
+                        auto &reporter = *reporter_;
+                        drainer = std::thread([ring, &reporter, &done]() {
+                            drain_ring(*ring, reporter, done);
+                        });
+                    }
+                    // Create session_locator URL for the services
+                    auto session_locator = SessionLocator(service_locator(listen_address_, port));
+                    spdlog::debug("Running gRPC server. {0}", session_locator);
+                    // Execute the build command
+                    session_->start_supervision(*reporter_);
+                    const auto supervised = std::chrono::steady_clock::now();
+                    auto result = session_->run(execution_, session_locator);
+                    const auto built = std::chrono::steady_clock::now();
+                    session_->stop_supervision();
+                    // Let the drain thread consume the remaining records.
+                    done.store(true, std::memory_order_release);
+                    if (drainer.joinable()) {
+                        drainer.join();
+                    }
+                    // Stop the gRPC server
+                    spdlog::debug("Stopping gRPC server.");
+                    server.shutdown();
+                    if (profile_) {
+                        // The shard merge runs when the reporter is
+                        // destroyed; it prints its own profile line.
+                        struct rusage usage = {};
+                        getrusage(RUSAGE_SELF, &usage);
+                        const auto cpu_ms = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+                                + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+                        spdlog::info("profile: session setup took {} ms, build took {} ms, event drain took {} ms, collector cpu {} ms.",
+                                     std::chrono::duration_cast<std::chrono::milliseconds>(supervised - started).count(),
+                                     std::chrono::duration_cast<std::chrono::milliseconds>(built - supervised).count(),
+                                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             std::chrono::steady_clock::now() - built).count(),
+                                     cpu_ms);
+                    }
+                    // Exit with the build status
+                    return result;
+                });
+    }
+
+    rust::Result<int> AttachedCommand::execute() const
+    {
+        const fs::path output = fs::absolute(output_);
+        // The session id is the path of the events database this build
+        // asked for: the collector writes the events of this session
+        // straight into it. (The attached builds and the collector share
+        // a filesystem; sharing one collector over the builds of one
+        // host is the point of attaching.)
+        sys::env::Vars environment(environment_);
+        environment[cmd::wrapper::KEY_SESSION] = output.string();
+        // The shared memory ring of the collector can not carry the
+        // session id. Without the ring variable the preloaded library
+        // reports through the supervisor process instead, which sends
+        // the id with every call.
+        environment.erase(cmd::library::KEY_RING);
+
+        spdlog::debug("Attaching to the collector. [{0}]", environment_.at(cmd::wrapper::KEY_DESTINATION));
+        auto result = sys::Process::Builder(execution_.executable)
+                .add_arguments(execution_.arguments.begin(), execution_.arguments.end())
+                .set_environment(environment)
+                .spawn()
+                .and_then<sys::ExitStatus>([](auto child) {
+                    sys::SignalForwarder guard(child);
+                    return child.wait();
+                })
+                .map<int>([](auto status) {
+                    return status.code().value_or(EXIT_FAILURE);
+                })
+                .on_error([](auto error) {
+                    spdlog::warn("Command execution failed: {}", error.what());
+                })
+                .on_success([](auto status) {
+                    spdlog::debug("Running command. [Exited with {0}]", status);
+                });
+        // The collector may still be flushing when the build command
+        // returned; the later steps (like the semantic analysis) expect
+        // the events on disk.
+        wait_for_quiet(output);
+        if (!fs::exists(output)) {
+            // A build without intercepted processes leaves no session
+            // database behind; the later steps still expect the file.
+            ic::collect::db::EventsDatabaseWriter::create(output, ic::collect::db::EventsDatabaseFormat::JSON, 0, false)
+                    .on_error([&output](auto error) {
+                        spdlog::warn("Creating the events database {} failed: {}", output.string(), error.what());
+                    });
+        }
         return result;
     }
 
+    rust::Result<int> ServiceCommand::execute() const
+    {
+        // Block the termination signals before any thread is created, so
+        // they all inherit the mask and the sigwait below is the only
+        // place where the signals are delivered.
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        // A hangup would otherwise kill the daemon with the in-flight
+        // events unflushed. The collector has no configuration to
+        // reload (the recognition settings belong to the separate
+        // citnames runs, and their caches live on disk), so a hangup
+        // drains and stops cleanly, like a termination request.
+        sigaddset(&mask, SIGHUP);
+        pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+        // Create and start the gRPC server
+        ic::RpcServer server(*session_, *reporter_, server_threads_, listen_address_, token_);
+        return server.start()
+                .and_then<int>([this, &server, &mask](auto port) {
+                    // Start draining the shared memory ring, when the session has one.
+                    std::atomic<bool> done(false);
+                    std::thread drainer;
+                    if (auto *ring = session_->events_ring(); ring != nullptr) {
+                        auto &reporter = *reporter_;
+                        drainer = std::thread([ring, &reporter, &done]() {
+                            drain_ring(*ring, reporter, done);
+                        });
+                    }
+                    // Create session_locator URL for the services
+                    auto session_locator = SessionLocator(service_locator(listen_address_, port));
+                    spdlog::debug("Running gRPC server. {0}", session_locator);
+                    session_->set_locator(session_locator);
+                    // Print the variables the session would set on a supervised
+                    // build, so a shell can export them and run builds against
+                    // this collector. Only the added or changed ones are printed.
+                    for (const auto &[key, value] : session_->environment(environment_)) {
+                        if (auto it = environment_.find(key); it == environment_.end() || it->second != value) {
+                            fmt::print("export {0}={1}\n", key, shell_quote(value));
+                        }
+                    }
+                    std::fflush(stdout);
+                    // Publish the collector counters, when requested. A
+                    // failed bind is logged but does not stop the daemon:
+                    // losing the scrape is better than losing the build.
+                    std::optional<ic::MetricsEndpoint> metrics;
+                    if (!metrics_address_.empty()) {
+                        metrics.emplace(*reporter_);
+                        auto started = metrics->start(metrics_address_);
+                        if (started.is_err()) {
+                            started.on_error([](auto error) {
+                                spdlog::warn("Starting the metrics endpoint failed: {}", error.what());
+                            });
+                            metrics.reset();
+                        } else {
+                            spdlog::debug("Metrics endpoint is listening. [port: {0}]", started.unwrap());
+                        }
+                    }
+                    // Wait until the user stops the daemon.
+                    session_->start_supervision(*reporter_);
+                    int signal = 0;
+                    sigwait(&mask, &signal);
+                    spdlog::debug("Signal received. [{0}]", signal);
+                    session_->stop_supervision();
+                    if (metrics.has_value()) {
+                        metrics->shutdown();
+                    }
+                    // Let the drain thread consume the remaining records.
+                    done.store(true, std::memory_order_release);
+                    if (drainer.joinable()) {
+                        drainer.join();
+                    }
+                    // Stop the gRPC server
+                    spdlog::debug("Stopping gRPC server.");
+                    server.shutdown();
+                    return rust::Result<int>(rust::Ok(EXIT_SUCCESS));
+                });
+    }
+
     Intercept::Intercept(const ps::ApplicationLogConfig& log_config) noexcept
             : ps::SubcommandFromArgs("intercept", log_config)
     { }
 
     rust::Result<ps::CommandPtr> Intercept::command(const flags::Arguments &args, const char **envp) const {
-        const auto execution = capture_execution(args, sys::env::from(envp));
         const auto session = Session::from(args, envp);
         const auto reporter = Reporter::from(args);
+        const auto server_threads = args.as_string(cmd::intercept::FLAG_SERVER_THREADS)
+                .map<size_t>([](auto value) { return size_t(strtoul(value.data(), nullptr, 10)); })
+                .unwrap_or(0);
+        // Install the cpu set the collector threads shall run on, before
+        // any of them is created.
+        const std::string affinity_spec(args.as_string(cmd::intercept::FLAG_AFFINITY).unwrap_or(""));
+        if (auto configured = affinity::configure(affinity_spec); configured.is_err()) {
+            return rust::Err(configured.unwrap_err());
+        }
+        // A collector on an external address is guarded by a session
+        // token, which the sessions hand over to the reporting processes.
+        const std::string listen_address(args.as_string(cmd::intercept::FLAG_LISTEN).unwrap_or(""));
+        const std::string token = listen_address.empty() ? std::string() : generate_token();
+        const std::string metrics_address(args.as_string(cmd::intercept::FLAG_METRICS).unwrap_or(""));
+
+        // The daemon mode has no build command to run.
+        if (args.as_bool(cmd::intercept::FLAG_DAEMON).unwrap_or(false)) {
+            // The seccomp filter covers only the descendants of the process
+            // which installed it; a build started from another shell is not
+            // one of them.
+            if (args.as_bool(cmd::intercept::FLAG_FORCE_SECCOMP).unwrap_or(false)) {
+                return rust::Err(std::runtime_error("Seccomp interception needs to start the build command; it can't run as daemon."));
+            }
+            // The EndpointSecurity filter tracks the descendants of this
+            // process; a build started from another shell is not one.
+            if (args.as_bool(cmd::intercept::FLAG_FORCE_ES).unwrap_or(false)) {
+                return rust::Err(std::runtime_error("EndpointSecurity interception needs to start the build command; it can't run as daemon."));
+            }
+            return rust::merge(session, reporter)
+                    .map<ps::CommandPtr>([&server_threads, &envp, &listen_address, &token, &metrics_address](auto tuple) {
+                        const auto&[session, reporter] = tuple;
+                        session->set_token(token);
+                        return std::make_unique<ServiceCommand>(session, reporter, sys::env::from(envp), server_threads, listen_address, token, metrics_address);
+                    });
+        }
+
+        // When the environment carries the variables of a running
+        // collector (the exports of a daemon, sourced into this shell),
+        // attach the build to it instead of starting a second collector
+        // with its own server and event pipeline.
+        auto environment = sys::env::from(envp);
+        if (environment.find(cmd::wrapper::KEY_DESTINATION) != environment.end()) {
+            const auto execution = capture_execution(args, sys::env::Vars(environment));
+            const auto output = args.as_string(cmd::intercept::FLAG_OUTPUT);
+            return rust::merge(execution, output)
+                    .map<ps::CommandPtr>([&environment](auto tuple) {
+                        const auto&[execution, output] = tuple;
+                        return std::make_unique<AttachedCommand>(execution, fs::path(output), std::move(environment));
+                    });
+        }
 
+        const auto profile = args.as_bool(cmd::bear::FLAG_PROFILE).unwrap_or(false);
+        const auto execution = capture_execution(args, std::move(environment));
         return rust::merge(execution, session, reporter)
-                .map<ps::CommandPtr>([](auto tuple) {
+                .map<ps::CommandPtr>([&server_threads, &listen_address, &token, &profile](auto tuple) {
                     const auto&[execution, session, reporter] = tuple;
-                    return std::make_unique<Command>(execution, session, reporter);
+                    session->set_token(token);
+                    return std::make_unique<Command>(execution, session, reporter, server_threads, listen_address, token, profile);
                 });
     }
 }
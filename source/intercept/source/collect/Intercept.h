@@ -21,6 +21,7 @@
 
 #include "config.h"
 #include "libmain/SubcommandFromArgs.h"
+#include "libsys/Environment.h"
 #include "Session.h"
 #include "Reporter.h"
 
@@ -34,11 +35,16 @@ namespace ic {
 
     struct Command : ps::Command {
 
-        Command(Execution execution, Session::Ptr session, Reporter::Ptr reporter)
+        Command(Execution execution, Session::Ptr session, Reporter::Ptr reporter, size_t server_threads,
+                std::string listen_address, std::string token, bool profile)
                 : ps::Command()
                 , execution_(std::move(execution))
                 , session_(std::move(session))
                 , reporter_(std::move(reporter))
+                , server_threads_(server_threads)
+                , listen_address_(std::move(listen_address))
+                , token_(std::move(token))
+                , profile_(profile)
         { }
 
         [[nodiscard]] rust::Result<int> execute() const override;
@@ -50,5 +56,69 @@ namespace ic {
         Execution execution_;
         Session::Ptr session_;
         Reporter::Ptr reporter_;
+        size_t server_threads_;
+        std::string listen_address_;
+        std::string token_;
+        // Print how long the phases of the run took at exit.
+        bool profile_;
+    };
+
+    // Runs the build against an already running collector instead of
+    // starting a second one. Used when the environment carries the
+    // variables of a collector (the exports of a daemon, sourced into
+    // the shell): the build processes report there, and the collector
+    // routes the events of this session into the requested output file.
+    struct AttachedCommand : ps::Command {
+
+        AttachedCommand(Execution execution, fs::path output, sys::env::Vars environment)
+                : ps::Command()
+                , execution_(std::move(execution))
+                , output_(std::move(output))
+                , environment_(std::move(environment))
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(AttachedCommand)
+        NON_COPYABLE_NOR_MOVABLE(AttachedCommand)
+
+    private:
+        Execution execution_;
+        fs::path output_;
+        sys::env::Vars environment_;
+    };
+
+    // Runs the collecting services without a build command. The server
+    // stays up until SIGINT or SIGTERM arrives, and the builds are started
+    // by the user from other shells. The environment variables those
+    // shells shall export are printed on the standard output.
+    struct ServiceCommand : ps::Command {
+
+        ServiceCommand(Session::Ptr session, Reporter::Ptr reporter, sys::env::Vars environment, size_t server_threads,
+                       std::string listen_address, std::string token, std::string metrics_address)
+                : ps::Command()
+                , session_(std::move(session))
+                , reporter_(std::move(reporter))
+                , environment_(std::move(environment))
+                , server_threads_(server_threads)
+                , listen_address_(std::move(listen_address))
+                , token_(std::move(token))
+                , metrics_address_(std::move(metrics_address))
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(ServiceCommand)
+        NON_COPYABLE_NOR_MOVABLE(ServiceCommand)
+
+    private:
+        Session::Ptr session_;
+        Reporter::Ptr reporter_;
+        sys::env::Vars environment_;
+        size_t server_threads_;
+        std::string listen_address_;
+        std::string token_;
+        // When not empty, the collector counters are published here.
+        std::string metrics_address_;
     };
 }
@@ -0,0 +1,306 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/Merge.h"
+#include "HybridClock.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "collect/db/EventsDatabaseWriter.h"
+#include "collect/db/ExternalDedup.h"
+#include "intercept/intercept-forward.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace db = ic::collect::db;
+
+namespace {
+
+    // Bounds the events waiting for the writer, so the readers do not
+    // balloon the memory usage when they are faster than the writer.
+    constexpr size_t MERGE_QUEUE_LIMIT = 4 * 1024;
+
+    uint64_t fnv1a_step(uint64_t hash, const std::string &value) {
+        for (const char character : value) {
+            hash ^= uint8_t(character);
+            hash *= 0x100000001b3;
+        }
+        // terminate the value, so adjacent values do not collide.
+        hash ^= 0xff;
+        hash *= 0x100000001b3;
+        return hash;
+    }
+
+    // Content digest of a started event. Two executions with the same
+    // executable, arguments and working directory are considered the same
+    // compilation, whichever input file captured them. (The environment is
+    // left out on purpose: protobuf map iteration order is unspecified,
+    // and the environment does not distinguish compilations anyway.)
+    uint64_t digest(const rpc::Event &event) {
+        uint64_t hash = 0xcbf29ce484222325;
+        const auto &execution = event.started().execution();
+        hash = fnv1a_step(hash, execution.executable());
+        hash = fnv1a_step(hash, execution.working_dir());
+        for (const auto &argument : execution.arguments()) {
+            hash = fnv1a_step(hash, argument);
+        }
+        return hash;
+    }
+
+    // Tie the lifecycle events to their started event in the external
+    // dedup stage. The run identifiers are only unique within a single
+    // capture, so the input index is mixed in. (The stage compares the
+    // owners for equality only, a hash is as good as the pair; the
+    // duplicate detection itself accepts 64 bit digest equality too.)
+    uint64_t owner_of(size_t index, uint64_t rid) {
+        uint64_t hash = 0xcbf29ce484222325;
+        hash = fnv1a_step(hash, std::to_string(index));
+        hash = fnv1a_step(hash, std::to_string(rid));
+        return hash;
+    }
+}
+
+namespace ic {
+
+    rust::Result<int> MergeCommand::execute() const
+    {
+        // Refuse to overwrite one of the inputs with the merge result.
+        if (std::find(inputs_.begin(), inputs_.end(), output_) != inputs_.end()) {
+            return rust::Err(std::runtime_error("The output file is one of the input files."));
+        }
+        return db::EventsDatabaseWriter::create(output_, format_, db::EventsDatabaseWriter::DEFAULT_FLUSH_THRESHOLD, compress_)
+                .and_then<int>([this](auto writer) -> rust::Result<int> {
+                    std::mutex mutex;
+                    std::condition_variable ready;
+                    std::condition_variable space;
+                    std::vector<std::deque<db::EventPtr>> queues(inputs_.size());
+                    std::vector<bool> done(inputs_.size(), false);
+                    std::vector<std::string> failures;
+                    const size_t queue_limit = std::max<size_t>(MERGE_QUEUE_LIMIT / inputs_.size(), 64);
+
+                    // One reader thread per input file: the event parsing is
+                    // the expensive part, and it runs in parallel. The writer
+                    // (this thread) merges the per input queues in clock
+                    // order. Within one file the events are already ordered
+                    // (each node stamps them with a monotonic clock), so
+                    // picking the smallest head yields the global order.
+                    std::vector<std::thread> readers;
+                    readers.reserve(inputs_.size());
+                    for (size_t index = 0; index < inputs_.size(); ++index) {
+                        readers.emplace_back([this, index, &mutex, &ready, &space, &queues, &done, &failures, queue_limit]() {
+                            auto result = db::EventsDatabaseReader::from(inputs_[index]);
+                            if (result.is_err()) {
+                                const std::lock_guard<std::mutex> guard(mutex);
+                                failures.emplace_back(fmt::format("{}: {}", inputs_[index].string(), result.unwrap_err().what()));
+                            } else {
+                                auto reader = result.unwrap();
+                                for (auto event = reader->next(); event.has_value(); event = reader->next()) {
+                                    if (event->is_err()) {
+                                        const std::lock_guard<std::mutex> guard(mutex);
+                                        failures.emplace_back(fmt::format("{}: {}", inputs_[index].string(), event->unwrap_err().what()));
+                                        break;
+                                    }
+                                    std::unique_lock<std::mutex> lock(mutex);
+                                    space.wait(lock, [&queues, index, queue_limit]() { return queues[index].size() < queue_limit; });
+                                    queues[index].emplace_back(event->unwrap());
+                                    lock.unlock();
+                                    ready.notify_one();
+                                }
+                            }
+                            {
+                                const std::lock_guard<std::mutex> guard(mutex);
+                                done[index] = true;
+                            }
+                            ready.notify_one();
+                        });
+                    }
+
+                    // The executions already written, and the run identifiers
+                    // of the dropped ones (per input file, the identifiers are
+                    // only unique within a single capture). With a memory
+                    // budget set, these key sets would not fit: the events go
+                    // through the spill to disk dedup stage instead, and only
+                    // the digests of the still running executions are tracked
+                    // here (to key the lifecycle events by their execution).
+                    const bool external = (max_memory_ > 0);
+                    std::optional<db::ExternalDedup> dedup;
+                    if (external) {
+                        dedup.emplace(output_, max_memory_);
+                    }
+                    std::unordered_set<uint64_t> seen;
+                    std::set<std::pair<size_t, uint64_t>> dropped;
+                    std::map<std::pair<size_t, uint64_t>, uint64_t> live;
+                    size_t count = 0;
+                    rust::Result<int> status = rust::Ok(0);
+                    for (;;) {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        // The smallest head can only be picked when every
+                        // input either finished or has its head event.
+                        ready.wait(lock, [&queues, &done]() {
+                            for (size_t i = 0; i < queues.size(); ++i) {
+                                if (!done[i] && queues[i].empty()) {
+                                    return false;
+                                }
+                            }
+                            return true;
+                        });
+                        // Pick the input whose head event has the smallest
+                        // clock; the node identity breaks the ties, so the
+                        // merge result is deterministic.
+                        size_t index = queues.size();
+                        uint64_t best_key = 0;
+                        uint32_t best_node = 0;
+                        for (size_t i = 0; i < queues.size(); ++i) {
+                            if (queues[i].empty()) {
+                                continue;
+                            }
+                            const uint64_t key = domain::hlc::ordering_key(*queues[i].front());
+                            const uint32_t node = queues[i].front()->node();
+                            if ((index == queues.size())
+                                    || (key < best_key)
+                                    || ((key == best_key) && (node < best_node))) {
+                                index = i;
+                                best_key = key;
+                                best_node = node;
+                            }
+                        }
+                        if (index == queues.size()) {
+                            break;
+                        }
+                        auto event = std::move(queues[index].front());
+                        queues[index].pop_front();
+                        lock.unlock();
+                        space.notify_all();
+
+                        // After a write failure the queue is still drained, so
+                        // the readers are not stuck waiting for space.
+                        if (status.is_err()) {
+                            continue;
+                        }
+                        if (external) {
+                            const uint64_t owner = owner_of(index, event->rid());
+                            const bool head = event->has_started();
+                            uint64_t key = owner;
+                            if (head) {
+                                key = digest(*event);
+                                live[std::make_pair(index, event->rid())] = key;
+                            } else if (const auto found = live.find(std::make_pair(index, event->rid())); found != live.end()) {
+                                key = found->second;
+                                if (event->has_terminated()) {
+                                    live.erase(found);
+                                }
+                            }
+                            // An orphan lifecycle event keys on its owner, and
+                            // passes through the stage like before.
+                            const std::string record = event->SerializeAsString();
+                            if (auto result = dedup->insert(key, owner, head, record); result.is_err()) {
+                                status = std::move(result);
+                            }
+                            continue;
+                        }
+                        if (event->has_started()) {
+                            if (!seen.insert(digest(*event)).second) {
+                                dropped.emplace(index, event->rid());
+                                continue;
+                            }
+                        } else if (dropped.find(std::make_pair(index, event->rid())) != dropped.end()) {
+                            // the lifecycle events of a dropped execution.
+                            continue;
+                        }
+                        if (auto result = writer->insert_event(*event); result.is_err()) {
+                            status = std::move(result);
+                            continue;
+                        }
+                        ++count;
+                    }
+                    for (auto &reader : readers) {
+                        reader.join();
+                    }
+                    if (external && status.is_ok()) {
+                        auto drained = dedup->drain([&writer](std::string_view record) -> rust::Result<int> {
+                            rpc::Event event;
+                            if (!event.ParseFromArray(record.data(), int(record.size()))) {
+                                return rust::Err(std::runtime_error("Merging events failed: spilled event parsing error"));
+                            }
+                            return writer->insert_event(event);
+                        });
+                        if (drained.is_err()) {
+                            return rust::Err(drained.unwrap_err());
+                        }
+                        count = drained.unwrap();
+                    }
+                    if (status.is_err()) {
+                        return status;
+                    }
+                    for (const auto &failure : failures) {
+                        spdlog::warn("Reading events failed: {}", failure);
+                    }
+                    if (!failures.empty()) {
+                        return rust::Err(std::runtime_error(failures.front()));
+                    }
+                    spdlog::debug("events merged. [size: {}]", count);
+                    return writer->flush().template map<int>([](auto) { return EXIT_SUCCESS; });
+                });
+    }
+
+    Merge::Merge(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("merge", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Merge::command(const flags::Arguments &args, const char **) const {
+        const auto inputs = args.as_string_list(cmd::merge::FLAG_INPUT)
+                .and_then<std::vector<fs::path>>([](auto names) {
+                    using Result = rust::Result<std::vector<fs::path>>;
+                    return (names.empty())
+                            ? Result(rust::Err(std::runtime_error("No input files.")))
+                            : Result(rust::Ok(std::vector<fs::path>(names.begin(), names.end())));
+                });
+        const auto output = args.as_string(cmd::merge::FLAG_OUTPUT)
+                .map<fs::path>([](auto value) { return fs::path(value); });
+        const auto format = args.as_bool(cmd::intercept::FLAG_OUTPUT_JSON).unwrap_or(false)
+                ? db::EventsDatabaseFormat::JSON
+                : db::EventsDatabaseFormat::BINARY;
+        const auto compress = args.as_bool(cmd::intercept::FLAG_OUTPUT_ZSTD).unwrap_or(false);
+        // the budget is given in megabytes; zero (the default) is no limit.
+        const size_t max_memory = args.as_string(cmd::merge::FLAG_MAX_MEMORY)
+                .map<size_t>([](auto value) { return size_t(strtoul(value.data(), nullptr, 10)); })
+                .unwrap_or(0)
+                * 1024u * 1024u;
+
+        return rust::merge(inputs, output)
+                .map<ps::CommandPtr>([&format, &compress, &max_memory](auto tuple) {
+                    const auto&[inputs, output] = tuple;
+                    return std::make_unique<MergeCommand>(inputs, output, format, compress, max_memory);
+                });
+    }
+}
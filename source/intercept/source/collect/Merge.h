@@ -0,0 +1,61 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libmain/SubcommandFromArgs.h"
+#include "collect/db/EventsDatabaseFormat.h"
+
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace ic {
+
+    // Merges multiple events databases into a single one. The input files
+    // are read on parallel threads, and executions already written to the
+    // output are dropped, so overlapping capture shards do not inflate it.
+    struct MergeCommand : ps::Command {
+
+        MergeCommand(std::vector<fs::path> inputs, fs::path output, collect::db::EventsDatabaseFormat format, bool compress, size_t max_memory)
+                : ps::Command()
+                , inputs_(std::move(inputs))
+                , output_(std::move(output))
+                , format_(format)
+                , compress_(compress)
+                , max_memory_(max_memory)
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(MergeCommand)
+        NON_COPYABLE_NOR_MOVABLE(MergeCommand)
+
+    private:
+        std::vector<fs::path> inputs_;
+        fs::path output_;
+        collect::db::EventsDatabaseFormat format_;
+        bool compress_;
+        // Memory budget of the duplicate detection in bytes; zero keeps
+        // the key set in memory, a budget spills it to disk.
+        size_t max_memory_;
+    };
+}
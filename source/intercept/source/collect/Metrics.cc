@@ -0,0 +1,202 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/Metrics.h"
+
+#include "libsys/Errors.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+    // The port of a bound socket, for either address family.
+    int bound_port(const int socket) noexcept
+    {
+        sockaddr_storage address {};
+        socklen_t length = sizeof(address);
+        if (::getsockname(socket, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+            return 0;
+        }
+        return (address.ss_family == AF_INET6)
+                ? ntohs(reinterpret_cast<const sockaddr_in6 *>(&address)->sin6_port)
+                : ntohs(reinterpret_cast<const sockaddr_in *>(&address)->sin_port);
+    }
+
+    // Write the whole buffer; a slow or vanished scraper is not an error.
+    void send_all(const int connection, const char *data, size_t size) noexcept
+    {
+        while (size > 0) {
+            const ssize_t sent = ::send(connection, data, size, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                return;
+            }
+            data += sent;
+            size -= size_t(sent);
+        }
+    }
+}
+
+namespace ic {
+
+    MetricsEndpoint::MetricsEndpoint(const Reporter &reporter)
+            : reporter_(reporter)
+            , socket_(-1)
+            , server_()
+    { }
+
+    MetricsEndpoint::~MetricsEndpoint() noexcept
+    {
+        shutdown();
+    }
+
+    rust::Result<int> MetricsEndpoint::start(const std::string &address)
+    {
+        const auto colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("The metrics address \"{}\" is not a host:port pair.", address)));
+        }
+        const std::string host = address.substr(0, colon);
+        const std::string port = address.substr(colon + 1);
+
+        addrinfo hints {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo *candidates = nullptr;
+        if (const int status = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &candidates); status != 0) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Resolving the metrics address \"{}\" failed: {}", address, ::gai_strerror(status))));
+        }
+        int fd = -1;
+        for (const addrinfo *it = candidates; it != nullptr; it = it->ai_next) {
+            fd = ::socket(it->ai_family, it->ai_socktype | SOCK_CLOEXEC, it->ai_protocol);
+            if (fd == -1) {
+                continue;
+            }
+            const int enable = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            if ((::bind(fd, it->ai_addr, it->ai_addrlen) == 0) && (::listen(fd, 8) == 0)) {
+                break;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+        ::freeaddrinfo(candidates);
+        if (fd == -1) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Binding the metrics address \"{}\" failed: {}", address, sys::error_string(errno))));
+        }
+        socket_ = fd;
+        server_ = std::thread([this]() { serve(); });
+        return rust::Ok(bound_port(fd));
+    }
+
+    void MetricsEndpoint::shutdown() noexcept
+    {
+        if (socket_ != -1) {
+            // unblocks the accept in the server thread.
+            ::shutdown(socket_, SHUT_RDWR);
+        }
+        if (server_.joinable()) {
+            server_.join();
+        }
+        if (socket_ != -1) {
+            ::close(socket_);
+            socket_ = -1;
+        }
+    }
+
+    void MetricsEndpoint::serve() const
+    {
+        for (;;) {
+            const int connection = ::accept(socket_, nullptr, nullptr);
+            if (connection == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // the shutdown closed the listening socket.
+                break;
+            }
+            // the request is read and ignored: every path serves the
+            // counters, there is nothing else here.
+            char request[1024];
+            while (::recv(connection, request, sizeof(request), MSG_DONTWAIT) == sizeof(request))
+                ;
+            const std::string body = render();
+            const std::string response = fmt::format(
+                    "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                    "Content-Length: {}\r\n"
+                    "Connection: close\r\n"
+                    "\r\n"
+                    "{}",
+                    body.size(), body);
+            send_all(connection, response.data(), response.size());
+            ::close(connection);
+        }
+    }
+
+    std::string MetricsEndpoint::render() const
+    {
+        const auto counters = reporter_.counters();
+        return fmt::format(
+                "# HELP bear_events_received_total Events received by the collector.\n"
+                "# TYPE bear_events_received_total counter\n"
+                "bear_events_received_total {}\n"
+                "# HELP bear_events_discarded_total Events dropped by the discard filter.\n"
+                "# TYPE bear_events_discarded_total counter\n"
+                "bear_events_discarded_total {}\n"
+                "# HELP bear_events_persisted_total Events written into a database.\n"
+                "# TYPE bear_events_persisted_total counter\n"
+                "bear_events_persisted_total {}\n"
+                "# HELP bear_events_failed_total Events lost on a write failure.\n"
+                "# TYPE bear_events_failed_total counter\n"
+                "bear_events_failed_total {}\n"
+                "# HELP bear_rpc_errors_total Events refused or lost on the RPC layer.\n"
+                "# TYPE bear_rpc_errors_total counter\n"
+                "bear_rpc_errors_total {}\n"
+                "# HELP bear_event_queue_depth Events waiting for the writer threads.\n"
+                "# TYPE bear_event_queue_depth gauge\n"
+                "bear_event_queue_depth {}\n"
+                "# HELP bear_writer_threads Writer threads draining the event queue.\n"
+                "# TYPE bear_writer_threads gauge\n"
+                "bear_writer_threads {}\n"
+                "# HELP bear_attached_sessions Attached builds with their own events database.\n"
+                "# TYPE bear_attached_sessions gauge\n"
+                "bear_attached_sessions {}\n",
+                counters.received,
+                counters.discarded,
+                counters.persisted,
+                counters.failed,
+                counters.rpc_errors,
+                counters.queue_depth,
+                counters.writer_threads,
+                counters.sessions);
+    }
+}
@@ -0,0 +1,61 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "collect/Reporter.h"
+#include "libresult/Result.h"
+
+#include <string>
+#include <thread>
+
+namespace ic {
+
+    // Publishes the collector counters for a monitoring scrape.
+    //
+    // A daemon session runs for days, and its health (event rates, queue
+    // depth, losses) is not visible from outside otherwise. This is a
+    // minimal HTTP responder on a dedicated thread: every connection
+    // receives the counters in the Prometheus text exposition format and
+    // is closed. The counters are plain atomic loads from the reporter,
+    // so a scrape never touches a lock on the ingestion path.
+    class MetricsEndpoint {
+    public:
+        explicit MetricsEndpoint(const Reporter &reporter);
+        ~MetricsEndpoint() noexcept;
+
+        // Binds the "host:port" address and starts serving. Returns the
+        // bound port (useful when the requested port was zero).
+        [[nodiscard]] rust::Result<int> start(const std::string &address);
+        void shutdown() noexcept;
+
+        NON_DEFAULT_CONSTRUCTABLE(MetricsEndpoint)
+        NON_COPYABLE_NOR_MOVABLE(MetricsEndpoint)
+
+    private:
+        void serve() const;
+        [[nodiscard]] std::string render() const;
+
+    private:
+        const Reporter &reporter_;
+        int socket_;
+        std::thread server_;
+    };
+}
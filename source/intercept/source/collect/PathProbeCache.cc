@@ -0,0 +1,156 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "collect/PathProbeCache.h"
+
+#include "libsys/Errors.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace ic {
+
+    std::optional<ProbeIdentity> probe_identity(const std::string &path)
+    {
+        struct stat sb {};
+        if (::stat(path.c_str(), &sb) != 0) {
+            return std::nullopt;
+        }
+        return std::make_optional(ProbeIdentity{
+                uint64_t(sb.st_dev), uint64_t(sb.st_ino),
+                int64_t(sb.st_mtime), int64_t(sb.st_size)});
+    }
+
+    fs::path probe_cache_file()
+    {
+        if (const char *cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr) {
+            return fs::path(cache) / "bear" / "path-probes";
+        }
+        if (const char *home = std::getenv("HOME"); home != nullptr) {
+            return fs::path(home) / ".cache" / "bear" / "path-probes";
+        }
+        return fs::path();
+    }
+
+    ProbeEntries read_probe_cache(const fs::path &file)
+    {
+        ProbeEntries entries;
+        if (file.empty()) {
+            return entries;
+        }
+        std::ifstream source(file);
+        std::string line;
+        while (std::getline(source, line)) {
+            std::string input, resolved;
+            int mode = 0;
+            ProbeIdentity identity {};
+            std::istringstream fields(line);
+            if (std::getline(fields, input, '\t') && (fields >> mode) && fields.ignore()
+                    && std::getline(fields, resolved, '\t')
+                    && (fields >> identity.device >> identity.inode >> identity.mtime >> identity.size)) {
+                entries[ProbeKey(input, mode)] = std::make_pair(resolved, identity);
+            }
+        }
+        return entries;
+    }
+
+    void write_probe_cache(const fs::path &file, const ProbeEntries &entries)
+    {
+        if (file.empty()) {
+            return;
+        }
+        std::error_code error_code;
+        fs::create_directories(file.parent_path(), error_code);
+        // merge over the current content: a concurrent session may have
+        // written probes of its own since this process read the file.
+        ProbeEntries merged = read_probe_cache(file);
+        for (const auto &[key, value] : entries) {
+            merged[key] = value;
+        }
+        // the rename makes the update atomic; a concurrent writer can
+        // still win the race with its own rename, but every reader sees
+        // one complete file, never an interleaving of two writers.
+        const fs::path temporary(fmt::format("{}.{}", file.string(), getpid()));
+        {
+            std::ofstream target(temporary);
+            for (const auto &[key, value] : merged) {
+                target << key.first << '\t' << key.second << '\t'
+                       << value.first << '\t'
+                       << value.second.device << ' ' << value.second.inode << ' '
+                       << value.second.mtime << ' ' << value.second.size << '\n';
+            }
+            if (!target) {
+                fs::remove(temporary, error_code);
+                return;
+            }
+        }
+        fs::rename(temporary, file, error_code);
+        if (error_code) {
+            fs::remove(temporary, error_code);
+        }
+    }
+
+    rust::Result<std::string> canonical_path(const std::string_view &path, const int mode)
+    {
+        const auto file = probe_cache_file();
+        auto entries = read_probe_cache(file);
+
+        // Reuse the resolved path from a previous run when the probed
+        // path still leads to the very same file (a retargeted symlink
+        // along the way changes the identity the stat finds), and the
+        // file itself is unchanged and accessible.
+        const ProbeKey key(std::string(path), mode);
+        if (const auto entry = entries.find(key); entry != entries.end()) {
+            const auto &[resolved, identity] = entry->second;
+            const auto current = probe_identity(resolved);
+            const auto source = probe_identity(key.first);
+            if (current.has_value() && (current.value() == identity)
+                    && source.has_value() && (source.value() == identity)
+                    && (::access(resolved.c_str(), mode) == 0)) {
+                spdlog::debug("path probe reused from cache: {}", resolved);
+                return rust::Ok(std::string(resolved));
+            }
+        }
+
+        std::error_code error_code;
+        const auto result = fs::canonical(fs::path(path), error_code);
+        if (error_code) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Could not resolve \"{}\": {}", std::string(path), error_code.message())));
+        }
+        if (::access(result.c_str(), mode) != 0) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Could not access \"{}\": {}", result.string(), sys::error_string(errno))));
+        }
+        if (const auto identity = probe_identity(result.string()); identity.has_value()) {
+            entries[key] = std::make_pair(result.string(), identity.value());
+            write_probe_cache(file, entries);
+        }
+        return rust::Ok(result.string());
+    }
+}
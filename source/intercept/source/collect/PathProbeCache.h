@@ -0,0 +1,79 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "libresult/Result.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace ic {
+
+    // The canonical form of the library and the reporter paths only
+    // changes when the installation does, but resolving them walks
+    // every path component, which is a metadata round trip each on a
+    // network mounted toolchain. The resolved paths are therefore kept
+    // in a cache file: a stat of the probed and the resolved file
+    // revalidates an entry, and a mismatch falls back to the full
+    // resolve.
+
+    // The identity of a resolved file, to detect a changed installation.
+    struct ProbeIdentity {
+        uint64_t device;
+        uint64_t inode;
+        int64_t mtime;
+        int64_t size;
+
+        bool operator==(const ProbeIdentity &rhs) const {
+            return (device == rhs.device) && (inode == rhs.inode)
+                    && (mtime == rhs.mtime) && (size == rhs.size);
+        }
+    };
+
+    // The probed path and the access mode it was checked against.
+    using ProbeKey = std::pair<std::string, int>;
+    // What a probe resolved to, and the identity of that file.
+    using ProbeEntries = std::map<ProbeKey, std::pair<std::string, ProbeIdentity>>;
+
+    [[nodiscard]] std::optional<ProbeIdentity> probe_identity(const std::string &path);
+
+    // The cache file under the XDG cache directory. Empty when the
+    // environment names no usable cache location.
+    [[nodiscard]] fs::path probe_cache_file();
+
+    [[nodiscard]] ProbeEntries read_probe_cache(const fs::path &file);
+
+    // Persists the entries, merged over what the file holds already (so
+    // concurrent sessions keep each other's probes), through a rename
+    // of a per-process temporary: a reader never sees a torn file. Best
+    // effort: a failed write only costs the next run the resolve again.
+    void write_probe_cache(const fs::path &file, const ProbeEntries &entries);
+
+    // Checks and canonicalizes a path of the interception machinery,
+    // through the probe cache.
+    [[nodiscard]] rust::Result<std::string> canonical_path(const std::string_view &path, int mode);
+}
@@ -0,0 +1,174 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "collect/Replay.h"
+#include "intercept/intercept-forward.h"
+
+#include <google/protobuf/util/time_util.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using google::protobuf::util::TimeUtil;
+
+namespace {
+
+    // The generated events mimic a compiler call: a handful of flag
+    // like arguments padded to the requested volume, and an environment
+    // of ordinary sized variables. The content is constant, which keeps
+    // the runs comparable; the environment interning of the writer sees
+    // it as one distinct environment, like a real build would.
+    rpc::Execution synthetic_execution(size_t argument_bytes, size_t environment_bytes) {
+        rpc::Execution execution;
+        execution.set_executable("/usr/bin/cc");
+        execution.set_working_dir("/home/user/project");
+        execution.add_arguments("cc");
+        execution.add_arguments("-c");
+        execution.add_arguments("-o");
+        size_t remaining = argument_bytes;
+        while (remaining > 0) {
+            const size_t size = std::min(remaining, size_t(32));
+            execution.add_arguments(std::string(size, 'a'));
+            remaining -= size;
+        }
+        remaining = environment_bytes;
+        for (size_t count = 0; remaining > 0; ++count) {
+            const size_t size = std::min(remaining, size_t(64));
+            (*execution.mutable_environment())[fmt::format("REPLAY_{}", count)] = std::string(size, 'e');
+            remaining -= size;
+        }
+        return execution;
+    }
+
+    uint64_t percentile(const std::vector<uint64_t> &sorted, size_t nth) {
+        return sorted.empty() ? 0 : sorted[(sorted.size() - 1) * nth / 100];
+    }
+}
+
+namespace ic {
+
+    rust::Result<int> ReplayCommand::execute() const {
+        const auto execution = synthetic_execution(argument_bytes_, environment_bytes_);
+        // Per thread pacing: each producer owns a slice of the target
+        // rate, and schedules against the start time, so a slow report
+        // call is caught up instead of shifting the whole run.
+        const auto period = (rate_ == 0)
+                ? std::chrono::nanoseconds(0)
+                : std::chrono::nanoseconds(uint64_t(1000000000) * threads_ / rate_);
+        std::vector<std::vector<uint64_t>> latencies(threads_);
+        std::vector<std::thread> producers;
+        producers.reserve(threads_);
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t thread = 0; thread < threads_; ++thread) {
+            const uint64_t share = executions_ / threads_
+                    + ((thread < executions_ % threads_) ? 1 : 0);
+            producers.emplace_back([this, &execution, &period, &start, &latencies, thread, share]() {
+                auto &samples = latencies[thread];
+                samples.reserve(2 * share);
+                const auto report = [this, &samples](const rpc::Event &event) {
+                    const auto before = std::chrono::steady_clock::now();
+                    reporter_->report(event);
+                    const auto after = std::chrono::steady_clock::now();
+                    samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+                };
+                for (uint64_t index = 0; index < share; ++index) {
+                    if (period.count() != 0) {
+                        std::this_thread::sleep_until(start + period * index);
+                    }
+                    // The rids shall be unique over the whole run, like
+                    // the supervisor processes would hand them out.
+                    const uint64_t rid = (uint64_t(thread) << 32u) | index;
+                    rpc::Event started;
+                    started.set_rid(rid);
+                    *started.mutable_timestamp() = TimeUtil::GetCurrentTime();
+                    started.mutable_started()->set_pid(uint32_t(rid));
+                    started.mutable_started()->set_ppid(1);
+                    *started.mutable_started()->mutable_execution() = execution;
+                    report(started);
+                    rpc::Event terminated;
+                    terminated.set_rid(rid);
+                    *terminated.mutable_timestamp() = TimeUtil::GetCurrentTime();
+                    terminated.mutable_terminated()->set_status(0);
+                    report(terminated);
+                }
+            });
+        }
+        for (auto &producer : producers) {
+            producer.join();
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+        std::vector<uint64_t> sorted;
+        sorted.reserve(2 * executions_);
+        for (const auto &samples : latencies) {
+            sorted.insert(sorted.end(), samples.begin(), samples.end());
+        }
+        std::sort(sorted.begin(), sorted.end());
+        const auto seconds = double(elapsed.count()) / 1e9;
+        // The throughput is producer side: the rate the report calls
+        // sustained. The writer thread may still be draining; its
+        // completeness is covered by the run summary of the reporter.
+        fmt::print("executions:      {} ({} events, {} threads)\n", executions_, sorted.size(), threads_);
+        fmt::print("elapsed:         {:.3f} s\n", seconds);
+        fmt::print("throughput:      {:.0f} events/second sustained\n",
+                   (seconds > 0) ? double(sorted.size()) / seconds : 0.0);
+        fmt::print("report latency:  p50 {:.1f} us, p90 {:.1f} us, p99 {:.1f} us, max {:.1f} us\n",
+                   double(percentile(sorted, 50)) / 1e3,
+                   double(percentile(sorted, 90)) / 1e3,
+                   double(percentile(sorted, 99)) / 1e3,
+                   sorted.empty() ? 0.0 : double(sorted.back()) / 1e3);
+        return rust::Ok(EXIT_SUCCESS);
+    }
+
+    Replay::Replay(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("replay", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Replay::command(const flags::Arguments &args, const char **) const {
+        const auto number_of = [&args](const char *flag, uint64_t fallback) {
+            return args.as_string(flag)
+                    .map<uint64_t>([](auto value) { return uint64_t(strtoull(value.data(), nullptr, 10)); })
+                    .unwrap_or(fallback);
+        };
+        const uint64_t executions = number_of(cmd::replay::FLAG_EXECUTIONS, 0);
+        if (executions == 0) {
+            return rust::Err(std::runtime_error("The replay needs a positive execution count."));
+        }
+        const uint64_t rate = number_of(cmd::replay::FLAG_RATE, 0);
+        size_t threads = size_t(number_of(cmd::replay::FLAG_THREADS, 0));
+        if (threads == 0) {
+            const auto cores = std::thread::hardware_concurrency();
+            threads = (cores > 0) ? cores : 2;
+        }
+        const size_t argument_bytes = size_t(number_of(cmd::replay::FLAG_ARGUMENT_BYTES, 0));
+        const size_t environment_bytes = size_t(number_of(cmd::replay::FLAG_ENVIRONMENT_BYTES, 0));
+        // The replay parser shares the output flags of the intercept
+        // command, so the reporter factory reads them as usual.
+        return Reporter::from(args)
+                .map<ps::CommandPtr>([&executions, &rate, &threads, &argument_bytes, &environment_bytes](auto reporter) {
+                    return std::make_unique<ReplayCommand>(reporter, executions, rate, threads, argument_bytes, environment_bytes);
+                });
+    }
+}
@@ -0,0 +1,66 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "collect/Reporter.h"
+#include "libmain/SubcommandFromArgs.h"
+
+#include <cstdint>
+
+namespace ic {
+
+    // Drives the collector's event pipeline with a synthetic load, to
+    // size the queue depth and the thread counts with repeatable
+    // numbers instead of a live build. The producer threads feed
+    // generated process executions (configurable rate, argument and
+    // environment sizes) into the reporter, and the run prints the
+    // sustained events per second and the latency percentiles of the
+    // report call - the cost the supervised processes would see. The
+    // events land in the regular output file, so the downstream
+    // consumers can be measured against the same load.
+    struct ReplayCommand : ps::Command {
+
+        ReplayCommand(Reporter::Ptr reporter, uint64_t executions, uint64_t rate, size_t threads, size_t argument_bytes, size_t environment_bytes)
+                : ps::Command()
+                , reporter_(std::move(reporter))
+                , executions_(executions)
+                , rate_(rate)
+                , threads_(threads)
+                , argument_bytes_(argument_bytes)
+                , environment_bytes_(environment_bytes)
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(ReplayCommand)
+        NON_COPYABLE_NOR_MOVABLE(ReplayCommand)
+
+    private:
+        Reporter::Ptr reporter_;
+        uint64_t executions_;
+        // Target executions per second over all threads; zero means
+        // unthrottled.
+        uint64_t rate_;
+        size_t threads_;
+        size_t argument_bytes_;
+        size_t environment_bytes_;
+    };
+}
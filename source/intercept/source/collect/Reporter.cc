@@ -18,36 +18,686 @@
  */
 
 #include "config.h"
+#include "collect/Affinity.h"
 #include "collect/Reporter.h"
+#include "HybridClock.h"
+#include "Probes.h"
 
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <thread>
+#include <unordered_set>
 #include <utility>
 
+namespace {
+
+    using ic::collect::db::EventsDatabaseFormat;
+
+    // The capacity of the event queue between the gRPC handler threads
+    // and the writer thread. Sized for a burst of a few thousand process
+    // executions; an overflow falls back to the synchronous write path.
+    constexpr size_t EVENT_QUEUE_CAPACITY = 4 * 1024;
+
+    // When the queue depth crosses this, the writer thread fell behind a
+    // burst, and a helper writer is spawned. Half the capacity leaves the
+    // helper time to start before the overflow fallback kicks in.
+    constexpr size_t QUEUE_SPAWN_WATERMARK = EVENT_QUEUE_CAPACITY / 2;
+
+    // A helper retires after this many consecutive empty polls (at 100
+    // microseconds each): long enough to survive the gaps inside one
+    // configure storm, short enough to be gone during the compile phase.
+    constexpr int HELPER_IDLE_ROUNDS = 500;
+
+    fs::path shard_path(const fs::path &output, size_t index) {
+        return fs::path(fmt::format("{}.shard.{}", output.string(), index));
+    }
+
+    size_t shard_count() {
+        const auto cores = std::thread::hardware_concurrency();
+        return (cores > 0) ? cores : 1;
+    }
+
+    // Every thread sticks to one shard. The shards are handed out round
+    // robin, so the server threads spread evenly over them.
+    size_t shard_index(size_t count) {
+        static std::atomic<size_t> next_index(0);
+        thread_local const size_t index = next_index.fetch_add(1);
+        return index % count;
+    }
+
+    // Streaming outputs (the standard output or a FIFO) are consumed by
+    // another process while the build runs. They can neither be sharded
+    // nor merged, and the events shall leave the process promptly.
+    bool is_streaming(const fs::path &output) {
+        if (output == "-") {
+            return true;
+        }
+        struct stat file_status {};
+        return (stat(output.c_str(), &file_status) == 0) && S_ISFIFO(file_status.st_mode);
+    }
+
+    // The shard files carry self contained records (or zstd frames), so
+    // the merge is a byte level concatenation. Only the headers need
+    // care: the per shard file headers are dropped and a single one is
+    // written.
+    bool merge_shards(const fs::path &output, EventsDatabaseFormat format, size_t count, bool compress) {
+        std::ofstream target(output, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!target.is_open()) {
+            return false;
+        }
+        size_t header_size = 0;
+        if (compress || (format == EventsDatabaseFormat::BINARY)) {
+            // The merged header shall match the per shard ones: the same
+            // writer process wrote those, with the same session root.
+            const std::string root = (format == EventsDatabaseFormat::BINARY)
+                    ? ic::collect::db::EventsDatabaseWriter::session_root()
+                    : std::string();
+            target.write(ic::collect::db::EVENTS_DB_MAGIC, ic::collect::db::EVENTS_DB_MAGIC_SIZE);
+            // The string table ids are content hashes, so the shards
+            // (each interning on its own) concatenate safely: a repeated
+            // definition is harmless for the readers.
+            const uint32_t version = compress
+                    ? (root.empty() ? ic::collect::db::EVENTS_DB_VERSION_ZSTD : ic::collect::db::EVENTS_DB_VERSION_ZSTD_ROOTED)
+                    : (root.empty() ? ic::collect::db::EVENTS_DB_VERSION_STRINGS : ic::collect::db::EVENTS_DB_VERSION_STRINGS_ROOTED);
+            char bytes[] = {
+                    char(version & 0xffu),
+                    char((version >> 8u) & 0xffu),
+                    char((version >> 16u) & 0xffu),
+                    char((version >> 24u) & 0xffu),
+            };
+            target.write(bytes, sizeof(bytes));
+            header_size = ic::collect::db::EVENTS_DB_MAGIC_SIZE + sizeof(bytes);
+            if (compress) {
+                const char payload = (format == EventsDatabaseFormat::BINARY)
+                        ? ic::collect::db::EVENTS_DB_PAYLOAD_BINARY
+                        : ic::collect::db::EVENTS_DB_PAYLOAD_JSON;
+                target.write(&payload, 1);
+                header_size += 1;
+            }
+            if (!root.empty()) {
+                const auto root_length = uint32_t(root.size());
+                char length_bytes[] = {
+                        char(root_length & 0xffu),
+                        char((root_length >> 8u) & 0xffu),
+                        char((root_length >> 16u) & 0xffu),
+                        char((root_length >> 24u) & 0xffu),
+                };
+                target.write(length_bytes, sizeof(length_bytes));
+                target.write(root.data(), root.size());
+                header_size += sizeof(length_bytes) + root.size();
+            }
+        }
+        for (size_t index = 0; index < count; ++index) {
+            const auto shard = shard_path(output, index);
+            std::ifstream source(shard, std::ios::in | std::ios::binary);
+            if (source.is_open()) {
+                source.seekg(header_size, std::ios::beg);
+                // An empty shard would set the fail bit on the insertion.
+                if (source.peek() != std::ifstream::traits_type::eof()) {
+                    target << source.rdbuf();
+                }
+                source.close();
+            }
+            std::error_code error_code;
+            fs::remove(shard, error_code);
+        }
+        return target.good();
+    }
+
+    void append_uint32(std::string &content, uint32_t value) {
+        content.push_back(char(value & 0xffu));
+        content.push_back(char((value >> 8u) & 0xffu));
+        content.push_back(char((value >> 16u) & 0xffu));
+        content.push_back(char((value >> 24u) & 0xffu));
+    }
+
+    void append_uint64(std::string &content, uint64_t value) {
+        append_uint32(content, uint32_t(value));
+        append_uint32(content, uint32_t(value >> 32u));
+    }
+
+    // Write the run summary sidecar file.
+    bool write_summary_file(const fs::path &output, uint64_t received, uint64_t discarded, uint64_t persisted, uint64_t failed, uint64_t rpc_errors) {
+        const fs::path summary_path(output.string() + ic::collect::db::EVENTS_DB_SUMMARY_SUFFIX);
+        std::ofstream target(summary_path, std::ios::out | std::ios::trunc);
+        target << fmt::format(
+                R"({{"events_received": {}, "events_discarded": {}, "events_persisted": {}, "events_failed": {}, "rpc_errors": {}}})",
+                received, discarded, persisted, failed, rpc_errors)
+               << std::endl;
+        return target.good();
+    }
+
+    // The discard flag holds executable basenames, colon separated.
+    std::unordered_set<std::string> discard_set(const std::string &flag) {
+        std::unordered_set<std::string> result;
+        for (size_t begin = 0; begin < flag.size();) {
+            const size_t end = std::min(flag.find(':', begin), flag.size());
+            if (end > begin) {
+                result.emplace(flag.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+        return result;
+    }
+
+    // The sample flag holds the N of the one in N reporting; one means
+    // every execution is reported.
+    rust::Result<uint32_t> sample_rate(const std::string &flag) {
+        char *end = nullptr;
+        errno = 0;
+        const unsigned long value = std::strtoul(flag.c_str(), &end, 10);
+        if ((errno != 0) || (end == flag.c_str()) || (*end != '\0')
+                || (value == 0) || (value > std::numeric_limits<uint32_t>::max())) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Sampling rate {} is not a positive number", flag)));
+        }
+        return rust::Ok(uint32_t(value));
+    }
+
+    // Deterministic choice whether a pid falls outside the reported
+    // sample. The pid is hashed (FNV-1a) first: a plain modulo would be
+    // biased by the stride of the kernel's pid allocation.
+    bool sampled_out(uint32_t pid, uint32_t rate) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t index = 0; index < sizeof(pid); ++index) {
+            hash ^= (pid >> (8u * index)) & 0xffu;
+            hash *= 1099511628211ull;
+        }
+        return (hash % rate) != 0;
+    }
+
+    // Record the sampling rate at the head of a database, so its
+    // consumers know the totals shall be scaled up by this factor.
+    void write_sampling_marker(ic::collect::db::EventsDatabaseWriter &database, uint32_t rate) {
+        rpc::Event event;
+        event.mutable_sampling()->set_rate(rate);
+        database.insert_event(event)
+                .on_error([](auto error) {
+                    spdlog::warn("Writing the sampling rate failed: {} Ignored.", error.what());
+                });
+    }
+
+    // The durability policy named by the command line flag.
+    rust::Result<ic::collect::db::EventsDatabaseDurability> durability_of(const std::string &flag) {
+        if (flag == cmd::intercept::SYNC_NONE) {
+            return rust::Ok(ic::collect::db::EventsDatabaseDurability::NONE);
+        }
+        if (flag == cmd::intercept::SYNC_GROUP) {
+            return rust::Ok(ic::collect::db::EventsDatabaseDurability::GROUP);
+        }
+        if (flag == cmd::intercept::SYNC_STRICT) {
+            return rust::Ok(ic::collect::db::EventsDatabaseDurability::STRICT);
+        }
+        return rust::Err(std::runtime_error(
+                fmt::format("Unrecognized events db sync policy: {}", flag)));
+    }
+
+    // Write the index sidecar file. The entry offsets are shard relative;
+    // turn them into absolute file offsets of the merged output, with the
+    // same arithmetic the byte level merge applies to the records.
+    bool write_index_file(
+            const fs::path &output,
+            const std::vector<std::vector<ic::collect::db::EventsDatabaseIndexEntry>> &indices,
+            const std::vector<uint64_t> &bases) {
+        // The root of the rooted header is variable sized; the offsets
+        // shall match what merge_shards writes.
+        const std::string &root = ic::collect::db::EventsDatabaseWriter::session_root();
+        const uint64_t header_size =
+                ic::collect::db::EVENTS_DB_MAGIC_SIZE + ic::collect::db::EVENTS_DB_LENGTH_PREFIX_SIZE
+                + (root.empty() ? 0 : (sizeof(uint32_t) + root.size()));
+        size_t count = 0;
+        for (const auto &index : indices) {
+            count += index.size();
+        }
+        std::string content(ic::collect::db::EVENTS_DB_INDEX_MAGIC, ic::collect::db::EVENTS_DB_INDEX_MAGIC_SIZE);
+        append_uint32(content, ic::collect::db::EVENTS_DB_INDEX_VERSION);
+        append_uint32(content, uint32_t(count));
+        for (size_t shard = 0; shard < indices.size(); ++shard) {
+            for (const auto &entry : indices[shard]) {
+                append_uint64(content, entry.rid);
+                append_uint64(content, header_size + bases[shard] + entry.offset);
+                append_uint32(content, entry.length);
+                append_uint32(content, entry.pid);
+                append_uint32(content, entry.ppid);
+                append_uint32(content, uint32_t(entry.kind));
+                append_uint64(content, entry.timestamp);
+            }
+        }
+        const fs::path index_path(output.string() + ic::collect::db::EVENTS_DB_INDEX_SUFFIX);
+        std::ofstream target(index_path, std::ios::out | std::ios::trunc | std::ios::binary);
+        target.write(content.data(), content.size());
+        return target.good();
+    }
+}
+
 namespace ic {
 
     rust::Result<Reporter::Ptr> Reporter::from(const flags::Arguments& flags) {
+        const auto format = flags.as_bool(cmd::intercept::FLAG_OUTPUT_JSON).unwrap_or(false)
+                ? EventsDatabaseFormat::JSON
+                : EventsDatabaseFormat::BINARY;
+        const auto compress = flags.as_bool(cmd::intercept::FLAG_OUTPUT_ZSTD).unwrap_or(false);
+        const auto indexed = flags.as_bool(cmd::intercept::FLAG_OUTPUT_INDEX).unwrap_or(false);
+        auto durability = durability_of(std::string(flags.as_string(cmd::intercept::FLAG_OUTPUT_SYNC).unwrap_or(cmd::intercept::SYNC_NONE)));
+        if (durability.is_err()) {
+            return rust::Err(durability.unwrap_err());
+        }
+        const auto sync = durability.unwrap();
+        const auto resume = flags.as_bool(cmd::intercept::FLAG_RESUME).unwrap_or(false);
+        // The resumed shard files keep their own content and encoding;
+        // the features which would need to revisit it are refused.
+        if (resume && (format != EventsDatabaseFormat::BINARY)) {
+            return rust::Err(std::runtime_error("Events db resume requested, but it needs the binary format"));
+        }
+        if (resume && compress) {
+            return rust::Err(std::runtime_error("Events db resume requested, but a compressed file can not be resumed"));
+        }
+        if (resume && indexed) {
+            return rust::Err(std::runtime_error("Events db resume requested, but the index sidecar can not be rebuilt"));
+        }
+        auto discard = discard_set(std::string(flags.as_string(cmd::intercept::FLAG_DISCARD).unwrap_or("")));
+        auto sample_result = sample_rate(std::string(flags.as_string(cmd::intercept::FLAG_SAMPLE).unwrap_or("1")));
+        if (sample_result.is_err()) {
+            return rust::Err(sample_result.unwrap_err());
+        }
+        const auto sample = sample_result.unwrap();
+        const auto profile = flags.as_bool(cmd::bear::FLAG_PROFILE).unwrap_or(false);
         return flags
                 .as_string(cmd::intercept::FLAG_OUTPUT)
-                .and_then<ic::collect::db::EventsDatabaseWriter::Ptr>([](auto file) {
-                    return ic::collect::db::EventsDatabaseWriter::create(file);
-                })
-                .map<Reporter::Ptr>([](auto events) {
-                    return std::make_shared<Reporter>(events);
+                .and_then<Reporter::Ptr>([&format, &compress, &indexed, &sync, &resume, &discard, &sample, &profile](auto file) -> rust::Result<Reporter::Ptr> {
+                    const fs::path output(file);
+                    if (is_streaming(output)) {
+                        if (indexed) {
+                            return rust::Err(std::runtime_error("Events db index requested, but a streaming output can not be indexed"));
+                        }
+                        if (sync != ic::collect::db::EventsDatabaseDurability::NONE) {
+                            return rust::Err(std::runtime_error("Events db sync requested, but a streaming output can not be synced"));
+                        }
+                        if (resume) {
+                            return rust::Err(std::runtime_error("Events db resume requested, but a streaming output can not be resumed"));
+                        }
+                        return ic::collect::db::EventsDatabaseWriter::create(output, format, 0, compress)
+                                .template map<Reporter::Ptr>([&output, &format, &compress, &discard, &sample, &profile](auto database) {
+                                    if (sample > 1) {
+                                        write_sampling_marker(*database, sample);
+                                    }
+                                    auto shard = std::make_unique<Shard>();
+                                    shard->database = database;
+                                    std::vector<std::unique_ptr<Shard>> shards;
+                                    shards.emplace_back(std::move(shard));
+                                    return std::make_shared<Reporter>(output, format, std::move(shards), true, compress, false, ic::collect::db::EventsDatabaseDurability::NONE, std::move(discard), sample, profile);
+                                });
+                    }
+                    size_t count = shard_count();
+                    if (resume) {
+                        // An interrupted run may have used a different
+                        // shard count; every leftover shard file shall be
+                        // picked up, or its events would be lost.
+                        std::error_code error_code;
+                        while (fs::exists(shard_path(output, count), error_code)) {
+                            ++count;
+                        }
+                    }
+                    std::vector<std::unique_ptr<Shard>> shards;
+                    for (size_t index = 0; index < count; ++index) {
+                        auto shard = std::make_unique<Shard>();
+                        // A fresh shard file is only created by the first
+                        // event it receives. A resumed run appends to the
+                        // shard files an interrupted run left behind, and
+                        // those are opened now: resuming cuts off their
+                        // torn tails, which must happen before the final
+                        // merge reads the files.
+                        std::error_code error_code;
+                        if (resume && fs::exists(shard_path(output, index), error_code)) {
+                            auto database = ic::collect::db::EventsDatabaseWriter::resume(
+                                    shard_path(output, index),
+                                    ic::collect::db::EventsDatabaseWriter::DEFAULT_FLUSH_THRESHOLD,
+                                    sync);
+                            if (database.is_err()) {
+                                return rust::Err(database.unwrap_err());
+                            }
+                            shard->database = database.unwrap();
+                        }
+                        shards.emplace_back(std::move(shard));
+                    }
+                    return rust::Ok(std::make_shared<Reporter>(output, format, std::move(shards), false, compress, indexed, sync, std::move(discard), sample, profile));
                 });
     }
 
-    Reporter::Reporter(ic::collect::db::EventsDatabaseWriter::Ptr database)
-            : database_(std::move(database))
-            , mutex_()
+    Reporter::Reporter(fs::path output,
+                       ic::collect::db::EventsDatabaseFormat format,
+                       std::vector<std::unique_ptr<Shard>> shards,
+                       bool streaming,
+                       bool compress,
+                       bool index,
+                       ic::collect::db::EventsDatabaseDurability durability,
+                       std::unordered_set<std::string> discard,
+                       uint32_t sample,
+                       bool profile)
+            : output_(std::move(output))
+            , format_(format)
+            , shards_(std::move(shards))
+            , streaming_(streaming)
+            , compress_(compress)
+            , index_(index)
+            , durability_(durability)
+            , discard_(std::move(discard))
+            , sample_(sample)
+            , profile_(profile)
+            , discarded_mutex_()
+            , discarded_rids_()
+            , sessions_mutex_()
+            , sessions_()
+            , session_count_(0)
+            , queue_(EVENT_QUEUE_CAPACITY)
+            , done_(false)
+            , received_(0)
+            , discarded_count_(0)
+            , persisted_(0)
+            , failed_(0)
+            , rpc_errors_(0)
+            , helpers_mutex_()
+            , helpers_()
+            , helper_count_(0)
+            , writer_([this]() { drain_queue(); })
     { }
 
+    Reporter::~Reporter() noexcept {
+        const auto started = std::chrono::steady_clock::now();
+        // Let the writer threads drain the remaining events.
+        done_.store(true, std::memory_order_release);
+        writer_.join();
+        {
+            // No new helper is spawned after done_ is set; what is in the
+            // vector is all of them.
+            const std::lock_guard<std::mutex> guard(helpers_mutex_);
+            for (auto &helper : helpers_) {
+                helper.join();
+            }
+            helpers_.clear();
+        }
+        // The shard relative index entries are gone with the writers.
+        std::vector<std::vector<ic::collect::db::EventsDatabaseIndexEntry>> indices;
+        if (index_) {
+            for (auto &shard : shards_) {
+                // an untouched shard was never opened, it has no entries.
+                indices.emplace_back(shard->database
+                        ? shard->database->index()
+                        : std::vector<ic::collect::db::EventsDatabaseIndexEntry>());
+            }
+        }
+        // Flush and close the shard writers before the merge reads them.
+        for (auto &shard : shards_) {
+            shard->database.reset();
+        }
+        // Close the events databases of the attached sessions.
+        sessions_.clear();
+        // The merge removes the shard files, but the index needs to know
+        // how many payload bytes each shard contributes.
+        std::vector<uint64_t> bases;
+        if (index_) {
+            // The shard files carry the same (possibly rooted) header.
+            const std::string &root = ic::collect::db::EventsDatabaseWriter::session_root();
+            const uint64_t header_size =
+                    ic::collect::db::EVENTS_DB_MAGIC_SIZE + ic::collect::db::EVENTS_DB_LENGTH_PREFIX_SIZE
+                    + (root.empty() ? 0 : (sizeof(uint32_t) + root.size()));
+            uint64_t base = 0;
+            for (size_t index = 0; index < shards_.size(); ++index) {
+                bases.push_back(base);
+                std::error_code error_code;
+                const auto size = fs::file_size(shard_path(output_, index), error_code);
+                base += error_code ? 0 : (size - header_size);
+            }
+        }
+        if (!streaming_ && !merge_shards(output_, format_, shards_.size(), compress_)) {
+            spdlog::warn("Merging event shards into {} failed.", output_.string());
+        }
+        if (profile_ && !streaming_) {
+            spdlog::info("profile: event persistence (final drain and shard merge) took {} ms.",
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - started).count());
+        }
+        if (index_ && !write_index_file(output_, indices, bases)) {
+            spdlog::warn("Writing the event index of {} failed.", output_.string());
+        }
+        // Emit the run summary. Losses are called out loudly; the sidecar
+        // carries the counters for the machines.
+        const uint64_t received = received_.load();
+        const uint64_t discarded = discarded_count_.load();
+        const uint64_t persisted = persisted_.load();
+        const uint64_t failed = failed_.load();
+        const uint64_t rpc_errors = rpc_errors_.load();
+        if ((failed > 0) || (rpc_errors > 0)) {
+            spdlog::warn("Event loss detected: received {}, persisted {}, failed {}, RPC errors {}. The compilation database may be incomplete.",
+                         received, persisted, failed, rpc_errors);
+        } else {
+            spdlog::debug("Run summary: received {}, discarded {}, persisted {} events.", received, discarded, persisted);
+        }
+        if (!streaming_ && !write_summary_file(output_, received, discarded, persisted, failed, rpc_errors)) {
+            spdlog::warn("Writing the run summary of {} failed.", output_.string());
+        }
+    }
+
     void Reporter::report(const rpc::Event& event) {
-        const std::lock_guard<std::mutex> lock(mutex_);
+        BEAR_PROBE1(reporter_report, event.rid());
+        received_.fetch_add(1, std::memory_order_relaxed);
+        // fold the clock of the (possibly remote) sender into the local
+        // one, so events this process stamps later order after this one.
+        domain::hlc::observe(event.clock());
+        if (discarded(event)) {
+            discarded_count_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // The queue takes the event without blocking on file writes. Only
+        // when it's full (the writer thread fell behind a burst) does the
+        // handler write the event itself.
+        rpc::Event copy(event);
+        if (!queue_.push(std::move(copy))) {
+            write_into_shard(event);
+            return;
+        }
+        if (queue_.depth() >= QUEUE_SPAWN_WATERMARK) {
+            maybe_spawn_helper();
+        }
+    }
 
-        database_->insert_event(event)
-                .on_error([](auto error) {
+    // Whether the event shall be dropped instead of persisted. A start
+    // event is matched on the executable basename and on the sampling
+    // rate (a deterministic hash of the pid picks the kept one in N
+    // executions); the later lifecycle events of a discarded process
+    // would be orphans in the database, so they are dropped with it.
+    bool Reporter::discarded(const rpc::Event &event) {
+        if (discard_.empty() && (sample_ < 2)) {
+            return false;
+        }
+        if (event.has_started()) {
+            const auto basename = fs::path(event.started().execution().executable()).filename().string();
+            const bool drop = (discard_.find(basename) != discard_.end())
+                    || ((sample_ > 1) && sampled_out(event.started().pid(), sample_));
+            if (!drop) {
+                return false;
+            }
+            const std::lock_guard<std::mutex> guard(discarded_mutex_);
+            discarded_rids_.insert(event.rid());
+            return true;
+        }
+        const std::lock_guard<std::mutex> guard(discarded_mutex_);
+        return discarded_rids_.find(event.rid()) != discarded_rids_.end();
+    }
+
+    // Opens the events database of a shard on its first use. The build
+    // command launched without waiting for the file creates, and a small
+    // build leaves the shards of the idle threads untouched entirely.
+    bool Reporter::open_shard(Shard &shard, const size_t index) {
+        auto database = ic::collect::db::EventsDatabaseWriter::create(
+                shard_path(output_, index),
+                format_,
+                ic::collect::db::EventsDatabaseWriter::DEFAULT_FLUSH_THRESHOLD,
+                compress_,
+                index_,
+                durability_);
+        if (database.is_err()) {
+            spdlog::warn("Opening the shard database {} failed: {} Ignored.",
+                         shard_path(output_, index).string(), database.unwrap_err().what());
+            return false;
+        }
+        shard.database = database.unwrap();
+        if (sample_ > 1) {
+            write_sampling_marker(*shard.database, sample_);
+        }
+        return true;
+    }
+
+    void Reporter::write_into_shard(const rpc::Event &event) {
+        if (!event.session().empty()) {
+            write_into_session(event);
+            return;
+        }
+        const size_t index = shard_index(shards_.size());
+        auto &shard = *shards_[index];
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+
+        if ((shard.database == nullptr) && !open_shard(shard, index)) {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        shard.database->insert_event(event)
+                .on_success([this](auto) {
+                    persisted_.fetch_add(1, std::memory_order_relaxed);
+                })
+                .on_error([this](auto error) {
+                    failed_.fetch_add(1, std::memory_order_relaxed);
                     spdlog::warn("Writing event into database failed: {} Ignored.", error.what());
                 });
     }
+
+    // Events of an attached build go into the events database that build
+    // asked for, not into the shards of this collector's output. The
+    // session id is the absolute path of that database; the collector and
+    // the attached builds share a filesystem, sharing one collector over
+    // the builds of one host is the point. The writer is created on the
+    // first event and flushes promptly, so the attached build finds its
+    // events on disk when its build command finished.
+    void Reporter::write_into_session(const rpc::Event &event) {
+        const std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto it = sessions_.find(event.session());
+        if (it == sessions_.end()) {
+            // Only absolute paths are accepted; a relative name shall not
+            // be resolved against the working directory of the collector.
+            if (event.session().front() != '/') {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+                spdlog::warn("Session id {} is not an absolute path. Event ignored.", event.session());
+                return;
+            }
+            auto database = ic::collect::db::EventsDatabaseWriter::create(
+                    fs::path(event.session()), format_, 0, compress_, false, durability_);
+            if (database.is_err()) {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+                spdlog::warn("Opening the session database {} failed. Event ignored.", event.session());
+                return;
+            }
+            if (sample_ > 1) {
+                write_sampling_marker(*database.unwrap(), sample_);
+            }
+            it = sessions_.emplace(event.session(), database.unwrap()).first;
+            session_count_.store(sessions_.size(), std::memory_order_relaxed);
+        }
+        // The session tag is a routing detail, the persisted event shall
+        // look like the events of an unattached build.
+        rpc::Event record(event);
+        record.clear_session();
+        it->second->insert_event(record)
+                .on_success([this](auto) {
+                    persisted_.fetch_add(1, std::memory_order_relaxed);
+                })
+                .on_error([this](auto error) {
+                    failed_.fetch_add(1, std::memory_order_relaxed);
+                    spdlog::warn("Writing event into database failed: {} Ignored.", error.what());
+                });
+    }
+
+    void Reporter::account_rpc_error() {
+        rpc_errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Reporter::Counters Reporter::counters() const noexcept {
+        return Counters {
+                received_.load(std::memory_order_relaxed),
+                discarded_count_.load(std::memory_order_relaxed),
+                persisted_.load(std::memory_order_relaxed),
+                failed_.load(std::memory_order_relaxed),
+                rpc_errors_.load(std::memory_order_relaxed),
+                queue_.depth(),
+                // the permanent writer plus the active helpers.
+                helper_count_.load(std::memory_order_relaxed) + 1,
+                session_count_.load(std::memory_order_relaxed),
+        };
+    }
+
+    void Reporter::drain_queue() {
+        // when an affinity set is configured, the writer stays on one
+        // cpu, and the file buffers it allocates stay on that node.
+        affinity::pin_writer();
+        rpc::Event event;
+        for (;;) {
+            if (queue_.pop(event)) {
+                write_into_shard(event);
+            } else if (done_.load(std::memory_order_acquire)) {
+                // The producers are gone, and the last pop saw an empty
+                // queue. Nothing left to drain.
+                break;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    // Spawn a helper writer thread when the permanent writer fell behind.
+    // Capped at one writer per shard: the threads stick to distinct
+    // shards, so they never contend on a shard lock. A streaming output
+    // has a single shard, and keeps its single writer (the events shall
+    // leave the process in the order they were queued).
+    void Reporter::maybe_spawn_helper() {
+        const size_t cap = shards_.size() - 1;
+        if (helper_count_.load(std::memory_order_relaxed) >= cap) {
+            return;
+        }
+        const std::lock_guard<std::mutex> guard(helpers_mutex_);
+        if ((helper_count_.load(std::memory_order_relaxed) >= cap)
+                || done_.load(std::memory_order_acquire)) {
+            return;
+        }
+        helper_count_.fetch_add(1, std::memory_order_relaxed);
+        helpers_.emplace_back([this]() { drain_as_helper(); });
+    }
+
+    // A helper drains alongside the permanent writer while the queue is
+    // busy, and retires after it stayed empty for a while. The next storm
+    // spawns a fresh one.
+    void Reporter::drain_as_helper() {
+        rpc::Event event;
+        int idle = 0;
+        while (idle < HELPER_IDLE_ROUNDS) {
+            if (queue_.pop(event)) {
+                write_into_shard(event);
+                idle = 0;
+            } else if (done_.load(std::memory_order_acquire)) {
+                break;
+            } else {
+                ++idle;
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        helper_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
 }
@@ -19,17 +19,58 @@
 
 #pragma once
 
+#include "collect/EventQueue.h"
 #include "collect/db/EventsDatabaseWriter.h"
 #include "libflags/Flags.h"
 #include "libresult/Result.h"
 #include "intercept.pb.h"
 
+#include <atomic>
+#include <filesystem>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
 
 namespace ic {
 
     // Responsible to collect executions and persist them into an output file.
+    //
+    // The shard databases are created on the first event they receive,
+    // not when the reporter is constructed: the collector starts without
+    // touching the disk, and the build command launches without waiting
+    // for it.
+    //
+    // The gRPC handler threads push the events into a bounded lock-free
+    // queue, and a dedicated writer thread drains it into the database.
+    // The handlers therefore return (and the supervised processes resume)
+    // without waiting for the file writes. When the queue is full, the
+    // handlers fall back to writing directly into multiple shard files
+    // (each with its own lock). The shards are merged into the output file
+    // when the reporter is destroyed.
+    //
+    // The writer thread count follows the build phases. A configure step
+    // storms the queue with thousands of short processes, while a long
+    // compile phase barely touches it. When the queue depth crosses a
+    // high watermark, helper writer threads are spawned (up to one per
+    // shard) to drain alongside the permanent writer; a helper retires
+    // after the queue stayed empty for a while.
+    //
+    // An optional discard list (executable basenames) drops the events of
+    // uninteresting processes before they reach the queue or the disk.
+    // An optional sampling rate keeps only one in N executions (decided
+    // on a hash of the pid), for an always-on telemetry setup where the
+    // cost of persisting every execution would be too much; the rate is
+    // recorded in the databases, so the consumers can extrapolate.
+    //
+    // Events tagged with a session id (builds attached to a shared
+    // collector) are routed into a separate events database per session
+    // instead of the shards of the output file.
     class Reporter {
     public:
         using Ptr = std::shared_ptr<Reporter>;
@@ -37,16 +78,95 @@ namespace ic {
 
         void report(const rpc::Event &event);
 
+        // Account an event that was refused or lost on the RPC layer, so
+        // the run summary can report it. (Called by the gRPC services.)
+        void account_rpc_error();
+
+        // A snapshot of the run counters, for monitoring. The reads are
+        // plain atomic loads, so taking a snapshot never blocks the
+        // event path. (The values are racy against each other, which is
+        // fine for a scrape.)
+        struct Counters {
+            uint64_t received;
+            uint64_t discarded;
+            uint64_t persisted;
+            uint64_t failed;
+            uint64_t rpc_errors;
+            size_t queue_depth;
+            size_t writer_threads;
+            size_t sessions;
+        };
+        [[nodiscard]] Counters counters() const noexcept;
+
     public:
-        explicit Reporter(ic::collect::db::EventsDatabaseWriter::Ptr database);
+        struct Shard {
+            ic::collect::db::EventsDatabaseWriter::Ptr database;
+            std::mutex mutex;
+        };
 
-        ~Reporter() noexcept = default;
+        explicit Reporter(fs::path output,
+                          ic::collect::db::EventsDatabaseFormat format,
+                          std::vector<std::unique_ptr<Shard>> shards,
+                          bool streaming,
+                          bool compress,
+                          bool index,
+                          ic::collect::db::EventsDatabaseDurability durability,
+                          std::unordered_set<std::string> discard,
+                          uint32_t sample,
+                          bool profile);
+
+        ~Reporter() noexcept;
 
         NON_DEFAULT_CONSTRUCTABLE(Reporter)
         NON_COPYABLE_NOR_MOVABLE(Reporter)
 
     private:
-        ic::collect::db::EventsDatabaseWriter::Ptr database_;
-        std::mutex mutex_;
+        bool discarded(const rpc::Event &event);
+        bool open_shard(Shard &shard, size_t index);
+        void write_into_shard(const rpc::Event &event);
+        void write_into_session(const rpc::Event &event);
+        void drain_queue();
+        void drain_as_helper();
+        void maybe_spawn_helper();
+
+    private:
+        fs::path output_;
+        ic::collect::db::EventsDatabaseFormat format_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+        bool streaming_;
+        bool compress_;
+        bool index_;
+        ic::collect::db::EventsDatabaseDurability durability_;
+        const std::unordered_set<std::string> discard_;
+        // One in this many executions is reported; one means every
+        // execution. The choice hashes the pid, so the lifecycle events
+        // of a process follow the fate of its start event.
+        const uint32_t sample_;
+        // Print how long the final drain and the shard merge took.
+        bool profile_;
+        // The reporter ids of the discarded start events; the lifecycle
+        // events of those processes are dropped too.
+        std::mutex discarded_mutex_;
+        std::unordered_set<uint64_t> discarded_rids_;
+        // The events databases of the attached sessions, keyed by the
+        // session id (the path of the database).
+        std::mutex sessions_mutex_;
+        std::map<std::string, ic::collect::db::EventsDatabaseWriter::Ptr> sessions_;
+        // The session count again, readable without the mutex above.
+        std::atomic<size_t> session_count_;
+        collect::EventQueue queue_;
+        std::atomic<bool> done_;
+        std::atomic<uint64_t> received_;
+        std::atomic<uint64_t> discarded_count_;
+        std::atomic<uint64_t> persisted_;
+        std::atomic<uint64_t> failed_;
+        std::atomic<uint64_t> rpc_errors_;
+        // The helper writer threads spawned during exec storms. A retired
+        // helper stays in the vector (finished, still joinable) until the
+        // destructor joins them all.
+        std::mutex helpers_mutex_;
+        std::vector<std::thread> helpers_;
+        std::atomic<size_t> helper_count_;
+        std::thread writer_;
     };
 }
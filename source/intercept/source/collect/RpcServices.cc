@@ -17,38 +17,316 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
+#include "collect/Affinity.h"
 #include "collect/Reporter.h"
 #include "collect/RpcServices.h"
 #include "collect/Session.h"
+#include "Convert.h"
+#include "Probes.h"
+
+#include <fmt/format.h>
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server_builder.h>
+
+#include <cstdlib>
+
+namespace {
+
+    // Content hash of an environment. (FNV-1a over the sorted entries.)
+    uint64_t hash_environment(const std::map<std::string, std::string> &environment) {
+        constexpr uint64_t OFFSET = 0xcbf29ce484222325;
+        constexpr uint64_t PRIME = 0x100000001b3;
+
+        uint64_t hash = OFFSET;
+        const auto mix = [&hash](const std::string &value) {
+            for (const char it : value) {
+                hash = (hash ^ uint64_t(uint8_t(it))) * PRIME;
+            }
+            hash = (hash ^ uint64_t(0)) * PRIME;
+        };
+        for (const auto &[key, value] : environment) {
+            mix(key);
+            mix(value);
+        }
+        return hash;
+    }
+
+    // Validates the session token of a call. Builds running on remote
+    // workers send it as gRPC metadata; the local (loopback) collector
+    // runs with an empty token and accepts everything.
+    bool authorized(const grpc::ServerContext &context, const std::string &token) {
+        if (token.empty()) {
+            return true;
+        }
+        const auto &metadata = context.client_metadata();
+        const auto it = metadata.find(cmd::intercept::METADATA_TOKEN);
+        return (it != metadata.end())
+                && (it->second == grpc::string_ref(token.data(), token.size()));
+    }
+
+    // The session id of a call. A build attached to a shared collector
+    // sends it as gRPC metadata; the events of the call are then routed
+    // into the events database of that session. Empty for a build the
+    // collector was started for.
+    std::string session_of(const grpc::ServerContext &context) {
+        const auto &metadata = context.client_metadata();
+        const auto it = metadata.find(cmd::intercept::METADATA_SESSION);
+        return (it != metadata.end())
+                ? std::string(it->second.data(), it->second.size())
+                : std::string();
+    }
+
+    // The state machine of a single asynchronous call.
+    //
+    // A call object is created to wait for one incoming request. When the
+    // request arrives, it spawns a successor to wait for the next one,
+    // runs the handler, and asks for the response to be sent. When the
+    // send is confirmed, the object deletes itself. The completion queue
+    // events carry the object as their tag.
+    class CallData {
+    public:
+        virtual ~CallData() noexcept = default;
+        virtual void proceed(bool ok) = 0;
+    };
+
+    // The single registration call of a supervised process.
+    //
+    // The first message of the stream is the started event, which
+    // doubles as the resolve request: the answer tells the supervisor
+    // how to execute the program. The event is recorded with the
+    // resolved execution, trimmed by the capture profile. The later
+    // life cycle events are recorded without any answer.
+    class SuperviseCall final : public CallData {
+    public:
+        SuperviseCall(rpc::Interceptor::AsyncService *service, grpc::ServerCompletionQueue *queue, const ic::Session &session, ic::EnvironmentCache &environments, ic::Reporter &reporter, const std::string &token)
+                : service_(service)
+                , queue_(queue)
+                , session_(session)
+                , environments_(environments)
+                , reporter_(reporter)
+                , token_(token)
+                , call_session_()
+                , stream_(&context_)
+                , state_(REQUESTED)
+        {
+            service_->RequestSupervise(&context_, &stream_, queue_, queue_, this);
+        }
+
+        void proceed(bool ok) override {
+            switch (state_) {
+                case REQUESTED:
+                    if (!ok) {
+                        // The server is shutting down, the call never completes.
+                        delete this;
+                        return;
+                    }
+                    // A new call object takes over the waiting for requests.
+                    new SuperviseCall(service_, queue_, session_, environments_, reporter_, token_);
+                    if (!authorized(context_, token_)) {
+                        reporter_.account_rpc_error();
+                        state_ = FINISHED;
+                        stream_.Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Missing or wrong session token"), this);
+                        break;
+                    }
+                    call_session_ = session_of(context_);
+                    state_ = READING;
+                    stream_.Read(&event_, this);
+                    break;
+                case READING:
+                    if (!ok) {
+                        // The client has finished writing.
+                        state_ = FINISHED;
+                        stream_.Finish(grpc::Status::OK, this);
+                        break;
+                    }
+                    if (event_.has_started() && !session_.resolves_remotely()) {
+                        // The event arrives already resolved; record it
+                        // without an answer, like the life cycle events.
+                        rpc::Execution &recorded = *event_.mutable_started()->mutable_execution();
+                        if (!session_.keeps_environment()) {
+                            recorded.clear_environment();
+                        }
+                        record();
+                        stream_.Read(&event_, this);
+                        break;
+                    }
+                    if (event_.has_started()) {
+                        BEAR_PROBE(supervisor_resolve_begin);
+                        const grpc::Status status = resolve(domain::from(event_.started().execution()))
+                                .map<grpc::Status>([this](auto execution) {
+                                    response_.mutable_execution()->CopyFrom(domain::into(execution));
+                                    return grpc::Status::OK;
+                                })
+                                .unwrap_or_else([](const auto &error) {
+                                    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error.what());
+                                });
+                        BEAR_PROBE(supervisor_resolve_end);
+                        if (!status.ok()) {
+                            state_ = FINISHED;
+                            stream_.Finish(status, this);
+                            break;
+                        }
+                        // Record the event with the execution the process
+                        // was told to spawn, not with the request.
+                        rpc::Execution &recorded = *event_.mutable_started()->mutable_execution();
+                        recorded = response_.execution();
+                        if (!session_.keeps_environment()) {
+                            recorded.clear_environment();
+                        }
+                        record();
+                        state_ = WRITING;
+                        stream_.Write(response_, this);
+                    } else {
+                        record();
+                        stream_.Read(&event_, this);
+                    }
+                    break;
+                case WRITING:
+                    if (!ok) {
+                        // The client is gone, the write never completes.
+                        delete this;
+                        return;
+                    }
+                    state_ = READING;
+                    stream_.Read(&event_, this);
+                    break;
+                case FINISHED:
+                    delete this;
+                    break;
+            }
+        }
+
+    private:
+        // Record the event, tagged with the session of the call, so the
+        // reporter can route the events of an attached build separately.
+        void record() {
+            if (!call_session_.empty()) {
+                event_.set_session(call_session_);
+            }
+            reporter_.report(event_);
+        }
+
+        // Resolve the execution, with the environment update served from
+        // the cache when the same environment was resolved before.
+        rust::Result<ic::Execution> resolve(const ic::Execution &execution) const {
+            const uint64_t key = hash_environment(execution.environment);
+            {
+                const std::lock_guard<std::mutex> lock(environments_.mutex);
+                if (const auto it = environments_.entries.find(key); it != environments_.entries.end()) {
+                    return session_.resolve(execution, it->second);
+                }
+            }
+            return session_.resolve(execution)
+                    .on_success([this, key](const auto &resolved) {
+                        const std::lock_guard<std::mutex> lock(environments_.mutex);
+                        environments_.entries.emplace(key, resolved.environment);
+                    });
+        }
+
+    private:
+        enum State { REQUESTED, READING, WRITING, FINISHED };
+
+        rpc::Interceptor::AsyncService *service_;
+        grpc::ServerCompletionQueue *queue_;
+        const ic::Session &session_;
+        ic::EnvironmentCache &environments_;
+        ic::Reporter &reporter_;
+        const std::string &token_;
+        std::string call_session_;
+        grpc::ServerContext context_;
+        rpc::Event event_;
+        rpc::ResolveResponse response_;
+        grpc::ServerAsyncReaderWriter<rpc::ResolveResponse, rpc::Event> stream_;
+        State state_;
+    };
+}
 
 namespace ic {
 
-    SupervisorImpl::SupervisorImpl(const Session &session)
-            : rpc::Supervisor::Service()
-            , session_(session)
-    { }
-
-    grpc::Status SupervisorImpl::Resolve(grpc::ServerContext *, const rpc::ResolveRequest *request, rpc::ResolveResponse *response) {
-        return session_.resolve(from(request->execution()))
-                .map<grpc::Status>([&response](auto execution) {
-                    // Need to copy the execution into the response.
-                    response->mutable_execution()->CopyFrom(into(execution));
-                    // Confirm it with an OK.
-                    return ::grpc::Status::OK;
-                })
-                .unwrap_or_else([](const auto &error) {
-                    return grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, error.what());
-                });
-    }
-
-    InterceptorImpl::InterceptorImpl(Reporter &reporter)
-            : rpc::Interceptor::Service()
+    RpcServer::RpcServer(const Session &session, Reporter &reporter, size_t threads,
+                         std::string listen_address, std::string token)
+            : session_(session)
             , reporter_(reporter)
-    { }
-
-    grpc::Status InterceptorImpl::Register(grpc::ServerContext*, const rpc::Event* request, google::protobuf::Empty*)
+            , environments_()
+            , thread_count_(threads)
+            , listen_address_(std::move(listen_address))
+            , token_(std::move(token))
+            , interceptor_()
+            , queues_()
+            , server_()
+            , threads_()
     {
-        reporter_.report(*request);
-        return ::grpc::Status::OK;
+        if (thread_count_ == 0) {
+            const auto cores = std::thread::hardware_concurrency();
+            thread_count_ = (cores > 0) ? cores : 1;
+        }
+    }
+
+    RpcServer::~RpcServer() noexcept {
+        shutdown();
+    }
+
+    rust::Result<int> RpcServer::start() {
+        int port = 0;
+        grpc::ServerBuilder builder;
+        builder.RegisterService(&interceptor_);
+        // The loopback name keeps the collector local; a listen address
+        // is only configured when remote build workers shall reach it. A
+        // vsock URI ("vsock:cid:port", for builds inside microVMs) is
+        // passed through as it is: it names its own port, while anything
+        // else gets an ephemeral one.
+        const bool vsock = listen_address_.rfind("vsock:", 0) == 0;
+        const auto address = listen_address_.empty()
+                ? std::string("dns:///localhost:0")
+                : vsock ? listen_address_ : fmt::format("{}:0", listen_address_);
+        builder.AddListeningPort(address, grpc::InsecureServerCredentials(), &port);
+        for (size_t index = 0; index < thread_count_; ++index) {
+            queues_.emplace_back(builder.AddCompletionQueue());
+        }
+        server_ = builder.BuildAndStart();
+        if (server_ == nullptr) {
+            return rust::Err(std::runtime_error("Could not start the gRPC server"));
+        }
+        if (vsock && (port == 0)) {
+            // Not every gRPC version reports the bound port of a vsock
+            // listener; the URI names it explicitly anyway.
+            const auto colon = listen_address_.rfind(':');
+            port = int(strtol(listen_address_.c_str() + colon + 1, nullptr, 10));
+        }
+        for (size_t index = 0; index < queues_.size(); ++index) {
+            // Each queue starts with one waiting call object.
+            auto *queue = queues_[index].get();
+            new SuperviseCall(&interceptor_, queue, session_, environments_, reporter_, token_);
+            threads_.emplace_back([this, queue, index]() {
+                // when an affinity set is configured, the handlers spread
+                // over it, and their arenas are first touched locally.
+                affinity::pin_handler(index);
+                serve(queue);
+            });
+        }
+        return rust::Ok(port);
+    }
+
+    void RpcServer::shutdown() {
+        if (server_ != nullptr) {
+            server_->Shutdown();
+            for (auto &queue : queues_) {
+                queue->Shutdown();
+            }
+            for (auto &thread : threads_) {
+                thread.join();
+            }
+            threads_.clear();
+            server_.reset();
+        }
+    }
+
+    void RpcServer::serve(grpc::ServerCompletionQueue *queue) {
+        void *tag = nullptr;
+        bool ok = false;
+        while (queue->Next(&tag, &ok)) {
+            static_cast<CallData *>(tag)->proceed(ok);
+        }
     }
 }
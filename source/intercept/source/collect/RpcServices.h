@@ -19,39 +19,75 @@
 
 #pragma once
 
+#include "libresult/Result.h"
 #include "intercept.grpc.pb.h"
 #include "supervise.grpc.pb.h"
 
+#include <grpcpp/server.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 namespace ic {
 
     class Reporter;
     class Session;
 
-    class SupervisorImpl final : public rpc::Supervisor::Service {
-    public:
-        explicit SupervisorImpl(const Session&);
-        ~SupervisorImpl() override = default;
-
-        grpc::Status Resolve(grpc::ServerContext *context, const rpc::ResolveRequest *request, rpc::ResolveResponse *response) override;
-
-        NON_DEFAULT_CONSTRUCTABLE(SupervisorImpl)
-        NON_COPYABLE_NOR_MOVABLE(SupervisorImpl)
-
-    private:
-        const Session &session_;
+    // Caches the resolved environments by the hash of the requested one.
+    //
+    // Within a session every process asks for the same environment update
+    // (the library path injection), so the answer is computed once and the
+    // later requests are served with a hash lookup instead of rebuilding
+    // the environment map.
+    struct EnvironmentCache {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::map<std::string, std::string>> entries;
     };
 
-    class InterceptorImpl final : public rpc::Interceptor::Service {
+    // Serves the interceptor service with the asynchronous completion
+    // queue API.
+    //
+    // The synchronous API runs each call on a thread of a shared pool,
+    // and highly parallel builds queue up behind that pool. Here a fixed
+    // number of worker threads polls one completion queue each, and a
+    // call only occupies a thread while its handler runs. The thread
+    // count is configurable; zero means one thread per hardware core.
+    class RpcServer {
     public:
-        explicit InterceptorImpl(Reporter&);
-        ~InterceptorImpl() override = default;
-
-        ::grpc::Status Register(::grpc::ServerContext* context, const rpc::Event* request, google::protobuf::Empty* response) override;
+        // The listen address is empty for the local (loopback) collector.
+        // When it is set (for remote build workers), the token shall be
+        // set too: every call is rejected unless the client sends it as
+        // gRPC metadata.
+        explicit RpcServer(const Session &session, Reporter &reporter, size_t threads,
+                           std::string listen_address = std::string(), std::string token = std::string());
+        ~RpcServer() noexcept;
+
+        // Start listening on a free port of the configured address and
+        // spawn the worker threads. Returns the port the server is bound to.
+        [[nodiscard]] rust::Result<int> start();
+        void shutdown();
+
+        NON_DEFAULT_CONSTRUCTABLE(RpcServer)
+        NON_COPYABLE_NOR_MOVABLE(RpcServer)
 
-        NON_DEFAULT_CONSTRUCTABLE(InterceptorImpl)
-        NON_COPYABLE_NOR_MOVABLE(InterceptorImpl)
+    private:
+        void serve(grpc::ServerCompletionQueue *queue);
 
     private:
-        Reporter& reporter_;
+        const Session &session_;
+        Reporter &reporter_;
+        EnvironmentCache environments_;
+        size_t thread_count_;
+        std::string listen_address_;
+        std::string token_;
+        rpc::Interceptor::AsyncService interceptor_;
+        std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues_;
+        std::unique_ptr<grpc::Server> server_;
+        std::vector<std::thread> threads_;
     };
 }
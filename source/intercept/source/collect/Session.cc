@@ -24,29 +24,158 @@
 #ifdef SUPPORT_PRELOAD
 #include "collect/SessionLibrary.h"
 #endif
+#ifdef SUPPORT_SECCOMP
+#include "collect/SessionSeccomp.h"
+#endif
+#ifdef SUPPORT_EBPF
+#include "collect/SessionEbpf.h"
+#endif
+#ifdef SUPPORT_ENDPOINT_SECURITY
+#include "collect/SessionEndpointSecurity.h"
+#endif
 
 #include "libsys/Path.h"
 #include "libsys/Signal.h"
 
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <sys/utsname.h>
+
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+
+    std::string kernel_release()
+    {
+        utsname name {};
+        return (::uname(&name) == 0) ? std::string(name.release) : std::string();
+    }
+}
+
 namespace ic {
 
-    rust::Result<Session::Ptr> Session::from(const flags::Arguments& args, const char **envp)
-#ifdef SUPPORT_PRELOAD
+    static rust::Result<Session::Ptr> session_from(const flags::Arguments& args, const char **envp)
     {
+        if (args.as_bool(cmd::intercept::FLAG_FORCE_SECCOMP).unwrap_or(false)) {
+#ifdef SUPPORT_SECCOMP
+            return SeccompSession::from(args);
+#else
+            return rust::Err(std::runtime_error("Seccomp interception is not supported on this platform."));
+#endif
+        }
+        if (args.as_bool(cmd::intercept::FLAG_FORCE_EBPF).unwrap_or(false)) {
+#ifdef SUPPORT_EBPF
+            return EbpfSession::from(args);
+#else
+            return rust::Err(std::runtime_error("eBPF interception is not supported on this platform."));
+#endif
+        }
+        if (args.as_bool(cmd::intercept::FLAG_FORCE_ES).unwrap_or(false)) {
+#ifdef SUPPORT_ENDPOINT_SECURITY
+            return EndpointSecuritySession::from(args);
+#else
+            return rust::Err(std::runtime_error("EndpointSecurity interception is not supported on this platform."));
+#endif
+        }
+#ifdef SUPPORT_PRELOAD
         if (args.as_bool(cmd::intercept::FLAG_FORCE_WRAPPER).unwrap_or(false))
             return WrapperSession::from(args, envp);
         if (args.as_bool(cmd::intercept::FLAG_FORCE_PRELOAD).unwrap_or(false))
             return LibraryPreloadSession::from(args);
 
+        // An engine preference measured on this host (by the doctor
+        // subcommand) beats the static default.
+        if (const auto preferred = Session::preferred_engine(); preferred.has_value()) {
+            spdlog::debug("Using the recorded engine preference. [{0}]", preferred.value());
+#ifdef SUPPORT_SECCOMP
+            if (preferred.value() == "seccomp")
+                return SeccompSession::from(args);
+#endif
+#ifdef SUPPORT_EBPF
+            if (preferred.value() == "ebpf")
+                return EbpfSession::from(args);
+#endif
+            if (preferred.value() == "wrapper")
+                return WrapperSession::from(args, envp);
+            if (preferred.value() == "preload")
+                return LibraryPreloadSession::from(args);
+            // an unknown name (a newer bear wrote it?) falls through to
+            // the default.
+            spdlog::debug("Unknown engine preference ignored. [{0}]", preferred.value());
+        }
+
         return LibraryPreloadSession::from(args);
-    }
 #else
-    {
         return WrapperSession::from(args, envp);
-    }
 #endif
+    }
+
+    fs::path Session::engine_preference_file()
+    {
+        if (const char *cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr && cache[0] != '\0') {
+            return fs::path(cache) / "bear" / "engine";
+        }
+        if (const char *home = std::getenv("HOME"); home != nullptr && home[0] != '\0') {
+            return fs::path(home) / ".cache" / "bear" / "engine";
+        }
+        return fs::path();
+    }
+
+    std::optional<std::string> Session::preferred_engine()
+    {
+        const fs::path file = engine_preference_file();
+        if (file.empty()) {
+            return std::nullopt;
+        }
+        std::ifstream stream(file);
+        std::string engine;
+        std::string release;
+        if (!std::getline(stream, engine) || engine.empty()) {
+            return std::nullopt;
+        }
+        std::getline(stream, release);
+        if (release != kernel_release()) {
+            spdlog::debug("Engine preference was measured on another kernel; ignored.");
+            return std::nullopt;
+        }
+        return engine;
+    }
+
+    rust::Result<fs::path> Session::record_engine_preference(const std::string &engine)
+    {
+        const fs::path file = engine_preference_file();
+        if (file.empty()) {
+            return rust::Err(std::runtime_error("No cache directory to record the engine preference in."));
+        }
+        std::error_code error_code;
+        fs::create_directories(file.parent_path(), error_code);
+        std::ofstream stream(file);
+        stream << engine << '\n' << kernel_release() << '\n';
+        if (!stream) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to write the engine preference into {}.", file.string())));
+        }
+        return rust::Ok(file);
+    }
+
+    rust::Result<Session::Ptr> Session::from(const flags::Arguments& args, const char **envp)
+    {
+        const std::string capture(args.as_string(cmd::intercept::FLAG_CAPTURE)
+                .unwrap_or(cmd::intercept::CAPTURE_FULL));
+        if (capture != cmd::intercept::CAPTURE_FULL && capture != cmd::intercept::CAPTURE_MINIMAL) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Unknown capture profile: \"{}\"", capture)));
+        }
+        return session_from(args, envp)
+                .map<Session::Ptr>([&capture](auto session) {
+                    if (capture == cmd::intercept::CAPTURE_MINIMAL) {
+                        session->set_capture(capture);
+                    }
+                    return session;
+                });
+    }
 
     std::string Session::keep_front_in_path(const std::string& path, const std::string& paths)
     {
@@ -78,8 +207,28 @@ namespace ic {
         return sys::path::join(result);
     }
 
-    rust::Result<int> Session::run(const ic::Execution &execution, const SessionLocator &session_locator) {
+    void Session::set_locator(const SessionLocator &session_locator)
+    {
         session_locator_ = std::make_unique<SessionLocator>(session_locator);
+    }
+
+    void Session::set_token(const std::string &token)
+    {
+        session_token_ = token;
+    }
+
+    void Session::set_capture(const std::string &profile)
+    {
+        capture_profile_ = profile;
+    }
+
+    bool Session::keeps_environment() const
+    {
+        return capture_profile_ != cmd::intercept::CAPTURE_MINIMAL;
+    }
+
+    rust::Result<int> Session::run(const ic::Execution &execution, const SessionLocator &session_locator) {
+        set_locator(session_locator);
         return supervise(execution)
                 .spawn()
                 .and_then<sys::ExitStatus>([](auto child) {
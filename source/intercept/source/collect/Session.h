@@ -27,33 +27,111 @@
 #include "Domain.h"
 #include "Convert.h"
 
+#include <filesystem>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 
+namespace fs = std::filesystem;
+
+namespace el::shm {
+    struct Ring;
+}
+
 namespace ic {
 
     using namespace domain;
 
+    class Reporter;
+
     class Session {
     public:
         using Ptr = std::shared_ptr<Session>;
         static rust::Result<Session::Ptr> from(const flags::Arguments &args, const char **envp);
 
+        // The host-local file the doctor subcommand records the measured
+        // engine preference into. Empty when the host has no cache
+        // directory (no XDG_CACHE_HOME and no HOME).
+        [[nodiscard]] static fs::path engine_preference_file();
+
+        // The recorded engine preference, when there is a valid one. The
+        // record is bound to the kernel release it was measured on; a
+        // changed kernel invalidates it (the seccomp and eBPF support
+        // moves with the kernel).
+        [[nodiscard]] static std::optional<std::string> preferred_engine();
+
+        // Records the engine preference for this host. Returns the file
+        // it was written into.
+        static rust::Result<fs::path> record_engine_preference(const std::string &engine);
+
     public:
         virtual ~Session() = default;
 
         [[nodiscard]] virtual rust::Result<ic::Execution> resolve(const ic::Execution &execution) const = 0;
+
+        // Like resolve, but takes an already resolved environment for the
+        // execution. Implementations override this to skip rebuilding the
+        // environment map; the default ignores the hint.
+        [[nodiscard]] virtual rust::Result<ic::Execution> resolve(const ic::Execution &execution, const std::map<std::string, std::string> &) const
+        {
+            return resolve(execution);
+        }
         [[nodiscard]] virtual sys::Process::Builder supervise(const ic::Execution &execution) const = 0;
 
+        // The environment the intercepted build processes shall run in. It
+        // is the same environment the supervise call sets up for the build
+        // command, exposed for the daemon mode, where the build is started
+        // by the user from another shell. Only valid after the session
+        // locator has been set.
+        [[nodiscard]] virtual std::map<std::string, std::string> environment(const std::map<std::string, std::string> &env) const = 0;
+
+        // The shared memory ring the intercepted processes report their
+        // executions into, when the session provides one.
+        [[nodiscard]] virtual el::shm::Ring *events_ring() const { return nullptr; }
+
+        // Whether the supervised processes need this process to resolve
+        // their executions. When the injection is a session constant that
+        // every process of the build inherits, the supervisor re-applies
+        // it locally instead, and its started events arrive already
+        // resolved, awaiting no answer.
+        [[nodiscard]] virtual bool resolves_remotely() const { return true; }
+
+        // Called around the build command, with the reporter the session
+        // may feed events into directly. The default has nothing to run;
+        // the seccomp session serves its notifications from here.
+        virtual void start_supervision(Reporter &) { }
+        virtual void stop_supervision() { }
+
         [[nodiscard]] rust::Result<int> run(const ic::Execution &execution, const SessionLocator &session_locator);
 
+        // Remembers the service locator of the running collector. The run
+        // method does this implicitly; the daemon mode has no command to
+        // run, so it calls this before asking for the environment.
+        void set_locator(const SessionLocator &session_locator);
+
+        // Remembers the session token the collector requires on its
+        // calls. Stays empty when the collector listens only locally.
+        void set_token(const std::string &token);
+
+        // Remembers the event capture profile of the session; empty means
+        // the default (full) capture.
+        void set_capture(const std::string &profile);
+
+        // Whether the recorded events shall keep the environment of the
+        // executions. (The minimal capture profile drops it; the
+        // environment dominates the event size, so dropping it shrinks
+        // the events by an order of magnitude.)
+        [[nodiscard]] bool keeps_environment() const;
+
     protected:
         static std::string keep_front_in_path(const std::string& path, const std::string& paths);
         static std::string remove_from_path(const std::string& path, const std::string& paths);
 
     protected:
         std::unique_ptr<SessionLocator> session_locator_;
+        std::string session_token_;
+        std::string capture_profile_;
     };
 }
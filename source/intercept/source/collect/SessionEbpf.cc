@@ -0,0 +1,529 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "collect/SessionEbpf.h"
+#include "collect/Reporter.h"
+#include "HybridClock.h"
+
+#include "libsys/Errors.h"
+
+#include <fmt/format.h>
+#include <google/protobuf/util/time_util.h>
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <linux/bpf.h>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <optional>
+#include <string>
+
+namespace {
+
+    int sys_bpf(const int command, union bpf_attr *attributes)
+    {
+        return int(syscall(__NR_bpf, command, attributes, sizeof(*attributes)));
+    }
+
+    int sys_perf_event_open(perf_event_attr *attributes, const pid_t pid, const int cpu)
+    {
+        return int(syscall(__NR_perf_event_open, attributes, pid, cpu, -1, PERF_FLAG_FD_CLOEXEC));
+    }
+
+    // instruction builders (the uapi header has none)
+    bpf_insn mov64_reg(const uint8_t dst, const uint8_t src)
+    {
+        return bpf_insn{BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0};
+    }
+
+    bpf_insn mov64_imm(const uint8_t dst, const int32_t imm)
+    {
+        return bpf_insn{BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm};
+    }
+
+    bpf_insn alu64_imm(const uint8_t op, const uint8_t dst, const int32_t imm)
+    {
+        return bpf_insn{uint8_t(BPF_ALU64 | op | BPF_K), dst, 0, 0, imm};
+    }
+
+    bpf_insn jmp_reg(const uint8_t op, const uint8_t dst, const uint8_t src, const int16_t off)
+    {
+        return bpf_insn{uint8_t(BPF_JMP | op | BPF_X), dst, src, off, 0};
+    }
+
+    bpf_insn stx_mem(const uint8_t size, const uint8_t dst, const uint8_t src, const int16_t off)
+    {
+        return bpf_insn{uint8_t(BPF_STX | BPF_MEM | size), dst, src, off, 0};
+    }
+
+    bpf_insn call_fn(const int32_t function)
+    {
+        return bpf_insn{BPF_JMP | BPF_CALL, 0, 0, 0, function};
+    }
+
+    bpf_insn exit_insn()
+    {
+        return bpf_insn{BPF_JMP | BPF_EXIT, 0, 0, 0, 0};
+    }
+
+    // the 16 byte pseudo instruction pair, for 64 bit immediate values
+    void ld_imm64(std::list<bpf_insn> &instructions, const uint8_t dst, const uint8_t src, const uint64_t imm)
+    {
+        instructions.push_back(bpf_insn{BPF_LD | BPF_DW | BPF_IMM, dst, src, 0, int32_t(uint32_t(imm))});
+        instructions.push_back(bpf_insn{0, 0, 0, 0, int32_t(uint32_t(imm >> 32))});
+    }
+
+    // the ancestor level check is unrolled up to this cgroup depth
+    constexpr int DEPTH_LIMIT = 16;
+    // data pages of a perf ring buffer (shall be a power of two)
+    constexpr size_t BUFFER_PAGES = 8;
+
+    // The mount point of the cgroup v2 hierarchy, from the mount table.
+    // (It is /sys/fs/cgroup on a pure v2 host, but sits elsewhere on a
+    // hybrid setup.)
+    std::optional<std::string> cgroup2_mount()
+    {
+        std::ifstream input("/proc/self/mountinfo");
+        std::string line;
+        while (std::getline(input, line)) {
+            // the filesystem type is the first field after the " - "
+            // separator; the mount point is the 5th field before it.
+            const auto separator = line.find(" - ");
+            if (separator == std::string::npos || line.compare(separator + 3, 8, "cgroup2 ") != 0) {
+                continue;
+            }
+            size_t field = 0, begin = 0;
+            for (size_t pos = 0; pos < separator; ++pos) {
+                if (line[pos] != ' ') {
+                    continue;
+                }
+                if (++field == 4) {
+                    begin = pos + 1;
+                } else if (field == 5) {
+                    return line.substr(begin, pos - begin);
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // The cgroup id of the calling process (the kernfs inode number,
+    // the same value the bpf cgroup helpers return).
+    std::optional<uint64_t> own_cgroup_id()
+    {
+        const auto mount = cgroup2_mount();
+        if (!mount) {
+            return std::nullopt;
+        }
+        std::ifstream input("/proc/self/cgroup");
+        std::string line;
+        while (std::getline(input, line)) {
+            if (line.rfind("0::", 0) != 0) {
+                continue;
+            }
+            struct {
+                file_handle handle;
+                char buffer[MAX_HANDLE_SZ];
+            } handle = {};
+            handle.handle.handle_bytes = MAX_HANDLE_SZ;
+            int mount_id = 0;
+            if (name_to_handle_at(AT_FDCWD, (*mount + line.substr(3)).c_str(), &handle.handle, &mount_id, 0) != 0) {
+                return std::nullopt;
+            }
+            uint64_t id = 0;
+            memcpy(&id, handle.handle.f_handle, sizeof(id));
+            return id;
+        }
+        return std::nullopt;
+    }
+
+    // The id of a tracepoint, from the tracefs. (The mount point moved
+    // out of the debugfs over the kernel releases; try both.)
+    std::optional<int> tracepoint_id(const char *category, const char *name)
+    {
+        for (const char *root : {"/sys/kernel/tracing", "/sys/kernel/debug/tracing"}) {
+            std::ifstream input(fmt::format("{}/events/{}/{}/id", root, category, name));
+            int id = 0;
+            if (input >> id) {
+                return id;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // The exec tracing program. When the task is in the cgroup subtree
+    // of the collector, it writes the thread group id into the perf
+    // buffer of the current cpu; everything else is read from /proc by
+    // the drain thread. The subtree check compares the cgroup id of
+    // every ancestor of the task against ours, since the ancestor
+    // levels count from the host root, and in a container the depth of
+    // our own subtree there is not knowable.
+    std::list<bpf_insn> exec_tracing_program(const uint64_t cgroup_id, const int map_fd)
+    {
+        std::list<bpf_insn> instructions;
+        instructions.push_back(mov64_reg(6, 1));                       // r6 = ctx
+        for (int level = 0; level < DEPTH_LIMIT; ++level) {
+            instructions.push_back(mov64_imm(1, level));
+            instructions.push_back(call_fn(BPF_FUNC_get_current_ancestor_cgroup_id));
+            ld_imm64(instructions, 1, 0, cgroup_id);
+            // forward distance to the first instruction after the check
+            const auto body = int16_t((DEPTH_LIMIT - 1 - level) * 5 + 2);
+            instructions.push_back(jmp_reg(BPF_JEQ, 0, 1, body));
+        }
+        instructions.push_back(mov64_imm(0, 0));                       // not our build:
+        instructions.push_back(exit_insn());                           // done
+        instructions.push_back(call_fn(BPF_FUNC_get_current_pid_tgid));
+        instructions.push_back(alu64_imm(BPF_RSH, 0, 32));             // r0 = tgid
+        instructions.push_back(stx_mem(BPF_W, 10, 0, -8));             // stack[-8] = tgid
+        instructions.push_back(mov64_reg(1, 6));                       // r1 = ctx
+        ld_imm64(instructions, 2, BPF_PSEUDO_MAP_FD, uint64_t(map_fd));
+        ld_imm64(instructions, 3, 0, BPF_F_CURRENT_CPU);
+        instructions.push_back(mov64_reg(4, 10));
+        instructions.push_back(alu64_imm(BPF_ADD, 4, -8));             // r4 = &stack[-8]
+        instructions.push_back(mov64_imm(5, sizeof(uint32_t)));
+        instructions.push_back(call_fn(BPF_FUNC_perf_event_output));
+        instructions.push_back(mov64_imm(0, 0));
+        instructions.push_back(exit_insn());
+        return instructions;
+    }
+
+    // The target of a symbolic link under /proc; empty when unreadable.
+    std::string read_link(const std::string &path)
+    {
+        char buffer[PATH_MAX];
+        const ssize_t count = readlink(path.c_str(), buffer, sizeof(buffer) - 1);
+        return (count > 0) ? std::string(buffer, size_t(count)) : std::string();
+    }
+
+    // The argument vector of a process, from the cmdline file (NUL
+    // separated strings).
+    std::optional<std::list<std::string>> read_arguments(const uint32_t pid)
+    {
+        std::ifstream input(fmt::format("/proc/{}/cmdline", pid));
+        std::list<std::string> result;
+        std::string argument;
+        while (std::getline(input, argument, '\0')) {
+            result.emplace_back(std::move(argument));
+        }
+        return result.empty() ? std::nullopt : std::make_optional(std::move(result));
+    }
+
+    // The parent process, from the status file.
+    pid_t parent_of(const uint32_t pid)
+    {
+        std::ifstream status(fmt::format("/proc/{}/status", pid));
+        std::string key;
+        while (status >> key) {
+            if (key == "PPid:") {
+                pid_t result = 0;
+                status >> result;
+                return result;
+            }
+            status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        return 0;
+    }
+}
+
+namespace ic {
+
+    rust::Result<Session::Ptr> EbpfSession::from(const flags::Arguments& args)
+    {
+        const auto verbose = args.as_bool(flags::VERBOSE).unwrap_or(false);
+        const auto wrapper = args.as_string(cmd::intercept::FLAG_WRAPPER);
+
+        return rust::merge(wrapper, attach())
+            .map<Session::Ptr>([&verbose](auto tuple) {
+                const auto& [wrapper, attachment] = tuple;
+                const auto& [map_fd, program_fd, channels] = attachment;
+                return std::make_shared<EbpfSession>(verbose, wrapper, map_fd, program_fd, channels);
+            });
+    }
+
+    EbpfSession::EbpfSession(bool verbose, const std::string_view &executor, int map_fd, int program_fd, std::vector<Channel> channels)
+            : Session()
+            , verbose_(verbose)
+            , executor_(executor)
+            , map_fd_(map_fd)
+            , program_fd_(program_fd)
+            , channels_(std::move(channels))
+            , running_(false)
+            , drainer_()
+    {
+        spdlog::debug("Created eBPF session. [executor={0}]", executor_);
+    }
+
+    EbpfSession::~EbpfSession()
+    {
+        stop_supervision();
+        const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+        for (const auto &channel : channels_) {
+            munmap(channel.buffer, page_size * (BUFFER_PAGES + 1));
+            close(channel.event_fd);
+            close(channel.buffer_fd);
+        }
+        close(program_fd_);
+        close(map_fd_);
+    }
+
+    rust::Result<std::tuple<int, int, std::vector<EbpfSession::Channel>>> EbpfSession::attach()
+    {
+        const auto cgroup_id = own_cgroup_id();
+        if (!cgroup_id) {
+            return rust::Err(std::runtime_error("Failed to find the cgroup of this process. (The eBPF interception needs cgroup v2.)"));
+        }
+        const auto tracepoint = tracepoint_id("sched", "sched_process_exec");
+        if (!tracepoint) {
+            return rust::Err(std::runtime_error("Failed to read the exec tracepoint id. (Is the tracefs mounted?)"));
+        }
+        // the channel to user space: a perf event array, one slot per cpu
+        const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+        union bpf_attr map_attributes = {};
+        map_attributes.map_type = BPF_MAP_TYPE_PERF_EVENT_ARRAY;
+        map_attributes.key_size = sizeof(uint32_t);
+        map_attributes.value_size = sizeof(uint32_t);
+        map_attributes.max_entries = uint32_t(cpus);
+        const int map_fd = sys_bpf(BPF_MAP_CREATE, &map_attributes);
+        if (map_fd < 0) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to create the perf event map: {} (The eBPF interception needs privileges.)", sys::error_string(errno))));
+        }
+        const auto program = exec_tracing_program(cgroup_id.value(), map_fd);
+        const std::vector<bpf_insn> instructions(program.begin(), program.end());
+        union bpf_attr program_attributes = {};
+        program_attributes.prog_type = BPF_PROG_TYPE_TRACEPOINT;
+        program_attributes.insns = uint64_t(instructions.data());
+        program_attributes.insn_cnt = uint32_t(instructions.size());
+        program_attributes.license = uint64_t("GPL");
+        const int program_fd = sys_bpf(BPF_PROG_LOAD, &program_attributes);
+        if (program_fd < 0) {
+            close(map_fd);
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to load the exec tracing program: {}", sys::error_string(errno))));
+        }
+        // per cpu: a ring buffer for the output, and a tracepoint event
+        // which runs the program.
+        const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+        std::vector<Channel> channels;
+        for (int cpu = 0; cpu < cpus; ++cpu) {
+            perf_event_attr buffer_attributes = {};
+            buffer_attributes.type = PERF_TYPE_SOFTWARE;
+            buffer_attributes.config = PERF_COUNT_SW_BPF_OUTPUT;
+            buffer_attributes.size = sizeof(buffer_attributes);
+            buffer_attributes.sample_type = PERF_SAMPLE_RAW;
+            buffer_attributes.sample_period = 1;
+            buffer_attributes.wakeup_events = 1;
+            const int buffer_fd = sys_perf_event_open(&buffer_attributes, -1, cpu);
+            if (buffer_fd < 0) {
+                break;
+            }
+            void *buffer = mmap(nullptr, page_size * (BUFFER_PAGES + 1), PROT_READ | PROT_WRITE, MAP_SHARED, buffer_fd, 0);
+            if (buffer == MAP_FAILED) {
+                close(buffer_fd);
+                break;
+            }
+            uint32_t key = uint32_t(cpu);
+            union bpf_attr update_attributes = {};
+            update_attributes.map_fd = uint32_t(map_fd);
+            update_attributes.key = uint64_t(&key);
+            update_attributes.value = uint64_t(&buffer_fd);
+            perf_event_attr event_attributes = {};
+            event_attributes.type = PERF_TYPE_TRACEPOINT;
+            event_attributes.config = uint64_t(tracepoint.value());
+            event_attributes.size = sizeof(event_attributes);
+            event_attributes.sample_period = 1;
+            const int event_fd = sys_perf_event_open(&event_attributes, -1, cpu);
+            if (sys_bpf(BPF_MAP_UPDATE_ELEM, &update_attributes) != 0
+                    || event_fd < 0
+                    || ioctl(event_fd, PERF_EVENT_IOC_SET_BPF, program_fd) != 0
+                    || ioctl(event_fd, PERF_EVENT_IOC_ENABLE, 0) != 0) {
+                if (event_fd >= 0) {
+                    close(event_fd);
+                }
+                munmap(buffer, page_size * (BUFFER_PAGES + 1));
+                close(buffer_fd);
+                break;
+            }
+            channels.emplace_back(Channel{buffer_fd, event_fd, buffer});
+        }
+        if (channels.size() != size_t(cpus)) {
+            const auto error = fmt::format("Failed to attach the exec tracing program: {}", sys::error_string(errno));
+            for (const auto &channel : channels) {
+                close(channel.event_fd);
+                munmap(channel.buffer, page_size * (BUFFER_PAGES + 1));
+                close(channel.buffer_fd);
+            }
+            close(program_fd);
+            close(map_fd);
+            return rust::Err(std::runtime_error(error));
+        }
+        return rust::Ok(std::make_tuple(map_fd, program_fd, std::move(channels)));
+    }
+
+    rust::Result<ic::Execution> EbpfSession::resolve(const ic::Execution &execution) const
+    {
+        // the interception needs no changes on the executed command.
+        return rust::Ok(execution);
+    }
+
+    sys::Process::Builder EbpfSession::supervise(const ic::Execution &execution) const
+    {
+        auto builder = sys::Process::Builder(executor_)
+                .add_argument(executor_)
+                .add_argument(cmd::wrapper::FLAG_DESTINATION)
+                .add_argument(*session_locator_);
+
+        if (verbose_) {
+            builder.add_argument(cmd::wrapper::FLAG_VERBOSE);
+        }
+
+        return builder
+                .add_argument(cmd::wrapper::FLAG_EXECUTE)
+                .add_argument(execution.executable)
+                .add_argument(cmd::wrapper::FLAG_COMMAND)
+                .add_arguments(execution.arguments.begin(), execution.arguments.end())
+                .set_environment(environment(execution.environment));
+    }
+
+    std::map<std::string, std::string>
+    EbpfSession::environment(const std::map<std::string, std::string> &env) const
+    {
+        // the build processes report nothing themselves; only the session
+        // token travels with the root command, for the remote collector.
+        std::map<std::string, std::string> copy(env);
+        if (!session_token_.empty()) {
+            copy[cmd::wrapper::KEY_TOKEN] = session_token_;
+        }
+        return copy;
+    }
+
+    void EbpfSession::start_supervision(Reporter &reporter)
+    {
+        running_.store(true, std::memory_order_release);
+        drainer_ = std::thread([this, &reporter]() {
+            drain_loop(reporter);
+        });
+    }
+
+    void EbpfSession::stop_supervision()
+    {
+        running_.store(false, std::memory_order_release);
+        if (drainer_.joinable()) {
+            drainer_.join();
+        }
+    }
+
+    void EbpfSession::drain_loop(Reporter &reporter)
+    {
+        std::vector<pollfd> poll_fds;
+        for (const auto &channel : channels_) {
+            poll_fds.push_back(pollfd{channel.buffer_fd, POLLIN, 0});
+        }
+        while (running_.load(std::memory_order_acquire)) {
+            if (poll(poll_fds.data(), nfds_t(poll_fds.size()), 100) < 0) {
+                continue;
+            }
+            // drain every buffer on each pass; the records are cheap to
+            // look for, and a missed wakeup shall not lose any of them.
+            for (const auto &channel : channels_) {
+                drain_buffer(reporter, channel);
+            }
+        }
+        // a last pass, for the records of the build's final commands.
+        for (const auto &channel : channels_) {
+            drain_buffer(reporter, channel);
+        }
+    }
+
+    void EbpfSession::drain_buffer(Reporter &reporter, const Channel &channel) const
+    {
+        const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+        const size_t data_size = page_size * BUFFER_PAGES;
+        auto *meta = static_cast<perf_event_mmap_page *>(channel.buffer);
+        auto *data = static_cast<char *>(channel.buffer) + page_size;
+        const uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+        uint64_t tail = meta->data_tail;
+        std::vector<char> copy;
+        while (tail < head) {
+            auto *header = reinterpret_cast<perf_event_header *>(data + (tail % data_size));
+            // a record can wrap around the end of the buffer
+            if ((tail % data_size) + header->size > data_size) {
+                copy.assign(size_t(header->size), 0);
+                const size_t first = data_size - (tail % data_size);
+                memcpy(copy.data(), data + (tail % data_size), first);
+                memcpy(copy.data() + first, data, header->size - first);
+                header = reinterpret_cast<perf_event_header *>(copy.data());
+            }
+            if (header->type == PERF_RECORD_SAMPLE) {
+                // the raw payload is a 32 bit size and the bytes the
+                // program wrote: the thread group id.
+                uint32_t pid = 0;
+                memcpy(&pid, reinterpret_cast<const char *>(header + 1) + sizeof(uint32_t), sizeof(pid));
+                report(reporter, pid);
+            } else if (header->type == PERF_RECORD_LOST) {
+                spdlog::debug("The exec tracing lost records. (The build executes faster than the drain.)");
+            }
+            tail += header->size;
+        }
+        __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+    }
+
+    void EbpfSession::report(Reporter &reporter, const uint32_t pid) const
+    {
+        // everything besides the pid comes from /proc; a process which
+        // already exited (or executed again) is skipped.
+        const auto executable = read_link(fmt::format("/proc/{}/exe", pid));
+        const auto working_dir = read_link(fmt::format("/proc/{}/cwd", pid));
+        const auto arguments = read_arguments(pid);
+        const auto parent = parent_of(pid);
+        if (executable.empty() || working_dir.empty() || !arguments) {
+            spdlog::debug("Failed to read the command of a traced exec. [pid: {}]", pid);
+            return;
+        }
+        // the environment is not read, which is fine for the semantic
+        // analysis: it only needs the command itself.
+        rpc::Event event;
+        event.set_rid(make_reporter_id(pid));
+        domain::hlc::stamp(event);
+        *event.mutable_timestamp() = google::protobuf::util::TimeUtil::GetCurrentTime();
+        auto &started = *event.mutable_started();
+        started.set_pid(pid);
+        started.set_ppid(parent);
+        auto &execution = *started.mutable_execution();
+        execution.set_executable(executable);
+        execution.set_working_dir(working_dir);
+        for (auto &argument : arguments.value()) {
+            execution.add_arguments(std::move(argument));
+        }
+        reporter.report(event);
+    }
+}
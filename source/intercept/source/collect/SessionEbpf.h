@@ -0,0 +1,87 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "collect/Session.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace ic {
+
+    // Intercepts the process executions with an eBPF program on the
+    // sched_process_exec tracepoint, filtered to the cgroup subtree of
+    // the collector. The build processes run completely unchanged: no
+    // library is preloaded, no wrapper process is spawned, and nothing
+    // is ever blocked. This makes it a good fit for container CI, where
+    // the build owns the whole cgroup subtree, and where the privileges
+    // the bpf and perf_event_open calls need are available.
+    //
+    // The program streams the pid of every executed process through a
+    // perf ring buffer; a drain thread picks the command line and the
+    // working directory up from /proc and reports it. A process which
+    // exits faster than that read is lost (unlike under the seccomp
+    // session, which holds the process until the read is done) -- an
+    // accepted trade for zero interference with the build.
+    class EbpfSession : public ic::Session {
+    public:
+        // One perf ring buffer and one tracepoint event, per cpu.
+        struct Channel {
+            int buffer_fd;
+            int event_fd;
+            void *buffer;
+        };
+
+        EbpfSession(bool verbose, const std::string_view &executor, int map_fd, int program_fd, std::vector<Channel> channels);
+        ~EbpfSession() override;
+
+        static rust::Result<Session::Ptr> from(const flags::Arguments&);
+
+        [[nodiscard]] rust::Result<ic::Execution> resolve(const ic::Execution &execution) const override;
+        [[nodiscard]] sys::Process::Builder supervise(const ic::Execution &execution) const override;
+        [[nodiscard]] std::map<std::string, std::string> environment(const std::map<std::string, std::string> &env) const override;
+
+        void start_supervision(Reporter &reporter) override;
+        void stop_supervision() override;
+
+        NON_DEFAULT_CONSTRUCTABLE(EbpfSession)
+        NON_COPYABLE_NOR_MOVABLE(EbpfSession)
+
+    private:
+        // Creates the map, loads the program and attaches it to the
+        // tracepoint on every cpu. Fails without the needed privileges.
+        static rust::Result<std::tuple<int, int, std::vector<Channel>>> attach();
+
+        void drain_loop(Reporter &reporter);
+        void drain_buffer(Reporter &reporter, const Channel &channel) const;
+        void report(Reporter &reporter, uint32_t pid) const;
+
+    private:
+        bool verbose_;
+        std::string executor_;
+        int map_fd_;
+        int program_fd_;
+        std::vector<Channel> channels_;
+        std::atomic<bool> running_;
+        std::thread drainer_;
+    };
+}
@@ -0,0 +1,233 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "collect/SessionEndpointSecurity.h"
+#include "collect/Reporter.h"
+
+#include <fmt/format.h>
+#include <google/protobuf/util/time_util.h>
+#include <spdlog/spdlog.h>
+
+#include <bsm/libbsm.h>
+#include <libproc.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace {
+
+    // The working directory of a process. The exec notification carries
+    // the command, but the directory of the caller survives the exec
+    // and is read back from the kernel. Empty when the process is gone.
+    std::string working_dir_of(const pid_t pid)
+    {
+        proc_vnodepathinfo info = {};
+        if (proc_pidinfo(pid, PROC_PIDVNODEPATHINFO, 0, &info, sizeof(info)) <= 0) {
+            return std::string();
+        }
+        return std::string(info.pvi_cdir.vip_path);
+    }
+
+    std::string to_string(const es_string_token_t &token)
+    {
+        return std::string(token.data, token.length);
+    }
+}
+
+namespace ic {
+
+    rust::Result<Session::Ptr> EndpointSecuritySession::from(const flags::Arguments& args)
+    {
+        const auto verbose = args.as_bool(flags::VERBOSE).unwrap_or(false);
+        const auto wrapper = args.as_string(cmd::intercept::FLAG_WRAPPER);
+
+        return wrapper.and_then<Session::Ptr>([&verbose](auto executor) -> rust::Result<Session::Ptr> {
+            auto session = std::make_shared<EndpointSecuritySession>(verbose, executor);
+            // the handler block holds the session pointer; the session
+            // outlives the client, which is deleted in the destructor.
+            EndpointSecuritySession *raw = session.get();
+            es_client_t *client = nullptr;
+            switch (es_new_client(&client, ^(es_client_t *, const es_message_t *message) {
+                raw->handle(message);
+            })) {
+                case ES_NEW_CLIENT_RESULT_SUCCESS:
+                    break;
+                case ES_NEW_CLIENT_RESULT_ERR_NOT_ENTITLED:
+                    return rust::Err(std::runtime_error(
+                            "The EndpointSecurity interception needs the endpoint security entitlement on this binary."));
+                case ES_NEW_CLIENT_RESULT_ERR_NOT_PERMITTED:
+                    return rust::Err(std::runtime_error(
+                            "The EndpointSecurity interception is not approved on this host. (Grant Full Disk Access to it.)"));
+                case ES_NEW_CLIENT_RESULT_ERR_NOT_PRIVILEGED:
+                    return rust::Err(std::runtime_error(
+                            "The EndpointSecurity interception needs root privileges."));
+                default:
+                    return rust::Err(std::runtime_error(
+                            "Failed to create the EndpointSecurity client."));
+            }
+            session->client_ = client;
+            return rust::Ok(Session::Ptr(session));
+        });
+    }
+
+    EndpointSecuritySession::EndpointSecuritySession(bool verbose, const std::string_view &executor)
+            : Session()
+            , verbose_(verbose)
+            , executor_(executor)
+            , client_(nullptr)
+            , mutex_()
+            , reporter_(nullptr)
+            , members_()
+    {
+        spdlog::debug("Created EndpointSecurity session. [executor={0}]", executor_);
+    }
+
+    EndpointSecuritySession::~EndpointSecuritySession()
+    {
+        stop_supervision();
+        if (client_ != nullptr) {
+            // drains the handler before it returns.
+            es_delete_client(client_);
+        }
+    }
+
+    rust::Result<ic::Execution> EndpointSecuritySession::resolve(const ic::Execution &execution) const
+    {
+        // the interception needs no changes on the executed command.
+        return rust::Ok(execution);
+    }
+
+    sys::Process::Builder EndpointSecuritySession::supervise(const ic::Execution &execution) const
+    {
+        auto builder = sys::Process::Builder(executor_)
+                .add_argument(executor_)
+                .add_argument(cmd::wrapper::FLAG_DESTINATION)
+                .add_argument(*session_locator_);
+
+        if (verbose_) {
+            builder.add_argument(cmd::wrapper::FLAG_VERBOSE);
+        }
+
+        return builder
+                .add_argument(cmd::wrapper::FLAG_EXECUTE)
+                .add_argument(execution.executable)
+                .add_argument(cmd::wrapper::FLAG_COMMAND)
+                .add_arguments(execution.arguments.begin(), execution.arguments.end())
+                .set_environment(environment(execution.environment));
+    }
+
+    std::map<std::string, std::string>
+    EndpointSecuritySession::environment(const std::map<std::string, std::string> &env) const
+    {
+        // the build processes report nothing themselves; only the session
+        // token travels with the root command, for the remote collector.
+        std::map<std::string, std::string> copy(env);
+        if (!session_token_.empty()) {
+            copy[cmd::wrapper::KEY_TOKEN] = session_token_;
+        }
+        return copy;
+    }
+
+    void EndpointSecuritySession::start_supervision(Reporter &reporter)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            reporter_ = &reporter;
+            // the build command is spawned by this process, so every
+            // process of the build descends from here.
+            members_ = {getpid()};
+        }
+        const es_event_type_t events[] = {
+                ES_EVENT_TYPE_NOTIFY_FORK,
+                ES_EVENT_TYPE_NOTIFY_EXEC,
+                ES_EVENT_TYPE_NOTIFY_EXIT,
+        };
+        if (es_subscribe(client_, events, sizeof(events) / sizeof(events[0])) != ES_RETURN_SUCCESS) {
+            spdlog::warn("Failed to subscribe to the exec notifications; no executions will be reported.");
+        }
+    }
+
+    void EndpointSecuritySession::stop_supervision()
+    {
+        if (client_ != nullptr) {
+            es_unsubscribe_all(client_);
+        }
+        std::lock_guard<std::mutex> guard(mutex_);
+        reporter_ = nullptr;
+        members_.clear();
+    }
+
+    void EndpointSecuritySession::handle(const es_message_t *message)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (reporter_ == nullptr) {
+            return;
+        }
+        switch (message->event_type) {
+            case ES_EVENT_TYPE_NOTIFY_FORK: {
+                const pid_t parent = audit_token_to_pid(message->process->audit_token);
+                if (members_.count(parent) > 0) {
+                    members_.insert(audit_token_to_pid(message->event.fork.child->audit_token));
+                }
+                break;
+            }
+            case ES_EVENT_TYPE_NOTIFY_EXEC: {
+                const pid_t pid = audit_token_to_pid(message->event.exec.target->audit_token);
+                if (members_.count(pid) > 0) {
+                    report(*reporter_, message->event.exec);
+                }
+                break;
+            }
+            case ES_EVENT_TYPE_NOTIFY_EXIT: {
+                members_.erase(audit_token_to_pid(message->process->audit_token));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void EndpointSecuritySession::report(Reporter &reporter, const es_event_exec_t &exec) const
+    {
+        const es_process_t &process = *exec.target;
+        const pid_t pid = audit_token_to_pid(process.audit_token);
+        const auto working_dir = working_dir_of(pid);
+        if (working_dir.empty()) {
+            spdlog::debug("Failed to read the working directory of a traced exec. [pid: {}]", pid);
+            return;
+        }
+        // the environment is not read, which is fine for the semantic
+        // analysis: it only needs the command itself.
+        rpc::Event event;
+        event.set_rid(make_reporter_id(uint32_t(pid)));
+        *event.mutable_timestamp() = google::protobuf::util::TimeUtil::GetCurrentTime();
+        auto &started = *event.mutable_started();
+        started.set_pid(uint32_t(pid));
+        started.set_ppid(uint32_t(process.ppid));
+        auto &execution = *started.mutable_execution();
+        execution.set_executable(to_string(process.executable->path));
+        execution.set_working_dir(working_dir);
+        const uint32_t count = es_exec_arg_count(&exec);
+        for (uint32_t index = 0; index < count; ++index) {
+            execution.add_arguments(to_string(es_exec_arg(&exec, index)));
+        }
+        reporter.report(event);
+    }
+}
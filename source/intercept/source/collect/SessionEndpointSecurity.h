@@ -0,0 +1,75 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "collect/Session.h"
+
+#include <EndpointSecurity/EndpointSecurity.h>
+
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace ic {
+
+    // Intercepts the process executions with an EndpointSecurity client
+    // subscribed to the exec notifications, filtered to the descendants
+    // of the collector. The build processes run completely unchanged:
+    // SIP strips the injected library from the protected binaries (so
+    // the preload session silently misses most execs on macOS), and the
+    // wrapper session pays an extra process for every compile; here the
+    // notifications come from the kernel instead.
+    //
+    // The descendant filter is kept from the fork and exit
+    // notifications, seeded with this process when the supervision
+    // starts. Creating the client needs root privileges and the
+    // endpoint security entitlement, which a CI host grants once.
+    class EndpointSecuritySession : public ic::Session {
+    public:
+        EndpointSecuritySession(bool verbose, const std::string_view &executor);
+        ~EndpointSecuritySession() override;
+
+        static rust::Result<Session::Ptr> from(const flags::Arguments&);
+
+        [[nodiscard]] rust::Result<ic::Execution> resolve(const ic::Execution &execution) const override;
+        [[nodiscard]] sys::Process::Builder supervise(const ic::Execution &execution) const override;
+        [[nodiscard]] std::map<std::string, std::string> environment(const std::map<std::string, std::string> &env) const override;
+
+        void start_supervision(Reporter &reporter) override;
+        void stop_supervision() override;
+
+        // Called by the subscription handler with every notification.
+        void handle(const es_message_t *message);
+
+        NON_DEFAULT_CONSTRUCTABLE(EndpointSecuritySession)
+        NON_COPYABLE_NOR_MOVABLE(EndpointSecuritySession)
+
+    private:
+        void report(Reporter &reporter, const es_event_exec_t &exec) const;
+
+    private:
+        bool verbose_;
+        std::string executor_;
+        es_client_t *client_;
+        std::mutex mutex_;
+        Reporter *reporter_;
+        std::set<pid_t> members_;
+    };
+}
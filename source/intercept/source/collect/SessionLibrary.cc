@@ -20,13 +20,23 @@
 #include "config.h"
 #include "collect/SessionLibrary.h"
 
+#include "collect/PathProbeCache.h"
 #include "libsys/Errors.h"
 #include "libsys/Path.h"
 #include "libsys/Process.h"
 
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <functional>
+#include <map>
 
 namespace {
 
@@ -54,36 +64,134 @@ namespace ic {
     rust::Result<Session::Ptr> LibraryPreloadSession::from(const flags::Arguments& args)
     {
         auto verbose = args.as_bool(flags::VERBOSE).unwrap_or(false);
-        const auto library = args.as_string(cmd::intercept::FLAG_LIBRARY);
-        const auto wrapper = args.as_string(cmd::intercept::FLAG_WRAPPER);
+        // the library is loaded (read) by the intercepted processes,
+        // while the reporter executable is run by them.
+        const auto library = args.as_string(cmd::intercept::FLAG_LIBRARY)
+                .and_then<std::string>([](const auto &path) { return canonical_path(path, R_OK); });
+        const auto wrapper = args.as_string(cmd::intercept::FLAG_WRAPPER)
+                .and_then<std::string>([](const auto &path) { return canonical_path(path, X_OK); });
+        const auto filter = args.as_string(cmd::intercept::FLAG_FILTER).unwrap_or("");
 
         return merge(library, wrapper)
-            .map<Session::Ptr>([&verbose](auto tuple) {
+            .map<Session::Ptr>([&verbose, &filter](auto tuple) {
                 const auto& [library, wrapper] = tuple;
-                return std::make_shared<LibraryPreloadSession>(verbose, library, wrapper);
+                return std::make_shared<LibraryPreloadSession>(verbose, library, wrapper, filter);
             });
     }
 
     LibraryPreloadSession::LibraryPreloadSession(
         bool verbose,
         const std::string_view &library,
-        const std::string_view &executor)
+        const std::string_view &executor,
+        const std::string_view &filter)
             : Session()
             , verbose_(verbose)
             , library_(library)
             , executor_(executor)
+            , filter_(filter)
+            , ring_name_()
+            , ring_(nullptr)
+            , ring_fd_(-1)
     {
+        create_ring();
         spdlog::debug("Created library preload session. [library={0}, executor={1}]", library_, executor_);
     }
 
+    LibraryPreloadSession::~LibraryPreloadSession()
+    {
+        if (ring_ != nullptr) {
+            munmap(ring_, sizeof(el::shm::Ring));
+            if (ring_fd_ != -1) {
+                close(ring_fd_);
+            } else {
+                shm_unlink(ring_name_.c_str());
+            }
+        }
+    }
+
+    void LibraryPreloadSession::create_ring()
+    {
+        // The ring is a best effort optimization: when it can't be
+        // created, the intercepted processes report through the reporter
+        // process instead.
+        //
+        // The memory is an anonymous memfd where the kernel offers one:
+        // nothing is written to the filesystem, and a crashed session
+        // cleans up by itself (the memory is gone with the last mapping).
+        // The intercepted processes attach to it through the proc
+        // filesystem entry of this process, so the descriptor stays open
+        // for the whole session. The POSIX shared memory object is the
+        // fallback, which needs the unlink in the destructor.
+        std::string name;
+        int fd = -1;
+        bool anonymous = false;
+#ifdef SYS_memfd_create
+        fd = int(::syscall(SYS_memfd_create, "bear-events-ring", 0));
+        if (fd != -1) {
+            name = fmt::format("/proc/{}/fd/{}", getpid(), fd);
+            anonymous = true;
+        }
+#endif
+        if (fd == -1) {
+            name = fmt::format("/bear-{}", getpid());
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        }
+        if (fd == -1) {
+            spdlog::debug("Creating the events ring failed: {}", sys::error_string(errno));
+            return;
+        }
+        if (ftruncate(fd, sizeof(el::shm::Ring)) == -1) {
+            spdlog::debug("Sizing the events ring failed: {}", sys::error_string(errno));
+            close(fd);
+            if (!anonymous) {
+                shm_unlink(name.c_str());
+            }
+            return;
+        }
+        void *const address = mmap(nullptr, sizeof(el::shm::Ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            spdlog::debug("Mapping the events ring failed: {}", sys::error_string(errno));
+            close(fd);
+            if (!anonymous) {
+                shm_unlink(name.c_str());
+            }
+            return;
+        }
+        if (anonymous) {
+            ring_fd_ = fd;
+        } else {
+            close(fd);
+        }
+        ring_ = static_cast<el::shm::Ring *>(address);
+        el::shm::init(*ring_);
+        ring_name_ = std::move(name);
+    }
+
+    el::shm::Ring *LibraryPreloadSession::events_ring() const
+    {
+        return ring_;
+    }
+
+    bool LibraryPreloadSession::resolves_remotely() const
+    {
+        // The supervisor re-applies the distributed injection locally and
+        // reports the started event already resolved.
+        return false;
+    }
+
     rust::Result<ic::Execution> LibraryPreloadSession::resolve(const ic::Execution &execution) const
     {
         spdlog::debug("trying to resolve for library: {}", execution.executable.string());
+        return resolve(execution, update(execution.environment));
+    }
+
+    rust::Result<ic::Execution> LibraryPreloadSession::resolve(const ic::Execution &execution, const std::map<std::string, std::string> &environment) const
+    {
         return rust::Ok(ic::Execution{
                 execution.executable,
                 execution.arguments,
                 execution.working_dir,
-                update(execution.environment)
+                environment
         });
     }
 
@@ -106,15 +214,39 @@ namespace ic {
                 .set_environment(update(execution.environment));
     }
 
+    std::map<std::string, std::string>
+    LibraryPreloadSession::environment(const std::map<std::string, std::string> &env) const
+    {
+        return update(env);
+    }
+
     std::map<std::string, std::string>
     LibraryPreloadSession::update(const std::map<std::string, std::string> &env) const
     {
+        // Within a session the injection is constant: everything but the
+        // preload entry (which merges with the value of the request) is
+        // assembled once. Only valid after the session locator is set.
+        std::call_once(injection_once_, [this]() {
+            if (verbose_) {
+                injection_[cmd::library::KEY_VERBOSE] = "true";
+            }
+            injection_[cmd::library::KEY_DESTINATION] = *session_locator_;
+            injection_[cmd::library::KEY_REPORTER] = executor_;
+            if (!session_token_.empty()) {
+                injection_[cmd::wrapper::KEY_TOKEN] = session_token_;
+            }
+            if (!ring_name_.empty()) {
+                injection_[cmd::library::KEY_RING] = ring_name_;
+            }
+            if (!filter_.empty()) {
+                injection_[cmd::library::KEY_FILTER] = filter_;
+            }
+        });
+
         std::map<std::string, std::string> copy(env);
-        if (verbose_) {
-            copy[cmd::library::KEY_VERBOSE] = "true";
+        for (const auto &[key, value] : injection_) {
+            copy[key] = value;
         }
-        copy[cmd::library::KEY_DESTINATION] = *session_locator_;
-        copy[cmd::library::KEY_REPORTER] = executor_;
         insert_or_merge(copy, GLIBC_PRELOAD_KEY, library_, Session::keep_front_in_path);
 
         return copy;
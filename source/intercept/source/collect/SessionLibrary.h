@@ -20,27 +20,51 @@
 #pragma once
 
 #include "collect/Session.h"
+#include "report/libexec/ShmRing.h"
+
+#include <mutex>
 
 namespace ic {
 
     class LibraryPreloadSession : public ic::Session {
     public:
-        LibraryPreloadSession(bool verbose, const std::string_view &library, const std::string_view &executor);
+        LibraryPreloadSession(bool verbose, const std::string_view &library, const std::string_view &executor, const std::string_view &filter);
+        ~LibraryPreloadSession() override;
 
         static rust::Result<Session::Ptr> from(const flags::Arguments&);
 
         [[nodiscard]] rust::Result<ic::Execution> resolve(const ic::Execution &execution) const override;
+        [[nodiscard]] rust::Result<ic::Execution> resolve(const ic::Execution &execution, const std::map<std::string, std::string> &environment) const override;
         [[nodiscard]] sys::Process::Builder supervise(const ic::Execution &execution) const override;
+        [[nodiscard]] std::map<std::string, std::string> environment(const std::map<std::string, std::string> &env) const override;
+        [[nodiscard]] el::shm::Ring *events_ring() const override;
+        [[nodiscard]] bool resolves_remotely() const override;
 
         NON_DEFAULT_CONSTRUCTABLE(LibraryPreloadSession)
         NON_COPYABLE_NOR_MOVABLE(LibraryPreloadSession)
 
     private:
         [[nodiscard]] std::map<std::string, std::string> update(const std::map<std::string, std::string>& env) const;
+        void create_ring();
 
     private:
         bool verbose_;
+        // Canonical paths, verified when the session is created; the
+        // intercepted processes use them without further lookups.
         std::string library_;
         std::string executor_;
+        std::string filter_;
+        std::string ring_name_;
+        el::shm::Ring *ring_;
+        // The memory object behind the ring, when it is an anonymous
+        // memfd; -1 when it is a named POSIX shared memory object. The
+        // descriptor stays open for the session: the intercepted
+        // processes reach the memory through the proc filesystem entry
+        // of this process.
+        int ring_fd_;
+        // The injected variables are session constants; they are built on
+        // the first update and reused afterwards.
+        mutable std::once_flag injection_once_;
+        mutable std::map<std::string, std::string> injection_;
     };
 }
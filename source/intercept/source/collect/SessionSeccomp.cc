@@ -0,0 +1,373 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "collect/SessionSeccomp.h"
+#include "collect/Reporter.h"
+#include "HybridClock.h"
+
+#include "libsys/Errors.h"
+
+#include <fmt/format.h>
+#include <google/protobuf/util/time_util.h>
+#include <spdlog/spdlog.h>
+
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_X86_64
+#elif defined(__i386__)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_I386
+#elif defined(__aarch64__)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_AARCH64
+#elif defined(__arm__)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_ARM
+#elif defined(__riscv) && (__riscv_xlen == 64)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_RISCV64
+#elif defined(__powerpc64__) && defined(__LITTLE_ENDIAN__)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_PPC64LE
+#elif defined(__powerpc64__)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_PPC64
+#elif defined(__s390x__)
+#define SECCOMP_NATIVE_ARCH AUDIT_ARCH_S390X
+#endif
+
+namespace {
+
+    // A single argument string shall fit into this; gives up on reading
+    // garbage addresses without walking the whole address space.
+    constexpr size_t STRING_LIMIT = 128 * 1024;
+    // More arguments than any build tool takes; same purpose.
+    constexpr size_t ARGUMENT_LIMIT = 256 * 1024;
+
+    // Reads a NUL terminated string from the memory of another process.
+    // The reads stop at page boundaries: the string may end just before
+    // an unmapped page, and a read across it would fail entirely.
+    std::optional<std::string> read_string(const pid_t pid, uint64_t address)
+    {
+        constexpr size_t PAGE_SIZE = 4096;
+        std::string result;
+        char buffer[PAGE_SIZE];
+        while (result.size() < STRING_LIMIT) {
+            const size_t chunk = PAGE_SIZE - (address % PAGE_SIZE);
+            iovec local = { buffer, chunk };
+            iovec remote = { reinterpret_cast<void *>(address), chunk };
+            const ssize_t count = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+            if (count <= 0) {
+                return std::nullopt;
+            }
+            if (const auto *end = static_cast<const char *>(memchr(buffer, 0, size_t(count))); end != nullptr) {
+                result.append(buffer, size_t(end - buffer));
+                return result;
+            }
+            result.append(buffer, size_t(count));
+            address += uint64_t(count);
+        }
+        return std::nullopt;
+    }
+
+    // Reads a NULL terminated pointer array (the argv of the execve
+    // call) and the strings it points to.
+    std::optional<std::list<std::string>> read_strings(const pid_t pid, uint64_t address)
+    {
+        constexpr size_t BATCH = 64;
+        std::list<std::string> result;
+        uint64_t pointers[BATCH];
+        for (size_t total = 0; total < ARGUMENT_LIMIT; ) {
+            iovec local = { pointers, sizeof(pointers) };
+            iovec remote = { reinterpret_cast<void *>(address), sizeof(pointers) };
+            const ssize_t count = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+            if (count < ssize_t(sizeof(uint64_t))) {
+                return std::nullopt;
+            }
+            const size_t read = size_t(count) / sizeof(uint64_t);
+            for (size_t index = 0; index < read; ++index, ++total) {
+                if (pointers[index] == 0) {
+                    return result;
+                }
+                auto string = read_string(pid, pointers[index]);
+                if (!string) {
+                    return std::nullopt;
+                }
+                result.emplace_back(std::move(string.value()));
+            }
+            address += read * sizeof(uint64_t);
+        }
+        return std::nullopt;
+    }
+
+    // The target of a symbolic link under /proc; empty when unreadable.
+    std::string read_link(const std::string &path)
+    {
+        char buffer[PATH_MAX];
+        const ssize_t count = readlink(path.c_str(), buffer, sizeof(buffer) - 1);
+        return (count > 0) ? std::string(buffer, size_t(count)) : std::string();
+    }
+
+    // The parent process of the trapped process, from the status file.
+    pid_t parent_of(const pid_t pid)
+    {
+        std::ifstream status(fmt::format("/proc/{}/status", pid));
+        std::string key;
+        while (status >> key) {
+            if (key == "PPid:") {
+                pid_t result = 0;
+                status >> result;
+                return result;
+            }
+            status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        return 0;
+    }
+}
+
+namespace ic {
+
+    rust::Result<Session::Ptr> SeccompSession::from(const flags::Arguments& args)
+    {
+        const auto verbose = args.as_bool(flags::VERBOSE).unwrap_or(false);
+        const auto wrapper = args.as_string(cmd::intercept::FLAG_WRAPPER);
+
+        return rust::merge(wrapper, install_filter())
+            .map<Session::Ptr>([&verbose](auto tuple) {
+                const auto& [wrapper, notify_fd] = tuple;
+                return std::make_shared<SeccompSession>(verbose, wrapper, notify_fd);
+            });
+    }
+
+    SeccompSession::SeccompSession(bool verbose, const std::string_view &executor, int notify_fd)
+            : Session()
+            , verbose_(verbose)
+            , executor_(executor)
+            , notify_fd_(notify_fd)
+            , running_(false)
+            , supervisor_()
+    {
+        spdlog::debug("Created seccomp session. [executor={0}]", executor_);
+    }
+
+    SeccompSession::~SeccompSession()
+    {
+        stop_supervision();
+        close(notify_fd_);
+    }
+
+    rust::Result<int> SeccompSession::install_filter()
+    {
+#ifndef SECCOMP_NATIVE_ARCH
+        return rust::Err(std::runtime_error("Seccomp interception is not supported on this architecture."));
+#else
+        // An unprivileged process may only install a filter with the
+        // no-new-privs flag set; the flag is inherited like the filter.
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to set no_new_privs: {}", sys::error_string(errno))));
+        }
+        sock_filter filter[] = {
+                // syscalls of a foreign architecture (32 bit children)
+                // have their own numbering; let them pass unreported.
+                BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
+                BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_NATIVE_ARCH, 1, 0),
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+                BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+                BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_execve, 2, 0),
+#ifdef __NR_execveat
+                BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_execveat, 1, 0),
+#else
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_USER_NOTIF),
+        };
+        sock_fprog program = { static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])), filter };
+        const int fd = int(syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAG_NEW_LISTENER, &program));
+        if (fd < 0) {
+            return rust::Err(std::runtime_error(
+                    fmt::format("Failed to install the seccomp filter: {}", sys::error_string(errno))));
+        }
+        return rust::Ok(fd);
+#endif
+    }
+
+    rust::Result<ic::Execution> SeccompSession::resolve(const ic::Execution &execution) const
+    {
+        // the interception needs no changes on the executed command.
+        return rust::Ok(execution);
+    }
+
+    sys::Process::Builder SeccompSession::supervise(const ic::Execution &execution) const
+    {
+        auto builder = sys::Process::Builder(executor_)
+                .add_argument(executor_)
+                .add_argument(cmd::wrapper::FLAG_DESTINATION)
+                .add_argument(*session_locator_);
+
+        if (verbose_) {
+            builder.add_argument(cmd::wrapper::FLAG_VERBOSE);
+        }
+
+        return builder
+                .add_argument(cmd::wrapper::FLAG_EXECUTE)
+                .add_argument(execution.executable)
+                .add_argument(cmd::wrapper::FLAG_COMMAND)
+                .add_arguments(execution.arguments.begin(), execution.arguments.end())
+                .set_environment(environment(execution.environment));
+    }
+
+    std::map<std::string, std::string>
+    SeccompSession::environment(const std::map<std::string, std::string> &env) const
+    {
+        // the build processes report nothing themselves; only the session
+        // token travels with the root command, for the remote collector.
+        std::map<std::string, std::string> copy(env);
+        if (!session_token_.empty()) {
+            copy[cmd::wrapper::KEY_TOKEN] = session_token_;
+        }
+        return copy;
+    }
+
+    void SeccompSession::start_supervision(Reporter &reporter)
+    {
+        running_.store(true, std::memory_order_release);
+        supervisor_ = std::thread([this, &reporter]() {
+            supervise_loop(reporter);
+        });
+    }
+
+    void SeccompSession::stop_supervision()
+    {
+        running_.store(false, std::memory_order_release);
+        if (supervisor_.joinable()) {
+            supervisor_.join();
+        }
+    }
+
+    void SeccompSession::supervise_loop(Reporter &reporter)
+    {
+        // the kernel tells how big the notification structures are; a
+        // newer kernel may use bigger ones than the build headers say.
+        seccomp_notif_sizes sizes = {};
+        if (syscall(__NR_seccomp, SECCOMP_GET_NOTIF_SIZES, 0, &sizes) != 0) {
+            spdlog::warn("Failed to query the seccomp notification sizes: {}", sys::error_string(errno));
+            return;
+        }
+        std::vector<char> request_buffer(std::max(sizeof(seccomp_notif), size_t(sizes.seccomp_notif)));
+        std::vector<char> response_buffer(std::max(sizeof(seccomp_notif_resp), size_t(sizes.seccomp_notif_resp)));
+        while (running_.load(std::memory_order_acquire)) {
+            pollfd poll_fd = { notify_fd_, POLLIN, 0 };
+            if (poll(&poll_fd, 1, 100) <= 0) {
+                // timeout or interrupt; check for the shutdown and retry.
+                continue;
+            }
+            auto *request = reinterpret_cast<seccomp_notif *>(request_buffer.data());
+            memset(request_buffer.data(), 0, request_buffer.size());
+            if (ioctl(notify_fd_, SECCOMP_IOCTL_NOTIF_RECV, request) != 0) {
+                if (errno == EINTR || errno == ENOENT) {
+                    // the trapped process got killed before the receive.
+                    continue;
+                }
+                spdlog::warn("Failed to receive a seccomp notification: {}", sys::error_string(errno));
+                break;
+            }
+            report(reporter, *request);
+            // let the trapped execve call continue, whatever the report
+            // did; the supervision shall never break the build.
+            auto *response = reinterpret_cast<seccomp_notif_resp *>(response_buffer.data());
+            memset(response_buffer.data(), 0, response_buffer.size());
+            response->id = request->id;
+            response->flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+            if (ioctl(notify_fd_, SECCOMP_IOCTL_NOTIF_SEND, response) != 0 && errno != ENOENT) {
+                spdlog::debug("Failed to answer a seccomp notification: {}", sys::error_string(errno));
+            }
+        }
+    }
+
+    void SeccompSession::report(Reporter &reporter, const seccomp_notif &request) const
+    {
+        const pid_t pid = pid_t(request.pid);
+#ifdef __NR_execveat
+        const bool at_call = (request.data.nr == __NR_execveat);
+#else
+        const bool at_call = false;
+#endif
+        // the path and the argument vector live in the memory of the
+        // trapped process, still blocked in the execve call.
+        auto executable = read_string(pid, request.data.args[at_call ? 1 : 0]);
+        auto arguments = read_strings(pid, request.data.args[at_call ? 2 : 1]);
+        const auto working_dir = read_link(fmt::format("/proc/{}/cwd", pid));
+        const auto parent = parent_of(pid);
+        // the reads above are only authentic when the process still
+        // waits in the trapped call (and was not killed and replaced).
+        uint64_t id = request.id;
+        if (ioctl(notify_fd_, SECCOMP_IOCTL_NOTIF_ID_VALID, &id) != 0) {
+            return;
+        }
+        if (!executable || !arguments || working_dir.empty()) {
+            spdlog::debug("Failed to read the command of a trapped execve call. [pid: {}]", pid);
+            return;
+        }
+        // a relative path is against the working directory; an execveat
+        // call resolves it against its directory file descriptor.
+        fs::path resolved(executable.value());
+        if (resolved.is_relative()) {
+            const auto base = at_call
+                    ? read_link(fmt::format("/proc/{}/fd/{}", pid, int(request.data.args[0])))
+                    : working_dir;
+            if (!base.empty()) {
+                resolved = fs::path(base) / resolved;
+            }
+        }
+        // the environment is not read (its size would dominate the stop
+        // time), which is fine for the semantic analysis: it only needs
+        // the command itself.
+        rpc::Event event;
+        event.set_rid(make_reporter_id(ProcessId(pid)));
+        domain::hlc::stamp(event);
+        *event.mutable_timestamp() = google::protobuf::util::TimeUtil::GetCurrentTime();
+        auto &started = *event.mutable_started();
+        started.set_pid(pid);
+        started.set_ppid(parent);
+        auto &execution = *started.mutable_execution();
+        execution.set_executable(resolved.string());
+        execution.set_working_dir(working_dir);
+        for (auto &argument : arguments.value()) {
+            execution.add_arguments(std::move(argument));
+        }
+        reporter.report(event);
+    }
+}
@@ -0,0 +1,84 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "collect/Session.h"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+
+struct seccomp_notif;
+
+namespace ic {
+
+    // Intercepts the process executions with a seccomp filter and user
+    // space notification (seccomp unotify). The filter traps only the
+    // execve calls and is installed on the collector process before the
+    // build starts, so every descendant of the build inherits it. That
+    // covers statically linked tools, which the preload session misses,
+    // and does not depend on the PATH, which the wrapper session needs.
+    //
+    // A supervisor thread receives a notification for every execve call,
+    // reads the command from the memory of the trapped process, reports
+    // it, and lets the call continue. Only the execve call itself is
+    // blocked for the time of that read; every other syscall runs at
+    // full speed, unlike under a ptrace based tracer.
+    //
+    // Two caveats of the mechanism: the filter requires the no-new-privs
+    // flag, so set-uid programs (like sudo) do not elevate within the
+    // supervised build; and a process which outlives the collector gets
+    // an error on its execve calls, since nobody answers the
+    // notifications any more.
+    class SeccompSession : public ic::Session {
+    public:
+        SeccompSession(bool verbose, const std::string_view &executor, int notify_fd);
+        ~SeccompSession() override;
+
+        static rust::Result<Session::Ptr> from(const flags::Arguments&);
+
+        [[nodiscard]] rust::Result<ic::Execution> resolve(const ic::Execution &execution) const override;
+        [[nodiscard]] sys::Process::Builder supervise(const ic::Execution &execution) const override;
+        [[nodiscard]] std::map<std::string, std::string> environment(const std::map<std::string, std::string> &env) const override;
+
+        void start_supervision(Reporter &reporter) override;
+        void stop_supervision() override;
+
+        NON_DEFAULT_CONSTRUCTABLE(SeccompSession)
+        NON_COPYABLE_NOR_MOVABLE(SeccompSession)
+
+    private:
+        // Installs the filter on the calling process and returns the
+        // notification file descriptor.
+        static rust::Result<int> install_filter();
+
+        void supervise_loop(Reporter &reporter);
+        void report(Reporter &reporter, const seccomp_notif &request) const;
+
+    private:
+        bool verbose_;
+        std::string executor_;
+        int notify_fd_;
+        std::atomic<bool> running_;
+        std::thread supervisor_;
+    };
+}
@@ -33,9 +33,15 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <iterator>
+#include <limits>
+#include <optional>
 #include <utility>
 
+#include <unistd.h>
+
 namespace {
 
     struct Rule {
@@ -88,6 +94,105 @@ namespace {
         }
         return rust::Ok(std::move(result));
     }
+
+    using Mapping = std::map<std::string, fs::path>;
+
+    // The wrapper to compiler mapping is stable across builds: it only
+    // depends on the wrapper directory content, the PATH and the implicit
+    // make variables. Computing it costs a PATH search per wrapper, so
+    // the result is kept in a cache file, validated by a digest of those
+    // inputs, and reused while the compilers stay in place.
+
+    // Content digest of the mapping inputs. (FNV-1a.)
+    uint64_t mapping_digest(const char **envp, const std::string &wrapper_dir)
+    {
+        constexpr uint64_t PRIME = 0x100000001b3;
+        uint64_t hash = 0xcbf29ce484222325;
+        const auto mix = [&hash](const char *value) {
+            for (; (value != nullptr) && (*value != 0); ++value) {
+                hash = (hash ^ uint64_t(uint8_t(*value))) * PRIME;
+            }
+            hash = (hash ^ uint64_t(0)) * PRIME;
+        };
+        mix(wrapper_dir.c_str());
+        mix(el::env::get_env_value(envp, "PATH"));
+        for (const auto &implicit : IMPLICITS) {
+            mix(implicit.env);
+            mix(el::env::get_env_value(envp, implicit.env));
+        }
+        return hash;
+    }
+
+    // The cache file under the XDG cache directory. Empty when the
+    // environment names no usable cache location.
+    fs::path mapping_cache_file(const char **envp)
+    {
+        if (const char *cache = el::env::get_env_value(envp, "XDG_CACHE_HOME"); cache != nullptr) {
+            return fs::path(cache) / "bear" / "wrapper-mapping";
+        }
+        if (const char *home = el::env::get_env_value(envp, "HOME"); home != nullptr) {
+            return fs::path(home) / ".cache" / "bear" / "wrapper-mapping";
+        }
+        return fs::path();
+    }
+
+    // Reads the cached mapping back, when its digest matches and the
+    // mapped executables are still in place.
+    std::optional<std::pair<Mapping, Mapping>> read_mapping_cache(const fs::path &file, uint64_t digest)
+    {
+        if (file.empty()) {
+            return std::nullopt;
+        }
+        std::ifstream source(file);
+        uint64_t stored = 0;
+        if (!(source >> stored) || (stored != digest)) {
+            return std::nullopt;
+        }
+        source.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        Mapping mapping;
+        Mapping override;
+        std::string line;
+        while (std::getline(source, line)) {
+            const auto first = line.find('\t');
+            const auto second = line.find('\t', first + 1);
+            if ((first == std::string::npos) || (second == std::string::npos)) {
+                return std::nullopt;
+            }
+            const auto key = line.substr(first + 1, second - first - 1);
+            const auto value = line.substr(second + 1);
+            if (line.compare(0, first, "m") == 0) {
+                // a stale entry invalidates the whole cache.
+                if (::access(value.c_str(), X_OK) != 0) {
+                    return std::nullopt;
+                }
+                mapping[key] = fs::path(value);
+            } else if (line.compare(0, first, "o") == 0) {
+                override[key] = fs::path(value);
+            } else {
+                return std::nullopt;
+            }
+        }
+        return std::make_optional(std::make_pair(std::move(mapping), std::move(override)));
+    }
+
+    // Best effort: a failed write only costs the next run the PATH
+    // searches again.
+    void write_mapping_cache(const fs::path &file, uint64_t digest, const Mapping &mapping, const Mapping &override)
+    {
+        if (file.empty()) {
+            return;
+        }
+        std::error_code error_code;
+        fs::create_directories(file.parent_path(), error_code);
+        std::ofstream target(file);
+        target << digest << '\n';
+        for (const auto &[key, value] : mapping) {
+            target << "m\t" << key << '\t' << value.string() << '\n';
+        }
+        for (const auto &[key, value] : override) {
+            target << "o\t" << key << '\t' << value.string() << '\n';
+        }
+    }
 }
 
 namespace ic {
@@ -96,6 +201,22 @@ namespace ic {
     {
         const bool verbose = args.as_bool(flags::VERBOSE).unwrap_or(false);
         auto wrapper_dir = args.as_string(cmd::intercept::FLAG_WRAPPER_DIR);
+
+        // Reuse the mapping from a previous session when its inputs have
+        // not changed since.
+        if (wrapper_dir.is_ok()) {
+            const auto digest = mapping_digest(envp, std::string(wrapper_dir.unwrap()));
+            const auto file = mapping_cache_file(envp);
+            if (auto cached = read_mapping_cache(file, digest); cached.has_value()) {
+                spdlog::debug("wrapper mapping reused from cache: {}", file.string());
+                return rust::Ok(Session::Ptr(std::make_shared<WrapperSession>(
+                        verbose,
+                        std::string(wrapper_dir.unwrap()),
+                        std::move(cached->first),
+                        std::move(cached->second))));
+            }
+        }
+
         auto wrappers = wrapper_dir.and_then<std::list<fs::path>>(list_dir);
 
         auto mapping = wrappers
@@ -141,6 +262,7 @@ namespace ic {
                                 });
                     }
                 }
+                write_mapping_cache(mapping_cache_file(envp), mapping_digest(envp, std::string(wrapper_dir)), mapping, override);
                 return std::make_shared<WrapperSession>(verbose, std::string(wrapper_dir), std::move(mapping), std::move(override));
             });
     }
@@ -164,15 +286,20 @@ namespace ic {
     rust::Result<ic::Execution> WrapperSession::resolve(const ic::Execution &execution) const
     {
         spdlog::debug("trying to resolve for wrapper: {}", execution.executable.string());
+        return resolve(execution, update(execution.environment));
+    }
+
+    rust::Result<ic::Execution> WrapperSession::resolve(const ic::Execution &execution, const std::map<std::string, std::string> &environment) const
+    {
         return resolve(execution.executable)
-                .map<ic::Execution>([this, &execution](auto executable) {
+                .map<ic::Execution>([&execution, &environment](auto executable) {
                     auto arguments = execution.arguments;
                     arguments.front() = executable;
                     return ic::Execution{
                             fs::path(executable),
                             std::move(arguments),
                             fs::path(execution.working_dir),
-                            update(execution.environment)
+                            environment
                     };
                 });
     }
@@ -184,6 +311,11 @@ namespace ic {
                 .set_environment(set_up(execution.environment));
     }
 
+    std::map<std::string, std::string> WrapperSession::environment(const std::map<std::string, std::string> &env) const
+    {
+        return set_up(env);
+    }
+
     rust::Result<fs::path> WrapperSession::resolve(const fs::path &name) const
     {
         const auto &basename = name.filename();
@@ -209,6 +341,10 @@ namespace ic {
         if (const auto it = copy.find(cmd::wrapper::KEY_DESTINATION); it != copy.end()) {
             copy.erase(it);
         }
+        // remove the session token
+        if (const auto it = copy.find(cmd::wrapper::KEY_TOKEN); it != copy.end()) {
+            copy.erase(it);
+        }
         // remove all implicits
         for (const auto& override : override_) {
             if (auto it = copy.find(override.first); it != copy.end()) {
@@ -227,6 +363,9 @@ namespace ic {
         }
         // sets the server address to wrappers
         environment[cmd::wrapper::KEY_DESTINATION] = *session_locator_;
+        if (!session_token_.empty()) {
+            environment[cmd::wrapper::KEY_TOKEN] = session_token_;
+        }
         // change PATH to put the wrapper directory at the front.
         if (auto it = environment.find("PATH"); it != environment.end()) {
             it->second = keep_front_in_path(wrapper_dir_, it->second);
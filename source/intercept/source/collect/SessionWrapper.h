@@ -34,7 +34,9 @@ namespace ic {
         static rust::Result<Session::Ptr> from(const flags::Arguments &args, const char **envp);
 
         [[nodiscard]] rust::Result<ic::Execution> resolve(const ic::Execution &execution) const override;
+        [[nodiscard]] rust::Result<ic::Execution> resolve(const ic::Execution &execution, const std::map<std::string, std::string> &environment) const override;
         [[nodiscard]] sys::Process::Builder supervise(const ic::Execution &execution) const override;
+        [[nodiscard]] std::map<std::string, std::string> environment(const std::map<std::string, std::string> &env) const override;
 
         NON_DEFAULT_CONSTRUCTABLE(WrapperSession)
         NON_COPYABLE_NOR_MOVABLE(WrapperSession)
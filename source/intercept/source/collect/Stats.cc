@@ -0,0 +1,235 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/Stats.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "intercept/intercept-forward.h"
+
+#include <google/protobuf/util/time_util.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace db = ic::collect::db;
+
+namespace {
+
+    // The duration histogram buckets, decade sized. The last bucket
+    // collects everything above the named ones.
+    constexpr int64_t HISTOGRAM_LIMITS[] = {
+            1000,           // 1 ms
+            10000,          // 10 ms
+            100000,         // 100 ms
+            1000000,        // 1 s
+            10000000,       // 10 s
+            100000000,      // 100 s
+    };
+    constexpr const char *HISTOGRAM_LABELS[] = {
+            "< 1 ms", "< 10 ms", "< 100 ms", "< 1 s", "< 10 s", "< 100 s", ">= 100 s",
+    };
+    constexpr size_t HISTOGRAM_BUCKETS = std::size(HISTOGRAM_LIMITS) + 1;
+
+    size_t histogram_bucket(int64_t duration) {
+        for (size_t index = 0; index < std::size(HISTOGRAM_LIMITS); ++index) {
+            if (duration < HISTOGRAM_LIMITS[index]) {
+                return index;
+            }
+        }
+        return std::size(HISTOGRAM_LIMITS);
+    }
+
+    struct BinaryStats {
+        size_t count = 0;
+        int64_t total = 0;      // microseconds
+        int64_t longest = 0;    // microseconds
+        uint64_t peak_rss = 0;  // kilobytes
+    };
+
+    std::string seconds(int64_t duration) {
+        return fmt::format("{:.3f}s", double(duration) / 1e6);
+    }
+
+    std::string megabytes(uint64_t kilobytes) {
+        return fmt::format("{} MB", kilobytes / 1024);
+    }
+}
+
+namespace ic {
+
+    rust::Result<int> StatsCommand::execute() const
+    {
+        return db::EventsDatabaseReader::from(input_)
+                .and_then<int>([](const auto &reader) -> rust::Result<int> {
+                    size_t started = 0;
+                    size_t terminated = 0;
+                    size_t signalled = 0;
+                    // one in this many executions was persisted; above one
+                    // the totals are extrapolated.
+                    uint32_t sample = 1;
+                    // the resource usage summed over the terminated
+                    // events which carried one.
+                    size_t with_usage = 0;
+                    uint64_t user_time = 0;      // microseconds
+                    uint64_t system_time = 0;    // microseconds
+                    // the executions waiting for their termination event.
+                    std::map<uint64_t, std::pair<int64_t, std::string>> open;
+                    std::map<std::string, BinaryStats> binaries;
+                    std::vector<std::pair<int64_t, int64_t>> intervals;
+                    size_t histogram[HISTOGRAM_BUCKETS] = {};
+
+                    for (auto event = reader->next(); event.has_value(); event = reader->next()) {
+                        if (event->is_err()) {
+                            spdlog::warn("Reading events failed: {}", event->unwrap_err().what());
+                            break;
+                        }
+                        const auto &current = *event->unwrap();
+                        const auto timestamp =
+                                google::protobuf::util::TimeUtil::TimestampToMicroseconds(current.timestamp());
+                        if (current.has_started()) {
+                            ++started;
+                            open.emplace(current.rid(),
+                                         std::make_pair(timestamp, current.started().execution().executable()));
+                        } else if (current.has_terminated()) {
+                            ++terminated;
+                            const auto it = open.find(current.rid());
+                            if (it == open.end()) {
+                                continue;
+                            }
+                            const auto duration = timestamp - it->second.first;
+                            auto &binary = binaries[it->second.second];
+                            ++binary.count;
+                            binary.total += duration;
+                            binary.longest = std::max(binary.longest, duration);
+                            if (current.terminated().has_usage()) {
+                                const auto &usage = current.terminated().usage();
+                                ++with_usage;
+                                user_time += usage.user_time_usec();
+                                system_time += usage.system_time_usec();
+                                binary.peak_rss = std::max(binary.peak_rss, usage.max_rss_kb());
+                            }
+                            ++histogram[histogram_bucket(duration)];
+                            intervals.emplace_back(it->second.first, timestamp);
+                            open.erase(it);
+                        } else if (current.has_signalled()) {
+                            ++signalled;
+                        } else if (current.has_sampling()) {
+                            sample = std::max(sample, current.sampling().rate());
+                        }
+                    }
+
+                    fmt::print("events:          {} (started: {}, terminated: {}, signalled: {})\n",
+                               started + terminated + signalled, started, terminated, signalled);
+                    if (sample > 1) {
+                        fmt::print("sampled:         one in {} executions recorded, ~{} executions estimated\n",
+                                   sample, started * sample);
+                    }
+                    if (!open.empty()) {
+                        fmt::print("unfinished:      {} executions without termination event\n", open.size());
+                    }
+                    if (intervals.empty()) {
+                        fmt::print("no finished executions.\n");
+                        return rust::Ok(EXIT_SUCCESS);
+                    }
+
+                    // The wall time spans from the first start to the last end,
+                    // the process time is the sum of all execution durations.
+                    // Their ratio is the average parallelism; the peak comes
+                    // from sweeping the interval boundaries in time order.
+                    int64_t process_time = 0;
+                    std::vector<std::pair<int64_t, int>> boundaries;
+                    boundaries.reserve(intervals.size() * 2);
+                    for (const auto &[begin, end] : intervals) {
+                        process_time += end - begin;
+                        boundaries.emplace_back(begin, +1);
+                        boundaries.emplace_back(end, -1);
+                    }
+                    std::sort(boundaries.begin(), boundaries.end());
+                    int active = 0;
+                    int peak = 0;
+                    for (const auto &[_, step] : boundaries) {
+                        active += step;
+                        peak = std::max(peak, active);
+                    }
+                    const auto wall_time = boundaries.back().first - boundaries.front().first;
+                    fmt::print("wall time:       {}\n", seconds(wall_time));
+                    fmt::print("process time:    {}\n", seconds(process_time));
+                    if (with_usage > 0) {
+                        fmt::print("cpu time:        {} user, {} system ({} of {} executions reported usage)\n",
+                                   seconds(int64_t(user_time)), seconds(int64_t(system_time)),
+                                   with_usage, terminated);
+                    }
+                    fmt::print("parallelism:     {:.2f} average, {} peak\n",
+                               (wall_time > 0) ? double(process_time) / double(wall_time) : 0.0, peak);
+
+                    fmt::print("\nduration histogram:\n");
+                    for (size_t index = 0; index < HISTOGRAM_BUCKETS; ++index) {
+                        fmt::print("{:>12}  {}\n", HISTOGRAM_LABELS[index], histogram[index]);
+                    }
+
+                    fmt::print("\nbinaries (by total time):\n");
+                    // the memory column appears when the events carry
+                    // resource usage (older databases have none).
+                    if (with_usage > 0) {
+                        fmt::print("{:>8}  {:>12}  {:>10}  {:>10}  {:>10}  binary\n",
+                                   "count", "total", "mean", "longest", "peak rss");
+                    } else {
+                        fmt::print("{:>8}  {:>12}  {:>10}  {:>10}  binary\n", "count", "total", "mean", "longest");
+                    }
+                    std::vector<std::pair<std::string, BinaryStats>> ordered(binaries.begin(), binaries.end());
+                    std::sort(ordered.begin(), ordered.end(),
+                              [](const auto &lhs, const auto &rhs) { return lhs.second.total > rhs.second.total; });
+                    for (const auto &[name, stats] : ordered) {
+                        if (with_usage > 0) {
+                            fmt::print("{:>8}  {:>12}  {:>10}  {:>10}  {:>10}  {}\n",
+                                       stats.count,
+                                       seconds(stats.total),
+                                       seconds(stats.total / int64_t(stats.count)),
+                                       seconds(stats.longest),
+                                       megabytes(stats.peak_rss),
+                                       name);
+                        } else {
+                            fmt::print("{:>8}  {:>12}  {:>10}  {:>10}  {}\n",
+                                       stats.count,
+                                       seconds(stats.total),
+                                       seconds(stats.total / int64_t(stats.count)),
+                                       seconds(stats.longest),
+                                       name);
+                        }
+                    }
+                    return rust::Ok(EXIT_SUCCESS);
+                });
+    }
+
+    Stats::Stats(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("stats", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Stats::command(const flags::Arguments &args, const char **) const {
+        return args.as_string(cmd::stats::FLAG_INPUT)
+                .map<ps::CommandPtr>([](auto input) {
+                    return std::make_unique<StatsCommand>(fs::path(input));
+                });
+    }
+}
@@ -0,0 +1,164 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "collect/Trace.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "intercept/intercept-forward.h"
+
+#include <google/protobuf/util/time_util.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+
+namespace db = ic::collect::db;
+
+namespace {
+
+    // Escapes a string for a JSON string literal.
+    std::string json_escape(const std::string &value) {
+        std::string result;
+        result.reserve(value.size());
+        for (const char character : value) {
+            switch (character) {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if (uint8_t(character) < 0x20) {
+                        result += fmt::format("\\u{:04x}", character);
+                    } else {
+                        result += character;
+                    }
+            }
+        }
+        return result;
+    }
+
+    // A started event waiting for its terminated pair.
+    struct OpenExecution {
+        int64_t start;          // microseconds
+        uint32_t pid;
+        uint32_t ppid;
+        std::string name;       // the basename of the executable
+        std::string command;    // the full command line
+    };
+}
+
+namespace ic {
+
+    rust::Result<int> TraceCommand::execute() const
+    {
+        return db::EventsDatabaseReader::from(input_)
+                .and_then<int>([this](const auto &reader) -> rust::Result<int> {
+                    std::ofstream target(output_);
+                    if (!target.is_open()) {
+                        return rust::Err(std::runtime_error(
+                                fmt::format("Failed to open file: {}", output_.string())));
+                    }
+                    target << "{\"traceEvents\":[\n";
+
+                    std::map<uint64_t, OpenExecution> open;
+                    size_t count = 0;
+                    // The first timestamp of the database is the time base, so
+                    // the trace starts at zero instead of the UNIX epoch.
+                    int64_t base = 0;
+                    bool base_known = false;
+                    for (auto event = reader->next(); event.has_value(); event = reader->next()) {
+                        if (event->is_err()) {
+                            spdlog::warn("Reading events failed: {}", event->unwrap_err().what());
+                            break;
+                        }
+                        const auto &current = *event->unwrap();
+                        const auto timestamp =
+                                google::protobuf::util::TimeUtil::TimestampToMicroseconds(current.timestamp());
+                        if (!base_known) {
+                            base = timestamp;
+                            base_known = true;
+                        }
+                        if (current.has_started()) {
+                            const auto &execution = current.started().execution();
+                            std::string command;
+                            for (const auto &argument : execution.arguments()) {
+                                if (!command.empty()) {
+                                    command += ' ';
+                                }
+                                command += argument;
+                            }
+                            open.emplace(current.rid(), OpenExecution{
+                                    timestamp,
+                                    current.started().pid(),
+                                    current.started().ppid(),
+                                    fs::path(execution.executable()).filename().string(),
+                                    std::move(command)
+                            });
+                        } else if (current.has_terminated()) {
+                            const auto it = open.find(current.rid());
+                            if (it == open.end()) {
+                                continue;
+                            }
+                            const auto &execution = it->second;
+                            // Complete events, grouped by the parent process:
+                            // the children of the same build tool share a track
+                            // group, which makes the serialization visible.
+                            target << fmt::format(
+                                    "{}{{\"ph\":\"X\",\"name\":\"{}\",\"cat\":\"process\",\"ts\":{},\"dur\":{},\"pid\":{},\"tid\":{},\"args\":{{\"cmd\":\"{}\",\"status\":{}}}}}",
+                                    (count == 0) ? "" : ",\n",
+                                    json_escape(execution.name),
+                                    execution.start - base,
+                                    timestamp - execution.start,
+                                    execution.ppid,
+                                    execution.pid,
+                                    json_escape(execution.command),
+                                    current.terminated().status());
+                            ++count;
+                            open.erase(it);
+                        }
+                    }
+                    if (!open.empty()) {
+                        spdlog::warn("Executions without termination event are not in the trace. [count: {}]", open.size());
+                    }
+                    target << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+                    spdlog::debug("trace events written. [size: {}]", count);
+                    return rust::Ok(EXIT_SUCCESS);
+                });
+    }
+
+    Trace::Trace(const ps::ApplicationLogConfig& log_config) noexcept
+            : ps::SubcommandFromArgs("trace", log_config)
+    { }
+
+    rust::Result<ps::CommandPtr> Trace::command(const flags::Arguments &args, const char **) const {
+        const auto input = args.as_string(cmd::trace::FLAG_INPUT)
+                .map<fs::path>([](auto value) { return fs::path(value); });
+        const auto output = args.as_string(cmd::trace::FLAG_OUTPUT)
+                .map<fs::path>([](auto value) { return fs::path(value); });
+
+        return rust::merge(input, output)
+                .map<ps::CommandPtr>([](auto tuple) {
+                    const auto&[input, output] = tuple;
+                    return std::make_unique<TraceCommand>(input, output);
+                });
+    }
+}
@@ -0,0 +1,53 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libmain/SubcommandFromArgs.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace ic {
+
+    // Converts an events database into the Chrome trace event format,
+    // which chrome://tracing and the Perfetto UI can open. Every captured
+    // process becomes a complete event on a track derived from its parent
+    // process, so the build timeline (and its serialization points) are
+    // visible without running a separate profiler.
+    struct TraceCommand : ps::Command {
+
+        TraceCommand(fs::path input, fs::path output)
+                : ps::Command()
+                , input_(std::move(input))
+                , output_(std::move(output))
+        { }
+
+        [[nodiscard]] rust::Result<int> execute() const override;
+
+        NON_DEFAULT_CONSTRUCTABLE(TraceCommand)
+        NON_COPYABLE_NOR_MOVABLE(TraceCommand)
+
+    private:
+        fs::path input_;
+        fs::path output_;
+    };
+}
@@ -0,0 +1,141 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__aarch64__)
+#if __has_include(<arm_acle.h>)
+#include <arm_acle.h>
+#define HAS_ARM_CRC_INTRINSICS
+#endif
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+namespace {
+
+    constexpr uint32_t POLYNOMIAL = 0x82f63b78u;
+
+    // The portable implementation: one table lookup per byte. Slow next
+    // to the hardware loop, but it only runs on processors without the
+    // CRC instructions.
+    uint32_t crc32c_sw(std::string_view bytes) noexcept {
+        static const auto table = []() {
+            std::array<uint32_t, 256> result {};
+            for (uint32_t index = 0; index < result.size(); ++index) {
+                uint32_t value = index;
+                for (int bit = 0; bit < 8; ++bit) {
+                    value = (value >> 1u) ^ ((value & 1u) ? POLYNOMIAL : 0u);
+                }
+                result[index] = value;
+            }
+            return result;
+        }();
+        uint32_t crc = ~uint32_t(0);
+        for (const char byte : bytes) {
+            crc = (crc >> 8u) ^ table[(crc ^ uint8_t(byte)) & 0xffu];
+        }
+        return ~crc;
+    }
+
+#if defined(__x86_64__)
+
+    // The SSE4.2 CRC instructions. The function carries its own target
+    // attribute, so the rest of the binary stays runnable on processors
+    // without the extension; the dispatch below only calls it when the
+    // processor reports the support.
+    __attribute__((target("sse4.2")))
+    uint32_t crc32c_hw(std::string_view bytes) noexcept {
+        uint64_t crc = ~uint32_t(0);
+        const char *it = bytes.data();
+        size_t remaining = bytes.size();
+        while (remaining >= sizeof(uint64_t)) {
+            uint64_t chunk;
+            std::memcpy(&chunk, it, sizeof(chunk));
+            crc = __builtin_ia32_crc32di(crc, chunk);
+            it += sizeof(chunk);
+            remaining -= sizeof(chunk);
+        }
+        while (remaining > 0) {
+            crc = __builtin_ia32_crc32qi(uint32_t(crc), uint8_t(*it));
+            ++it;
+            --remaining;
+        }
+        return ~uint32_t(crc);
+    }
+
+    bool crc32c_hw_supported() noexcept {
+        return __builtin_cpu_supports("sse4.2");
+    }
+
+#define HAS_CRC32C_HW
+
+#elif defined(__aarch64__) && defined(HAS_ARM_CRC_INTRINSICS)
+
+    // The CRC extension of ARMv8. Optional below ARMv8.1, hence the
+    // runtime detection through the hardware capability bits.
+    __attribute__((target("+crc")))
+    uint32_t crc32c_hw(std::string_view bytes) noexcept {
+        uint32_t crc = ~uint32_t(0);
+        const char *it = bytes.data();
+        size_t remaining = bytes.size();
+        while (remaining >= sizeof(uint64_t)) {
+            uint64_t chunk;
+            std::memcpy(&chunk, it, sizeof(chunk));
+            crc = __crc32cd(crc, chunk);
+            it += sizeof(chunk);
+            remaining -= sizeof(chunk);
+        }
+        while (remaining > 0) {
+            crc = __crc32cb(crc, uint8_t(*it));
+            ++it;
+            --remaining;
+        }
+        return ~crc;
+    }
+
+    bool crc32c_hw_supported() noexcept {
+#if defined(__linux__) && defined(HWCAP_CRC32)
+        return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+        return false;
+#endif
+    }
+
+#define HAS_CRC32C_HW
+
+#endif
+}
+
+namespace ic::collect::db {
+
+    uint32_t crc32c(std::string_view bytes) noexcept {
+#if defined(HAS_CRC32C_HW)
+        static const bool hardware = crc32c_hw_supported();
+        return hardware ? crc32c_hw(bytes) : crc32c_sw(bytes);
+#else
+        return crc32c_sw(bytes);
+#endif
+    }
+}
@@ -0,0 +1,35 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace ic::collect::db {
+
+    // CRC32C (the Castagnoli polynomial) of the given bytes. The events
+    // database stamps every binary record with it, so the check shall
+    // cost next to nothing: when the processor has CRC instructions
+    // (SSE4.2 on x86, the CRC extension of ARMv8), the hot loop is one
+    // instruction per eight bytes. The support is detected once at the
+    // first call; without it a table driven loop computes the same
+    // value, so the files stay portable between the machines.
+    [[nodiscard]] uint32_t crc32c(std::string_view bytes) noexcept;
+}
@@ -0,0 +1,161 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ic::collect::db {
+
+    // The events database is persisted in one of two wire formats.
+    //
+    // The binary format is the default. It starts with a fixed magic
+    // header (so the reader can detect it), followed by records, where
+    // each record is a 32 bit little-endian length prefix and the raw
+    // protobuf serialized `rpc::Event` message.
+    //
+    // The JSON format is the historical one: a JSON serialized event
+    // per line. It is kept for debugging purposes, because the content
+    // stays human readable.
+    enum class EventsDatabaseFormat {
+        BINARY,
+        JSON,
+    };
+
+    constexpr char EVENTS_DB_MAGIC[4] = {'B', 'E', 'A', 'R'};
+    constexpr size_t EVENTS_DB_MAGIC_SIZE = sizeof(EVENTS_DB_MAGIC);
+    constexpr uint32_t EVENTS_DB_VERSION = 1;
+    constexpr size_t EVENTS_DB_LENGTH_PREFIX_SIZE = sizeof(uint32_t);
+
+    // Version 2 marks a zstd compressed file. The header is the magic, this
+    // version number and a single byte for the payload format (0 for binary,
+    // 1 for JSON). The rest of the file is a sequence of zstd frames (one
+    // frame per write batch, so the reader can stream the decompression),
+    // which contain the records of the named payload format, without any
+    // further header.
+    constexpr uint32_t EVENTS_DB_VERSION_ZSTD = 2;
+    constexpr char EVENTS_DB_PAYLOAD_BINARY = 0;
+    constexpr char EVENTS_DB_PAYLOAD_JSON = 1;
+
+    // Version 3 extends the binary format with the session root: the
+    // header additionally carries a 32 bit little-endian length and the
+    // root directory path itself. Nearly every path of a build shares
+    // this prefix, so the path fields of the binary records are stored
+    // with the prefix replaced by the marker byte, and the reader
+    // restores them after parsing. A value which genuinely starts with
+    // the marker (or the escape) byte is written with the escape byte in
+    // front, which keeps the decoding unambiguous. Version 4 is the zstd
+    // compressed variant: the version 2 header, with the root (length
+    // and path) following the payload format byte, still outside of the
+    // compressed content.
+    constexpr uint32_t EVENTS_DB_VERSION_ROOTED = 3;
+    constexpr uint32_t EVENTS_DB_VERSION_ZSTD_ROOTED = 4;
+    constexpr char EVENTS_DB_ROOT_MARKER = '\x01';
+    constexpr char EVENTS_DB_ROOT_ESCAPE = '\x02';
+
+    // Version 5 extends the binary record framing with an integrity
+    // check: between the length prefix and the payload sits the CRC32C
+    // of the payload bytes (32 bit little-endian). Flaky storage (a
+    // network filesystem, a failing disk) can corrupt a record in
+    // place, which a plain parse error would report thousands of
+    // records later; the checksum pins the damage to the record, and
+    // the reader skips it and scans for the next intact record instead
+    // of failing the whole read. Version 6 is the rooted variant: the
+    // version 3 header with the checksummed framing. The compressed
+    // files keep the plain framing inside the frames; the zstd
+    // decompression detects a damaged frame itself.
+    constexpr uint32_t EVENTS_DB_VERSION_CRC = 5;
+    constexpr uint32_t EVENTS_DB_VERSION_CRC_ROOTED = 6;
+    constexpr size_t EVENTS_DB_CRC_SIZE = sizeof(uint32_t);
+
+    // Version 7 extends the binary format with a per file string table:
+    // the argument vectors repeat the same strings (flags, include
+    // directories) across many records, so the writer defines each
+    // repeated string once (a `Strings` event carrying the values and
+    // their ids) and the later occurrences store the string marker byte
+    // followed by the 16 hex digit id instead (the protobuf string
+    // fields insist on valid UTF-8, raw id bytes would not pass). The
+    // id is the content hash of the value (like the environment
+    // interning), so files written by independent writers concatenate
+    // safely. The
+    // escape byte of the rooted encoding covers the string marker too,
+    // which keeps the decoding unambiguous. Version 8 is the rooted
+    // variant. Both keep the checksummed framing of versions 5 and 6.
+    // The compressed files skip the table: the zstd frames squeeze the
+    // repeated strings themselves.
+    constexpr uint32_t EVENTS_DB_VERSION_STRINGS = 7;
+    constexpr uint32_t EVENTS_DB_VERSION_STRINGS_ROOTED = 8;
+    constexpr char EVENTS_DB_STRING_MARKER = '\x03';
+    constexpr size_t EVENTS_DB_STRING_REF_SIZE = 1 + 2 * sizeof(uint64_t);
+    // The table is windowed: once this many distinct values are
+    // remembered, the rest of the file stores its values verbatim,
+    // which bounds the memory of both the writer and the readers.
+    constexpr size_t EVENTS_DB_STRING_TABLE_LIMIT = 64 * 1024;
+
+    // The optional index is a sidecar file (the events file name with an
+    // ".idx" suffix), so the events file itself stays readable without
+    // it. The index starts with its own magic and version, a 32 bit
+    // little-endian entry count, and the entries: one per record of an
+    // uncompressed binary events file, each carrying the process identity
+    // and the absolute file offset of the record.
+    constexpr char EVENTS_DB_INDEX_MAGIC[4] = {'B', 'I', 'D', 'X'};
+    constexpr size_t EVENTS_DB_INDEX_MAGIC_SIZE = sizeof(EVENTS_DB_INDEX_MAGIC);
+    // Version 2 added the parent process identity to the entries, so the
+    // process tree queries need no scan of the events file. Version 3
+    // added the event timestamp, so a time window query selects its
+    // records on the index alone.
+    constexpr uint32_t EVENTS_DB_INDEX_VERSION = 3;
+    constexpr char EVENTS_DB_INDEX_SUFFIX[] = ".idx";
+
+    // The run summary is a sidecar file too (the events file name with a
+    // ".summary" suffix). A single JSON object with the event counters of
+    // the session: received, persisted, failed writes and refused RPC
+    // calls. A CI job can compare the counters to detect an incomplete
+    // events file right after the build, instead of discovering missing
+    // entries in the compilation database later.
+    constexpr char EVENTS_DB_SUMMARY_SUFFIX[] = ".summary";
+
+    // What kind of event a record holds. (Stored in the index, so a
+    // lookup can filter by event type without touching the records.)
+    enum class EventsDatabaseEventKind : uint32_t {
+        STARTED = 1,
+        TERMINATED = 2,
+        SIGNALLED = 3,
+        ENVIRONMENT = 4,
+        STRINGS = 5,
+        SAMPLING = 6,
+    };
+
+    // A single index entry: 64 bit rid, 64 bit offset, 32 bit length,
+    // pid, ppid and kind, then the 64 bit event timestamp (microseconds
+    // since the epoch), all little-endian. The offset points at the
+    // length prefix of the record in the events file. The pid and the
+    // ppid are zero when the writer has not seen the started event of
+    // the rid.
+    struct EventsDatabaseIndexEntry {
+        uint64_t rid;
+        uint64_t offset;
+        uint32_t length;
+        uint32_t pid;
+        uint32_t ppid;
+        EventsDatabaseEventKind kind;
+        uint64_t timestamp;
+    };
+}
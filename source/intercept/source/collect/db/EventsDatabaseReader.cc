@@ -18,36 +18,666 @@
  */
 
 #include "EventsDatabaseReader.h"
+#include "Crc32c.h"
+#include "PrefetchStream.h"
+#include "ZstdStream.h"
 #include "libsys/Errors.h"
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/util/json_util.h>
+#include <google/protobuf/util/time_util.h>
 #include <fmt/format.h>
+#include <spdlog/spdlog.h>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
 #include <fstream>
+#include <set>
+#include <sstream>
 #include <utility>
 
 using google::protobuf::util::JsonParseOptions;
 
 namespace {
+
     const JsonParseOptions parse_options;
+
+    uint32_t read_uint32(const char *bytes) {
+        return uint32_t(uint8_t(bytes[0]))
+                | (uint32_t(uint8_t(bytes[1])) << 8u)
+                | (uint32_t(uint8_t(bytes[2])) << 16u)
+                | (uint32_t(uint8_t(bytes[3])) << 24u);
+    }
+
+    uint64_t read_uint64(const char *bytes) {
+        return uint64_t(read_uint32(bytes)) | (uint64_t(read_uint32(bytes + 4)) << 32u);
+    }
+
+    // Does an event with the given timestamp and pid fall into the
+    // selection? The bounds are inclusive, an unset bound passes.
+    bool selected(const ic::collect::db::EventsDatabaseQuery &query, uint64_t timestamp, uint32_t pid) {
+        if (query.since && (timestamp < query.since.value())) {
+            return false;
+        }
+        if (query.until && (timestamp > query.until.value())) {
+            return false;
+        }
+        if (query.pids && ((pid < query.pids.value().first) || (pid > query.pids.value().second))) {
+            return false;
+        }
+        return true;
+    }
+
+    bool has_magic(const char *data, size_t size) {
+        return (size >= ic::collect::db::EVENTS_DB_MAGIC_SIZE) &&
+                std::equal(ic::collect::db::EVENTS_DB_MAGIC,
+                           ic::collect::db::EVENTS_DB_MAGIC + ic::collect::db::EVENTS_DB_MAGIC_SIZE,
+                           data);
+    }
+
+    // Read the session root of a rooted header from a stream: a 32 bit
+    // little-endian length and the root path itself.
+    bool read_root(std::istream &file, std::string &root) {
+        char bytes[sizeof(uint32_t)];
+        if (!file.read(bytes, sizeof(bytes))) {
+            return false;
+        }
+        const auto length = read_uint32(bytes);
+        root.resize(length);
+        return (length == 0) || bool(file.read(root.data(), length));
+    }
+
+    // Restore a path field of a rooted file: a leading marker byte
+    // stands for the session root, a leading escape byte protects a
+    // value which genuinely starts with one of the two bytes.
+    void decode_path(std::string &value, const std::string &root) {
+        if (value.empty()) {
+            return;
+        }
+        if (value.front() == ic::collect::db::EVENTS_DB_ROOT_MARKER) {
+            value.replace(0, 1, root);
+        } else if (value.front() == ic::collect::db::EVENTS_DB_ROOT_ESCAPE) {
+            value.erase(0, 1);
+        }
+    }
+
+    void decode_started_paths(rpc::Event &event, const std::string &root) {
+        auto *execution = event.mutable_started()->mutable_execution();
+        decode_path(*execution->mutable_executable(), root);
+        decode_path(*execution->mutable_working_dir(), root);
+        for (auto &argument : *execution->mutable_arguments()) {
+            decode_path(argument, root);
+        }
+    }
+
+    // A hand written parser for the JSON events this tool emits. The
+    // generic protobuf JSON parser goes through reflection and dynamic
+    // value trees, which dominates the reading of large JSON archives;
+    // this one walks the known event schema directly. It is deliberately
+    // conservative: anything outside the expected subset (like unicode
+    // escapes or unknown fields) makes it give up, and the caller falls
+    // back to the generic parser.
+    class FastEventParser {
+    public:
+        explicit FastEventParser(std::string_view input) noexcept
+                : it_(input.data())
+                , end_(input.data() + input.size())
+        { }
+
+        // Returns false when the input is outside of the supported subset.
+        // The event may be partially filled then, the caller shall reset it.
+        [[nodiscard]] bool parse(rpc::Event &event) noexcept {
+            if (!parse_event(event)) {
+                return false;
+            }
+            skip_space();
+            return it_ == end_;
+        }
+
+    private:
+        void skip_space() noexcept {
+            while ((it_ != end_) && ((*it_ == ' ') || (*it_ == '\t') || (*it_ == '\n') || (*it_ == '\r'))) {
+                ++it_;
+            }
+        }
+
+        bool consume(const char expected) noexcept {
+            skip_space();
+            if ((it_ != end_) && (*it_ == expected)) {
+                ++it_;
+                return true;
+            }
+            return false;
+        }
+
+        bool peek(const char expected) noexcept {
+            skip_space();
+            return (it_ != end_) && (*it_ == expected);
+        }
+
+        bool parse_string(std::string &output) noexcept {
+            if (!consume('"')) {
+                return false;
+            }
+            output.clear();
+            while (it_ != end_) {
+                const char current = *it_++;
+                if (current == '"') {
+                    return true;
+                }
+                if (current == '\\') {
+                    if (it_ == end_) {
+                        return false;
+                    }
+                    switch (*it_++) {
+                        case '"': output.push_back('"'); break;
+                        case '\\': output.push_back('\\'); break;
+                        case '/': output.push_back('/'); break;
+                        case 'b': output.push_back('\b'); break;
+                        case 'f': output.push_back('\f'); break;
+                        case 'n': output.push_back('\n'); break;
+                        case 'r': output.push_back('\r'); break;
+                        case 't': output.push_back('\t'); break;
+                        // unicode escapes go to the generic parser.
+                        default: return false;
+                    }
+                } else {
+                    output.push_back(current);
+                }
+            }
+            return false;
+        }
+
+        // Accepts both the bare number and the quoted form; protobuf
+        // prints 64 bit integers as JSON strings.
+        bool parse_uint64(uint64_t &value) noexcept {
+            const bool quoted = peek('"');
+            if (quoted) {
+                ++it_;
+            }
+            if ((it_ == end_) || (*it_ < '0') || (*it_ > '9')) {
+                return false;
+            }
+            value = 0;
+            while ((it_ != end_) && ('0' <= *it_) && (*it_ <= '9')) {
+                value = (value * 10) + uint64_t(*it_ - '0');
+                ++it_;
+            }
+            return quoted ? ((it_ != end_) && (*it_++ == '"')) : true;
+        }
+
+        bool parse_int64(int64_t &value) noexcept {
+            const bool quoted = peek('"');
+            if (quoted) {
+                ++it_;
+            }
+            bool negative = false;
+            if ((it_ != end_) && (*it_ == '-')) {
+                negative = true;
+                ++it_;
+            }
+            if ((it_ == end_) || (*it_ < '0') || (*it_ > '9')) {
+                return false;
+            }
+            uint64_t magnitude = 0;
+            while ((it_ != end_) && ('0' <= *it_) && (*it_ <= '9')) {
+                magnitude = (magnitude * 10) + uint64_t(*it_ - '0');
+                ++it_;
+            }
+            value = negative ? -int64_t(magnitude) : int64_t(magnitude);
+            return quoted ? ((it_ != end_) && (*it_++ == '"')) : true;
+        }
+
+        template <typename Handler>
+        bool parse_object(Handler &&handler) noexcept {
+            if (!consume('{')) {
+                return false;
+            }
+            if (consume('}')) {
+                return true;
+            }
+            for (;;) {
+                std::string key;
+                if (!parse_string(key) || !consume(':')) {
+                    return false;
+                }
+                if (!handler(key)) {
+                    return false;
+                }
+                if (consume(',')) {
+                    continue;
+                }
+                return consume('}');
+            }
+        }
+
+        bool parse_map(google::protobuf::Map<std::string, std::string> &variables) noexcept {
+            return parse_object([this, &variables](const std::string &key) {
+                return parse_string(variables[key]);
+            });
+        }
+
+        bool parse_execution(rpc::Execution &execution) noexcept {
+            return parse_object([this, &execution](const std::string &key) {
+                if (key == "executable") {
+                    return parse_string(*execution.mutable_executable());
+                }
+                if (key == "arguments") {
+                    if (!consume('[')) {
+                        return false;
+                    }
+                    if (consume(']')) {
+                        return true;
+                    }
+                    for (;;) {
+                        if (!parse_string(*execution.add_arguments())) {
+                            return false;
+                        }
+                        if (consume(',')) {
+                            continue;
+                        }
+                        return consume(']');
+                    }
+                }
+                if ((key == "working_dir") || (key == "workingDir")) {
+                    return parse_string(*execution.mutable_working_dir());
+                }
+                if (key == "environment") {
+                    return parse_map(*execution.mutable_environment());
+                }
+                if ((key == "environment_id") || (key == "environmentId")) {
+                    uint64_t value = 0;
+                    if (!parse_uint64(value)) {
+                        return false;
+                    }
+                    execution.set_environment_id(value);
+                    return true;
+                }
+                return false;
+            });
+        }
+
+        bool parse_started(rpc::Event::Started &started) noexcept {
+            return parse_object([this, &started](const std::string &key) {
+                if (key == "execution") {
+                    return parse_execution(*started.mutable_execution());
+                }
+                if (key == "pid") {
+                    uint64_t value = 0;
+                    if (!parse_uint64(value)) {
+                        return false;
+                    }
+                    started.set_pid(uint32_t(value));
+                    return true;
+                }
+                if (key == "ppid") {
+                    uint64_t value = 0;
+                    if (!parse_uint64(value)) {
+                        return false;
+                    }
+                    started.set_ppid(uint32_t(value));
+                    return true;
+                }
+                return false;
+            });
+        }
+
+        bool parse_environment(rpc::Event::Environment &environment) noexcept {
+            return parse_object([this, &environment](const std::string &key) {
+                if (key == "id") {
+                    uint64_t value = 0;
+                    if (!parse_uint64(value)) {
+                        return false;
+                    }
+                    environment.set_id(value);
+                    return true;
+                }
+                if (key == "variables") {
+                    return parse_map(*environment.mutable_variables());
+                }
+                return false;
+            });
+        }
+
+        bool parse_event(rpc::Event &event) noexcept {
+            return parse_object([this, &event](const std::string &key) {
+                if (key == "rid") {
+                    uint64_t value = 0;
+                    if (!parse_uint64(value)) {
+                        return false;
+                    }
+                    event.set_rid(value);
+                    return true;
+                }
+                if (key == "timestamp") {
+                    std::string value;
+                    return parse_string(value)
+                           && google::protobuf::util::TimeUtil::FromString(value, event.mutable_timestamp());
+                }
+                if (key == "started") {
+                    return parse_started(*event.mutable_started());
+                }
+                if (key == "terminated") {
+                    auto &terminated = *event.mutable_terminated();
+                    return parse_object([this, &terminated](const std::string &member) {
+                        if (member == "status") {
+                            int64_t value = 0;
+                            if (!parse_int64(value)) {
+                                return false;
+                            }
+                            terminated.set_status(value);
+                            return true;
+                        }
+                        return false;
+                    });
+                }
+                if (key == "signalled") {
+                    auto &signalled = *event.mutable_signalled();
+                    return parse_object([this, &signalled](const std::string &member) {
+                        if (member == "number") {
+                            int64_t value = 0;
+                            if (!parse_int64(value)) {
+                                return false;
+                            }
+                            signalled.set_number(int32_t(value));
+                            return true;
+                        }
+                        return false;
+                    });
+                }
+                if (key == "environment") {
+                    return parse_environment(*event.mutable_environment());
+                }
+                return false;
+            });
+        }
+
+    private:
+        const char *it_;
+        const char *end_;
+    };
+
+    bool read_varint(const char *&it, const char *const end, uint64_t &value) {
+        value = 0;
+        for (unsigned int shift = 0; (it != end) && (shift < 64); shift += 7) {
+            const auto byte = uint8_t(*it++);
+            value |= uint64_t(byte & 0x7fu) << shift;
+            if ((byte & 0x80u) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The field number of the event oneof a binary record carries. Walks
+    // the top level wire format tags only, nothing is parsed. Returns
+    // zero when the record holds no such field or is not well formed
+    // (the caller shall hand those to the real parser).
+    uint32_t binary_event_kind(std::string_view record) {
+        const char *it = record.data();
+        const char *const end = it + record.size();
+        while (it != end) {
+            uint64_t tag = 0;
+            if (!read_varint(it, end, tag)) {
+                return 0;
+            }
+            const auto field = uint32_t(tag >> 3u);
+            switch (tag & 7u) {
+                case 0: {
+                    uint64_t ignored = 0;
+                    if (!read_varint(it, end, ignored)) {
+                        return 0;
+                    }
+                    break;
+                }
+                case 1:
+                    if (size_t(end - it) < 8) {
+                        return 0;
+                    }
+                    it += 8;
+                    break;
+                case 2: {
+                    uint64_t length = 0;
+                    if (!read_varint(it, end, length) || (uint64_t(end - it) < length)) {
+                        return 0;
+                    }
+                    if ((field >= rpc::Event::kStartedFieldNumber) && (field <= rpc::Event::kEnvironmentFieldNumber)) {
+                        return field;
+                    }
+                    it += length;
+                    break;
+                }
+                case 5:
+                    if (size_t(end - it) < 4) {
+                        return 0;
+                    }
+                    it += 4;
+                    break;
+                default:
+                    return 0;
+            }
+        }
+        return 0;
+    }
+
+    // Allocate the event on an arena. Parsing an event touches the heap
+    // once per string, map node and sub message; the arena serves those
+    // from a few larger blocks instead. The arena lives as long as the
+    // event (the deleter owns it), so the callers see a plain EventPtr.
+    ic::collect::db::EventPtr create_arena_event() {
+        auto arena = std::make_unique<google::protobuf::Arena>();
+        auto *event = google::protobuf::Arena::CreateMessage<rpc::Event>(arena.get());
+        return ic::collect::db::EventPtr(
+                event,
+                [arena = arena.release()](rpc::Event *) { delete arena; });
+    }
 }
 
 namespace ic::collect::db {
 
     rust::Result<EventsDatabaseReader::Ptr> EventsDatabaseReader::from(const fs::path &path) {
-        std::unique_ptr<std::istream> file =
-                std::make_unique<std::fstream>(path, std::ios::in);
+        // The "-" file name stands for the standard input. It consumes the
+        // events as a producer process emits them.
+        if (path == "-") {
+            return from_stream(path, std::make_unique<std::istream>(std::cin.rdbuf()));
+        }
+        // Memory map the file when it's a regular file. The records are then
+        // accessed as zero-copy slices of the mapping. Everything else (like
+        // pipes) falls back to the stream based reading.
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            auto message = fmt::format("Events db open failed (file {}): {}", path.string(), sys::error_string(errno));
+            return rust::Err(std::runtime_error(message));
+        }
+        struct stat file_status {};
+        if ((fstat(fd, &file_status) == 0) && S_ISREG(file_status.st_mode) && (file_status.st_size > 0)) {
+            const size_t size = file_status.st_size;
+            void *const address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (address == MAP_FAILED) {
+                auto message = fmt::format("Events db mmap failed (file {}): {}", path.string(), sys::error_string(errno));
+                return rust::Err(std::runtime_error(message));
+            }
+            // Tell the kernel that the mapping is consumed front to back,
+            // so it can read ahead aggressively and drop the pages behind.
+            madvise(address, size, MADV_SEQUENTIAL);
+
+            const char *data = static_cast<const char *>(address);
+            auto format = EventsDatabaseFormat::JSON;
+            size_t cursor = 0;
+            std::string root;
+            bool checksum = false;
+            bool strings = false;
+            if (has_magic(data, size)) {
+                const uint32_t version = (size >= EVENTS_DB_MAGIC_SIZE + EVENTS_DB_LENGTH_PREFIX_SIZE)
+                        ? read_uint32(data + EVENTS_DB_MAGIC_SIZE)
+                        : 0;
+                if ((version == EVENTS_DB_VERSION_ZSTD) || (version == EVENTS_DB_VERSION_ZSTD_ROOTED)) {
+                    // Compressed files are consumed through the streaming
+                    // decompressor instead of record slicing.
+                    munmap(const_cast<char *>(data), size);
+                    return from_stream(path, std::make_unique<std::fstream>(path, std::ios::in | std::ios::binary));
+                }
+                if ((version != EVENTS_DB_VERSION) && (version != EVENTS_DB_VERSION_ROOTED)
+                        && (version != EVENTS_DB_VERSION_CRC) && (version != EVENTS_DB_VERSION_CRC_ROOTED)
+                        && (version != EVENTS_DB_VERSION_STRINGS) && (version != EVENTS_DB_VERSION_STRINGS_ROOTED)) {
+                    munmap(const_cast<char *>(data), size);
+                    auto message = fmt::format(
+                            "Events db read failed (from file {}): unsupported version {}",
+                            path.string(),
+                            version);
+                    return rust::Err(std::runtime_error(message));
+                }
+                format = EventsDatabaseFormat::BINARY;
+                checksum = (version != EVENTS_DB_VERSION) && (version != EVENTS_DB_VERSION_ROOTED);
+                strings = (version == EVENTS_DB_VERSION_STRINGS) || (version == EVENTS_DB_VERSION_STRINGS_ROOTED);
+                cursor = EVENTS_DB_MAGIC_SIZE + EVENTS_DB_LENGTH_PREFIX_SIZE;
+                if ((version == EVENTS_DB_VERSION_ROOTED) || (version == EVENTS_DB_VERSION_CRC_ROOTED)
+                        || (version == EVENTS_DB_VERSION_STRINGS_ROOTED)) {
+                    const auto root_length = (cursor + sizeof(uint32_t) <= size)
+                            ? size_t(read_uint32(data + cursor))
+                            : size;
+                    cursor += sizeof(uint32_t);
+                    if (cursor + root_length > size) {
+                        munmap(const_cast<char *>(data), size);
+                        auto message = fmt::format(
+                                "Events db read failed (from file {}): truncated header",
+                                path.string());
+                        return rust::Err(std::runtime_error(message));
+                    }
+                    root.assign(data + cursor, root_length);
+                    cursor += root_length;
+                }
+            }
+            std::shared_ptr<EventsDatabaseReader> result =
+                    std::make_shared<EventsDatabaseReader>(path, data, size, format, cursor, std::move(root), checksum, strings);
+            return rust::Ok(result);
+        }
+        close(fd);
+
+        return from_stream(path, std::make_unique<std::fstream>(path, std::ios::in | std::ios::binary));
+    }
+
+    rust::Result<EventsDatabaseReader::Ptr> EventsDatabaseReader::from_stream(const fs::path &path, StreamPtr file) {
+        // The stream inputs (pipes, the standard input, cold files) are
+        // consumed through the read ahead wrapper: a reader thread fills
+        // the next block while the records of the current one are parsed.
+        file = prefetch_stream(std::move(file));
+        // The format detection consumes the header bytes. Streams can not
+        // seek back (pipes), therefore the consumed bytes are carried over
+        // to the record reading when they are part of the first record.
+        char magic[EVENTS_DB_MAGIC_SIZE];
+        file->read(magic, EVENTS_DB_MAGIC_SIZE);
+        const auto magic_count = size_t(file->gcount());
+        auto format = EventsDatabaseFormat::JSON;
+        std::string carry;
+        std::string root;
+        bool checksum = false;
+        bool strings = false;
+        if ((magic_count == EVENTS_DB_MAGIC_SIZE) && has_magic(magic, EVENTS_DB_MAGIC_SIZE)) {
+            uint32_t version = 0;
+            char bytes[EVENTS_DB_LENGTH_PREFIX_SIZE];
+            if (file->read(bytes, EVENTS_DB_LENGTH_PREFIX_SIZE)) {
+                version = read_uint32(bytes);
+            }
+            if ((version == EVENTS_DB_VERSION_ZSTD) || (version == EVENTS_DB_VERSION_ZSTD_ROOTED)) {
+                char payload = EVENTS_DB_PAYLOAD_BINARY;
+                file->read(&payload, 1);
+                const auto inner_format = (payload == EVENTS_DB_PAYLOAD_JSON)
+                        ? EventsDatabaseFormat::JSON
+                        : EventsDatabaseFormat::BINARY;
+                // The root is part of the plain header, outside of the
+                // compressed content.
+                std::string root;
+                if ((version == EVENTS_DB_VERSION_ZSTD_ROOTED) && !read_root(*file, root)) {
+                    auto message = fmt::format(
+                            "Events db read failed (from file {}): truncated header",
+                            path.string());
+                    return rust::Err(std::runtime_error(message));
+                }
+                auto decompressed = zstd_decompress_stream(std::move(file));
+                if (decompressed == nullptr) {
+                    auto message = fmt::format(
+                            "Events db read failed (from file {}): zstd support is not built in",
+                            path.string());
+                    return rust::Err(std::runtime_error(message));
+                }
+                std::shared_ptr<EventsDatabaseReader> result =
+                        std::make_shared<EventsDatabaseReader>(path, std::move(decompressed), inner_format, std::string(), std::move(root), false, false);
+                return rust::Ok(result);
+            }
+            if ((version != EVENTS_DB_VERSION) && (version != EVENTS_DB_VERSION_ROOTED)
+                    && (version != EVENTS_DB_VERSION_CRC) && (version != EVENTS_DB_VERSION_CRC_ROOTED)
+                    && (version != EVENTS_DB_VERSION_STRINGS) && (version != EVENTS_DB_VERSION_STRINGS_ROOTED)) {
+                auto message = fmt::format(
+                        "Events db read failed (from file {}): unsupported version {}",
+                        path.string(),
+                        version);
+                return rust::Err(std::runtime_error(message));
+            }
+            if (((version == EVENTS_DB_VERSION_ROOTED) || (version == EVENTS_DB_VERSION_CRC_ROOTED)
+                        || (version == EVENTS_DB_VERSION_STRINGS_ROOTED))
+                    && !read_root(*file, root)) {
+                auto message = fmt::format(
+                        "Events db read failed (from file {}): truncated header",
+                        path.string());
+                return rust::Err(std::runtime_error(message));
+            }
+            format = EventsDatabaseFormat::BINARY;
+            checksum = (version != EVENTS_DB_VERSION) && (version != EVENTS_DB_VERSION_ROOTED);
+            strings = (version == EVENTS_DB_VERSION_STRINGS) || (version == EVENTS_DB_VERSION_STRINGS_ROOTED);
+        } else {
+            file->clear();
+            carry.assign(magic, magic_count);
+        }
         std::shared_ptr<EventsDatabaseReader> result =
-                std::make_shared<EventsDatabaseReader>(path, std::move(file));
+                std::make_shared<EventsDatabaseReader>(path, std::move(file), format, std::move(carry), std::move(root), checksum, strings);
         return rust::Ok(result);
     }
 
-    EventsDatabaseReader::EventsDatabaseReader(fs::path path, StreamPtr file) noexcept
+    EventsDatabaseReader::EventsDatabaseReader(fs::path path, const char *data, size_t size, EventsDatabaseFormat format, size_t cursor, std::string root, bool checksum, bool strings) noexcept
+            : path_(std::move(path))
+            , file_()
+            , data_(data)
+            , size_(size)
+            , cursor_(cursor)
+            , buffer_()
+            , carry_()
+            , format_(format)
+            , root_(std::move(root))
+            , checksum_(checksum)
+            , strings_(strings)
+            , index_loaded_(false)
+    { }
+
+    EventsDatabaseReader::EventsDatabaseReader(fs::path path, StreamPtr file, EventsDatabaseFormat format, std::string carry, std::string root, bool checksum, bool strings) noexcept
             : path_(std::move(path))
             , file_(std::move(file))
+            , data_(nullptr)
+            , size_(0)
+            , cursor_(0)
+            , buffer_()
+            , carry_(std::move(carry))
+            , format_(format)
+            , root_(std::move(root))
+            , checksum_(checksum)
+            , strings_(strings)
+            , index_loaded_(false)
     { }
 
+    EventsDatabaseReader::~EventsDatabaseReader() noexcept {
+        if (data_ != nullptr) {
+            munmap(const_cast<char *>(data_), size_);
+        }
+    }
+
     EventsDatabaseReader::Iterator EventsDatabaseReader::begin() noexcept {
         return EventsDatabaseReader::Iterator(*this, false);
     }
@@ -57,36 +687,559 @@ namespace ic::collect::db {
     }
 
     std::optional<rust::Result<EventPtr>> EventsDatabaseReader::next() noexcept {
-        const auto line = next_line();
-        if (line.has_value()) {
-            return line.value()
-                    .and_then<EventPtr>([this](const auto &line) {
-                        return from_json(line);
-                    });
+        // The writer interns the environments and the repeated strings:
+        // each distinct one is stored once as a definition event, and
+        // the started events refer to them. Resolve the references here,
+        // so the consumers see the full content and never the interning
+        // itself.
+        while (auto candidate = read_event()) {
+            if (candidate.value().is_err()) {
+                return candidate;
+            }
+            auto event = candidate.value().unwrap();
+            if (event->has_environment()) {
+                environments_[event->environment().id()] = event->environment().variables();
+                continue;
+            }
+            if (event->has_strings()) {
+                load_strings(event->strings());
+                continue;
+            }
+            resolve_environment(event);
+            return std::make_optional(rust::Ok(event));
         }
         return {};
     }
 
-    std::optional<rust::Result<std::string>> EventsDatabaseReader::next_line() noexcept {
-        std::string line;
-        if (std::getline(*file_, line)) {
-            return line.empty()
-                    ? std::optional<rust::Result<std::string>>()
-                    : std::make_optional(rust::Ok(std::move(line)));
+    std::optional<size_t> EventsDatabaseReader::mapped_size() const noexcept {
+        return (data_ != nullptr)
+               ? std::make_optional(size_)
+               : std::nullopt;
+    }
+
+    std::optional<uint64_t> EventsDatabaseReader::prefix_digest(const size_t length) const noexcept {
+        if ((data_ == nullptr) || (length > size_)) {
+            return std::nullopt;
+        }
+        // FNV-1a
+        uint64_t hash = 0xcbf29ce484222325;
+        for (size_t idx = 0; idx < length; ++idx) {
+            hash ^= uint8_t(data_[idx]);
+            hash *= 0x100000001b3;
+        }
+        return std::make_optional(hash);
+    }
+
+    void EventsDatabaseReader::resolve_environment(const EventPtr &event) noexcept {
+        if (event->has_started() && (event->started().execution().environment_id() != 0)) {
+            auto *execution = event->mutable_started()->mutable_execution();
+            if (const auto it = environments_.find(execution->environment_id()); it != environments_.end()) {
+                *execution->mutable_environment() = it->second;
+            }
+            execution->clear_environment_id();
+        }
+    }
+
+    // Fill the string table from a definition event. With a prefilter
+    // installed, a defined value which contains one of the needles gets
+    // its reference encoding added as a needle too: a record storing
+    // the value as a reference shall still match the raw byte scan.
+    void EventsDatabaseReader::load_strings(const rpc::Event::Strings &definition) noexcept {
+        const auto count = std::min(definition.ids_size(), definition.values_size());
+        for (int position = 0; position < count; ++position) {
+            const auto id = definition.ids(position);
+            const auto &value = definition.values(position);
+            if (!allowlist_.empty()
+                    && std::any_of(allowlist_.begin(), allowlist_.end(),
+                                   [&value](const auto &needle) { return value.find(needle) != std::string::npos; })) {
+                std::string reference(1, EVENTS_DB_STRING_MARKER);
+                for (size_t digit = 0; digit < 2 * sizeof(uint64_t); ++digit) {
+                    reference.push_back("0123456789abcdef"[(id >> (60u - 4u * digit)) & 0xfu]);
+                }
+                allowlist_.emplace_back(std::move(reference));
+            }
+            string_table_[id] = value;
+        }
+    }
+
+    // Replace the string table references of the started event with the
+    // defined values. (The root prefix decoding runs after this: the
+    // table stores the values in their root encoded form.)
+    void EventsDatabaseReader::resolve_strings(rpc::Event &event) const noexcept {
+        auto *execution = event.mutable_started()->mutable_execution();
+        const auto resolve = [this](std::string &value) {
+            if ((value.size() != EVENTS_DB_STRING_REF_SIZE) || (value.front() != EVENTS_DB_STRING_MARKER)) {
+                return;
+            }
+            uint64_t id = 0;
+            for (size_t digit = 1; digit < EVENTS_DB_STRING_REF_SIZE; ++digit) {
+                const char hex = value[digit];
+                if (('0' <= hex) && (hex <= '9')) {
+                    id = (id << 4u) | uint64_t(hex - '0');
+                } else if (('a' <= hex) && (hex <= 'f')) {
+                    id = (id << 4u) | uint64_t(hex - 'a' + 10);
+                } else {
+                    return;
+                }
+            }
+            if (const auto it = string_table_.find(id); it != string_table_.end()) {
+                value = it->second;
+            }
+        };
+        resolve(*execution->mutable_executable());
+        resolve(*execution->mutable_working_dir());
+        for (auto &argument : *execution->mutable_arguments()) {
+            resolve(argument);
+        }
+    }
+
+    void EventsDatabaseReader::prefilter(std::vector<std::string> allowlist) noexcept {
+        allowlist_ = std::move(allowlist);
+        // A rooted file stores the session root prefix of the path fields
+        // as a marker byte. Add the encoded variant of the affected
+        // needles, so the raw scan keeps its over-match guarantee.
+        if (!root_.empty()) {
+            const size_t given = allowlist_.size();
+            for (size_t position = 0; position < given; ++position) {
+                const auto &needle = allowlist_[position];
+                if ((needle.size() >= root_.size()) && (needle.compare(0, root_.size(), root_) == 0)
+                        && ((needle.size() == root_.size()) || (needle[root_.size()] == OS_DIR_SEPARATOR))) {
+                    std::string encoded(1, EVENTS_DB_ROOT_MARKER);
+                    encoded.append(needle, root_.size(), std::string::npos);
+                    allowlist_.emplace_back(std::move(encoded));
+                }
+            }
+        }
+    }
+
+    bool EventsDatabaseReader::drop_record(std::string_view record) const noexcept {
+        if (allowlist_.empty()) {
+            return false;
+        }
+        for (const auto &needle : allowlist_) {
+            if (record.find(needle) != std::string_view::npos) {
+                return false;
+            }
+        }
+        // Nothing of the allowlist is in the record. Only the command
+        // lifecycle records may be dropped: the environment definitions
+        // are consumed by the reader itself, and anything unrecognized
+        // shall reach the parser to report the problem.
+        if (format_ == EventsDatabaseFormat::BINARY) {
+            const auto kind = binary_event_kind(record);
+            return (kind == rpc::Event::kStartedFieldNumber)
+                    || (kind == rpc::Event::kTerminatedFieldNumber)
+                    || (kind == rpc::Event::kSignalledFieldNumber);
+        }
+        return (record.find(R"("started")") != std::string_view::npos)
+                || (record.find(R"("terminated")") != std::string_view::npos)
+                || (record.find(R"("signalled")") != std::string_view::npos);
+    }
+
+    std::optional<rust::Result<EventPtr>> EventsDatabaseReader::read_event() noexcept {
+        if (format_ == EventsDatabaseFormat::BINARY) {
+            while (auto record = next_record()) {
+                if (record.value().is_err()) {
+                    return std::make_optional(rust::Err(record.value().unwrap_err()));
+                }
+                const auto bytes = record.value().unwrap();
+                if (drop_record(bytes)) {
+                    continue;
+                }
+                return std::make_optional(from_binary(bytes));
+            }
+            return {};
+        }
+        while (auto line = next_line()) {
+            if (line.value().is_err()) {
+                return std::make_optional(rust::Err(line.value().unwrap_err()));
+            }
+            const auto bytes = line.value().unwrap();
+            if (drop_record(bytes)) {
+                continue;
+            }
+            return std::make_optional(from_json(bytes));
+        }
+        return {};
+    }
+
+    std::optional<rust::Result<std::string_view>> EventsDatabaseReader::next_line() noexcept {
+        if (data_ == nullptr) {
+            return next_line_stream();
+        }
+        if (cursor_ >= size_) {
+            return {};
+        }
+        const char *const begin = data_ + cursor_;
+        const char *const end = data_ + size_;
+        const char *const newline = std::find(begin, end, '\n');
+        const std::string_view line(begin, newline - begin);
+        cursor_ += line.size() + ((newline != end) ? 1 : 0);
+        return line.empty()
+                ? std::optional<rust::Result<std::string_view>>()
+                : std::make_optional(rust::Ok(line));
+    }
+
+    std::optional<rust::Result<std::string_view>> EventsDatabaseReader::next_record() noexcept {
+        if (data_ == nullptr) {
+            return next_record_stream();
+        }
+        const size_t prefix = EVENTS_DB_LENGTH_PREFIX_SIZE + (checksum_ ? EVENTS_DB_CRC_SIZE : 0);
+        for (;;) {
+            if (cursor_ >= size_) {
+                return {};
+            }
+            if (cursor_ + prefix > size_) {
+                // A crashed writer leaves a torn record at the end; all the
+                // records before it are intact (the file only ever grows at
+                // the end), so the events end here instead of failing the
+                // whole read.
+                spdlog::warn("Events db {} ends with a torn record; the tail is ignored.", path_.string());
+                cursor_ = size_;
+                return {};
+            }
+            const auto length = read_uint32(data_ + cursor_);
+            const bool framed = (cursor_ + prefix + length <= size_);
+            const bool intact = framed && (!checksum_
+                    || (crc32c(std::string_view(data_ + cursor_ + prefix, length))
+                            == read_uint32(data_ + cursor_ + EVENTS_DB_LENGTH_PREFIX_SIZE)));
+            if (!intact) {
+                // Without the checksum only a torn tail is recognizable.
+                // With it the damage is pinned to this record: scan for
+                // the next one whose payload matches its checksum, and
+                // continue the read there instead of failing it.
+                if (checksum_) {
+                    if (const auto next = resynchronize(cursor_ + 1); next.has_value()) {
+                        spdlog::warn(
+                                "Events db {} has a corrupted record at offset {}; {} bytes are skipped.",
+                                path_.string(), cursor_, next.value() - cursor_);
+                        cursor_ = next.value();
+                        continue;
+                    }
+                    spdlog::warn(
+                            "Events db {} has a corrupted record at offset {}; no intact record follows, the tail is ignored.",
+                            path_.string(), cursor_);
+                } else {
+                    spdlog::warn("Events db {} ends with a torn record; the tail is ignored.", path_.string());
+                }
+                cursor_ = size_;
+                return {};
+            }
+            const std::string_view record(data_ + cursor_ + prefix, length);
+            cursor_ += prefix + length;
+            return std::make_optional(rust::Ok(record));
+        }
+    }
+
+    std::optional<size_t> EventsDatabaseReader::resynchronize(size_t from) const noexcept {
+        constexpr size_t prefix = EVENTS_DB_LENGTH_PREFIX_SIZE + EVENTS_DB_CRC_SIZE;
+        for (size_t offset = from; offset + prefix <= size_; ++offset) {
+            const auto length = read_uint32(data_ + offset);
+            if (offset + prefix + length > size_) {
+                continue;
+            }
+            const std::string_view payload(data_ + offset + prefix, length);
+            if (crc32c(payload) == read_uint32(data_ + offset + EVENTS_DB_LENGTH_PREFIX_SIZE)) {
+                return std::make_optional(offset);
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<rust::Result<std::string_view>> EventsDatabaseReader::next_line_stream() noexcept {
+        if (std::getline(*file_, buffer_)) {
+            if (!carry_.empty()) {
+                buffer_.insert(0, carry_);
+                carry_.clear();
+            }
+            return buffer_.empty()
+                    ? std::optional<rust::Result<std::string_view>>()
+                    : std::make_optional(rust::Ok(std::string_view(buffer_)));
         } else {
             const std::runtime_error error(
                     fmt::format(
                             "Events db read failed (from file {}): io error",
                             path_.string()));
             return file_->eof()
-                   ? std::optional<rust::Result<std::string>>()
+                   ? std::optional<rust::Result<std::string_view>>()
                    : std::make_optional(rust::Err(error));
         }
     }
 
-    rust::Result<EventPtr> EventsDatabaseReader::from_json(const std::string &line) noexcept {
-        std::shared_ptr<rpc::Event> event = std::make_shared<rpc::Event>();
-        if (const auto status = google::protobuf::util::JsonStringToMessage(line, event.get(), parse_options); !status.ok()) {
+    std::optional<rust::Result<std::string_view>> EventsDatabaseReader::next_record_stream() noexcept {
+        const size_t prefix = EVENTS_DB_LENGTH_PREFIX_SIZE + (checksum_ ? EVENTS_DB_CRC_SIZE : 0);
+        for (;;) {
+            char bytes[EVENTS_DB_LENGTH_PREFIX_SIZE + EVENTS_DB_CRC_SIZE];
+            if (!file_->read(bytes, std::streamsize(prefix))) {
+                if (file_->eof() && (file_->gcount() == 0)) {
+                    return {};
+                }
+                // The stream ended inside a record: a crashed writer leaves
+                // a torn record at the end, which is dropped. A read error
+                // before the end of the stream is still an error.
+                if (file_->eof()) {
+                    spdlog::warn("Events db {} ends with a torn record; the tail is ignored.", path_.string());
+                    return {};
+                }
+                const std::runtime_error error(
+                        fmt::format(
+                                "Events db read failed (from file {}): io error",
+                                path_.string()));
+                return std::make_optional(rust::Err(error));
+            }
+            const auto length = read_uint32(bytes);
+            buffer_.resize(length);
+            if (!file_->read(buffer_.data(), length)) {
+                if (file_->eof()) {
+                    spdlog::warn("Events db {} ends with a torn record; the tail is ignored.", path_.string());
+                    return {};
+                }
+                const std::runtime_error error(
+                        fmt::format(
+                                "Events db read failed (from file {}): io error",
+                                path_.string()));
+                return std::make_optional(rust::Err(error));
+            }
+            // A stream can not seek back to scan for the next intact
+            // record; the framing is trusted and only the damaged record
+            // is dropped. (The mapped reader resynchronizes instead.)
+            if (checksum_ && (crc32c(std::string_view(buffer_)) != read_uint32(bytes + EVENTS_DB_LENGTH_PREFIX_SIZE))) {
+                spdlog::warn("Events db {} has a corrupted record; it is skipped.", path_.string());
+                continue;
+            }
+            return std::make_optional(rust::Ok(std::string_view(buffer_)));
+        }
+    }
+
+    rust::Result<std::vector<EventPtr>> EventsDatabaseReader::events_for_pid(uint32_t pid) noexcept {
+        if ((data_ == nullptr) || (format_ != EventsDatabaseFormat::BINARY)) {
+            auto message = fmt::format(
+                    "Events db lookup failed (from file {}): the index needs an uncompressed binary file",
+                    path_.string());
+            return rust::Err(std::runtime_error(message));
+        }
+        if (auto loaded = ensure_index(); loaded.is_err()) {
+            return rust::Err(loaded.unwrap_err());
+        }
+        // The started events name the pid; the terminated and signalled
+        // events of the same execution are tied to it by the rid.
+        std::set<uint64_t> rids;
+        for (const auto &entry : index_) {
+            if ((entry.kind == EventsDatabaseEventKind::STARTED) && (entry.pid == pid)) {
+                rids.insert(entry.rid);
+            }
+        }
+        std::vector<EventPtr> events;
+        for (const auto &entry : index_) {
+            if ((entry.kind != EventsDatabaseEventKind::ENVIRONMENT)
+                    && (entry.kind != EventsDatabaseEventKind::STRINGS)
+                    && (entry.kind != EventsDatabaseEventKind::SAMPLING)
+                    && (rids.count(entry.rid) > 0)) {
+                auto event = parse_indexed(entry);
+                if (event.is_err()) {
+                    return rust::Err(event.unwrap_err());
+                }
+                auto parsed = event.unwrap();
+                resolve_environment(parsed);
+                events.emplace_back(std::move(parsed));
+            }
+        }
+        return rust::Ok(std::move(events));
+    }
+
+    rust::Result<size_t> EventsDatabaseReader::query(const EventsDatabaseQuery &query, const EventConsumer &consumer) noexcept {
+        // An indexed uncompressed binary file answers the selection from
+        // the index: only the matching records are read and parsed.
+        // Everything else (compressed, JSON or unindexed files) falls
+        // back to a scan with the filter applied after parsing.
+        if ((data_ != nullptr) && (format_ == EventsDatabaseFormat::BINARY) && ensure_index().is_ok()) {
+            size_t count = 0;
+            for (const auto &entry : index_) {
+                if ((entry.kind == EventsDatabaseEventKind::ENVIRONMENT)
+                        || (entry.kind == EventsDatabaseEventKind::STRINGS)
+                        || (entry.kind == EventsDatabaseEventKind::SAMPLING)) {
+                    continue;
+                }
+                if (!selected(query, entry.timestamp, entry.pid)) {
+                    continue;
+                }
+                auto event = parse_indexed(entry);
+                if (event.is_err()) {
+                    return rust::Err(event.unwrap_err());
+                }
+                auto parsed = event.unwrap();
+                resolve_environment(parsed);
+                consumer(parsed);
+                ++count;
+            }
+            return rust::Ok(count);
+        }
+        // Only the started events carry the process identity; the rid to
+        // pid mapping ties the terminated and signalled events of an
+        // execution to the same pid.
+        std::map<uint64_t, uint32_t> pids;
+        size_t count = 0;
+        for (auto candidate = next(); candidate; candidate = next()) {
+            if (candidate.value().is_err()) {
+                return rust::Err(candidate.value().unwrap_err());
+            }
+            auto event = candidate.value().unwrap();
+            if (event->has_started()) {
+                pids[event->rid()] = uint32_t(event->started().pid());
+            }
+            const auto pid_it = pids.find(event->rid());
+            const uint32_t pid = (pid_it != pids.end()) ? pid_it->second : 0u;
+            const auto timestamp = uint64_t(google::protobuf::util::TimeUtil::TimestampToMicroseconds(event->timestamp()));
+            if (selected(query, timestamp, pid)) {
+                consumer(event);
+                ++count;
+            }
+        }
+        return rust::Ok(count);
+    }
+
+    rust::Result<int> EventsDatabaseReader::ensure_index() noexcept {
+        if (index_loaded_) {
+            return rust::Ok(0);
+        }
+        if (auto loaded = load_index(); loaded.is_err()) {
+            return loaded;
+        }
+        index_loaded_ = true;
+        // The environment and string definitions are shared between
+        // processes, resolve them once up front, so the point lookups
+        // can resolve their references in any order. The children lists
+        // make the process tree queries proportional to their results,
+        // instead of the index size.
+        for (const auto &entry : index_) {
+            if (entry.kind == EventsDatabaseEventKind::ENVIRONMENT) {
+                if (auto event = parse_indexed(entry); event.is_ok()) {
+                    const auto definition = event.unwrap();
+                    environments_[definition->environment().id()] = definition->environment().variables();
+                }
+            }
+            if (entry.kind == EventsDatabaseEventKind::STRINGS) {
+                if (auto event = parse_indexed(entry); event.is_ok()) {
+                    load_strings(event.unwrap()->strings());
+                }
+            }
+            if ((entry.kind == EventsDatabaseEventKind::STARTED) && (entry.ppid != 0)) {
+                children_[entry.ppid].push_back(entry.pid);
+            }
+        }
+        return rust::Ok(0);
+    }
+
+    rust::Result<std::vector<uint32_t>> EventsDatabaseReader::children_of(uint32_t pid) noexcept {
+        if ((data_ == nullptr) || (format_ != EventsDatabaseFormat::BINARY)) {
+            auto message = fmt::format(
+                    "Events db lookup failed (from file {}): the index needs an uncompressed binary file",
+                    path_.string());
+            return rust::Err(std::runtime_error(message));
+        }
+        if (auto loaded = ensure_index(); loaded.is_err()) {
+            return rust::Err(loaded.unwrap_err());
+        }
+        const auto it = children_.find(pid);
+        std::vector<uint32_t> result = (it != children_.end()) ? it->second : std::vector<uint32_t>();
+        return rust::Ok(std::move(result));
+    }
+
+    rust::Result<int> EventsDatabaseReader::load_index() noexcept {
+        const fs::path index_path(path_.string() + EVENTS_DB_INDEX_SUFFIX);
+        std::ifstream file(index_path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            auto message = fmt::format(
+                    "Events db lookup failed (from file {}): no index file found",
+                    path_.string());
+            return rust::Err(std::runtime_error(message));
+        }
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        const std::string content = buffer.str();
+
+        constexpr size_t HEADER_SIZE = EVENTS_DB_INDEX_MAGIC_SIZE + 2 * sizeof(uint32_t);
+        constexpr size_t ENTRY_SIZE = 3 * sizeof(uint64_t) + 4 * sizeof(uint32_t);
+        const bool valid = (content.size() >= HEADER_SIZE)
+                && std::equal(EVENTS_DB_INDEX_MAGIC, EVENTS_DB_INDEX_MAGIC + EVENTS_DB_INDEX_MAGIC_SIZE, content.data())
+                && (read_uint32(content.data() + EVENTS_DB_INDEX_MAGIC_SIZE) == EVENTS_DB_INDEX_VERSION);
+        const size_t count = valid
+                ? read_uint32(content.data() + EVENTS_DB_INDEX_MAGIC_SIZE + sizeof(uint32_t))
+                : 0;
+        if (!valid || (content.size() < HEADER_SIZE + count * ENTRY_SIZE)) {
+            auto message = fmt::format(
+                    "Events db lookup failed (from file {}): malformed index file",
+                    path_.string());
+            return rust::Err(std::runtime_error(message));
+        }
+        index_.reserve(count);
+        for (size_t position = HEADER_SIZE; index_.size() < count; position += ENTRY_SIZE) {
+            const char *bytes = content.data() + position;
+            index_.push_back(EventsDatabaseIndexEntry {
+                    read_uint64(bytes),
+                    read_uint64(bytes + 8),
+                    read_uint32(bytes + 16),
+                    read_uint32(bytes + 20),
+                    read_uint32(bytes + 24),
+                    EventsDatabaseEventKind(read_uint32(bytes + 28)),
+                    read_uint64(bytes + 32),
+            });
+        }
+        return rust::Ok(0);
+    }
+
+    rust::Result<EventPtr> EventsDatabaseReader::parse_indexed(const EventsDatabaseIndexEntry &entry) noexcept {
+        const size_t prefix = EVENTS_DB_LENGTH_PREFIX_SIZE + (checksum_ ? EVENTS_DB_CRC_SIZE : 0);
+        if (entry.offset + prefix + entry.length > size_) {
+            auto message = fmt::format(
+                    "Events db lookup failed (from file {}): the index points outside of the file",
+                    path_.string());
+            return rust::Err(std::runtime_error(message));
+        }
+        const std::string_view record(data_ + entry.offset + prefix, entry.length);
+        // A point lookup has nothing to skip to: a damaged record is an
+        // error here, not a gap in a stream.
+        if (checksum_ && (crc32c(record) != read_uint32(data_ + entry.offset + EVENTS_DB_LENGTH_PREFIX_SIZE))) {
+            auto message = fmt::format(
+                    "Events db lookup failed (from file {}): the record failed its integrity check",
+                    path_.string());
+            return rust::Err(std::runtime_error(message));
+        }
+        return from_binary(record);
+    }
+
+    rust::Result<EventPtr> EventsDatabaseReader::from_binary(std::string_view record) noexcept {
+        EventPtr event = create_arena_event();
+        if (!event->ParseFromArray(record.data(), record.size())) {
+            auto message = fmt::format(
+                    "Events db read failed (from file {}): message parsing error",
+                    path_.string()
+            );
+            return rust::Err(std::runtime_error(message));
+        }
+        // The started events store their string fields encoded: the
+        // repeated values as references into the string table, and the
+        // session root prefix as the marker byte. Restore them here, so
+        // the consumers never see the encoding.
+        if (event->has_started() && (strings_ || !root_.empty())) {
+            if (strings_) {
+                resolve_strings(*event);
+            }
+            decode_started_paths(*event, root_);
+        }
+        return rust::Ok(event);
+    }
+
+    rust::Result<EventPtr> EventsDatabaseReader::from_json(std::string_view line) noexcept {
+        EventPtr event = create_arena_event();
+        // The schema aware parser handles the events this tool writes;
+        // everything else goes through the generic protobuf JSON parser.
+        if (FastEventParser(line).parse(*event)) {
+            return rust::Ok(event);
+        }
+        event->Clear();
+        const google::protobuf::StringPiece input(line.data(), line.size());
+        if (const auto status = google::protobuf::util::JsonStringToMessage(input, event.get(), parse_options); !status.ok()) {
             auto message = fmt::format(
                     "Events db read failed (from file {}): JSON parsing error",
                     path_.string()
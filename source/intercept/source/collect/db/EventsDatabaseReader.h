@@ -20,13 +20,19 @@
 #pragma once
 
 #include "config.h"
+#include "collect/db/EventsDatabaseFormat.h"
 #include "libresult/Result.h"
 #include "intercept.pb.h"
 
+#include <functional>
 #include <iosfwd>
 #include <filesystem>
+#include <map>
 #include <memory>
 #include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -34,6 +40,15 @@ namespace ic::collect::db {
 
     using EventPtr = std::shared_ptr<rpc::Event>;
 
+    // A selection over the events of a database: an inclusive time
+    // window (microseconds since the epoch) and an inclusive pid range.
+    // An unset bound does not constrain.
+    struct EventsDatabaseQuery {
+        std::optional<uint64_t> since = std::nullopt;
+        std::optional<uint64_t> until = std::nullopt;
+        std::optional<std::pair<uint32_t, uint32_t>> pids = std::nullopt;
+    };
+
     class EventsDatabaseReader {
     public:
         class Iterator;
@@ -41,26 +56,119 @@ namespace ic::collect::db {
 
         using Ptr = std::shared_ptr<EventsDatabaseReader>;
         using StreamPtr = std::unique_ptr<std::istream>;
+        using EventConsumer = std::function<void(const EventPtr &)>;
 
         [[nodiscard]] static rust::Result<EventsDatabaseReader::Ptr> from(const fs::path &path);
 
         [[nodiscard]] Iterator begin() noexcept;
         [[nodiscard]] Iterator end() noexcept;
 
-    private:
+        // Look up the events of a single process through the index sidecar
+        // file, without scanning the whole events file. Needs a memory
+        // mapped binary events file with its index written next to it.
+        [[nodiscard]] rust::Result<std::vector<EventPtr>> events_for_pid(uint32_t pid) noexcept;
+
+        // The child processes of a process, through the index sidecar
+        // file: the pids of the started events which name the given pid
+        // as their parent, in event order. Combined with events_for_pid
+        // it reconstructs the process tree without scanning the events
+        // file. Needs the same indexed setup as events_for_pid.
+        [[nodiscard]] rust::Result<std::vector<uint32_t>> children_of(uint32_t pid) noexcept;
+
+        // Stream the process events matching the query into the consumer,
+        // in event order. On an indexed uncompressed binary file the
+        // selection runs on the index and only the matching records are
+        // read from the file; otherwise the whole database is scanned
+        // and filtered after parsing. Returns the matched event count.
+        [[nodiscard]] rust::Result<size_t> query(const EventsDatabaseQuery &query, const EventConsumer &consumer) noexcept;
+
+        // Read the next event. Returns nothing at the end of the database.
+        // The iterator interface wraps this; it is public for readers which
+        // need to own the events (to hand them over to another thread).
         [[nodiscard]] std::optional<rust::Result<EventPtr>> next() noexcept;
-        [[nodiscard]] std::optional<rust::Result<std::string>> next_line() noexcept;
-        [[nodiscard]] rust::Result<EventPtr> from_json(const std::string &) noexcept;
+
+        // Install a raw record prefilter: the reads drop every command
+        // record whose serialized bytes contain none of the given
+        // substrings, without parsing the message. It is a plain byte
+        // scan, so it can only over-match (an occurrence in an argument
+        // or an environment variable keeps the record): a dropped record
+        // is a guaranteed non-match. The environment definitions are
+        // always parsed, and the terminated and signalled events of a
+        // dropped command are dropped with it. The substrings shall be
+        // given as they appear in the serialized record (mind the JSON
+        // string escaping for exotic paths).
+        void prefilter(std::vector<std::string> allowlist) noexcept;
+
+        // Size of a memory mapped events file. Returns nothing for
+        // streamed inputs.
+        [[nodiscard]] std::optional<size_t> mapped_size() const noexcept;
+
+        // Digest of the first length bytes of a memory mapped events file.
+        // Returns nothing for streamed inputs or when the file is shorter.
+        // Consumers use it to recognize a file they saw before it grew.
+        [[nodiscard]] std::optional<uint64_t> prefix_digest(size_t length) const noexcept;
+
+    private:
+        [[nodiscard]] std::optional<rust::Result<EventPtr>> read_event() noexcept;
+        [[nodiscard]] bool drop_record(std::string_view record) const noexcept;
+        [[nodiscard]] std::optional<rust::Result<std::string_view>> next_line() noexcept;
+        [[nodiscard]] std::optional<rust::Result<std::string_view>> next_record() noexcept;
+        [[nodiscard]] rust::Result<EventPtr> from_json(std::string_view) noexcept;
+        [[nodiscard]] rust::Result<EventPtr> from_binary(std::string_view) noexcept;
+        [[nodiscard]] rust::Result<int> load_index() noexcept;
+        [[nodiscard]] rust::Result<int> ensure_index() noexcept;
+        [[nodiscard]] rust::Result<EventPtr> parse_indexed(const EventsDatabaseIndexEntry &entry) noexcept;
+        void resolve_environment(const EventPtr &event) noexcept;
+        void resolve_strings(rpc::Event &event) const noexcept;
+        void load_strings(const rpc::Event::Strings &definition) noexcept;
+        // Scan the mapping for the next intact record after a corrupted
+        // one: the first offset from the given one where the framing fits
+        // the file and the payload matches its checksum. Returns nothing
+        // when no such offset exists before the end of the file.
+        [[nodiscard]] std::optional<size_t> resynchronize(size_t from) const noexcept;
 
     public:
-        explicit EventsDatabaseReader(fs::path path, StreamPtr file) noexcept;
+        // Reads the events from a memory mapped view of the file. The record
+        // access is zero-copy: the parser consumes slices of the mapping.
+        // The cursor points past the file header, the root is the session
+        // root of a rooted file (empty otherwise), the checksum flag tells
+        // whether the records carry the per record CRC32C, the strings
+        // flag whether they store references into the string table.
+        explicit EventsDatabaseReader(fs::path path, const char *data, size_t size, EventsDatabaseFormat format, size_t cursor, std::string root, bool checksum, bool strings) noexcept;
+        // Reads the events through a stream. Fallback for inputs which can
+        // not be memory mapped. The stream content is buffered per record.
+        explicit EventsDatabaseReader(fs::path path, StreamPtr file, EventsDatabaseFormat format, std::string carry, std::string root, bool checksum, bool strings) noexcept;
+        ~EventsDatabaseReader() noexcept;
 
         NON_DEFAULT_CONSTRUCTABLE(EventsDatabaseReader)
         NON_COPYABLE_NOR_MOVABLE(EventsDatabaseReader)
 
+    private:
+        [[nodiscard]] static rust::Result<EventsDatabaseReader::Ptr> from_stream(const fs::path &path, StreamPtr file);
+        [[nodiscard]] std::optional<rust::Result<std::string_view>> next_line_stream() noexcept;
+        [[nodiscard]] std::optional<rust::Result<std::string_view>> next_record_stream() noexcept;
+
     private:
         fs::path path_;
         StreamPtr file_;
+        const char *data_;
+        size_t size_;
+        size_t cursor_;
+        std::string buffer_;
+        std::string carry_;
+        EventsDatabaseFormat format_;
+        std::string root_;
+        bool checksum_;
+        // The string table of the file, filled from the definition
+        // events as the read passes them (a definition always precedes
+        // its first reference).
+        bool strings_;
+        std::map<uint64_t, std::string> string_table_;
+        std::map<uint64_t, google::protobuf::Map<std::string, std::string>> environments_;
+        bool index_loaded_;
+        std::vector<EventsDatabaseIndexEntry> index_;
+        std::map<uint32_t, std::vector<uint32_t>> children_;
+        std::vector<std::string> allowlist_;
     };
 
     class EventsDatabaseReader::Iterator {
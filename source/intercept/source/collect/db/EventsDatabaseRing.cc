@@ -0,0 +1,67 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EventsDatabaseRing.h"
+
+#include <fmt/format.h>
+
+#include <fstream>
+#include <system_error>
+
+namespace ic::collect::db {
+
+    fs::path ring_segment_path(const fs::path &base, uint64_t segment) {
+        return fs::path(fmt::format("{}.ring.{}", base.string(), segment));
+    }
+
+    fs::path ring_watermark_path(const fs::path &base) {
+        return fs::path(fmt::format("{}.ring.consumed", base.string()));
+    }
+
+    uint64_t ring_consumed_watermark(const fs::path &base) noexcept {
+        std::ifstream file(ring_watermark_path(base));
+        uint64_t value = 0;
+        return (file >> value) ? value : 0;
+    }
+
+    rust::Result<int> ring_mark_consumed(const fs::path &base, uint64_t segment) {
+        // A replayed older position shall not resurrect reclaimed
+        // segments in the writer's eyes.
+        if (segment <= ring_consumed_watermark(base)) {
+            return rust::Ok(0);
+        }
+        const auto target = ring_watermark_path(base);
+        const auto temporary = fs::path(target.string() + ".tmp");
+        {
+            std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+            file << segment << std::endl;
+            if (!file) {
+                auto message = fmt::format("Events db watermark write failed (file {})", temporary.string());
+                return rust::Err(std::runtime_error(message));
+            }
+        }
+        std::error_code error_code;
+        fs::rename(temporary, target, error_code);
+        if (error_code) {
+            auto message = fmt::format("Events db watermark write failed (file {}): {}", target.string(), error_code.message());
+            return rust::Err(std::runtime_error(message));
+        }
+        return rust::Ok(1);
+    }
+}
@@ -0,0 +1,58 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libresult/Result.h"
+
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace ic::collect::db {
+
+    // The segment naming and the consumption watermark of the ring mode.
+    //
+    // A long running collector session would grow a single events file
+    // without bound. A ring writer splits the output into fixed size
+    // segments instead, numbered from one: "<base>.ring.<n>". Every
+    // segment is a complete events file with its own header and its own
+    // environment definitions, readable on its own with the usual
+    // reader. The consumer reads the finished segments in order (a
+    // segment is finished once its successor exists) and records its
+    // progress in the watermark file; the writer removes the consumed
+    // segments when it rotates to the next one. The steady state disk
+    // usage is therefore the unconsumed segments plus the one being
+    // written, no matter how long the session runs.
+
+    [[nodiscard]] fs::path ring_segment_path(const fs::path &base, uint64_t segment);
+    [[nodiscard]] fs::path ring_watermark_path(const fs::path &base);
+
+    // The highest segment number the consumer finished with, read from
+    // the watermark file. Zero when nothing was consumed yet (or the
+    // watermark is unreadable, which only delays the reclaim).
+    [[nodiscard]] uint64_t ring_consumed_watermark(const fs::path &base) noexcept;
+
+    // Record that every segment up to (and including) the given number
+    // is consumed. The watermark only moves forward; the update is a
+    // write-then-rename, so the writer never reads a partial value.
+    [[nodiscard]] rust::Result<int> ring_mark_consumed(const fs::path &base, uint64_t segment);
+}
@@ -18,16 +18,24 @@
  */
 
 #include "EventsDatabaseWriter.h"
+#include "Crc32c.h"
+#include "EventsDatabaseRing.h"
+#include "ZstdStream.h"
 #include "libsys/Errors.h"
 
 #include <google/protobuf/util/json_util.h>
+#include <google/protobuf/util/time_util.h>
 #include <fmt/format.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+
+#include <algorithm>
 #include <cerrno>
+#include <cstring>
+#include <vector>
 
 using google::protobuf::util::JsonPrintOptions;
 
@@ -43,68 +51,719 @@ namespace {
     }
 
     const JsonPrintOptions print_options = create_print_options();
+
+    // Turn a hot path error into the allocating one the public API
+    // reports, adding the context only this layer knows.
+    std::runtime_error describe(const rust::Error &error, const fs::path &path) {
+        std::string message = fmt::format("{} (file {})", error.message, path.string());
+        if (error.detail != nullptr) {
+            message += fmt::format(": {}", error.detail);
+        }
+        if (error.code != 0) {
+            message += fmt::format(": {}", sys::error_string(error.code));
+        }
+        return std::runtime_error(message);
+    }
+
+    // A stable content hash of the environment, used as the interning key.
+    // The map entries are visited in sorted order, because the protobuf map
+    // iteration order is unspecified. (FNV-1a over the key value pairs.)
+    uint64_t hash_environment(const google::protobuf::Map<std::string, std::string> &environment) {
+        std::vector<const google::protobuf::MapPair<std::string, std::string> *> entries;
+        entries.reserve(environment.size());
+        for (const auto &entry : environment) {
+            entries.emplace_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](auto lhs, auto rhs) { return lhs->first < rhs->first; });
+
+        uint64_t hash = 14695981039346656037ull;
+        const auto mix = [&hash](const std::string &content) {
+            for (const char character : content) {
+                hash ^= uint8_t(character);
+                hash *= 1099511628211ull;
+            }
+            hash ^= 0xffu;
+            hash *= 1099511628211ull;
+        };
+        for (const auto *entry : entries) {
+            mix(entry->first);
+            mix(entry->second);
+        }
+        return hash;
+    }
+
+    // The string table id of a value: FNV-1a of the content. The zero
+    // value is avoided, it marks a not yet interned entry.
+    uint64_t hash_string(const std::string &value) {
+        uint64_t hash = 14695981039346656037ull;
+        for (const char character : value) {
+            hash ^= uint8_t(character);
+            hash *= 1099511628211ull;
+        }
+        return (hash == 0) ? 1 : hash;
+    }
+
+    // The size of the extents the file space is reserved in, ahead of
+    // the writes. Large enough that a multi gigabyte session lands in a
+    // handful of contiguous extents; the unused tail of the last one is
+    // given back when the writer closes.
+    constexpr size_t PREALLOCATION_EXTENT = 256 * 1024 * 1024;
+
+    // Reserve the given byte range of the file without changing its
+    // size, so the coming appends land on contiguous disk. Returns
+    // false when the platform or the filesystem can not do it.
+    bool reserve_file_range(int fd, size_t offset, size_t length) {
+#if defined(__linux__)
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, off_t(offset), off_t(length)) == -1) {
+            errno = 0;
+            return false;
+        }
+        return true;
+#else
+        static_cast<void>(fd);
+        static_cast<void>(offset);
+        static_cast<void>(length);
+        return false;
+#endif
+    }
+
+    // Give back the reserved blocks past the written bytes: truncating
+    // to the (unchanged) file size releases everything beyond it. Best
+    // effort, a failure only leaves the blocks allocated.
+    void release_file_tail(int fd, size_t size) {
+        if (ftruncate(fd, off_t(size)) == -1) {
+            errno = 0;
+        }
+    }
+
+    ic::collect::db::EventsDatabaseEventKind kind_of(const rpc::Event &event) {
+        if (event.has_started()) {
+            return ic::collect::db::EventsDatabaseEventKind::STARTED;
+        }
+        if (event.has_terminated()) {
+            return ic::collect::db::EventsDatabaseEventKind::TERMINATED;
+        }
+        if (event.has_signalled()) {
+            return ic::collect::db::EventsDatabaseEventKind::SIGNALLED;
+        }
+        if (event.has_strings()) {
+            return ic::collect::db::EventsDatabaseEventKind::STRINGS;
+        }
+        if (event.has_sampling()) {
+            return ic::collect::db::EventsDatabaseEventKind::SAMPLING;
+        }
+        return ic::collect::db::EventsDatabaseEventKind::ENVIRONMENT;
+    }
+
+    std::string create_file_header(uint32_t version) {
+        std::string header(ic::collect::db::EVENTS_DB_MAGIC, ic::collect::db::EVENTS_DB_MAGIC_SIZE);
+        header.push_back(char(version & 0xffu));
+        header.push_back(char((version >> 8u) & 0xffu));
+        header.push_back(char((version >> 16u) & 0xffu));
+        header.push_back(char((version >> 24u) & 0xffu));
+        return header;
+    }
+
+    // The rooted headers carry the session root after the fixed part:
+    // a 32 bit little-endian length and the root path itself.
+    void append_root(std::string &header, const std::string &root) {
+        const auto length = uint32_t(root.size());
+        header.push_back(char(length & 0xffu));
+        header.push_back(char((length >> 8u) & 0xffu));
+        header.push_back(char((length >> 16u) & 0xffu));
+        header.push_back(char((length >> 24u) & 0xffu));
+        header.append(root);
+    }
+
+    // Replace the session root prefix of a path value with the marker
+    // byte. A value which genuinely starts with the marker, the escape
+    // or the string marker byte gets the escape byte in front instead,
+    // which keeps the decoding unambiguous.
+    void encode_path(std::string &value, const std::string &root) {
+        if (value.empty()) {
+            return;
+        }
+        if ((value.front() == ic::collect::db::EVENTS_DB_ROOT_MARKER)
+                || (value.front() == ic::collect::db::EVENTS_DB_ROOT_ESCAPE)
+                || (value.front() == ic::collect::db::EVENTS_DB_STRING_MARKER)) {
+            value.insert(value.begin(), ic::collect::db::EVENTS_DB_ROOT_ESCAPE);
+            return;
+        }
+        if (root.empty()) {
+            return;
+        }
+        if ((value.size() >= root.size()) && (value.compare(0, root.size(), root) == 0)
+                && ((value.size() == root.size()) || (value[root.size()] == OS_DIR_SEPARATOR))) {
+            value.replace(0, root.size(), 1, ic::collect::db::EVENTS_DB_ROOT_MARKER);
+        }
+    }
 }
 
 namespace ic::collect::db {
 
-    rust::Result<EventsDatabaseWriter::Ptr> EventsDatabaseWriter::create(const fs::path &file) {
-        int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 00644);
+    rust::Result<EventsDatabaseWriter::Ptr> EventsDatabaseWriter::create(const fs::path &file, EventsDatabaseFormat format, size_t flush_threshold, bool compress, bool index, EventsDatabaseDurability durability) {
+        if (compress && !zstd_supported()) {
+            return rust::Err(std::runtime_error("Events db compression requested, but zstd support is not built in"));
+        }
+        // The index offsets point into the records, which a compressed or
+        // JSON file does not expose as addressable slices.
+        if (index && (compress || (format != EventsDatabaseFormat::BINARY))) {
+            return rust::Err(std::runtime_error("Events db index requested, but it needs the uncompressed binary format"));
+        }
+        // The standard output is a pipe, which has no durable storage to
+        // sync to.
+        if ((durability != EventsDatabaseDurability::NONE) && (file == "-")) {
+            return rust::Err(std::runtime_error("Events db sync requested, but a streaming output can not be synced"));
+        }
+        // The "-" file name stands for the standard output. It makes the
+        // events available to a consumer process as they happen.
+        int fd = (file == "-")
+                ? dup(STDOUT_FILENO)
+                : open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 00644);
         if (fd == -1) {
             auto message = fmt::format("Events db open failed (file {}): {}", file.string(), sys::error_string(errno));
             return rust::Err(std::runtime_error(message));
         }
         std::shared_ptr<EventsDatabaseWriter> result =
-                std::make_shared<EventsDatabaseWriter>(file, fd);
+                std::make_shared<EventsDatabaseWriter>(file, fd, format, flush_threshold, compress, index, durability);
+        // The JSON payload stays verbatim, so only the binary files
+        // carry the session root (and the path encoding) in the header.
+        const bool rooted = (format == EventsDatabaseFormat::BINARY) && !session_root().empty();
+        if (compress) {
+            // The header is plain (not part of the compressed content), so
+            // the reader can detect the compression before inflating.
+            auto header = create_file_header(rooted ? EVENTS_DB_VERSION_ZSTD_ROOTED : EVENTS_DB_VERSION_ZSTD);
+            header.push_back((format == EventsDatabaseFormat::BINARY)
+                    ? EVENTS_DB_PAYLOAD_BINARY
+                    : EVENTS_DB_PAYLOAD_JSON);
+            if (rooted) {
+                append_root(header, session_root());
+            }
+            if (auto written = result->write_to_file(header); written.is_err()) {
+                return rust::Err(describe(written.unwrap_err(), file));
+            }
+        } else if (format == EventsDatabaseFormat::BINARY) {
+            auto header = create_file_header(rooted ? EVENTS_DB_VERSION_STRINGS_ROOTED : EVENTS_DB_VERSION_STRINGS);
+            if (rooted) {
+                append_root(header, session_root());
+            }
+            if (auto written = result->append(header); written.is_err()) {
+                return rust::Err(describe(written.unwrap_err(), file));
+            }
+        }
         return rust::Ok(result);
     }
 
-    EventsDatabaseWriter::EventsDatabaseWriter(fs::path path, int file) noexcept
+    rust::Result<EventsDatabaseWriter::Ptr> EventsDatabaseWriter::resume(const fs::path &file, size_t flush_threshold, EventsDatabaseDurability durability) {
+        if (file == "-") {
+            return rust::Err(std::runtime_error("Events db resume requested, but a streaming output can not be resumed"));
+        }
+        const int fd = open(file.c_str(), O_RDWR);
+        if (fd == -1) {
+            auto message = fmt::format("Events db open failed (file {}): {}", file.string(), sys::error_string(errno));
+            return rust::Err(std::runtime_error(message));
+        }
+        const auto fail = [&fd, &file](const std::string &cause) {
+            close(fd);
+            return rust::Err(std::runtime_error(
+                    fmt::format("Events db resume failed (file {}): {}", file.string(), cause)));
+        };
+        const auto read_uint32_at = [&fd](size_t offset, uint32_t &value) {
+            char bytes[sizeof(uint32_t)];
+            if (pread(fd, bytes, sizeof(bytes), off_t(offset)) != ssize_t(sizeof(bytes))) {
+                return false;
+            }
+            value = uint32_t(uint8_t(bytes[0]))
+                    | (uint32_t(uint8_t(bytes[1])) << 8u)
+                    | (uint32_t(uint8_t(bytes[2])) << 16u)
+                    | (uint32_t(uint8_t(bytes[3])) << 24u);
+            return true;
+        };
+        struct stat state = {};
+        if (fstat(fd, &state) == -1) {
+            return fail(sys::error_string(errno));
+        }
+        const auto size = size_t(state.st_size);
+        // Validate the header: the appended records shall use the same
+        // framing (and the same path encoding) the file started with.
+        char magic[EVENTS_DB_MAGIC_SIZE];
+        uint32_t version = 0;
+        if ((pread(fd, magic, sizeof(magic), 0) != ssize_t(sizeof(magic)))
+                || (0 != std::memcmp(magic, EVENTS_DB_MAGIC, EVENTS_DB_MAGIC_SIZE))
+                || !read_uint32_at(EVENTS_DB_MAGIC_SIZE, version)) {
+            return fail("not an events db file");
+        }
+        if ((version == EVENTS_DB_VERSION) || (version == EVENTS_DB_VERSION_ROOTED)) {
+            // The appended records would carry checksums the header does
+            // not announce, and the readers would treat the checksum
+            // bytes as payload.
+            return fail("the file predates the per record checksums");
+        }
+        if ((version != EVENTS_DB_VERSION_CRC) && (version != EVENTS_DB_VERSION_CRC_ROOTED)
+                && (version != EVENTS_DB_VERSION_STRINGS) && (version != EVENTS_DB_VERSION_STRINGS_ROOTED)) {
+            return fail("only an uncompressed binary file can be resumed");
+        }
+        size_t offset = EVENTS_DB_MAGIC_SIZE + sizeof(uint32_t);
+        std::string root;
+        if ((version == EVENTS_DB_VERSION_CRC_ROOTED) || (version == EVENTS_DB_VERSION_STRINGS_ROOTED)) {
+            uint32_t root_length = 0;
+            if (!read_uint32_at(offset, root_length)) {
+                return fail("truncated header");
+            }
+            offset += sizeof(uint32_t);
+            root.resize(root_length);
+            if (pread(fd, root.data(), root_length, off_t(offset)) != ssize_t(root_length)) {
+                return fail("truncated header");
+            }
+            offset += root_length;
+        }
+        if (root != session_root()) {
+            return fail("the file was captured from a different working directory");
+        }
+        // Scan the records and cut off a torn tail, so the file ends on
+        // a record boundary before the appending starts.
+        constexpr size_t prefix = EVENTS_DB_LENGTH_PREFIX_SIZE + EVENTS_DB_CRC_SIZE;
+        while (offset + prefix <= size) {
+            uint32_t length = 0;
+            if (!read_uint32_at(offset, length)
+                    || (offset + prefix + length > size)) {
+                break;
+            }
+            offset += prefix + length;
+        }
+        if ((offset < size) && (ftruncate(fd, off_t(offset)) == -1)) {
+            return fail(sys::error_string(errno));
+        }
+        if (lseek(fd, off_t(offset), SEEK_SET) == -1) {
+            return fail(sys::error_string(errno));
+        }
+        auto writer = std::make_shared<EventsDatabaseWriter>(
+                file, fd, EventsDatabaseFormat::BINARY, flush_threshold, false, false, durability);
+        // The string marker encoding shall match what the header of the
+        // file announces. The interning starts afresh, like the
+        // environments: the ids are content hashes, a repeated
+        // definition is harmless for the readers.
+        writer->strings_ = (version == EVENTS_DB_VERSION_STRINGS) || (version == EVENTS_DB_VERSION_STRINGS_ROOTED);
+        return rust::Ok(writer);
+    }
+
+    rust::Result<EventsDatabaseWriter::Ptr> EventsDatabaseWriter::ring(const fs::path &base, size_t segment_size, size_t flush_threshold, EventsDatabaseDurability durability) {
+        if (base == "-") {
+            return rust::Err(std::runtime_error("Events db ring requested, but a streaming output can not be segmented"));
+        }
+        // Continue the numbering after the leftover segments of a
+        // previous session, so nothing the consumer has not seen yet
+        // gets overwritten.
+        uint64_t segment = ring_consumed_watermark(base) + 1;
+        std::error_code error_code;
+        while (fs::exists(ring_segment_path(base, segment), error_code)) {
+            ++segment;
+        }
+        return create(ring_segment_path(base, segment), EventsDatabaseFormat::BINARY, flush_threshold, false, false, durability)
+                .map<EventsDatabaseWriter::Ptr>([&base, &segment_size, &segment](auto writer) {
+                    writer->base_ = base;
+                    writer->segment_limit_ = segment_size;
+                    writer->segment_ = segment;
+                    return writer;
+                });
+    }
+
+    const std::string &EventsDatabaseWriter::session_root() noexcept {
+        static const std::string root = []() {
+            std::error_code error_code;
+            const auto current = fs::current_path(error_code);
+            // The filesystem root as a prefix would save nothing.
+            return (error_code || (current == current.root_path()))
+                    ? std::string()
+                    : current.string();
+        }();
+        return root;
+    }
+
+    EventsDatabaseWriter::EventsDatabaseWriter(fs::path path, int file, EventsDatabaseFormat format, size_t flush_threshold, bool compress, bool index, EventsDatabaseDurability durability) noexcept
             : path_(std::move(path))
             , file_(file)
-    { }
+            , format_(format)
+            , buffer_()
+            , flush_threshold_(flush_threshold)
+            , compress_(compress)
+            , checksum_((format == EventsDatabaseFormat::BINARY) && !compress)
+            , strings_((format == EventsDatabaseFormat::BINARY) && !compress)
+            , root_((format == EventsDatabaseFormat::BINARY) ? session_root() : std::string())
+            , preallocate_(false)
+            , written_(0)
+            , allocated_(0)
+            , durability_(durability)
+            , unsynced_(0)
+            , last_sync_(std::chrono::steady_clock::now())
+            , base_()
+            , segment_limit_(0)
+            , segment_(0)
+            , segment_written_(0)
+            , index_enabled_(index)
+            , offset_(0)
+    {
+        buffer_.reserve(flush_threshold);
+        // The preallocation needs a seekable regular file; the current
+        // position tells where the appends start (nonzero on resume).
+        struct stat file_status {};
+        if ((fstat(file, &file_status) == 0) && S_ISREG(file_status.st_mode)) {
+            if (const off_t position = lseek(file, 0, SEEK_CUR); position != -1) {
+                preallocate_ = true;
+                written_ = size_t(position);
+                allocated_ = size_t(position);
+            }
+        }
+        errno = 0;
+    }
 
     EventsDatabaseWriter::~EventsDatabaseWriter() noexcept {
+        flush().unwrap_or(0);
+        // give back the reserved tail of the last extent; only the
+        // written bytes shall keep their blocks.
+        if (allocated_ > written_) {
+            release_file_tail(file_, written_);
+        }
         close(file_);
     }
 
     rust::Result<int> EventsDatabaseWriter::insert_event(const rpc::Event &event) {
-        return to_json(event)
-                .and_then<int>([this](const auto &json) {
-                    return write_to_file(json);
+        return insert_event_internal(event)
+                .and_then<int>([this](auto written) {
+                    return sync_event(written);
                 })
-                .and_then<int>([this](const auto &) {
-                    return write_to_file("\n");
+                .map_err<std::runtime_error>([this](const auto &error) {
+                    return describe(error, path_);
+                });
+    }
+
+    rust::Result<int, rust::Error> EventsDatabaseWriter::insert_event_internal(const rpc::Event &event) {
+        // The ring rotates between events, never inside one: an
+        // environment definition and the started event referencing it
+        // shall land in the same segment.
+        if ((segment_limit_ != 0) && (segment_written_ >= segment_limit_)) {
+            if (auto rotated = rotate_segment(); rotated.is_err()) {
+                return rotated;
+            }
+        }
+        // Nearly all captured executions share the same few environments.
+        // Store each distinct environment once (keyed by content hash) and
+        // replace the map in the started events with a reference to it.
+        // The reader resolves the references, so this stays transparent.
+        if (event.has_started() && !event.started().execution().environment().empty()) {
+            const auto &environment = event.started().execution().environment();
+            const auto id = hash_environment(environment);
+            if (known_environments_.insert(id).second) {
+                rpc::Event definition;
+                definition.set_rid(event.rid());
+                definition.mutable_environment()->set_id(id);
+                *definition.mutable_environment()->mutable_variables() = environment;
+                if (auto result = write_event(definition); result.is_err()) {
+                    return result;
+                }
+            }
+            rpc::Event stripped(event);
+            stripped.mutable_started()->mutable_execution()->clear_environment();
+            stripped.mutable_started()->mutable_execution()->set_environment_id(id);
+            if (!root_.empty() || strings_) {
+                if (auto encoded = encode_started(stripped); encoded.is_err()) {
+                    return encoded;
+                }
+            }
+            return write_event(stripped);
+        }
+        // The session root and the string table encodings apply to the
+        // started events of the binary format only; the header version
+        // announces them.
+        if (event.has_started() && (!root_.empty() || strings_)) {
+            rpc::Event encoded(event);
+            if (auto defined = encode_started(encoded); defined.is_err()) {
+                return defined;
+            }
+            return write_event(encoded);
+        }
+        return write_event(event);
+    }
+
+    // Encode the string carrying fields of the started event: nearly
+    // every path of a build shares the session root prefix (stored as a
+    // single byte), and the argument vectors repeat the same strings
+    // across records (stored as references into the string table). The
+    // definitions of the strings the event newly interned are written in
+    // front of it, so the readers always see a definition before its
+    // first reference.
+    rust::Result<int, rust::Error> EventsDatabaseWriter::encode_started(rpc::Event &event) noexcept {
+        auto *execution = event.mutable_started()->mutable_execution();
+        rpc::Event definition;
+        encode_path(*execution->mutable_executable(), root_);
+        intern_string(*execution->mutable_executable(), definition);
+        encode_path(*execution->mutable_working_dir(), root_);
+        intern_string(*execution->mutable_working_dir(), definition);
+        for (auto &argument : *execution->mutable_arguments()) {
+            encode_path(argument, root_);
+            intern_string(argument, definition);
+        }
+        if (definition.has_strings()) {
+            definition.set_rid(event.rid());
+            return write_event(definition);
+        }
+        return rust::Ok(1);
+    }
+
+    // Replace a repeated value with a reference into the string table
+    // (the marker byte and the 16 hex digit content hash of the value).
+    // A value is interned on its second occurrence:
+    // defining a one-off value (a source file name, typically) would
+    // only grow the file. Short values stay verbatim, a reference would
+    // not be smaller. The new definitions are collected into the given
+    // event.
+    void EventsDatabaseWriter::intern_string(std::string &value, rpc::Event &definition) {
+        if (!strings_ || (value.size() <= EVENTS_DB_STRING_REF_SIZE)) {
+            return;
+        }
+        uint64_t id = 0;
+        if (const auto it = interned_.find(value); it != interned_.end()) {
+            if (it->second == 0) {
+                // the second occurrence; intern it.
+                it->second = hash_string(value);
+                definition.mutable_strings()->add_ids(it->second);
+                definition.mutable_strings()->add_values(value);
+            }
+            id = it->second;
+        } else {
+            // remember the first occurrence, while the window lasts.
+            if (interned_.size() < EVENTS_DB_STRING_TABLE_LIMIT) {
+                interned_.emplace(value, 0);
+            }
+            return;
+        }
+        value.resize(EVENTS_DB_STRING_REF_SIZE);
+        value[0] = EVENTS_DB_STRING_MARKER;
+        for (size_t position = 1; position < EVENTS_DB_STRING_REF_SIZE; ++position) {
+            value[position] = "0123456789abcdef"[(id >> (60u - 4u * (position - 1))) & 0xfu];
+        }
+    }
+
+    rust::Result<int, rust::Error> EventsDatabaseWriter::write_event(const rpc::Event &event) noexcept {
+        return (format_ == EventsDatabaseFormat::BINARY)
+                ? insert_event_binary(event)
+                : insert_event_json(event);
+    }
+
+    rust::Result<int, rust::Error> EventsDatabaseWriter::insert_event_binary(const rpc::Event &event) noexcept {
+        // Assemble the length prefix, the checksum and the payload into a
+        // single buffer, so the record lands in the file with one write
+        // call. (The compressed files skip the per record checksum: the
+        // zstd frames detect their own corruption.)
+        const size_t prefix = EVENTS_DB_LENGTH_PREFIX_SIZE + (checksum_ ? EVENTS_DB_CRC_SIZE : 0);
+        std::string record(prefix, char(0));
+        if (!event.AppendToString(&record)) {
+            return rust::Err(rust::Error { 0, "Events db write failed", "serialization error" });
+        }
+        const auto length = uint32_t(record.size() - prefix);
+        record[0] = char(length & 0xffu);
+        record[1] = char((length >> 8u) & 0xffu);
+        record[2] = char((length >> 16u) & 0xffu);
+        record[3] = char((length >> 24u) & 0xffu);
+        if (checksum_) {
+            const auto crc = crc32c(std::string_view(record).substr(prefix));
+            record[4] = char(crc & 0xffu);
+            record[5] = char((crc >> 8u) & 0xffu);
+            record[6] = char((crc >> 16u) & 0xffu);
+            record[7] = char((crc >> 24u) & 0xffu);
+        }
+        if (index_enabled_) {
+            // The terminated and signalled events only carry the rid; the
+            // process identity is remembered from the started event of
+            // the same rid.
+            const auto kind = kind_of(event);
+            if (kind == EventsDatabaseEventKind::STARTED) {
+                rid_to_process_[event.rid()] = std::make_pair(event.started().pid(), event.started().ppid());
+            }
+            const auto it = rid_to_process_.find(event.rid());
+            const auto [pid, ppid] = (it != rid_to_process_.end()) ? it->second : std::make_pair(0u, 0u);
+            const auto timestamp =
+                    uint64_t(google::protobuf::util::TimeUtil::TimestampToMicroseconds(event.timestamp()));
+            index_.push_back(EventsDatabaseIndexEntry { event.rid(), offset_, length, pid, ppid, kind, timestamp });
+            offset_ += record.size();
+        }
+        return append(record);
+    }
+
+    const std::vector<EventsDatabaseIndexEntry> &EventsDatabaseWriter::index() const noexcept {
+        return index_;
+    }
+
+    rust::Result<int, rust::Error> EventsDatabaseWriter::insert_event_json(const rpc::Event &event) noexcept {
+        return to_json(event)
+                .and_then<int>([this](auto json) {
+                    json.push_back('\n');
+                    return append(json);
                 });
     }
 
-    rust::Result<std::string> EventsDatabaseWriter::to_json(const rpc::Event &event) noexcept {
+    rust::Result<std::string, rust::Error> EventsDatabaseWriter::to_json(const rpc::Event &event) noexcept {
         std::string json;
         if (const auto status = google::protobuf::util::MessageToJsonString(event, &json, print_options); !status.ok()) {
-            auto message = fmt::format(
-                    "Events db write failed (to file {}): JSON formatting error",
-                    path_.string()
-            );
-            return rust::Err(std::runtime_error(message));
+            return rust::Err(rust::Error { 0, "Events db write failed", "JSON formatting error" });
         }
         return rust::Ok(std::move(json));
     }
 
-    rust::Result<int> EventsDatabaseWriter::write_to_file(const std::string& content) noexcept {
+    rust::Result<int, rust::Error> EventsDatabaseWriter::append(const std::string &content) noexcept {
+        // Collect the records in memory, and write them out in batches.
+        // This amortizes the cost of the write system calls, which would
+        // otherwise dominate with many small events.
+        buffer_.append(content);
+        segment_written_ += content.size();
+        return (buffer_.size() >= flush_threshold_)
+                ? flush_buffer()
+                : rust::Ok(1);
+    }
+
+    rust::Result<int> EventsDatabaseWriter::flush() noexcept {
+        // The closing flush honors the policy too: a synced file shall be
+        // fully on the disk when the writer goes away.
+        auto result = (durability_ == EventsDatabaseDurability::NONE)
+                ? flush_buffer()
+                : sync();
+        return result
+                .map_err<std::runtime_error>([this](const auto &error) {
+                    return describe(error, path_);
+                });
+    }
+
+    // Applies the durability policy after a successful insert; returns
+    // the insert result unchanged when no sync is due.
+    rust::Result<int, rust::Error> EventsDatabaseWriter::sync_event(const int written) noexcept {
+        switch (durability_) {
+            case EventsDatabaseDurability::STRICT:
+                break;
+            case EventsDatabaseDurability::GROUP:
+                if ((++unsynced_ < GROUP_COMMIT_EVENTS)
+                        && (std::chrono::steady_clock::now() - last_sync_ < GROUP_COMMIT_INTERVAL)) {
+                    return rust::Ok(written);
+                }
+                break;
+            default:
+                return rust::Ok(written);
+        }
+        return sync().map<int>([&written](auto) { return written; });
+    }
+
+    // Pushes the buffered records to the file and asks the kernel to
+    // persist its content. (fdatasync skips the metadata-only updates a
+    // full fsync would also wait for; the file size changes it needs for
+    // reading the data back are covered.)
+    rust::Result<int, rust::Error> EventsDatabaseWriter::sync() noexcept {
+        return flush_buffer()
+                .and_then<int>([this](auto) -> rust::Result<int, rust::Error> {
+                    if (fdatasync(file_) == -1) {
+                        const int code = errno;
+                        errno = 0;
+                        return rust::Err(rust::Error { code, "Events db sync failed" });
+                    }
+                    unsynced_ = 0;
+                    last_sync_ = std::chrono::steady_clock::now();
+                    return rust::Ok(1);
+                });
+    }
+
+    // Finishes the current segment, reclaims what the consumer is done
+    // with, and opens the next segment with a fresh header.
+    rust::Result<int, rust::Error> EventsDatabaseWriter::rotate_segment() noexcept {
+        // The segment shall be complete (and as durable as the policy
+        // asks for) before its successor announces it as finished.
+        auto finished = (durability_ == EventsDatabaseDurability::NONE)
+                ? flush_buffer()
+                : sync();
+        if (finished.is_err()) {
+            return finished;
+        }
+        if (allocated_ > written_) {
+            release_file_tail(file_, written_);
+        }
+        close(file_);
+        // Remove the consumed segments, newest first, stopping at the
+        // first one already gone: everything below it was reclaimed by
+        // an earlier rotation.
+        const auto watermark = std::min(ring_consumed_watermark(base_), segment_);
+        for (uint64_t number = watermark; number >= 1; --number) {
+            std::error_code error_code;
+            if (!fs::remove(ring_segment_path(base_, number), error_code)) {
+                break;
+            }
+        }
+        segment_ += 1;
+        path_ = ring_segment_path(base_, segment_);
+        file_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 00644);
+        if (file_ == -1) {
+            const int code = errno;
+            errno = 0;
+            return rust::Err(rust::Error { code, "Events db open failed" });
+        }
+        segment_written_ = 0;
+        // the fresh segment starts its own reservation; the support of
+        // the filesystem did not change.
+        written_ = 0;
+        allocated_ = 0;
+        // Every segment is a standalone file: the environments and the
+        // strings get defined again in the new one on first use.
+        known_environments_.clear();
+        interned_.clear();
+        auto header = create_file_header(root_.empty() ? EVENTS_DB_VERSION_STRINGS : EVENTS_DB_VERSION_STRINGS_ROOTED);
+        if (!root_.empty()) {
+            append_root(header, root_);
+        }
+        return append(header);
+    }
+
+    rust::Result<int, rust::Error> EventsDatabaseWriter::flush_buffer() noexcept {
+        if (buffer_.empty()) {
+            return rust::Ok(1);
+        }
+        // With compression each batch becomes a single zstd frame, which
+        // lets the reader decompress the file in a streaming fashion.
+        auto result = compress_
+                ? zstd_compress_frame(buffer_)
+                        .and_then<int>([this](const auto &frame) {
+                            return write_to_file(frame);
+                        })
+                : write_to_file(buffer_);
+        buffer_.clear();
+        return result;
+    }
+
+    rust::Result<int, rust::Error> EventsDatabaseWriter::write_to_file(const std::string& content) noexcept {
+        // Reserve the file space ahead in large extents: the incremental
+        // appends of a long session would fragment the file extent by
+        // extent otherwise, and the later sequential reads (the mmap of
+        // the consumers) would pay for it. The first refusal turns the
+        // reservation off; the appends work without it.
+        if (preallocate_ && (written_ + content.size() > allocated_)) {
+            size_t reserve = PREALLOCATION_EXTENT;
+            while (allocated_ + reserve < written_ + content.size()) {
+                reserve += PREALLOCATION_EXTENT;
+            }
+            if (reserve_file_range(file_, allocated_, reserve)) {
+                allocated_ += reserve;
+            } else {
+                preallocate_ = false;
+            }
+        }
         const char* content_ptr = content.c_str();
         size_t content_length = content.size();
         while (content_length) {
             const int written_length = write(file_, content_ptr, content_length);
             if (written_length == -1) {
-                auto message = fmt::format(
-                        "Events db write failed (to file {}): {}",
-                        path_.string(),
-                        sys::error_string(errno)
-                );
+                const int code = errno;
                 errno = 0;
-                return rust::Err(std::runtime_error(message));
+                return rust::Err(rust::Error { code, "Events db write failed" });
             }
             content_length -= written_length;
             content_ptr += written_length;
+            written_ += size_t(written_length);
         }
         return rust::Ok(1);
     }
@@ -20,38 +20,168 @@
 #pragma once
 
 #include "config.h"
+#include "collect/db/EventsDatabaseFormat.h"
+#include "libresult/Error.h"
 #include "libresult/Result.h"
 #include "intercept.pb.h"
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include <chrono>
 #include <filesystem>
+#include <map>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace ic::collect::db {
 
+    // How eagerly the written events shall reach the disk. NONE leaves
+    // it to the kernel (a host crash can lose everything the page cache
+    // still holds); GROUP issues a data sync when enough events or enough
+    // time accumulated since the last one, which bounds the loss to a
+    // short window without a per event disk wait; STRICT syncs after
+    // every event.
+    enum class EventsDatabaseDurability {
+        NONE,
+        GROUP,
+        STRICT,
+    };
+
     class EventsDatabaseWriter {
     public:
         using Ptr = std::shared_ptr<EventsDatabaseWriter>;
 
-        [[nodiscard]] static rust::Result<EventsDatabaseWriter::Ptr> create(const fs::path &file);
+        // The default amount of buffered bytes before the content is
+        // written to the file with a single write call.
+        static constexpr size_t DEFAULT_FLUSH_THRESHOLD = 64 * 1024;
+
+        // The group commit policy syncs after this many events, or when
+        // this much time passed since the last sync, whichever comes
+        // first.
+        static constexpr size_t GROUP_COMMIT_EVENTS = 256;
+        static constexpr std::chrono::milliseconds GROUP_COMMIT_INTERVAL {1000};
+
+        // The default segment size of the ring mode. Large enough that
+        // the per segment overhead (header, repeated environment
+        // definitions) stays negligible, small enough that the consumer
+        // gets finished segments at a steady pace.
+        static constexpr size_t DEFAULT_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+        [[nodiscard]] static rust::Result<EventsDatabaseWriter::Ptr> create(
+                const fs::path &file,
+                EventsDatabaseFormat format = EventsDatabaseFormat::BINARY,
+                size_t flush_threshold = DEFAULT_FLUSH_THRESHOLD,
+                bool compress = false,
+                bool index = false,
+                EventsDatabaseDurability durability = EventsDatabaseDurability::NONE);
+        // Reopens an existing uncompressed binary events file and appends
+        // to it. The records are scanned from the header, and a torn
+        // final record (a crashed writer can leave one behind) is cut
+        // off, so the new records land after the last complete one. The
+        // file shall carry the session root of this process: the records
+        // encode their paths against it, and a resumed run from another
+        // directory would mix two encodings. The environment interning
+        // starts afresh; a repeated definition is harmless for the
+        // readers. The string table interning starts afresh too; the
+        // ids are content hashes, so the appended definitions agree
+        // with the earlier ones. A file from before the per record
+        // checksums is refused: the appended records would not match
+        // its framing.
+        [[nodiscard]] static rust::Result<EventsDatabaseWriter::Ptr> resume(
+                const fs::path &file,
+                size_t flush_threshold = DEFAULT_FLUSH_THRESHOLD,
+                EventsDatabaseDurability durability = EventsDatabaseDurability::NONE);
+        // A ring writer for sessions with no natural end (the daemon
+        // mode): the output is split into fixed size segments (see
+        // EventsDatabaseRing.h for the naming and the consumption
+        // watermark), and the consumed segments are removed on rotation,
+        // so the disk usage stays bounded. The segments are uncompressed
+        // binary files; the numbering continues after any segments a
+        // previous session left behind. The rotation happens between
+        // events, so a segment never ends mid record.
+        [[nodiscard]] static rust::Result<EventsDatabaseWriter::Ptr> ring(
+                const fs::path &base,
+                size_t segment_size = DEFAULT_SEGMENT_SIZE,
+                size_t flush_threshold = DEFAULT_FLUSH_THRESHOLD,
+                EventsDatabaseDurability durability = EventsDatabaseDurability::NONE);
+        // The session root the binary files store in their header: the
+        // working directory of the process, captured once. Every writer
+        // of the process (the shards and the merged output) shares it,
+        // so their headers agree. Empty when there is no usable root.
+        [[nodiscard]] static const std::string &session_root() noexcept;
         [[nodiscard]] rust::Result<int> insert_event(const rpc::Event &event);
+        [[nodiscard]] rust::Result<int> flush() noexcept;
+        // The index entries of the written records. The offsets are
+        // relative to the end of the file header.
+        [[nodiscard]] const std::vector<EventsDatabaseIndexEntry> &index() const noexcept;
 
     public:
-        explicit EventsDatabaseWriter(fs::path path, int file) noexcept;
+        explicit EventsDatabaseWriter(fs::path path, int file, EventsDatabaseFormat format, size_t flush_threshold, bool compress, bool index, EventsDatabaseDurability durability) noexcept;
         ~EventsDatabaseWriter() noexcept;
 
         NON_DEFAULT_CONSTRUCTABLE(EventsDatabaseWriter)
         NON_COPYABLE_NOR_MOVABLE(EventsDatabaseWriter)
 
     private:
-        rust::Result<std::string> to_json(const rpc::Event &event) noexcept;
-        rust::Result<int> write_to_file(const std::string &content) noexcept;
+        // The per event path raises the non allocating error type; the
+        // public methods convert it (adding the file name) on the way out.
+        rust::Result<int, rust::Error> insert_event_internal(const rpc::Event &event);
+        rust::Result<int, rust::Error> encode_started(rpc::Event &event) noexcept;
+        void intern_string(std::string &value, rpc::Event &definition);
+        rust::Result<int, rust::Error> write_event(const rpc::Event &event) noexcept;
+        rust::Result<int, rust::Error> insert_event_binary(const rpc::Event &event) noexcept;
+        rust::Result<int, rust::Error> insert_event_json(const rpc::Event &event) noexcept;
+        rust::Result<std::string, rust::Error> to_json(const rpc::Event &event) noexcept;
+        rust::Result<int, rust::Error> append(const std::string &content) noexcept;
+        rust::Result<int, rust::Error> flush_buffer() noexcept;
+        rust::Result<int, rust::Error> write_to_file(const std::string &content) noexcept;
+        rust::Result<int, rust::Error> sync_event(int written) noexcept;
+        rust::Result<int, rust::Error> sync() noexcept;
+        rust::Result<int, rust::Error> rotate_segment() noexcept;
 
     private:
         fs::path path_;
         int file_;
+        EventsDatabaseFormat format_;
+        std::string buffer_;
+        size_t flush_threshold_;
+        bool compress_;
+        // The uncompressed binary records carry a per record checksum;
+        // the file header version announces it to the readers.
+        bool checksum_;
+        // The uncompressed binary records store their repeated strings
+        // as references into the per file string table; the header
+        // version announces the encoding. The map remembers every value
+        // seen once (id zero) and the interned ones (their content
+        // hash), bounded by the table window.
+        bool strings_;
+        std::unordered_map<std::string, uint64_t> interned_;
+        std::string root_;
+        // The file space is reserved ahead of the appends in large
+        // extents, so a long session stays on contiguous disk (see
+        // write_to_file). The counters track the written bytes and the
+        // end of the reserved range; the flag turns the reservation off
+        // on a file (or platform) which does not support it.
+        bool preallocate_;
+        size_t written_;
+        size_t allocated_;
+        EventsDatabaseDurability durability_;
+        size_t unsynced_;
+        std::chrono::steady_clock::time_point last_sync_;
+        // The ring mode state; a zero segment limit means no ring.
+        fs::path base_;
+        size_t segment_limit_;
+        uint64_t segment_;
+        size_t segment_written_;
+        std::unordered_set<uint64_t> known_environments_;
+        bool index_enabled_;
+        size_t offset_;
+        std::vector<EventsDatabaseIndexEntry> index_;
+        std::map<uint64_t, std::pair<uint32_t, uint32_t>> rid_to_process_;
     };
 }
@@ -0,0 +1,249 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ExternalDedup.h"
+
+#include <fmt/format.h>
+
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+    // Buckets per partitioning step; 4 key bits are consumed by each.
+    constexpr size_t FAN_OUT = 16;
+    constexpr size_t BITS_PER_LEVEL = 4;
+    // The key space is 64 bits. In a bucket split by the last level every
+    // key is equal, so the recursion always terminates.
+    constexpr size_t LEVEL_LIMIT = 64 / BITS_PER_LEVEL;
+    // Estimated heap cost of one entry of the resident key map.
+    constexpr size_t KEY_ENTRY_COST = 64;
+
+    // The record header in the spill files, all fields little endian:
+    // the key, the owner, the head flag and the record length.
+    constexpr size_t HEADER_SIZE = 8 + 8 + 1 + 4;
+
+    size_t bucket_of(uint64_t key, size_t level) {
+        return size_t(key >> (64 - BITS_PER_LEVEL * (level + 1))) & (FAN_OUT - 1);
+    }
+
+    void append_uint32(std::string &content, uint32_t value) {
+        content.push_back(char(value & 0xffu));
+        content.push_back(char((value >> 8u) & 0xffu));
+        content.push_back(char((value >> 16u) & 0xffu));
+        content.push_back(char((value >> 24u) & 0xffu));
+    }
+
+    void append_uint64(std::string &content, uint64_t value) {
+        append_uint32(content, uint32_t(value));
+        append_uint32(content, uint32_t(value >> 32u));
+    }
+
+    uint32_t read_uint32(const char *bytes) {
+        return uint32_t(uint8_t(bytes[0]))
+                | (uint32_t(uint8_t(bytes[1])) << 8u)
+                | (uint32_t(uint8_t(bytes[2])) << 16u)
+                | (uint32_t(uint8_t(bytes[3])) << 24u);
+    }
+
+    uint64_t read_uint64(const char *bytes) {
+        return uint64_t(read_uint32(bytes)) | (uint64_t(read_uint32(bytes + 4)) << 32u);
+    }
+
+    bool write_record(std::ofstream &target, uint64_t key, uint64_t owner, bool head, std::string_view record) {
+        std::string header;
+        header.reserve(HEADER_SIZE);
+        append_uint64(header, key);
+        append_uint64(header, owner);
+        header.push_back(head ? char(1) : char(0));
+        append_uint32(header, uint32_t(record.size()));
+        target.write(header.data(), std::streamsize(header.size()));
+        target.write(record.data(), std::streamsize(record.size()));
+        return target.good();
+    }
+}
+
+namespace ic::collect::db {
+
+    ExternalDedup::ExternalDedup(fs::path output, size_t memory_budget)
+            : output_(std::move(output))
+            , memory_budget_(memory_budget)
+            , next_spill_(0)
+            , bucket_paths_()
+            , bucket_counts_()
+            , buckets_()
+    { }
+
+    ExternalDedup::~ExternalDedup() noexcept {
+        // Remove the spill files of an abandoned (not drained) stage.
+        buckets_.clear();
+        for (const auto &path : bucket_paths_) {
+            std::error_code error_code;
+            fs::remove(path, error_code);
+        }
+    }
+
+    fs::path ExternalDedup::spill_path() {
+        return fs::path(fmt::format("{}.dedup.{}", output_.string(), next_spill_++));
+    }
+
+    rust::Result<int> ExternalDedup::insert(uint64_t key, uint64_t owner, bool head, std::string_view record) {
+        if (buckets_.empty()) {
+            buckets_.reserve(FAN_OUT);
+            for (size_t index = 0; index < FAN_OUT; ++index) {
+                auto path = spill_path();
+                auto stream = std::make_unique<std::ofstream>(path, std::ios::out | std::ios::trunc | std::ios::binary);
+                if (!stream->is_open()) {
+                    auto message = fmt::format("Dedup spill failed (file {}): can not create", path.string());
+                    return rust::Err(std::runtime_error(message));
+                }
+                bucket_paths_.emplace_back(std::move(path));
+                buckets_.emplace_back(std::move(stream));
+            }
+            bucket_counts_.assign(FAN_OUT, 0);
+        }
+        const size_t bucket = bucket_of(key, 0);
+        if (!write_record(*buckets_[bucket], key, owner, head, record)) {
+            auto message = fmt::format("Dedup spill failed (file {}): write error", bucket_paths_[bucket].string());
+            return rust::Err(std::runtime_error(message));
+        }
+        ++bucket_counts_[bucket];
+        return rust::Ok(0);
+    }
+
+    rust::Result<size_t> ExternalDedup::drain(const std::function<rust::Result<int>(std::string_view)> &consumer) {
+        // Flush and close the phase one writers before the buckets are read.
+        buckets_.clear();
+        size_t count = 0;
+        for (size_t index = 0; index < bucket_paths_.size(); ++index) {
+            auto result = drain_bucket(bucket_paths_[index], bucket_counts_[index], 0, consumer);
+            if (result.is_err()) {
+                return result;
+            }
+            count += result.unwrap();
+            std::error_code error_code;
+            fs::remove(bucket_paths_[index], error_code);
+        }
+        bucket_paths_.clear();
+        bucket_counts_.clear();
+        return rust::Ok(count);
+    }
+
+    rust::Result<size_t> ExternalDedup::drain_bucket(
+            const fs::path &path,
+            const size_t records,
+            const size_t level,
+            const std::function<rust::Result<int>(std::string_view)> &consumer) {
+        // The key set of the bucket shall fit the budget. The record count
+        // bounds the key count; when even that is over the budget, the
+        // bucket is split into children by further key bits instead of
+        // guessing. (A duplicate heavy bucket may get split needlessly,
+        // but the children shrink on every level, so it settles.)
+        const size_t capacity = (memory_budget_ > KEY_ENTRY_COST)
+                ? memory_budget_ / KEY_ENTRY_COST
+                : 1;
+        const bool splittable = (level + 1 < LEVEL_LIMIT);
+
+        std::ifstream source(path, std::ios::in | std::ios::binary);
+        if (!source.is_open()) {
+            auto message = fmt::format("Dedup spill failed (file {}): can not read back", path.string());
+            return rust::Err(std::runtime_error(message));
+        }
+        char header[HEADER_SIZE];
+        std::string record;
+
+        if (splittable && (records > capacity)) {
+            std::vector<fs::path> child_paths;
+            std::vector<size_t> child_counts(FAN_OUT, 0);
+            std::vector<std::unique_ptr<std::ofstream>> children;
+            children.reserve(FAN_OUT);
+            for (size_t child = 0; child < FAN_OUT; ++child) {
+                auto child_path = spill_path();
+                auto stream = std::make_unique<std::ofstream>(child_path, std::ios::out | std::ios::trunc | std::ios::binary);
+                if (!stream->is_open()) {
+                    auto message = fmt::format("Dedup spill failed (file {}): can not create", child_path.string());
+                    return rust::Err(std::runtime_error(message));
+                }
+                child_paths.emplace_back(std::move(child_path));
+                children.emplace_back(std::move(stream));
+            }
+            while (source.read(header, HEADER_SIZE)) {
+                const uint64_t key = read_uint64(header);
+                const uint32_t length = read_uint32(header + 17);
+                record.resize(length);
+                if (!source.read(record.data(), std::streamsize(length))) {
+                    auto message = fmt::format("Dedup spill failed (file {}): truncated record", path.string());
+                    return rust::Err(std::runtime_error(message));
+                }
+                const size_t child = bucket_of(key, level + 1);
+                if (!write_record(*children[child], key, read_uint64(header + 8), header[16] != char(0), record)) {
+                    auto message = fmt::format("Dedup spill failed (file {}): write error", child_paths[child].string());
+                    return rust::Err(std::runtime_error(message));
+                }
+                ++child_counts[child];
+            }
+            children.clear();
+            size_t count = 0;
+            for (size_t child = 0; child < FAN_OUT; ++child) {
+                auto result = drain_bucket(child_paths[child], child_counts[child], level + 1, consumer);
+                if (result.is_err()) {
+                    return result;
+                }
+                count += result.unwrap();
+                std::error_code error_code;
+                fs::remove(child_paths[child], error_code);
+            }
+            return rust::Ok(count);
+        }
+
+        // The winner of each key: the owner of the first head record.
+        std::unordered_map<uint64_t, uint64_t> winners;
+        size_t count = 0;
+        while (source.read(header, HEADER_SIZE)) {
+            const uint64_t key = read_uint64(header);
+            const uint64_t owner = read_uint64(header + 8);
+            const bool head = (header[16] != char(0));
+            const uint32_t length = read_uint32(header + 17);
+            record.resize(length);
+            if (!source.read(record.data(), std::streamsize(length))) {
+                auto message = fmt::format("Dedup spill failed (file {}): truncated record", path.string());
+                return rust::Err(std::runtime_error(message));
+            }
+            if (head) {
+                if (!winners.emplace(key, owner).second) {
+                    continue;
+                }
+            } else {
+                // A follower survives with its head; one without a head
+                // record seen is passed through.
+                const auto winner = winners.find(key);
+                if ((winner != winners.end()) && (winner->second != owner)) {
+                    continue;
+                }
+            }
+            if (auto delivered = consumer(record); delivered.is_err()) {
+                return rust::Err(delivered.unwrap_err());
+            }
+            ++count;
+        }
+        return rust::Ok(count);
+    }
+}
@@ -0,0 +1,84 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libresult/Result.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace ic::collect::db {
+
+    // Deduplicates a stream of records by a 64 bit content key, with the
+    // memory use bounded by a budget. Meant for inputs beyond the RAM
+    // size, where an in memory key set does not fit.
+    //
+    // The records are partitioned by their key into temporary bucket
+    // files first, then each bucket is deduplicated on its own: only one
+    // bucket's key set is resident at a time. A bucket whose key set
+    // would exceed the budget is repartitioned by further key bits. All
+    // file traffic is sequential. The records come back reordered across
+    // buckets (and only there): record order is kept within a bucket.
+    //
+    // A record may belong to a group (head record plus followers, like a
+    // process start event and its lifecycle events): when the head is
+    // dropped as a duplicate, the followers of the same owner are dropped
+    // with it. Standalone records are their own head.
+    class ExternalDedup {
+    public:
+        // The spill files are created next to the given path, named after
+        // it. The budget is in bytes; it bounds the resident key set, not
+        // the spill files.
+        ExternalDedup(fs::path output, size_t memory_budget);
+        ~ExternalDedup() noexcept;
+
+        // Route the record into its bucket. The key identifies the record
+        // content, the owner ties the followers to their head record.
+        [[nodiscard]] rust::Result<int> insert(uint64_t key, uint64_t owner, bool head, std::string_view record);
+
+        // Deduplicate the buckets and pass the surviving records to the
+        // consumer. Removes the spill files; the stage is drained once.
+        // Returns the number of records the consumer received.
+        [[nodiscard]] rust::Result<size_t> drain(const std::function<rust::Result<int>(std::string_view)> &consumer);
+
+        NON_DEFAULT_CONSTRUCTABLE(ExternalDedup)
+        NON_COPYABLE_NOR_MOVABLE(ExternalDedup)
+
+    private:
+        [[nodiscard]] rust::Result<size_t> drain_bucket(const fs::path &path, size_t records, size_t level, const std::function<rust::Result<int>(std::string_view)> &consumer);
+        [[nodiscard]] fs::path spill_path();
+
+    private:
+        fs::path output_;
+        size_t memory_budget_;
+        size_t next_spill_;
+        std::vector<fs::path> bucket_paths_;
+        std::vector<size_t> bucket_counts_;
+        std::vector<std::unique_ptr<std::ofstream>> buckets_;
+    };
+}
@@ -0,0 +1,141 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PrefetchStream.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    using StreamPtr = std::unique_ptr<std::istream>;
+
+    // The block size trades memory for fewer hand overs between the
+    // threads. Two of these are in flight.
+    constexpr size_t PREFETCH_BLOCK_SIZE = 256 * 1024;
+
+    // Double buffered read ahead. The reader thread fills the back block
+    // from the wrapped stream, while the get area of the stream buffer
+    // serves the consumer from the front block. The underflow swaps the
+    // two and wakes the reader to fill the freed one.
+    class PrefetchStreamBuf : public std::streambuf {
+    public:
+        explicit PrefetchStreamBuf(StreamPtr source)
+                : source_(std::move(source))
+                , front_(PREFETCH_BLOCK_SIZE)
+                , back_(PREFETCH_BLOCK_SIZE)
+                , back_size_(0)
+                , back_ready_(false)
+                , finished_(false)
+                , reader_([this]() { fill(); })
+        { }
+
+        // The reader thread holds at most one outstanding read on the
+        // source; the join waits for that (and only that) to return when
+        // the consumer quits mid stream.
+        ~PrefetchStreamBuf() override {
+            {
+                const std::lock_guard<std::mutex> guard(mutex_);
+                finished_ = true;
+            }
+            reader_wakeup_.notify_all();
+            reader_.join();
+        }
+
+        PrefetchStreamBuf(PrefetchStreamBuf const &) = delete;
+        PrefetchStreamBuf &operator=(PrefetchStreamBuf const &) = delete;
+
+    protected:
+        int_type underflow() override {
+            std::unique_lock<std::mutex> lock(mutex_);
+            consumer_wakeup_.wait(lock, [this]() { return back_ready_ || finished_; });
+            if (!back_ready_) {
+                return traits_type::eof();
+            }
+            front_.swap(back_);
+            const size_t size = back_size_;
+            back_ready_ = false;
+            lock.unlock();
+            reader_wakeup_.notify_one();
+
+            setg(front_.data(), front_.data(), front_.data() + size);
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        void fill() {
+            for (;;) {
+                // Read without the lock held; the back block is owned by
+                // this thread whenever it is not marked ready.
+                source_->read(back_.data(), std::streamsize(back_.size()));
+                const auto count = size_t(source_->gcount());
+
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (count == 0) {
+                    finished_ = true;
+                    consumer_wakeup_.notify_one();
+                    return;
+                }
+                back_size_ = count;
+                back_ready_ = true;
+                consumer_wakeup_.notify_one();
+                reader_wakeup_.wait(lock, [this]() { return !back_ready_ || finished_; });
+                if (finished_) {
+                    return;
+                }
+            }
+        }
+
+    private:
+        StreamPtr source_;
+        std::vector<char> front_;
+        std::vector<char> back_;
+        size_t back_size_;
+        bool back_ready_;
+        bool finished_;
+        std::mutex mutex_;
+        std::condition_variable consumer_wakeup_;
+        std::condition_variable reader_wakeup_;
+        std::thread reader_;
+    };
+
+    class PrefetchStream : public std::istream {
+    public:
+        explicit PrefetchStream(StreamPtr source)
+                : std::istream(nullptr)
+                , buffer_(std::move(source))
+        {
+            rdbuf(&buffer_);
+        }
+
+    private:
+        PrefetchStreamBuf buffer_;
+    };
+}
+
+namespace ic::collect::db {
+
+    std::unique_ptr<std::istream> prefetch_stream(std::unique_ptr<std::istream> source) noexcept {
+        return std::make_unique<PrefetchStream>(std::move(source));
+    }
+}
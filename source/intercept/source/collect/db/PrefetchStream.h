@@ -0,0 +1,34 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <istream>
+#include <memory>
+
+namespace ic::collect::db {
+
+    // Wraps the stream into one which reads ahead on a dedicated thread.
+    // Two blocks are kept: while the consumer parses the current one, the
+    // reader thread fills the next. The parsing therefore does not stall
+    // on partial pipe reads, nor on cold cache file reads.
+    [[nodiscard]] std::unique_ptr<std::istream> prefetch_stream(std::unique_ptr<std::istream> source) noexcept;
+}
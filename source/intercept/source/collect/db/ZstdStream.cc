@@ -0,0 +1,233 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ZstdStream.h"
+
+#ifdef HAVE_ZSTD
+
+#include <zstd.h>
+
+#include <streambuf>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    using StreamPtr = std::unique_ptr<std::istream>;
+
+    // Decompresses a sequence of zstd frames from the wrapped stream.
+    // The get area of the stream buffer is refilled frame chunk by frame
+    // chunk as the consumer drains it.
+    class ZstdInputStreamBuf : public std::streambuf {
+    public:
+        explicit ZstdInputStreamBuf(StreamPtr source, ZSTD_DStream *context)
+                : source_(std::move(source))
+                , context_(context)
+                , compressed_(ZSTD_DStreamInSize())
+                , compressed_view_{compressed_.data(), 0, 0}
+                , decompressed_(ZSTD_DStreamOutSize())
+        { }
+
+        ~ZstdInputStreamBuf() override {
+            ZSTD_freeDStream(context_);
+        }
+
+        ZstdInputStreamBuf(ZstdInputStreamBuf const &) = delete;
+        ZstdInputStreamBuf &operator=(ZstdInputStreamBuf const &) = delete;
+
+    protected:
+        int_type underflow() override {
+            while (true) {
+                if (compressed_view_.pos >= compressed_view_.size) {
+                    source_->read(compressed_.data(), compressed_.size());
+                    compressed_view_.size = size_t(source_->gcount());
+                    compressed_view_.pos = 0;
+                    if (compressed_view_.size == 0) {
+                        return traits_type::eof();
+                    }
+                }
+                ZSTD_outBuffer output = {decompressed_.data(), decompressed_.size(), 0};
+                const auto status = ZSTD_decompressStream(context_, &output, &compressed_view_);
+                if (ZSTD_isError(status)) {
+                    return traits_type::eof();
+                }
+                if (output.pos > 0) {
+                    setg(decompressed_.data(), decompressed_.data(), decompressed_.data() + output.pos);
+                    return traits_type::to_int_type(*gptr());
+                }
+            }
+        }
+
+    private:
+        StreamPtr source_;
+        ZSTD_DStream *context_;
+        std::vector<char> compressed_;
+        ZSTD_inBuffer compressed_view_;
+        std::vector<char> decompressed_;
+    };
+
+    class ZstdInputStream : public std::istream {
+    public:
+        explicit ZstdInputStream(StreamPtr source, ZSTD_DStream *context)
+                : std::istream(nullptr)
+                , buffer_(std::move(source), context)
+        {
+            rdbuf(&buffer_);
+        }
+
+    private:
+        ZstdInputStreamBuf buffer_;
+    };
+
+    using SinkPtr = std::unique_ptr<std::ostream>;
+
+    // Compresses the put area into the wrapped stream whenever it fills
+    // up; the destructor drains the leftover and closes the frame.
+    class ZstdOutputStreamBuf : public std::streambuf {
+    public:
+        explicit ZstdOutputStreamBuf(SinkPtr sink, ZSTD_CStream *context)
+                : sink_(std::move(sink))
+                , context_(context)
+                , input_(ZSTD_CStreamInSize())
+                , output_(ZSTD_CStreamOutSize())
+        {
+            setp(input_.data(), input_.data() + input_.size());
+        }
+
+        ~ZstdOutputStreamBuf() override {
+            drain(ZSTD_e_end);
+            ZSTD_freeCStream(context_);
+        }
+
+        ZstdOutputStreamBuf(ZstdOutputStreamBuf const &) = delete;
+        ZstdOutputStreamBuf &operator=(ZstdOutputStreamBuf const &) = delete;
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (!drain(ZSTD_e_continue)) {
+                return traits_type::eof();
+            }
+            if (ch != traits_type::eof()) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override {
+            return drain(ZSTD_e_flush) ? 0 : -1;
+        }
+
+    private:
+        bool drain(ZSTD_EndDirective mode) {
+            ZSTD_inBuffer input = {input_.data(), size_t(pptr() - pbase()), 0};
+            size_t remaining = 0;
+            do {
+                ZSTD_outBuffer output = {output_.data(), output_.size(), 0};
+                remaining = ZSTD_compressStream2(context_, &output, &input, mode);
+                if (ZSTD_isError(remaining)) {
+                    return false;
+                }
+                sink_->write(output_.data(), std::streamsize(output.pos));
+            } while ((input.pos < input.size) || ((mode != ZSTD_e_continue) && (remaining != 0)));
+            setp(input_.data(), input_.data() + input_.size());
+            if (mode != ZSTD_e_continue) {
+                sink_->flush();
+            }
+            return sink_->good();
+        }
+
+    private:
+        SinkPtr sink_;
+        ZSTD_CStream *context_;
+        std::vector<char> input_;
+        std::vector<char> output_;
+    };
+
+    class ZstdOutputStream : public std::ostream {
+    public:
+        explicit ZstdOutputStream(SinkPtr sink, ZSTD_CStream *context)
+                : std::ostream(nullptr)
+                , buffer_(std::move(sink), context)
+        {
+            rdbuf(&buffer_);
+        }
+
+    private:
+        ZstdOutputStreamBuf buffer_;
+    };
+}
+
+namespace ic::collect::db {
+
+    bool zstd_supported() noexcept {
+        return true;
+    }
+
+    rust::Result<std::string, rust::Error> zstd_compress_frame(const std::string &content) noexcept {
+        std::string result;
+        result.resize(ZSTD_compressBound(content.size()));
+        const auto status = ZSTD_compress(result.data(), result.size(), content.data(), content.size(), ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(status)) {
+            // The zstd error names are string literals.
+            return rust::Err(rust::Error { 0, "Events db compression failed", ZSTD_getErrorName(status) });
+        }
+        result.resize(status);
+        return rust::Ok(std::move(result));
+    }
+
+    std::unique_ptr<std::istream> zstd_decompress_stream(std::unique_ptr<std::istream> source) noexcept {
+        ZSTD_DStream *context = ZSTD_createDStream();
+        if (context == nullptr) {
+            return nullptr;
+        }
+        return std::make_unique<ZstdInputStream>(std::move(source), context);
+    }
+
+    std::unique_ptr<std::ostream> zstd_compress_stream(std::unique_ptr<std::ostream> sink) noexcept {
+        ZSTD_CStream *context = ZSTD_createCStream();
+        if (context == nullptr) {
+            return nullptr;
+        }
+        return std::make_unique<ZstdOutputStream>(std::move(sink), context);
+    }
+}
+
+#else
+
+namespace ic::collect::db {
+
+    bool zstd_supported() noexcept {
+        return false;
+    }
+
+    rust::Result<std::string, rust::Error> zstd_compress_frame(const std::string &) noexcept {
+        return rust::Err(rust::Error { 0, "Events db compression failed", "zstd support is not built in" });
+    }
+
+    std::unique_ptr<std::istream> zstd_decompress_stream(std::unique_ptr<std::istream>) noexcept {
+        return nullptr;
+    }
+
+    std::unique_ptr<std::ostream> zstd_compress_stream(std::unique_ptr<std::ostream>) noexcept {
+        return nullptr;
+    }
+}
+
+#endif
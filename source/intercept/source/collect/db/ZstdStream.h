@@ -0,0 +1,53 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libresult/Error.h"
+#include "libresult/Result.h"
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace ic::collect::db {
+
+    // Tells if the zstd compression support was built in.
+    [[nodiscard]] bool zstd_supported() noexcept;
+
+    // Compresses the content into a single self contained zstd frame.
+    // (Raises the non allocating error type: this runs on the event write
+    // path, whenever a write batch is flushed.)
+    [[nodiscard]] rust::Result<std::string, rust::Error> zstd_compress_frame(const std::string &content) noexcept;
+
+    // Wraps the stream into one which decompresses a sequence of zstd
+    // frames on the fly. The decompression is streaming: the memory use
+    // stays bounded regardless of the file size. Returns null when the
+    // zstd support is not built in (or the context creation failed).
+    [[nodiscard]] std::unique_ptr<std::istream> zstd_decompress_stream(std::unique_ptr<std::istream> source) noexcept;
+
+    // Wraps the stream into one which compresses the written content
+    // into a single zstd frame on the fly. The frame is finished when
+    // the stream is destroyed, so destroy it before the sink content is
+    // published. Returns null when the zstd support is not built in (or
+    // the context creation failed).
+    [[nodiscard]] std::unique_ptr<std::ostream> zstd_compress_stream(std::unique_ptr<std::ostream> sink) noexcept;
+}
@@ -20,7 +20,7 @@
 #include "report/libexec/Array.h"
 #include "report/libexec/Buffer.h"
 
-#include <utility>
+#include <cstring>
 
 namespace el {
 
@@ -29,11 +29,17 @@ namespace el {
         if (input == nullptr)
             return nullptr;
 
-        const auto input_end = el::array::end(input) + 1; // include the zero element
-        auto top = el::array::copy(input, input_end, top_, end_);
-        if (top != nullptr)
-            std::swap(top_, top);
-        return top;
+        // The length is computed once; the copy is a single memcpy of
+        // the known size (which the libc does with vector instructions),
+        // instead of a second byte by byte walk.
+        const size_t size = el::array::length(input) + 1; // include the zero element
+        if (size > size_t(end_ - top_))
+            return nullptr;
+
+        char* const result = top_;
+        ::memcpy(result, input, size);
+        top_ += size;
+        return result;
     }
 
 }
@@ -19,14 +19,21 @@
 
 #include "report/libexec/Executor.h"
 
+#include "Probes.h"
+
 #include "Array.h"
 #include "Logger.h"
 #include "Resolver.h"
 #include "Linker.h"
 #include "Session.h"
+#include "ShmRing.h"
 
 #include <algorithm>
 #include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
 
 namespace {
 
@@ -48,9 +55,61 @@ namespace {
         }                                               \
     } while (false)
 
+    // Check whether the executable shall be reported. The filter is a
+    // colon separated list of basenames; no filter reports everything.
+    // The scans lean on the libc string routines, which use vector
+    // instructions, instead of byte by byte walks.
+    bool is_reported(const char* filter, const char* executable) noexcept
+    {
+        if (filter == nullptr) {
+            return true;
+        }
+        const char* const slash = ::strrchr(executable, OS_DIR_SEPARATOR);
+        const char* const basename = (slash != nullptr) ? (slash + 1) : executable;
+        const size_t basename_length = ::strlen(basename);
+        for (const char* it = filter; *it != char(0);) {
+            const char* const separator = ::strchr(it, OS_PATH_SEPARATOR);
+            const size_t length = (separator != nullptr) ? size_t(separator - it) : ::strlen(it);
+            if ((length > 0) && (length == basename_length) && (0 == ::memcmp(basename, it, length))) {
+                return true;
+            }
+            it += (separator != nullptr) ? (length + 1) : length;
+        }
+        return false;
+    }
+
+    // Fires the USDT probe pair around the exec rewriting, on every
+    // return path. (On a successful exec* the process image is replaced,
+    // so only the entry probe fires there; pair it with the exec syscall
+    // when measuring.)
+    struct RewriteProbe {
+        RewriteProbe() noexcept { BEAR_PROBE(exec_rewrite_entry); }
+        ~RewriteProbe() noexcept { BEAR_PROBE(exec_rewrite_exit); }
+    };
+
+    // The bounded wait on a full ring: the retry count times the pause
+    // stays well under the cost of spawning the reporter process.
+    constexpr int FULL_RING_RETRIES = 32;
+    constexpr long FULL_RING_PAUSE_NS = 100'000;
+
+    // Conservative check whether the execution record fits a ring slot.
+    // The working directory is counted with its worst case length.
+    bool record_fits(const char* executable, char* const argv[]) noexcept
+    {
+        size_t size = PATH_MAX;
+        size += ::strlen(executable) + 1;
+        for (char* const* it = argv; (it != nullptr) && (*it != nullptr); ++it) {
+            size += ::strlen(*it) + 1;
+        }
+        return size <= el::shm::SLOT_DATA_SIZE;
+    }
+
     // Util class to create command arguments to execute the intercept process.
     //
     // Use this class to allocate buffer and assemble the content of it.
+    // The layout is the fixed positional supervise protocol: the reporter
+    // decodes it by direct indexing, so no flags are involved. (Verbosity
+    // travels in the environment, like in the wrapper mode.)
     class CommandBuilder {
     public:
         constexpr CommandBuilder(const el::Session& session, const char* path, char* const* const argv)
@@ -62,7 +121,7 @@ namespace {
         [[nodiscard]]
         constexpr size_t length() const noexcept
         {
-            return (session.verbose ? 6 : 7) + el::array::length(argv) + 1;
+            return 5 + el::array::length(argv) + 1;
         }
 
         constexpr void assemble(const char** it) const noexcept
@@ -70,12 +129,8 @@ namespace {
             const char** const it_end = it + length();
 
             *it++ = session.reporter;
-            *it++ = cmd::wrapper::FLAG_DESTINATION;
+            *it++ = cmd::wrapper::TAG_SUPERVISE;
             *it++ = session.destination;
-            if (session.verbose) {
-                *it++ = cmd::wrapper::FLAG_VERBOSE;
-            }
-            *it++ = cmd::wrapper::FLAG_EXECUTE;
             *it++ = path;
             *it++ = cmd::wrapper::FLAG_COMMAND;
             {
@@ -103,18 +158,98 @@ namespace {
 
 namespace el {
 
-    Executor::Executor(el::Linker const& linker, el::Session const& session, el::Resolver &resolver) noexcept
+    Executor::Executor(el::Linker const& linker, el::Session const& session, el::Resolver &resolver, el::shm::Ring *ring) noexcept
             : linker_(linker)
             , session_(session)
             , resolver_(resolver)
+            , ring_(ring)
     { }
 
+    bool Executor::report(const char* executable, char* const argv[], pid_t pid, pid_t ppid) const noexcept
+    {
+        char working_dir[PATH_MAX];
+        if (nullptr == getcwd(working_dir, sizeof(working_dir))) {
+            working_dir[0] = char(0);
+        }
+        // An oversized record can never enter the ring; it goes to the
+        // reporter process straight away, which has no size limit.
+        size_t size = ::strlen(working_dir) + 1 + ::strlen(executable) + 1;
+        for (char* const* it = argv; (it != nullptr) && (*it != nullptr); ++it) {
+            size += ::strlen(*it) + 1;
+        }
+        if (size > el::shm::SLOT_DATA_SIZE) {
+            return false;
+        }
+        // A fitting record only fails on a full ring. The collector
+        // drains the ring continuously, so a short wait almost always
+        // finds a free slot - and waiting is strictly cheaper than the
+        // fallback, which spawns a reporter process for this single
+        // record. The wait is bounded: a stalled collector shall not
+        // hang the build.
+        for (int attempt = 0;; ++attempt) {
+            if (el::shm::push(*ring_, uint32_t(pid), uint32_t(ppid), working_dir, executable, argv)) {
+                return true;
+            }
+            if (attempt >= FULL_RING_RETRIES) {
+                return false;
+            }
+            const struct timespec pause = { 0, FULL_RING_PAUSE_NS };
+            ::nanosleep(&pause, nullptr);
+        }
+    }
+
+    rust::Result<int, int> Executor::spawn_and_report(pid_t* pid, const char* executable,
+        const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attrp,
+        char* const argv[], char* const envp[]) const
+    {
+        pid_t child = 0;
+        auto result = linker_.posix_spawn(&child, executable, file_actions, attrp, argv, envp);
+        if (result.is_ok()) {
+            if (!report(executable, argv, child, getpid())) {
+                LOGGER.warning("execution record dropped");
+            }
+            if (pid != nullptr) {
+                *pid = child;
+            }
+        }
+        return result;
+    }
+
+    rust::Result<int, int> Executor::exec_resolved(const char* executable, char* const* argv, char* const* envp) const
+    {
+        // The resolution may hold a handle on the executable: exec that,
+        // so the kernel skips the repeated path walk (a network round
+        // trip on NFS mounted toolchains), and the executed file is
+        // exactly the checked one. An interpreted script can not start
+        // from a close-on-exec fd (the interpreter would not find the
+        // file), so a failure falls through to the path based exec.
+        if (const int fd = resolver_.executable_fd(); fd != -1) {
+            linker_.fexecve(fd, argv, envp).unwrap_or(0);
+        }
+        return linker_.execve(executable, argv, envp);
+    }
+
     rust::Result<int, int> Executor::execve(const char* path, char* const* argv, char* const* envp) const
     {
         CHECK_SESSION(session_);
         CHECK_POINTER(path);
-
+        const RewriteProbe probe;
+
+        // A filtered executable goes to the real exec call with the
+        // caller's original pointers: no resolution, no copies. The
+        // filter compares basenames, which the resolution never changes,
+        // so the decision is the same on the unresolved path. (And the
+        // kernel reports a missing file with the same errno the resolver
+        // would.)
+        if (!is_reported(session_.filter, path)) {
+            return linker_.execve(path, argv, envp);
+        }
         if (auto executable = resolver_.from_current_directory(path); executable.is_ok()) {
+            if ((ring_ != nullptr) && report(executable.unwrap(), argv, getpid(), getppid())) {
+                return exec_resolved(executable.unwrap(), argv, envp);
+            }
+            // An oversized record (or a full ring) falls back to the
+            // reporter process, which has no size limit.
             const CommandBuilder cmd(session_, executable.unwrap(), argv);
             const char* dst[cmd.length()];
             cmd.assemble(dst);
@@ -129,8 +264,21 @@ namespace el {
     {
         CHECK_SESSION(session_);
         CHECK_POINTER(file);
+        const RewriteProbe probe;
 
+        // The filter decision runs on the caller's name; the resolution
+        // keeps the basename, and a filtered execution still needs it to
+        // find the binary on the search path.
+        const bool reported = is_reported(session_.filter, file);
         if (auto executable = resolver_.from_path(file, const_cast<const char **>(envp)); executable.is_ok()) {
+            if (!reported) {
+                return exec_resolved(executable.unwrap(), argv, envp);
+            }
+            if ((ring_ != nullptr) && report(executable.unwrap(), argv, getpid(), getppid())) {
+                return exec_resolved(executable.unwrap(), argv, envp);
+            }
+            // An oversized record (or a full ring) falls back to the
+            // reporter process, which has no size limit.
             const CommandBuilder cmd(session_, executable.unwrap(), argv);
             const char* dst[cmd.length()];
             cmd.assemble(dst);
@@ -145,8 +293,18 @@ namespace el {
     {
         CHECK_SESSION(session_);
         CHECK_POINTER(file);
+        const RewriteProbe probe;
 
+        const bool reported = is_reported(session_.filter, file);
         if (auto executable = resolver_.from_search_path(file, search_path); executable.is_ok()) {
+            if (!reported) {
+                return exec_resolved(executable.unwrap(), argv, envp);
+            }
+            if ((ring_ != nullptr) && report(executable.unwrap(), argv, getpid(), getppid())) {
+                return exec_resolved(executable.unwrap(), argv, envp);
+            }
+            // An oversized record (or a full ring) falls back to the
+            // reporter process, which has no size limit.
             const CommandBuilder cmd(session_, executable.unwrap(), argv);
             const char* dst[cmd.length()];
             cmd.assemble(dst);
@@ -163,8 +321,17 @@ namespace el {
     {
         CHECK_SESSION(session_);
         CHECK_POINTER(path);
+        const RewriteProbe probe;
 
+        // The same pass-through as the exec calls: a filtered spawn goes
+        // to the real call with the caller's original pointers.
+        if (!is_reported(session_.filter, path)) {
+            return linker_.posix_spawn(pid, path, file_actions, attrp, argv, envp);
+        }
         if (auto executable = resolver_.from_current_directory(path); executable.is_ok()) {
+            if ((ring_ != nullptr) && record_fits(executable.unwrap(), argv)) {
+                return spawn_and_report(pid, executable.unwrap(), file_actions, attrp, argv, envp);
+            }
             const CommandBuilder cmd(session_, executable.unwrap(), argv);
             const char* dst[cmd.length()];
             cmd.assemble(dst);
@@ -181,8 +348,19 @@ namespace el {
     {
         CHECK_SESSION(session_);
         CHECK_POINTER(file);
-
+        const RewriteProbe probe;
+
+        // A filtered spawn goes to the real search path variant with the
+        // caller's original pointers: the libc walks the PATH itself (from
+        // the caller's environment, exactly like an uninstrumented spawn),
+        // so no userspace resolution runs at all.
+        if (!is_reported(session_.filter, file)) {
+            return linker_.posix_spawnp(pid, file, file_actions, attrp, argv, envp);
+        }
         if (auto executable = resolver_.from_path(file, const_cast<const char **>(envp)); executable.is_ok()) {
+            if ((ring_ != nullptr) && record_fits(executable.unwrap(), argv)) {
+                return spawn_and_report(pid, executable.unwrap(), file_actions, attrp, argv, envp);
+            }
             const CommandBuilder cmd(session_, executable.unwrap(), argv);
             const char* dst[cmd.length()];
             cmd.assemble(dst);
@@ -34,6 +34,10 @@ namespace el {
     struct Session;
     class Resolver;
 
+    namespace shm {
+        struct Ring;
+    }
+
     /**
      * This class implements the process execution logic.
      *
@@ -53,7 +57,11 @@ namespace el {
      */
     class Executor {
     public:
-        Executor(el::Linker const& linker, el::Session const& session, el::Resolver &resolver) noexcept;
+        // When a ring is given, the executions are reported into it and
+        // the original binary is executed directly, without the reporter
+        // process in between. Executions that do not fit a ring slot
+        // fall back to the reporter process.
+        Executor(el::Linker const& linker, el::Session const& session, el::Resolver &resolver, el::shm::Ring *ring = nullptr) noexcept;
 
         ~Executor() noexcept = default;
 
@@ -76,9 +84,21 @@ namespace el {
             char* const argv[],
             char* const envp[]) const;
 
+    private:
+        bool report(const char* executable, char* const argv[], pid_t pid, pid_t ppid) const noexcept;
+
+        rust::Result<int, int> exec_resolved(const char* executable, char* const argv[], char* const envp[]) const;
+
+        rust::Result<int, int> spawn_and_report(pid_t* pid, const char* executable,
+            const posix_spawn_file_actions_t* file_actions,
+            const posix_spawnattr_t* attrp,
+            char* const argv[],
+            char* const envp[]) const;
+
     private:
         el::Linker const &linker_;
         el::Session const &session_;
         el::Resolver &resolver_;
+        el::shm::Ring *ring_;
     };
 }
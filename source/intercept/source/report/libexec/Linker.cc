@@ -18,6 +18,7 @@
  */
 
 #include "report/libexec/Linker.h"
+#include "report/libexec/Logger.h"
 
 #include <cerrno>
 #include <dlfcn.h>
@@ -29,24 +30,80 @@ namespace {
     {
         return reinterpret_cast<T>(dlsym(RTLD_NEXT, name));
     }
+
+    using execve_t = int (*)(const char*, char* const[], char* const[]);
+    using fexecve_t = int (*)(int, char* const[], char* const[]);
+    using posix_spawn_t = int (*)(
+        pid_t*,
+        const char*,
+        const posix_spawn_file_actions_t*,
+        const posix_spawnattr_t*,
+        char* const[],
+        char* const[]);
+
+    // The resolved symbols, filled once by el::linker::load.
+    execve_t EXECVE = nullptr;
+    fexecve_t FEXECVE = nullptr;
+    posix_spawn_t POSIX_SPAWN = nullptr;
+    posix_spawn_t POSIX_SPAWNP = nullptr;
 }
 
 namespace el {
 
+    namespace linker {
+
+        void load() noexcept
+        {
+            EXECVE = dynamic_linker<execve_t>("execve");
+#ifdef HAVE_FEXECVE
+            FEXECVE = dynamic_linker<fexecve_t>("fexecve");
+#endif
+            POSIX_SPAWN = dynamic_linker<posix_spawn_t>("posix_spawn");
+            POSIX_SPAWNP = dynamic_linker<posix_spawn_t>("posix_spawnp");
+        }
+    }
+
     rust::Result<int, int> Linker::execve(const char* path, char* const* argv, char* const* envp) const noexcept
     {
-        using type = int (*)(const char*, char* const[], char* const[]);
+        using type = execve_t;
 
-        const auto fp = dynamic_linker<type>("execve");
+        const auto fp = (EXECVE != nullptr) ? EXECVE : dynamic_linker<type>("execve");
         if (fp == nullptr) {
             return rust::Err(EINVAL);
         }
+        // a successful exec replaces the process image, together with the
+        // batched log records.
+        el::log::flush();
         auto result = fp(path, argv, envp);
         return (result == -1)
             ? rust::Result<int, int>(rust::Err(errno))
             : rust::Result<int, int>(rust::Ok(result));
     }
 
+    rust::Result<int, int> Linker::fexecve(int fd, char* const* argv, char* const* envp) const noexcept
+    {
+#ifdef HAVE_FEXECVE
+        using type = fexecve_t;
+
+        // this library does not interpose the call, but the resolution
+        // goes the same way as for the interposed ones.
+        const auto fp = (FEXECVE != nullptr) ? FEXECVE : dynamic_linker<type>("fexecve");
+        if (fp == nullptr) {
+            return rust::Err(EINVAL);
+        }
+        el::log::flush();
+        auto result = fp(fd, argv, envp);
+        return (result == -1)
+            ? rust::Result<int, int>(rust::Err(errno))
+            : rust::Result<int, int>(rust::Ok(result));
+#else
+        (void)fd;
+        (void)argv;
+        (void)envp;
+        return rust::Err(ENOSYS);
+#endif
+    }
+
     rust::Result<int, int> Linker::posix_spawn(
         pid_t* pid,
         const char* path,
@@ -55,21 +112,37 @@ namespace el {
         char* const* argv,
         char* const* envp) const noexcept
     {
-        using type = int (*)(
-            pid_t * pid,
-            const char* path,
-            const posix_spawn_file_actions_t* file_actions,
-            const posix_spawnattr_t* attrp,
-            char* const argv[],
-            char* const envp[]);
-
-        const auto fp = dynamic_linker<type>("posix_spawn");
+        using type = posix_spawn_t;
+
+        const auto fp = (POSIX_SPAWN != nullptr) ? POSIX_SPAWN : dynamic_linker<type>("posix_spawn");
         if (fp == nullptr) {
             return rust::Err(EINVAL);
         }
+        el::log::flush();
         auto result = fp(pid, path, file_actions, attrp, argv, envp);
         return (result != 0)
             ? rust::Result<int, int>(rust::Err(errno))
             : rust::Result<int, int>(rust::Ok(result));
     }
+
+    rust::Result<int, int> Linker::posix_spawnp(
+        pid_t* pid,
+        const char* file,
+        const posix_spawn_file_actions_t* file_actions,
+        const posix_spawnattr_t* attrp,
+        char* const* argv,
+        char* const* envp) const noexcept
+    {
+        using type = posix_spawn_t;
+
+        const auto fp = (POSIX_SPAWNP != nullptr) ? POSIX_SPAWNP : dynamic_linker<type>("posix_spawnp");
+        if (fp == nullptr) {
+            return rust::Err(EINVAL);
+        }
+        el::log::flush();
+        auto result = fp(pid, file, file_actions, attrp, argv, envp);
+        return (result != 0)
+            ? rust::Result<int, int>(rust::Err(errno))
+            : rust::Result<int, int>(rust::Ok(result));
+    }
 }
@@ -44,6 +44,15 @@ namespace el {
             char* const argv[],
             char* const envp[]) const noexcept;
 
+        // The fd based exec call: the kernel executes the already opened
+        // file, without another path walk. Reports ENOSYS on platforms
+        // without the call.
+        [[nodiscard]]
+        virtual rust::Result<int, int> fexecve(
+            int fd,
+            char* const argv[],
+            char* const envp[]) const noexcept;
+
         [[nodiscard]]
         virtual rust::Result<int, int> posix_spawn(
             pid_t* pid,
@@ -52,5 +61,26 @@ namespace el {
             const posix_spawnattr_t* attrp,
             char* const argv[],
             char* const envp[]) const noexcept;
+
+        // The search path variant: the libc walks the PATH itself (from
+        // the caller's environment, like the native call would), so a
+        // pass-through spawn keeps the exact native semantics.
+        [[nodiscard]]
+        virtual rust::Result<int, int> posix_spawnp(
+            pid_t* pid,
+            const char* file,
+            const posix_spawn_file_actions_t* file_actions,
+            const posix_spawnattr_t* attrp,
+            char* const argv[],
+            char* const envp[]) const noexcept;
     };
+
+    namespace linker {
+
+        // Resolve the interposed symbols once and keep them in static
+        // storage. Called from the library constructor, so the exec hot
+        // path has no dlsym traffic. The calls fall back to a lazy
+        // resolution when this was not called.
+        void load() noexcept;
+    }
 }
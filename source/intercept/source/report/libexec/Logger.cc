@@ -21,12 +21,31 @@
 
 #include <ctime>
 #include <cstdio>
+#include <cstring>
 #include <unistd.h>
 
 namespace {
 
     el::log::Level LEVEL = el::log::SILENT;
 
+    // The records are batched here and leave with a single write syscall
+    // per flush, instead of one per record. The buffer is static, this
+    // library shall not allocate in the intercepted process. (Like the
+    // level, it is not MT safe.)
+    constexpr size_t BATCH_SIZE = 4096;
+    char BATCH[BATCH_SIZE];
+    size_t BATCH_USED = 0;
+
+    void flush_batch()
+    {
+        if (BATCH_USED > 0) {
+            if (::write(STDERR_FILENO, BATCH, BATCH_USED) == -1) {
+                // the log is best effort, like it was with dprintf.
+            }
+            BATCH_USED = 0;
+        }
+    }
+
     void verbose_message(char const* name, char const* message, char const* variable)
     {
         struct timespec ts { 0, 0 };
@@ -37,8 +56,23 @@ namespace {
         ::localtime_r(&ts.tv_sec, &local_time);
         const unsigned long micros = ts.tv_nsec / 1000;
         const pid_t pid = ::getpid();
-        ::dprintf(STDERR_FILENO, "[%02d:%02d:%02d.%06ld, el, %d] %s; %s%s\n",
+        char record[1024];
+        const int length = ::snprintf(record, sizeof(record), "[%02d:%02d:%02d.%06ld, el, %d] %s; %s%s\n",
             local_time.tm_hour, local_time.tm_min, local_time.tm_sec, micros, pid, name, message, variable);
+        if (length < 0) {
+            return;
+        }
+        // an oversized record is truncated; snprintf kept the newline out
+        // then, put one back.
+        const size_t size = (size_t(length) < sizeof(record)) ? size_t(length) : sizeof(record) - 1;
+        if (size_t(length) >= sizeof(record)) {
+            record[size - 1] = '\n';
+        }
+        if (size > BATCH_SIZE - BATCH_USED) {
+            flush_batch();
+        }
+        ::memcpy(BATCH + BATCH_USED, record, size);
+        BATCH_USED += size;
     }
 }
 
@@ -50,6 +84,11 @@ namespace el::log {
         fsync(STDERR_FILENO);
     }
 
+    void flush() noexcept
+    {
+        flush_batch();
+    }
+
     void Logger::debug(char const* message) const noexcept
     {
         this->debug(message, "");
@@ -64,8 +103,11 @@ namespace el::log {
 
     void Logger::warning(char const* message) const noexcept
     {
+        // Warnings shall be visible right away, whatever happens to the
+        // process afterwards.
         if (el::log::VERBOSE == LEVEL) {
             verbose_message(name_, message, "");
+            flush_batch();
         } else {
             dprintf(STDERR_FILENO, "libexec.so: %s; %s\n", name_, message);
         }
@@ -29,6 +29,11 @@ namespace el::log {
     // Not MT safe
     void set(Level);
 
+    // Push the batched records out. The records are buffered to spare
+    // write syscalls on the instrumented path; the exec and exit
+    // boundaries flush them, since the process image goes away there.
+    void flush() noexcept;
+
     class Logger {
     public:
         constexpr explicit Logger(const char *name) noexcept;
@@ -24,19 +24,154 @@
 #include "report/libexec/Paths.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
 #ifdef HAVE_SYS_STAT_H
 #include <sys/stat.h>
 #endif
+#include <fcntl.h>
 
 namespace {
 
     bool contains_dir_separator(std::string_view const &candidate) {
-        return std::find(candidate.begin(), candidate.end(), OS_DIR_SEPARATOR) != candidate.end();
+        // find lowers to memchr in the standard library.
+        return candidate.find(OS_DIR_SEPARATOR) != std::string_view::npos;
+    }
+
+    // A cached resolution is only valid while it is what the search
+    // path walk would find: a file of the same name landing in an
+    // earlier directory since the store shall win over the cache. One
+    // access call per earlier directory is still much cheaper than the
+    // full walk, which opens and stats every candidate.
+    bool first_match_on_path(const char *resolved, std::string_view const &file, const char *search_path) noexcept {
+        for (const auto &path : el::Paths(search_path)) {
+            if (path.empty()) {
+                continue;
+            }
+            if ((file.size() + path.size() + 2) > PATH_MAX) {
+                continue;
+            }
+            // reached the directory of the cached resolution: no
+            // earlier directory holds the file, the cache stands.
+            if ((::strncmp(resolved, path.data(), path.size()) == 0)
+                    && (resolved[path.size()] == OS_DIR_SEPARATOR)
+                    && (std::string_view(resolved + path.size() + 1) == file)) {
+                return true;
+            }
+            char candidate[PATH_MAX];
+            ::memcpy(candidate, path.data(), path.size());
+            candidate[path.size()] = OS_DIR_SEPARATOR;
+            ::memcpy(candidate + path.size() + 1, file.data(), file.size());
+            candidate[path.size() + 1 + file.size()] = 0;
+            if (0 == ::access(candidate, X_OK)) {
+                // an earlier directory gained the file; resolve anew.
+                // (a directory of that name trips this too, which only
+                // costs the walk - it skips non regular files.)
+                return false;
+            }
+        }
+        // the cached directory is not on this search path at all.
+        return false;
+    }
+
+    // A small cache of the search path resolutions.
+    //
+    // Builds resolve the same few executables from the same search path
+    // over and over again. The cache turns the repeated directory walks
+    // into a single lookup. It is a fixed size direct mapped table in
+    // static storage, to respect the no allocation rule of this library.
+    //
+    // The entries are guarded with a version counter (a seqlock): an odd
+    // version marks an entry that is being written, a changed version
+    // marks a torn read. Both cases are treated as a cache miss.
+    namespace cache {
+
+        constexpr size_t SIZE = 16; // must be a power of two
+        constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325;
+        constexpr uint64_t FNV_PRIME = 0x100000001b3;
+
+        struct Entry {
+            std::atomic<uint64_t> version;
+            uint64_t key;
+            char path[PATH_MAX];
+        };
+
+        Entry ENTRIES[SIZE];
+
+        // The memoized content hash of the last seen search path. A
+        // shell execs hundreds of children with the same PATH string,
+        // and hashing it was the remaining walk over its content on
+        // every exec. The string address is the key: setenv and putenv
+        // install a new string, so a changed PATH misses here and is
+        // hashed again. (A stale hit only misdirects the cache probe,
+        // and the cached resolution is validated before use anyway.)
+        std::atomic<const char *> SEARCH_PATH_KEY {nullptr};
+        std::atomic<uint64_t> SEARCH_PATH_HASH {0};
+
+        uint64_t hash_search_path(const char *search_path) noexcept {
+            if (SEARCH_PATH_KEY.load(std::memory_order_acquire) == search_path) {
+                return SEARCH_PATH_HASH.load(std::memory_order_relaxed);
+            }
+            uint64_t result = FNV_OFFSET;
+            for (const char *it = search_path; *it != char(0); ++it) {
+                result = (result ^ uint64_t(uint8_t(*it))) * FNV_PRIME;
+            }
+            // the value is published before the key; a concurrent update
+            // with another string changes the key, which fails the probe.
+            SEARCH_PATH_HASH.store(result, std::memory_order_relaxed);
+            SEARCH_PATH_KEY.store(search_path, std::memory_order_release);
+            return result;
+        }
+
+        uint64_t hash(std::string_view const &file, const char *search_path) noexcept {
+            uint64_t result = FNV_OFFSET;
+            for (const char it : file) {
+                result = (result ^ uint64_t(uint8_t(it))) * FNV_PRIME;
+            }
+            result = (result ^ uint64_t(0)) * FNV_PRIME;
+            result = (result ^ hash_search_path(search_path)) * FNV_PRIME;
+            return result;
+        }
+
+        bool lookup(uint64_t key, char *result) noexcept {
+            const Entry &entry = ENTRIES[key & (SIZE - 1)];
+            const uint64_t before = entry.version.load(std::memory_order_acquire);
+            if (((before & 1) != 0) || (entry.key != key)) {
+                return false;
+            }
+            for (size_t index = 0; index < PATH_MAX; ++index) {
+                result[index] = entry.path[index];
+                if (entry.path[index] == char(0)) {
+                    break;
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return entry.version.load(std::memory_order_relaxed) == before;
+        }
+
+        void store(uint64_t key, const char *path) noexcept {
+            Entry &entry = ENTRIES[key & (SIZE - 1)];
+            uint64_t version = entry.version.load(std::memory_order_relaxed);
+            if (((version & 1) != 0)
+                    || (!entry.version.compare_exchange_strong(version, version + 1, std::memory_order_acq_rel))) {
+                // Another thread is updating the entry, skip the store.
+                return;
+            }
+            entry.key = key;
+            for (size_t index = 0; index < PATH_MAX; ++index) {
+                entry.path[index] = path[index];
+                if (path[index] == char(0)) {
+                    break;
+                }
+            }
+            entry.version.store(version + 2, std::memory_order_release);
+        }
     }
 }
 
@@ -44,24 +179,71 @@ namespace el {
 
     Resolver::Resolver() noexcept
             : result_()
+            , fd_(-1)
     {
         result_[0] = 0;
     }
 
+    Resolver::~Resolver() noexcept {
+        release();
+    }
+
+    int Resolver::executable_fd() const noexcept {
+        return fd_;
+    }
+
+    void Resolver::release() noexcept {
+        if (fd_ != -1) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
     rust::Result<const char*, int> Resolver::from_current_directory(std::string_view const &file) {
-        // copy the input to result.
-        array::copy(file.begin(), file.end() + 1, result_, result_ + PATH_MAX);
+        // copy the input to result. The length is known already: a single
+        // memcpy instead of a byte by byte walk, and an over long input
+        // is rejected instead of silently truncated.
+        if (file.size() >= PATH_MAX) {
+            return rust::Err(ENAMETOOLONG);
+        }
+        ::memcpy(result_, file.data(), file.size());
+        result_[file.size()] = 0;
+        return validate();
+    }
+
+    rust::Result<const char*, int> Resolver::validate() noexcept {
+        release();
+#if defined(HAVE_FEXECVE) && defined(O_PATH)
+        // A path only handle: the single path walk happens here, the
+        // checks run against the handle, and the exec can use it too.
+        // On a network filesystem every avoided walk is a round trip,
+        // and the file can not be swapped between the check and the
+        // exec. Close-on-exec, so nothing leaks into the build tools.
+        fd_ = ::open(result_, O_PATH | O_CLOEXEC);
+        if (fd_ == -1) {
+            return rust::Err((errno == EACCES) ? EACCES : ENOENT);
+        }
+        // check if this is a file
+        struct stat sb {};
+        ::fstat(fd_, &sb);
+        if ((sb.st_mode & S_IFMT) != S_IFREG) {
+            release();
+            return rust::Err(ENOENT);
+        }
+#else
         // check if this is a file
         struct stat sb {};
         ::stat(result_, &sb);
         if ((sb.st_mode & S_IFMT) != S_IFREG) {
             return rust::Err(ENOENT);
         }
+#endif
         // check if it's okay to execute.
         if (0 == ::access(result_, X_OK)) {
             const char *ptr = result_;
             return rust::Ok(ptr);
         }
+        release();
         // try to set a meaningful error value.
         if (0 == ::access(result_, F_OK)) {
             return rust::Err(EACCES);
@@ -103,6 +285,16 @@ namespace el {
             // the file contains a dir separator, it is treated as path.
             return from_current_directory(file);
         } else {
+            // serve repeated resolutions from the cache. The cached path
+            // is verified before use: it has to be the first match of
+            // the search path walk still, and an executable file still.
+            const uint64_t key = cache::hash(file, search_path);
+            if (cache::lookup(key, result_)
+                    && first_match_on_path(result_, file, search_path)) {
+                if (auto result = validate(); result.is_ok()) {
+                    return result;
+                }
+            }
             // otherwise use the given search path to locate the executable.
             for (const auto &path : el::Paths(search_path)) {
                 // ignore empty entries
@@ -113,18 +305,18 @@ namespace el {
                 if ((file.size() + path.size() + 2) > PATH_MAX) {
                     continue;
                 }
-                // create a path
+                // create a path; the entry and the file lengths are known,
+                // so the copies are plain memcpy calls.
                 char candidate[PATH_MAX];
                 {
-                    char *const candidate_begin = candidate;
-                    char *const candidate_end = candidate + PATH_MAX;
-                    auto it = el::array::copy(path.begin(), path.end(), candidate_begin, candidate_end);
-                    *it++ = OS_DIR_SEPARATOR;
-                    it = el::array::copy(file.begin(), file.end(), it, candidate_end);
-                    *it = 0;
+                    ::memcpy(candidate, path.data(), path.size());
+                    candidate[path.size()] = OS_DIR_SEPARATOR;
+                    ::memcpy(candidate + path.size() + 1, file.data(), file.size());
+                    candidate[path.size() + 1 + file.size()] = 0;
                 }
                 // check if it's okay to execute.
                 if (auto result = from_current_directory(candidate); result.is_ok()) {
+                    cache::store(key, result_);
                     return result;
                 }
             }
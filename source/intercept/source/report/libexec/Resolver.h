@@ -37,7 +37,7 @@ namespace el {
     class Resolver {
     public:
         Resolver() noexcept;
-        virtual ~Resolver() noexcept = default;
+        virtual ~Resolver() noexcept;
 
         /**
          * Resolve the executable from system environments.
@@ -53,9 +53,29 @@ namespace el {
         [[nodiscard]]
         virtual rust::Result<const char*, int> from_search_path(std::string_view const &file, const char *search_path);
 
+        /**
+         * File descriptor of the last resolved executable, when the
+         * platform supports an fd based exec. The resolution opens the
+         * file with O_PATH, so the executed file is the checked one,
+         * and the exec call needs no second path walk. Returns -1 when
+         * nothing is resolved or the platform has no such call.
+         *
+         * The descriptor is owned by the resolver: a new resolution or
+         * the destructor closes it (and it is close-on-exec anyway).
+         */
+        [[nodiscard]]
+        int executable_fd() const noexcept;
+
         NON_COPYABLE_NOR_MOVABLE(Resolver)
 
+    private:
+        // Validate the path in the result buffer: a regular file with
+        // execute permission. Keeps the O_PATH handle on success.
+        rust::Result<const char*, int> validate() noexcept;
+        void release() noexcept;
+
     private:
         char result_[PATH_MAX];
+        int fd_;
     };
 }
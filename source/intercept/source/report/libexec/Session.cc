@@ -20,8 +20,24 @@
 #include "config.h"
 #include "report/libexec/Session.h"
 
+#include "report/libexec/Array.h"
 #include "report/libexec/Buffer.h"
-#include "report/libexec/Environment.h"
+
+namespace {
+
+    // All session variables share this prefix; a single comparison
+    // rejects the unrelated environment entries.
+    constexpr char KEY_PREFIX[] = "INTERCEPT_";
+    constexpr size_t KEY_PREFIX_SIZE = sizeof(KEY_PREFIX) - 1;
+
+    // The single pass dispatch below hashes the keys by their length.
+    static_assert(
+            (sizeof(cmd::library::KEY_VERBOSE) < sizeof(cmd::library::KEY_RING))
+                    && (sizeof(cmd::library::KEY_RING) < sizeof(cmd::library::KEY_FILTER))
+                    && (sizeof(cmd::library::KEY_FILTER) < sizeof(cmd::library::KEY_REPORTER))
+                    && (sizeof(cmd::library::KEY_REPORTER) < sizeof(cmd::library::KEY_DESTINATION)),
+            "the session variable key lengths shall be pairwise different");
+}
 
 namespace el::session {
 
@@ -30,9 +46,47 @@ namespace el::session {
         if (nullptr == environment)
             return;
 
-        session.reporter = env::get_env_value(environment, cmd::library::KEY_REPORTER);
-        session.destination = env::get_env_value(environment, cmd::library::KEY_DESTINATION);
-        session.verbose = env::get_env_value(environment, cmd::library::KEY_VERBOSE) != nullptr;
+        // A single pass over the environment, instead of one scan per
+        // variable. Every session variable starts with the same prefix,
+        // and the key lengths are pairwise different: the length is a
+        // perfect hash over the keys, so an entry with the prefix is
+        // compared against at most one candidate key. (The first entry
+        // of a key wins, like the per key scans did.)
+        for (const char **it = environment; *it != nullptr; ++it) {
+            const char *const entry = *it;
+            if (!el::array::equal_n(KEY_PREFIX, entry, KEY_PREFIX_SIZE))
+                continue;
+            size_t length = KEY_PREFIX_SIZE;
+            while ((entry[length] != 0) && (entry[length] != '='))
+                ++length;
+            if (entry[length] != '=')
+                continue;
+            const char *const value = entry + length + 1;
+            switch (length) {
+            case sizeof(cmd::library::KEY_REPORTER) - 1:
+                if ((session.reporter == nullptr) && el::array::equal_n(cmd::library::KEY_REPORTER, entry, length))
+                    session.reporter = value;
+                break;
+            case sizeof(cmd::library::KEY_DESTINATION) - 1:
+                if ((session.destination == nullptr) && el::array::equal_n(cmd::library::KEY_DESTINATION, entry, length))
+                    session.destination = value;
+                break;
+            case sizeof(cmd::library::KEY_RING) - 1:
+                if ((session.ring == nullptr) && el::array::equal_n(cmd::library::KEY_RING, entry, length))
+                    session.ring = value;
+                break;
+            case sizeof(cmd::library::KEY_FILTER) - 1:
+                if ((session.filter == nullptr) && el::array::equal_n(cmd::library::KEY_FILTER, entry, length))
+                    session.filter = value;
+                break;
+            case sizeof(cmd::library::KEY_VERBOSE) - 1:
+                if (el::array::equal_n(cmd::library::KEY_VERBOSE, entry, length))
+                    session.verbose = true;
+                break;
+            default:
+                break;
+            }
+        }
     }
 
     void persist(Session &session, char *begin, char *end) noexcept
@@ -43,6 +97,8 @@ namespace el::session {
         Buffer buffer(begin, end);
         session.reporter = buffer.store(session.reporter);
         session.destination = buffer.store(session.destination);
+        session.ring = buffer.store(session.ring);
+        session.filter = buffer.store(session.filter);
     }
 
     bool is_valid(Session const &session) noexcept
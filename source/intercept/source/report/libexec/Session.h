@@ -31,6 +31,11 @@ namespace el {
     struct Session {
         char const* reporter = nullptr;
         char const* destination = nullptr;
+        // Optional. The name of the shared memory ring to report into.
+        char const* ring = nullptr;
+        // Optional. Colon separated basenames of executables to report;
+        // everything else is executed without reporting.
+        char const* filter = nullptr;
         bool verbose = false;
     };
 
@@ -0,0 +1,133 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "report/libexec/ShmRing.h"
+
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+    // Copy the string (with its terminating zero byte) into the slot
+    // data. Returns the new offset, or SIZE_MAX when it does not fit.
+    size_t append(char *data, size_t offset, const char *value) noexcept
+    {
+        if ((offset == SIZE_MAX) || (value == nullptr)) {
+            return SIZE_MAX;
+        }
+        for (const char *it = value;; ++it) {
+            if (offset >= el::shm::SLOT_DATA_SIZE) {
+                return SIZE_MAX;
+            }
+            data[offset++] = *it;
+            if (*it == char(0)) {
+                return offset;
+            }
+        }
+    }
+}
+
+namespace el::shm {
+
+    Ring *attach(const char *name) noexcept
+    {
+        if (name == nullptr) {
+            return nullptr;
+        }
+        // A memfd backed ring is handed over as a path into the proc
+        // filesystem of the collector ("/proc/<pid>/fd/<fd>"); a POSIX
+        // shared memory name has no further separator after the first.
+        const int fd = (strchr(name + 1, '/') != nullptr)
+                ? open(name, O_RDWR | O_CLOEXEC)
+                : shm_open(name, O_RDWR, 0);
+        if (fd == -1) {
+            return nullptr;
+        }
+        void *const address = mmap(nullptr, sizeof(Ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        return (address == MAP_FAILED) ? nullptr : static_cast<Ring *>(address);
+    }
+
+    void init(Ring &ring) noexcept
+    {
+        ring.head.store(0, std::memory_order_relaxed);
+        ring.tail.store(0, std::memory_order_relaxed);
+        for (size_t index = 0; index < SLOT_COUNT; ++index) {
+            ring.slots[index].sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(Ring &ring, uint32_t pid, uint32_t ppid, const char *working_dir, const char *executable, char *const *argv) noexcept
+    {
+        uint64_t position = ring.head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = ring.slots[position % SLOT_COUNT];
+            const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const int64_t difference = int64_t(sequence) - int64_t(position);
+            if (difference == 0) {
+                // The slot is free. Claim it by advancing the head, or
+                // retry when another process was faster.
+                if (ring.head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    size_t offset = append(slot.data, 0, working_dir);
+                    offset = append(slot.data, offset, executable);
+                    for (char *const *it = argv; (offset != SIZE_MAX) && (it != nullptr) && (*it != nullptr); ++it) {
+                        offset = append(slot.data, offset, *it);
+                    }
+                    slot.pid = pid;
+                    slot.ppid = ppid;
+                    // A claimed slot must always be committed, otherwise
+                    // the consumer would stall on it. An oversized record
+                    // is committed with zero length, which the consumer
+                    // skips.
+                    slot.length = (offset == SIZE_MAX) ? 0 : uint32_t(offset);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return (offset != SIZE_MAX);
+                }
+            } else if (difference < 0) {
+                // The consumer has not freed the slot yet: the ring is full.
+                return false;
+            } else {
+                position = ring.head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(Ring &ring, Slot &out) noexcept
+    {
+        const uint64_t position = ring.tail.load(std::memory_order_relaxed);
+        Slot &slot = ring.slots[position % SLOT_COUNT];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (int64_t(sequence) - int64_t(position + 1) < 0) {
+            // The producers have not committed the slot yet.
+            return false;
+        }
+        out.pid = slot.pid;
+        out.ppid = slot.ppid;
+        out.length = (slot.length <= SLOT_DATA_SIZE) ? slot.length : 0;
+        for (size_t index = 0; index < out.length; ++index) {
+            out.data[index] = slot.data[index];
+        }
+        slot.sequence.store(position + SLOT_COUNT, std::memory_order_release);
+        ring.tail.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+}
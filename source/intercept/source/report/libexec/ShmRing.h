@@ -0,0 +1,83 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace el::shm {
+
+    /**
+     * A ring buffer of execution records in shared memory.
+     *
+     * The collector creates the ring and announces its name to the
+     * intercepted processes. The preload library writes a fixed layout
+     * record into it on every exec, which is a handful of memory writes
+     * instead of spawning a reporter process and a gRPC round trip.
+     *
+     * Many producers write the ring concurrently (the intercepted
+     * processes), a single consumer drains it (the collector). The
+     * implementation is the bounded ring with per slot sequence counters
+     * (by Dmitry Vyukov). Everything is relative to the mapping address,
+     * because each process maps the ring at a different address.
+     *
+     * The producer side must not allocate and must stay signal safe, so
+     * the records are fixed size and the strings are flattened into the
+     * slot. A record that does not fit (or hits a full ring) is dropped:
+     * losing an event is better than blocking the intercepted process.
+     */
+
+    // The slot count must be a power of two.
+    constexpr size_t SLOT_COUNT = 512;
+    constexpr size_t SLOT_DATA_SIZE = 8128;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        uint32_t pid;
+        uint32_t ppid;
+        // The used bytes of the data array. Zero marks a dropped record.
+        uint32_t length;
+        // The working directory, the executable and the arguments, each
+        // terminated with a zero byte, in this order.
+        char data[SLOT_DATA_SIZE];
+    };
+
+    struct Ring {
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+        Slot slots[SLOT_COUNT];
+    };
+
+    // Prepare a freshly mapped (zero filled) ring for use.
+    void init(Ring &ring) noexcept;
+
+    // Map an existing ring by its name. Returns nullptr when the ring
+    // can not be opened or mapped.
+    Ring *attach(const char *name) noexcept;
+
+    // Write one execution record. Returns false when the record was
+    // dropped, because the ring was full or the strings did not fit.
+    bool push(Ring &ring, uint32_t pid, uint32_t ppid, const char *working_dir, const char *executable, char *const *argv) noexcept;
+
+    // Copy the oldest record into the given slot. Returns false when the
+    // ring is empty. Only a single consumer may call this.
+    bool pop(Ring &ring, Slot &out) noexcept;
+}
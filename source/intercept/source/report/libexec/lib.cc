@@ -29,6 +29,7 @@
 #include "report/libexec/Logger.h"
 #include "report/libexec/Resolver.h"
 #include "report/libexec/Session.h"
+#include "report/libexec/ShmRing.h"
 
 #ifdef HAVE_SPAWN_H
 #include <spawn.h>
@@ -88,6 +89,7 @@ namespace {
     // These are related to the functionality of this library.
     el::Session SESSION;
     el::Linker LINKER;
+    el::shm::Ring* RING = nullptr;
 
     constexpr el::log::Logger LOGGER("lib.cc");
 }
@@ -104,8 +106,11 @@ extern "C" void on_load()
     if (LOADED.exchange(true))
         return;
 
+    el::linker::load();
     el::session::from(SESSION, environment());
     el::session::persist(SESSION, BUFFER, BUFFER + BUFFER_SIZE);
+    // Report through the shared memory ring, when the collector offers one.
+    RING = el::shm::attach(SESSION.ring);
 
     el::log::Level level = SESSION.verbose ? el::log::VERBOSE : el::log::SILENT;
     el::log::set(level);
@@ -127,6 +132,7 @@ extern "C" void on_unload()
         return;
 
     LOGGER.debug("on_unload");
+    el::log::flush();
     errno = 0;
 }
 
@@ -135,7 +141,7 @@ extern "C" int execve(const char* path, char* const argv[], char* const envp[])
     LOGGER.debug("execve path: ", path);
 
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execve(path, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execve(path, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execve failed.");
         errno = result.unwrap_err();
@@ -149,7 +155,7 @@ extern "C" int execv(const char* path, char* const argv[])
 
     auto envp = const_cast<char* const*>(environment());
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execve(path, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execve(path, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execv failed.");
         errno = result.unwrap_err();
@@ -162,7 +168,7 @@ extern "C" int execvpe(const char* file, char* const argv[], char* const envp[])
     LOGGER.debug("execvpe file: ", file);
 
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execvpe(file, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execvpe(file, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execvpe failed.");
         errno = result.unwrap_err();
@@ -176,7 +182,7 @@ extern "C" int execvp(const char* file, char* const argv[])
 
     auto envp = const_cast<char* const*>(environment());
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execvpe(file, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execvpe(file, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execvp failed.");
         errno = result.unwrap_err();
@@ -190,7 +196,7 @@ extern "C" int execvP(const char* file, const char* search_path, char* const arg
 
     auto envp = const_cast<char* const*>(environment());
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execvP(file, search_path, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execvP(file, search_path, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execvP failed.");
         errno = result.unwrap_err();
@@ -203,7 +209,7 @@ extern "C" int exect(const char* path, char* const argv[], char* const envp[])
     LOGGER.debug("exect path: ", path);
 
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execve(path, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execve(path, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("exect failed.");
         errno = result.unwrap_err();
@@ -232,7 +238,7 @@ extern "C" int execl(const char* path, const char* arg, ...)
 
     auto envp = const_cast<char* const*>(environment());
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execve(path, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execve(path, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execl failed.");
         errno = result.unwrap_err();
@@ -258,7 +264,7 @@ extern "C" int execlp(const char* file, const char* arg, ...)
 
     auto envp = const_cast<char* const*>(environment());
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execvpe(file, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execvpe(file, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execlp failed.");
         errno = result.unwrap_err();
@@ -285,7 +291,7 @@ extern "C" int execle(const char* path, const char* arg, ...)
     va_end(ap);
 
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).execve(path, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).execve(path, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("execle failed.");
         errno = result.unwrap_err();
@@ -303,7 +309,7 @@ extern "C" int posix_spawn(pid_t* pid, const char* path,
     LOGGER.debug("posix_spawn path:", path);
 
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).posix_spawn(pid, path, file_actions, attrp, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).posix_spawn(pid, path, file_actions, attrp, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("posix_spawn failed.");
         errno = result.unwrap_err();
@@ -319,7 +325,7 @@ extern "C" int posix_spawnp(pid_t* pid, const char* file,
     LOGGER.debug("posix_spawnp file:", file);
 
     el::Resolver resolver;
-    const auto result = el::Executor(LINKER, SESSION, resolver).posix_spawnp(pid, file, file_actions, attrp, argv, envp);
+    const auto result = el::Executor(LINKER, SESSION, resolver, RING).posix_spawnp(pid, file, file_actions, attrp, argv, envp);
     if (result.is_err()) {
         LOGGER.debug("posix_spawnp failed.");
         errno = result.unwrap_err();
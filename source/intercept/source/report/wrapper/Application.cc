@@ -33,6 +33,7 @@
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace fs = std::filesystem;
@@ -50,8 +51,8 @@ namespace {
         { }
 
         void initForVerbose() const override {
+            ps::ApplicationLogConfig::initForVerbose();
             spdlog::set_pattern(fmt::format("[%H:%M:%S.%f, wr, {0}, ppid: {1}] %v", getpid(), getppid()));
-            spdlog::set_level(spdlog::level::debug);
         }
     };
 
@@ -98,6 +99,28 @@ namespace {
 
     namespace Supervisor {
 
+        // The fixed positional command line of a rewritten exec call:
+        // [reporter, tag, destination, executable, "--", arguments...].
+        // Both ends of this protocol are this tool; the decoding is
+        // direct indexing, the flag parser only serves the collector
+        // and the manual invocations.
+        bool is_positional_call(int argc, const char **argv) noexcept {
+            return (argc >= 5)
+                    && (std::string_view(argv[1]) == cmd::wrapper::TAG_SUPERVISE)
+                    && (std::string_view(argv[4]) == cmd::wrapper::FLAG_COMMAND);
+        }
+
+        rust::Result<wr::Execution> make_execution(int argc, const char **argv, sys::env::Vars &&environment) noexcept {
+            return sys::path::get_cwd()
+                    .map<wr::Execution>([argc, &argv, &environment](auto working_dir) {
+                        return wr::Execution{
+                                fs::path(argv[3]),
+                                std::list<std::string>(argv + 5, argv + argc),
+                                working_dir,
+                                environment};
+                    });
+        }
+
         rust::Result<wr::SessionLocator> make_session(const flags::Arguments &args) noexcept {
             return args.as_string(cmd::wrapper::FLAG_DESTINATION)
                     .map<wr::SessionLocator>([](const auto &destination) {
@@ -127,6 +150,62 @@ namespace {
                 .map<bool>([](auto _status) { return _status.is_exited(); })
                 .unwrap_or(true);
     }
+
+    // The preload session distributes its environment injection to every
+    // process of the build, so this process carries it too. Re-applying
+    // it from our own environment replaces the resolve round trip to the
+    // collector, which would answer with exactly these variables.
+    namespace Preload {
+
+        constexpr char GLIBC_PRELOAD_KEY[] = "LD_PRELOAD";
+
+        // The variables the preload session injects, besides the
+        // preload entry itself.
+        constexpr const char *SESSION_KEYS[] = {
+                cmd::library::KEY_REPORTER,
+                cmd::library::KEY_DESTINATION,
+                cmd::library::KEY_RING,
+                cmd::library::KEY_FILTER,
+                cmd::library::KEY_VERBOSE,
+                cmd::wrapper::KEY_TOKEN,
+                cmd::wrapper::KEY_SESSION,
+        };
+
+        bool is_active() {
+            return getenv(cmd::library::KEY_REPORTER) != nullptr;
+        }
+
+        // Merge the library to the front of a preload value, without
+        // repeating it when it is already listed.
+        std::string keep_front_in_path(const std::string &library, const std::string &value) {
+            std::string result(library);
+            std::size_t it = 0;
+            while (it < value.size()) {
+                const std::size_t end = std::min(value.find(OS_PATH_SEPARATOR, it), value.size());
+                if (value.compare(it, end - it, library) != 0) {
+                    result += OS_PATH_SEPARATOR;
+                    result.append(value, it, end - it);
+                }
+                it = end + 1;
+            }
+            return result;
+        }
+
+        wr::Execution resolve(wr::Execution &&execution) {
+            for (const char *key : SESSION_KEYS) {
+                if (const char *value = getenv(key); value != nullptr) {
+                    execution.environment[key] = value;
+                }
+            }
+            if (const char *preload = getenv(GLIBC_PRELOAD_KEY); preload != nullptr) {
+                // The session put the library first in our value.
+                const std::string library(preload, std::min(std::string_view(preload).find(OS_PATH_SEPARATOR), std::string_view(preload).size()));
+                auto &target = execution.environment[GLIBC_PRELOAD_KEY];
+                target = target.empty() ? library : keep_front_in_path(library, target);
+            }
+            return std::move(execution);
+        }
+    }
 }
 
 namespace wr {
@@ -137,27 +216,35 @@ namespace wr {
             , execution_(std::move(execution))
     { }
 
+    // Resolve how to execute the command: locally in a preload session,
+    // by the collector otherwise. Either way the started event reports
+    // the resolved execution.
+    static rust::Result<wr::Execution> resolve(wr::EventReporter &reporter, const wr::Execution &execution) {
+        if (Preload::is_active()) {
+            auto resolved = Preload::resolve(wr::Execution(execution));
+            reporter.report_start_resolved(wr::Execution(resolved));
+            return rust::Ok(std::move(resolved));
+        }
+        return reporter.report_start(wr::Execution(execution));
+    }
+
     rust::Result<int> Command::execute() const {
         wr::EventReporter event_reporter(session_);
-        wr::SupervisorClient supervisor_client(session_);
 
-        return supervisor_client.resolve(execution_)
-                .and_then<sys::Process>([&event_reporter](auto execution) {
+        return resolve(event_reporter, execution_)
+                .and_then<sys::Process>([](auto execution) {
                     return sys::Process::Builder(execution.executable, true)
                             .add_arguments(execution.arguments.begin(), execution.arguments.end())
                             .set_environment(execution.environment)
                             .set_redirect_io()
-                            .spawn()
-                            .on_success([&event_reporter, &execution](auto &child) {
-                                event_reporter.report_start(child.get_pid(), execution);
-                            });
+                            .spawn();
                 })
                 .and_then<sys::ExitStatus>([&event_reporter](auto child) {
                     sys::SignalForwarder guard(child);
                     while (true) {
                         auto status = child.wait(true)
-                                .on_success([&event_reporter](auto exit) {
-                                    event_reporter.report_wait(exit);
+                                .on_success([&event_reporter, &child](auto exit) {
+                                    event_reporter.report_wait(exit, child.get_usage());
                                 });
                         if (is_exited(status)) {
                             return status;
@@ -184,6 +271,13 @@ namespace wr {
             log_config.record(argv, envp);
 
             return Application::from_envs(argc, argv, envp);
+        } else if (Supervisor::is_positional_call(argc, argv)) {
+            if (const bool verbose = (nullptr != getenv(cmd::wrapper::KEY_VERBOSE)); verbose) {
+                log_config.initForVerbose();
+            }
+            log_config.record(argv, envp);
+
+            return Application::from_positions(argc, argv, envp);
         } else {
             return Application::parse(argc, argv)
                     .on_success([this, &argv, &envp](const auto& args) {
@@ -191,7 +285,7 @@ namespace wr {
                             log_config.initForVerbose();
                         }
                         log_config.record(argv, envp);
-                        spdlog::debug("arguments parsed: {0}", args);
+                        SPDLOG_DEBUG("arguments parsed: {0}", args);
                     })
                     .and_then<ps::CommandPtr>([&envp](auto args) {
                         // if parsing success, we create the main command and execute it.
@@ -212,6 +306,18 @@ namespace wr {
                 });
     }
 
+    rust::Result<ps::CommandPtr> Application::from_positions(int argc, const char **argv, const char **envp) {
+        auto environment = sys::env::from(const_cast<const char **>(envp));
+        auto session = rust::Result<wr::SessionLocator>(rust::Ok(wr::SessionLocator{argv[2]}));
+        auto execution = Supervisor::make_execution(argc, argv, std::move(environment));
+
+        return rust::merge(session, execution)
+                .map<ps::CommandPtr>([](const auto &tuple) {
+                    const auto&[session, execution] = tuple;
+                    return std::make_unique<Command>(session, execution);
+                });
+    }
+
     rust::Result<ps::CommandPtr> Application::from_args(const flags::Arguments &args, const char **envp) {
         auto environment = sys::env::from(const_cast<const char **>(envp));
         auto session = Supervisor::make_session(args);
@@ -46,6 +46,9 @@ namespace wr {
         rust::Result<ps::CommandPtr> command(int argc, const char **argv, const char **envp) const override;
 
         static rust::Result<ps::CommandPtr> from_envs(int argc, const char **argv, const char **envp);
+        // Decodes the fixed positional supervise command line, which the
+        // rewritten exec calls of a preload session assemble.
+        static rust::Result<ps::CommandPtr> from_positions(int argc, const char **argv, const char **envp);
         static rust::Result<ps::CommandPtr> from_args(const flags::Arguments &args, const char **envp);
         static rust::Result<flags::Arguments> parse(int argc, const char **argv) ;
 
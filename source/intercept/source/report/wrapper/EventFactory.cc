@@ -20,8 +20,12 @@
 #include "config.h"
 #include "report/wrapper/EventFactory.h"
 #include "Convert.h"
+#include "HybridClock.h"
 
-#include <random>
+#include <cstdlib>
+#include <ctime>
+#include <utility>
+#include <unistd.h>
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #else
@@ -32,44 +36,58 @@ using namespace google::protobuf::util;
 
 namespace {
 
-    google::protobuf::Timestamp now() {
+    // Fill the timestamp of the event in place, without constructing and
+    // copying a temporary message. The coarse clock is served from the
+    // vDSO without a system call; its tick granularity (a few
+    // milliseconds) is enough to order the lifecycle events of a
+    // process, so a session may opt into it through the environment.
+    void stamp(rpc::Event &event, bool coarse) {
+        // the hybrid clock is the ordering key; the wall timestamp below
+        // stays the human readable capture time.
+        domain::hlc::stamp(event);
+        google::protobuf::Timestamp &timestamp = *event.mutable_timestamp();
+#ifdef CLOCK_REALTIME_COARSE
+        if (coarse) {
+            timespec ts;
+            ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+
+            timestamp.set_seconds(ts.tv_sec);
+            timestamp.set_nanos(ts.tv_nsec);
+            return;
+        }
+#endif
 #ifdef HAVE_SYS_TIME_H
         timeval tv;
         gettimeofday(&tv, nullptr);
 
-        google::protobuf::Timestamp timestamp;
         timestamp.set_seconds(tv.tv_sec);
         timestamp.set_nanos(tv.tv_usec * 1000);
-        return timestamp;
 #else
-        return TimeUtil::GetCurrentTime();
+        timestamp = TimeUtil::GetCurrentTime();
 #endif
     }
-
-    std::uint64_t generate_unique_id() {
-        std::random_device random_device;
-        std::mt19937_64 generator(random_device());
-        std::uniform_int_distribution<std::uint64_t> distribution;
-
-        return distribution(generator);
-    }
 }
 
 namespace wr {
 
     EventFactory::EventFactory() noexcept
-            : rid_(generate_unique_id())
+            : rid_(make_reporter_id(ProcessId(getpid())))
+            , coarse_clock_(nullptr != std::getenv(cmd::wrapper::KEY_CLOCK_COARSE))
     { }
 
     rpc::Event EventFactory::start(ProcessId pid, ProcessId ppid, const Execution &execution) const {
+        return start(pid, ppid, Execution(execution));
+    }
+
+    rpc::Event EventFactory::start(ProcessId pid, ProcessId ppid, Execution &&execution) const {
         rpc::Event event;
         event.set_rid(rid_);
-        event.mutable_timestamp()->CopyFrom(now());
+        stamp(event, coarse_clock_);
         {
             rpc::Event_Started &event_started = *event.mutable_started();
             event_started.set_pid(pid);
             event_started.set_ppid(ppid);
-            *event_started.mutable_execution() = into(execution);
+            *event_started.mutable_execution() = into(std::move(execution));
         }
         return event;
     }
@@ -77,7 +95,7 @@ namespace wr {
     rpc::Event EventFactory::signal(int number) const {
         rpc::Event event;
         event.set_rid(rid_);
-        event.mutable_timestamp()->CopyFrom(now());
+        stamp(event, coarse_clock_);
         {
             rpc::Event_Signalled &event_signalled = *event.mutable_signalled();
             event_signalled.set_number(number);
@@ -88,11 +106,24 @@ namespace wr {
     rpc::Event EventFactory::terminate(int code) const {
         rpc::Event event;
         event.set_rid(rid_);
-        event.mutable_timestamp()->CopyFrom(now());
+        stamp(event, coarse_clock_);
         {
             rpc::Event_Terminated &event_terminated = *event.mutable_terminated();
             event_terminated.set_status(code);
         }
         return event;
     }
+
+    rpc::Event EventFactory::terminate(int code, const sys::ResourceUsage &usage) const {
+        rpc::Event event = terminate(code);
+        {
+            rpc::Event_Terminated_ResourceUsage &event_usage = *event.mutable_terminated()->mutable_usage();
+            event_usage.set_user_time_usec(usage.user_time_usec);
+            event_usage.set_system_time_usec(usage.system_time_usec);
+            event_usage.set_max_rss_kb(usage.max_rss_kb);
+            event_usage.set_block_reads(usage.block_reads);
+            event_usage.set_block_writes(usage.block_writes);
+        }
+        return event;
+    }
 }
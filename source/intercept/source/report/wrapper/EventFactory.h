@@ -20,6 +20,7 @@
 #pragma once
 
 #include "Domain.h"
+#include "libsys/Process.h"
 
 #include "intercept.pb.h"
 
@@ -32,10 +33,15 @@ namespace wr {
         ~EventFactory() noexcept = default;
 
         [[nodiscard]] rpc::Event start(ProcessId pid, ProcessId ppid, const Execution &execution) const;
+        [[nodiscard]] rpc::Event start(ProcessId pid, ProcessId ppid, Execution &&execution) const;
         [[nodiscard]] rpc::Event signal(int number) const;
         [[nodiscard]] rpc::Event terminate(int code) const;
+        [[nodiscard]] rpc::Event terminate(int code, const sys::ResourceUsage &usage) const;
 
     private:
         ReporterId rid_;
+        // Stamp the events with the coarse clock. Opted in through the
+        // environment, read once at construction.
+        bool coarse_clock_;
     };
 }
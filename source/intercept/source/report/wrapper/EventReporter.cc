@@ -21,20 +21,28 @@
 
 namespace wr {
 
-    EventReporter::EventReporter(const SessionLocator &session_locator) noexcept
+    EventReporter::EventReporter(const SessionLocator &session_locator)
             : event_factory()
             , client(session_locator)
     { }
 
-    void EventReporter::report_start(ProcessId pid, const Execution &execution) {
-        const auto &event = event_factory.start(pid, getppid(), execution);
-        client.report(event);
+    rust::Result<Execution> EventReporter::report_start(Execution &&execution) {
+        // The event carries the execution as this process was called
+        // with; the collector records it with the resolved one.
+        return client.resolve(event_factory.start(getpid(), getppid(), std::move(execution)));
     }
 
-    void EventReporter::report_wait(const sys::ExitStatus exit_status) {
-        const auto event = (exit_status.is_signaled())
-                ? event_factory.signal(exit_status.signal().value())
-                : event_factory.terminate(exit_status.code().value());
-        client.report(event);
+    void EventReporter::report_start_resolved(Execution &&execution) {
+        client.report(event_factory.start(getpid(), getppid(), std::move(execution)));
+    }
+
+    void EventReporter::report_wait(const sys::ExitStatus exit_status, const std::optional<sys::ResourceUsage> &usage) {
+        if (exit_status.is_signaled()) {
+            client.report(event_factory.signal(exit_status.signal().value()));
+        } else {
+            client.report(usage.has_value()
+                    ? event_factory.terminate(exit_status.code().value(), usage.value())
+                    : event_factory.terminate(exit_status.code().value()));
+        }
     }
 }
@@ -30,22 +30,33 @@ namespace wr {
     /**
      * Reports events to the interceptor gRPC service.
      *
-     * Depend on the implementation, it can collect the events and send at the very
-     * end, or it can send it immediately (sync or async).
+     * All events of this process go over a single bidirectional call.
+     * The start report doubles as the resolve handshake: it returns the
+     * execution this process shall spawn. The later life cycle events
+     * are fire-and-forget; the call is closed when this object is
+     * destructed.
      */
     class EventReporter {
     public:
-        explicit EventReporter(const wr::SessionLocator& session_locator) noexcept;
+        explicit EventReporter(const wr::SessionLocator& session_locator);
         ~EventReporter() noexcept = default;
 
-        void report_start(ProcessId pid, const Execution &execution);
-        void report_wait(sys::ExitStatus exit_status);
+        [[nodiscard]] rust::Result<Execution> report_start(Execution &&execution);
+
+        // Like report_start, but the execution is already resolved (by
+        // the local injection of a preload session); no answer is
+        // awaited from the collector.
+        void report_start_resolved(Execution &&execution);
+
+        // The termination event carries the resource usage of the child
+        // when the wait call reported one.
+        void report_wait(sys::ExitStatus exit_status, const std::optional<sys::ResourceUsage> &usage);
 
         NON_DEFAULT_CONSTRUCTABLE(EventReporter)
         NON_COPYABLE_NOR_MOVABLE(EventReporter)
 
     private:
         EventFactory event_factory;
-        InterceptorClient client;
+        SuperviseClient client;
     };
 }
@@ -19,55 +19,96 @@
 
 #include "report/wrapper/RpcClients.h"
 #include "Convert.h"
+#include "Probes.h"
 
 #include <fmt/format.h>
 #include <grpcpp/create_channel.h>
+#include <grpcpp/support/channel_arguments.h>
 #include <spdlog/spdlog.h>
 
+#include <cstdlib>
+
 namespace {
 
     std::runtime_error create_error(const grpc::Status& status) {
         return std::runtime_error(fmt::format("gRPC call failed: {}", status.error_message().data()));
     }
-}
-
-namespace wr {
 
-    SupervisorClient::SupervisorClient(const SessionLocator &session_locator)
-            : channel_(grpc::CreateChannel(session_locator, grpc::InsecureChannelCredentials()))
-            , supervisor_(rpc::Supervisor::NewStub(channel_))
-    { }
+    std::shared_ptr<grpc::Channel> create_channel(const wr::SessionLocator &session_locator) {
+        // The locator is handed to gRPC as it is, so every resolver it
+        // knows works here: DNS names, plain addresses, and the vsock
+        // URIs a guest build uses to reach a collector on the microVM
+        // host ("vsock:2:port").
+        // The collector is already listening when wr starts. Retry a
+        // failed connect quickly instead of the default backoff, which
+        // would dominate the short lifetime of this process.
+        grpc::ChannelArguments arguments;
+        arguments.SetInt(GRPC_ARG_INITIAL_RECONNECT_BACKOFF_MS, 100);
+        arguments.SetInt(GRPC_ARG_MIN_RECONNECT_BACKOFF_MS, 100);
+        return grpc::CreateCustomChannel(session_locator, grpc::InsecureChannelCredentials(), arguments);
+    }
 
-    rust::Result<wr::Execution> SupervisorClient::resolve(const wr::Execution &execution) {
-        spdlog::debug("gRPC call requested: supervise::Supervisor::Resolve");
+    // A collector listening on an external address requires a session
+    // token on every call. The intercept process injects it into the
+    // build environment, right next to the destination address. A build
+    // attached to a shared collector carries a session id the same way,
+    // so the collector can route its events separately.
+    void authorize(grpc::ClientContext &context) {
+        if (const char *token = getenv(cmd::wrapper::KEY_TOKEN); token != nullptr) {
+            context.AddMetadata(cmd::intercept::METADATA_TOKEN, token);
+        }
+        if (const char *session = getenv(cmd::wrapper::KEY_SESSION); session != nullptr) {
+            context.AddMetadata(cmd::intercept::METADATA_SESSION, session);
+        }
+    }
+}
 
-        grpc::ClientContext context;
-        rpc::ResolveRequest request;
-        rpc::ResolveResponse response;
-        request.set_allocated_execution(new rpc::Execution(into(execution)));
-        const grpc::Status status = supervisor_->Resolve(&context, request, &response);
+namespace wr {
 
-        spdlog::debug("gRPC call [Resolve] finished: {}", status.ok());
-        return status.ok()
-               ? rust::Result<wr::Execution>(rust::Ok(from(response.execution())))
-               : rust::Result<wr::Execution>(rust::Err(create_error(status)));
+    SuperviseClient::SuperviseClient(const SessionLocator &session_locator)
+            : channel_(create_channel(session_locator))
+            , interceptor_(rpc::Interceptor::NewStub(channel_))
+            , context_()
+            , stream_()
+            , finished_(false)
+    {
+        // Queue the call until the channel is connected, instead of
+        // failing fast while the connection is still being established.
+        context_.set_wait_for_ready(true);
+        authorize(context_);
+        stream_ = interceptor_->Supervise(&context_);
     }
 
-    InterceptorClient::InterceptorClient(const SessionLocator &session_locator)
-            : channel_(grpc::CreateChannel(session_locator, grpc::InsecureChannelCredentials()))
-            , interceptor_(rpc::Interceptor::NewStub(channel_))
-    { }
+    SuperviseClient::~SuperviseClient() noexcept {
+        if (!finished_) {
+            stream_->WritesDone();
+            const grpc::Status status = stream_->Finish();
+            SPDLOG_DEBUG("gRPC call [Supervise] finished: {}", status.ok());
+        }
+    }
 
-    rust::Result<int> InterceptorClient::report(const rpc::Event &event) {
-        spdlog::debug("gRPC call requested: supervise::Interceptor::Register");
+    rust::Result<wr::Execution> SuperviseClient::resolve(const rpc::Event &event) {
+        SPDLOG_DEBUG("gRPC call requested: supervise::Interceptor::Supervise");
+        BEAR_PROBE(wr_resolve_begin);
 
-        grpc::ClientContext context;
-        google::protobuf::Empty response;
-        const grpc::Status status = interceptor_->Register(&context, event, &response);
+        rpc::ResolveResponse response;
+        const bool ok = stream_->Write(event) && stream_->Read(&response);
+
+        SPDLOG_DEBUG("gRPC call [Supervise] resolved: {}", ok);
+        BEAR_PROBE(wr_resolve_end);
+        if (ok) {
+            return rust::Ok(from(std::move(*response.mutable_execution())));
+        }
+        // The status of the failed stream carries the reason.
+        finished_ = true;
+        return rust::Err(create_error(stream_->Finish()));
+    }
 
-        spdlog::debug("gRPC call [Register] finished: {}", status.ok());
-        return status.ok()
-                ? rust::Result<int>(rust::Ok(0))
-                : rust::Result<int>(rust::Err(create_error(status)));
+    void SuperviseClient::report(const rpc::Event &event) {
+        BEAR_PROBE(wr_report_begin);
+        // Fire-and-forget: a failed write surfaces when the stream is
+        // closed, and there is nothing this process could do about it.
+        stream_->Write(event);
+        BEAR_PROBE(wr_report_end);
     }
 }
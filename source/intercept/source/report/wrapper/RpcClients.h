@@ -27,37 +27,40 @@
 #include <memory>
 
 #include <grpcpp/channel.h>
+#include <grpcpp/client_context.h>
+#include <grpcpp/support/sync_stream.h>
 #include "intercept.grpc.pb.h"
 #include "supervise.grpc.pb.h"
 
 namespace wr {
     using namespace domain;
 
-    class SupervisorClient {
+    // The single registration call of a supervised process.
+    //
+    // All the traffic of one process goes over one bidirectional stream:
+    // the started event is the first message, its response tells how to
+    // execute the program, and the later life cycle events need no
+    // response. The stream is closed when this object is destructed.
+    class SuperviseClient {
     public:
-        explicit SupervisorClient(const wr::SessionLocator& session_locator);
+        explicit SuperviseClient(const wr::SessionLocator& session_locator);
+        ~SuperviseClient() noexcept;
 
-        rust::Result<wr::Execution> resolve(const wr::Execution &);
+        // Send the started event and wait for the resolved execution.
+        // Shall be called once, before any other report.
+        rust::Result<wr::Execution> resolve(const rpc::Event &);
 
-        NON_DEFAULT_CONSTRUCTABLE(SupervisorClient)
-        NON_COPYABLE_NOR_MOVABLE(SupervisorClient)
+        // Send a life cycle event, without waiting for any answer.
+        void report(const rpc::Event &);
 
-    private:
-        std::shared_ptr<::grpc::Channel> channel_;
-        std::unique_ptr<rpc::Supervisor::Stub> supervisor_;
-    };
-
-    class InterceptorClient {
-    public:
-        explicit InterceptorClient(const wr::SessionLocator& session_locator);
-
-        rust::Result<int> report(const rpc::Event &);
-
-        NON_DEFAULT_CONSTRUCTABLE(InterceptorClient)
-        NON_COPYABLE_NOR_MOVABLE(InterceptorClient)
+        NON_DEFAULT_CONSTRUCTABLE(SuperviseClient)
+        NON_COPYABLE_NOR_MOVABLE(SuperviseClient)
 
     private:
         std::shared_ptr<::grpc::Channel> channel_;
         std::unique_ptr<rpc::Interceptor::Stub> interceptor_;
+        ::grpc::ClientContext context_;
+        std::unique_ptr<::grpc::ClientReaderWriter<rpc::Event, rpc::ResolveResponse>> stream_;
+        bool finished_;
     };
 }
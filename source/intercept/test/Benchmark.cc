@@ -0,0 +1,188 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "collect/db/EventsDatabaseReader.h"
+#include "collect/db/EventsDatabaseWriter.h"
+#include "report/wrapper/EventFactory.h"
+
+#include <fmt/format.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+using ic::collect::db::EventsDatabaseFormat;
+using ic::collect::db::EventsDatabaseReader;
+using ic::collect::db::EventsDatabaseWriter;
+
+namespace {
+
+    // The corpus models the event sizes of a real build: mostly small
+    // compiler calls, a few medium sized ones with long include paths,
+    // and the occasional linker call with a command line of a couple of
+    // hundred kilobytes.
+    std::vector<rpc::Event> generate_corpus() {
+        const wr::EventFactory factory;
+        std::vector<rpc::Event> result;
+
+        const std::map<std::string, std::string> environment = {
+                {"PATH", "/usr/local/bin:/usr/bin:/bin"},
+                {"HOME", "/home/user"},
+                {"LANG", "C.UTF-8"},
+        };
+        // Tiny: a cc1 call with a handful of arguments.
+        for (size_t index = 0; index < 64; ++index) {
+            result.emplace_back(factory.start(1000 + index, 999, wr::Execution {
+                    fs::path("/usr/libexec/gcc/cc1"),
+                    {"cc1", "-quiet", fmt::format("source_{}.c", index), "-o", "/tmp/ccXXXXXX.s"},
+                    fs::path("/home/user/project"),
+                    environment,
+            }));
+        }
+        // Medium: a compiler driver call with warnings, defines and a
+        // dozen include directories.
+        for (size_t index = 0; index < 16; ++index) {
+            std::list<std::string> arguments = {
+                    "g++", "-c", "-O2", "-g", "-Wall", "-Wextra", "-std=c++17",
+                    "-DNDEBUG", "-DVERSION=\"1.2.3\"", "-fPIC",
+            };
+            for (size_t include = 0; include < 12; ++include) {
+                arguments.emplace_back(fmt::format("-I/home/user/project/module_{}/include", include));
+            }
+            arguments.emplace_back(fmt::format("module/source_{}.cpp", index));
+            result.emplace_back(factory.start(2000 + index, 999, wr::Execution {
+                    fs::path("/usr/bin/g++"),
+                    std::move(arguments),
+                    fs::path("/home/user/project"),
+                    environment,
+            }));
+        }
+        // Large: a linker call naming a few thousand object files, the
+        // command line alone is around 200 KB.
+        {
+            std::list<std::string> arguments = {"ld", "-o", "product"};
+            for (size_t object = 0; object < 4096; ++object) {
+                arguments.emplace_back(fmt::format("/home/user/project/_build/objects/translation_unit_{:04}.o", object));
+            }
+            result.emplace_back(factory.start(3000, 999, wr::Execution {
+                    fs::path("/usr/bin/ld"),
+                    std::move(arguments),
+                    fs::path("/home/user/project"),
+                    environment,
+            }));
+        }
+        // Every start event has a matching terminate event.
+        const auto started = result.size();
+        for (size_t index = 0; index < started; ++index) {
+            result.emplace_back(factory.terminate(0));
+        }
+        return result;
+    }
+
+    const std::vector<rpc::Event> CORPUS = generate_corpus();
+
+    size_t corpus_bytes() {
+        size_t result = 0;
+        for (const auto &event : CORPUS) {
+            result += event.ByteSizeLong();
+        }
+        return result;
+    }
+
+    // A file the events can be written into, removed on destruction.
+    struct TemporaryFile {
+        TemporaryFile()
+                : path(fs::temp_directory_path() / fmt::format("events-bench-{}.db", getpid()))
+        { }
+
+        ~TemporaryFile() {
+            std::remove(path.c_str());
+        }
+
+        const fs::path path;
+    };
+
+    void db_writer(benchmark::State &state, EventsDatabaseFormat format) {
+        // The null device takes the write calls without growing a file,
+        // so the serialization and batching costs dominate the numbers.
+        const auto database = EventsDatabaseWriter::create(fs::path("/dev/null"), format).unwrap();
+        for (auto _ : state) {
+            for (const auto &event : CORPUS) {
+                auto result = database->insert_event(event);
+                benchmark::DoNotOptimize(result);
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * CORPUS.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * corpus_bytes()));
+    }
+
+    void db_writer_binary(benchmark::State &state) {
+        db_writer(state, EventsDatabaseFormat::BINARY);
+    }
+
+    void db_writer_json(benchmark::State &state) {
+        db_writer(state, EventsDatabaseFormat::JSON);
+    }
+
+    void db_reader(benchmark::State &state, EventsDatabaseFormat format) {
+        const TemporaryFile file;
+        {
+            const auto database = EventsDatabaseWriter::create(file.path, format).unwrap();
+            for (const auto &event : CORPUS) {
+                database->insert_event(event).unwrap();
+            }
+            database->flush().unwrap();
+        }
+        for (auto _ : state) {
+            const auto database = EventsDatabaseReader::from(file.path).unwrap();
+            size_t count = 0;
+            while (auto event = database->next()) {
+                benchmark::DoNotOptimize(event);
+                ++count;
+            }
+            if (count != CORPUS.size()) {
+                state.SkipWithError("the reader lost events");
+                return;
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * CORPUS.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * fs::file_size(file.path)));
+    }
+
+    void db_reader_binary(benchmark::State &state) {
+        db_reader(state, EventsDatabaseFormat::BINARY);
+    }
+
+    void db_reader_json(benchmark::State &state) {
+        db_reader(state, EventsDatabaseFormat::JSON);
+    }
+
+    BENCHMARK(db_writer_binary);
+    BENCHMARK(db_writer_json);
+    BENCHMARK(db_reader_binary);
+    BENCHMARK(db_reader_json);
+}
+
+BENCHMARK_MAIN();
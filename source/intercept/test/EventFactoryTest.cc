@@ -19,6 +19,7 @@
 
 #include "gtest/gtest.h"
 
+#include "HybridClock.h"
 #include "report/wrapper/EventFactory.h"
 
 namespace {
@@ -53,4 +54,39 @@ namespace {
 
         EXPECT_NE(start1.rid(), start2.rid());
     }
+
+    TEST(event_factory, start_event_carries_the_execution)
+    {
+        wr::EventFactory sut;
+        auto start = sut.start(TEST_PID, TEST_PPID, TEST_EXECUTION);
+
+        const auto &execution = start.started().execution();
+        EXPECT_EQ(execution.executable(), "/usr/bin/ls");
+        EXPECT_EQ(execution.arguments_size(), 2);
+        EXPECT_EQ(execution.working_dir(), "/home/user");
+        EXPECT_EQ(execution.environment_size(), 1);
+    }
+
+    TEST(event_factory, events_carry_a_monotonic_clock)
+    {
+        wr::EventFactory sut;
+        auto start = sut.start(TEST_PID, TEST_PPID, TEST_EXECUTION);
+        auto stop = sut.terminate(0);
+
+        EXPECT_NE(start.clock(), 0u);
+        EXPECT_LT(start.clock(), stop.clock());
+        EXPECT_EQ(start.node(), stop.node());
+        EXPECT_NE(start.node(), 0u);
+    }
+
+    TEST(event_factory, observed_clocks_push_the_local_clock_forward)
+    {
+        wr::EventFactory sut;
+        auto before = sut.start(TEST_PID, TEST_PPID, TEST_EXECUTION);
+        // an event from a node whose wall clock runs ahead of ours.
+        domain::hlc::observe(before.clock() + (1u << 20));
+        auto after = sut.terminate(0);
+
+        EXPECT_GT(after.clock(), before.clock() + (1u << 20));
+    }
 }
@@ -0,0 +1,320 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "collect/db/EventsDatabaseFormat.h"
+#include "collect/db/EventsDatabaseReader.h"
+#include "collect/db/EventsDatabaseWriter.h"
+#include "collect/db/ZstdStream.h"
+
+#include <google/protobuf/util/message_differencer.h>
+#include <fmt/format.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+using ic::collect::db::EventsDatabaseEventKind;
+using ic::collect::db::EventsDatabaseFormat;
+using ic::collect::db::EventsDatabaseReader;
+using ic::collect::db::EventsDatabaseWriter;
+
+namespace {
+
+    // A file the events can be written into, removed on destruction.
+    struct TemporaryFile {
+        TemporaryFile()
+                : path(fs::temp_directory_path()
+                        / fmt::format("events-test-{}-{}.db", getpid(), counter++))
+        { }
+
+        ~TemporaryFile() {
+            std::remove(path.c_str());
+        }
+
+        const fs::path path;
+        static size_t counter;
+    };
+
+    size_t TemporaryFile::counter = 0;
+
+    rpc::Event started(uint64_t rid, uint32_t pid, const std::string &source) {
+        rpc::Event event;
+        event.set_rid(rid);
+        event.mutable_timestamp()->set_seconds(int64_t(1000 + rid));
+        auto *start = event.mutable_started();
+        start->set_pid(pid);
+        start->set_ppid(1);
+        auto *execution = start->mutable_execution();
+        execution->set_executable("/usr/bin/cc");
+        execution->add_arguments("cc");
+        execution->add_arguments("-c");
+        execution->add_arguments("-O2");
+        // a long repeated value, so the string table interning kicks in.
+        execution->add_arguments("-I/opt/toolchain/sysroot/usr/include/c++/current");
+        execution->add_arguments(source);
+        execution->set_working_dir(EventsDatabaseWriter::session_root().empty()
+                ? std::string("/home/user/project")
+                : EventsDatabaseWriter::session_root());
+        auto &environment = *execution->mutable_environment();
+        environment["PATH"] = "/usr/local/bin:/usr/bin:/bin";
+        environment["LANG"] = "C.UTF-8";
+        return event;
+    }
+
+    rpc::Event terminated(uint64_t rid, int64_t status) {
+        rpc::Event event;
+        event.set_rid(rid);
+        event.mutable_timestamp()->set_seconds(int64_t(2000 + rid));
+        event.mutable_terminated()->set_status(status);
+        return event;
+    }
+
+    rpc::Event signalled(uint64_t rid, int32_t number) {
+        rpc::Event event;
+        event.set_rid(rid);
+        event.mutable_timestamp()->set_seconds(int64_t(3000 + rid));
+        event.mutable_signalled()->set_number(number);
+        return event;
+    }
+
+    // A corpus touching every encoding: shared environments, repeated
+    // argument values, paths under the session root, and all three
+    // lifecycle event kinds.
+    std::vector<rpc::Event> test_events() {
+        std::vector<rpc::Event> result;
+        result.emplace_back(started(1, 101, "main.c"));
+        result.emplace_back(started(2, 102, "util.c"));
+        result.emplace_back(terminated(1, 0));
+        result.emplace_back(started(3, 103, "parse.c"));
+        result.emplace_back(signalled(2, 9));
+        result.emplace_back(terminated(3, 1));
+        return result;
+    }
+
+    void write_events(const EventsDatabaseWriter::Ptr &writer, const std::vector<rpc::Event> &events) {
+        for (const auto &event : events) {
+            ASSERT_TRUE(writer->insert_event(event).is_ok());
+        }
+        ASSERT_TRUE(writer->flush().is_ok());
+    }
+
+    std::vector<rpc::Event> read_events(const fs::path &path) {
+        std::vector<rpc::Event> result;
+        auto reader = EventsDatabaseReader::from(path);
+        EXPECT_TRUE(reader.is_ok());
+        if (reader.is_ok()) {
+            while (auto event = reader.unwrap()->next()) {
+                EXPECT_TRUE(event.value().is_ok());
+                if (event.value().is_ok()) {
+                    result.emplace_back(*event.value().unwrap());
+                }
+            }
+        }
+        return result;
+    }
+
+    void expect_same_events(const std::vector<rpc::Event> &written, const std::vector<rpc::Event> &read) {
+        ASSERT_EQ(written.size(), read.size());
+        for (size_t index = 0; index < written.size(); ++index) {
+            EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(written[index], read[index]))
+                    << "event " << index << " differs:\n"
+                    << "written: " << written[index].ShortDebugString() << "\n"
+                    << "read:    " << read[index].ShortDebugString();
+        }
+    }
+
+    TEST(events_db, binary_round_trip)
+    {
+        const TemporaryFile file;
+        const auto events = test_events();
+        write_events(EventsDatabaseWriter::create(file.path).unwrap(), events);
+
+        expect_same_events(events, read_events(file.path));
+    }
+
+    TEST(events_db, json_round_trip)
+    {
+        const TemporaryFile file;
+        const auto events = test_events();
+        write_events(EventsDatabaseWriter::create(file.path, EventsDatabaseFormat::JSON).unwrap(), events);
+
+        expect_same_events(events, read_events(file.path));
+    }
+
+    TEST(events_db, compressed_round_trip)
+    {
+        if (!ic::collect::db::zstd_supported()) {
+            GTEST_SKIP() << "zstd support is not built in";
+        }
+        const TemporaryFile file;
+        const auto events = test_events();
+        const auto writer = EventsDatabaseWriter::create(
+                file.path, EventsDatabaseFormat::BINARY,
+                EventsDatabaseWriter::DEFAULT_FLUSH_THRESHOLD, true);
+        write_events(writer.unwrap(), events);
+
+        expect_same_events(events, read_events(file.path));
+    }
+
+    TEST(events_db, marker_colliding_paths_survive)
+    {
+        // A value genuinely starting with the root (or string) marker
+        // byte shall come back verbatim through the escape encoding.
+        const TemporaryFile file;
+        std::vector<rpc::Event> events = { started(1, 101, "\x01/odd.c") };
+        events.front().mutable_started()->mutable_execution()->set_executable("\x03/usr/bin/cc");
+        write_events(EventsDatabaseWriter::create(file.path).unwrap(), events);
+
+        expect_same_events(events, read_events(file.path));
+    }
+
+    TEST(events_db, reads_version_1_files)
+    {
+        // The original binary format: the magic, version one, and plain
+        // length prefixed records. Old files shall stay readable.
+        const TemporaryFile file;
+        const auto events = test_events();
+        {
+            std::ofstream sink(file.path, std::ios::binary);
+            sink.write(ic::collect::db::EVENTS_DB_MAGIC, ic::collect::db::EVENTS_DB_MAGIC_SIZE);
+            const uint32_t version = ic::collect::db::EVENTS_DB_VERSION;
+            sink.write(reinterpret_cast<const char *>(&version), sizeof(version));
+            for (const auto &event : events) {
+                const auto payload = event.SerializeAsString();
+                const auto length = uint32_t(payload.size());
+                sink.write(reinterpret_cast<const char *>(&length), sizeof(length));
+                sink.write(payload.data(), std::streamsize(payload.size()));
+            }
+        }
+
+        expect_same_events(events, read_events(file.path));
+    }
+
+    TEST(events_db, resume_appends_after_a_torn_tail)
+    {
+        const TemporaryFile file;
+        const auto before = test_events();
+        write_events(EventsDatabaseWriter::create(file.path).unwrap(), before);
+        {
+            // a crashed writer leaves a torn record: a framing that
+            // promises more bytes than the file holds.
+            std::ofstream sink(file.path, std::ios::binary | std::ios::app);
+            const char torn[] = {100, 0, 0, 0, 0, 0, 0, 0, 'x', 'y', 'z'};
+            sink.write(torn, sizeof(torn));
+        }
+        const std::vector<rpc::Event> after = {
+                started(7, 107, "late.c"),
+                terminated(7, 0),
+        };
+        write_events(EventsDatabaseWriter::resume(file.path).unwrap(), after);
+
+        std::vector<rpc::Event> expected(before);
+        expected.insert(expected.end(), after.begin(), after.end());
+        expect_same_events(expected, read_events(file.path));
+    }
+
+    TEST(events_db, corrupted_records_are_skipped)
+    {
+        const TemporaryFile file;
+        const auto events = test_events();
+        size_t target = 0;
+        {
+            const auto writer = EventsDatabaseWriter::create(
+                    file.path, EventsDatabaseFormat::BINARY,
+                    EventsDatabaseWriter::DEFAULT_FLUSH_THRESHOLD, false, true);
+            write_events(writer.unwrap(), events);
+            // The index offsets are relative to the end of the file
+            // header; the last entry closes the file, which gives the
+            // header size without knowing the header layout.
+            const auto &index = writer.unwrap()->index();
+            ASSERT_FALSE(index.empty());
+            const auto &last = index.back();
+            const size_t framing = ic::collect::db::EVENTS_DB_LENGTH_PREFIX_SIZE
+                    + ic::collect::db::EVENTS_DB_CRC_SIZE;
+            const size_t header = fs::file_size(file.path) - (last.offset + framing + last.length);
+            // damage the payload of the second started record.
+            size_t found = 0;
+            for (const auto &entry : index) {
+                if ((entry.kind == EventsDatabaseEventKind::STARTED) && (++found == 2)) {
+                    target = header + entry.offset + framing + 1;
+                    break;
+                }
+            }
+            ASSERT_NE(target, 0u);
+        }
+        {
+            std::fstream sink(file.path, std::ios::binary | std::ios::in | std::ios::out);
+            sink.seekp(std::streamoff(target));
+            sink.put('\xff');
+        }
+
+        // the damaged record is dropped, everything around it survives.
+        const auto read = read_events(file.path);
+        std::vector<rpc::Event> expected;
+        size_t found = 0;
+        for (const auto &event : events) {
+            if (event.has_started() && (++found == 2)) {
+                continue;
+            }
+            expected.emplace_back(event);
+        }
+        expect_same_events(expected, read);
+    }
+
+    TEST(events_db, writer_index_covers_the_records)
+    {
+        const TemporaryFile file;
+        const auto events = test_events();
+        const auto writer = EventsDatabaseWriter::create(
+                file.path, EventsDatabaseFormat::BINARY,
+                EventsDatabaseWriter::DEFAULT_FLUSH_THRESHOLD, false, true);
+        write_events(writer.unwrap(), events);
+
+        const auto &index = writer.unwrap()->index();
+        // every lifecycle event has an entry (the interning definitions
+        // have their own), at strictly increasing offsets.
+        ASSERT_GE(index.size(), events.size());
+        size_t lifecycle = 0;
+        uint64_t previous_end = 0;
+        for (const auto &entry : index) {
+            EXPECT_GE(entry.offset, previous_end);
+            previous_end = entry.offset + entry.length;
+            switch (entry.kind) {
+                case EventsDatabaseEventKind::STARTED:
+                case EventsDatabaseEventKind::TERMINATED:
+                case EventsDatabaseEventKind::SIGNALLED:
+                    ++lifecycle;
+                    // the process identity is filled from the started
+                    // event of the rid.
+                    EXPECT_NE(entry.pid, 0u);
+                    EXPECT_NE(entry.timestamp, 0u);
+                    break;
+                default:
+                    break;
+            }
+        }
+        EXPECT_EQ(lifecycle, events.size());
+    }
+}
@@ -0,0 +1,156 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "collect/PathProbeCache.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+using ic::ProbeEntries;
+using ic::ProbeIdentity;
+using ic::ProbeKey;
+
+namespace {
+
+    // A scratch directory which is also the probe cache location for
+    // the duration of the test, removed on destruction.
+    struct TemporaryCacheDir {
+        TemporaryCacheDir()
+                : root(fs::temp_directory_path()
+                        / ("path-probe-test-" + std::to_string(getpid()) + "-" + std::to_string(counter++)))
+        {
+            fs::create_directories(root);
+            ::setenv("XDG_CACHE_HOME", root.c_str(), 1);
+        }
+
+        ~TemporaryCacheDir() {
+            ::unsetenv("XDG_CACHE_HOME");
+            std::error_code error_code;
+            fs::remove_all(root, error_code);
+        }
+
+        const fs::path root;
+        static size_t counter;
+    };
+
+    size_t TemporaryCacheDir::counter = 0;
+
+    void touch(const fs::path &file, const std::string &content) {
+        std::ofstream sink(file);
+        sink << content;
+    }
+
+    TEST(path_probe_cache, entries_round_trip_through_the_file)
+    {
+        const TemporaryCacheDir cache;
+        const fs::path file = cache.root / "path-probes";
+
+        ProbeEntries written;
+        written[ProbeKey("/usr/local/lib/bear/libexec.so", R_OK)] =
+                std::make_pair(std::string("/opt/bear/lib/libexec.so"),
+                               ProbeIdentity{2049, 131072, 1700000000, 65536});
+        written[ProbeKey("/path with spaces/wrapper", X_OK)] =
+                std::make_pair(std::string("/other path/with spaces/wrapper"),
+                               ProbeIdentity{1, 2, 3, 4});
+        ic::write_probe_cache(file, written);
+
+        EXPECT_EQ(written, ic::read_probe_cache(file));
+    }
+
+    TEST(path_probe_cache, write_merges_with_a_concurrent_writer)
+    {
+        const TemporaryCacheDir cache;
+        const fs::path file = cache.root / "path-probes";
+
+        // another session wrote its probe after this process read the
+        // (then empty) file; the write shall not wipe it.
+        ProbeEntries theirs;
+        theirs[ProbeKey("/their/library", R_OK)] =
+                std::make_pair(std::string("/their/resolved"), ProbeIdentity{1, 2, 3, 4});
+        ic::write_probe_cache(file, theirs);
+
+        ProbeEntries ours;
+        ours[ProbeKey("/our/library", R_OK)] =
+                std::make_pair(std::string("/our/resolved"), ProbeIdentity{5, 6, 7, 8});
+        ic::write_probe_cache(file, ours);
+
+        const auto merged = ic::read_probe_cache(file);
+        EXPECT_EQ(2u, merged.size());
+        EXPECT_EQ(1u, merged.count(ProbeKey("/their/library", R_OK)));
+        EXPECT_EQ(1u, merged.count(ProbeKey("/our/library", R_OK)));
+    }
+
+    TEST(path_probe_cache, canonical_path_round_trips_through_the_cache)
+    {
+        const TemporaryCacheDir cache;
+        const fs::path target = cache.root / "library.so";
+        const fs::path link = cache.root / "library-link.so";
+        touch(target, "content");
+        fs::create_symlink(target, link);
+
+        // the first call resolves and populates the cache ...
+        auto first = ic::canonical_path(link.string(), R_OK);
+        ASSERT_TRUE(first.is_ok());
+        EXPECT_EQ(fs::canonical(target).string(), first.unwrap());
+        EXPECT_EQ(1u, ic::read_probe_cache(ic::probe_cache_file())
+                .count(ProbeKey(link.string(), R_OK)));
+
+        // ... which the second call serves the same answer from.
+        auto second = ic::canonical_path(link.string(), R_OK);
+        ASSERT_TRUE(second.is_ok());
+        EXPECT_EQ(first.unwrap(), second.unwrap());
+    }
+
+    TEST(path_probe_cache, retargeted_symlink_invalidates_the_hit)
+    {
+        const TemporaryCacheDir cache;
+        const fs::path old_target = cache.root / "library-1.so";
+        const fs::path new_target = cache.root / "library-2.so";
+        const fs::path link = cache.root / "library.so";
+        touch(old_target, "old");
+        touch(new_target, "newer");
+        fs::create_symlink(old_target, link);
+
+        auto first = ic::canonical_path(link.string(), R_OK);
+        ASSERT_TRUE(first.is_ok());
+        EXPECT_EQ(fs::canonical(old_target).string(), first.unwrap());
+
+        // the installation changed under the same probe path: the
+        // cached entry shall not win over the current link target.
+        fs::remove(link);
+        fs::create_symlink(new_target, link);
+
+        auto second = ic::canonical_path(link.string(), R_OK);
+        ASSERT_TRUE(second.is_ok());
+        EXPECT_EQ(fs::canonical(new_target).string(), second.unwrap());
+    }
+
+    TEST(path_probe_cache, missing_file_is_an_error)
+    {
+        const TemporaryCacheDir cache;
+        const fs::path absent = cache.root / "no-such-library.so";
+
+        EXPECT_TRUE(ic::canonical_path(absent.string(), R_OK).is_err());
+    }
+}
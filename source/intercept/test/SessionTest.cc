@@ -38,6 +38,12 @@ namespace {
             (const ic::Execution &),
             (const, override));
 
+        MOCK_METHOD(
+            (sys::env::Vars),
+            environment,
+            (const sys::env::Vars &),
+            (const, override));
+
         using Session::keep_front_in_path;
         using Session::remove_from_path;
     };
@@ -53,12 +53,16 @@ namespace {
     el::Session SILENT_SESSION = {
         "/usr/bin/intercept",
         "/tmp/intercept.random",
+        nullptr,
+        nullptr,
         false
     };
 
     el::Session VERBOSE_SESSION = {
         "/usr/bin/intercept",
         "/tmp/intercept.random",
+        nullptr,
+        nullptr,
         true
     };
 
@@ -112,9 +116,8 @@ namespace {
         EXPECT_CALL(linker,execve(SILENT_SESSION.reporter,
                                   CStyleArrayEqual(std::vector<const char *> {
                                       SILENT_SESSION.reporter,
-                                      cmd::wrapper::FLAG_DESTINATION,
+                                      cmd::wrapper::TAG_SUPERVISE,
                                       SILENT_SESSION.destination,
-                                      cmd::wrapper::FLAG_EXECUTE,
                                       LS_PATH,
                                       cmd::wrapper::FLAG_COMMAND,
                                       LS_ARGV[0],
@@ -141,10 +144,8 @@ namespace {
         EXPECT_CALL(linker, execve(VERBOSE_SESSION.reporter,
                                    CStyleArrayEqual(std::vector<const char *> {
                                            VERBOSE_SESSION.reporter,
-                                           cmd::wrapper::FLAG_DESTINATION,
+                                           cmd::wrapper::TAG_SUPERVISE,
                                            VERBOSE_SESSION.destination,
-                                           cmd::wrapper::FLAG_VERBOSE,
-                                           cmd::wrapper::FLAG_EXECUTE,
                                            LS_PATH,
                                            cmd::wrapper::FLAG_COMMAND,
                                            LS_ARGV[0],
@@ -158,6 +159,47 @@ namespace {
         EXPECT_EQ(expected, result);
     }
 
+    TEST(Executor, execve_filtered_passes_through)
+    {
+        const rust::Result<int, int> expected = rust::Ok(0);
+
+        el::Session session = SILENT_SESSION;
+        session.filter = "cc:c++";
+
+        // a filtered execution reaches the real call with the caller's
+        // original pointers, without resolution.
+        ResolverMock resolver;
+        EXPECT_CALL(resolver, from_current_directory(_)).Times(0);
+
+        LinkerMock linker;
+        EXPECT_CALL(linker, execve(LS_PATH, LS_ARGV, LS_ENVP))
+                .Times(1)
+                .WillOnce(Return(expected));
+
+        auto result = el::Executor(linker, session, resolver).execve(LS_PATH, LS_ARGV, LS_ENVP);
+        EXPECT_EQ(expected, result);
+    }
+
+    TEST(Executor, spawn_filtered_passes_through)
+    {
+        const rust::Result<int, int> expected = rust::Ok(0);
+
+        el::Session session = SILENT_SESSION;
+        session.filter = "cc:c++";
+
+        ResolverMock resolver;
+        EXPECT_CALL(resolver, from_current_directory(_)).Times(0);
+
+        pid_t pid;
+        LinkerMock linker;
+        EXPECT_CALL(linker, posix_spawn(&pid, LS_PATH, nullptr, nullptr, LS_ARGV, LS_ENVP))
+                .Times(1)
+                .WillOnce(Return(expected));
+
+        auto result = el::Executor(linker, session, resolver).posix_spawn(&pid, LS_PATH, nullptr, nullptr, LS_ARGV, LS_ENVP);
+        EXPECT_EQ(expected, result);
+    }
+
     TEST(Executor, execvpe_fails_on_resolve)
     {
         const rust::Result<int, int> expected = rust::Err(ENOENT);
@@ -188,10 +230,8 @@ namespace {
         EXPECT_CALL(linker, execve(VERBOSE_SESSION.reporter,
                                    CStyleArrayEqual(std::vector<const char *> {
                                        VERBOSE_SESSION.reporter,
-                                       cmd::wrapper::FLAG_DESTINATION,
+                                       cmd::wrapper::TAG_SUPERVISE,
                                        VERBOSE_SESSION.destination,
-                                       cmd::wrapper::FLAG_VERBOSE,
-                                       cmd::wrapper::FLAG_EXECUTE,
                                        LS_PATH,
                                        cmd::wrapper::FLAG_COMMAND,
                                        LS_ARGV[0],
@@ -218,10 +258,8 @@ namespace {
         EXPECT_CALL(linker, execve(VERBOSE_SESSION.reporter,
                                    CStyleArrayEqual(std::vector<const char *> {
                                            VERBOSE_SESSION.reporter,
-                                           cmd::wrapper::FLAG_DESTINATION,
+                                           cmd::wrapper::TAG_SUPERVISE,
                                            VERBOSE_SESSION.destination,
-                                           cmd::wrapper::FLAG_VERBOSE,
-                                           cmd::wrapper::FLAG_EXECUTE,
                                            LS_PATH,
                                            cmd::wrapper::FLAG_COMMAND,
                                            LS_ARGV[0],
@@ -249,10 +287,8 @@ namespace {
         EXPECT_CALL(linker, posix_spawn(&pid, VERBOSE_SESSION.reporter, nullptr, nullptr,
                                         CStyleArrayEqual(std::vector<const char *> {
                                                 VERBOSE_SESSION.reporter,
-                                                cmd::wrapper::FLAG_DESTINATION,
+                                                cmd::wrapper::TAG_SUPERVISE,
                                                 VERBOSE_SESSION.destination,
-                                                cmd::wrapper::FLAG_VERBOSE,
-                                                cmd::wrapper::FLAG_EXECUTE,
                                                 LS_PATH,
                                                 cmd::wrapper::FLAG_COMMAND,
                                                 LS_ARGV[0],
@@ -298,10 +334,8 @@ namespace {
         EXPECT_CALL(linker, posix_spawn(&pid, VERBOSE_SESSION.reporter, nullptr, nullptr,
                                         CStyleArrayEqual(std::vector<const char *> {
                                                 VERBOSE_SESSION.reporter,
-                                                cmd::wrapper::FLAG_DESTINATION,
+                                                cmd::wrapper::TAG_SUPERVISE,
                                                 VERBOSE_SESSION.destination,
-                                                cmd::wrapper::FLAG_VERBOSE,
-                                                cmd::wrapper::FLAG_EXECUTE,
                                                 LS_PATH,
                                                 cmd::wrapper::FLAG_COMMAND,
                                                 LS_ARGV[0],
@@ -0,0 +1,116 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "report/libexec/Resolver.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    // Two search path directories and a unique tool name per test, so
+    // the resolutions of one test never hit the cache entries of
+    // another. Removed on destruction.
+    struct TemporaryPath {
+        explicit TemporaryPath(const char *name)
+                : root(fs::temp_directory_path()
+                        / ("resolver-test-" + std::to_string(getpid()) + "-" + name))
+                , early(root / "early")
+                , late(root / "late")
+                , search_path(early.string() + ":" + late.string())
+        {
+            fs::create_directories(early);
+            fs::create_directories(late);
+        }
+
+        ~TemporaryPath() {
+            std::error_code error_code;
+            fs::remove_all(root, error_code);
+        }
+
+        static void install(const fs::path &file) {
+            std::ofstream(file) << "#!/bin/sh\n";
+            ::chmod(file.c_str(), 0755);
+        }
+
+        const fs::path root;
+        const fs::path early;
+        const fs::path late;
+        const std::string search_path;
+    };
+
+    TEST(Resolver, finds_the_executable_on_the_search_path)
+    {
+        const TemporaryPath dirs("finds");
+        TemporaryPath::install(dirs.late / "tool-finds");
+
+        el::Resolver resolver;
+        auto result = resolver.from_search_path("tool-finds", dirs.search_path.c_str());
+        ASSERT_TRUE(result.is_ok());
+        EXPECT_EQ((dirs.late / "tool-finds").string(), result.unwrap());
+    }
+
+    TEST(Resolver, reports_when_nothing_matches)
+    {
+        const TemporaryPath dirs("misses");
+
+        el::Resolver resolver;
+        EXPECT_TRUE(resolver.from_search_path("tool-misses", dirs.search_path.c_str()).is_err());
+    }
+
+    TEST(Resolver, an_earlier_directory_wins_over_the_cached_resolution)
+    {
+        const TemporaryPath dirs("order");
+        TemporaryPath::install(dirs.late / "tool-order");
+
+        el::Resolver resolver;
+        // the first resolution lands in the cache ...
+        auto before = resolver.from_search_path("tool-order", dirs.search_path.c_str());
+        ASSERT_TRUE(before.is_ok());
+        EXPECT_EQ((dirs.late / "tool-order").string(), before.unwrap());
+
+        // ... and shall not be served once an earlier search path
+        // directory gains the file: the walk order decides, like the
+        // exec of the shell would.
+        TemporaryPath::install(dirs.early / "tool-order");
+        auto after = resolver.from_search_path("tool-order", dirs.search_path.c_str());
+        ASSERT_TRUE(after.is_ok());
+        EXPECT_EQ((dirs.early / "tool-order").string(), after.unwrap());
+    }
+
+    TEST(Resolver, removed_file_invalidates_the_cached_resolution)
+    {
+        const TemporaryPath dirs("gone");
+        TemporaryPath::install(dirs.late / "tool-gone");
+
+        el::Resolver resolver;
+        ASSERT_TRUE(resolver.from_search_path("tool-gone", dirs.search_path.c_str()).is_ok());
+
+        fs::remove(dirs.late / "tool-gone");
+        EXPECT_TRUE(resolver.from_search_path("tool-gone", dirs.search_path.c_str()).is_err());
+    }
+}
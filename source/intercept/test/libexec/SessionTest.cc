@@ -57,6 +57,45 @@ namespace {
         EXPECT_EQ(false, sut.verbose);
     }
 
+    TEST(Session, capture_ring_and_filter)
+    {
+        const char* envp[] = {
+            "INTERCEPT_REPORT_DESTINATION=/tmp/intercept.random",
+            "INTERCEPT_REPORT_COMMAND=/usr/bin/intercept",
+            "INTERCEPT_REPORT_RING=/bear-1234",
+            "INTERCEPT_REPORT_FILTER=cc:c++",
+            nullptr
+        };
+
+        el::Session sut {};
+        el::session::from(sut, envp);
+        ASSERT_TRUE(el::session::is_valid(sut));
+
+        EXPECT_STREQ("/bear-1234", sut.ring);
+        EXPECT_STREQ("cc:c++", sut.filter);
+    }
+
+    TEST(Session, capture_skips_lookalike_keys)
+    {
+        const char* envp[] = {
+            "INTERCEPT_REPORT_DESTINATIOX=/tmp/wrong",
+            "INTERCEPT_REPORT_COMMANX=/usr/bin/wrong",
+            "INTERCEPT_REPORT_RINX=/bear-wrong",
+            "INTERCEPT_NO_VALUE",
+            "INTERCEPT_REPORT_DESTINATION=/tmp/intercept.random",
+            "INTERCEPT_REPORT_COMMAND=/usr/bin/intercept",
+            nullptr
+        };
+
+        el::Session sut {};
+        el::session::from(sut, envp);
+        ASSERT_TRUE(el::session::is_valid(sut));
+
+        EXPECT_STREQ("/tmp/intercept.random", sut.destination);
+        EXPECT_STREQ("/usr/bin/intercept", sut.reporter);
+        EXPECT_EQ(nullptr, sut.ring);
+    }
+
     TEST(Session, capture_verbose)
     {
         const char* envp[] = {
@@ -0,0 +1,107 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "report/libexec/ShmRing.h"
+
+#include <cstring>
+#include <memory>
+
+namespace {
+
+    char ARG_0[] = "cc";
+    char ARG_1[] = "-c";
+    char ARG_2[] = "source.c";
+    char *ARGV[] = {ARG_0, ARG_1, ARG_2, nullptr};
+
+    std::unique_ptr<el::shm::Ring> create_ring()
+    {
+        auto ring = std::make_unique<el::shm::Ring>();
+        el::shm::init(*ring);
+        return ring;
+    }
+
+    TEST(ShmRing, empty_ring_pops_nothing)
+    {
+        auto ring = create_ring();
+        el::shm::Slot slot;
+
+        EXPECT_FALSE(el::shm::pop(*ring, slot));
+    }
+
+    TEST(ShmRing, pops_what_was_pushed)
+    {
+        auto ring = create_ring();
+
+        EXPECT_TRUE(el::shm::push(*ring, 42, 43, "/home/user", "/usr/bin/cc", ARGV));
+
+        el::shm::Slot slot;
+        ASSERT_TRUE(el::shm::pop(*ring, slot));
+        EXPECT_EQ(42u, slot.pid);
+        EXPECT_EQ(43u, slot.ppid);
+        EXPECT_STREQ("/home/user", slot.data);
+        const char *executable = slot.data + strlen(slot.data) + 1;
+        EXPECT_STREQ("/usr/bin/cc", executable);
+        const char *argument = executable + strlen(executable) + 1;
+        EXPECT_STREQ("cc", argument);
+
+        EXPECT_FALSE(el::shm::pop(*ring, slot));
+    }
+
+    TEST(ShmRing, keeps_the_order)
+    {
+        auto ring = create_ring();
+
+        EXPECT_TRUE(el::shm::push(*ring, 1, 0, "/", "/bin/first", ARGV));
+        EXPECT_TRUE(el::shm::push(*ring, 2, 0, "/", "/bin/second", ARGV));
+
+        el::shm::Slot slot;
+        ASSERT_TRUE(el::shm::pop(*ring, slot));
+        EXPECT_EQ(1u, slot.pid);
+        ASSERT_TRUE(el::shm::pop(*ring, slot));
+        EXPECT_EQ(2u, slot.pid);
+    }
+
+    TEST(ShmRing, rejects_when_full)
+    {
+        auto ring = create_ring();
+
+        for (size_t index = 0; index < el::shm::SLOT_COUNT; ++index) {
+            EXPECT_TRUE(el::shm::push(*ring, index, 0, "/", "/bin/true", ARGV));
+        }
+        EXPECT_FALSE(el::shm::push(*ring, 0, 0, "/", "/bin/true", ARGV));
+
+        el::shm::Slot slot;
+        EXPECT_TRUE(el::shm::pop(*ring, slot));
+        EXPECT_TRUE(el::shm::push(*ring, 0, 0, "/", "/bin/true", ARGV));
+    }
+
+    TEST(ShmRing, commits_oversized_records_with_zero_length)
+    {
+        auto ring = create_ring();
+
+        const std::string huge(el::shm::SLOT_DATA_SIZE, 'x');
+        EXPECT_FALSE(el::shm::push(*ring, 1, 0, huge.c_str(), "/bin/true", ARGV));
+
+        el::shm::Slot slot;
+        ASSERT_TRUE(el::shm::pop(*ring, slot));
+        EXPECT_EQ(0u, slot.length);
+    }
+}
@@ -0,0 +1,181 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include "report/libexec/Linker.h"
+#include "report/libexec/Session.h"
+#include "report/libexec/ShmRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <dlfcn.h>
+
+extern char **environ;
+
+// The library constructor runs in every intercepted process, so its
+// cost multiplies by the process count of the build. These tests guard
+// the two properties it relies on: the initialization stays within a
+// time budget, and it touches no heap at all (the library serves every
+// need from its static buffer, so it can not disturb the allocator
+// state of the host process).
+//
+// The allocator of the whole test binary is replaced by counting
+// wrappers around the real functions. The counting is armed only
+// around the measured section; everything else (the test framework
+// allocates freely) passes through.
+
+namespace {
+
+    std::atomic<bool> COUNTING(false);
+    std::atomic<size_t> ALLOCATIONS(0);
+
+    // dlsym allocates on some libc versions while it resolves the real
+    // functions; the bootstrap arena serves those few requests, so the
+    // resolution does not recurse into the wrappers.
+    char BOOTSTRAP[4096];
+    size_t BOOTSTRAP_USED = 0;
+    bool RESOLVING = false;
+
+    void *bootstrap_allocate(size_t size)
+    {
+        // align generously; the arena is tiny anyway.
+        const size_t aligned = (size + 15u) & ~size_t(15u);
+        if (BOOTSTRAP_USED + aligned > sizeof(BOOTSTRAP)) {
+            return nullptr;
+        }
+        void *result = BOOTSTRAP + BOOTSTRAP_USED;
+        BOOTSTRAP_USED += aligned;
+        return result;
+    }
+
+    bool bootstrap_owns(const void *ptr)
+    {
+        return (ptr >= BOOTSTRAP) && (ptr < BOOTSTRAP + sizeof(BOOTSTRAP));
+    }
+
+    template <typename T>
+    T resolve(const char *name)
+    {
+        RESOLVING = true;
+        const auto result = reinterpret_cast<T>(dlsym(RTLD_NEXT, name));
+        RESOLVING = false;
+        return result;
+    }
+
+    void count()
+    {
+        if (COUNTING.load(std::memory_order_relaxed)) {
+            ALLOCATIONS.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    using type = void *(*)(size_t);
+    if (RESOLVING) {
+        return bootstrap_allocate(size);
+    }
+    static const type real = resolve<type>("malloc");
+    count();
+    return real(size);
+}
+
+extern "C" void *calloc(size_t count_, size_t size) noexcept
+{
+    using type = void *(*)(size_t, size_t);
+    if (RESOLVING) {
+        // the arena is zero initialized and never reused.
+        return bootstrap_allocate(count_ * size);
+    }
+    static const type real = resolve<type>("calloc");
+    count();
+    return real(count_, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+    using type = void *(*)(void *, size_t);
+    static const type real = resolve<type>("realloc");
+    count();
+    return bootstrap_owns(ptr) ? real(nullptr, size) : real(ptr, size);
+}
+
+extern "C" void free(void *ptr) noexcept
+{
+    using type = void (*)(void *);
+    if (bootstrap_owns(ptr) || (ptr == nullptr)) {
+        return;
+    }
+    static const type real = resolve<type>("free");
+    real(ptr);
+}
+
+namespace {
+
+    // The same work the library constructor (on_load in lib.cc) does,
+    // without the log line at its end.
+    void initialize(el::Session &session, char *begin, char *end)
+    {
+        el::linker::load();
+        el::session::from(session, const_cast<const char **>(environ));
+        el::session::persist(session, begin, end);
+        el::shm::attach(session.ring);
+    }
+
+    TEST(Startup, allocation_free)
+    {
+        char buffer[PATH_MAX * 2];
+        el::Session session;
+
+        ALLOCATIONS.store(0);
+        COUNTING.store(true);
+        initialize(session, buffer, buffer + sizeof(buffer));
+        COUNTING.store(false);
+
+        EXPECT_EQ(0u, ALLOCATIONS.load());
+    }
+
+    TEST(Startup, within_budget)
+    {
+        // Generous for any machine this runs on (the real cost is a few
+        // microseconds); a regression which matters at build scale blows
+        // way past it.
+        constexpr auto BUDGET = std::chrono::microseconds(500);
+        constexpr size_t ROUNDS = 1000;
+
+        char buffer[PATH_MAX * 2];
+        // warm up the lazy symbol resolutions.
+        {
+            el::Session session;
+            initialize(session, buffer, buffer + sizeof(buffer));
+        }
+        const auto started = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < ROUNDS; ++round) {
+            el::Session session;
+            initialize(session, buffer, buffer + sizeof(buffer));
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+
+        EXPECT_LT(elapsed / ROUNDS, BUDGET);
+    }
+}
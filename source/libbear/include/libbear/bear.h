@@ -0,0 +1,102 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The embeddable streaming API of Bear.
+ *
+ * Tooling which consumes compilation databases (IDE indexers, clangd
+ * wrappers) can stream the entries through this API instead of parsing
+ * the whole compile_commands.json on every change. The entries arrive
+ * one by one while the input is still being read, so the memory usage
+ * stays flat no matter how large the database is. The same iteration
+ * works directly over an events database of an intercepted build: the
+ * commands are recognized on the fly, which skips the JSON round trip
+ * entirely.
+ *
+ * The API is plain C with opaque handles, so the binary interface
+ * stays stable across Bear releases and usable from any language with
+ * a C foreign function interface.
+ *
+ * A reader is not thread safe; use one reader per thread. Errors are
+ * reported at iteration time: opening only sets the stream up, a
+ * missing or corrupt input surfaces as a negative bear_next result.
+ */
+
+#ifndef BEAR_H
+#define BEAR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The version of this interface; grows when the contract changes. */
+#define BEAR_API_VERSION 1
+
+unsigned int bear_api_version(void);
+
+/* An open entry stream. Created by the bear_open_* calls, released by
+ * bear_close. */
+typedef struct bear_reader bear_reader;
+
+/* One compilation database entry. The pointers are owned by the reader
+ * and stay valid until the next bear_next call on it (or bear_close);
+ * copy what shall live longer. The output is NULL when the entry has
+ * none. */
+typedef struct bear_entry {
+    const char *file;
+    const char *directory;
+    const char *output;
+    const char *const *arguments;
+    size_t argument_count;
+} bear_entry;
+
+/* Stream the entries of a JSON compilation database file. Both the
+ * "arguments" and the "command" forms are accepted. */
+bear_reader *bear_open_database(const char *path);
+
+/* Stream only the entries of one source file from a JSON compilation
+ * database: the per file lookup of an indexer. The file is compared
+ * as it is written in the database. */
+bear_reader *bear_open_database_for(const char *path, const char *source_file);
+
+/* Stream the recognized compilations of an events database (the
+ * intermediate output of an intercepted build). The optional citnames
+ * configuration file controls the recognition and the content filters;
+ * NULL uses the defaults. */
+bear_reader *bear_open_events(const char *path, const char *configuration);
+
+/* Fetch the next entry. Returns 1 when the entry was filled, 0 at the
+ * end of the stream, and a negative value on error (the message is
+ * available through bear_error). */
+int bear_next(bear_reader *reader, bear_entry *entry);
+
+/* The message of the last error of the reader, or NULL when there was
+ * none. Owned by the reader. */
+const char *bear_error(const bear_reader *reader);
+
+/* Release the reader. Safe to call mid stream; a NULL reader is a
+ * no-op. */
+void bear_close(bear_reader *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,281 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libbear/bear.h"
+
+#include "Citnames.h"
+#include "Configuration.h"
+#include "Output.h"
+#include "semantic/Build.h"
+#include "semantic/Semantic.h"
+#include "collect/db/EventsDatabaseReader.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+namespace db = ic::collect::db;
+
+namespace {
+
+    // The producer thread runs ahead of the consumer by at most this
+    // many entries; enough to hide the parse latency, small enough to
+    // keep the memory flat.
+    constexpr size_t QUEUE_CAPACITY = 256;
+
+    // Thrown by the queue when the consumer closed the reader, to
+    // unwind the producer out of the streaming parser.
+    struct Cancelled {
+    };
+}
+
+// The handle behind the C API: a bounded queue between the producer
+// thread (which streams the input) and the bear_next calls, plus the
+// string storage of the entry delivered last.
+struct bear_reader {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+    std::deque<cs::Entry> queue;
+    bool done = false;
+    bool cancelled = false;
+    std::string error;
+    std::thread producer;
+
+    // The C views handed out by bear_next; valid until the next call.
+    std::string file;
+    std::string directory;
+    std::string output;
+    bool has_output = false;
+    std::vector<std::string> arguments;
+    std::vector<const char *> argument_views;
+};
+
+namespace {
+
+    void push(bear_reader &reader, cs::Entry &&entry) {
+        std::unique_lock<std::mutex> lock(reader.mutex);
+        reader.space.wait(lock, [&reader]() {
+            return (reader.queue.size() < QUEUE_CAPACITY) || reader.cancelled;
+        });
+        if (reader.cancelled) {
+            throw Cancelled();
+        }
+        reader.queue.emplace_back(std::move(entry));
+        reader.ready.notify_one();
+    }
+
+    void finish(bear_reader &reader, std::string error = std::string()) {
+        const std::lock_guard<std::mutex> guard(reader.mutex);
+        reader.error = std::move(error);
+        reader.done = true;
+        reader.ready.notify_all();
+    }
+
+    bool is_cancelled(bear_reader &reader) {
+        const std::lock_guard<std::mutex> guard(reader.mutex);
+        return reader.cancelled;
+    }
+
+    // Streams a JSON compilation database, optionally narrowed to the
+    // entries of one source file.
+    void stream_database(bear_reader &reader, const fs::path &path, const std::string &source_file) {
+        const cs::CompilationDatabase database(cs::Format {}, cs::Content {});
+        try {
+            auto result = database.from_json(path, cs::CompilationDatabase::EntryConsumer(
+                    [&reader, &source_file](cs::Entry &&entry) {
+                        if (source_file.empty() || (entry.file == source_file)) {
+                            push(reader, std::move(entry));
+                        }
+                    }));
+            finish(reader, result.is_err() ? std::string(result.unwrap_err().what()) : std::string());
+        } catch (const Cancelled &) {
+            finish(reader);
+        } catch (const std::exception &error) {
+            finish(reader, error.what());
+        }
+    }
+
+    // Streams an events database through the semantic recognition; the
+    // link commands are skipped, like the main database writer does.
+    // (Link is a compiler call too, hence it is tested first.)
+    void stream_events(bear_reader &reader, const fs::path &path, const std::optional<fs::path> &config_file) {
+        try {
+            auto configuration = cs::load_configuration(config_file, sys::env::Vars());
+            if (configuration.is_err()) {
+                finish(reader, configuration.unwrap_err().what());
+                return;
+            }
+            const auto config = configuration.unwrap();
+            auto events = db::EventsDatabaseReader::from(path);
+            if (events.is_err()) {
+                finish(reader, events.unwrap_err().what());
+                return;
+            }
+            const auto reader_ptr = events.unwrap();
+            const cs::CompilationDatabase database(config.output.format, config.output.content);
+            const cs::semantic::Build build(config.compilation);
+            for (auto event = reader_ptr->next(); event.has_value(); event = reader_ptr->next()) {
+                if (is_cancelled(reader)) {
+                    finish(reader);
+                    return;
+                }
+                if (event->is_err()) {
+                    finish(reader, event->unwrap_err().what());
+                    return;
+                }
+                const auto current = event->unwrap();
+                if (!current->has_started()) {
+                    continue;
+                }
+                auto entries = build.recognize(std::move(*current))
+                        .map<cs::CompilationDatabase::Entries>([](const auto &semantic) -> cs::CompilationDatabase::Entries {
+                            if (dynamic_cast<const cs::semantic::Link *>(semantic.get()) != nullptr) {
+                                return {};
+                            }
+                            if (const auto compiler = dynamic_cast<const cs::semantic::CompilerCall *>(semantic.get()); compiler != nullptr) {
+                                return compiler->into_entries();
+                            }
+                            return {};
+                        })
+                        .unwrap_or(cs::CompilationDatabase::Entries());
+                for (auto &entry : entries) {
+                    if (database.admits(entry)) {
+                        push(reader, std::move(entry));
+                    }
+                }
+            }
+            finish(reader);
+        } catch (const Cancelled &) {
+            finish(reader);
+        } catch (const std::exception &error) {
+            finish(reader, error.what());
+        }
+    }
+}
+
+extern "C" {
+
+unsigned int bear_api_version(void) {
+    return BEAR_API_VERSION;
+}
+
+bear_reader *bear_open_database(const char *path) {
+    return bear_open_database_for(path, nullptr);
+}
+
+bear_reader *bear_open_database_for(const char *path, const char *source_file) {
+    if (path == nullptr) {
+        return nullptr;
+    }
+    auto *reader = new (std::nothrow) bear_reader();
+    if (reader == nullptr) {
+        return nullptr;
+    }
+    const fs::path file(path);
+    const std::string filter((source_file != nullptr) ? source_file : "");
+    reader->producer = std::thread([reader, file, filter]() {
+        stream_database(*reader, file, filter);
+    });
+    return reader;
+}
+
+bear_reader *bear_open_events(const char *path, const char *configuration) {
+    if (path == nullptr) {
+        return nullptr;
+    }
+    auto *reader = new (std::nothrow) bear_reader();
+    if (reader == nullptr) {
+        return nullptr;
+    }
+    const fs::path file(path);
+    const auto config = (configuration != nullptr)
+            ? std::make_optional(fs::path(configuration))
+            : std::optional<fs::path>();
+    reader->producer = std::thread([reader, file, config]() {
+        stream_events(*reader, file, config);
+    });
+    return reader;
+}
+
+int bear_next(bear_reader *reader, bear_entry *entry) {
+    if ((reader == nullptr) || (entry == nullptr)) {
+        return -1;
+    }
+    cs::Entry current;
+    {
+        std::unique_lock<std::mutex> lock(reader->mutex);
+        reader->ready.wait(lock, [reader]() {
+            return !reader->queue.empty() || reader->done;
+        });
+        if (reader->queue.empty()) {
+            return reader->error.empty() ? 0 : -1;
+        }
+        current = std::move(reader->queue.front());
+        reader->queue.pop_front();
+        reader->space.notify_one();
+    }
+    reader->file = current.file.string();
+    reader->directory = current.directory.string();
+    reader->has_output = current.output.has_value();
+    reader->output = reader->has_output ? current.output->string() : std::string();
+    reader->arguments = current.arguments.flatten();
+    reader->argument_views.clear();
+    reader->argument_views.reserve(reader->arguments.size());
+    for (const auto &argument : reader->arguments) {
+        reader->argument_views.push_back(argument.c_str());
+    }
+    entry->file = reader->file.c_str();
+    entry->directory = reader->directory.c_str();
+    entry->output = reader->has_output ? reader->output.c_str() : nullptr;
+    entry->arguments = reader->argument_views.data();
+    entry->argument_count = reader->argument_views.size();
+    return 1;
+}
+
+const char *bear_error(const bear_reader *reader) {
+    if (reader == nullptr) {
+        return "no reader";
+    }
+    // The error is only written before done is set; the consumer reads
+    // it after a negative bear_next, when the producer is finished.
+    return reader->error.empty() ? nullptr : reader->error.c_str();
+}
+
+void bear_close(bear_reader *reader) {
+    if (reader == nullptr) {
+        return;
+    }
+    {
+        const std::lock_guard<std::mutex> guard(reader->mutex);
+        reader->cancelled = true;
+        reader->space.notify_all();
+    }
+    if (reader->producer.joinable()) {
+        reader->producer.join();
+    }
+    delete reader;
+}
+}
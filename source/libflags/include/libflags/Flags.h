@@ -23,9 +23,9 @@
 #include "libresult/Result.h"
 
 #include <list>
-#include <map>
 #include <optional>
 #include <string_view>
+#include <utility>
 #include <vector>
 #include <iosfwd>
 #include <optional>
@@ -57,13 +57,21 @@ namespace flags {
 
     private:
         using Parameter = std::vector<std::string_view>;
-        using Parameters = std::map<std::string_view, Parameter>;
+        // The values are views into the caller's argv, which outlives the
+        // parsing. A result is built on every parse (wr does this once per
+        // intercepted process), so the parameters follow the option table:
+        // a flat sorted vector with binary search lookups, instead of a
+        // node based map that pays an allocation per flag.
+        using Parameters = std::vector<std::pair<std::string_view, Parameter>>;
 
         friend class Parser;
         friend std::ostream& operator<<(std::ostream&, const Arguments&);
 
         Arguments(std::string_view program, Parameters&& parameters);
 
+        [[nodiscard]] static Parameters::const_iterator find(const Parameters& parameters, const std::string_view& key) noexcept;
+        static Parameter& insert(Parameters& parameters, const std::string_view& key);
+
     private:
         std::string_view program_;
         Parameters parameters_;
@@ -86,13 +94,18 @@ namespace flags {
     struct Option {
         int arguments;
         bool required;
-        const std::string_view help;
-        const std::optional<std::string_view> default_value;
-        const std::optional<std::string_view> group_name;
+        std::string_view help;
+        std::optional<std::string_view> default_value;
+        std::optional<std::string_view> group_name;
     };
 
-    using OptionMap = std::map<std::string_view, Option>;
-    using OptionValue = OptionMap::value_type;
+    // The option tables are literals at every call site, and a parser is
+    // built on each startup (wr does this once per intercepted process).
+    // A flat sorted vector keeps that construction to a single allocation
+    // and the flag lookup a binary search, instead of building a node
+    // based map every time.
+    using OptionValue = std::pair<std::string_view, Option>;
+    using OptionMap = std::vector<OptionValue>;
 
     // Represents a command line parser.
     //
@@ -33,6 +33,34 @@ namespace {
 
     constexpr char QUERY_GROUP[] = "query options";
 
+    // Add the implicit entry, unless the caller already defined the flag.
+    void insert_option(flags::OptionMap& options, flags::OptionValue&& entry)
+    {
+        const auto it = std::find_if(options.begin(), options.end(),
+            [&entry](const auto& candidate) { return candidate.first == entry.first; });
+        if (it == options.end()) {
+            options.emplace_back(std::move(entry));
+        }
+    }
+
+    // Sort the table for the binary search lookups. Keeps the first entry
+    // of duplicated keys, like the map based table did.
+    void seal_options(flags::OptionMap& options)
+    {
+        std::stable_sort(options.begin(), options.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+        const auto last = std::unique(options.begin(), options.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; });
+        options.erase(last, options.end());
+    }
+
+    flags::OptionMap::const_iterator find_option(const flags::OptionMap& options, const std::string_view& flag)
+    {
+        const auto it = std::lower_bound(options.begin(), options.end(), flag,
+            [](const auto& entry, const auto& key) { return entry.first < key; });
+        return ((it != options.end()) && (it->first == flag)) ? it : options.end();
+    }
+
     std::optional<std::tuple<const char**, const char**>>
     take(const flags::Option& option, const char** const begin, const char** const end) noexcept
     {
@@ -133,14 +161,30 @@ namespace flags {
             , parameters_(parameters)
     { }
 
+    Arguments::Parameters::const_iterator Arguments::find(const Parameters& parameters, const std::string_view& key) noexcept
+    {
+        const auto it = std::lower_bound(parameters.cbegin(), parameters.cend(), key,
+            [](const auto& entry, const auto& value) { return entry.first < value; });
+        return ((it != parameters.cend()) && (it->first == key)) ? it : parameters.cend();
+    }
+
+    Arguments::Parameter& Arguments::insert(Parameters& parameters, const std::string_view& key)
+    {
+        const auto it = std::lower_bound(parameters.begin(), parameters.end(), key,
+            [](const auto& entry, const auto& value) { return entry.first < value; });
+        return ((it != parameters.end()) && (it->first == key))
+            ? it->second
+            : parameters.insert(it, { key, Parameter() })->second;
+    }
+
     rust::Result<bool> Arguments::as_bool(const std::string_view& key) const
     {
-        return rust::Ok(parameters_.find(key) != parameters_.end());
+        return rust::Ok(find(parameters_, key) != parameters_.cend());
     }
 
     rust::Result<std::string_view> Arguments::as_string(const std::string_view& key) const
     {
-        if (auto values = parameters_.find(key); values != parameters_.end()) {
+        if (auto values = find(parameters_, key); values != parameters_.cend()) {
             return (values->second.size() == 1)
                 ? rust::Result<std::string_view>(
                         rust::Ok(values->second.front()))
@@ -154,7 +198,7 @@ namespace flags {
 
     rust::Result<std::vector<std::string_view>> Arguments::as_string_list(const std::string_view& key) const
     {
-        if (auto values = parameters_.find(key); values != parameters_.end()) {
+        if (auto values = find(parameters_, key); values != parameters_.cend()) {
             return rust::Ok(values->second);
         }
         return rust::Err(std::runtime_error(
@@ -188,9 +232,10 @@ namespace flags {
             , options_(options)
             , commands_()
     {
-        options_.insert({ VERBOSE, { 0, false, "run in verbose mode", std::nullopt, std::nullopt } });
-        options_.insert({ HELP, { 0, false, "print help and exit", std::nullopt, { QUERY_GROUP } } });
-        options_.insert({ VERSION, { 0, false, "print version and exit", std::nullopt, { QUERY_GROUP } } });
+        insert_option(options_, { VERBOSE, { 0, false, "run in verbose mode", std::nullopt, std::nullopt } });
+        insert_option(options_, { HELP, { 0, false, "print help and exit", std::nullopt, { QUERY_GROUP } } });
+        insert_option(options_, { VERSION, { 0, false, "print version and exit", std::nullopt, { QUERY_GROUP } } });
+        seal_options(options_);
     }
 
     Parser::Parser(std::string_view name, std::initializer_list<OptionValue> options)
@@ -199,8 +244,9 @@ namespace flags {
             , options_(options)
             , commands_()
     {
-        options_.insert({ VERBOSE, { 0, false, "run in verbose mode", std::nullopt, std::nullopt } });
-        options_.insert({ HELP, { 0, false, "print help and exit", std::nullopt, { QUERY_GROUP } } });
+        insert_option(options_, { VERBOSE, { 0, false, "run in verbose mode", std::nullopt, std::nullopt } });
+        insert_option(options_, { HELP, { 0, false, "print help and exit", std::nullopt, { QUERY_GROUP } } });
+        seal_options(options_);
     }
 
     Parser::Parser(std::string_view name, std::string_view version, std::initializer_list<Parser> commands, std::initializer_list<OptionValue> default_options)
@@ -210,10 +256,11 @@ namespace flags {
             , commands_(commands)
     {
         if (default_options.size() != 0) {
-            options_.insert({ VERBOSE, { 0, false, "run in verbose mode", std::nullopt, std::nullopt } });
+            insert_option(options_, { VERBOSE, { 0, false, "run in verbose mode", std::nullopt, std::nullopt } });
         }
-        options_.insert({ HELP, { 0, false, "print help and exit", std::nullopt, { QUERY_GROUP } } });
-        options_.insert({ VERSION, { 0, false, "print version and exit", std::nullopt, { QUERY_GROUP } } });
+        insert_option(options_, { HELP, { 0, false, "print help and exit", std::nullopt, { QUERY_GROUP } } });
+        insert_option(options_, { VERSION, { 0, false, "print version and exit", std::nullopt, { QUERY_GROUP } } });
+        seal_options(options_);
     }
 
     rust::Result<Arguments> Parser::parse(const int argc, const char** argv) const
@@ -229,7 +276,7 @@ namespace flags {
             if (sub_command != commands_.end()) {
                 return sub_command->parse(argc - 1, argv + 1)
                         .map<Arguments>([&sub_command](auto arguments) {
-                            arguments.parameters_[COMMAND] = {sub_command->name_};
+                            Arguments::insert(arguments.parameters_, COMMAND) = { sub_command->name_ };
                             return arguments;
                         });
             }
@@ -237,21 +284,22 @@ namespace flags {
 
         std::string_view program(argv[0]);
         Arguments::Parameters parameters;
+        // every option (with its default value) plus the command name
+        // fits without a regrowth.
+        parameters.reserve(options_.size() + 1);
 
         const char** const args_end = argv + argc;
         for (const char** args_it = ++argv; args_it != args_end;) {
             // find which option is it.
-            if (auto option = options_.find(*args_it); option != options_.end()) {
+            if (auto option = find_option(options_, *args_it); option != options_.end()) {
                 // take the required number of arguments if founded.
                 if (const auto params = take(option->second, args_it + 1, args_end); params) {
                     const auto& [begin, end] = params.value();
-                    auto args = std::vector<std::string_view>(begin, end);
-
-                    if (auto it = parameters.find(option->first); parameters.end() != it) {
-                        std::copy(args.begin(), args.end(), std::back_inserter(it->second));
-                    } else {
-                        parameters.emplace(option->first, args);
-                    }
+                    // append the views straight from argv, there is no
+                    // intermediate copy. A repeated flag extends the
+                    // already collected values.
+                    auto& values = Arguments::insert(parameters, option->first);
+                    values.insert(values.end(), begin, end);
 
                     args_it = end;
                 } else {
@@ -265,16 +313,15 @@ namespace flags {
         }
         // add default values to the parameters as it would given by the user.
         for (const auto& [flag, option] : options_) {
-            if (option.default_value.has_value() && parameters.find(flag) == parameters.end()) {
-                std::vector<std::string_view> args = { option.default_value.value() };
-                parameters.emplace(flag, args);
+            if (option.default_value.has_value() && (Arguments::find(parameters, flag) == parameters.cend())) {
+                Arguments::insert(parameters, flag).push_back(option.default_value.value());
             }
         }
         // if this is not a help or version query, then validate the parameters strict.
-        if (parameters.find(HELP) == parameters.end() && parameters.find(VERSION) == parameters.end()) {
+        if ((Arguments::find(parameters, HELP) == parameters.cend()) && (Arguments::find(parameters, VERSION) == parameters.cend())) {
             for (const auto& [flag, option] : options_) {
                 // check if the parameter is required, but not present.
-                if (option.required && parameters.find(flag) == parameters.end()) {
+                if (option.required && (Arguments::find(parameters, flag) == parameters.cend())) {
                     return rust::Err(std::runtime_error(
                         fmt::format("Parameter is required, but not given: \"{0}\"", flag)));
                 }
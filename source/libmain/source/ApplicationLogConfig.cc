@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include <fmt/ranges.h>
+#include <spdlog/async.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_sinks.h>
 
@@ -64,6 +65,14 @@ namespace ps {
 
     void ApplicationLogConfig::initForVerbose() const
     {
+        // Verbose mode logs every intercepted event. Route them through an
+        // async logger, so the formatting and the stderr write happen on a
+        // background thread instead of serializing the event handlers.
+        spdlog::init_thread_pool(8192, 1);
+        auto sink = std::make_shared<spdlog::sinks::stderr_sink_mt>();
+        auto logger = std::make_shared<spdlog::async_logger>(
+                "stderr-async", std::move(sink), spdlog::thread_pool(), spdlog::async_overflow_policy::block);
+        spdlog::set_default_logger(std::move(logger));
         spdlog::set_pattern(fmt::format("[%H:%M:%S.%f, {0}, %P] %v", id_));
         spdlog::set_level(spdlog::level::debug);
     }
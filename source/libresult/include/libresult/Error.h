@@ -0,0 +1,42 @@
+/*  Copyright (C) 2012-2023 by László Nagy
+    This file is part of Bear.
+
+    Bear is a tool to generate compilation database for clang tooling.
+
+    Bear is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bear is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+namespace rust {
+
+    // A cheap error for hot paths.
+    //
+    // It carries an errno style code and pointers to static messages, so
+    // creating or propagating it does not allocate. Methods called once
+    // per intercepted event shall raise this; the cold caller converts it
+    // into an allocating error (adding the context only it knows, like a
+    // file name) at the API boundary.
+    struct Error {
+        // An errno value, or zero when the error has no system error code.
+        int code = 0;
+        // What failed. Points to a string literal, never owned.
+        const char *message = "";
+        // An optional detail of the failure. Points to a string with
+        // static storage duration, or null when there is none.
+        const char *detail = nullptr;
+
+        [[nodiscard]] const char *what() const noexcept { return message; }
+    };
+}
@@ -51,7 +51,7 @@ namespace rust {
             }
 
             explicit Err(E&& value) noexcept
-                    : value_(value)
+                    : value_(std::move(value))
             {
             }
 
@@ -73,8 +73,13 @@ namespace rust {
 
             typedef typename std::aligned_storage<Size, Align>::type type;
 
+            // The storage is zeroed up front. The inactive alternative
+            // is never read, but the compiler cannot always prove that
+            // when the rvalue combinators are inlined, and the spurious
+            // -Wmaybe-uninitialized would break the warning free build.
             Storage()
-                    : initialized_(false)
+                    : storage_()
+                    , initialized_(false)
             {
             }
 
@@ -130,6 +135,36 @@ namespace rust {
             type storage_;
             bool initialized_;
         };
+
+        // Whether the function can be called with an rvalue of the type.
+        // (A generic lambda with an `auto&` parameter can not.)
+        template <typename F, typename T, typename = void>
+        struct accepts_rvalue : std::false_type {
+        };
+
+        template <typename F, typename T>
+        struct accepts_rvalue<F, T, decltype(void(std::declval<F&>()(std::declval<T&&>())))> : std::true_type {
+        };
+
+        // Calls the function with the moved value when it accepts an
+        // rvalue; otherwise with an lvalue reference, so the callers
+        // written before the move-aware combinators keep compiling (they
+        // just keep their copy).
+        template <typename F, typename T>
+        auto apply_moved(F&& f, T& value)
+                -> typename std::enable_if<accepts_rvalue<F, T>::value,
+                        decltype(std::declval<F&>()(std::declval<T&&>()))>::type
+        {
+            return std::forward<F>(f)(std::move(value));
+        }
+
+        template <typename F, typename T>
+        auto apply_moved(F&& f, T& value)
+                -> typename std::enable_if<!accepts_rvalue<F, T>::value,
+                        decltype(std::declval<F&>()(std::declval<T&>()))>::type
+        {
+            return std::forward<F>(f)(value);
+        }
     }
 
     // Util methods which help to create `Result` types easier.
@@ -189,6 +224,15 @@ namespace rust {
         template <typename U>
         Result<U, E> map(std::function<U(const T&)> const& f) const;
 
+        // The rvalue-qualified combinators move the payload into the
+        // continuation instead of copying it, so a chain over a result
+        // which is not needed afterwards (the common spelling) costs no
+        // deep copy per link. The functor can still take the value by
+        // const reference; a by-value or rvalue parameter receives the
+        // moved payload.
+        template <typename U, typename F>
+        Result<U, E> map(F&& f) &&;
+
         template <typename U>
         Result<U, E> map_or(U&& value, std::function<U(const T&)> const& func) const;
 
@@ -198,22 +242,34 @@ namespace rust {
         template <typename F>
         Result<T, F> map_err(std::function<F(const E&)> const& f) const;
 
+        template <typename F, typename Fn>
+        Result<T, F> map_err(Fn&& f) &&;
+
         template <typename U>
         Result<U, E> and_(const Result<U, E>& rhs) const;
 
         template <typename U>
         Result<U, E> and_then(std::function<Result<U, E>(const T&)> const& f) const;
 
+        template <typename U, typename F>
+        Result<U, E> and_then(F&& f) &&;
+
         Result<T, E> or_(const Result<T, E>& rhs) const;
 
         Result<T, E> or_else(std::function<Result<T, E>(const E&)> const& f) const;
 
+        template <typename F>
+        Result<T, E> or_else(F&& f) &&;
+
         const T& unwrap() const;
         const E& unwrap_err() const;
         const T& unwrap_or(const T& value) const;
 
         T unwrap_or_else(std::function<T(const E&)> const& provider) const;
 
+        template <typename F>
+        T unwrap_or_else(F&& provider) &&;
+
         const Result<T, E>& on_success(std::function<void(const T&)> const& f) const;
         const Result<T, E>& on_error(std::function<void(const E&)> const& f) const;
 
@@ -398,6 +454,18 @@ namespace rust {
         }
     }
 
+    template <typename T, typename E>
+    template <typename U, typename F>
+    Result<U, E> Result<T, E>::map(F&& f) &&
+    {
+        if (ok_) {
+            auto res = internals::apply_moved(std::forward<F>(f), storage_.template get<T>());
+            return types::Ok<U>(std::move(res));
+        } else {
+            return types::Err<E>(std::move(storage_.template get<E>()));
+        }
+    }
+
     template <typename T, typename E>
     template <typename U>
     Result<U, E> Result<T, E>::map_or(U&& value, const std::function<U(const T&)>& f) const
@@ -436,6 +504,18 @@ namespace rust {
         }
     }
 
+    template <typename T, typename E>
+    template <typename F, typename Fn>
+    Result<T, F> Result<T, E>::map_err(Fn&& f) &&
+    {
+        if (ok_) {
+            return types::Ok<T>(std::move(storage_.template get<T>()));
+        } else {
+            auto res = internals::apply_moved(std::forward<Fn>(f), storage_.template get<E>());
+            return types::Err<F>(std::move(res));
+        }
+    }
+
     template <typename T, typename E>
     template <typename U>
     Result<U, E> Result<T, E>::and_(const Result<U, E>& rhs) const
@@ -459,6 +539,17 @@ namespace rust {
         }
     }
 
+    template <typename T, typename E>
+    template <typename U, typename F>
+    Result<U, E> Result<T, E>::and_then(F&& f) &&
+    {
+        if (ok_) {
+            return internals::apply_moved(std::forward<F>(f), storage_.template get<T>());
+        } else {
+            return types::Err<E>(std::move(storage_.template get<E>()));
+        }
+    }
+
     template <typename T, typename E>
     Result<T, E> Result<T, E>::or_(const Result<T, E>& rhs) const
     {
@@ -479,6 +570,17 @@ namespace rust {
         }
     }
 
+    template <typename T, typename E>
+    template <typename F>
+    Result<T, E> Result<T, E>::or_else(F&& f) &&
+    {
+        if (ok_) {
+            return std::move(*this);
+        } else {
+            return internals::apply_moved(std::forward<F>(f), storage_.template get<E>());
+        }
+    }
+
     template <typename T, typename E>
     const T& Result<T, E>::unwrap() const
     {
@@ -511,6 +613,17 @@ namespace rust {
         }
     }
 
+    template <typename T, typename E>
+    template <typename F>
+    T Result<T, E>::unwrap_or_else(F&& provider) &&
+    {
+        if (ok_) {
+            return std::move(storage_.template get<T>());
+        } else {
+            return internals::apply_moved(std::forward<F>(provider), storage_.template get<E>());
+        }
+    }
+
     template <typename T, typename E>
     const Result<T, E>& Result<T, E>::on_success(const std::function<void(const T&)>& f) const
     {
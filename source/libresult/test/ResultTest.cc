@@ -21,6 +21,9 @@
 
 #include "libresult/Result.h"
 
+#include <memory>
+#include <string>
+
 namespace {
 
     using Error = const char*;
@@ -357,4 +360,71 @@ namespace {
                       })
                       .unwrap_or('+')));
     }
+
+    // The rvalue-qualified combinators shall move the payload through
+    // the chain; a move-only payload proves that no copy is made.
+
+    TEST(result, rvalue_map_moves_the_payload)
+    {
+        EXPECT_EQ(4,
+            (Result<std::unique_ptr<int>, Error>(Ok(std::make_unique<int>(2)))
+                    .map<int>([](std::unique_ptr<int>&& in) { return *in * 2; })
+                    .unwrap_or(8)));
+        EXPECT_EQ(8,
+            (Result<std::unique_ptr<int>, Error>(Err("problem"))
+                    .map<int>([](std::unique_ptr<int>&& in) { return *in * 2; })
+                    .unwrap_or(8)));
+    }
+
+    TEST(result, rvalue_and_then_moves_the_payload)
+    {
+        EXPECT_EQ(3,
+            (Result<std::unique_ptr<int>, Error>(Ok(std::make_unique<int>(2)))
+                    .and_then<int>([](std::unique_ptr<int> in) { return Ok(*in + 1); })
+                    .unwrap_or(8)));
+        EXPECT_EQ(8,
+            (Result<std::unique_ptr<int>, Error>(Err("problem"))
+                    .and_then<int>([](std::unique_ptr<int> in) { return Ok(*in + 1); })
+                    .unwrap_or(8)));
+    }
+
+    TEST(result, rvalue_map_err_moves_the_error)
+    {
+        const auto result = Result<int, std::string>(Err(std::string("problem")))
+                .map_err<std::string>([](std::string&& error) { return error + "!"; });
+        EXPECT_TRUE(result.is_err());
+        EXPECT_EQ("problem!", result.unwrap_err());
+    }
+
+    TEST(result, rvalue_or_else_moves_the_success)
+    {
+        const auto result = Result<std::unique_ptr<int>, Error>(Ok(std::make_unique<int>(2)))
+                .or_else([](Error) { return Result<std::unique_ptr<int>, Error>(Err("problem")); });
+        EXPECT_TRUE(result.is_ok());
+        EXPECT_EQ(2, *result.unwrap());
+    }
+
+    TEST(result, rvalue_unwrap_or_else_moves_the_payload)
+    {
+        EXPECT_EQ(2,
+            *(Result<std::unique_ptr<int>, Error>(Ok(std::make_unique<int>(2)))
+                    .unwrap_or_else([](Error) { return std::unique_ptr<int>(); })));
+        EXPECT_EQ(nullptr,
+            (Result<std::unique_ptr<int>, Error>(Err("problem"))
+                    .unwrap_or_else([](Error) { return std::unique_ptr<int>(); })));
+    }
+
+    // The lambdas written before the move-aware overloads (e.g. with an
+    // `auto&` parameter) keep working on temporary results.
+    TEST(result, rvalue_with_lvalue_functor_still_works)
+    {
+        EXPECT_EQ(4,
+            (Result<int, Error>(Ok(2))
+                    .map<int>([](auto& in) { return in * 2; })
+                    .unwrap_or(8)));
+        EXPECT_EQ(4,
+            (Result<int, Error>(Ok(2))
+                    .and_then<int>([](auto& in) { return Ok(in * 2); })
+                    .unwrap_or(8)));
+    }
 }
@@ -23,6 +23,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 
 namespace sh {
 
@@ -36,6 +37,7 @@ namespace sh {
     // The arguments are combined into a single string with each word separated by a space.
     // Each individual word is escaped as necessary via `escape`.
     std::string join(const std::list<std::string>& arguments);
+    std::string join(const std::vector<std::string>& arguments);
 
     // Splits a string into a vector of words in the same way the UNIX Bourne shell does.
     //
@@ -19,67 +19,232 @@
 
 #include "libshell/Command.h"
 
-#include <regex>
+#include <array>
 #include <stdexcept>
 
-namespace sh {
+namespace {
 
-    std::string escape(const std::string& input)
+    // Character classification table for the single pass scanners below.
+    // Replaces the std::regex based implementation: citnames runs these
+    // functions for every database entry, and the regex engine dominated
+    // the conversion time on long linker command lines.
+    enum CharacterClass : unsigned char {
+        PLAIN = 0,
+        SPACE = 1,
+        SINGLE_QUOTE = 2,
+        DOUBLE_QUOTE = 3,
+        BACKSLASH = 4,
+    };
+
+    constexpr std::array<unsigned char, 256> create_class_table()
     {
-        if (input.empty()) {
-            return "''";
+        std::array<unsigned char, 256> table {};
+        table[' '] = SPACE;
+        table['\t'] = SPACE;
+        table['\n'] = SPACE;
+        table['\v'] = SPACE;
+        table['\f'] = SPACE;
+        table['\r'] = SPACE;
+        table['\''] = SINGLE_QUOTE;
+        table['"'] = DOUBLE_QUOTE;
+        table['\\'] = BACKSLASH;
+        return table;
+    }
+
+    constexpr std::array<unsigned char, 256> CLASS_TABLE = create_class_table();
+
+    constexpr unsigned char classify(const char character)
+    {
+        return CLASS_TABLE[static_cast<unsigned char>(character)];
+    }
+
+    // Tells if the character needs no escaping for the shell.
+    constexpr bool is_safe(const char character)
+    {
+        return (('A' <= character) && (character <= 'Z'))
+            || (('a' <= character) && (character <= 'z'))
+            || (('0' <= character) && (character <= '9'))
+            || (character == '_') || (character == '-') || (character == '.')
+            || (character == ',') || (character == ':') || (character == '/')
+            || (character == '@');
+    }
+
+    // Tells if a backslash keeps its meaning inside double quotes.
+    constexpr bool is_metacharacter(const char character)
+    {
+        return (character == '$') || (character == '`') || (character == '"')
+            || (character == '\\') || (character == '\n');
+    }
+
+    // How many output bytes a character produces when escaped: one for a
+    // safe character, two for an escaped one, three for the quoted line
+    // feed. A table lookup keeps the measuring loop branch free.
+    constexpr std::array<unsigned char, 256> create_length_table()
+    {
+        std::array<unsigned char, 256> table {};
+        for (size_t index = 0; index < table.size(); ++index) {
+            const char character = char(index);
+            table[index] = (character == '\n') ? 3 : is_safe(character) ? 1 : 2;
         }
+        return table;
+    }
 
-        const std::regex ESCAPE_PATTERN(R"#(([^A-Za-z0-9_\-.,:/@\n]))#");
-        const std::regex LINE_FEED(R"#(\n)#");
+    constexpr std::array<unsigned char, 256> LENGTH_TABLE = create_length_table();
 
-        const auto output = std::regex_replace(input, ESCAPE_PATTERN, "\\$1");
-        return std::regex_replace(output, LINE_FEED, "'\n'");
+    // Exact size of the escaped form of a single argument.
+    size_t escaped_length(const std::string& input) noexcept
+    {
+        if (input.empty()) {
+            return 2;
+        }
+        size_t result = 0;
+        for (const char character : input) {
+            result += LENGTH_TABLE[static_cast<unsigned char>(character)];
+        }
+        return result;
     }
 
-    std::string join(const std::list<std::string>& arguments)
+    // Appends the escaped form of the argument to the output. The caller
+    // reserved the space already, the appends do not reallocate.
+    void escape_into(const std::string& input, std::string& output)
+    {
+        if (input.empty()) {
+            output += "''";
+            return;
+        }
+        for (const char character : input) {
+            if (character == '\n') {
+                // keep the line feed readable: quote it instead of escaping
+                output += "'\n'";
+            } else if (is_safe(character)) {
+                output += character;
+            } else {
+                output += '\\';
+                output += character;
+            }
+        }
+    }
+
+    template <typename Container>
+    std::string join_impl(const Container& arguments)
     {
+        // measure first, so the output is built into a single reservation
+        // instead of growing through reallocations on long command lines.
+        size_t length = 0;
+        for (const auto& argument : arguments) {
+            length += escaped_length(argument) + 1;
+        }
         std::string result;
+        result.reserve((length > 0) ? (length - 1) : 0);
         for (auto it = arguments.begin(); it != arguments.end(); ++it) {
             if (it != arguments.begin()) {
-                result += " ";
+                result += ' ';
             }
-            result += escape(*it);
+            escape_into(*it, result);
         }
         return result;
     }
+}
 
-    rust::Result<std::list<std::string>> split(const std::string& input)
+namespace sh {
+
+    std::string escape(const std::string& input)
     {
-        const std::regex MAIN_PATTERN(R"#((?:\s*(?:([^\s\\'"]+)|'([^']*)'|"((?:[^"\\]|\\.)*)"|(\\.?)|(\S))(\s|$)?))#",
-                                      std::regex::ECMAScript);
-        const std::regex ESCAPE_PATTERN(R"#(\\(.))#");
-        const std::regex METACHAR_PATTERN(R"(\\([$`"\\\n]))");
+        std::string output;
+        output.reserve(escaped_length(input));
+        escape_into(input, output);
+        return output;
+    }
 
+    std::string join(const std::list<std::string>& arguments)
+    {
+        return join_impl(arguments);
+    }
+
+    std::string join(const std::vector<std::string>& arguments)
+    {
+        return join_impl(arguments);
+    }
+
+    rust::Result<std::list<std::string>> split(const std::string& input)
+    {
         std::list<std::string> words;
         std::string field;
+        bool in_field = false;
 
-        const auto input_begin = std::sregex_iterator(input.begin(), input.end(), MAIN_PATTERN);
-        const auto input_end = std::sregex_iterator();
-        for (auto it = input_begin; it != input_end; ++it) {
-            if (it->ready()) {
-                if (it->operator[](1).matched) {
-                    field += it->str(1);
-                } else if (it->operator[](2).matched) {
-                    field += it->str(2);
-                } else if (it->operator[](3).matched) {
-                    field += std::regex_replace(it->str(3), METACHAR_PATTERN, "$1");
-                } else if (it->operator[](4).matched) {
-                    field += std::regex_replace(it->str(4), ESCAPE_PATTERN, "$1");
-                } else if (it->operator[](5).matched) {
-                    return rust::Err(std::runtime_error("Mismatched quotes."));
-                }
-
-                if (it->operator[](6).matched) {
+        const size_t size = input.size();
+        size_t it = 0;
+        while (it < size) {
+            switch (classify(input[it])) {
+            case SPACE:
+                if (in_field) {
                     words.push_back(field);
                     field.clear();
+                    in_field = false;
                 }
+                ++it;
+                break;
+            case SINGLE_QUOTE: {
+                // everything up to the closing quote is literal
+                const size_t end = input.find('\'', it + 1);
+                if (end == std::string::npos) {
+                    return rust::Err(std::runtime_error("Mismatched quotes."));
+                }
+                field.append(input, it + 1, end - it - 1);
+                in_field = true;
+                it = end + 1;
+                break;
             }
+            case DOUBLE_QUOTE: {
+                // a backslash only escapes the shell metacharacters here
+                size_t end = it + 1;
+                for (; end < size; ++end) {
+                    if (input[end] == '"') {
+                        break;
+                    }
+                    if ((input[end] == '\\') && (end + 1 < size)) {
+                        if (!is_metacharacter(input[end + 1])) {
+                            field += '\\';
+                        }
+                        field += input[end + 1];
+                        ++end;
+                    } else {
+                        field += input[end];
+                    }
+                }
+                if (end == size) {
+                    return rust::Err(std::runtime_error("Mismatched quotes."));
+                }
+                in_field = true;
+                it = end + 1;
+                break;
+            }
+            case BACKSLASH:
+                // outside quotes a backslash escapes any character
+                if (it + 1 < size) {
+                    field += input[it + 1];
+                    it += 2;
+                } else {
+                    field += '\\';
+                    ++it;
+                }
+                in_field = true;
+                break;
+            default: {
+                // append the whole run of plain characters at once
+                size_t end = it + 1;
+                while ((end < size) && (classify(input[end]) == PLAIN)) {
+                    ++end;
+                }
+                field.append(input, it, end - it);
+                in_field = true;
+                it = end;
+                break;
+            }
+            }
+        }
+        if (in_field) {
+            words.push_back(field);
         }
         return rust::Ok(std::move(words));
     }
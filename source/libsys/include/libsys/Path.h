@@ -37,4 +37,17 @@ namespace sys::path {
     std::string join(const std::list<fs::path> &input);
 
     rust::Result<fs::path> get_cwd();
+
+    // Resolves the path against the working directory and normalizes it
+    // lexically: the "." and ".." components are removed, symlinks are
+    // not followed (an entry shall spell the path the build used).
+    //
+    // The results are cached by (working directory, raw path) for the
+    // lifetime of the process: a source file referenced by thousands of
+    // compilations is normalized once. The cache is safe to share
+    // between threads.
+    fs::path normalize(const fs::path &path, const fs::path &working_dir);
+
+    // The same normalization for a path which is already anchored.
+    fs::path normalize(const fs::path &path);
 }
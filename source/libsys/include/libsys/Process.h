@@ -22,9 +22,11 @@
 #include "config.h"
 #include "libresult/Result.h"
 
+#include <cstdint>
 #include <filesystem>
 #include <list>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -56,6 +58,20 @@ namespace sys {
         const int code_;
     };
 
+    // Resource usage of a reaped child, captured at the wait call from
+    // the same system call that collects the exit status. The numbers
+    // include everything the child itself waited for. The times are in
+    // microseconds, the peak resident set is in kilobytes, and the I/O
+    // counters are the block operation counts as the kernel accounts
+    // them.
+    struct ResourceUsage {
+        uint64_t user_time_usec;
+        uint64_t system_time_usec;
+        uint64_t max_rss_kb;
+        uint64_t block_reads;
+        uint64_t block_writes;
+    };
+
     class Process {
     public:
         class Builder;
@@ -63,16 +79,31 @@ namespace sys {
         [[nodiscard]]
         pid_t get_pid() const;
 
+        // The pidfd of the child, or -1 when the platform has none. The
+        // descriptor refers to the process itself (not its pid), so the
+        // signals sent through it can not hit a recycled pid.
+        [[nodiscard]]
+        int get_pidfd() const;
+
         rust::Result<ExitStatus> wait(bool request_for_signals = false);
         rust::Result<int> kill(int num);
 
+        // The resource usage of the child, available after a wait call
+        // observed its termination. Empty before that, and on platforms
+        // where the wait calls can not report it.
+        [[nodiscard]]
+        const std::optional<ResourceUsage>& get_usage() const;
+
     public:
         NON_DEFAULT_CONSTRUCTABLE(Process)
 
     private:
-        explicit Process(pid_t pid);
+        Process(pid_t pid, int pidfd);
 
         const pid_t pid_;
+        // Shared, so the copies of this object close the descriptor once.
+        std::shared_ptr<const int> pidfd_;
+        std::optional<ResourceUsage> usage_;
     };
 
     class Process::Builder {
@@ -21,11 +21,21 @@
 
 #include "config.h"
 #include <csignal>
+#include <thread>
 
 namespace sys {
 
     class Process;
 
+    // Relays the signals of this process to the supervised child, so an
+    // interactive interrupt or a job control signal reaches it.
+    //
+    // The handlers only note the signal number on a pipe (a single write,
+    // which is async-signal-safe); a dedicated poller thread picks the
+    // notes up and delivers them through the pidfd of the child. The
+    // handlers are installed with SA_RESTART, so the wait on the child is
+    // restarted by the kernel instead of failing with EINTR on every
+    // relayed signal.
     class SignalForwarder {
     public:
         explicit SignalForwarder(const Process &child) noexcept;
@@ -35,9 +45,14 @@ namespace sys {
         NON_DEFAULT_CONSTRUCTABLE(SignalForwarder)
         NON_COPYABLE_NOR_MOVABLE(SignalForwarder)
 
+    private:
+        void relay() noexcept;
+
     private:
         pid_t pid_;
-        using handler_t = void (*)(int);
-        handler_t handlers_[NSIG];
+        int pipe_[2];
+        int previous_note_fd_;
+        struct sigaction handlers_[NSIG];
+        std::thread poller_;
     };
 }
@@ -23,48 +23,50 @@
 #include <algorithm>
 #include <cstring>
 #include <functional>
+#include <tuple>
+#include <utility>
 
 namespace {
 
-    const char** to_c_array(const std::map<std::string, std::string>& entries)
+    std::pair<const char**, const char*> to_c_array(const std::map<std::string, std::string>& entries)
     {
-        // allocate the array for the pointer array
+        // allocate the pointer array and a single block for the entries
         const auto results = new const char*[entries.size() + 1];
+        size_t block_size = 0;
+        for (const auto& [key, value] : entries) {
+            block_size += key.size() + value.size() + 2;
+        }
+        const auto block = new char[block_size];
         // copy the elements
         auto results_it = results;
-        for (const auto& entry : entries) {
-            const auto& [key, value] = entry;
-            // allocate the entry
-            const size_t entry_size = key.size() + value.size() + 2;
-            auto result = new char[entry_size];
-            // assemble the content
-            {
-                auto it = std::copy(key.begin(), key.end(), result);
-                *it++ = '=';
-                it = std::copy(value.begin(), value.end(), it);
-                *it = '\0';
-            }
+        auto it = block;
+        for (const auto& [key, value] : entries) {
             // put into the pointer array
-            *results_it++ = result;
+            *results_it++ = it;
+            // assemble the content
+            it = std::copy(key.begin(), key.end(), it);
+            *it++ = '=';
+            it = std::copy(value.begin(), value.end(), it);
+            *it++ = '\0';
         }
         // set the terminator null pointer
         *results_it = nullptr;
-        return results;
+        return std::make_pair(results, block);
     }
 }
 
 namespace sys::env {
 
     Guard::Guard(const std::map<std::string, std::string> &environment)
-            : data_(to_c_array(environment))
+            : data_(nullptr)
+            , block_(nullptr)
     {
+        std::tie(data_, block_) = to_c_array(environment);
     }
 
     Guard::~Guard() noexcept
     {
-        for (const char** it = data_; *it != nullptr; ++it) {
-            delete[] * it;
-        }
+        delete[] block_;
         delete[] data_;
     }
 
@@ -82,9 +84,10 @@ namespace sys::env {
         for (const char** it = input; *it != nullptr; ++it) {
             const auto end = *it + std::strlen(*it);
             const auto sep = std::find(*it, end, '=');
-            const std::string key = (sep != end) ? std::string(*it, sep) : std::string(*it, end);
-            const std::string value = (sep != end) ? std::string(sep + 1, end) : std::string();
-            result.emplace(key, value);
+            // construct the strings in place, the entries are not copied again
+            result.emplace(
+                    std::string(*it, (sep != end) ? sep : end),
+                    (sep != end) ? std::string(sep + 1, end) : std::string());
         }
         return result;
     }
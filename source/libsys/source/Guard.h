@@ -31,6 +31,9 @@ namespace sys::env {
     // the values in different form. This class let the caller use a more
     // convenient form (`std::map<std::string, std::string>`)  to use,
     // but makes the final `const char**` not leak.
+    //
+    // All the entries live in one contiguous block, so the conversion
+    // costs two allocations regardless of the entry count.
     class Guard {
     public:
         explicit Guard(const std::map<std::string, std::string> &environment);
@@ -44,5 +47,6 @@ namespace sys::env {
 
     private:
         const char** data_;
+        const char* block_;
     };
 }
@@ -20,10 +20,28 @@
 #include "libsys/Path.h"
 
 #include <algorithm>
+#include <map>
+#include <mutex>
 #include <numeric>
+#include <utility>
 
 namespace {
 
+    fs::path normalize_uncached(const fs::path &candidate)
+    {
+        // Create canonical path without checking of file existence.
+        fs::path result;
+        for (const auto &part : candidate) {
+            if (part == ".")
+                continue;
+            if (part == "..")
+                result = result.parent_path();
+            else
+                result = result / part;
+        }
+        return result;
+    }
+
     std::list<fs::path> split_by(const std::string &input, const char sep)
     {
         std::list<fs::path> result;
@@ -75,4 +93,26 @@ namespace sys::path {
                ? rust::Result<fs::path>(rust::Err(std::runtime_error(error_code.message())))
                : rust::Result<fs::path>(rust::Ok(std::move(result)));
     }
+
+    fs::path normalize(const fs::path &path, const fs::path &working_dir)
+    {
+        // a build references the same paths over and over, remember the
+        // results instead of re-walking the components every time.
+        static std::map<std::pair<std::string, std::string>, fs::path> cache;
+        static std::mutex mutex;
+
+        std::lock_guard<std::mutex> guard(mutex);
+        auto key = std::make_pair(working_dir.string(), path.string());
+        if (auto it = cache.find(key); it != cache.end()) {
+            return it->second;
+        }
+        auto result = normalize_uncached(path.is_absolute() ? path : working_dir / path);
+        cache.emplace(std::move(key), result);
+        return result;
+    }
+
+    fs::path normalize(const fs::path &path)
+    {
+        return normalize(path, fs::path());
+    }
 }
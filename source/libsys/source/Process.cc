@@ -36,6 +36,12 @@
 #ifdef HAVE_SYS_WAIT_H
 #include <sys/wait.h>
 #endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -70,21 +76,26 @@ namespace {
 #ifdef SUPPORT_PRELOAD
     rust::Result<posix_spawn_t> resolve_spawn_function()
     {
-        errno = 0;
-        void *handle = ::dlopen(LIBC_SO, RTLD_LAZY);
-        if (handle == nullptr) {
-            const auto message = fmt::format("System call \"dlopen\" failed: {}", ::dlerror());
-            return rust::Err(std::runtime_error(message));
-        }
+        // The libc handle and the symbol don't change while the process
+        // runs; resolve them once instead of on every spawn.
+        static const rust::Result<posix_spawn_t> resolved = []() -> rust::Result<posix_spawn_t> {
+            errno = 0;
+            void *handle = ::dlopen(LIBC_SO, RTLD_LAZY);
+            if (handle == nullptr) {
+                const auto message = fmt::format("System call \"dlopen\" failed: {}", ::dlerror());
+                return rust::Err(std::runtime_error(message));
+            }
 
-        errno = 0;
-        auto fp = reinterpret_cast<posix_spawn_t>(::dlsym(handle, "posix_spawnp"));
-        if (fp == nullptr) {
-            const auto message = fmt::format("System call \"dlsym\" failed: {}", ::dlerror());
-            return rust::Err(std::runtime_error(message));
-        }
+            errno = 0;
+            auto fp = reinterpret_cast<posix_spawn_t>(::dlsym(handle, "posix_spawnp"));
+            if (fp == nullptr) {
+                const auto message = fmt::format("System call \"dlsym\" failed: {}", ::dlerror());
+                return rust::Err(std::runtime_error(message));
+            }
 
-        return rust::Ok(fp);
+            return rust::Ok(fp);
+        }();
+        return resolved;
     }
 #endif
 
@@ -101,18 +112,10 @@ namespace {
     rust::Result<pid_t> spawn_process(
             posix_spawn_t fp,
             const fs::path& program,
-            const std::list<std::string>& parameters,
-            const std::map<std::string, std::string>& environment,
+            char* const* args,
+            const char** envp,
             const bool redirect_io)
     {
-        // convert the arguments into a c-style array
-        std::vector<char*> args;
-        std::transform(parameters.begin(), parameters.end(),
-                       std::back_insert_iterator(args),
-                       [](const auto& arg) { return const_cast<char*>(arg.c_str()); });
-        args.push_back(nullptr);
-        // convert the environment into a c-style array
-        sys::env::Guard env(environment);
         // deal with file handles
         posix_spawn_file_actions_t file_actions;
         posix_spawn_file_actions_t *file_actionsp = nullptr;
@@ -134,20 +137,34 @@ namespace {
             file_actionsp = &file_actions;
         }
 
+        // On glibc the vfork based spawn avoids duplicating the page
+        // tables of the parent, which matters for the large collector
+        // process. (Newer glibc versions always take this path, and the
+        // flag became a no-op.)
+        posix_spawnattr_t attributes;
+        posix_spawnattr_t *attributes_ptr = nullptr;
+#ifdef POSIX_SPAWN_USEVFORK
+        if (0 == posix_spawnattr_init(&attributes)) {
+            posix_spawnattr_setflags(&attributes, POSIX_SPAWN_USEVFORK);
+            attributes_ptr = &attributes;
+        }
+#endif
+
         pid_t child;
         errno = 0;
-        if (0 != (*fp)(&child, program.c_str(), file_actionsp, nullptr, const_cast<char**>(args.data()), const_cast<char**>(env.data()))) {
-            const auto message = fmt::format("System call \"posix_spawnp\" failed: {}", sys::error_string(errno));
-            if (redirect_io) {
-                posix_spawn_file_actions_destroy(&file_actions);
-            }
+        const int status = (*fp)(&child, program.c_str(), file_actionsp, attributes_ptr, args, const_cast<char**>(envp));
+        const int spawn_errno = errno;
+        if (redirect_io) {
+            posix_spawn_file_actions_destroy(&file_actions);
+        }
+        if (attributes_ptr != nullptr) {
+            posix_spawnattr_destroy(attributes_ptr);
+        }
+        if (0 != status) {
+            const auto message = fmt::format("System call \"posix_spawnp\" failed: {}", sys::error_string(spawn_errno));
             return rust::Err(std::runtime_error(message));
-        } else {
-            if (redirect_io) {
-                posix_spawn_file_actions_destroy(&file_actions);
-            }
-            return rust::Ok(child);
         }
+        return rust::Ok(child);
     }
 
 
@@ -158,15 +175,25 @@ namespace {
         const std::map<std::string, std::string>& environment,
         const bool redirect_io)
     {
-        return spawn_process(fp, program, parameters, environment, redirect_io)
+        // Convert the arguments and the environment into c-style arrays
+        // once; the shell retry below reuses them. The first slot is
+        // reserved for the shell, so the retry is a pointer shift, not a
+        // new conversion.
+        std::vector<char*> args;
+        args.push_back(const_cast<char*>(PATH_TO_SH));
+        std::transform(parameters.begin(), parameters.end(),
+                       std::back_insert_iterator(args),
+                       [](const auto& arg) { return const_cast<char*>(arg.c_str()); });
+        args.push_back(nullptr);
+        sys::env::Guard env(environment);
+
+        return spawn_process(fp, program, args.data() + 1, env.data(), redirect_io)
                 // The file is accessible, but it is not an executable file.
                 // Invoke the shell to interpret it as a script.
                 .or_else([&](const std::runtime_error&) {
                     spdlog::debug("Process spawn failed. [will retry as shell]");
 
-                    std::list<std::string> args(parameters);
-                    args.insert(args.begin(), std::string(PATH_TO_SH));
-                    return spawn_process(fp, PATH_TO_SH, args, environment, redirect_io);
+                    return spawn_process(fp, PATH_TO_SH, args.data(), env.data(), redirect_io);
                 })
                 .on_success([&parameters](const auto& pid) {
                     spdlog::debug("Process spawned. [pid: {}, command: {}]", pid, parameters);
@@ -176,15 +203,111 @@ namespace {
                 });
     }
 
-    rust::Result<sys::ExitStatus> wait_for(const pid_t pid, const bool request_for_signals)
+#ifdef HAVE_SYS_RESOURCE_H
+    sys::ResourceUsage capture_usage(const struct rusage &usage)
+    {
+        const auto microseconds = [](const timeval &time) {
+            return uint64_t(time.tv_sec) * 1000000u + uint64_t(time.tv_usec);
+        };
+        return sys::ResourceUsage {
+                microseconds(usage.ru_utime),
+                microseconds(usage.ru_stime),
+#ifdef __APPLE__
+                // ru_maxrss is in bytes there, not in kilobytes.
+                uint64_t(usage.ru_maxrss) / 1024,
+#else
+                uint64_t(usage.ru_maxrss),
+#endif
+                uint64_t(usage.ru_inblock),
+                uint64_t(usage.ru_oublock),
+        };
+    }
+#endif
+
+    // Acquire a process file descriptor for the child. Returns -1 when
+    // the platform (or the kernel) has no pidfd support; the callers fall
+    // back to the pid based calls then.
+    int acquire_pidfd(const pid_t pid)
+    {
+#ifdef SYS_pidfd_open
+        return int(::syscall(SYS_pidfd_open, pid, 0));
+#else
+        (void)pid;
+        return -1;
+#endif
+    }
+
+#ifdef P_PIDFD
+    // Wait through the pidfd. Unlike waitpid, this can not be confused
+    // by a pid that was reaped and recycled behind our back.
+    rust::Result<sys::ExitStatus> wait_for_pidfd(const int pidfd, const bool request_for_signals, std::optional<sys::ResourceUsage> &usage)
+    {
+        const int mask = WEXITED | (request_for_signals ? (WSTOPPED | WCONTINUED) : 0);
+        siginfo_t info {};
+#if defined(SYS_waitid) && defined(HAVE_SYS_RESOURCE_H)
+        struct rusage used {};
+#endif
+        // A signal delivered to this thread (a handler installed without
+        // SA_RESTART) interrupts the wait; that is not an exit, retry.
+        int result;
+        do {
+            errno = 0;
+#if defined(SYS_waitid) && defined(HAVE_SYS_RESOURCE_H)
+            // the raw system call takes the rusage argument the libc
+            // wrapper does not expose.
+            result = int(::syscall(SYS_waitid, P_PIDFD, id_t(pidfd), &info, mask, &used));
+#else
+            result = ::waitid(P_PIDFD, id_t(pidfd), &info, mask);
+#endif
+        } while ((-1 == result) && (EINTR == errno));
+        if (-1 == result) {
+            auto message = fmt::format("System call \"waitid\" failed: {}", sys::error_string(errno));
+            return rust::Err(std::runtime_error(message));
+        }
+        switch (info.si_code) {
+            case CLD_EXITED:
+            case CLD_KILLED:
+            case CLD_DUMPED:
+                // the process is gone, the accounting is final.
+#if defined(SYS_waitid) && defined(HAVE_SYS_RESOURCE_H)
+                usage = capture_usage(used);
+#endif
+                return rust::Ok(sys::ExitStatus(CLD_EXITED == info.si_code, info.si_status));
+            case CLD_STOPPED:
+                return rust::Ok(sys::ExitStatus(false, info.si_status));
+            case CLD_CONTINUED:
+                return rust::Ok(sys::ExitStatus(false, SIGCONT));
+            default:
+                return rust::Err(std::runtime_error("System call \"waitid\" result is broken."));
+        }
+    }
+#endif
+
+    rust::Result<sys::ExitStatus> wait_for(const pid_t pid, const bool request_for_signals, std::optional<sys::ResourceUsage> &usage)
     {
         const int mask = request_for_signals ? (WUNTRACED | WCONTINUED) : 0;
-        errno = 0;
-        if (int status; -1 != ::waitpid(pid, &status, mask)) {
-            if (WIFEXITED(status)) {
-                return rust::Ok(sys::ExitStatus(true, WEXITSTATUS(status)));
-            } else if (WIFSIGNALED(status)) {
-                return rust::Ok(sys::ExitStatus(false, WTERMSIG(status)));
+        int status;
+#ifdef HAVE_SYS_RESOURCE_H
+        struct rusage used {};
+#endif
+        pid_t result;
+        do {
+            errno = 0;
+#ifdef HAVE_SYS_RESOURCE_H
+            result = ::wait4(pid, &status, mask, &used);
+#else
+            result = ::waitpid(pid, &status, mask);
+#endif
+        } while ((-1 == result) && (EINTR == errno));
+        if (-1 != result) {
+            if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                // the process is gone, the accounting is final.
+#ifdef HAVE_SYS_RESOURCE_H
+                usage = capture_usage(used);
+#endif
+                return WIFEXITED(status)
+                        ? rust::Ok(sys::ExitStatus(true, WEXITSTATUS(status)))
+                        : rust::Ok(sys::ExitStatus(false, WTERMSIG(status)));
             } else if (WIFSTOPPED(status)) {
                 return rust::Ok(sys::ExitStatus(false, WSTOPSIG(status)));
             } else if (WIFCONTINUED(status)) {
@@ -198,8 +321,20 @@ namespace {
         }
     }
 
-    rust::Result<int> send_signal(const pid_t pid, const int num)
+    rust::Result<int> send_signal(const pid_t pid, const int pidfd, const int num)
     {
+#ifdef SYS_pidfd_send_signal
+        if (pidfd >= 0) {
+            errno = 0;
+            if (const int result = int(::syscall(SYS_pidfd_send_signal, pidfd, num, nullptr, 0)); 0 == result) {
+                return rust::Ok(result);
+            }
+            auto message = fmt::format("System call \"pidfd_send_signal\" failed: {}", sys::error_string(errno));
+            return rust::Err(std::runtime_error(message));
+        }
+#else
+        (void)pidfd;
+#endif
         errno = 0;
         if (const int result = ::kill(pid, num); 0 == result) {
             return rust::Ok(result);
@@ -238,8 +373,11 @@ namespace sys {
         return is_code_ || ((code_ != SIGCONT) && (code_ != SIGSTOP));
     }
 
-    Process::Process(pid_t pid)
+    Process::Process(pid_t pid, int pidfd)
             : pid_(pid)
+            , pidfd_((pidfd >= 0)
+                    ? std::shared_ptr<const int>(new int(pidfd), [](const int *fd) { ::close(*fd); delete fd; })
+                    : nullptr)
     {
     }
 
@@ -248,10 +386,24 @@ namespace sys {
         return pid_;
     }
 
+    int Process::get_pidfd() const
+    {
+        return pidfd_ ? *pidfd_ : -1;
+    }
+
+    const std::optional<ResourceUsage>& Process::get_usage() const
+    {
+        return usage_;
+    }
+
     rust::Result<ExitStatus> Process::wait(const bool request_for_signals)
     {
         spdlog::debug("Process wait requested. [pid: {}]", pid_);
-        return wait_for(pid_, request_for_signals)
+#ifdef P_PIDFD
+        return (pidfd_ ? wait_for_pidfd(*pidfd_, request_for_signals, usage_) : wait_for(pid_, request_for_signals, usage_))
+#else
+        return wait_for(pid_, request_for_signals, usage_)
+#endif
             .on_success([this](const auto&) {
                 spdlog::debug("Process wait request: done. [pid: {}]", pid_);
             })
@@ -263,7 +415,7 @@ namespace sys {
     rust::Result<int> Process::kill(int num)
     {
         spdlog::debug("Process kill requested. [pid: {}, signum: {}]", pid_, num);
-        return send_signal(pid_, num)
+        return send_signal(pid_, get_pidfd(), num)
             .on_success([this](const auto&) {
                 spdlog::debug("Process kill request: done. [pid: {}]", pid_);
             })
@@ -331,7 +483,9 @@ namespace sys {
                 return spawn_process_with_retry(fp, program_, parameters_, environment_, redirect_io_);
             })
             .map<Process>([](auto pid) {
-                return Process(pid);
+                // The pidfd is acquired right after the spawn, while the
+                // child is surely not reaped, so it names this child.
+                return Process(pid, acquire_pidfd(pid));
             });
     }
 }
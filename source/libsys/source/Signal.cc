@@ -20,7 +20,17 @@
 #include "libsys/Signal.h"
 #include "libsys/Process.h"
 
-#include <set>
+#include <atomic>
+#include <cerrno>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 namespace {
 
@@ -35,13 +45,45 @@ namespace {
         }
     }
 
-    std::set<pid_t> CHILD_PROCESSES;
+    // Deliver a single signal to a single child.
+    void forward(const pid_t pid, const int pidfd, const int signum) {
+        // Through the pidfd the signal can not hit an unrelated
+        // process, even if the child was reaped and its pid got
+        // recycled meanwhile. (Both calls are async-signal-safe.)
+#ifdef SYS_pidfd_send_signal
+        if (pidfd >= 0) {
+            ::syscall(SYS_pidfd_send_signal, pidfd, signum, nullptr, 0);
+            return;
+        }
+#endif
+        ::kill(pid, signum);
+    }
+
+    // The children with their pidfd (or -1 when the platform has none).
+    std::map<pid_t, int> CHILD_PROCESSES;
+    std::mutex CHILD_PROCESSES_MUTEX;
+
+    // The write end of the note pipe of the active forwarder. The handler
+    // only pushes the signal number here; the poller thread does the rest.
+    std::atomic<int> NOTE_FD(-1);
 
     void handler(const int signum) {
-        if (shall_forward(signum)) {
-            for (const auto pid : CHILD_PROCESSES) {
-                ::kill(pid, signum);
-            }
+        if (!shall_forward(signum)) {
+            return;
+        }
+        const int fd = NOTE_FD.load(std::memory_order_relaxed);
+        if (fd >= 0) {
+            // A single write is async-signal-safe, and every signal number
+            // fits into a byte. The pipe is non blocking, so a signal storm
+            // can not wedge the handler; dropping a note there only loses
+            // a relay queued up behind a pipe buffer full of others.
+            const unsigned char note = static_cast<unsigned char>(signum);
+            [[maybe_unused]] const ssize_t ignored = ::write(fd, &note, sizeof(note));
+            return;
+        }
+        // Without the pipe, forward straight from the handler.
+        for (const auto &[pid, pidfd] : CHILD_PROCESSES) {
+            forward(pid, pidfd, signum);
         }
     }
 }
@@ -50,19 +92,80 @@ namespace sys {
 
     SignalForwarder::SignalForwarder(const Process &child) noexcept
             : pid_(child.get_pid())
+            , pipe_{-1, -1}
+            , previous_note_fd_(-1)
             , handlers_()
+            , poller_()
     {
-        CHILD_PROCESSES.insert(pid_);
+        {
+            const std::lock_guard<std::mutex> guard(CHILD_PROCESSES_MUTEX);
+            CHILD_PROCESSES.emplace(pid_, child.get_pidfd());
+        }
+        if (::pipe(pipe_) == 0) {
+            ::fcntl(pipe_[0], F_SETFL, O_NONBLOCK);
+            ::fcntl(pipe_[1], F_SETFL, O_NONBLOCK);
+            ::fcntl(pipe_[0], F_SETFD, FD_CLOEXEC);
+            ::fcntl(pipe_[1], F_SETFD, FD_CLOEXEC);
+            previous_note_fd_ = NOTE_FD.exchange(pipe_[1]);
+            poller_ = std::thread([this]() { relay(); });
+        }
+        // SA_RESTART keeps the wait on the child (and every other slow
+        // syscall) going, instead of returning EINTR on every relay.
+        struct sigaction action { };
+        action.sa_handler = &handler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
         for (int signum = 1; signum < NSIG; ++signum) {
-            handlers_[signum] = ::signal(signum, &handler);
+            ::sigaction(signum, &action, &handlers_[signum]);
         }
     }
 
     SignalForwarder::~SignalForwarder() noexcept
     {
-        CHILD_PROCESSES.erase(pid_);
+        // Restore the dispositions first, so no new note is written.
         for (int signum = 1; signum < NSIG; ++signum) {
-            ::signal(signum, handlers_[signum]);
+            ::sigaction(signum, &handlers_[signum], nullptr);
+        }
+        if (pipe_[1] >= 0) {
+            NOTE_FD.store(previous_note_fd_);
+            // Closing the write end wakes the poller up with an EOF,
+            // once it relayed the notes which are still in the pipe.
+            ::close(pipe_[1]);
+            poller_.join();
+            ::close(pipe_[0]);
+        }
+        const std::lock_guard<std::mutex> guard(CHILD_PROCESSES_MUTEX);
+        CHILD_PROCESSES.erase(pid_);
+    }
+
+    void SignalForwarder::relay() noexcept
+    {
+        struct pollfd waited = { pipe_[0], POLLIN, 0 };
+        for (;;) {
+            if (::poll(&waited, 1, -1) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            unsigned char notes[64];
+            const ssize_t count = ::read(pipe_[0], notes, sizeof(notes));
+            if (count == 0) {
+                // The write end is closed, the destructor quits.
+                return;
+            }
+            if (count < 0) {
+                if (errno == EINTR || errno == EAGAIN) {
+                    continue;
+                }
+                return;
+            }
+            const std::lock_guard<std::mutex> guard(CHILD_PROCESSES_MUTEX);
+            for (ssize_t idx = 0; idx < count; ++idx) {
+                for (const auto &[pid, pidfd] : CHILD_PROCESSES) {
+                    forward(pid, pidfd, static_cast<int>(notes[idx]));
+                }
+            }
         }
     }
 }
@@ -74,4 +74,46 @@ namespace {
         const std::string expected = "/path/to:/path/to/another";
         EXPECT_EQ(expected, result);
     }
+
+    TEST(path, normalize_keeps_absolute_path)
+    {
+        const auto result = sys::path::normalize("/path/to/source.c", "/path/elsewhere");
+
+        const fs::path expected = "/path/to/source.c";
+        EXPECT_EQ(expected, result);
+    }
+
+    TEST(path, normalize_anchors_relative_path)
+    {
+        const auto result = sys::path::normalize("source.c", "/path/to");
+
+        const fs::path expected = "/path/to/source.c";
+        EXPECT_EQ(expected, result);
+    }
+
+    TEST(path, normalize_removes_dot_components)
+    {
+        const auto result = sys::path::normalize("./src/./source.c", "/path/to");
+
+        const fs::path expected = "/path/to/src/source.c";
+        EXPECT_EQ(expected, result);
+    }
+
+    TEST(path, normalize_resolves_dot_dot_components)
+    {
+        const auto result = sys::path::normalize("../other/source.c", "/path/to");
+
+        const fs::path expected = "/path/other/source.c";
+        EXPECT_EQ(expected, result);
+    }
+
+    TEST(path, normalize_repeated_lookup_is_stable)
+    {
+        const auto first = sys::path::normalize("src/../lib/source.c", "/path/to");
+        const auto second = sys::path::normalize("src/../lib/source.c", "/path/to");
+
+        const fs::path expected = "/path/to/lib/source.c";
+        EXPECT_EQ(expected, first);
+        EXPECT_EQ(expected, second);
+    }
 }
\ No newline at end of file
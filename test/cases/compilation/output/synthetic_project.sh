@@ -0,0 +1,14 @@
+#!/usr/bin/env sh
+
+# The synthetic project generator backs the scale benchmark; this case
+# checks that it is deterministic and that a full build over its output
+# yields exactly one entry per translation unit (plus the main).
+
+# REQUIRES: shell, make
+# RUN: cd %T; %{shell} %s
+# RUN: cd %T/synthetic_project; %{bear} --verbose --output %t.json -- %{make}
+# RUN: assert_compilation %t.json count -eq 13
+
+generate_project --output synthetic_project --units 12 --fanout 4 --seed 42
+generate_project --output synthetic_project_again --units 12 --fanout 4 --seed 42
+diff -r synthetic_project synthetic_project_again